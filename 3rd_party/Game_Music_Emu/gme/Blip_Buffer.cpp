@@ -34,6 +34,7 @@ Blip_Buffer::Blip_Buffer()
 	sample_rate_  = 0;
 	reader_accum_ = 0;
 	bass_shift_   = 0;
+	synth_quality_ = blip_synth_standard;
 	clock_rate_   = 0;
 	bass_freq_    = 16;
 	length_       = 0;
@@ -203,15 +204,23 @@ void Blip_Synth_Fast_::volume_unit( double new_unit )
 
 #if !BLIP_BUFFER_FAST
 
+#if BLIP_BUFFER_SIMD
+Blip_Synth_::Blip_Synth_( short* p, int w, blip_long* k ) :
+	impulses( p ),
+	width( w ),
+	kernels( k )
+#else
 Blip_Synth_::Blip_Synth_( short* p, int w ) :
 	impulses( p ),
 	width( w )
+#endif
 {
 	volume_unit_ = 0.0;
 	kernel_unit = 0;
 	buf = 0;
 	last_amp = 0;
 	delta_factor = 0;
+	linear_factor = 0;
 }
 
 #undef PI
@@ -285,6 +294,19 @@ void Blip_Synth_::adjust_impulse()
 		//printf( "error: %ld\n", error );
 	}
 	
+	#if BLIP_BUFFER_SIMD
+		// unfold each phase's impulse as offset_resampled() walks it: first half
+		// forward from imp = impulses + blip_res - phase, second half mirrored
+		for ( int phase = 0; phase < blip_res; phase++ )
+		{
+			blip_long* kernel = kernels + phase * width;
+			for ( int j = 0; j < width / 2; j++ )
+				kernel [j] = impulses [blip_res * (j + 1) - phase];
+			for ( int j = width / 2; j < width; j++ )
+				kernel [j] = impulses [phase + blip_res * (width - 1 - j)];
+		}
+	#endif
+	
 	//for ( int i = blip_res; i--; printf( "\n" ) )
 	//  for ( int j = 0; j < width / 2; j++ )
 	//      printf( "%5ld,", impulses [j * blip_res + i + 1] );
@@ -348,6 +370,7 @@ void Blip_Synth_::volume_unit( double new_unit )
 			treble_eq( -8.0 );
 		
 		volume_unit_ = new_unit;
+		linear_factor = (int) floor( new_unit * (1L << blip_sample_bits) + 0.5 );
 		double factor = new_unit * (1L << blip_sample_bits) / kernel_unit;
 		
 		if ( factor > 0.0 )
@@ -422,6 +445,84 @@ long Blip_Buffer::read_samples( blip_sample_t* BLIP_RESTRICT out, long max_sampl
 	return count;
 }
 
+long Blip_Buffer::read_samples( Blip_Buffer* const* bufs, int buf_count, blip_sample_t* out,
+		long stride, long max_samples )
+{
+	long count = max_samples;
+	for ( int i = 0; i < buf_count; i++ )
+		if ( count > bufs [i]->samples_avail() )
+			count = bufs [i]->samples_avail();
+	
+	if ( count <= 0 )
+		return 0;
+	
+	int i = 0;
+	#if BLIP_BUFFER_SIMD
+		// the shift is the same for all lanes, so mismatched bass reads each on its own
+		int const bass = BLIP_READER_BASS( *bufs [0] );
+		int lockstep = buf_count;
+		for ( int k = 1; k < buf_count; k++ )
+			if ( BLIP_READER_BASS( *bufs [k] ) != bass )
+				lockstep = 0;
+		
+		static buf_t_ const silence [4] = { 0 };
+		for ( ; i + 1 < lockstep; i += 4 )
+		{
+			// fill a short group with a silent reader whose output is dropped
+			int const lanes = (buf_count - i < 4 ? buf_count - i : 4);
+			blip_long accums [4] = { 0 };
+			buf_t_ const* in [4];
+			long advance [4]; // index mask, so the silent reader stays put
+			for ( int k = 0; k < 4; k++ )
+			{
+				in [k] = silence;
+				advance [k] = 0;
+				if ( k < lanes )
+				{
+					in [k] = bufs [i + k]->buffer_;
+					advance [k] = ~0L;
+					accums [k] = bufs [i + k]->reader_accum_;
+				}
+			}
+			
+			blip_vec_t accum = blip_vload( accums );
+			long n = 0;
+			for ( ; n + 4 <= count; n += 4 )
+			{
+				blip_vec_t v [4];
+				for ( int k = 0; k < 4; k++ )
+					v [k] = blip_vload( in [k] + (n & advance [k]) );
+				blip_read4( accum, v, bass );
+				for ( int k = 0; k < lanes; k++ )
+					blip_vstore16( out + (i + k) * stride + n, v [k] );
+			}
+			blip_vstore( accums, accum );
+			
+			// remaining few samples one at a time
+			for ( int k = 0; k < lanes; k++ )
+			{
+				blip_sample_t* BLIP_RESTRICT dest = out + (i + k) * stride;
+				blip_long a = accums [k];
+				for ( long m = n; m < count; m++ )
+				{
+					blip_long s = a >> (blip_sample_bits - 16);
+					if ( (blip_sample_t) s != s )
+						s = 0x7FFF - (s >> 24);
+					dest [m] = (blip_sample_t) s;
+					a += in [k] [m] - (a >> bass);
+				}
+				bufs [i + k]->reader_accum_ = a;
+				bufs [i + k]->remove_samples( count );
+			}
+		}
+	#endif
+	
+	for ( ; i < buf_count; i++ )
+		bufs [i]->read_samples( out + i * stride, count );
+	
+	return count;
+}
+
 void Blip_Buffer::mix_samples( blip_sample_t const* in, long count )
 {
 	if ( buffer_size_ == silent_buf_size )
@@ -21,6 +21,13 @@ typedef blip_long blip_time_t;
 typedef short blip_sample_t;
 enum { blip_sample_max = 32767 };
 
+// How Blip_Synths place amplitude changes into a buffer; see synth_quality()
+enum {
+	blip_synth_linear   = 0, // between two samples, as BLIP_BUFFER_FAST does
+	blip_synth_standard = 1, // with each synth's own kernel (its quality)
+	blip_synth_wide     = 2  // with the widest kernel, whatever the synth's quality
+};
+
 class Blip_Buffer {
 public:
 	typedef const char* blargg_err_t;
@@ -52,6 +59,9 @@ public:
 	// Length of buffer, in milliseconds
 	int length() const;
 	
+	// Bytes allocated for the buffer's samples
+	long buffer_bytes() const;
+	
 	// Number of source time units per second
 	long clock_rate() const;
 	
@@ -61,6 +71,13 @@ public:
 	// Number of samples delay from synthesis to samples read out
 	int output_latency() const;
 	
+	// Set resampling quality of synths writing into this buffer, trading
+	// rolloff and aliasing against time per amplitude change. Takes effect
+	// from the next change; the latency stays the same. Ignored with
+	// BLIP_BUFFER_FAST, which is always linear.
+	void synth_quality( int q )     { synth_quality_ = q; }
+	int synth_quality() const       { return synth_quality_; }
+	
 	// Remove all available samples and clear buffer to silence. If 'entire_buffer' is
 	// false, just clears out any samples waiting rather than the entire buffer.
 	void clear( int entire_buffer = 1 );
@@ -92,6 +109,13 @@ public:
 	blip_resampled_time_t resampled_duration( int t ) const     { return t * factor_; }
 	blip_resampled_time_t resampled_time( blip_time_t t ) const { return t * factor_ + offset_; }
 	blip_resampled_time_t clock_rate_factor( long clock_rate ) const;
+	
+	// Read from 'count' buffers in lockstep, buffer i's samples to dest + i * stride.
+	// Reads at most 'max_samples', and no more than the emptiest buffer has. Output
+	// is the same as read_samples() on each in turn; with BLIP_BUFFER_SIMD, buffers
+	// are run four at a time.
+	static long read_samples( Blip_Buffer* const* bufs, int count, blip_sample_t* dest,
+			long stride, long max_samples );
 public:
 	Blip_Buffer();
 	~Blip_Buffer();
@@ -112,6 +136,7 @@ public:
 	blip_long buffer_size_;
 	blip_long reader_accum_;
 	int bass_shift_;
+	int synth_quality_;
 private:
 	long sample_rate_;
 	long clock_rate_;
@@ -142,6 +167,32 @@ private:
 	#endif
 #endif
 
+// Use SSE2, NEON or WebAssembly SIMD, whichever the target has, for Blip_Synth's
+// impulse adds, for reading several buffers at once, and for Fir_Resampler's
+// filter. Output is identical to the plain loops'. Changes the size of Blip_Synth, so must match across the program.
+#ifndef BLIP_BUFFER_SIMD
+	#define BLIP_BUFFER_SIMD 1
+#endif
+
+#if BLIP_BUFFER_SIMD
+	#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define BLIP_SIMD_SSE2 1
+		#include <emmintrin.h>
+		#if defined (__SSE4_1__)
+			#include <smmintrin.h>
+		#endif
+	#elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+		#define BLIP_SIMD_NEON 1
+		#include <arm_neon.h>
+	#elif defined (__wasm_simd128__)
+		#define BLIP_SIMD_WASM 1
+		#include <wasm_simd128.h>
+	#else
+		#undef BLIP_BUFFER_SIMD
+		#define BLIP_BUFFER_SIMD 0
+	#endif
+#endif
+
 	// Internal
 	typedef blip_ulong blip_resampled_time_t;
 	int const blip_widest_impulse_ = 16;
@@ -149,6 +200,128 @@ private:
 	int const blip_res = 1 << BLIP_PHASE_BITS;
 	class blip_eq_t;
 	
+#if BLIP_BUFFER_SIMD
+	// Four 32-bit lanes
+	#if BLIP_SIMD_SSE2
+		typedef __m128i blip_vec_t;
+		inline blip_vec_t blip_vload( blip_long const* p ) { return _mm_loadu_si128( (__m128i const*) p ); }
+		inline void blip_vstore( blip_long* p, blip_vec_t v ) { _mm_storeu_si128( (__m128i*) p, v ); }
+		inline blip_vec_t blip_vzero() { return _mm_setzero_si128(); }
+		inline blip_vec_t blip_vadd( blip_vec_t a, blip_vec_t b ) { return _mm_add_epi32( a, b ); }
+		inline blip_vec_t blip_vsub( blip_vec_t a, blip_vec_t b ) { return _mm_sub_epi32( a, b ); }
+		inline blip_vec_t blip_vsra( blip_vec_t v, int n ) { return _mm_sra_epi32( v, _mm_cvtsi32_si128( n ) ); }
+		
+		// acc + k * delta, where each k fits in 16 bits
+		inline blip_vec_t blip_vmul_add( blip_vec_t acc, blip_vec_t k, blip_long delta )
+		{
+		#if defined (__SSE4_1__)
+			return _mm_add_epi32( acc, _mm_mullo_epi32( k, _mm_set1_epi32( delta ) ) );
+		#else
+			// no 32-bit multiply in SSE2: split delta into 16-bit halves for pmaddwd,
+			// with the low half signed and the upper halves of the pairs zero
+			blip_long lo = (short) delta;
+			blip_vec_t vlo = _mm_set1_epi32( lo & 0xFFFF );
+			blip_vec_t vhi = _mm_set1_epi32( ((delta - lo) >> 16) & 0xFFFF );
+			blip_vec_t prod = _mm_add_epi32( _mm_madd_epi16( k, vlo ),
+					_mm_slli_epi32( _mm_madd_epi16( k, vhi ), 16 ) );
+			return _mm_add_epi32( acc, prod );
+		#endif
+		}
+		
+		inline void blip_vtranspose( blip_vec_t v [4] )
+		{
+			blip_vec_t t0 = _mm_unpacklo_epi32( v [0], v [1] );
+			blip_vec_t t1 = _mm_unpacklo_epi32( v [2], v [3] );
+			blip_vec_t t2 = _mm_unpackhi_epi32( v [0], v [1] );
+			blip_vec_t t3 = _mm_unpackhi_epi32( v [2], v [3] );
+			v [0] = _mm_unpacklo_epi64( t0, t1 );
+			v [1] = _mm_unpackhi_epi64( t0, t1 );
+			v [2] = _mm_unpacklo_epi64( t2, t3 );
+			v [3] = _mm_unpackhi_epi64( t2, t3 );
+		}
+		
+		// Saturated to 16 bits: four samples, or four pairs interleaved l, r
+		inline void blip_vstore16( blip_sample_t* out, blip_vec_t v )
+		{
+			_mm_storel_epi64( (__m128i*) out, _mm_packs_epi32( v, v ) );
+		}
+		inline void blip_vstore16_stereo( blip_sample_t* out, blip_vec_t l, blip_vec_t r )
+		{
+			blip_vec_t l16 = _mm_packs_epi32( l, l );
+			blip_vec_t r16 = _mm_packs_epi32( r, r );
+			_mm_storeu_si128( (__m128i*) out, _mm_unpacklo_epi16( l16, r16 ) );
+		}
+	#elif BLIP_SIMD_NEON
+		typedef int32x4_t blip_vec_t;
+		inline blip_vec_t blip_vload( blip_long const* p ) { return vld1q_s32( (int32_t const*) p ); }
+		inline void blip_vstore( blip_long* p, blip_vec_t v ) { vst1q_s32( (int32_t*) p, v ); }
+		inline blip_vec_t blip_vzero() { return vdupq_n_s32( 0 ); }
+		inline blip_vec_t blip_vadd( blip_vec_t a, blip_vec_t b ) { return vaddq_s32( a, b ); }
+		inline blip_vec_t blip_vsub( blip_vec_t a, blip_vec_t b ) { return vsubq_s32( a, b ); }
+		inline blip_vec_t blip_vsra( blip_vec_t v, int n ) { return vshlq_s32( v, vdupq_n_s32( -n ) ); }
+		inline blip_vec_t blip_vmul_add( blip_vec_t acc, blip_vec_t k, blip_long delta )
+		{
+			return vmlaq_n_s32( acc, k, delta );
+		}
+		
+		inline void blip_vtranspose( blip_vec_t v [4] )
+		{
+			int32x4x2_t t01 = vtrnq_s32( v [0], v [1] );
+			int32x4x2_t t23 = vtrnq_s32( v [2], v [3] );
+			v [0] = vcombine_s32( vget_low_s32 ( t01.val [0] ), vget_low_s32 ( t23.val [0] ) );
+			v [1] = vcombine_s32( vget_low_s32 ( t01.val [1] ), vget_low_s32 ( t23.val [1] ) );
+			v [2] = vcombine_s32( vget_high_s32( t01.val [0] ), vget_high_s32( t23.val [0] ) );
+			v [3] = vcombine_s32( vget_high_s32( t01.val [1] ), vget_high_s32( t23.val [1] ) );
+		}
+		
+		inline void blip_vstore16( blip_sample_t* out, blip_vec_t v )
+		{
+			vst1_s16( (int16_t*) out, vqmovn_s32( v ) );
+		}
+		inline void blip_vstore16_stereo( blip_sample_t* out, blip_vec_t l, blip_vec_t r )
+		{
+			int16x4x2_t lr;
+			lr.val [0] = vqmovn_s32( l );
+			lr.val [1] = vqmovn_s32( r );
+			vst2_s16( (int16_t*) out, lr );
+		}
+	#else
+		typedef v128_t blip_vec_t;
+		inline blip_vec_t blip_vload( blip_long const* p ) { return wasm_v128_load( p ); }
+		inline void blip_vstore( blip_long* p, blip_vec_t v ) { wasm_v128_store( p, v ); }
+		inline blip_vec_t blip_vzero() { return wasm_i32x4_splat( 0 ); }
+		inline blip_vec_t blip_vadd( blip_vec_t a, blip_vec_t b ) { return wasm_i32x4_add( a, b ); }
+		inline blip_vec_t blip_vsub( blip_vec_t a, blip_vec_t b ) { return wasm_i32x4_sub( a, b ); }
+		inline blip_vec_t blip_vsra( blip_vec_t v, int n ) { return wasm_i32x4_shr( v, n ); }
+		inline blip_vec_t blip_vmul_add( blip_vec_t acc, blip_vec_t k, blip_long delta )
+		{
+			return wasm_i32x4_add( acc, wasm_i32x4_mul( k, wasm_i32x4_splat( delta ) ) );
+		}
+		
+		inline void blip_vtranspose( blip_vec_t v [4] )
+		{
+			blip_vec_t t0 = wasm_i32x4_shuffle( v [0], v [1], 0, 4, 1, 5 );
+			blip_vec_t t1 = wasm_i32x4_shuffle( v [2], v [3], 0, 4, 1, 5 );
+			blip_vec_t t2 = wasm_i32x4_shuffle( v [0], v [1], 2, 6, 3, 7 );
+			blip_vec_t t3 = wasm_i32x4_shuffle( v [2], v [3], 2, 6, 3, 7 );
+			v [0] = wasm_i64x2_shuffle( t0, t1, 0, 2 );
+			v [1] = wasm_i64x2_shuffle( t0, t1, 1, 3 );
+			v [2] = wasm_i64x2_shuffle( t2, t3, 0, 2 );
+			v [3] = wasm_i64x2_shuffle( t2, t3, 1, 3 );
+		}
+		
+		inline void blip_vstore16( blip_sample_t* out, blip_vec_t v )
+		{
+			wasm_v128_store64_lane( out, wasm_i16x8_narrow_i32x4( v, v ), 0 );
+		}
+		inline void blip_vstore16_stereo( blip_sample_t* out, blip_vec_t l, blip_vec_t r )
+		{
+			blip_vec_t lr = wasm_i16x8_narrow_i32x4( l, r );
+			wasm_v128_store( out, wasm_i16x8_shuffle( lr, lr, 0, 4, 1, 5, 2, 6, 3, 7 ) );
+		}
+	#endif
+#endif
+	
 	class Blip_Synth_Fast_ {
 	public:
 		Blip_Buffer* buf;
@@ -165,14 +338,22 @@ private:
 		Blip_Buffer* buf;
 		int last_amp;
 		int delta_factor;
+		int linear_factor; // delta_factor for blip_synth_linear, which has no kernel
 		
 		void volume_unit( double );
+	#if BLIP_BUFFER_SIMD
+		Blip_Synth_( short* impulses, int width, blip_long* kernels );
+	#else
 		Blip_Synth_( short* impulses, int width );
+	#endif
 		void treble_eq( blip_eq_t const& );
 	private:
 		double volume_unit_;
 		short* const impulses;
 		int const width;
+	#if BLIP_BUFFER_SIMD
+		blip_long* const kernels;
+	#endif
 		blip_long kernel_unit;
 		int impulses_size() const { return blip_res / 2 * width + 1; }
 		void adjust_impulse();
@@ -190,10 +371,10 @@ template<int quality,int range>
 class Blip_Synth {
 public:
 	// Set overall volume of waveform
-	void volume( double v ) { impl.volume_unit( v * (1.0 / (range < 0 ? -range : range)) ); }
+	void volume( double v );
 	
 	// Configure low-pass filter (see blip_buffer.txt)
-	void treble_eq( blip_eq_t const& eq )       { impl.treble_eq( eq ); }
+	void treble_eq( blip_eq_t const& eq );
 	
 	// Get/set Blip_Buffer used for output
 	Blip_Buffer* output() const                 { return impl.buf; }
@@ -229,8 +410,21 @@ private:
 	Blip_Synth_ impl;
 	typedef short imp_t;
 	imp_t impulses [blip_res * (quality / 2) + 1];
+	// blip_synth_wide's kernel; only its impulses and delta_factor are used
+	Blip_Synth_ wide;
+	imp_t wide_impulses [blip_res * (blip_widest_impulse_ / 2) + 1];
+#if BLIP_BUFFER_SIMD
+	// the whole impulse for each phase, in output order, for vector adds
+	blip_long kernels [blip_res] [quality];
+	blip_long wide_kernels [blip_res] [blip_widest_impulse_];
 public:
-	Blip_Synth() : impl( impulses, quality ) { }
+	Blip_Synth() :
+		impl( impulses, quality, &kernels [0] [0] ),
+		wide( wide_impulses, blip_widest_impulse_, &wide_kernels [0] [0] ) { }
+#else
+public:
+	Blip_Synth() : impl( impulses, quality ), wide( wide_impulses, blip_widest_impulse_ ) { }
+#endif
 #endif
 };
 
@@ -303,6 +497,24 @@ int const blip_reader_default_bass = 9;
 #define BLIP_READER_END( name, blip_buffer ) \
 	(void) ((blip_buffer).reader_accum_ = name##_reader_accum)
 
+#if BLIP_BUFFER_SIMD
+	// internal
+	// Four readers over four samples at once: accum holds each reader's accumulator,
+	// and v [i] the next four raw samples of reader i. Replaces them with what
+	// BLIP_READER_READ() gives for those samples, and advances accum past them.
+	inline void blip_read4( blip_vec_t& accum, blip_vec_t v [4], int bass )
+	{
+		blip_vtranspose( v );
+		for ( int i = 0; i < 4; i++ )
+		{
+			blip_vec_t s = blip_vsra( accum, blip_sample_bits - 16 );
+			accum = blip_vadd( accum, blip_vsub( v [i], blip_vsra( accum, bass ) ) );
+			v [i] = s;
+		}
+		blip_vtranspose( v );
+	}
+#endif
+
 
 // Compatibility with older version
 const long blip_unscaled = 65535;
@@ -334,36 +546,33 @@ private:
 
 #include <assert.h>
 
-template<int quality,int range>
-inline void Blip_Synth<quality,range>::offset_resampled( blip_resampled_time_t time,
-		int delta, Blip_Buffer* blip_buf ) const
+// internal
+// Add the kernel for phase, quality points wide and scaled by delta, around buf's centre.
+// The SIMD path reads the pre-expanded kernels, the scalar one the impulses.
+template<int quality>
+inline void blip_add_kernel( blip_long* BLIP_RESTRICT buf, int phase, blip_long delta,
+	#if BLIP_BUFFER_SIMD
+		blip_long const (*kernels) [quality]
+	#else
+		short const* impulses
+	#endif
+		)
 {
-	// Fails if time is beyond end of Blip_Buffer, due to a bug in caller code or the
-	// need for a longer buffer as set by set_sample_rate().
-	assert( (blip_long) (time >> BLIP_BUFFER_ACCURACY) < blip_buf->buffer_size_ );
-	delta *= impl.delta_factor;
-	blip_long* BLIP_RESTRICT buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
-	int phase = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
-
-#if BLIP_BUFFER_FAST
-	blip_long left = buf [0] + delta;
+	int const fwd = (blip_widest_impulse_ - quality) / 2;
 	
-	// Kind of crappy, but doing shift after multiply results in overflow.
-	// Alternate way of delaying multiply by delta_factor results in worse
-	// sub-sample resolution.
-	blip_long right = (delta >> BLIP_PHASE_BITS) * phase;
-	left  -= right;
-	right += buf [1];
+	#if BLIP_BUFFER_SIMD
+	
+	blip_long* BLIP_RESTRICT out = buf + fwd;
+	blip_long const* kernel = kernels [phase];
+	for ( int i = 0; i < quality; i += 4 )
+		blip_vstore( out + i, blip_vmul_add( blip_vload( out + i ), blip_vload( kernel + i ), delta ) );
+	
+	#else
 	
-	buf [0] = left;
-	buf [1] = right;
-#else
-
-	int const fwd = (blip_widest_impulse_ - quality) / 2;
 	int const rev = fwd + quality - 2;
 	int const mid = quality / 2 - 1;
 	
-	imp_t const* BLIP_RESTRICT imp = impulses + blip_res - phase;
+	short const* BLIP_RESTRICT imp = impulses + blip_res - phase;
 	
 	#if defined (_M_IX86) || defined (_M_IA64) || defined (__i486__) || \
 			defined (__x86_64__) || defined (__ia64__) || defined (__i386__)
@@ -438,12 +647,88 @@ inline void Blip_Synth<quality,range>::offset_resampled( blip_resampled_time_t t
 		buf [rev + 1] = t1;
 	#endif
 	
+	#endif
+}
+
+// internal
+// The whole of delta between the two samples around buf's centre, in proportion to phase
+inline void blip_add_linear( blip_long* BLIP_RESTRICT buf, int phase, blip_long delta )
+{
+	buf += blip_widest_impulse_ / 2 - 1;
+	
+	// as in BLIP_BUFFER_FAST's offset_resampled() below
+	blip_long left = buf [0] + delta;
+	blip_long right = (delta >> BLIP_PHASE_BITS) * phase;
+	left  -= right;
+	right += buf [1];
+	
+	buf [0] = left;
+	buf [1] = right;
+}
+
+template<int quality,int range>
+inline void Blip_Synth<quality,range>::offset_resampled( blip_resampled_time_t time,
+		int delta, Blip_Buffer* blip_buf ) const
+{
+	// Fails if time is beyond end of Blip_Buffer, due to a bug in caller code or the
+	// need for a longer buffer as set by set_sample_rate().
+	assert( (blip_long) (time >> BLIP_BUFFER_ACCURACY) < blip_buf->buffer_size_ );
+	blip_long* BLIP_RESTRICT buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
+	int phase = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & (blip_res - 1));
+
+#if BLIP_BUFFER_FAST
+	delta *= impl.delta_factor;
+	blip_long left = buf [0] + delta;
+	
+	// Kind of crappy, but doing shift after multiply results in overflow.
+	// Alternate way of delaying multiply by delta_factor results in worse
+	// sub-sample resolution.
+	blip_long right = (delta >> BLIP_PHASE_BITS) * phase;
+	left  -= right;
+	right += buf [1];
+	
+	buf [0] = left;
+	buf [1] = right;
+#else
+	int const synth_quality = blip_buf->synth_quality_;
+	if ( synth_quality == blip_synth_standard )
+	#if BLIP_BUFFER_SIMD
+		blip_add_kernel<quality>( buf, phase, delta * impl.delta_factor, kernels );
+	#else
+		blip_add_kernel<quality>( buf, phase, delta * impl.delta_factor, impulses );
+	#endif
+	else if ( synth_quality == blip_synth_wide )
+	#if BLIP_BUFFER_SIMD
+		blip_add_kernel<blip_widest_impulse_>( buf, phase, delta * wide.delta_factor, wide_kernels );
+	#else
+		blip_add_kernel<blip_widest_impulse_>( buf, phase, delta * wide.delta_factor, wide_impulses );
+	#endif
+	else
+		blip_add_linear( buf, phase, delta * impl.linear_factor );
 #endif
 }
 
 #undef BLIP_FWD
 #undef BLIP_REV
 
+template<int quality,int range>
+inline void Blip_Synth<quality,range>::volume( double v )
+{
+	impl.volume_unit( v * (1.0 / (range < 0 ? -range : range)) );
+#if !BLIP_BUFFER_FAST
+	wide.volume_unit( v * (1.0 / (range < 0 ? -range : range)) );
+#endif
+}
+
+template<int quality,int range>
+inline void Blip_Synth<quality,range>::treble_eq( blip_eq_t const& eq )
+{
+	impl.treble_eq( eq );
+#if !BLIP_BUFFER_FAST
+	wide.treble_eq( eq );
+#endif
+}
+
 template<int quality,int range>
 #if BLIP_BUFFER_FAST
 	inline
@@ -470,6 +755,7 @@ inline blip_eq_t::blip_eq_t( double t, long rf, long sr, long cf ) :
 		treble( t ), rolloff_freq( rf ), sample_rate( sr ), cutoff_freq( cf ) { }
 
 inline int  Blip_Buffer::length() const         { return length_; }
+inline long Blip_Buffer::buffer_bytes() const   { return buffer_ ? (buffer_size_ + blip_buffer_extra_) * (long) sizeof (buf_t_) : 0; }
 inline long Blip_Buffer::samples_avail() const  { return (long) (offset_ >> BLIP_BUFFER_ACCURACY); }
 inline long Blip_Buffer::sample_rate() const    { return sample_rate_; }
 inline int  Blip_Buffer::output_latency() const { return blip_widest_impulse_ / 2; }
@@ -20,9 +20,12 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 
 Classic_Emu::Classic_Emu()
 {
-	buf           = 0;
-	stereo_buffer = 0;
-	voice_types   = 0;
+	buf            = 0;
+	stereo_buffer  = 0;
+	voice_types    = 0;
+	registers_only = false;
+	fast_skip      = false;
+	skip_overshoot = 0;
 	
 	// avoid inconsistency in our duplicated constants
 	assert( (int) wave_type  == (int) Multi_Buffer::wave_type );
@@ -90,11 +93,84 @@ blargg_err_t Classic_Emu::setup_buffer( long rate )
 
 blargg_err_t Classic_Emu::start_track_( int track )
 {
+	set_registers_only_( false );
 	RETURN_ERR( Music_Emu::start_track_( track ) );
 	buf->clear();
 	return 0;
 }
 
+bool Classic_Emu::set_registers_only_( bool b )
+{
+	if ( b != registers_only )
+	{
+		registers_only = b;
+		skip_overshoot = 0;
+		buf->clear();
+		if ( b )
+			mute_voices_( ~0 ); // detached outputs make the chips skip synthesis
+		else
+			remute_voices();
+	}
+	return true;
+}
+
+blargg_err_t Classic_Emu::skip_( long count )
+{
+	if ( registers_only )
+		return skip_clocks( count );
+	
+	// For a long skip (a seek), run all but the last part without synthesis;
+	// the rest plays as usual, which settles the buffers and output levels.
+	// The buffers are left as they are apart from the clocks the CPU ran
+	// over, so output resumes exactly in step with the chips.
+	long const threshold = 30000;
+	if ( fast_skip && count > threshold )
+	{
+		long n = (count - threshold / 2) & ~1L;
+		count -= n;
+		mute_voices_( ~0 );
+		blargg_err_t err = skip_clocks( n );
+		if ( skip_overshoot > 0 )
+			buf->end_frame( skip_overshoot );
+		skip_overshoot = 0;
+		remute_voices();
+		RETURN_ERR( err );
+	}
+	return Music_Emu::skip_( count );
+}
+
+blargg_err_t Classic_Emu::skip_clocks( long count )
+{
+	// Run the clocks count samples take, up to 100 ms at a time; the CPU can
+	// overshoot a run slightly, which is taken off the next one. Samples are
+	// counted at the buffers' rounded resampling factor, so skipped time
+	// keeps pace with played time.
+	int const stereo = 2;
+	long const rate = sample_rate();
+	double const clocks_per_sample = (double) (1L << BLIP_BUFFER_ACCURACY) /
+			buf->channel( 0, 0 ).center->clock_rate_factor( clock_rate_ );
+	double fraction = 0;
+	long frames = count / stereo;
+	while ( frames > 0 )
+	{
+		long n = min( frames, rate / 10 );
+		frames -= n;
+		double exact = n * clocks_per_sample + fraction;
+		blip_time_t clocks = (blip_time_t) exact;
+		fraction = exact - clocks;
+		clocks -= skip_overshoot;
+		if ( clocks <= 0 )
+		{
+			skip_overshoot = -clocks;
+			continue;
+		}
+		blip_time_t run = clocks;
+		RETURN_ERR( run_clocks( run, (int) (n * 1000 / rate) ) );
+		skip_overshoot = run - clocks;
+	}
+	return 0;
+}
+
 blargg_err_t Classic_Emu::play_( long count, sample_t* out )
 {
 	long remain = count;
@@ -118,6 +194,17 @@ blargg_err_t Classic_Emu::play_( long count, sample_t* out )
 	return 0;
 }
 
+long Classic_Emu::buffered_samples() const
+{
+	return buf ? buf->samples_avail() : 0;
+}
+
+void Classic_Emu::clear_buffered_samples()
+{
+	if ( buf )
+		buf->clear();
+}
+
 // Rom_Data
 
 blargg_err_t Rom_Data_::load_rom_data_( Data_Reader& in,
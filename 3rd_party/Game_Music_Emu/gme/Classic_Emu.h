@@ -17,10 +17,18 @@ protected:
 	// Services
 	enum { wave_type = 0x100, noise_type = 0x200, mixed_type = wave_type | noise_type };
 	void set_voice_types( int const* t ) { voice_types = t; }
+	// Let long skips run the chips with outputs detached, as registers-only
+	// skipping does; for emulators whose play_() is exactly run_clocks() into
+	// the Blip_Buffers
+	void set_fast_skip( bool b ) { fast_skip = b; }
 	blargg_err_t setup_buffer( long clock_rate );
 	long clock_rate() const { return clock_rate_; }
 	void change_clock_rate( long ); // experimental
 	
+	// Output samples generated by the last frame but not read yet
+	long buffered_samples() const;
+	void clear_buffered_samples();
+	
 	// Overridable
 	virtual void set_voice( int index, Blip_Buffer* center,
 			Blip_Buffer* left, Blip_Buffer* right ) = 0;
@@ -32,12 +40,18 @@ protected:
 	void mute_voices_( int );
 	void set_equalizer_( equalizer_t const& );
 	blargg_err_t play_( long, sample_t* );
+	blargg_err_t skip_( long );
+	bool set_registers_only_( bool );
 private:
 	Multi_Buffer* buf;
 	Multi_Buffer* stereo_buffer; // NULL if using custom buffer
 	long clock_rate_;
 	unsigned buf_changed_count;
 	int const* voice_types;
+	bool registers_only;
+	bool fast_skip;
+	blip_time_t skip_overshoot; // clocks run past the last registers-only skip
+	blargg_err_t skip_clocks( long count );
 };
 
 inline void Classic_Emu::set_buffer( Multi_Buffer* new_buf )
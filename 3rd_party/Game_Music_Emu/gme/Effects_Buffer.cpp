@@ -107,14 +107,24 @@ void Effects_Buffer::bass_freq( int freq )
 		bufs [i].bass_freq( freq );
 }
 
+void Effects_Buffer::synth_quality( int q )
+{
+	// All of them: config() may bring more buffers into use
+	for ( int i = 0; i < max_buf_count; i++ )
+		bufs [i].synth_quality( q );
+}
+
 void Effects_Buffer::clear()
 {
 	stereo_remain = 0;
 	effect_remain = 0;
-	if ( echo_buf.size() )
+	
+	// with effects off, echo and reverb are unused until config() enables them,
+	// which clears them then
+	if ( config_.effects_enabled && echo_buf.size() )
 		memset( &echo_buf [0], 0, echo_size * sizeof echo_buf [0] );
 	
-	if ( reverb_buf.size() )
+	if ( config_.effects_enabled && reverb_buf.size() )
 		memset( &reverb_buf [0], 0, reverb_size * sizeof reverb_buf [0] );
 	
 	for ( int i = 0; i < buf_count; i++ )
@@ -359,6 +369,30 @@ void Effects_Buffer::mix_stereo( blip_sample_t* out_, blargg_long count )
 	BLIP_READER_BEGIN( l, bufs [1] );
 	BLIP_READER_BEGIN( r, bufs [2] );
 	
+	#if BLIP_BUFFER_SIMD
+		// the three readers as lanes of one vector, four samples at a time
+		blip_long accums [4] = { c_reader_accum, l_reader_accum, r_reader_accum, 0 };
+		blip_vec_t accum = blip_vload( accums );
+		for ( ; count >= 4; count -= 4 )
+		{
+			blip_vec_t v [4];
+			v [0] = blip_vload( c_reader_buf );
+			v [1] = blip_vload( l_reader_buf );
+			v [2] = blip_vload( r_reader_buf );
+			v [3] = blip_vzero();
+			c_reader_buf += 4;
+			l_reader_buf += 4;
+			r_reader_buf += 4;
+			blip_read4( accum, v, bass );
+			blip_vstore16_stereo( out, blip_vadd( v [0], v [1] ), blip_vadd( v [0], v [2] ) );
+			out += 8;
+		}
+		blip_vstore( accums, accum );
+		c_reader_accum = accums [0];
+		l_reader_accum = accums [1];
+		r_reader_accum = accums [2];
+	#endif
+	
 	while ( count-- )
 	{
 		int cs = BLIP_READER_READ( c );
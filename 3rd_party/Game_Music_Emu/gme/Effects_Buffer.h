@@ -43,6 +43,7 @@ public:
 	blargg_err_t set_sample_rate( long samples_per_sec, int msec = blip_default_length );
 	void clock_rate( long );
 	void bass_freq( int );
+	void synth_quality( int );
 	void clear();
 	channel_t channel( int, int );
 	void end_frame( blip_time_t );
@@ -5,6 +5,7 @@
 #define FIR_RESAMPLER_H
 
 #include "blargg_common.h"
+#include "Blip_Buffer.h" // BLIP_BUFFER_SIMD
 #include <string.h>
 
 class Fir_Resampler_ {
@@ -96,6 +97,79 @@ inline void Fir_Resampler_::write( long count )
 	assert( write_pos <= buf.end() );
 }
 
+#if BLIP_BUFFER_SIMD
+	// internal
+	// Add 4 * 'count' points of impulse 'imp' applied to interleaved stereo 'in' to l and r.
+	// The products are the same 32-bit integers as the plain loop's, summed in another order.
+	inline void fir_mac4( blargg_long& l, blargg_long& r, short const* imp, short const* in, int count )
+	{
+	#if BLIP_SIMD_SSE2
+		// pmaddwd against the impulse widened to (point, 0) pairs picks out the left
+		// samples; shifting each pair down by 16 first picks out the right ones
+		__m128i const zero = _mm_setzero_si128();
+		__m128i vl = zero;
+		__m128i vr = zero;
+		for ( ; count >= 2; count -= 2 )
+		{
+			__m128i k8 = _mm_loadu_si128( (__m128i const*) imp );
+			__m128i i0 = _mm_loadu_si128( (__m128i const*) in );
+			__m128i i1 = _mm_loadu_si128( (__m128i const*) (in + 8) );
+			__m128i k0 = _mm_unpacklo_epi16( k8, zero );
+			__m128i k1 = _mm_unpackhi_epi16( k8, zero );
+			vl = _mm_add_epi32( vl, _mm_add_epi32( _mm_madd_epi16( i0, k0 ), _mm_madd_epi16( i1, k1 ) ) );
+			vr = _mm_add_epi32( vr, _mm_add_epi32( _mm_madd_epi16( _mm_srli_epi32( i0, 16 ), k0 ),
+					_mm_madd_epi16( _mm_srli_epi32( i1, 16 ), k1 ) ) );
+			imp += 8;
+			in  += 16;
+		}
+		if ( count )
+		{
+			__m128i i4 = _mm_loadu_si128( (__m128i const*) in );
+			__m128i k4 = _mm_unpacklo_epi16( _mm_loadl_epi64( (__m128i const*) imp ), zero );
+			vl = _mm_add_epi32( vl, _mm_madd_epi16( i4, k4 ) );
+			vr = _mm_add_epi32( vr, _mm_madd_epi16( _mm_srli_epi32( i4, 16 ), k4 ) );
+		}
+		__m128i lr = _mm_add_epi32( _mm_unpacklo_epi32( vl, vr ), _mm_unpackhi_epi32( vl, vr ) );
+		lr = _mm_add_epi32( lr, _mm_srli_si128( lr, 8 ) );
+		l += _mm_cvtsi128_si32( lr );
+		r += _mm_cvtsi128_si32( _mm_srli_si128( lr, 4 ) );
+	#elif BLIP_SIMD_NEON
+		int32x4_t vl = vdupq_n_s32( 0 );
+		int32x4_t vr = vl;
+		for ( ; count; --count )
+		{
+			int16x4x2_t i4 = vld2_s16( in ); // deinterleaved
+			int16x4_t k4 = vld1_s16( imp );
+			vl = vmlal_s16( vl, i4.val [0], k4 );
+			vr = vmlal_s16( vr, i4.val [1], k4 );
+			imp += 4;
+			in  += 8;
+		}
+		int32x2_t lr = vpadd_s32( vadd_s32( vget_low_s32( vl ), vget_high_s32( vl ) ),
+				vadd_s32( vget_low_s32( vr ), vget_high_s32( vr ) ) );
+		l += vget_lane_s32( lr, 0 );
+		r += vget_lane_s32( lr, 1 );
+	#else
+		v128_t const zero = wasm_i32x4_splat( 0 );
+		v128_t vl = zero;
+		v128_t vr = zero;
+		for ( ; count; --count )
+		{
+			v128_t i4 = wasm_v128_load( in );
+			v128_t k4 = wasm_i16x8_shuffle( wasm_v128_load64_zero( imp ), zero, 0, 8, 1, 8, 2, 8, 3, 8 );
+			vl = wasm_i32x4_add( vl, wasm_i32x4_dot_i16x8( i4, k4 ) );
+			vr = wasm_i32x4_add( vr, wasm_i32x4_dot_i16x8( wasm_u32x4_shr( i4, 16 ), k4 ) );
+			imp += 4;
+			in  += 8;
+		}
+		l += wasm_i32x4_extract_lane( vl, 0 ) + wasm_i32x4_extract_lane( vl, 1 ) +
+				wasm_i32x4_extract_lane( vl, 2 ) + wasm_i32x4_extract_lane( vl, 3 );
+		r += wasm_i32x4_extract_lane( vr, 0 ) + wasm_i32x4_extract_lane( vr, 1 ) +
+				wasm_i32x4_extract_lane( vr, 2 ) + wasm_i32x4_extract_lane( vr, 3 );
+	#endif
+	}
+#endif
+
 template<int width>
 int Fir_Resampler<width>::read( sample_t* out_begin, blargg_long count )
 {
@@ -124,7 +198,14 @@ int Fir_Resampler<width>::read( sample_t* out_begin, blargg_long count )
 			if ( count < 0 )
 				break;
 			
+		#if BLIP_BUFFER_SIMD
+			fir_mac4( l, r, imp, i, width / 4 );
+			imp += width & ~3;
+			i   += (width & ~3) * stereo;
+			for ( int n = (width & 3) / 2; n; --n )
+		#else
 			for ( int n = width / 2; n; --n )
+		#endif
 			{
 				int pt0 = imp [0];
 				l += pt0 * i [0];
@@ -85,6 +85,12 @@ void Stereo_Buffer::bass_freq( int bass )
 		bufs [i].bass_freq( bass );
 }
 
+void Stereo_Buffer::synth_quality( int q )
+{
+	for ( int i = 0; i < buf_count; i++ )
+		bufs [i].synth_quality( q );
+}
+
 void Stereo_Buffer::clear()
 {
 	stereo_added = 0;
@@ -156,6 +162,30 @@ void Stereo_Buffer::mix_stereo( blip_sample_t* out_, blargg_long count )
 	BLIP_READER_BEGIN( right, bufs [2] );
 	BLIP_READER_BEGIN( center, bufs [0] );
 	
+	#if BLIP_BUFFER_SIMD
+		// the three readers as lanes of one vector, four samples at a time
+		blip_long accums [4] = { center_reader_accum, left_reader_accum, right_reader_accum, 0 };
+		blip_vec_t accum = blip_vload( accums );
+		for ( ; count >= 4; count -= 4 )
+		{
+			blip_vec_t v [4];
+			v [0] = blip_vload( center_reader_buf );
+			v [1] = blip_vload( left_reader_buf );
+			v [2] = blip_vload( right_reader_buf );
+			v [3] = blip_vzero();
+			center_reader_buf += 4;
+			left_reader_buf   += 4;
+			right_reader_buf  += 4;
+			blip_read4( accum, v, bass );
+			blip_vstore16_stereo( out, blip_vadd( v [0], v [1] ), blip_vadd( v [0], v [2] ) );
+			out += 8;
+		}
+		blip_vstore( accums, accum );
+		center_reader_accum = accums [0];
+		left_reader_accum   = accums [1];
+		right_reader_accum  = accums [2];
+	#endif
+	
 	for ( ; count; --count )
 	{
 		int c = BLIP_READER_READ( center );
@@ -188,6 +218,27 @@ void Stereo_Buffer::mix_stereo_no_center( blip_sample_t* out_, blargg_long count
 	BLIP_READER_BEGIN( left, bufs [1] );
 	BLIP_READER_BEGIN( right, bufs [2] );
 	
+	#if BLIP_BUFFER_SIMD
+		blip_long accums [4] = { left_reader_accum, right_reader_accum, 0, 0 };
+		blip_vec_t accum = blip_vload( accums );
+		for ( ; count >= 4; count -= 4 )
+		{
+			blip_vec_t v [4];
+			v [0] = blip_vload( left_reader_buf );
+			v [1] = blip_vload( right_reader_buf );
+			v [2] = blip_vzero();
+			v [3] = blip_vzero();
+			left_reader_buf  += 4;
+			right_reader_buf += 4;
+			blip_read4( accum, v, bass );
+			blip_vstore16_stereo( out, v [0], v [1] );
+			out += 8;
+		}
+		blip_vstore( accums, accum );
+		left_reader_accum  = accums [0];
+		right_reader_accum = accums [1];
+	#endif
+	
 	for ( ; count; --count )
 	{
 		blargg_long l = BLIP_READER_READ( left );
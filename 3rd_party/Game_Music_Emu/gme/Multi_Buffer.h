@@ -31,6 +31,7 @@ public:
 	virtual blargg_err_t set_sample_rate( long rate, int msec = blip_default_length ) = 0;
 	virtual void clock_rate( long ) = 0;
 	virtual void bass_freq( int ) = 0;
+	virtual void synth_quality( int ) = 0;
 	virtual void clear() = 0;
 	long sample_rate() const;
 	
@@ -80,6 +81,7 @@ public:
 	blargg_err_t set_sample_rate( long rate, int msec = blip_default_length );
 	void clock_rate( long rate ) { buf.clock_rate( rate ); }
 	void bass_freq( int freq ) { buf.bass_freq( freq ); }
+	void synth_quality( int q ) { buf.synth_quality( q ); }
 	void clear() { buf.clear(); }
 	long samples_avail() const { return buf.samples_avail(); }
 	long read_samples( blip_sample_t* p, long s ) { return buf.read_samples( p, s ); }
@@ -102,6 +104,7 @@ public:
 	blargg_err_t set_sample_rate( long, int msec = blip_default_length );
 	void clock_rate( long );
 	void bass_freq( int );
+	void synth_quality( int );
 	void clear();
 	channel_t channel( int, int ) { return chan; }
 	void end_frame( blip_time_t );
@@ -132,6 +135,7 @@ public:
 	}
 	void clock_rate( long ) { }
 	void bass_freq( int ) { }
+	void synth_quality( int ) { }
 	void clear() { }
 	channel_t channel( int, int ) { return chan; }
 	void end_frame( blip_time_t ) { }
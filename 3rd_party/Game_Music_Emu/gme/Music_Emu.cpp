@@ -33,7 +33,7 @@ void Music_Emu::clear_track_vars()
 	emu_time         = 0;
 	emu_track_ended_ = true;
 	track_ended_     = true;
-	fade_start       = LONG_MAX / 2 + 1;
+	fade_start       = INT_MAX / 2 + 1; // LONG_MAX truncates to 0 in a 32-bit blargg_long
 	fade_step        = 1;
 	silence_time     = 0;
 	silence_count    = 0;
@@ -192,6 +192,18 @@ blargg_err_t Music_Emu::seek( long msec )
 	return skip( time - out_time );
 }
 
+void Music_Emu::restore_time( blargg_long time )
+{
+	require( current_track() >= 0 );
+	out_time         = time;
+	emu_time         = time;
+	emu_track_ended_ = false;
+	track_ended_     = false;
+	silence_time     = 0;
+	silence_count    = 0;
+	buf_remain       = 0;
+}
+
 blargg_err_t Music_Emu::skip( long count )
 {
 	require( current_track() >= 0 ); // start_track() must have been called already
@@ -345,9 +357,12 @@ blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 		long pos = 0;
 		if ( silence_count )
 		{
-			// during a run of silence, run emulator at >=2x speed so it gets ahead
+			// during a run of silence, run emulator at >=2x speed so it gets ahead,
+			// but by no more than silence_lookahead * out_count per call: the target
+			// jumps by several buffers when a run of silence is first noticed
 			long ahead_time = silence_lookahead * (out_time + out_count - silence_time) + silence_time;
-			while ( emu_time < ahead_time && !(buf_remain | emu_track_ended_) )
+			long budget = silence_lookahead * out_count;
+			for ( ; emu_time < ahead_time && budget > 0 && !(buf_remain | emu_track_ended_); budget -= buf_size )
 				fill_buf();
 			
 			// fill with silence
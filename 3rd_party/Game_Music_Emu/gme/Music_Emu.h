@@ -41,12 +41,22 @@ public:
 	// Number of milliseconds (1000 msec = 1 second) played since beginning of track
 	long tell() const;
 	
+	// Number of stereo frames played since beginning of track: tell() without
+	// the rounding to milliseconds
+	long tell_frames() const                    { return out_time / 2; }
+	
 	// Seek to new time in track. Seeking backwards or far forward can take a while.
 	blargg_err_t seek( long msec );
 	
 	// Skip n samples
 	blargg_err_t skip( long n );
 	
+	// Stop synthesizing sound, so that skip() only advances the CPU and sound
+	// chip registers; for passes that read chip state and discard the sound.
+	// Call after start_track(), which turns it off again. Returns false if
+	// the emulator doesn't support it, in which case nothing changes.
+	bool set_registers_only( bool b )           { return set_registers_only_( b ); }
+	
 	// True if a track has reached its end
 	bool track_ended() const;
 	
@@ -57,6 +67,12 @@ public:
 	// Disable automatic end-of-track detection and skipping of silence at beginning
 	void ignore_silence( bool disable = true );
 	
+	// Number of samples the emulator has run ahead of output looking for the
+	// silence at end of track. Each play() runs it at most silence_lookahead
+	// times its sample count ahead, so the cost is spread over a quiet passage
+	// instead of landing on one call.
+	long silence_lookahead_samples() const      { return emu_time - out_time; }
+	
 	// Info for current track
 	Gme_File::track_info;
 	blargg_err_t track_info( track_info_t* out ) const;
@@ -110,6 +126,13 @@ protected:
 	double tempo() const                        { return tempo_; }
 	void remute_voices();
 	
+	// Number of samples the emulator has generated since start of track
+	blargg_long emu_samples() const             { return emu_time; }
+	
+	// Continue output from sample position 'time' after the derived class has
+	// restored emulator state captured at that position
+	void restore_time( blargg_long time );
+	
 	virtual blargg_err_t set_sample_rate_( long sample_rate ) = 0;
 	virtual void set_equalizer_( equalizer_t const& ) { };
 	virtual void mute_voices_( int mask ) = 0;
@@ -117,6 +140,7 @@ protected:
 	virtual blargg_err_t start_track_( int ) = 0; // tempo is set before this
 	virtual blargg_err_t play_( long count, sample_t* out ) = 0;
 	virtual blargg_err_t skip_( long count );
+	virtual bool set_registers_only_( bool )    { return false; }
 protected:
 	virtual void unload();
 	virtual void pre_load();
@@ -2,6 +2,8 @@
 
 #include "Nes_Apu.h"
 
+#include <string.h>
+
 /* Copyright (C) 2003-2006 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
 General Public License as published by the Free Software Foundation; either
@@ -25,6 +27,7 @@ Nes_Apu::Nes_Apu() :
 	dmc.apu = this;
 	dmc.prg_reader = NULL;
 	irq_notifier_ = NULL;
+	set_write_log( NULL, 0 );
 	
 	oscs [0] = &square1;
 	oscs [1] = &square2;
@@ -249,6 +252,8 @@ void Nes_Apu::end_frame( nes_time_t end_time )
 		zero_apu_osc( &dmc,      last_time );
 	}
 	
+	write_log_clocks_ += end_time;
+	
 	// make times relative to new frame
 	last_time -= end_time;
 	require( last_time >= 0 );
@@ -271,6 +276,112 @@ void Nes_Apu::end_frame( nes_time_t end_time )
 	}
 }
 
+// snapshots
+
+static void save_osc( Nes_Osc const& in, nes_apu_snapshot_t::osc_t* out )
+{
+	memcpy( out->regs, in.regs, sizeof out->regs );
+	memcpy( out->reg_written, in.reg_written, sizeof out->reg_written );
+	out->length_counter = in.length_counter;
+	out->delay          = in.delay;
+	out->last_amp       = in.last_amp;
+}
+
+static void load_osc( nes_apu_snapshot_t::osc_t const& in, Nes_Osc* out )
+{
+	memcpy( out->regs, in.regs, sizeof out->regs );
+	memcpy( out->reg_written, in.reg_written, sizeof out->reg_written );
+	out->length_counter = in.length_counter;
+	out->delay          = in.delay;
+	out->last_amp       = in.last_amp;
+}
+
+void Nes_Apu::save_snapshot( nes_apu_snapshot_t* out ) const
+{
+	for ( int i = 0; i < osc_count; i++ )
+		save_osc( *oscs [i], &out->osc [i] );
+	
+	Nes_Square const* squares [2] = { &square1, &square2 };
+	for ( int i = 0; i < 2; i++ )
+	{
+		out->square_envelope    [i] = squares [i]->envelope;
+		out->square_env_delay   [i] = squares [i]->env_delay;
+		out->square_phase       [i] = squares [i]->phase;
+		out->square_sweep_delay [i] = squares [i]->sweep_delay;
+	}
+	out->triangle_phase          = triangle.phase;
+	out->triangle_linear_counter = triangle.linear_counter;
+	out->noise_envelope          = noise.envelope;
+	out->noise_env_delay         = noise.env_delay;
+	out->noise_shift             = noise.noise;
+	
+	out->dmc_address     = dmc.address;
+	out->dmc_period      = dmc.period;
+	out->dmc_buf         = dmc.buf;
+	out->dmc_bits_remain = dmc.bits_remain;
+	out->dmc_bits        = dmc.bits;
+	out->dmc_buf_full    = dmc.buf_full;
+	out->dmc_silence     = dmc.silence;
+	out->dmc_dac         = dmc.dac;
+	out->dmc_next_irq    = dmc.next_irq;
+	out->dmc_irq_enabled = dmc.irq_enabled;
+	out->dmc_irq_flag    = dmc.irq_flag;
+	
+	out->last_time     = last_time;
+	out->last_dmc_time = last_dmc_time;
+	out->earliest_irq  = earliest_irq_;
+	out->next_irq      = next_irq;
+	out->frame_period  = frame_period;
+	out->frame_delay   = frame_delay;
+	out->frame         = frame;
+	out->osc_enables   = osc_enables;
+	out->frame_mode    = frame_mode;
+	out->irq_flag      = irq_flag;
+}
+
+void Nes_Apu::load_snapshot( nes_apu_snapshot_t const& in )
+{
+	for ( int i = 0; i < osc_count; i++ )
+		load_osc( in.osc [i], oscs [i] );
+	
+	Nes_Square* squares [2] = { &square1, &square2 };
+	for ( int i = 0; i < 2; i++ )
+	{
+		squares [i]->envelope    = in.square_envelope    [i];
+		squares [i]->env_delay   = in.square_env_delay   [i];
+		squares [i]->phase       = in.square_phase       [i];
+		squares [i]->sweep_delay = in.square_sweep_delay [i];
+	}
+	triangle.phase          = in.triangle_phase;
+	triangle.linear_counter = in.triangle_linear_counter;
+	noise.envelope          = in.noise_envelope;
+	noise.env_delay         = in.noise_env_delay;
+	noise.noise             = in.noise_shift;
+	
+	dmc.address     = in.dmc_address;
+	dmc.period      = in.dmc_period;
+	dmc.buf         = in.dmc_buf;
+	dmc.bits_remain = in.dmc_bits_remain;
+	dmc.bits        = in.dmc_bits;
+	dmc.buf_full    = in.dmc_buf_full;
+	dmc.silence     = in.dmc_silence;
+	dmc.dac         = in.dmc_dac;
+	dmc.next_irq    = in.dmc_next_irq;
+	dmc.irq_enabled = in.dmc_irq_enabled;
+	dmc.irq_flag    = in.dmc_irq_flag;
+	
+	last_time      = in.last_time;
+	last_dmc_time  = in.last_dmc_time;
+	earliest_irq_  = in.earliest_irq;
+	next_irq       = in.next_irq;
+	frame_period   = in.frame_period;
+	frame_delay    = in.frame_delay;
+	frame          = in.frame;
+	osc_enables    = in.osc_enables;
+	frame_mode     = in.frame_mode;
+	irq_flag       = in.irq_flag;
+}
+
 // registers
 
 static const unsigned char length_table [0x20] = {
@@ -289,6 +400,14 @@ void Nes_Apu::write_register( nes_time_t time, nes_addr_t addr, int data )
 	if ( unsigned (addr - start_addr) > end_addr - start_addr )
 		return;
 	
+	if ( write_log_count_ < write_log_capacity )
+	{
+		write_t& w = write_log_ [write_log_count_++];
+		w.time = write_log_clocks_ + time;
+		w.addr = (unsigned short) addr;
+		w.data = (unsigned char) data;
+	}
+	
 	run_until_( time );
 	
 	if ( addr < 0x4014 )
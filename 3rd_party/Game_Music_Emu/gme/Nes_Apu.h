@@ -12,6 +12,7 @@ typedef unsigned nes_addr_t; // 16-bit memory address
 #include "Nes_Oscs.h"
 
 struct apu_state_t;
+struct nes_apu_snapshot_t;
 class Nes_Buffer;
 
 class Nes_Apu {
@@ -57,6 +58,12 @@ public:
 	void save_state( apu_state_t* out ) const;
 	void load_state( apu_state_t const& );
 	
+	// Save/load plain copy of oscillator and frame counter state (outputs,
+	// synths and callbacks are left alone). Must be used at a frame boundary,
+	// i.e. right after end_frame().
+	void save_snapshot( nes_apu_snapshot_t* out ) const;
+	void load_snapshot( nes_apu_snapshot_t const& );
+	
 	// Set overall volume (default is 1.0)
 	void volume( double );
 	
@@ -110,6 +117,41 @@ public:
 		if ((unsigned)osc < osc_count) return oscs[osc]->last_amp;
 		return 0;
 	}
+	// Fills osc_count entries of each array in one pass
+	void osc_state( int* periods, int* lengths, int* amplitudes ) const {
+		for ( int i = 0; i < osc_count; i++ )
+		{
+			Nes_Osc const* osc = oscs [i];
+			periods    [i] = osc->period();
+			lengths    [i] = osc->length_counter;
+			amplitudes [i] = osc->last_amp;
+		}
+	}
+	// Fills osc_count volumes taken from the registers rather than the output,
+	// so they stay valid while outputs are detached: envelope volume for the
+	// squares and noise, 15 for a running triangle, the DAC for the DMC
+	void osc_volumes( int* volumes ) const;
+	// Returns last value written to register reg (0-3) of oscillator
+	int osc_register( int osc, int reg ) const {
+		if ((unsigned)osc < osc_count && (unsigned)reg < 4) return oscs[osc]->regs[reg];
+		return 0;
+	}
+	
+	// Log register writes into 'log', up to 'capacity' of them, or stop
+	// logging if NULL. Times count clocks since the log was last cleared,
+	// running on across end_frame() calls; writes past capacity are lost.
+	struct write_t
+	{
+		nes_time_t time;
+		unsigned short addr;
+		unsigned char data;
+	};
+	void set_write_log( write_t* log, int capacity );
+	const write_t* write_log() const { return write_log_; }
+	int write_log_count() const { return write_log_count_; }
+	// Clocks ended by end_frame() since the log was last cleared
+	nes_time_t write_log_clocks() const { return write_log_clocks_; }
+	void clear_write_log() { write_log_count_ = 0; write_log_clocks_ = 0; }
 	
 public:
 	Nes_Apu();
@@ -146,6 +188,10 @@ private:
 	void (*irq_notifier_)( void* user_data );
 	void* irq_data;
 	Nes_Square::Synth square_synth; // shared by squares
+	write_t* write_log_;
+	int write_log_capacity;
+	int write_log_count_;
+	nes_time_t write_log_clocks_;
 	
 	void irq_changed();
 	void state_restored();
@@ -155,6 +201,52 @@ private:
 	friend class Nes_Core;
 };
 
+struct nes_apu_snapshot_t
+{
+	struct osc_t
+	{
+		unsigned char regs [4];
+		bool reg_written [4];
+		int length_counter;
+		int delay;
+		int last_amp;
+	};
+	osc_t osc [Nes_Apu::osc_count];
+	
+	int square_envelope [2];
+	int square_env_delay [2];
+	int square_phase [2];
+	int square_sweep_delay [2];
+	int triangle_phase;
+	int triangle_linear_counter;
+	int noise_envelope;
+	int noise_env_delay;
+	int noise_shift;
+	
+	int dmc_address;
+	int dmc_period;
+	int dmc_buf;
+	int dmc_bits_remain;
+	int dmc_bits;
+	bool dmc_buf_full;
+	bool dmc_silence;
+	int dmc_dac;
+	nes_time_t dmc_next_irq;
+	bool dmc_irq_enabled;
+	bool dmc_irq_flag;
+	
+	nes_time_t last_time;
+	nes_time_t last_dmc_time;
+	nes_time_t earliest_irq;
+	nes_time_t next_irq;
+	int frame_period;
+	int frame_delay;
+	int frame;
+	int osc_enables;
+	int frame_mode;
+	bool irq_flag;
+};
+
 inline void Nes_Apu::osc_output( int osc, Blip_Buffer* buf )
 {
 	assert( (unsigned) osc < osc_count );
@@ -172,6 +264,13 @@ inline void Nes_Apu::dmc_reader( int (*func)( void*, nes_addr_t ), void* user_da
 	dmc.prg_reader = func;
 }
 
+inline void Nes_Apu::set_write_log( write_t* log, int capacity )
+{
+	write_log_ = log;
+	write_log_capacity = log ? capacity : 0;
+	clear_write_log();
+}
+
 inline void Nes_Apu::irq_notifier( void (*func)( void* user_data ), void* user_data )
 {
 	irq_notifier_ = func;
@@ -193,4 +292,13 @@ inline nes_time_t Nes_Dmc::next_read_time() const
 
 inline nes_time_t Nes_Apu::next_dmc_read_time() const { return dmc.next_read_time(); }
 
+inline void Nes_Apu::osc_volumes( int* volumes ) const
+{
+	volumes [0] = square1.volume();
+	volumes [1] = square2.volume();
+	volumes [2] = (triangle.length_counter && triangle.linear_counter) ? 15 : 0;
+	volumes [3] = noise.volume();
+	volumes [4] = dmc.dac;
+}
+
 #endif
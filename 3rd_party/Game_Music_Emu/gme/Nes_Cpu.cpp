@@ -110,6 +110,19 @@ void Nes_Cpu::map_code( nes_addr_t start, unsigned size, void const* data, bool
 #define WRITE_LOW( addr, data ) (void) (READ_LOW( addr ) = (data))
 #define READ_PROG( addr )       (s.code_map [(addr) >> page_bits] [PAGE_OFFSET( addr )])
 
+// RAM and ROM come straight from the page table, without a time flush
+#define READ_MEM( addr, out )\
+{\
+	if ( ((addr) ^ 0x8000) <= 0x9FFF )\
+		out = READ_PROG( addr );\
+	else\
+	{\
+		FLUSH_TIME();\
+		out = READ( addr );\
+		CACHE_TIME();\
+	}\
+}
+
 #define SET_SP( v )     (sp = ((v) + 1) | 0x100)
 #define GET_SP()        ((sp - 1) & 0xFF)
 #define PUSH( v )       ((sp = (sp - 1) | 0x100), WRITE_LOW( sp, v ))
@@ -279,9 +292,7 @@ ind##op:\
 case op + 0x08: /* abs */\
 	ADD_PAGE();\
 ptr##op:\
-	FLUSH_TIME();\
-	data = READ( data );\
-	CACHE_TIME();\
+	READ_MEM( data, data );\
 case op + 0x04: /* imm */\
 imm##op:
 
@@ -531,9 +542,8 @@ imm##op:
 	case 0xAC:{// LDY abs
 		unsigned addr = data + 0x100 * GET_MSB();
 		pc += 2;
-		FLUSH_TIME();
-		y = nz = READ( addr );
-		CACHE_TIME();
+		READ_MEM( addr, nz );
+		y = nz;
 		goto loop;
 	}
 	
@@ -543,9 +553,8 @@ imm##op:
 	case 0xAE:{// LDX abs
 		unsigned addr = data + 0x100 * GET_MSB();
 		pc += 2;
-		FLUSH_TIME();
-		x = nz = READ( addr );
-		CACHE_TIME();
+		READ_MEM( addr, nz );
+		x = nz;
 		goto loop;
 	}
 	
@@ -576,9 +585,7 @@ imm##op:
 	case 0xEC:{// CPX abs
 		unsigned addr = GET_ADDR();
 		pc++;
-		FLUSH_TIME();
-		data = READ( addr );
-		CACHE_TIME();
+		READ_MEM( addr, data );
 		goto cpx_data;
 	}
 	
@@ -595,9 +602,7 @@ imm##op:
 	case 0xCC:{// CPY abs
 		unsigned addr = GET_ADDR();
 		pc++;
-		FLUSH_TIME();
-		data = READ( addr );
-		CACHE_TIME();
+		READ_MEM( addr, data );
 		goto cpy_data;
 	}
 	
@@ -40,6 +40,19 @@ public:
 	// (addr & addr_mask) == data_addr
 	void write_data( blip_time_t, int data );
 	
+	// Visualization accessors
+	// Fills osc_count entries of each array: 12-bit tone period, and 4-bit
+	// volume (0 while the tone is off or the unsupported envelope is selected)
+	void osc_state( int* periods, int* volumes ) const {
+		for ( int i = 0; i < osc_count; i++ )
+		{
+			int vol_mode = regs [010 + i];
+			bool tone = !(regs [7] >> i & 1);
+			periods [i] = (regs [i * 2 + 1] & 0x0F) * 0x100 + regs [i * 2];
+			volumes [i] = (tone && !(vol_mode & 0x10)) ? (vol_mode & 0x0F) : 0;
+		}
+	}
+	
 public:
 	Nes_Fme7_Apu();
 	BLARGG_DISABLE_NOTHROW
@@ -33,6 +33,21 @@ public:
 	void save_state( namco_state_t* out ) const;
 	void load_state( namco_state_t const& );
 	
+	// Visualization accessors
+	// Oscillators the sound RAM is set up for; they are the highest-numbered
+	int active_osc_count() const { return (reg [0x7F] >> 4 & 7) + 1; }
+	// Fills osc_count entries of each array: 18-bit frequency, wave length
+	// in samples (0 while halted) and 4-bit volume
+	void osc_state( long* freqs, int* wave_sizes, int* volumes ) const {
+		for ( int i = 0; i < osc_count; i++ )
+		{
+			BOOST::uint8_t const* osc_reg = &reg [i * 8 + 0x40];
+			freqs      [i] = (osc_reg [4] & 3) * 0x10000L + osc_reg [2] * 0x100L + osc_reg [0];
+			wave_sizes [i] = (osc_reg [4] & 0xE0) ? 32 - (osc_reg [4] >> 2 & 7) * 4 : 0;
+			volumes    [i] = osc_reg [7] & 15;
+		}
+	}
+	
 public:
 	Nes_Namco_Apu();
 	BLARGG_DISABLE_NOTHROW
@@ -105,15 +105,32 @@ void Nes_Vrc6_Apu::load_state( vrc6_apu_state_t const& in )
 void Nes_Vrc6_Apu::run_square( Vrc6_Osc& osc, blip_time_t end_time )
 {
 	Blip_Buffer* output = osc.output;
-	if ( !output )
-		return;
-	output->set_modified();
 	
 	int volume = osc.regs [0] & 15;
 	if ( !(osc.regs [2] & 0x80) )
 		volume = 0;
 	
 	int gate = osc.regs [0] & 0x80;
+	if ( !output )
+	{
+		// keep the duty step moving, as the 2A03 oscillators do
+		blip_time_t time = last_time + osc.delay;
+		osc.delay = 0;
+		int period = osc.period();
+		if ( volume && !gate && period > 4 )
+		{
+			if ( time < end_time )
+			{
+				blargg_long steps = (end_time - time + period - 1) / period;
+				osc.phase = (int) ((osc.phase + steps) & 15);
+				time += steps * period;
+			}
+			osc.delay = time - end_time;
+		}
+		return;
+	}
+	output->set_modified();
+	
 	int duty = ((osc.regs [0] >> 4) & 7) + 1;
 	int delta = ((gate || osc.phase < duty) ? volume : 0) - osc.last_amp;
 	blip_time_t time = last_time;
@@ -160,13 +177,45 @@ void Nes_Vrc6_Apu::run_saw( blip_time_t end_time )
 {
 	Vrc6_Osc& osc = oscs [2];
 	Blip_Buffer* output = osc.output;
-	if ( !output )
-		return;
-	output->set_modified();
 	
 	int amp = osc.amp;
 	int amp_step = osc.regs [0] & 0x3F;
 	blip_time_t time = last_time;
+	if ( !output )
+	{
+		// keep the accumulator moving; after the first reset, whole 7-step
+		// cycles leave it as it was
+		if ( !(osc.regs [2] & 0x80) || !(amp_step | amp) )
+		{
+			osc.delay = 0;
+			return;
+		}
+		time += osc.delay;
+		if ( time < end_time )
+		{
+			int period = osc.period() * 2;
+			blargg_long steps = (end_time - time + period - 1) / period;
+			time += steps * period;
+			int phase = osc.phase;
+			if ( steps > phase )
+				steps = phase + (steps - phase) % 7;
+			while ( steps-- )
+			{
+				if ( --phase == 0 )
+				{
+					phase = 7;
+					amp = 0;
+				}
+				amp = (amp + amp_step) & 0xFF;
+			}
+			osc.phase = phase;
+			osc.amp = amp;
+		}
+		osc.delay = time - end_time;
+		return;
+	}
+	output->set_modified();
+	
 	int last_amp = osc.last_amp;
 	if ( !(osc.regs [2] & 0x80) || !(amp_step | amp) )
 	{
@@ -30,6 +30,10 @@ public:
 	enum { addr_step = 0x1000 };
 	void write_osc( blip_time_t, int osc, int reg, int data );
 	
+	// Oscillator a write to addr is for, or -1 if addr is not one of the
+	// registers above; the register is then addr & (addr_step - 1)
+	static int osc_at( unsigned addr );
+	
 	// Visualization accessors
 	int osc_period( int osc ) const {
 		if ((unsigned)osc < osc_count) return oscs[osc].period();
@@ -52,6 +56,17 @@ public:
 		if ((unsigned)osc < osc_count) return (oscs[osc].regs[2] & 0x80) != 0;
 		return false;
 	}
+	// Fills osc_count entries of each array in one pass
+	void osc_state( int* periods, int* amplitudes, int* volumes, bool* enabled ) const {
+		for ( int i = 0; i < osc_count; i++ )
+		{
+			Vrc6_Osc const& osc = oscs [i];
+			periods    [i] = osc.period();
+			amplitudes [i] = osc.last_amp;
+			volumes    [i] = osc.regs [0] & (i < 2 ? 0x0F : 0x3F);
+			enabled    [i] = (osc.regs [2] & 0x80) != 0;
+		}
+	}
 	
 public:
 	Nes_Vrc6_Apu();
@@ -102,6 +117,13 @@ inline void Nes_Vrc6_Apu::osc_output( int i, Blip_Buffer* buf )
 	oscs [i].output = buf;
 }
 
+inline int Nes_Vrc6_Apu::osc_at( unsigned addr )
+{
+	// By the top nibble of the address
+	static signed char const oscs [16] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 2, -1, -1, -1, -1 };
+	return (addr & (addr_step - 1)) < (unsigned) reg_count ? oscs [addr >> 12 & 0x0F] : -1;
+}
+
 inline void Nes_Vrc6_Apu::volume( double v )
 {
 	double const factor = 0.0967 * 2;
@@ -44,9 +44,13 @@ Nsf_Emu::Nsf_Emu()
 	vrc6  = 0;
 	namco = 0;
 	fme7  = 0;
+	memset( &play_cost_, 0, sizeof play_cost_ );
+	play_began = 0;
+	in_play = false;
 	
 	set_type( gme_nsf_type );
 	set_silence_lookahead( 6 );
+	set_fast_skip( true );
 	apu.dmc_reader( pcm_read, this );
 	Music_Emu::set_equalizer( nes_eq );
 	set_gain( 1.4 );
@@ -155,6 +159,16 @@ void Nsf_Emu::set_tempo_( double t )
 	apu.set_tempo( t );
 }
 
+double Nsf_Emu::play_interval() const
+{
+	return play_period / (clock_divisor * clock_rate_);
+}
+
+long Nsf_Emu::play_period_clocks() const
+{
+	return play_period / clock_divisor;
+}
+
 blargg_err_t Nsf_Emu::init_sound()
 {
 	if ( header_.chip_flags & ~(namco_flag | vrc6_flag | fme7_flag) )
@@ -416,11 +430,10 @@ void Nsf_Emu::cpu_write_misc( nes_addr_t addr, int data )
 		
 		if ( vrc6 )
 		{
-			unsigned reg = addr & (Nes_Vrc6_Apu::addr_step - 1);
-			unsigned osc = unsigned (addr - Nes_Vrc6_Apu::base_addr) / Nes_Vrc6_Apu::addr_step;
-			if ( osc < Nes_Vrc6_Apu::osc_count && reg < Nes_Vrc6_Apu::reg_count )
+			int osc = Nes_Vrc6_Apu::osc_at( addr );
+			if ( osc >= 0 )
 			{
-				vrc6->write_osc( time(), osc, reg, data );
+				vrc6->write_osc( time(), osc, addr & (Nes_Vrc6_Apu::addr_step - 1), data );
 				return;
 			}
 		}
@@ -471,6 +484,8 @@ blargg_err_t Nsf_Emu::start_track_( int track )
 	play_ready = 4;
 	play_extra = 0;
 	next_play = play_period / clock_divisor;
+	memset( &play_cost_, 0, sizeof play_cost_ );
+	in_play = false;
 	
 	saved_state.pc = badop_addr;
 	low_mem [0x1FF] = (badop_addr - 1) >> 8;
@@ -483,6 +498,57 @@ blargg_err_t Nsf_Emu::start_track_( int track )
 	return 0;
 }
 
+// Snapshots
+
+void Nsf_Emu::save_snapshot( snapshot_t* out ) const
+{
+	require( can_snapshot() );
+	out->sample_time = emu_samples() + buffered_samples();
+	out->r           = cpu::r;
+	out->saved_state = saved_state;
+	out->next_play   = next_play;
+	out->play_extra  = play_extra;
+	out->play_ready  = play_ready;
+	memcpy( out->banks,   current_banks, sizeof out->banks );
+	memcpy( out->low_mem, low_mem,       sizeof out->low_mem );
+	memcpy( out->sram,    sram,          sizeof out->sram );
+	apu.save_snapshot( &out->apu );
+	#if !NSF_EMU_APU_ONLY
+	{
+		if ( vrc6 ) vrc6->save_state( &out->vrc6 );
+		if ( fme7 ) fme7->save_state( &out->fme7 );
+	}
+	#endif
+}
+
+void Nsf_Emu::load_snapshot( snapshot_t const& in )
+{
+	require( can_snapshot() );
+	memcpy( low_mem, in.low_mem, sizeof low_mem );
+	memcpy( sram,    in.sram,    sizeof sram );
+	for ( int i = 0; i < bank_count; ++i )
+		cpu_write( bank_select_addr + i, in.banks [i] );
+	
+	cpu::r      = in.r;
+	saved_state = in.saved_state;
+	next_play   = in.next_play;
+	play_extra  = in.play_extra;
+	play_ready  = in.play_ready;
+	in_play     = false; // a call interrupted by the snapshot is not timed
+	
+	apu.load_snapshot( in.apu );
+	#if !NSF_EMU_APU_ONLY
+	{
+		if ( vrc6 ) vrc6->load_state( in.vrc6 );
+		if ( fme7 ) fme7->load_state( in.fme7 );
+	}
+	#endif
+	
+	// Samples already buffered belong to the old position
+	clear_buffered_samples();
+	restore_time( in.sample_time );
+}
+
 blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 {
 	set_time( 0 );
@@ -499,6 +565,19 @@ blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 			}
 			else
 			{
+				if ( in_play )
+				{
+					// play routine returned
+					in_play = false;
+					long cost = time() - play_began;
+					play_cost_.log [play_cost_.calls % play_log_size] = cost;
+					play_cost_.calls++;
+					play_cost_.last = cost;
+					play_cost_.total += cost;
+					if ( cost > play_cost_.peak )
+						play_cost_.peak = cost;
+				}
+				
 				play_ready = 1;
 				if ( saved_state.pc != badop_addr )
 				{
@@ -526,6 +605,8 @@ blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 				r.pc = play_addr;
 				low_mem [0x100 + r.sp--] = (badop_addr - 1) >> 8;
 				low_mem [0x100 + r.sp--] = (badop_addr - 1) & 0xFF;
+				play_began = time();
+				in_play = true;
 				GME_FRAME_HOOK( this );
 			}
 		}
@@ -539,6 +620,7 @@ blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 	
 	duration = time();
 	next_play -= duration;
+	play_began -= duration;
 	check( next_play >= 0 );
 	if ( next_play < 0 )
 		next_play = 0;
@@ -7,6 +7,8 @@
 #include "Classic_Emu.h"
 #include "Nes_Apu.h"
 #include "Nes_Cpu.h"
+#include "Nes_Vrc6_Apu.h"
+#include "Nes_Fme7_Apu.h"
 
 class Nsf_Emu : private Nes_Cpu, public Classic_Emu {
 	typedef Nes_Cpu cpu;
@@ -53,7 +55,42 @@ public:
 	~Nsf_Emu();
 	Nes_Apu* apu_() { return &apu; }
 	class Nes_Vrc6_Apu* vrc6_() { return vrc6; }
+	class Nes_Fme7_Apu* fme7_() { return fme7; }
+	class Nes_Namco_Apu* namco_() { return namco; }
 	bool has_vrc6() const { return vrc6 != 0; }
+	
+	// Seconds between calls of the play routine at the current tempo
+	double play_interval() const;
+	// CPU clocks between calls of the play routine at the current tempo
+	long play_period_clocks() const;
+	
+	// CPU clocks the play routine took from its call to its return, since
+	// the track started. A call over play_period_clocks() ran into the next
+	// one's slot, which the NSF then skips. Call n's cost is at
+	// log [n % play_log_size] until play_log_size more have returned.
+	enum { play_log_size = 16 };
+	struct play_cost_t
+	{
+		long calls; // returned
+		long last;
+		long peak;
+		double total;
+		long log [play_log_size];
+	};
+	play_cost_t const& play_cost() const { return play_cost_; }
+	
+	// Samples the chips have run past what was played: waiting in the
+	// Blip_Buffers and rendered for silence detection
+	long samples_ahead() const { return silence_lookahead_samples() + buffered_samples(); }
+	
+	// Complete playback state captured between play() calls, used for fast
+	// seeking. Only valid for the same file, track and tempo it was taken with.
+	struct snapshot_t;
+	
+	// False if the file uses a sound chip without snapshot support (Namco 163)
+	bool can_snapshot() const { return namco == 0; }
+	void save_snapshot( snapshot_t* out ) const;
+	void load_snapshot( snapshot_t const& );
 protected:
 	blargg_err_t track_info_( track_info_t*, int track ) const;
 	blargg_err_t load_( Data_Reader& );
@@ -66,6 +103,7 @@ protected:
 protected:
 	enum { bank_count = 8 };
 	byte initial_banks [bank_count];
+	byte current_banks [bank_count];
 	nes_addr_t init_addr;
 	nes_addr_t play_addr;
 	double clock_rate_;
@@ -78,6 +116,11 @@ protected:
 	int play_extra;
 	int play_ready;
 	
+	// play routine cost
+	play_cost_t play_cost_;
+	nes_time_t play_began; // when the running call started, if in_play
+	bool in_play;
+	
 	enum { rom_begin = 0x8000 };
 	enum { bank_select_addr = 0x5FF8 };
 	enum { bank_size = 0x1000 };
@@ -105,4 +148,20 @@ private:
 	byte unmapped_code [Nes_Cpu::page_size + 8];
 };
 
+struct Nsf_Emu::snapshot_t
+{
+	blargg_long sample_time; // output sample position the state corresponds to
+	Nes_Cpu::registers_t r;
+	Nes_Cpu::registers_t saved_state;
+	nes_time_t next_play;
+	int play_extra;
+	int play_ready;
+	byte banks [bank_count];
+	byte low_mem [0x800];
+	byte sram [0x2000];
+	nes_apu_snapshot_t apu;
+	vrc6_apu_state_t vrc6;
+	fme7_apu_state_t fme7;
+};
+
 #endif
@@ -11,16 +11,11 @@ int Nsf_Emu::cpu_read( nes_addr_t addr )
 {
 	int result;
 	
-	result = cpu::low_mem [addr & 0x7FF];
-	if ( !(addr & 0xE000) )
-		goto exit;
-	
-	result = *cpu::get_code( addr );
-	if ( addr > 0x7FFF )
-		goto exit;
-	
-	result = sram [addr & (sizeof sram - 1)];
-	if ( addr > 0x5FFF )
+	// the CPU's page table maps mirrored RAM, SRAM and the current ROM banks
+	// (cpu_write() remaps those on $5FF8-$5FFF), so only $2000-$5FFF needs decoding.
+	// Indexed addresses can run past $FFFF; they wrap to RAM.
+	result = *cpu::get_code( addr & 0xFFFF );
+	if ( unsigned (addr - 0x2000) >= 0x4000 )
 		goto exit;
 	
 	if ( addr == Nes_Apu::status_addr )
@@ -69,6 +64,7 @@ void Nsf_Emu::cpu_write( nes_addr_t addr, int data )
 	unsigned bank = addr - bank_select_addr;
 	if ( bank < bank_count )
 	{
+		current_banks [bank] = data;
 		blargg_long offset = rom.mask_addr( data * (blargg_long) bank_size );
 		if ( offset >= rom.size() )
 			set_warning( "Invalid bank" );
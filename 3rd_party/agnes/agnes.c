@@ -54,6 +54,14 @@ THE SOFTWARE.
 
 #define AGNES_GET_BIT(byte, bit_ix) (((byte) >> (bit_ix)) & 1)
 
+#if defined(__GNUC__) || defined(__clang__)
+#define AGNES_FORCE_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define AGNES_FORCE_INLINE static __forceinline
+#else
+#define AGNES_FORCE_INLINE static inline
+#endif
+
 #endif /* common_h */
 //FILE_END
 //FILE_START:agnes_types.h
@@ -107,6 +115,25 @@ typedef struct ppu {
     uint8_t palette[32];
 
     uint8_t screen_buffer[AGNES_SCREEN_HEIGHT * AGNES_SCREEN_WIDTH];
+    bool screen_changed; // A pixel differs since agnes_take_screen_changed(); not in compact states
+    bool line_deferred;  // Dots 1..dot of this line not drawn yet, see ppu_catch_up(); false between frames
+
+    // Pattern rows as the PPU currently sees $0000-$1FFF, decoded on first
+    // use: 8 pixels of 2 bits, leftmost in the top bits. Tile by tile,
+    // 64 to a 1KB window; not in compact states.
+    uint16_t chr_rows[512 * 8];
+    bool chr_valid[512];
+
+    // The evaluated sprites' pixels on scanline sprite_line_y (-1 when
+    // stale), built on first use; see build_sprite_line(). Not in compact states.
+    uint8_t sprite_line[AGNES_SCREEN_WIDTH];
+    int16_t sprite_line_y;
+
+    // With the catch-up PPU: dots the CPU has run ahead by, and how many it
+    // may before the PPU must run (at most until vblank or, for mappers
+    // that count them, a PA12 clock). Not in compact states.
+    int dots_owed;
+    int dots_free;
 
     int scanline;
     int dot;
@@ -262,7 +289,7 @@ typedef struct {
     unsigned chr_rom_offset;
     int prg_rom_banks_count;
     int chr_rom_banks_count;
-    bool has_prg_ram;
+    bool has_prg_ram; // Battery-backed (iNES flags 6 bit 1) on a mapper with PRG RAM
     unsigned char mapper;
 } gamepack_t;
 
@@ -296,8 +323,62 @@ typedef struct agnes {
     agnes_apu_write_func apu_write;
     agnes_apu_read_func apu_read;
     void *apu_user_data;
+    agnes_input_strobe_func input_strobe; // See agnes_set_input_handler()
+    void *input_user_data;
+
+    bool fast_ppu; // Draw untouched scanlines at once, see agnes_set_fast_ppu()
+    bool catch_up_ppu; // Let the CPU run ahead of the PPU, see agnes_set_catch_up_ppu()
+    struct agnes_ppu_log *ppu_log; // Attached log, see agnes_log_ppu(); not in states
+    // Battery-backed PRG RAM written since agnes_take_prg_ram(). While it
+    // is not, $6000-$7FFF is mapped for reading alone, so the first write
+    // goes through cpu_write8()'s decode and sets it. Not in states.
+    bool prg_ram_dirty;
+
+    // CPU address space by 256-byte page: RAM and PRG banks are read (and
+    // RAM written) through these directly, NULL pages go to the full decode
+    // in cpu_read8()/cpu_write8(). Rebuilt by map_memory() and on bank
+    // switches; not in states.
+    const uint8_t *read_pages[256];
+    uint8_t *write_pages[256];
+
+    // The cartridge's handlers, bound by mapper_bind() so nothing on the
+    // hot path switches on the mapper number. pa12_rising_edge and
+    // cpu_cycles are NULL for mappers without them. Not in states.
+    struct {
+        uint8_t (*read)(struct agnes *agnes, uint16_t addr);
+        void (*write)(struct agnes *agnes, uint16_t addr, uint8_t val);
+        void (*pa12_rising_edge)(struct agnes *agnes);
+        void (*cpu_cycles)(struct agnes *agnes, int cycles); // After every instruction
+    } mapper_ops;
+
+#ifdef AGNES_PROFILE
+    agnes_profile_t *profile; // This instance's own, not in states
+#endif
 } agnes_t;
 
+/********************************** PPU LOG **********************************/
+
+// Something the CPU did that the picture depends on
+typedef struct {
+    uint32_t dots;  // PPU dots since the log started
+    uint16_t addr;  // $2000-$2007, $4014 (OAM DMA) or a mapper register
+    uint8_t val;
+    bool read;      // A PPU register read, for its side effects
+} ppu_log_event_t;
+
+struct agnes_ppu_log {
+    agnes_t *machine;  // As it was when the log started, and drawn on from there
+    ppu_log_event_t *events;
+    int events_count;
+    int events_capacity;
+    uint8_t *oam;      // All of OAM after each DMA, in order
+    int oam_count;
+    int oam_capacity;
+    uint32_t dots;     // Run since the log started
+    int lines_caught_up;
+    bool failed;       // An event did not fit
+};
+
 #endif /* agnes_types_h */
 //FILE_END
 //FILE_START:cpu.h
@@ -312,6 +393,7 @@ typedef struct agnes agnes_t;
 typedef struct cpu cpu_t;
 
 AGNES_INTERNAL void cpu_init(cpu_t *cpu, agnes_t *agnes);
+AGNES_INTERNAL void cpu_reset(cpu_t *cpu);
 AGNES_INTERNAL int cpu_tick(cpu_t *cpu);
 AGNES_INTERNAL void cpu_update_zn_flags(cpu_t *cpu, uint8_t val);
 AGNES_INTERNAL void cpu_stack_push8(cpu_t *cpu, uint8_t val);
@@ -341,9 +423,17 @@ typedef struct agnes agnes_t;
 typedef struct ppu ppu_t;
 
 AGNES_INTERNAL void ppu_init(ppu_t *ppu, agnes_t *agnes);
+AGNES_INTERNAL void ppu_reset(ppu_t *ppu);
 AGNES_INTERNAL void ppu_tick(ppu_t *ppu, bool *out_new_frame);
 AGNES_INTERNAL uint8_t ppu_read_register(ppu_t *ppu, uint16_t reg);
 AGNES_INTERNAL void ppu_write_register(ppu_t *ppu, uint16_t addr, uint8_t val);
+AGNES_INTERNAL void ppu_catch_up(ppu_t *ppu);
+AGNES_INTERNAL void ppu_run(ppu_t *ppu, int dots, bool *out_new_frame);
+AGNES_INTERNAL void ppu_run_owed(ppu_t *ppu, bool *out_new_frame);
+// The mapper switched the CHR behind [addr, addr + size) of the pattern tables
+AGNES_INTERNAL void ppu_chr_switched(ppu_t *ppu, uint16_t addr, uint16_t size);
+// Append to agnes' attached log, at the dot the PPU is caught up to
+AGNES_INTERNAL void ppu_log_event(agnes_t *agnes, uint16_t addr, uint8_t val, bool read);
 
 #endif /* ppu_h */
 //FILE_END
@@ -375,19 +465,10 @@ typedef enum {
 
 typedef struct cpu cpu_t;
 
-typedef int (*instruction_op_fn)(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
-
-typedef struct {
-    const char *name;
-    uint8_t opcode;
-    uint8_t cycles;
-    bool page_cross_cycle;
-    addr_mode_t mode;
-    instruction_op_fn operation;
-} instruction_t;
-
-AGNES_INTERNAL instruction_t* instruction_get(uint8_t opcode);
 AGNES_INTERNAL uint8_t instruction_get_size(addr_mode_t mode);
+// operand: the two bytes after the opcode when they can be read straight
+// from the code page, NULL to fetch them through cpu_read8()
+AGNES_INTERNAL int instruction_execute(cpu_t *cpu, uint8_t opcode, const uint8_t *operand);
 
 #endif /* opcodes_h */
 //FILE_END
@@ -402,9 +483,14 @@ AGNES_INTERNAL uint8_t instruction_get_size(addr_mode_t mode);
 typedef struct agnes agnes_t;
 
 AGNES_INTERNAL bool mapper_init(agnes_t *agnes);
+AGNES_INTERNAL void mapper_bind(agnes_t *agnes);
 AGNES_INTERNAL uint8_t mapper_read(agnes_t *agnes, uint16_t addr);
 AGNES_INTERNAL void mapper_write(agnes_t *agnes, uint16_t addr, uint8_t val);
 AGNES_INTERNAL void mapper_pa12_rising_edge(agnes_t *agnes);
+AGNES_INTERNAL void mapper_map_prg(agnes_t *agnes);
+#define PRG_RAM_SIZE (8 * 1024)
+// The cartridge's 8KB of battery-backed PRG RAM, NULL if it has none
+AGNES_INTERNAL uint8_t* mapper_prg_ram(const agnes_t *agnes);
 
 #endif /* mapper_h */
 //FILE_END
@@ -554,6 +640,15 @@ agnes_t* agnes_make(void) {
     agnes->apu_write = NULL;
     agnes->apu_read = NULL;
     agnes->apu_user_data = NULL;
+    agnes->input_strobe = NULL;
+    agnes->input_user_data = NULL;
+#ifdef AGNES_PROFILE
+    agnes->profile = (agnes_profile_t*)calloc(1, sizeof(agnes_profile_t));
+    if (!agnes->profile) {
+        free(agnes);
+        return NULL;
+    }
+#endif
     return agnes;
 }
 
@@ -567,13 +662,99 @@ void agnes_set_apu_handler(agnes_t *agnes,
     agnes->apu_user_data = user_data;
 }
 
+void agnes_set_input_handler(agnes_t *agnes, agnes_input_strobe_func strobe_func, void *user_data) {
+    if (!agnes) return;
+    agnes->input_strobe = strobe_func;
+    agnes->input_user_data = user_data;
+}
+
+void agnes_set_fast_ppu(agnes_t *agnes, bool fast) {
+    if (!agnes) return;
+    ppu_catch_up(&agnes->ppu);
+    agnes->fast_ppu = fast;
+}
+
+void agnes_set_catch_up_ppu(agnes_t *agnes, bool catch_up) {
+    if (!agnes) return;
+    ppu_catch_up(&agnes->ppu);
+    agnes->catch_up_ppu = catch_up;
+    agnes->ppu.dots_free = 0; // Not kept up while off
+}
+
 uint64_t agnes_get_cpu_cycles(const agnes_t *agnes) {
     if (!agnes) return 0;
     return agnes->cpu.cycles;
 }
 
-// Forward declaration for mapper24 CPU cycle (needed for IRQ)
-static void mapper24_cpu_cycle(mapper24_t *mapper);
+#ifdef AGNES_PROFILE
+const agnes_profile_t* agnes_get_profile(const agnes_t *agnes) {
+    return agnes->profile;
+}
+
+void agnes_clear_profile(agnes_t *agnes) {
+    memset(agnes->profile, 0, sizeof(agnes_profile_t));
+}
+#endif
+
+uint8_t agnes_peek(const agnes_t *agnes, uint16_t addr) {
+    const uint8_t *page = agnes->read_pages[addr >> 8];
+    return page ? page[addr & 0xff] : 0;
+}
+
+size_t agnes_prg_ram_size(const agnes_t *agnes) {
+    return mapper_prg_ram(agnes) ? PRG_RAM_SIZE : 0;
+}
+
+bool agnes_take_prg_ram(agnes_t *agnes, void *out) {
+    const uint8_t *prg_ram = mapper_prg_ram(agnes);
+    if (!prg_ram || !agnes->prg_ram_dirty) {
+        return false;
+    }
+    memcpy(out, prg_ram, PRG_RAM_SIZE);
+    agnes->prg_ram_dirty = false;
+    mapper_map_prg(agnes); // Read-only again until the next write
+    return true;
+}
+
+bool agnes_load_prg_ram(agnes_t *agnes, const void *data, size_t size) {
+    uint8_t *prg_ram = mapper_prg_ram(agnes);
+    if (!prg_ram || size != PRG_RAM_SIZE) {
+        return false;
+    }
+    memcpy(prg_ram, data, PRG_RAM_SIZE);
+    return true;
+}
+
+// Point the CPU page table at RAM, mirrored up to $1FFF, and at the
+// cartridge's current banks
+static void map_memory(agnes_t *agnes) {
+    for (int page = 0x00; page < 0x20; page++) {
+        agnes->read_pages[page] = agnes->write_pages[page] = agnes->ram + ((page & 0x7) << 8);
+    }
+    mapper_map_prg(agnes);
+}
+
+// Everything as at power-on, for the cartridge already in agnes->gamepack
+static bool power_on(agnes_t *agnes) {
+    const ines_header_t *header = (const ines_header_t*)agnes->gamepack.data;
+    if (AGNES_GET_BIT(header->flags_6, 3)) {
+        agnes->mirroring_mode = MIRRORING_MODE_FOUR_SCREEN;
+    } else {
+        agnes->mirroring_mode = AGNES_GET_BIT(header->flags_6, 0) ? MIRRORING_MODE_VERTICAL : MIRRORING_MODE_HORIZONTAL;
+    }
+
+    memset(agnes->ram, 0xff, sizeof(agnes->ram));
+    memset(&agnes->mapper, 0, sizeof(agnes->mapper));
+    bool ok = mapper_init(agnes);
+    if (!ok) {
+        return false;
+    }
+
+    map_memory(agnes);
+    cpu_init(&agnes->cpu, agnes);
+    ppu_init(&agnes->ppu, agnes);
+    return true;
+}
 
 bool agnes_load_ines_data(agnes_t *agnes, void *data, size_t data_size) {
     if (data_size < sizeof(ines_header_t)) {
@@ -592,12 +773,9 @@ bool agnes_load_ines_data(agnes_t *agnes, void *data, size_t data_size) {
     }
     agnes->gamepack.chr_rom_banks_count = header->chr_rom_banks_count;
     agnes->gamepack.prg_rom_banks_count = header->prg_rom_banks_count;
-    if (AGNES_GET_BIT(header->flags_6, 3)) {
-        agnes->mirroring_mode = MIRRORING_MODE_FOUR_SCREEN;
-    } else {
-        agnes->mirroring_mode = AGNES_GET_BIT(header->flags_6, 0) ? MIRRORING_MODE_VERTICAL : MIRRORING_MODE_HORIZONTAL;
-    }
     agnes->gamepack.mapper = ((header->flags_6 & 0xf0) >> 4) | (header->flags_7 & 0xf0);
+    agnes->gamepack.has_prg_ram = AGNES_GET_BIT(header->flags_6, 1);
+    agnes->prg_ram_dirty = false;
     unsigned prg_rom_size = header->prg_rom_banks_count * (16 * 1024);
     unsigned chr_rom_size = header->chr_rom_banks_count * (8 * 1024);
     unsigned chr_rom_offset = prg_rom_offset + prg_rom_size;
@@ -610,15 +788,32 @@ bool agnes_load_ines_data(agnes_t *agnes, void *data, size_t data_size) {
     agnes->gamepack.prg_rom_offset = prg_rom_offset;
     agnes->gamepack.chr_rom_offset = chr_rom_offset;
 
-    bool ok = mapper_init(agnes);
-    if (!ok) {
-        return false;
-    }
+#ifdef AGNES_PROFILE
+    agnes_clear_profile(agnes); // A new game
+#endif
+    return power_on(agnes);
+}
 
-    cpu_init(&agnes->cpu, agnes);
-    ppu_init(&agnes->ppu, agnes);
-    
-    return true;
+void agnes_reset(agnes_t *agnes, bool hard) {
+#ifdef AGNES_PROFILE
+    agnes->profile->handler_depth = 0;
+#endif
+    if (hard) {
+        // The battery keeps PRG RAM through a power cycle
+        uint8_t *prg_ram = mapper_prg_ram(agnes);
+        uint8_t kept[PRG_RAM_SIZE];
+        if (prg_ram) {
+            memcpy(kept, prg_ram, sizeof(kept));
+        }
+        power_on(agnes);
+        if (prg_ram) {
+            memcpy(mapper_prg_ram(agnes), kept, sizeof(kept));
+        }
+        return;
+    }
+    ppu_catch_up(&agnes->ppu);
+    cpu_reset(&agnes->cpu);
+    ppu_reset(&agnes->ppu);
 }
 
 void agnes_set_input(agnes_t *agn, const agnes_input_t *input_1, const agnes_input_t *input_2) {
@@ -634,11 +829,23 @@ size_t agnes_state_size() {
     return sizeof(agnes_state_t);
 }
 
+size_t agnes_size() {
+    return sizeof(agnes_t);
+}
+
 void agnes_dump_state(const agnes_t *agnes, agnes_state_t *out_res) {
     memmove(out_res, agnes, sizeof(agnes_t));
     out_res->agnes.gamepack.data = NULL;
+    out_res->agnes.ppu_log = NULL;
+    out_res->agnes.prg_ram_dirty = false;
     out_res->agnes.cpu.agnes = NULL;
     out_res->agnes.ppu.agnes = NULL;
+    memset(out_res->agnes.read_pages, 0, sizeof(out_res->agnes.read_pages));
+    memset(out_res->agnes.write_pages, 0, sizeof(out_res->agnes.write_pages));
+    memset(&out_res->agnes.mapper_ops, 0, sizeof(out_res->agnes.mapper_ops));
+#ifdef AGNES_PROFILE
+    out_res->agnes.profile = NULL;
+#endif
     switch (out_res->agnes.gamepack.mapper) {
         case 0: out_res->agnes.mapper.m0.agnes = NULL; break;
         case 1: out_res->agnes.mapper.m1.agnes = NULL; break;
@@ -648,10 +855,8 @@ void agnes_dump_state(const agnes_t *agnes, agnes_state_t *out_res) {
     }
 }
 
-bool agnes_restore_state(agnes_t *agnes, const agnes_state_t *state) {
-    const uint8_t *gamepack_data = agnes->gamepack.data;
-    memmove(agnes, state, sizeof(agnes_t));
-    agnes->gamepack.data = gamepack_data;
+// Point a copied agnes_t's pointers and page tables at itself
+static void bind_machine(agnes_t *agnes) {
     agnes->cpu.agnes = agnes;
     agnes->ppu.agnes = agnes;
     switch (agnes->gamepack.mapper) {
@@ -661,51 +866,348 @@ bool agnes_restore_state(agnes_t *agnes, const agnes_state_t *state) {
         case 4: agnes->mapper.m4.agnes = agnes; break;
         case 24: case 26: agnes->mapper.m24.agnes = agnes; break;
     }
+    mapper_bind(agnes);
+    map_memory(agnes);
+}
+
+bool agnes_restore_state(agnes_t *agnes, const agnes_state_t *state) {
+    const uint8_t *gamepack_data = agnes->gamepack.data;
+    struct agnes_ppu_log *ppu_log = agnes->ppu_log;
+    // Still to be saved if it was, or if the state's PRG RAM is other than this
+    bool prg_ram_dirty = agnes->prg_ram_dirty;
+    const uint8_t *prg_ram = mapper_prg_ram(agnes);
+    if (prg_ram && !prg_ram_dirty) {
+        const uint8_t *state_prg_ram = (const uint8_t*)state + (prg_ram - (const uint8_t*)agnes);
+        prg_ram_dirty = state->agnes.gamepack.mapper != agnes->gamepack.mapper ||
+                        memcmp(prg_ram, state_prg_ram, PRG_RAM_SIZE) != 0;
+    }
+#ifdef AGNES_PROFILE
+    agnes_profile_t *profile = agnes->profile;
+#endif
+    memmove(agnes, state, sizeof(agnes_t));
+    agnes->gamepack.data = gamepack_data;
+    agnes->ppu_log = ppu_log;
+    agnes->prg_ram_dirty = prg_ram_dirty;
+#ifdef AGNES_PROFILE
+    agnes->profile = profile;
+    profile->handler_depth = 0; // The stack is another one now
+#endif
+    bind_machine(agnes);
+    ppu_chr_switched(&agnes->ppu, 0x0000, 0x2000);
+    agnes->ppu.dots_owed = 0;
+    agnes->ppu.dots_free = 0;
     return true;
 }
 
-bool agnes_tick(agnes_t *agnes, bool *out_new_frame) {
+typedef struct {
+    size_t offset;
+    size_t size;
+} state_span_t;
+
+#define STATE_SPAN(from, to) { offsetof(agnes_t, from), offsetof(agnes_t, to) - offsetof(agnes_t, from) }
+#define STATE_FIELD(field) { offsetof(agnes_t, field), sizeof(((agnes_t*)0)->field) }
+
+// The parts of agnes_t a compact state holds, in order; returns the count.
+// parts, if not NULL, gets the AGNES_HASH_ part of each span.
+static int compact_spans(const agnes_t *agnes, state_span_t *spans, int *parts) {
+    const state_span_t common[] = {
+        { offsetof(agnes_t, cpu) + offsetof(cpu_t, pc), sizeof(cpu_t) - offsetof(cpu_t, pc) },
+        STATE_SPAN(ppu.nametables, ppu.screen_buffer),
+        { offsetof(agnes_t, ppu) + offsetof(ppu_t, scanline), sizeof(ppu_t) - offsetof(ppu_t, scanline) },
+        STATE_FIELD(ram),
+        STATE_FIELD(controllers),
+        STATE_FIELD(controllers_latch),
+        STATE_FIELD(mirroring_mode),
+    };
+    const int common_parts[] = {
+        AGNES_HASH_CPU, AGNES_HASH_PPU, AGNES_HASH_PPU, AGNES_HASH_RAM,
+        AGNES_HASH_INPUT, AGNES_HASH_INPUT, AGNES_HASH_MAPPER,
+    };
+    int count = 0;
+    for (size_t i = 0; i < sizeof(common) / sizeof(common[0]); i++) {
+        if (parts) parts[count] = common_parts[i];
+        spans[count++] = common[i];
+    }
+    // The rest is the cartridge's
+    const int mapper_from = count;
+
+    switch (agnes->gamepack.mapper) {
+        case 0:
+            spans[count++] = (state_span_t)STATE_SPAN(mapper.m0.prg_bank_offsets, mapper.m0.chr_ram);
+            if (agnes->mapper.m0.use_chr_ram) spans[count++] = (state_span_t)STATE_FIELD(mapper.m0.chr_ram);
+            break;
+        case 1:
+            spans[count++] = (state_span_t)STATE_SPAN(mapper.m1.shift, mapper.m1.chr_ram);
+            if (agnes->mapper.m1.use_chr_ram) spans[count++] = (state_span_t)STATE_FIELD(mapper.m1.chr_ram);
+            spans[count++] = (state_span_t)STATE_FIELD(mapper.m1.prg_ram);
+            break;
+        case 2:
+            spans[count++] = (state_span_t)STATE_FIELD(mapper.m2.prg_bank_offsets);
+            spans[count++] = (state_span_t)STATE_FIELD(mapper.m2.chr_ram);
+            break;
+        case 4:
+            spans[count++] = (state_span_t)STATE_SPAN(mapper.m4.prg_mode, mapper.m4.chr_ram);
+            if (agnes->mapper.m4.use_chr_ram) spans[count++] = (state_span_t)STATE_FIELD(mapper.m4.chr_ram);
+            break;
+        case 24: case 26:
+            spans[count++] = (state_span_t)STATE_SPAN(mapper.m24.prg_bank_16k, mapper.m24.chr_ram);
+            if (agnes->mapper.m24.use_chr_ram) spans[count++] = (state_span_t)STATE_FIELD(mapper.m24.chr_ram);
+            break;
+    }
+    for (int i = mapper_from; parts && i < count; i++) {
+        parts[i] = AGNES_HASH_MAPPER;
+    }
+    return count;
+}
+
+#undef STATE_SPAN
+#undef STATE_FIELD
+
+size_t agnes_save_compact(const agnes_t *agnes, void *out) {
+    state_span_t spans[16];
+    int count = compact_spans(agnes, spans, NULL);
+    uint8_t *dst = (uint8_t*)out;
+    size_t size = 0;
+    for (int i = 0; i < count; i++) {
+        if (dst) {
+            memcpy(dst + size, (const uint8_t*)agnes + spans[i].offset, spans[i].size);
+        }
+        size += spans[i].size;
+    }
+    return size;
+}
+
+bool agnes_load_compact(agnes_t *agnes, const void *data, size_t size) {
+    if (agnes_save_compact(agnes, NULL) != size) {
+        return false;
+    }
+    uint8_t *prg_ram = agnes->prg_ram_dirty ? NULL : mapper_prg_ram(agnes);
+    uint8_t kept[PRG_RAM_SIZE];
+    if (prg_ram) {
+        memcpy(kept, prg_ram, sizeof(kept));
+    }
+    state_span_t spans[16];
+    int count = compact_spans(agnes, spans, NULL);
+    const uint8_t *src = (const uint8_t*)data;
+    for (int i = 0; i < count; i++) {
+        memcpy((uint8_t*)agnes + spans[i].offset, src, spans[i].size);
+        src += spans[i].size;
+    }
+    if (prg_ram && memcmp(kept, prg_ram, sizeof(kept)) != 0) {
+        agnes->prg_ram_dirty = true;
+    }
+    mapper_map_prg(agnes);
+    ppu_chr_switched(&agnes->ppu, 0x0000, 0x2000);
+    agnes->ppu.dots_owed = 0; // The old timeline's
+    agnes->ppu.dots_free = 0;
+#ifdef AGNES_PROFILE
+    agnes->profile->handler_depth = 0;
+#endif
+    return true;
+}
+
+static uint64_t hash_bytes(const void *data, size_t size, uint64_t hash) {
+    const uint8_t *bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void agnes_hash_state(const agnes_t *agnes, uint64_t out[AGNES_HASH_COUNT]) {
+    for (int i = 0; i < AGNES_HASH_COUNT; i++) {
+        out[i] = 14695981039346656037ull;
+    }
+    state_span_t spans[16];
+    int parts[16];
+    int count = compact_spans(agnes, spans, parts);
+    for (int i = 0; i < count; i++) {
+        out[parts[i]] = hash_bytes((const uint8_t*)agnes + spans[i].offset, spans[i].size, out[parts[i]]);
+    }
+    out[AGNES_HASH_SCREEN] = hash_bytes(agnes->ppu.screen_buffer, sizeof(agnes->ppu.screen_buffer),
+                                        out[AGNES_HASH_SCREEN]);
+}
+
+// One instruction and the PPU dots it takes. With the catch-up PPU the dots
+// are only owed, and run at the first instruction end that reaches the
+// next event, which is where they would have run anyway; anything the CPU
+// does that the PPU could see or change runs them first (ppu_catch_up()).
+static bool step(agnes_t *agnes, bool *out_new_frame) {
     int cpu_cycles = cpu_tick(&agnes->cpu);
     if (cpu_cycles == 0) {
         return false;
     }
 
     int ppu_cycles = cpu_cycles * 3;
-    for (int i = 0; i < ppu_cycles; i++) {
-        ppu_tick(&agnes->ppu, out_new_frame);
+    if (agnes->catch_up_ppu) {
+        agnes->ppu.dots_owed += ppu_cycles;
+        if (agnes->ppu.dots_owed >= agnes->ppu.dots_free) {
+            ppu_run_owed(&agnes->ppu, out_new_frame);
+        }
+    } else {
+        ppu_run(&agnes->ppu, ppu_cycles, out_new_frame);
     }
     
     // Run mapper-specific CPU cycle logic (for IRQ counters, etc.)
-    if (agnes->gamepack.mapper == 24 || agnes->gamepack.mapper == 26) {
-        for (int i = 0; i < cpu_cycles; i++) {
-            mapper24_cpu_cycle(&agnes->mapper.m24);
-        }
+    if (agnes->mapper_ops.cpu_cycles) {
+        agnes->mapper_ops.cpu_cycles(agnes, cpu_cycles);
     }
     
     return true;
 }
 
+bool agnes_tick(agnes_t *agnes, bool *out_new_frame) {
+    bool ok = step(agnes, out_new_frame);
+    ppu_run_owed(&agnes->ppu, out_new_frame); // Callers see the PPU where the CPU is
+    return ok;
+}
+
 bool agnes_next_frame(agnes_t *agnes) {
     while (true) {
         bool new_frame = false;
-        bool ok = agnes_tick(agnes, &new_frame);
+        bool ok = step(agnes, &new_frame);
         if (!ok) {
+            ppu_run_owed(&agnes->ppu, &new_frame);
             return false;
         }
         if (new_frame) {
             break;
         }
     }
+#ifdef AGNES_PROFILE
+    agnes_profile_t *profile = agnes->profile;
+    profile->nmi_cycles = profile->frame_cycles[0];
+    profile->irq_cycles = profile->frame_cycles[1];
+    if (profile->nmi_cycles > profile->nmi_peak) profile->nmi_peak = profile->nmi_cycles;
+    if (profile->irq_cycles > profile->irq_peak) profile->irq_peak = profile->irq_cycles;
+    profile->frame_cycles[0] = profile->frame_cycles[1] = 0;
+    profile->frames++;
+#endif
     return true;
 }
 
+agnes_ppu_log_t* agnes_make_ppu_log(void) {
+    agnes_ppu_log_t *log = (agnes_ppu_log_t*)calloc(1, sizeof(agnes_ppu_log_t));
+    if (!log) {
+        return NULL;
+    }
+    log->machine = agnes_make();
+    if (!log->machine) {
+        free(log);
+        return NULL;
+    }
+    return log;
+}
+
+void agnes_destroy_ppu_log(agnes_ppu_log_t *log) {
+    if (!log) return;
+    agnes_destroy(log->machine);
+    free(log->events);
+    free(log->oam);
+    free(log);
+}
+
+void agnes_log_ppu(agnes_t *agnes, agnes_ppu_log_t *log) {
+    ppu_catch_up(&agnes->ppu); // The last dots are the old log's, and no line is left half done
+    agnes->ppu_log = log;
+    if (!log) {
+        return;
+    }
+    log->events_count = 0;
+    log->oam_count = 0;
+    log->dots = 0;
+    log->lines_caught_up = 0;
+    log->failed = false;
+
+    // The copy only ever runs its PPU: it has no APU to call, nothing owed
+    // and no log of its own
+    agnes_t *machine = log->machine;
+#ifdef AGNES_PROFILE
+    agnes_profile_t *profile = machine->profile;
+#endif
+    memcpy(machine, agnes, sizeof(agnes_t));
+#ifdef AGNES_PROFILE
+    machine->profile = profile;
+#endif
+    machine->ppu_log = NULL;
+    machine->apu_write = NULL;
+    machine->apu_read = NULL;
+    machine->apu_user_data = NULL;
+    machine->input_strobe = NULL;
+    machine->input_user_data = NULL;
+    machine->catch_up_ppu = false;
+    bind_machine(machine);
+}
+
+// Each event is applied with the copy's PPU caught up to the dot it
+// happened at, as agnes' own was
+bool agnes_render_ppu_log(agnes_ppu_log_t *log, const uint8_t *screen) {
+    agnes_t *machine = log->machine;
+    ppu_t *ppu = &machine->ppu;
+    memcpy(ppu->screen_buffer, screen, sizeof(ppu->screen_buffer));
+    ppu->screen_changed = false;
+
+    bool new_frame = false;
+    uint32_t dots = 0;
+    const uint8_t *oam = log->oam;
+    for (int i = 0; i < log->events_count; i++) {
+        const ppu_log_event_t *event = &log->events[i];
+        ppu_run(ppu, (int)(event->dots - dots), &new_frame);
+        dots = event->dots;
+        ppu_catch_up(ppu);
+        if (event->read) {
+            ppu_read_register(ppu, event->addr);
+        } else if (event->addr == 0x4014) {
+            ppu->last_reg_write = event->val;
+            memcpy(ppu->oam_data, oam, sizeof(ppu->oam_data));
+            oam += sizeof(ppu->oam_data);
+        } else if (event->addr < 0x4000) {
+            ppu_write_register(ppu, event->addr, event->val);
+        } else {
+            mapper_write(machine, event->addr, event->val);
+        }
+    }
+    ppu_run(ppu, (int)(log->dots - dots), &new_frame);
+    ppu_catch_up(ppu);
+    return !log->failed;
+}
+
+void agnes_take_ppu_log_screen(agnes_t *agnes, const agnes_ppu_log_t *log) {
+    const ppu_t *ppu = &log->machine->ppu;
+    memcpy(agnes->ppu.screen_buffer, ppu->screen_buffer, sizeof(ppu->screen_buffer));
+    agnes->ppu.screen_changed |= ppu->screen_changed;
+}
+
+int agnes_ppu_log_lines_caught_up(const agnes_ppu_log_t *log) {
+    return log->lines_caught_up;
+}
+
 agnes_color_t agnes_get_screen_pixel(const agnes_t *agnes, int x, int y) {
     int ix = (y * AGNES_SCREEN_WIDTH) + x;
     uint8_t color_ix = agnes->ppu.screen_buffer[ix];
     return g_colors[color_ix & 0x3f];
 }
 
+const uint8_t* agnes_get_screen_buffer(const agnes_t *agnes) {
+    return agnes->ppu.screen_buffer;
+}
+
+bool agnes_take_screen_changed(agnes_t *agnes) {
+    bool changed = agnes->ppu.screen_changed;
+    agnes->ppu.screen_changed = false;
+    return changed;
+}
+
+const agnes_color_t* agnes_get_palette(void) {
+    return g_colors;
+}
+
 void agnes_destroy(agnes_t *agnes) {
+#ifdef AGNES_PROFILE
+    if (agnes) {
+        free(agnes->profile);
+    }
+#endif
     free(agnes);
 }
 
@@ -735,10 +1237,30 @@ static uint8_t get_input_byte(const agnes_input_t* input) {
 #include "mapper.h"
 #endif
 
-static uint16_t cpu_read16_indirect_bug(cpu_t *cpu, uint16_t addr);
-static uint16_t get_instruction_operand(cpu_t *cpu, addr_mode_t mode, bool *out_pages_differ);
 static int handle_interrupt(cpu_t *cpu);
-static bool check_pages_differ(uint16_t a, uint16_t b);
+
+#ifdef AGNES_PROFILE
+// One instruction of cycles at pc, started with the stack pointer at sp and
+// interrupt being the one taken before it
+static void profile_instruction(cpu_t *cpu, uint16_t pc, uint8_t sp, uint8_t opcode, int interrupt, int cycles) {
+    agnes_profile_t *profile = cpu->agnes->profile;
+    profile->pc_cycles[pc] += cycles;
+    profile->total_cycles += cycles;
+    if (interrupt != INTERRPUT_NONE && profile->handler_depth < 8) {
+        // The flags and return address are pushed; RTI pops 3
+        int depth = profile->handler_depth++;
+        profile->handler_kind[depth] = interrupt == INTERRUPT_NMI ? 0 : 1;
+        profile->handler_sp[depth] = (uint8_t)(sp + 3);
+    }
+    if (profile->handler_depth > 0) {
+        int depth = profile->handler_depth - 1;
+        profile->frame_cycles[profile->handler_kind[depth]] += cycles;
+        if (opcode == 0x40 && cpu->sp == profile->handler_sp[depth]) { // RTI
+            profile->handler_depth--;
+        }
+    }
+}
+#endif
 
 void cpu_init(cpu_t *cpu, agnes_t *agnes) {
     memset(cpu, 0, sizeof(cpu_t));
@@ -748,38 +1270,60 @@ void cpu_init(cpu_t *cpu, agnes_t *agnes) {
     cpu_restore_flags(cpu, 0x24);
 }
 
+// The RESET line: the stack pointer drops by 3 as if for an interrupt, but
+// nothing is written, and the other registers keep their values
+void cpu_reset(cpu_t *cpu) {
+    cpu->sp -= 3;
+    cpu->flag_dis_interrupt = 1;
+    cpu->stall = 0;
+    cpu->interrupt = INTERRPUT_NONE;
+    cpu->pc = cpu_read16(cpu, 0xfffc);
+}
+
 int cpu_tick(cpu_t *cpu) {
     if (cpu->stall > 0) {
         cpu->stall--;
+#ifdef AGNES_PROFILE
+        cpu->agnes->profile->dma_cycles++;
+        cpu->agnes->profile->total_cycles++;
+#endif
         return 1;
     }
 
     int cycles = 0;
 
+#ifdef AGNES_PROFILE
+    int interrupt = cpu->interrupt;
+#endif
     if (cpu->interrupt != INTERRPUT_NONE) {
         cycles += handle_interrupt(cpu);
     }
 
-    uint8_t opcode = cpu_read8(cpu, cpu->pc);
-    instruction_t *ins = instruction_get(opcode);
-    if (ins->operation == NULL) {
-        return 0;
+#ifdef AGNES_PROFILE
+    uint16_t pc = cpu->pc;
+    uint8_t sp = cpu->sp;
+#endif
+    // RAM and PRG are plain memory: the opcode and its operand come from
+    // one page table lookup, unless the instruction runs off the page
+    uint8_t opcode;
+    const uint8_t *operand = NULL;
+    const uint8_t *page = cpu->agnes->read_pages[cpu->pc >> 8];
+    if (page && (cpu->pc & 0xff) <= 0xfd) {
+        opcode = page[cpu->pc & 0xff];
+        operand = page + (cpu->pc & 0xff) + 1;
+    } else {
+        opcode = cpu_read8(cpu, cpu->pc);
     }
-    
-    uint8_t ins_size = instruction_get_size(ins->mode);
-    bool page_crossed = false;
-    uint16_t addr = get_instruction_operand(cpu, ins->mode, &page_crossed);
-
-    cpu->pc += ins_size;
-
-    cycles += ins->cycles;
-    cycles += ins->operation(cpu, addr, ins->mode);
-
-    if (page_crossed && ins->page_cross_cycle) {
-        cycles += 1;
+    int ins_cycles = instruction_execute(cpu, opcode, operand);
+    if (ins_cycles == 0) {
+        return 0;
     }
+    cycles += ins_cycles;
 
     cpu->cycles += cycles;
+#ifdef AGNES_PROFILE
+    profile_instruction(cpu, pc, sp, opcode, interrupt, cycles);
+#endif
 
     return cycles;
 }
@@ -851,15 +1395,27 @@ void cpu_set_dma_stall(cpu_t *cpu) {
 void cpu_write8(cpu_t *cpu, uint16_t addr, uint8_t val) {
     agnes_t *agnes = cpu->agnes;
 
-    if (addr < 0x2000) {
-        agnes->ram[addr & 0x7ff] = val;
+    uint8_t *page = agnes->write_pages[addr >> 8];
+    if (page) { // RAM and PRG RAM
+        page[addr & 0xff] = val;
     } else if (addr < 0x4000) {
+        ppu_catch_up(&agnes->ppu);
         ppu_write_register(&agnes->ppu, 0x2000 | (addr & 0x7), val);
+        if (agnes->ppu_log) {
+            ppu_log_event(agnes, 0x2000 | (addr & 0x7), val, false);
+        }
     } else if (addr == 0x4014) {
+        ppu_catch_up(&agnes->ppu);
         ppu_write_register(&agnes->ppu, 0x4014, val);
+        if (agnes->ppu_log) {
+            ppu_log_event(agnes, 0x4014, val, false);
+        }
     } else if (addr == 0x4016) {
         agnes->controllers_latch = val & 0x1;
         if (agnes->controllers_latch) {
+            if (agnes->input_strobe) { // May call agnes_set_input() for the buttons held now
+                agnes->input_strobe(agnes->input_user_data, cpu->cycles);
+            }
             agnes->controllers[0].shift = agnes->controllers[0].state;
             agnes->controllers[1].shift = agnes->controllers[1].state;
         }
@@ -870,20 +1426,41 @@ void cpu_write8(cpu_t *cpu, uint16_t addr, uint8_t val) {
     } else if (addr < 0x4020) { // disabled
 
     } else {
+        if (addr >= 0x8000) { // Mapper registers may switch CHR banks or mirroring
+            ppu_catch_up(&agnes->ppu);
+        }
         mapper_write(agnes, addr, val);
+        if (addr >= 0x8000 && agnes->ppu_log) {
+            ppu_log_event(agnes, addr, val, false);
+        } else if (addr >= 0x6000 && addr < 0x8000 && agnes->gamepack.has_prg_ram && !agnes->prg_ram_dirty) {
+            // The first write since the last save; the rest go straight in
+            agnes->prg_ram_dirty = true;
+            mapper_map_prg(agnes);
+        }
     }
 }
 
 uint8_t cpu_read8(cpu_t *cpu, uint16_t addr) {
     agnes_t *agnes = cpu->agnes;
 
+    const uint8_t *page = agnes->read_pages[addr >> 8];
+    if (page) { // RAM and PRG, the common case
+        return page[addr & 0xff];
+    }
+
     uint8_t res = 0;
-    if (addr >= 0x4020) { // moved to top because it's the most common case
+    if (addr >= 0x4020) {
         res = mapper_read(agnes, addr);
-    } else if (addr < 0x2000) {
-        res = agnes->ram[addr & 0x7ff];
     } else if (addr < 0x4000) {
-        res = ppu_read_register(&agnes->ppu, 0x2000 | (addr & 0x7));
+        ppu_catch_up(&agnes->ppu);
+        uint16_t reg = 0x2000 | (addr & 0x7);
+        // Of the reads, only PPUDATA's and a PPUSTATUS one that resets the
+        // write toggle change what is drawn
+        bool logged = agnes->ppu_log && (reg == 0x2007 || (reg == 0x2002 && agnes->ppu.regs.w));
+        res = ppu_read_register(&agnes->ppu, reg);
+        if (logged) {
+            ppu_log_event(agnes, reg, 0, true);
+        }
     } else if (addr < 0x4016) {
         // APU read (mainly 0x4015 status)
         if (agnes->apu_read) {
@@ -906,71 +1483,6 @@ uint16_t cpu_read16(cpu_t *cpu, uint16_t addr) {
     return (hi << 8) | lo;
 }
 
-static uint16_t cpu_read16_indirect_bug(cpu_t *cpu, uint16_t addr) {
-    uint8_t lo = cpu_read8(cpu, addr);
-    uint8_t hi = cpu_read8(cpu, (addr & 0xff00) | ((addr + 1) & 0x00ff));
-    return (hi << 8) | lo;
-}
-
-static uint16_t get_instruction_operand(cpu_t *cpu, addr_mode_t mode, bool *out_pages_differ) {
-    *out_pages_differ = false;
-    switch (mode) {
-        case ADDR_MODE_ABSOLUTE: {
-            return cpu_read16(cpu, cpu->pc + 1);
-        }
-        case ADDR_MODE_ABSOLUTE_X: {
-            uint16_t addr = cpu_read16(cpu, cpu->pc + 1);
-            uint16_t res = addr + cpu->x;
-            *out_pages_differ = check_pages_differ(addr, res);
-            return res;
-        }
-        case ADDR_MODE_ABSOLUTE_Y: {
-            uint16_t addr = cpu_read16(cpu, cpu->pc + 1);
-            uint16_t res = addr + cpu->y;
-            *out_pages_differ = check_pages_differ(addr, res);
-            return res;
-        }
-        case ADDR_MODE_IMMEDIATE: {
-            return cpu->pc + 1;
-        }
-        case ADDR_MODE_INDIRECT: {
-            uint16_t addr = cpu_read16(cpu, cpu->pc + 1);
-            return cpu_read16_indirect_bug(cpu, addr);
-        }
-        case ADDR_MODE_INDIRECT_X: {
-            uint8_t addr = cpu_read8(cpu, (cpu->pc + 1));
-            return cpu_read16_indirect_bug(cpu, (addr + cpu->x) & 0xff);
-        }
-        case ADDR_MODE_INDIRECT_Y: {
-            uint8_t arg = cpu_read8(cpu, cpu->pc + 1);
-            uint16_t addr2 = cpu_read16_indirect_bug(cpu, arg);
-            uint16_t res = addr2 + cpu->y;
-            *out_pages_differ = check_pages_differ(addr2, res);
-            return res;
-        }
-        case ADDR_MODE_ZERO_PAGE: {
-            return cpu_read8(cpu, cpu->pc + 1);
-        }
-        case ADDR_MODE_ZERO_PAGE_X: {
-            return (cpu_read8(cpu, cpu->pc + 1) + cpu->x) & 0xff;
-        }
-        case ADDR_MODE_ZERO_PAGE_Y: {
-            return (cpu_read8(cpu, cpu->pc + 1) + cpu->y) & 0xff;
-        }
-        case ADDR_MODE_RELATIVE: {
-            uint8_t addr = cpu_read8(cpu, cpu->pc + 1);
-            if (addr < 0x80) {
-                return cpu->pc + addr + 2;
-            } else {
-                return cpu->pc + addr + 2 - 0x100;
-            }
-        }
-        default: {
-            return 0;
-        }
-    }
-}
-
 static int handle_interrupt(cpu_t *cpu) {
     uint16_t addr = 0;
     if (cpu->interrupt == INTERRUPT_NMI) {
@@ -988,10 +1500,6 @@ static int handle_interrupt(cpu_t *cpu) {
     cpu->flag_dis_interrupt = true;
     return 7;
 }
-
-static bool check_pages_differ(uint16_t a, uint16_t b) {
-    return (0xff00 & a) != (0xff00 & b);
-}
 //FILE_END
 //FILE_START:ppu.c
 #include <stdlib.h>
@@ -1007,17 +1515,26 @@ static bool check_pages_differ(uint16_t a, uint16_t b) {
 #endif
 
 static void scanline_visible_pre(ppu_t *ppu, bool *out_new_frame);
+static void render_line(ppu_t *ppu);
+static void draw_line(ppu_t *ppu, const uint16_t *tile_row, const uint8_t *tile_at, uint16_t first_at);
 static void inc_hori_v(ppu_t *ppu);
 static void inc_vert_v(ppu_t *ppu);
 static void emit_pixel(ppu_t *ppu);
 static uint16_t get_bg_color_addr(ppu_t *ppu);
 static uint16_t get_sprite_color_addr(ppu_t *ppu, int *out_sprite_ix, bool *out_behind_bg);
+static void build_sprite_line(ppu_t *ppu);
 static void eval_sprites(ppu_t *ppu);
 static void set_pixel_color_ix(ppu_t *ppu, int x, int y, uint8_t color_ix);
+static uint16_t ppu_chr_row(ppu_t *ppu, uint16_t addr);
 static uint8_t ppu_read8(ppu_t *ppu, uint16_t addr);
 static void ppu_write8(ppu_t *ppu, uint16_t addr, uint8_t val);
 static uint16_t mirror_address(ppu_t *ppu, uint16_t addr);
 
+// ppu_t.sprite_line entries; 0 where no sprite is opaque
+#define SPRITE_PIXEL_COLOR  0x1f // Palette address & 0x1f
+#define SPRITE_PIXEL_ZERO   0x20 // From sprite 0
+#define SPRITE_PIXEL_BEHIND 0x40 // Behind the background
+
 static unsigned g_palette_addr_map[32] = {
     0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
     0x00, 0x11, 0x12, 0x13, 0x04, 0x15, 0x16, 0x17, 0x08, 0x19, 0x1a, 0x1b, 0x0c, 0x1d, 0x1e, 0x1f,
@@ -1031,6 +1548,101 @@ void ppu_init(ppu_t *ppu, agnes_t *agnes) {
     ppu_write_register(ppu, 0x2001, 0);
 }
 
+// The RESET line clears PPUCTRL, PPUMASK, the scroll, the write toggle and
+// the read buffer; VRAM, OAM, the palette and the address are kept
+void ppu_reset(ppu_t *ppu) {
+    ppu_write_register(ppu, 0x2000, 0);
+    ppu_write_register(ppu, 0x2001, 0);
+    ppu->regs.t = 0;
+    ppu->regs.x = 0;
+    ppu->regs.w = 0;
+    ppu->ppudata_buffer = 0;
+    ppu->is_odd_frame = false;
+}
+
+#define PPU_LINE_DOTS 341
+#define PPU_FRAME_LINES 262
+
+// Ticks until the PPU handles scanline's dot, or one fewer if the odd
+// frame's skipped dot could be on the way: running the owed dots early
+// changes nothing, running them late would
+static int dots_until(const ppu_t *ppu, int scanline, int dot) {
+    int now = ppu->scanline * PPU_LINE_DOTS + ppu->dot;
+    int then = scanline * PPU_LINE_DOTS + dot;
+    if (then > now) {
+        return then - now;
+    }
+    return then + PPU_FRAME_LINES * PPU_LINE_DOTS - now - 1;
+}
+
+// Until vblank starts (the NMI and the end of the frame) and, for a mapper
+// that counts PA12 clocks, the next dot one could fall on. What else the
+// PPU does is only seen through its registers, which catch it up.
+static int dots_to_event(const ppu_t *ppu) {
+    int dots = dots_until(ppu, 241, 1);
+    if (ppu->agnes->mapper_ops.pa12_rising_edge) {
+        int to_pa12;
+        if (ppu->dot < 270) {
+            to_pa12 = 270 - ppu->dot;
+        } else if (ppu->dot < 324) {
+            to_pa12 = 324 - ppu->dot;
+        } else {
+            to_pa12 = PPU_LINE_DOTS - ppu->dot + 270 - (ppu->scanline == 261 ? 1 : 0);
+        }
+        if (to_pa12 < dots) {
+            dots = to_pa12;
+        }
+    }
+    return dots;
+}
+
+// How many of the next ticks would do nothing but move to the next dot of
+// this line: all of a line without fetches bar dot 1 of lines 241 and 261,
+// and dots 2-255 of a deferred line
+static int idle_dots(const ppu_t *ppu) {
+    int dot = ppu->dot;
+    if (dot == 0 || dot >= PPU_LINE_DOTS - 1) {
+        return 0;
+    }
+    bool rendering_enabled = ppu->masks.show_background || ppu->masks.show_sprites;
+    bool scanline_visible = ppu->scanline >= 0 && ppu->scanline < 240;
+    if (!rendering_enabled || !(scanline_visible || ppu->scanline == 261)) {
+        return PPU_LINE_DOTS - 1 - dot;
+    }
+    if (ppu->line_deferred && dot < 255) {
+        return 255 - dot;
+    }
+    return 0;
+}
+
+// Run dots ticks, skipping idle stretches at once
+void ppu_run(ppu_t *ppu, int dots, bool *out_new_frame) {
+    if (ppu->agnes->ppu_log) {
+        ppu->agnes->ppu_log->dots += dots;
+    }
+    while (dots > 0) {
+        int idle = idle_dots(ppu);
+        if (idle > 0) {
+            idle = idle < dots ? idle : dots;
+            ppu->dot += idle;
+            dots -= idle;
+        } else {
+            ppu_tick(ppu, out_new_frame);
+            dots--;
+        }
+    }
+}
+
+// Run the dots the CPU got ahead by
+void ppu_run_owed(ppu_t *ppu, bool *out_new_frame) {
+    ppu_run(ppu, ppu->dots_owed, out_new_frame);
+    ppu->dots_owed = 0;
+    ppu->dots_free = dots_to_event(ppu);
+}
+
+#undef PPU_LINE_DOTS
+#undef PPU_FRAME_LINES
+
 void ppu_tick(ppu_t *ppu, bool *out_new_frame) {
     bool rendering_enabled = ppu->masks.show_background || ppu->masks.show_sprites;
 
@@ -1062,7 +1674,17 @@ void ppu_tick(ppu_t *ppu, bool *out_new_frame) {
     bool scanline_post = ppu->scanline == 241;
 
     if (rendering_enabled && (scanline_visible || scanline_pre)) {
-        scanline_visible_pre(ppu, out_new_frame);
+        // With the fast PPU a visible line's pixels wait for dot 256 and are
+        // drawn at once, unless the CPU touches the PPU before then
+        if (scanline_visible && ppu->dot == 1 && ppu->agnes->fast_ppu) {
+            ppu->line_deferred = true;
+        }
+        if (!ppu->line_deferred) {
+            scanline_visible_pre(ppu, out_new_frame);
+        } else if (ppu->dot == 256) {
+            render_line(ppu);
+            ppu->line_deferred = false;
+        }
     }
 
     if (ppu->dot == 1) {
@@ -1151,6 +1773,7 @@ static void scanline_visible_pre(ppu_t *ppu, bool *out_new_frame) {
             eval_sprites(ppu);
         } else {
             ppu->sprite_ixs_count = 0;
+            ppu->sprite_line_y = -1;
         }
     }
 
@@ -1172,6 +1795,243 @@ static void scanline_visible_pre(ppu_t *ppu, bool *out_new_frame) {
     }
 }
 
+// lo and hi plane bits side by side: bit i of each to bits 2i and 2i + 1
+static uint16_t interleave_row(uint8_t lo, uint8_t hi) {
+    uint32_t x = lo | ((uint32_t)hi << 16);
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return (uint16_t)((x & 0xffff) | ((x >> 16) << 1));
+}
+
+// Decoded row of the bytes at addr and addr + 8, normally tile << 4 | fine y.
+// A sprite whose size changed since evaluation can land elsewhere; those
+// rows are read as they are.
+static uint16_t ppu_chr_row(ppu_t *ppu, uint16_t addr) {
+    if (addr & 0xe008) {
+        return interleave_row(ppu_read8(ppu, addr), ppu_read8(ppu, addr + 8));
+    }
+    unsigned tile = addr >> 4;
+    if (!ppu->chr_valid[tile]) {
+        uint16_t base = tile << 4;
+        for (int y = 0; y < 8; y++) {
+            ppu->chr_rows[tile * 8 + y] = interleave_row(mapper_read(ppu->agnes, base + y),
+                                                         mapper_read(ppu->agnes, base + y + 8));
+        }
+        ppu->chr_valid[tile] = true;
+    }
+    return ppu->chr_rows[tile * 8 + (addr & 0x7)];
+}
+
+void ppu_chr_switched(ppu_t *ppu, uint16_t addr, uint16_t size) {
+    unsigned from = addr >> 4;
+    unsigned to = (addr + size) >> 4;
+    memset(ppu->chr_valid + from, 0, (to < 512 ? to : 512) - from);
+    ppu->sprite_line_y = -1;
+}
+
+// Grow *items to hold count of size bytes, doubling
+static bool log_reserve(void **items, int *capacity, int count, size_t size) {
+    if (count <= *capacity) {
+        return true;
+    }
+    int grown = *capacity ? *capacity : 256;
+    while (grown < count) {
+        grown *= 2;
+    }
+    void *more = realloc(*items, (size_t)grown * size);
+    if (!more) {
+        return false;
+    }
+    *items = more;
+    *capacity = grown;
+    return true;
+}
+
+void ppu_log_event(agnes_t *agnes, uint16_t addr, uint8_t val, bool read) {
+    agnes_ppu_log_t *log = agnes->ppu_log;
+    if (log->failed) {
+        return;
+    }
+    if (!log_reserve((void**)&log->events, &log->events_capacity, log->events_count + 1, sizeof(ppu_log_event_t))) {
+        log->failed = true;
+        return;
+    }
+    if (addr == 0x4014) {
+        // The DMA's bytes come from CPU memory, so the copy gets them as OAM ends up
+        int bytes = (int)sizeof(agnes->ppu.oam_data);
+        if (!log_reserve((void**)&log->oam, &log->oam_capacity, log->oam_count + bytes, 1)) {
+            log->failed = true;
+            return;
+        }
+        memcpy(log->oam + log->oam_count, agnes->ppu.oam_data, bytes);
+        log->oam_count += bytes;
+    }
+    ppu_log_event_t *event = &log->events[log->events_count++];
+    event->dots = log->dots;
+    event->addr = addr;
+    event->val = val;
+    event->read = read;
+}
+
+// Run any owed dots, then draw the deferred dots of this line one at a
+// time, before the CPU reads or changes anything they depend on; the rest
+// of the line stays dot-accurate. The owed dots never reach an event (see
+// step()), so no frame can end here.
+void ppu_catch_up(ppu_t *ppu) {
+    if (ppu->dots_owed) {
+        bool new_frame = false;
+        ppu_run_owed(ppu, &new_frame);
+    }
+    if (!ppu->line_deferred) {
+        return;
+    }
+    ppu->line_deferred = false;
+    if (ppu->agnes->ppu_log) {
+        ppu->agnes->ppu_log->lines_caught_up++;
+    }
+
+    const int dot = ppu->dot;
+    bool new_frame = false;
+    for (int d = 1; d <= dot; d++) {
+        ppu->dot = d;
+        scanline_visible_pre(ppu, &new_frame);
+    }
+    ppu->dot = dot;
+}
+
+// 2-bit background pixel p of a line's decoded tile rows
+AGNES_FORCE_INLINE uint8_t tile_row_pixel(const uint16_t *tile_row, int p) {
+    return (tile_row[p >> 3] >> (14 - ((p & 0x7) << 1))) & 0x3;
+}
+
+// Sprite 0 is on this line and could still hit; with a log attached this
+// is all the PPU's own pixels are worked out for
+static bool sprite_zero_pending(const ppu_t *ppu) {
+    return ppu->masks.show_background && ppu->masks.show_sprites && !ppu->status.sprite_zero_hit
+        && ppu->sprite_ixs_count > 0 && ppu->sprite_ixs[0] == 0;
+}
+
+// render_line()'s sprite 0 test alone, over the 8 pixels sprite 0 can cover
+static void line_sprite_zero_hit(ppu_t *ppu, const uint16_t *tile_row) {
+    if (ppu->sprite_line_y != ppu->scanline) {
+        build_sprite_line(ppu);
+    }
+    const bool leftmost = ppu->masks.show_leftmost_bg && ppu->masks.show_leftmost_sprites;
+    const int from = ppu->sprites[0].x_pos;
+    for (int x = from; x < from + 8 && x < AGNES_SCREEN_WIDTH - 1; x++) {
+        uint8_t sprite = ppu->sprite_line[x];
+        if (!(sprite & SPRITE_PIXEL_ZERO) || (x < 8 && !leftmost)) {
+            continue;
+        }
+        if (tile_row_pixel(tile_row, x + ppu->regs.x)) {
+            ppu->status.sprite_zero_hit = true;
+            return;
+        }
+    }
+}
+
+// Dots 1-256 of a visible line in one go, leaving the same pixels and state
+// as scanline_visible_pre() would. The background pixel at x comes from bit
+// x + fine x of the two tiles already in the shift registers followed by
+// the 32 fetched on this line; the first 8 pixels' attributes are still in
+// at_shift, and the 8 after that use at_latch.
+static void render_line(ppu_t *ppu) {
+    uint16_t tile_row[34];
+    uint8_t tile_at[34];
+    tile_row[0] = interleave_row(ppu->bg_lo_shift >> 8, ppu->bg_hi_shift >> 8);
+    tile_row[1] = interleave_row(ppu->bg_lo_shift & 0xff, ppu->bg_hi_shift & 0xff);
+    tile_at[0] = 0;
+    tile_at[1] = ppu->at_latch & 0x3;
+    const uint16_t first_at = ppu->at_shift;
+    uint8_t last_lo = 0, last_hi = 0; // Tile 30, for the shift registers
+
+    for (int i = 0; i < 32; i++) {
+        uint16_t v = ppu->regs.v;
+        ppu->nt = ppu_read8(ppu, 0x2000 | (v & 0x0fff));
+        ppu->at = ppu_read8(ppu, 0x23C0 | (v & 0x0C00) | ((v >> 4) & 0x38) | ((v >> 2) & 0x07));
+        if (v & 0x40) {
+            ppu->at = ppu->at >> 4;
+        }
+        if (v & 0x02) {
+            ppu->at = ppu->at >> 2;
+        }
+        uint8_t fine_y = (v >> 12) & 0x7;
+        uint16_t addr = ppu->ctrl.bg_table_addr + (ppu->nt << 4) + fine_y;
+        tile_row[i + 2] = ppu_chr_row(ppu, addr);
+        tile_at[i + 2] = ppu->at & 0x3;
+        if (i >= 30) { // The raw bytes are only needed for what stays in the registers
+            last_lo = ppu->bg_lo;
+            last_hi = ppu->bg_hi;
+            ppu->bg_lo = ppu_read8(ppu, addr);
+            ppu->bg_hi = ppu_read8(ppu, addr + 8);
+        }
+
+        if (i == 31) {
+            inc_vert_v(ppu);
+        } else {
+            inc_hori_v(ppu);
+        }
+    }
+
+    if (ppu->agnes->ppu_log) {
+        if (sprite_zero_pending(ppu)) {
+            line_sprite_zero_hit(ppu, tile_row);
+        }
+    } else {
+        draw_line(ppu, tile_row, tile_at, first_at);
+    }
+
+    // The shift registers as the last fetches left them
+    ppu->bg_lo_shift = (last_lo << 8) | ppu->bg_lo;
+    ppu->bg_hi_shift = (last_hi << 8) | ppu->bg_hi;
+    ppu->at_shift = tile_at[32] * 0x5555;
+    ppu->at_latch = tile_at[33];
+}
+
+// render_line()'s pixels from the line's tiles and sprites
+static void draw_line(ppu_t *ppu, const uint16_t *tile_row, const uint8_t *tile_at, uint16_t first_at) {
+    const int y = ppu->scanline;
+    if (ppu->masks.show_sprites && ppu->sprite_line_y != ppu->scanline) {
+        build_sprite_line(ppu);
+    }
+
+    for (int x = 0; x < AGNES_SCREEN_WIDTH; x++) {
+        if (x < 8 && !ppu->masks.show_leftmost_bg && !ppu->masks.show_leftmost_sprites) {
+            set_pixel_color_ix(ppu, x, y, 63); // 63 is black in my default colour palette
+            continue;
+        }
+
+        uint8_t bg_color = 0;
+        if (ppu->masks.show_background && (x >= 8 || ppu->masks.show_leftmost_bg)) {
+            int p = x + ppu->regs.x;
+            uint8_t palette_ix = tile_row_pixel(tile_row, p);
+            if (palette_ix) {
+                uint8_t palette = p < 8 ? (first_at >> (14 - (p << 1))) & 0x3 : tile_at[p >> 3];
+                bg_color = (palette << 2) | palette_ix;
+            }
+        }
+        uint8_t sprite = 0;
+        if (ppu->masks.show_sprites && (x >= 8 || ppu->masks.show_leftmost_sprites)) {
+            sprite = ppu->sprite_line[x];
+        }
+        uint8_t sp_color_x = sprite & SPRITE_PIXEL_COLOR;
+
+        uint8_t color = 0;
+        if (bg_color && sp_color_x) {
+            if ((sprite & SPRITE_PIXEL_ZERO) && x != 255) {
+                ppu->status.sprite_zero_hit = true;
+            }
+            color = (sprite & SPRITE_PIXEL_BEHIND) ? bg_color : sp_color_x;
+        } else if (bg_color) {
+            color = bg_color;
+        } else if (sp_color_x) {
+            color = sp_color_x;
+        }
+        set_pixel_color_ix(ppu, x, y, ppu->palette[g_palette_addr_map[color]]);
+    }
+}
+
 #define GET_COARSE_X(v) ((v) & 0x1f)
 #define SET_COARSE_X(v, cx) do { v = (((v) & ~0x1f) | ((cx) & 0x1f)); } while (0)
 #define GET_COARSE_Y(v) (((v) >> 5) & 0x1f)
@@ -1216,17 +2076,16 @@ static void inc_vert_v(ppu_t *ppu) {
 
 static void eval_sprites(ppu_t *ppu) {
     ppu->sprite_ixs_count = 0;
+    ppu->sprite_line_y = -1;
     const sprite_t* sprites = (const sprite_t*)ppu->oam_data;
-    int sprite_height = ppu->ctrl.use_8x16_sprites ? 16 : 8;
+    const unsigned sprite_height = ppu->ctrl.use_8x16_sprites ? 16 : 8;
+    const unsigned scanline = (unsigned)ppu->scanline;
     for (int i = 0; i < 64; i++) {
         const sprite_t* sprite = &sprites[i];
 
-        if (sprite->y_pos > 0xef || sprite->x_pos > 0xff) {
-            continue;
-        }
-
-        int s_y = ppu->scanline - sprite->y_pos;
-        if (s_y < 0 || s_y >= sprite_height) {
+        // One unsigned compare for y_pos <= scanline < y_pos + height; y_pos
+        // past 0xef never matches a visible line
+        if (scanline - sprite->y_pos >= sprite_height || sprite->y_pos > 0xef) {
             continue;
         }
 
@@ -1244,9 +2103,15 @@ static void eval_sprites(ppu_t *ppu) {
 static void emit_pixel(ppu_t *ppu) {
     const int x = ppu->dot - 1;
     const int y = ppu->scanline;
+    const bool logging = ppu->agnes->ppu_log != NULL;
+    if (logging && !sprite_zero_pending(ppu)) {
+        return;
+    }
 
     if (x < 8 && !ppu->masks.show_leftmost_bg && !ppu->masks.show_leftmost_sprites) {
-        set_pixel_color_ix(ppu, x, y, 63); // 63 is black in my default colour palette
+        if (!logging) {
+            set_pixel_color_ix(ppu, x, y, 63); // 63 is black in my default colour palette
+        }
         return;
     }
 
@@ -1267,6 +2132,9 @@ static void emit_pixel(ppu_t *ppu) {
     } else if (!bg_color_addr && sp_color_addr) {
         color_addr = sp_color_addr;
     }
+    if (logging) {
+        return;
+    }
 
     uint8_t output_color_ix = ppu_read8(ppu, color_addr);
     set_pixel_color_ix(ppu, x, y, output_color_ix);
@@ -1295,27 +2163,42 @@ static uint16_t get_sprite_color_addr(ppu_t *ppu, int *out_sprite_ix, bool *out_
     *out_behind_bg = false;
 
     const int x = ppu->dot - 1;
-    const int y = ppu->scanline;
 
     if (!ppu->masks.show_sprites || (!ppu->masks.show_leftmost_sprites && x < 8)) {
         return 0;
     }
 
-    int sprite_height = ppu->ctrl.use_8x16_sprites ? 16 : 8;
-    uint16_t table = ppu->ctrl.sprite_table_addr;
+    if (ppu->sprite_line_y != ppu->scanline) {
+        build_sprite_line(ppu);
+    }
+    uint8_t sprite = ppu->sprite_line[x];
+    if (!sprite) {
+        return 0;
+    }
+    // Only sprite 0 matters to the caller, so any other index will do
+    *out_sprite_ix = (sprite & SPRITE_PIXEL_ZERO) ? 0 : 1;
+    *out_behind_bg = sprite & SPRITE_PIXEL_BEHIND;
+    return 0x3f00 | (sprite & SPRITE_PIXEL_COLOR);
+}
 
+// The line's sprite pixels as emit_pixel() and render_line() see them: the
+// first evaluated sprite that is opaque at x wins. Depends on PPUCTRL and
+// the pattern tables, so writes to either drop it; lines without rendering
+// evaluate no sprites, so it is also kept per scanline. Rows read from outside
+// the pattern tables (a sprite size change since evaluation) could change
+// under a write to PPU memory, so a line with one is rebuilt per pixel.
+static void build_sprite_line(ppu_t *ppu) {
+    memset(ppu->sprite_line, 0, sizeof(ppu->sprite_line));
+    bool cacheable = true;
+
+    const int y = ppu->scanline;
+    int sprite_height = ppu->ctrl.use_8x16_sprites ? 16 : 8;
     for (int i = 0; i < ppu->sprite_ixs_count; i++) {
         const sprite_t *sprite = &ppu->sprites[i];
-        int s_x = x - sprite->x_pos;
-        if (s_x < 0 || s_x >= 8) {
-            continue;
-        }
-
         int s_y = y - sprite->y_pos - 1;
-
-        s_x = AGNES_GET_BIT(sprite->attrs, 6) ? 7 - s_x : s_x; // flip hor
         s_y = AGNES_GET_BIT(sprite->attrs, 7) ? (sprite_height - 1 - s_y) : s_y; // flip vert
 
+        uint16_t table = ppu->ctrl.sprite_table_addr;
         uint8_t tile_num = sprite->tile_num;
         if (ppu->ctrl.use_8x16_sprites) {
             table = tile_num & 0x1 ? 0x1000 : 0x0000;
@@ -1326,29 +2209,32 @@ static uint16_t get_sprite_color_addr(ppu_t *ppu, int *out_sprite_ix, bool *out_
             }
         }
 
-        uint16_t offset = table + (tile_num << 4) + s_y;
-
-        uint8_t lo_byte = ppu_read8(ppu, offset);
-        uint8_t hi_byte = ppu_read8(ppu, offset + 8);
-
-        if (!lo_byte && !hi_byte) {
+        uint16_t addr = table + (tile_num << 4) + s_y;
+        if ((addr & 0x3fff) >= 0x2000 || ((addr + 8) & 0x3fff) >= 0x2000) {
+            cacheable = false;
+        }
+        uint16_t row = ppu_chr_row(ppu, addr);
+        if (!row) {
             continue;
         }
 
-        bool lo_bit = AGNES_GET_BIT(lo_byte, 7 - s_x);
-        bool hi_bit = AGNES_GET_BIT(hi_byte, 7 - s_x);
-
-        if (lo_bit || hi_bit) {
-            *out_sprite_ix = ppu->sprite_ixs[i];
-            if (AGNES_GET_BIT(sprite->attrs, 5)) {
-                *out_behind_bg = true;
+        bool flip = AGNES_GET_BIT(sprite->attrs, 6);
+        uint8_t flags = 0x10 | ((sprite->attrs & 0x3) << 2)
+                      | (ppu->sprite_ixs[i] == 0 ? SPRITE_PIXEL_ZERO : 0)
+                      | (AGNES_GET_BIT(sprite->attrs, 5) ? SPRITE_PIXEL_BEHIND : 0);
+        for (int s_x = 0; s_x < 8; s_x++) {
+            int x = sprite->x_pos + s_x;
+            if (x >= AGNES_SCREEN_WIDTH || ppu->sprite_line[x]) {
+                continue;
+            }
+            int bit = flip ? s_x : 7 - s_x;
+            uint8_t palette_ix = (row >> (bit << 1)) & 0x3;
+            if (palette_ix) {
+                ppu->sprite_line[x] = flags | palette_ix;
             }
-            uint8_t palette_ix = ((uint8_t)hi_bit << 1) | (uint8_t)lo_bit;
-            uint16_t color_address = 0x3f10 | ((sprite->attrs & 0x3) << 2) | palette_ix;
-            return color_address;
         }
     }
-    return 0;
+    ppu->sprite_line_y = cacheable ? y : -1;
 }
 
 uint8_t ppu_read_register(ppu_t *ppu, uint16_t addr) {
@@ -1393,6 +2279,7 @@ void ppu_write_register(ppu_t *ppu, uint16_t addr, uint8_t val) {
             ppu->ctrl.bg_table_addr = AGNES_GET_BIT(val, 4) ? 0x1000 : 0x0000;
             ppu->ctrl.use_8x16_sprites = AGNES_GET_BIT(val, 5);
             ppu->ctrl.nmi_enabled = AGNES_GET_BIT(val, 7);
+            ppu->sprite_line_y = -1;
 
             //    t: |_...|BA..| |....|....| = d: |....|..BA|
             ppu->regs.t = (ppu->regs.t & 0xf3ff) | ((val & 0x03) << 10);
@@ -1469,6 +2356,7 @@ void ppu_write_register(ppu_t *ppu, uint16_t addr, uint8_t val) {
 
 static void set_pixel_color_ix(ppu_t *ppu, int x, int y, uint8_t color_ix) {
     int ix = (y * AGNES_SCREEN_WIDTH) + x;
+    ppu->screen_changed |= ppu->screen_buffer[ix] != color_ix;
     ppu->screen_buffer[ix] = color_ix;
 }
 
@@ -1494,6 +2382,11 @@ static void ppu_write8(ppu_t *ppu, uint16_t addr, uint8_t val) {
         ppu->palette[palette_ix] = val;
     } else if (addr < 0x2000) { // $0000 - $1FFF
         mapper_write(ppu->agnes, addr, val);
+        // CHR RAM banks are 1KB-aligned, so any alias is the same tile of another window
+        for (unsigned tile = (addr >> 4) & 63; tile < 512; tile += 64) {
+            ppu->chr_valid[tile] = false;
+        }
+        ppu->sprite_line_y = -1;
     } else { // $2000 - $3EFF
         uint16_t mirrored_addr = mirror_address(ppu, addr);
         ppu->nametables[mirrored_addr] = val;
@@ -1579,275 +2472,347 @@ static int op_tya(cpu_t *cpu, uint16_t addr, addr_mode_t mode);
 
 static int take_branch(cpu_t *cpu, uint16_t addr);
 
-#define INS(OPC, NAME, CYCLES, PCC, OP, MODE) { NAME, OPC, CYCLES, PCC, MODE, OP }
-#define INE(OPC) { "ILL", OPC, 1, false, ADDR_MODE_IMPLIED, NULL }
-
-static instruction_t instructions[256] = {
-    INS(0x00, "BRK", 7, false, op_brk, ADDR_MODE_IMPLIED_BRK),
-    INS(0x01, "ORA", 6, false, op_ora, ADDR_MODE_INDIRECT_X),
-    INE(0x02),
-    INE(0x03),
-    INE(0x04),
-    INS(0x05, "ORA", 3, false, op_ora, ADDR_MODE_ZERO_PAGE),
-    INS(0x06, "ASL", 5, false, op_asl, ADDR_MODE_ZERO_PAGE),
-    INE(0x07),
-    INS(0x08, "PHP", 3, false, op_php, ADDR_MODE_IMPLIED),
-    INS(0x09, "ORA", 2, false, op_ora, ADDR_MODE_IMMEDIATE),
-    INS(0x0a, "ASL", 2, false, op_asl, ADDR_MODE_ACCUMULATOR),
-    INE(0x0b),
-    INE(0x0c),
-    INS(0x0d, "ORA", 4, false, op_ora, ADDR_MODE_ABSOLUTE),
-    INS(0x0e, "ASL", 6, false, op_asl, ADDR_MODE_ABSOLUTE),
-    INE(0x0f),
-    INS(0x10, "BPL", 2, true,  op_bpl, ADDR_MODE_RELATIVE),
-    INS(0x11, "ORA", 5, true,  op_ora, ADDR_MODE_INDIRECT_Y),
-    INE(0x12),
-    INE(0x13),
-    INE(0x14),
-    INS(0x15, "ORA", 4, false, op_ora, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x16, "ASL", 6, false, op_asl, ADDR_MODE_ZERO_PAGE_X),
-    INE(0x17),
-    INS(0x18, "CLC", 2, false, op_clc, ADDR_MODE_IMPLIED),
-    INS(0x19, "ORA", 4, true,  op_ora, ADDR_MODE_ABSOLUTE_Y),
-    INE(0x1a),
-    INE(0x1b),
-    INE(0x1c),
-    INS(0x1d, "ORA", 4, true,  op_ora, ADDR_MODE_ABSOLUTE_X),
-    INS(0x1e, "ASL", 7, false, op_asl, ADDR_MODE_ABSOLUTE_X),
-    INE(0x1f),
-    INS(0x20, "JSR", 6, false, op_jsr, ADDR_MODE_ABSOLUTE),
-    INS(0x21, "AND", 6, false, op_and, ADDR_MODE_INDIRECT_X),
-    INE(0x22),
-    INE(0x23),
-    INS(0x24, "BIT", 3, false, op_bit, ADDR_MODE_ZERO_PAGE),
-    INS(0x25, "AND", 3, false, op_and, ADDR_MODE_ZERO_PAGE),
-    INS(0x26, "ROL", 5, false, op_rol, ADDR_MODE_ZERO_PAGE),
-    INE(0x27),
-    INS(0x28, "PLP", 4, false, op_plp, ADDR_MODE_IMPLIED),
-    INS(0x29, "AND", 2, false, op_and, ADDR_MODE_IMMEDIATE),
-    INS(0x2a, "ROL", 2, false, op_rol, ADDR_MODE_ACCUMULATOR),
-    INE(0x2b),
-    INS(0x2c, "BIT", 4, false, op_bit, ADDR_MODE_ABSOLUTE),
-    INS(0x2d, "AND", 4, false, op_and, ADDR_MODE_ABSOLUTE),
-    INS(0x2e, "ROL", 6, false, op_rol, ADDR_MODE_ABSOLUTE),
-    INE(0x2f),
-    INS(0x30, "BMI", 2, true,  op_bmi, ADDR_MODE_RELATIVE),
-    INS(0x31, "AND", 5, true,  op_and, ADDR_MODE_INDIRECT_Y),
-    INE(0x32),
-    INE(0x33),
-    INE(0x34),
-    INS(0x35, "AND", 4, false, op_and, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x36, "ROL", 6, false, op_rol, ADDR_MODE_ZERO_PAGE_X),
-    INE(0x37),
-    INS(0x38, "SEC", 2, false, op_sec, ADDR_MODE_IMPLIED),
-    INS(0x39, "AND", 4, true,  op_and, ADDR_MODE_ABSOLUTE_Y),
-    INE(0x3a),
-    INE(0x3b),
-    INE(0x3c),
-    INS(0x3d, "AND", 4, true,  op_and, ADDR_MODE_ABSOLUTE_X),
-    INS(0x3e, "ROL", 7, false, op_rol, ADDR_MODE_ABSOLUTE_X),
-    INE(0x3f),
-    INS(0x40, "RTI", 6, false, op_rti, ADDR_MODE_IMPLIED),
-    INS(0x41, "EOR", 6, false, op_eor, ADDR_MODE_INDIRECT_X),
-    INE(0x42),
-    INE(0x43),
-    INE(0x44),
-    INS(0x45, "EOR", 3, false, op_eor, ADDR_MODE_ZERO_PAGE),
-    INS(0x46, "LSR", 5, false, op_lsr, ADDR_MODE_ZERO_PAGE),
-    INE(0x47),
-    INS(0x48, "PHA", 3, false, op_pha, ADDR_MODE_IMPLIED),
-    INS(0x49, "EOR", 2, false, op_eor, ADDR_MODE_IMMEDIATE),
-    INS(0x4a, "LSR", 2, false, op_lsr, ADDR_MODE_ACCUMULATOR),
-    INE(0x4b),
-    INS(0x4c, "JMP", 3, false, op_jmp, ADDR_MODE_ABSOLUTE),
-    INS(0x4d, "EOR", 4, false, op_eor, ADDR_MODE_ABSOLUTE),
-    INS(0x4e, "LSR", 6, false, op_lsr, ADDR_MODE_ABSOLUTE),
-    INE(0x4f),
-    INS(0x50, "BVC", 2, true,  op_bvc, ADDR_MODE_RELATIVE),
-    INS(0x51, "EOR", 5, true,  op_eor, ADDR_MODE_INDIRECT_Y),
-    INE(0x52),
-    INE(0x53),
-    INE(0x54),
-    INS(0x55, "EOR", 4, false, op_eor, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x56, "LSR", 6, false, op_lsr, ADDR_MODE_ZERO_PAGE_X),
-    INE(0x57),
-    INS(0x58, "CLI", 2, false, op_cli, ADDR_MODE_IMPLIED),
-    INS(0x59, "EOR", 4, true,  op_eor, ADDR_MODE_ABSOLUTE_Y),
-    INE(0x5a),
-    INE(0x5b),
-    INE(0x5c),
-    INS(0x5d, "EOR", 4, true,  op_eor, ADDR_MODE_ABSOLUTE_X),
-    INS(0x5e, "LSR", 7, false, op_lsr, ADDR_MODE_ABSOLUTE_X),
-    INE(0x5f),
-    INS(0x60, "RTS", 6, false, op_rts, ADDR_MODE_IMPLIED),
-    INS(0x61, "ADC", 6, false, op_adc, ADDR_MODE_INDIRECT_X),
-    INE(0x62),
-    INE(0x63),
-    INE(0x64),
-    INS(0x65, "ADC", 3, false, op_adc, ADDR_MODE_ZERO_PAGE),
-    INS(0x66, "ROR", 5, false, op_ror, ADDR_MODE_ZERO_PAGE),
-    INE(0x67),
-    INS(0x68, "PLA", 4, false, op_pla, ADDR_MODE_IMPLIED),
-    INS(0x69, "ADC", 2, false, op_adc, ADDR_MODE_IMMEDIATE),
-    INS(0x6a, "ROR", 2, false, op_ror, ADDR_MODE_ACCUMULATOR),
-    INE(0x6b),
-    INS(0x6c, "JMP", 5, false, op_jmp, ADDR_MODE_INDIRECT),
-    INS(0x6d, "ADC", 4, false,  op_adc, ADDR_MODE_ABSOLUTE),
-    INS(0x6e, "ROR", 6, false, op_ror, ADDR_MODE_ABSOLUTE),
-    INE(0x6f),
-    INS(0x70, "BVS", 2, true,  op_bvs, ADDR_MODE_RELATIVE),
-    INS(0x71, "ADC", 5, true,  op_adc, ADDR_MODE_INDIRECT_Y),
-    INE(0x72),
-    INE(0x73),
-    INE(0x74),
-    INS(0x75, "ADC", 4, false, op_adc, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x76, "ROR", 6, false, op_ror, ADDR_MODE_ZERO_PAGE_X),
-    INE(0x77),
-    INS(0x78, "SEI", 2, false, op_sei, ADDR_MODE_IMPLIED),
-    INS(0x79, "ADC", 4, true,  op_adc, ADDR_MODE_ABSOLUTE_Y),
-    INE(0x7a),
-    INE(0x7b),
-    INE(0x7c),
-    INS(0x7d, "ADC", 4, true,  op_adc, ADDR_MODE_ABSOLUTE_X),
-    INS(0x7e, "ROR", 7, false, op_ror, ADDR_MODE_ABSOLUTE_X),
-    INE(0x7f),
-    INE(0x80),
-    INS(0x81, "STA", 6, false, op_sta, ADDR_MODE_INDIRECT_X),
-    INE(0x82),
-    INE(0x83),
-    INS(0x84, "STY", 3, false, op_sty, ADDR_MODE_ZERO_PAGE),
-    INS(0x85, "STA", 3, false, op_sta, ADDR_MODE_ZERO_PAGE),
-    INS(0x86, "STX", 3, false, op_stx, ADDR_MODE_ZERO_PAGE),
-    INE(0x87),
-    INS(0x88, "DEY", 2, false, op_dey, ADDR_MODE_IMPLIED),
-    INE(0x89),
-    INS(0x8a, "TXA", 2, false, op_txa, ADDR_MODE_IMPLIED),
-    INE(0x8b),
-    INS(0x8c, "STY", 4, false, op_sty, ADDR_MODE_ABSOLUTE),
-    INS(0x8d, "STA", 4, false, op_sta, ADDR_MODE_ABSOLUTE),
-    INS(0x8e, "STX", 4, false, op_stx, ADDR_MODE_ABSOLUTE),
-    INE(0x8f),
-    INS(0x90, "BCC", 2, true,  op_bcc, ADDR_MODE_RELATIVE),
-    INS(0x91, "STA", 6, false, op_sta, ADDR_MODE_INDIRECT_Y),
-    INE(0x92),
-    INE(0x93),
-    INS(0x94, "STY", 4, false, op_sty, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x95, "STA", 4, false, op_sta, ADDR_MODE_ZERO_PAGE_X),
-    INS(0x96, "STX", 4, false, op_stx, ADDR_MODE_ZERO_PAGE_Y),
-    INE(0x97),
-    INS(0x98, "TYA", 2, false, op_tya, ADDR_MODE_IMPLIED),
-    INS(0x99, "STA", 5, false, op_sta, ADDR_MODE_ABSOLUTE_Y),
-    INS(0x9a, "TXS", 2, false, op_txs, ADDR_MODE_IMPLIED),
-    INE(0x9b),
-    INE(0x9c),
-    INS(0x9d, "STA", 5, false, op_sta, ADDR_MODE_ABSOLUTE_X),
-    INE(0x9e),
-    INE(0x9f),
-    INS(0xa0, "LDY", 2, false, op_ldy, ADDR_MODE_IMMEDIATE),
-    INS(0xa1, "LDA", 6, false, op_lda, ADDR_MODE_INDIRECT_X),
-    INS(0xa2, "LDX", 2, false, op_ldx, ADDR_MODE_IMMEDIATE),
-    INE(0xa3),
-    INS(0xa4, "LDY", 3, false, op_ldy, ADDR_MODE_ZERO_PAGE),
-    INS(0xa5, "LDA", 3, false, op_lda, ADDR_MODE_ZERO_PAGE),
-    INS(0xa6, "LDX", 3, false, op_ldx, ADDR_MODE_ZERO_PAGE),
-    INE(0xa7),
-    INS(0xa8, "TAY", 2, false, op_tay, ADDR_MODE_IMPLIED),
-    INS(0xa9, "LDA", 2, false, op_lda, ADDR_MODE_IMMEDIATE),
-    INS(0xaa, "TAX", 2, false, op_tax, ADDR_MODE_IMPLIED),
-    INE(0xab),
-    INS(0xac, "LDY", 4, false, op_ldy, ADDR_MODE_ABSOLUTE),
-    INS(0xad, "LDA", 4, false, op_lda, ADDR_MODE_ABSOLUTE),
-    INS(0xae, "LDX", 4, false, op_ldx, ADDR_MODE_ABSOLUTE),
-    INE(0xaf),
-    INS(0xb0, "BCS", 2, true,  op_bcs, ADDR_MODE_RELATIVE),
-    INS(0xb1, "LDA", 5, true,  op_lda, ADDR_MODE_INDIRECT_Y),
-    INE(0xb2),
-    INE(0xb3),
-    INS(0xb4, "LDY", 4, false, op_ldy, ADDR_MODE_ZERO_PAGE_X),
-    INS(0xb5, "LDA", 4, false, op_lda, ADDR_MODE_ZERO_PAGE_X),
-    INS(0xb6, "LDX", 4, false, op_ldx, ADDR_MODE_ZERO_PAGE_Y),
-    INE(0xb7),
-    INS(0xb8, "CLV", 2, false, op_clv, ADDR_MODE_IMPLIED),
-    INS(0xb9, "LDA", 4, true,  op_lda, ADDR_MODE_ABSOLUTE_Y),
-    INS(0xba, "TSX", 2, false, op_tsx, ADDR_MODE_IMPLIED),
-    INE(0xbb),
-    INS(0xbc, "LDY", 4, true,  op_ldy, ADDR_MODE_ABSOLUTE_X),
-    INS(0xbd, "LDA", 4, true,  op_lda, ADDR_MODE_ABSOLUTE_X),
-    INS(0xbe, "LDX", 4, true,  op_ldx, ADDR_MODE_ABSOLUTE_Y),
-    INE(0xbf),
-    INS(0xc0, "CPY", 2, false, op_cpy, ADDR_MODE_IMMEDIATE),
-    INS(0xc1, "CMP", 6, false, op_cmp, ADDR_MODE_INDIRECT_X),
-    INE(0xc2),
-    INE(0xc3),
-    INS(0xc4, "CPY", 3, false, op_cpy, ADDR_MODE_ZERO_PAGE),
-    INS(0xc5, "CMP", 3, false, op_cmp, ADDR_MODE_ZERO_PAGE),
-    INS(0xc6, "DEC", 5, false, op_dec, ADDR_MODE_ZERO_PAGE),
-    INE(0xc7),
-    INS(0xc8, "INY", 2, false, op_iny, ADDR_MODE_IMPLIED),
-    INS(0xc9, "CMP", 2, false, op_cmp, ADDR_MODE_IMMEDIATE),
-    INS(0xca, "DEX", 2, false, op_dex, ADDR_MODE_IMPLIED),
-    INE(0xcb),
-    INS(0xcc, "CPY", 4, false, op_cpy, ADDR_MODE_ABSOLUTE),
-    INS(0xcd, "CMP", 4, false, op_cmp, ADDR_MODE_ABSOLUTE),
-    INS(0xce, "DEC", 6, false, op_dec, ADDR_MODE_ABSOLUTE),
-    INE(0xcf),
-    INS(0xd0, "BNE", 2, true,  op_bne, ADDR_MODE_RELATIVE),
-    INS(0xd1, "CMP", 5, true,  op_cmp, ADDR_MODE_INDIRECT_Y),
-    INE(0xd2),
-    INE(0xd3),
-    INE(0xd4),
-    INS(0xd5, "CMP", 4, false, op_cmp, ADDR_MODE_ZERO_PAGE_X),
-    INS(0xd6, "DEC", 6, false, op_dec, ADDR_MODE_ZERO_PAGE_X),
-    INE(0xd7),
-    INS(0xd8, "CLD", 2, false, op_cld, ADDR_MODE_IMPLIED),
-    INS(0xd9, "CMP", 4, true,  op_cmp, ADDR_MODE_ABSOLUTE_Y),
-    INE(0xda),
-    INE(0xdb),
-    INE(0xdc),
-    INS(0xdd, "CMP", 4, true,  op_cmp, ADDR_MODE_ABSOLUTE_X),
-    INS(0xde, "DEC", 7, false, op_dec, ADDR_MODE_ABSOLUTE_X),
-    INE(0xdf),
-    INS(0xe0, "CPX", 2, false, op_cpx, ADDR_MODE_IMMEDIATE),
-    INS(0xe1, "SBC", 6, false, op_sbc, ADDR_MODE_INDIRECT_X),
-    INE(0xe2),
-    INE(0xe3),
-    INS(0xe4, "CPX", 3, false, op_cpx, ADDR_MODE_ZERO_PAGE),
-    INS(0xe5, "SBC", 3, false, op_sbc, ADDR_MODE_ZERO_PAGE),
-    INS(0xe6, "INC", 5, false, op_inc, ADDR_MODE_ZERO_PAGE),
-    INE(0xe7),
-    INS(0xe8, "INX", 2, false, op_inx, ADDR_MODE_IMPLIED),
-    INS(0xe9, "SBC", 2, false, op_sbc, ADDR_MODE_IMMEDIATE),
-    INS(0xea, "NOP", 2, false, op_nop, ADDR_MODE_IMPLIED),
-    INE(0xeb),
-    INS(0xec, "CPX", 4, false, op_cpx, ADDR_MODE_ABSOLUTE),
-    INS(0xed, "SBC", 4, false, op_sbc, ADDR_MODE_ABSOLUTE),
-    INS(0xee, "INC", 6, false, op_inc, ADDR_MODE_ABSOLUTE),
-    INE(0xef),
-    INS(0xf0, "BEQ", 2, true,  op_beq, ADDR_MODE_RELATIVE),
-    INS(0xf1, "SBC", 5, true,  op_sbc, ADDR_MODE_INDIRECT_Y),
-    INE(0xf2),
-    INE(0xf3),
-    INE(0xf4),
-    INS(0xf5, "SBC", 4, false, op_sbc, ADDR_MODE_ZERO_PAGE_X),
-    INS(0xf6, "INC", 6, false, op_inc, ADDR_MODE_ZERO_PAGE_X),
-    INE(0xf7),
-    INS(0xf8, "SED", 2, false, op_sed, ADDR_MODE_IMPLIED),
-    INS(0xf9, "SBC", 4, true,  op_sbc, ADDR_MODE_ABSOLUTE_Y),
-    INE(0xfa),
-    INE(0xfb),
-    INE(0xfc),
-    INS(0xfd, "SBC", 4, true,  op_sbc, ADDR_MODE_ABSOLUTE_X),
-    INS(0xfe, "INC", 7, false, op_inc, ADDR_MODE_ABSOLUTE_X),
-    INE(0xff),
-};
+AGNES_FORCE_INLINE bool pages_differ(uint16_t a, uint16_t b) {
+    return (0xff00 & a) != (0xff00 & b);
+}
 
-#undef INE
-#undef INS
+AGNES_FORCE_INLINE uint16_t cpu_read16_indirect_bug(cpu_t *cpu, uint16_t addr) {
+    uint8_t lo = cpu_read8(cpu, addr);
+    uint8_t hi = cpu_read8(cpu, (addr & 0xff00) | ((addr + 1) & 0x00ff));
+    return (hi << 8) | lo;
+}
 
-instruction_t* instruction_get(uint8_t opc) {
-    return &instructions[opc];
+AGNES_FORCE_INLINE uint8_t operand_read8(cpu_t *cpu, const uint8_t *operand) {
+    return operand ? operand[0] : cpu_read8(cpu, cpu->pc + 1);
 }
 
+AGNES_FORCE_INLINE uint16_t operand_read16(cpu_t *cpu, const uint8_t *operand) {
+    return operand ? (uint16_t)(operand[0] | (operand[1] << 8)) : cpu_read16(cpu, cpu->pc + 1);
+}
+
+// Inlined into every opcode's case in instruction_execute(), where mode is
+// a constant and all but one case folds away
+AGNES_FORCE_INLINE uint16_t get_instruction_operand(cpu_t *cpu, addr_mode_t mode, const uint8_t *operand,
+                                                    bool *out_pages_differ) {
+    *out_pages_differ = false;
+    switch (mode) {
+        case ADDR_MODE_ABSOLUTE: {
+            return operand_read16(cpu, operand);
+        }
+        case ADDR_MODE_ABSOLUTE_X: {
+            uint16_t addr = operand_read16(cpu, operand);
+            uint16_t res = addr + cpu->x;
+            *out_pages_differ = pages_differ(addr, res);
+            return res;
+        }
+        case ADDR_MODE_ABSOLUTE_Y: {
+            uint16_t addr = operand_read16(cpu, operand);
+            uint16_t res = addr + cpu->y;
+            *out_pages_differ = pages_differ(addr, res);
+            return res;
+        }
+        case ADDR_MODE_IMMEDIATE: {
+            return cpu->pc + 1;
+        }
+        case ADDR_MODE_INDIRECT: {
+            uint16_t addr = operand_read16(cpu, operand);
+            return cpu_read16_indirect_bug(cpu, addr);
+        }
+        case ADDR_MODE_INDIRECT_X: {
+            uint8_t addr = operand_read8(cpu, operand);
+            return cpu_read16_indirect_bug(cpu, (addr + cpu->x) & 0xff);
+        }
+        case ADDR_MODE_INDIRECT_Y: {
+            uint8_t arg = operand_read8(cpu, operand);
+            uint16_t addr2 = cpu_read16_indirect_bug(cpu, arg);
+            uint16_t res = addr2 + cpu->y;
+            *out_pages_differ = pages_differ(addr2, res);
+            return res;
+        }
+        case ADDR_MODE_ZERO_PAGE: {
+            return operand_read8(cpu, operand);
+        }
+        case ADDR_MODE_ZERO_PAGE_X: {
+            return (operand_read8(cpu, operand) + cpu->x) & 0xff;
+        }
+        case ADDR_MODE_ZERO_PAGE_Y: {
+            return (operand_read8(cpu, operand) + cpu->y) & 0xff;
+        }
+        case ADDR_MODE_RELATIVE: {
+            uint8_t addr = operand_read8(cpu, operand);
+            if (addr < 0x80) {
+                return cpu->pc + addr + 2;
+            } else {
+                return cpu->pc + addr + 2 - 0x100;
+            }
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+// Every opcode, as INS(opcode, name, cycles, page cross cycle, operation,
+// addressing mode) or INE(opcode) for the illegal ones; expanded into the
+// switch in instruction_execute()
+#define INSTRUCTIONS(INS, INE) \
+    INS(0x00, "BRK", 7, false, op_brk, ADDR_MODE_IMPLIED_BRK) \
+    INS(0x01, "ORA", 6, false, op_ora, ADDR_MODE_INDIRECT_X) \
+    INE(0x02) \
+    INE(0x03) \
+    INE(0x04) \
+    INS(0x05, "ORA", 3, false, op_ora, ADDR_MODE_ZERO_PAGE) \
+    INS(0x06, "ASL", 5, false, op_asl, ADDR_MODE_ZERO_PAGE) \
+    INE(0x07) \
+    INS(0x08, "PHP", 3, false, op_php, ADDR_MODE_IMPLIED) \
+    INS(0x09, "ORA", 2, false, op_ora, ADDR_MODE_IMMEDIATE) \
+    INS(0x0a, "ASL", 2, false, op_asl, ADDR_MODE_ACCUMULATOR) \
+    INE(0x0b) \
+    INE(0x0c) \
+    INS(0x0d, "ORA", 4, false, op_ora, ADDR_MODE_ABSOLUTE) \
+    INS(0x0e, "ASL", 6, false, op_asl, ADDR_MODE_ABSOLUTE) \
+    INE(0x0f) \
+    INS(0x10, "BPL", 2, true,  op_bpl, ADDR_MODE_RELATIVE) \
+    INS(0x11, "ORA", 5, true,  op_ora, ADDR_MODE_INDIRECT_Y) \
+    INE(0x12) \
+    INE(0x13) \
+    INE(0x14) \
+    INS(0x15, "ORA", 4, false, op_ora, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x16, "ASL", 6, false, op_asl, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0x17) \
+    INS(0x18, "CLC", 2, false, op_clc, ADDR_MODE_IMPLIED) \
+    INS(0x19, "ORA", 4, true,  op_ora, ADDR_MODE_ABSOLUTE_Y) \
+    INE(0x1a) \
+    INE(0x1b) \
+    INE(0x1c) \
+    INS(0x1d, "ORA", 4, true,  op_ora, ADDR_MODE_ABSOLUTE_X) \
+    INS(0x1e, "ASL", 7, false, op_asl, ADDR_MODE_ABSOLUTE_X) \
+    INE(0x1f) \
+    INS(0x20, "JSR", 6, false, op_jsr, ADDR_MODE_ABSOLUTE) \
+    INS(0x21, "AND", 6, false, op_and, ADDR_MODE_INDIRECT_X) \
+    INE(0x22) \
+    INE(0x23) \
+    INS(0x24, "BIT", 3, false, op_bit, ADDR_MODE_ZERO_PAGE) \
+    INS(0x25, "AND", 3, false, op_and, ADDR_MODE_ZERO_PAGE) \
+    INS(0x26, "ROL", 5, false, op_rol, ADDR_MODE_ZERO_PAGE) \
+    INE(0x27) \
+    INS(0x28, "PLP", 4, false, op_plp, ADDR_MODE_IMPLIED) \
+    INS(0x29, "AND", 2, false, op_and, ADDR_MODE_IMMEDIATE) \
+    INS(0x2a, "ROL", 2, false, op_rol, ADDR_MODE_ACCUMULATOR) \
+    INE(0x2b) \
+    INS(0x2c, "BIT", 4, false, op_bit, ADDR_MODE_ABSOLUTE) \
+    INS(0x2d, "AND", 4, false, op_and, ADDR_MODE_ABSOLUTE) \
+    INS(0x2e, "ROL", 6, false, op_rol, ADDR_MODE_ABSOLUTE) \
+    INE(0x2f) \
+    INS(0x30, "BMI", 2, true,  op_bmi, ADDR_MODE_RELATIVE) \
+    INS(0x31, "AND", 5, true,  op_and, ADDR_MODE_INDIRECT_Y) \
+    INE(0x32) \
+    INE(0x33) \
+    INE(0x34) \
+    INS(0x35, "AND", 4, false, op_and, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x36, "ROL", 6, false, op_rol, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0x37) \
+    INS(0x38, "SEC", 2, false, op_sec, ADDR_MODE_IMPLIED) \
+    INS(0x39, "AND", 4, true,  op_and, ADDR_MODE_ABSOLUTE_Y) \
+    INE(0x3a) \
+    INE(0x3b) \
+    INE(0x3c) \
+    INS(0x3d, "AND", 4, true,  op_and, ADDR_MODE_ABSOLUTE_X) \
+    INS(0x3e, "ROL", 7, false, op_rol, ADDR_MODE_ABSOLUTE_X) \
+    INE(0x3f) \
+    INS(0x40, "RTI", 6, false, op_rti, ADDR_MODE_IMPLIED) \
+    INS(0x41, "EOR", 6, false, op_eor, ADDR_MODE_INDIRECT_X) \
+    INE(0x42) \
+    INE(0x43) \
+    INE(0x44) \
+    INS(0x45, "EOR", 3, false, op_eor, ADDR_MODE_ZERO_PAGE) \
+    INS(0x46, "LSR", 5, false, op_lsr, ADDR_MODE_ZERO_PAGE) \
+    INE(0x47) \
+    INS(0x48, "PHA", 3, false, op_pha, ADDR_MODE_IMPLIED) \
+    INS(0x49, "EOR", 2, false, op_eor, ADDR_MODE_IMMEDIATE) \
+    INS(0x4a, "LSR", 2, false, op_lsr, ADDR_MODE_ACCUMULATOR) \
+    INE(0x4b) \
+    INS(0x4c, "JMP", 3, false, op_jmp, ADDR_MODE_ABSOLUTE) \
+    INS(0x4d, "EOR", 4, false, op_eor, ADDR_MODE_ABSOLUTE) \
+    INS(0x4e, "LSR", 6, false, op_lsr, ADDR_MODE_ABSOLUTE) \
+    INE(0x4f) \
+    INS(0x50, "BVC", 2, true,  op_bvc, ADDR_MODE_RELATIVE) \
+    INS(0x51, "EOR", 5, true,  op_eor, ADDR_MODE_INDIRECT_Y) \
+    INE(0x52) \
+    INE(0x53) \
+    INE(0x54) \
+    INS(0x55, "EOR", 4, false, op_eor, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x56, "LSR", 6, false, op_lsr, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0x57) \
+    INS(0x58, "CLI", 2, false, op_cli, ADDR_MODE_IMPLIED) \
+    INS(0x59, "EOR", 4, true,  op_eor, ADDR_MODE_ABSOLUTE_Y) \
+    INE(0x5a) \
+    INE(0x5b) \
+    INE(0x5c) \
+    INS(0x5d, "EOR", 4, true,  op_eor, ADDR_MODE_ABSOLUTE_X) \
+    INS(0x5e, "LSR", 7, false, op_lsr, ADDR_MODE_ABSOLUTE_X) \
+    INE(0x5f) \
+    INS(0x60, "RTS", 6, false, op_rts, ADDR_MODE_IMPLIED) \
+    INS(0x61, "ADC", 6, false, op_adc, ADDR_MODE_INDIRECT_X) \
+    INE(0x62) \
+    INE(0x63) \
+    INE(0x64) \
+    INS(0x65, "ADC", 3, false, op_adc, ADDR_MODE_ZERO_PAGE) \
+    INS(0x66, "ROR", 5, false, op_ror, ADDR_MODE_ZERO_PAGE) \
+    INE(0x67) \
+    INS(0x68, "PLA", 4, false, op_pla, ADDR_MODE_IMPLIED) \
+    INS(0x69, "ADC", 2, false, op_adc, ADDR_MODE_IMMEDIATE) \
+    INS(0x6a, "ROR", 2, false, op_ror, ADDR_MODE_ACCUMULATOR) \
+    INE(0x6b) \
+    INS(0x6c, "JMP", 5, false, op_jmp, ADDR_MODE_INDIRECT) \
+    INS(0x6d, "ADC", 4, false,  op_adc, ADDR_MODE_ABSOLUTE) \
+    INS(0x6e, "ROR", 6, false, op_ror, ADDR_MODE_ABSOLUTE) \
+    INE(0x6f) \
+    INS(0x70, "BVS", 2, true,  op_bvs, ADDR_MODE_RELATIVE) \
+    INS(0x71, "ADC", 5, true,  op_adc, ADDR_MODE_INDIRECT_Y) \
+    INE(0x72) \
+    INE(0x73) \
+    INE(0x74) \
+    INS(0x75, "ADC", 4, false, op_adc, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x76, "ROR", 6, false, op_ror, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0x77) \
+    INS(0x78, "SEI", 2, false, op_sei, ADDR_MODE_IMPLIED) \
+    INS(0x79, "ADC", 4, true,  op_adc, ADDR_MODE_ABSOLUTE_Y) \
+    INE(0x7a) \
+    INE(0x7b) \
+    INE(0x7c) \
+    INS(0x7d, "ADC", 4, true,  op_adc, ADDR_MODE_ABSOLUTE_X) \
+    INS(0x7e, "ROR", 7, false, op_ror, ADDR_MODE_ABSOLUTE_X) \
+    INE(0x7f) \
+    INE(0x80) \
+    INS(0x81, "STA", 6, false, op_sta, ADDR_MODE_INDIRECT_X) \
+    INE(0x82) \
+    INE(0x83) \
+    INS(0x84, "STY", 3, false, op_sty, ADDR_MODE_ZERO_PAGE) \
+    INS(0x85, "STA", 3, false, op_sta, ADDR_MODE_ZERO_PAGE) \
+    INS(0x86, "STX", 3, false, op_stx, ADDR_MODE_ZERO_PAGE) \
+    INE(0x87) \
+    INS(0x88, "DEY", 2, false, op_dey, ADDR_MODE_IMPLIED) \
+    INE(0x89) \
+    INS(0x8a, "TXA", 2, false, op_txa, ADDR_MODE_IMPLIED) \
+    INE(0x8b) \
+    INS(0x8c, "STY", 4, false, op_sty, ADDR_MODE_ABSOLUTE) \
+    INS(0x8d, "STA", 4, false, op_sta, ADDR_MODE_ABSOLUTE) \
+    INS(0x8e, "STX", 4, false, op_stx, ADDR_MODE_ABSOLUTE) \
+    INE(0x8f) \
+    INS(0x90, "BCC", 2, true,  op_bcc, ADDR_MODE_RELATIVE) \
+    INS(0x91, "STA", 6, false, op_sta, ADDR_MODE_INDIRECT_Y) \
+    INE(0x92) \
+    INE(0x93) \
+    INS(0x94, "STY", 4, false, op_sty, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x95, "STA", 4, false, op_sta, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0x96, "STX", 4, false, op_stx, ADDR_MODE_ZERO_PAGE_Y) \
+    INE(0x97) \
+    INS(0x98, "TYA", 2, false, op_tya, ADDR_MODE_IMPLIED) \
+    INS(0x99, "STA", 5, false, op_sta, ADDR_MODE_ABSOLUTE_Y) \
+    INS(0x9a, "TXS", 2, false, op_txs, ADDR_MODE_IMPLIED) \
+    INE(0x9b) \
+    INE(0x9c) \
+    INS(0x9d, "STA", 5, false, op_sta, ADDR_MODE_ABSOLUTE_X) \
+    INE(0x9e) \
+    INE(0x9f) \
+    INS(0xa0, "LDY", 2, false, op_ldy, ADDR_MODE_IMMEDIATE) \
+    INS(0xa1, "LDA", 6, false, op_lda, ADDR_MODE_INDIRECT_X) \
+    INS(0xa2, "LDX", 2, false, op_ldx, ADDR_MODE_IMMEDIATE) \
+    INE(0xa3) \
+    INS(0xa4, "LDY", 3, false, op_ldy, ADDR_MODE_ZERO_PAGE) \
+    INS(0xa5, "LDA", 3, false, op_lda, ADDR_MODE_ZERO_PAGE) \
+    INS(0xa6, "LDX", 3, false, op_ldx, ADDR_MODE_ZERO_PAGE) \
+    INE(0xa7) \
+    INS(0xa8, "TAY", 2, false, op_tay, ADDR_MODE_IMPLIED) \
+    INS(0xa9, "LDA", 2, false, op_lda, ADDR_MODE_IMMEDIATE) \
+    INS(0xaa, "TAX", 2, false, op_tax, ADDR_MODE_IMPLIED) \
+    INE(0xab) \
+    INS(0xac, "LDY", 4, false, op_ldy, ADDR_MODE_ABSOLUTE) \
+    INS(0xad, "LDA", 4, false, op_lda, ADDR_MODE_ABSOLUTE) \
+    INS(0xae, "LDX", 4, false, op_ldx, ADDR_MODE_ABSOLUTE) \
+    INE(0xaf) \
+    INS(0xb0, "BCS", 2, true,  op_bcs, ADDR_MODE_RELATIVE) \
+    INS(0xb1, "LDA", 5, true,  op_lda, ADDR_MODE_INDIRECT_Y) \
+    INE(0xb2) \
+    INE(0xb3) \
+    INS(0xb4, "LDY", 4, false, op_ldy, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0xb5, "LDA", 4, false, op_lda, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0xb6, "LDX", 4, false, op_ldx, ADDR_MODE_ZERO_PAGE_Y) \
+    INE(0xb7) \
+    INS(0xb8, "CLV", 2, false, op_clv, ADDR_MODE_IMPLIED) \
+    INS(0xb9, "LDA", 4, true,  op_lda, ADDR_MODE_ABSOLUTE_Y) \
+    INS(0xba, "TSX", 2, false, op_tsx, ADDR_MODE_IMPLIED) \
+    INE(0xbb) \
+    INS(0xbc, "LDY", 4, true,  op_ldy, ADDR_MODE_ABSOLUTE_X) \
+    INS(0xbd, "LDA", 4, true,  op_lda, ADDR_MODE_ABSOLUTE_X) \
+    INS(0xbe, "LDX", 4, true,  op_ldx, ADDR_MODE_ABSOLUTE_Y) \
+    INE(0xbf) \
+    INS(0xc0, "CPY", 2, false, op_cpy, ADDR_MODE_IMMEDIATE) \
+    INS(0xc1, "CMP", 6, false, op_cmp, ADDR_MODE_INDIRECT_X) \
+    INE(0xc2) \
+    INE(0xc3) \
+    INS(0xc4, "CPY", 3, false, op_cpy, ADDR_MODE_ZERO_PAGE) \
+    INS(0xc5, "CMP", 3, false, op_cmp, ADDR_MODE_ZERO_PAGE) \
+    INS(0xc6, "DEC", 5, false, op_dec, ADDR_MODE_ZERO_PAGE) \
+    INE(0xc7) \
+    INS(0xc8, "INY", 2, false, op_iny, ADDR_MODE_IMPLIED) \
+    INS(0xc9, "CMP", 2, false, op_cmp, ADDR_MODE_IMMEDIATE) \
+    INS(0xca, "DEX", 2, false, op_dex, ADDR_MODE_IMPLIED) \
+    INE(0xcb) \
+    INS(0xcc, "CPY", 4, false, op_cpy, ADDR_MODE_ABSOLUTE) \
+    INS(0xcd, "CMP", 4, false, op_cmp, ADDR_MODE_ABSOLUTE) \
+    INS(0xce, "DEC", 6, false, op_dec, ADDR_MODE_ABSOLUTE) \
+    INE(0xcf) \
+    INS(0xd0, "BNE", 2, true,  op_bne, ADDR_MODE_RELATIVE) \
+    INS(0xd1, "CMP", 5, true,  op_cmp, ADDR_MODE_INDIRECT_Y) \
+    INE(0xd2) \
+    INE(0xd3) \
+    INE(0xd4) \
+    INS(0xd5, "CMP", 4, false, op_cmp, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0xd6, "DEC", 6, false, op_dec, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0xd7) \
+    INS(0xd8, "CLD", 2, false, op_cld, ADDR_MODE_IMPLIED) \
+    INS(0xd9, "CMP", 4, true,  op_cmp, ADDR_MODE_ABSOLUTE_Y) \
+    INE(0xda) \
+    INE(0xdb) \
+    INE(0xdc) \
+    INS(0xdd, "CMP", 4, true,  op_cmp, ADDR_MODE_ABSOLUTE_X) \
+    INS(0xde, "DEC", 7, false, op_dec, ADDR_MODE_ABSOLUTE_X) \
+    INE(0xdf) \
+    INS(0xe0, "CPX", 2, false, op_cpx, ADDR_MODE_IMMEDIATE) \
+    INS(0xe1, "SBC", 6, false, op_sbc, ADDR_MODE_INDIRECT_X) \
+    INE(0xe2) \
+    INE(0xe3) \
+    INS(0xe4, "CPX", 3, false, op_cpx, ADDR_MODE_ZERO_PAGE) \
+    INS(0xe5, "SBC", 3, false, op_sbc, ADDR_MODE_ZERO_PAGE) \
+    INS(0xe6, "INC", 5, false, op_inc, ADDR_MODE_ZERO_PAGE) \
+    INE(0xe7) \
+    INS(0xe8, "INX", 2, false, op_inx, ADDR_MODE_IMPLIED) \
+    INS(0xe9, "SBC", 2, false, op_sbc, ADDR_MODE_IMMEDIATE) \
+    INS(0xea, "NOP", 2, false, op_nop, ADDR_MODE_IMPLIED) \
+    INE(0xeb) \
+    INS(0xec, "CPX", 4, false, op_cpx, ADDR_MODE_ABSOLUTE) \
+    INS(0xed, "SBC", 4, false, op_sbc, ADDR_MODE_ABSOLUTE) \
+    INS(0xee, "INC", 6, false, op_inc, ADDR_MODE_ABSOLUTE) \
+    INE(0xef) \
+    INS(0xf0, "BEQ", 2, true,  op_beq, ADDR_MODE_RELATIVE) \
+    INS(0xf1, "SBC", 5, true,  op_sbc, ADDR_MODE_INDIRECT_Y) \
+    INE(0xf2) \
+    INE(0xf3) \
+    INE(0xf4) \
+    INS(0xf5, "SBC", 4, false, op_sbc, ADDR_MODE_ZERO_PAGE_X) \
+    INS(0xf6, "INC", 6, false, op_inc, ADDR_MODE_ZERO_PAGE_X) \
+    INE(0xf7) \
+    INS(0xf8, "SED", 2, false, op_sed, ADDR_MODE_IMPLIED) \
+    INS(0xf9, "SBC", 4, true,  op_sbc, ADDR_MODE_ABSOLUTE_Y) \
+    INE(0xfa) \
+    INE(0xfb) \
+    INE(0xfc) \
+    INS(0xfd, "SBC", 4, true,  op_sbc, ADDR_MODE_ABSOLUTE_X) \
+    INS(0xfe, "INC", 7, false, op_inc, ADDR_MODE_ABSOLUTE_X) \
+    INE(0xff)
+
 uint8_t instruction_get_size(addr_mode_t mode) {
     switch (mode) {
         case ADDR_MODE_NONE:        return 0;
@@ -1869,6 +2834,30 @@ uint8_t instruction_get_size(addr_mode_t mode) {
     }
 }
 
+// Runs the instruction at pc and returns its cycles, 0 for an illegal
+// opcode. Each case has its operand decoding, size and cycle count as
+// constants and calls its operation directly, which the compiler inlines:
+// no indirect call and no switch on the addressing mode per instruction.
+int instruction_execute(cpu_t *cpu, uint8_t opcode, const uint8_t *operand) {
+#define INS(OPC, NAME, CYCLES, PCC, OP, MODE) \
+    case OPC: { \
+        bool page_crossed = false; \
+        uint16_t addr = get_instruction_operand(cpu, MODE, operand, &page_crossed); \
+        cpu->pc += instruction_get_size(MODE); \
+        int cycles = CYCLES + OP(cpu, addr, MODE); \
+        return (PCC && page_crossed) ? cycles + 1 : cycles; \
+    }
+#define INE(OPC) case OPC: return 0;
+
+    switch (opcode) {
+        INSTRUCTIONS(INS, INE)
+    }
+    return 0;
+
+#undef INE
+#undef INS
+}
+
 static int op_adc(cpu_t *cpu, uint16_t addr, addr_mode_t mode) {
     uint8_t old_acc = cpu->acc;
     uint8_t val = cpu_read8(cpu, addr);
@@ -2261,9 +3250,10 @@ static int take_branch(cpu_t *cpu, uint16_t addr) {
 static void mapper24_init(mapper24_t *mapper, agnes_t *agnes);
 static uint8_t mapper24_read(mapper24_t *mapper, uint16_t addr);
 static void mapper24_write(mapper24_t *mapper, uint16_t addr, uint8_t val);
-static void mapper24_cpu_cycle(mapper24_t *mapper);
+static void mapper24_cpu_cycles(mapper24_t *mapper, int cycles);
 
 bool mapper_init(agnes_t *agnes) {
+    mapper_bind(agnes);
     switch (agnes->gamepack.mapper) {
         case 0: mapper0_init(&agnes->mapper.m0, agnes); return true;
         case 1: mapper1_init(&agnes->mapper.m1, agnes); return true;
@@ -2275,30 +3265,129 @@ bool mapper_init(agnes_t *agnes) {
     }
 }
 
-uint8_t mapper_read(agnes_t *agnes, uint16_t addr) {
+// agnes_t entry points onto each mapper's own state
+#define MAPPER_OPS(N, M) \
+    static uint8_t mapper##N##_read_op(agnes_t *agnes, uint16_t addr) { \
+        return mapper##N##_read(&agnes->mapper.M, addr); \
+    } \
+    static void mapper##N##_write_op(agnes_t *agnes, uint16_t addr, uint8_t val) { \
+        mapper##N##_write(&agnes->mapper.M, addr, val); \
+    }
+
+MAPPER_OPS(0, m0)
+MAPPER_OPS(1, m1)
+MAPPER_OPS(2, m2)
+MAPPER_OPS(4, m4)
+MAPPER_OPS(24, m24)
+
+#undef MAPPER_OPS
+
+static void mapper4_pa12_rising_edge_op(agnes_t *agnes) {
+    mapper4_pa12_rising_edge(&agnes->mapper.m4);
+}
+
+static void mapper24_cpu_cycles_op(agnes_t *agnes, int cycles) {
+    mapper24_cpu_cycles(&agnes->mapper.m24, cycles);
+}
+
+void mapper_bind(agnes_t *agnes) {
+    memset(&agnes->mapper_ops, 0, sizeof(agnes->mapper_ops));
     switch (agnes->gamepack.mapper) {
-        case 0: return mapper0_read(&agnes->mapper.m0, addr);
-        case 1: return mapper1_read(&agnes->mapper.m1, addr);
-        case 2: return mapper2_read(&agnes->mapper.m2, addr);
-        case 4: return mapper4_read(&agnes->mapper.m4, addr);
-        case 24: case 26: return mapper24_read(&agnes->mapper.m24, addr);
-        default: return 0;
+        case 0:
+            agnes->mapper_ops.read = mapper0_read_op;
+            agnes->mapper_ops.write = mapper0_write_op;
+            break;
+        case 1:
+            agnes->mapper_ops.read = mapper1_read_op;
+            agnes->mapper_ops.write = mapper1_write_op;
+            break;
+        case 2:
+            agnes->mapper_ops.read = mapper2_read_op;
+            agnes->mapper_ops.write = mapper2_write_op;
+            break;
+        case 4:
+            agnes->mapper_ops.read = mapper4_read_op;
+            agnes->mapper_ops.write = mapper4_write_op;
+            agnes->mapper_ops.pa12_rising_edge = mapper4_pa12_rising_edge_op;
+            break;
+        case 24: case 26:
+            agnes->mapper_ops.read = mapper24_read_op;
+            agnes->mapper_ops.write = mapper24_write_op;
+            agnes->mapper_ops.cpu_cycles = mapper24_cpu_cycles_op;
+            break;
     }
 }
 
+uint8_t mapper_read(agnes_t *agnes, uint16_t addr) {
+    return agnes->mapper_ops.read(agnes, addr);
+}
+
 void mapper_write(agnes_t *agnes, uint16_t addr, uint8_t val) {
+    agnes->mapper_ops.write(agnes, addr, val);
+}
+
+void mapper_pa12_rising_edge(agnes_t *agnes) {
+    if (agnes->mapper_ops.pa12_rising_edge) {
+        agnes->mapper_ops.pa12_rising_edge(agnes);
+    }
+}
+
+// Map size bytes of CPU space from addr onto read, and onto write if not NULL
+static void map_pages(agnes_t *agnes, uint16_t addr, unsigned size, const uint8_t *read, uint8_t *write) {
+    for (unsigned i = 0; i < size >> 8; i++) {
+        agnes->read_pages[(addr >> 8) + i] = read + (i << 8);
+        agnes->write_pages[(addr >> 8) + i] = write ? write + (i << 8) : NULL;
+    }
+}
+
+uint8_t* mapper_prg_ram(const agnes_t *agnes) {
+    if (!agnes->gamepack.has_prg_ram) {
+        return NULL;
+    }
     switch (agnes->gamepack.mapper) {
-        case 0: mapper0_write(&agnes->mapper.m0, addr, val); break;
-        case 1: mapper1_write(&agnes->mapper.m1, addr, val); break;
-        case 2: mapper2_write(&agnes->mapper.m2, addr, val); break;
-        case 4: mapper4_write(&agnes->mapper.m4, addr, val); break;
-        case 24: case 26: mapper24_write(&agnes->mapper.m24, addr, val); break;
+        case 1: return (uint8_t*)agnes->mapper.m1.prg_ram;
+        case 4: return (uint8_t*)agnes->mapper.m4.prg_ram;
+        case 24: case 26: return (uint8_t*)agnes->mapper.m24.prg_ram;
+        default: return NULL;
     }
 }
 
-void mapper_pa12_rising_edge(agnes_t *agnes) {
+// PRG RAM to map for writing: none while battery-backed RAM is clean
+static uint8_t* prg_ram_write_page(agnes_t *agnes, uint8_t *prg_ram) {
+    return agnes->gamepack.has_prg_ram && !agnes->prg_ram_dirty ? NULL : prg_ram;
+}
+
+// Refresh the CPU page table from $6000 up after the PRG banks changed.
+// Everything that has a side effect stays unmapped: mapper registers are
+// only written, so PRG ROM pages are mapped for reading alone.
+void mapper_map_prg(agnes_t *agnes) {
+    const uint8_t *prg = agnes->gamepack.data + agnes->gamepack.prg_rom_offset;
     switch (agnes->gamepack.mapper) {
-        case 4: mapper4_pa12_rising_edge(&agnes->mapper.m4); break;
+        case 0:
+            map_pages(agnes, 0x8000, 0x4000, prg + agnes->mapper.m0.prg_bank_offsets[0], NULL);
+            map_pages(agnes, 0xc000, 0x4000, prg + agnes->mapper.m0.prg_bank_offsets[1], NULL);
+            break;
+        case 1:
+            map_pages(agnes, 0x6000, 0x2000, agnes->mapper.m1.prg_ram, prg_ram_write_page(agnes, agnes->mapper.m1.prg_ram));
+            map_pages(agnes, 0x8000, 0x4000, prg + agnes->mapper.m1.prg_bank_offsets[0], NULL);
+            map_pages(agnes, 0xc000, 0x4000, prg + agnes->mapper.m1.prg_bank_offsets[1], NULL);
+            break;
+        case 2:
+            map_pages(agnes, 0x8000, 0x4000, prg + agnes->mapper.m2.prg_bank_offsets[0], NULL);
+            map_pages(agnes, 0xc000, 0x4000, prg + agnes->mapper.m2.prg_bank_offsets[1], NULL);
+            break;
+        case 4:
+            map_pages(agnes, 0x6000, 0x2000, agnes->mapper.m4.prg_ram, prg_ram_write_page(agnes, agnes->mapper.m4.prg_ram));
+            for (int i = 0; i < 4; i++) {
+                map_pages(agnes, 0x8000 + i * 0x2000, 0x2000, prg + agnes->mapper.m4.prg_bank_offsets[i], NULL);
+            }
+            break;
+        case 24: case 26:
+            map_pages(agnes, 0x6000, 0x2000, agnes->mapper.m24.prg_ram, prg_ram_write_page(agnes, agnes->mapper.m24.prg_ram));
+            for (int i = 0; i < 4; i++) {
+                map_pages(agnes, 0x8000 + i * 0x2000, 0x2000, prg + agnes->mapper.m24.prg_bank_offsets[i], NULL);
+            }
+            break;
     }
 }
 //FILE_END
@@ -2440,6 +3529,7 @@ static void mapper1_write_control(mapper1_t *mapper, uint8_t val) {
 }
 
 static void mapper1_set_offsets(mapper1_t *mapper) {
+    unsigned old_chr[2] = { mapper->chr_bank_offsets[0], mapper->chr_bank_offsets[1] };
     switch (mapper->chr_mode) {
         case 0: {
             mapper->chr_bank_offsets[0] = (mapper->chr_banks[0] & 0xfe) * (8 * 1024);
@@ -2452,6 +3542,11 @@ static void mapper1_set_offsets(mapper1_t *mapper) {
             break;
         }
     }
+    for (int i = 0; i < 2; i++) {
+        if (mapper->chr_bank_offsets[i] != old_chr[i]) {
+            ppu_chr_switched(&mapper->agnes->ppu, i * 0x1000, 0x1000);
+        }
+    }
 
     switch (mapper->prg_mode) {
         case 0: case 1: {
@@ -2470,6 +3565,7 @@ static void mapper1_set_offsets(mapper1_t *mapper) {
             break;
         }
     }
+    mapper_map_prg(mapper->agnes);
 }
 //FILE_END
 //FILE_START:mapper2.c
@@ -2504,6 +3600,7 @@ void mapper2_write(mapper2_t *mapper, uint16_t addr, uint8_t val) {
     } else if (addr >= 0x8000) {
         int bank = val % (mapper->agnes->gamepack.prg_rom_banks_count);
         mapper->prg_bank_offsets[0] = bank * (16 * 1024);
+        mapper_map_prg(mapper->agnes);
     }
 }
 //FILE_END
@@ -2623,6 +3720,8 @@ static void mapper4_write_register(mapper4_t *mapper, uint16_t addr, uint8_t val
 }
 
 static void mapper4_set_offsets(mapper4_t *mapper) {
+    unsigned old_chr[8];
+    memcpy(old_chr, mapper->chr_bank_offsets, sizeof(old_chr));
     switch (mapper->chr_mode) {
         case 0: { // R0_1, R0_2, R1_1, R1_2, R2, R3, R4, R5
             mapper->chr_bank_offsets[0] = (mapper->regs[0] & 0xfe) * 1024;
@@ -2647,6 +3746,11 @@ static void mapper4_set_offsets(mapper4_t *mapper) {
             break;
         }
     }
+    for (int i = 0; i < 8; i++) {
+        if (mapper->chr_bank_offsets[i] != old_chr[i]) {
+            ppu_chr_switched(&mapper->agnes->ppu, i * 0x400, 0x400);
+        }
+    }
 
     switch (mapper->prg_mode) {
         case 0: { // R6, R7, -2, -1
@@ -2664,6 +3768,7 @@ static void mapper4_set_offsets(mapper4_t *mapper) {
             break;
         }
     }
+    mapper_map_prg(mapper->agnes);
 }
 //FILE_END
 
@@ -2816,9 +3921,11 @@ static void mapper24_write(mapper24_t *mapper, uint16_t addr, uint8_t val) {
         } else if (reg_group == 0xD000) {
             // $D000-$DFFF: CHR banks 0-3 (1KB each)
             mapper->chr_bank_offsets[sub_reg] = (unsigned)val * 1024;
+            ppu_chr_switched(&mapper->agnes->ppu, sub_reg * 0x400, 0x400);
         } else if (reg_group == 0xE000) {
             // $E000-$EFFF: CHR banks 4-7 (1KB each)
             mapper->chr_bank_offsets[4 + sub_reg] = (unsigned)val * 1024;
+            ppu_chr_switched(&mapper->agnes->ppu, (4 + sub_reg) * 0x400, 0x400);
         } else if (reg_group == 0xF000) {
             // $F000-$FFFF: IRQ control
             // sub_reg 0: IRQ latch
@@ -2858,32 +3965,36 @@ static void mapper24_set_offsets(mapper24_t *mapper) {
     
     // $E000-$FFFF: Fixed to last 8K
     mapper->prg_bank_offsets[3] = prg_rom_size - 8 * 1024;
+    mapper_map_prg(mapper->agnes);
 }
 
-static void mapper24_cpu_cycle(mapper24_t *mapper) {
+// The IRQ counter over a whole instruction's cycles at once, worked out
+// rather than stepped: the same end state as clocking cycle by cycle, and
+// the IRQ raised as many times (the CPU only sees whether it was)
+static void mapper24_cpu_cycles(mapper24_t *mapper, int cycles) {
     if (!mapper->irq_enabled) return;
     
     // VRC6 IRQ can run in scanline mode (bit 2 = 0) or cycle mode (bit 2 = 1)
+    unsigned clocks;
     if (mapper->irq_mode & 0x04) {
         // Cycle mode: clock every CPU cycle
-        if (mapper->irq_counter == 0xFF) {
-            mapper->irq_counter = mapper->irq_latch;
-            cpu_trigger_irq(&mapper->agnes->cpu);
-        } else {
-            mapper->irq_counter++;
-        }
+        clocks = cycles;
     } else {
         // Scanline mode: prescaler divides by 114
-        mapper->irq_prescaler++;
-        if (mapper->irq_prescaler >= 114) {
-            mapper->irq_prescaler = 0;
-            if (mapper->irq_counter == 0xFF) {
-                mapper->irq_counter = mapper->irq_latch;
-                cpu_trigger_irq(&mapper->agnes->cpu);
-            } else {
-                mapper->irq_counter++;
-            }
-        }
+        unsigned prescaler = mapper->irq_prescaler + cycles;
+        clocks = prescaler / 114;
+        mapper->irq_prescaler = prescaler % 114;
+    }
+    
+    // The counter counts up, and is reloaded from the latch instead of
+    // wrapping past $FF
+    unsigned to_reload = 0x100 - mapper->irq_counter;
+    if (clocks < to_reload) {
+        mapper->irq_counter += clocks;
+        return;
     }
+    clocks -= to_reload;
+    mapper->irq_counter = mapper->irq_latch + clocks % (0x100 - mapper->irq_latch);
+    cpu_trigger_irq(&mapper->agnes->cpu);
 }
 //FILE_END
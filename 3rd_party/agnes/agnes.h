@@ -67,21 +67,111 @@ typedef struct {
 typedef struct agnes agnes_t;
 typedef struct agnes_state agnes_state_t;
 
+#ifdef AGNES_PROFILE
+// Where the CPU's cycles went since agnes_clear_profile(), kept only in
+// builds with AGNES_PROFILE defined. Instructions are counted at the
+// address they start at, interrupt entry at the handler's first one.
+// Cycles between an NMI or IRQ and its RTI count as handler time, the
+// innermost handler's when they nest; BRK is left with the code.
+typedef struct agnes_profile {
+    uint32_t pc_cycles[0x10000];
+    uint64_t total_cycles;
+    uint64_t dma_cycles;       // OAM DMA stalls, not in pc_cycles
+    uint64_t frames;
+    uint32_t nmi_cycles;       // In the last frame, from vblank to vblank
+    uint32_t irq_cycles;
+    uint32_t nmi_peak;         // Most in any one frame
+    uint32_t irq_peak;
+
+    // The frame in progress, and the handlers being run: kind and the
+    // stack pointer their RTI returns with
+    uint32_t frame_cycles[2];
+    int handler_depth;
+    uint8_t handler_kind[8];
+    uint8_t handler_sp[8];
+} agnes_profile_t;
+#endif
+
 // APU callback function types for external APU implementation
 typedef void (*agnes_apu_write_func)(void* user_data, uint16_t addr, uint8_t val, uint64_t cpu_cycle);
 typedef uint8_t (*agnes_apu_read_func)(void* user_data, uint16_t addr, uint64_t cpu_cycle);
+// Input callback type, see agnes_set_input_handler()
+typedef void (*agnes_input_strobe_func)(void* user_data, uint64_t cpu_cycle);
 
 agnes_t* agnes_make(void);
 void agnes_destroy(agnes_t *agn);
 bool agnes_load_ines_data(agnes_t *agnes, void *data, size_t data_size);
+// The console's Reset button: CPU and PPU restart, RAM and the cartridge
+// keep their state. hard is a power cycle instead, which clears those too.
+// The cartridge is read from the data it was loaded from either way.
+void agnes_reset(agnes_t *agnes, bool hard);
 void agnes_set_input(agnes_t *agnes, const agnes_input_t *input_1, const agnes_input_t *input_2);
 size_t agnes_state_size(void);
+// Bytes of one agnes_t, as agnes_make() allocates it
+size_t agnes_size(void);
 void agnes_dump_state(const agnes_t *agnes, agnes_state_t *out_res);
 bool agnes_restore_state(agnes_t *agnes, const agnes_state_t *state);
+
+// Compact state: CPU, PPU, RAM, controllers and mapper, without the screen
+// buffer, pointers, cartridge layout or unused CHR RAM. Only valid for the
+// ROM it was saved with. out may be NULL to get the size.
+size_t agnes_save_compact(const agnes_t *agnes, void *out);
+bool agnes_load_compact(agnes_t *agnes, const void *data, size_t size);
+// FNV-1a hashes of what a compact state holds, by part, and of the screen
+// buffer, so two runs can be checked for staying in step part by part
+enum {
+    AGNES_HASH_CPU,     // Registers, cycle count, pending interrupt
+    AGNES_HASH_PPU,     // Nametables, palette, OAM, registers, scanline and dot
+    AGNES_HASH_RAM,     // The 2KB of work RAM
+    AGNES_HASH_INPUT,   // Controller shift registers and latch
+    AGNES_HASH_MAPPER,  // Bank registers, IRQ counters, PRG and CHR RAM, mirroring
+    AGNES_HASH_SCREEN,  // Palette indices drawn so far
+    AGNES_HASH_COUNT
+};
+void agnes_hash_state(const agnes_t *agnes, uint64_t out[AGNES_HASH_COUNT]);
 bool agnes_tick(agnes_t *agnes, bool *out_new_frame);
+// Draw each visible scanline at once when nothing the CPU does touches the
+// PPU or the mapper during it, and dot by dot when something does. The
+// output is the same either way; off by default.
+void agnes_set_fast_ppu(agnes_t *agnes, bool fast);
+// Let the CPU run ahead and the PPU catch up only when the CPU touches its
+// registers or the mapper, at the start of vblank, and at each scanline for
+// mappers with a scanline IRQ. Every frame comes out the same; off by
+// default. agnes_next_frame() and agnes_tick() return with the PPU caught up.
+void agnes_set_catch_up_ppu(agnes_t *agnes, bool catch_up);
 bool agnes_next_frame(agnes_t *agnes);
 
+// Pipelined drawing. With a log attached agnes draws nothing: the PPU keeps
+// its timing, registers and flags, sprite 0 hits included, and whatever the
+// CPU does that the picture depends on (PPU register accesses, OAM DMA,
+// mapper writes) goes into the log at the dot it happened, after a copy of
+// the machine from when the log started. agnes_render_ppu_log() draws the
+// logged stretch on that copy, on any thread, while agnes runs on.
+typedef struct agnes_ppu_log agnes_ppu_log_t;
+agnes_ppu_log_t* agnes_make_ppu_log(void);
+void agnes_destroy_ppu_log(agnes_ppu_log_t *log);
+// Ends the log attached, if any, and starts log from here; NULL goes back
+// to drawing. Only the CPU is logged: end the log before a reset or a state
+// load. The screen buffer keeps the picture from before the log until
+// agnes_take_ppu_log_screen().
+void agnes_log_ppu(agnes_t *agnes, agnes_ppu_log_t *log);
+// Once per ended log: draws it over screen, the picture from before it,
+// which must stay as it is until this returns. false if the log ran out
+// of memory, and the picture is not to be trusted.
+bool agnes_render_ppu_log(agnes_ppu_log_t *log, const uint8_t *screen);
+// The rendered picture into agnes' screen buffer, marked changed if it is
+void agnes_take_ppu_log_screen(agnes_t *agnes, const agnes_ppu_log_t *log);
+// Lines of the logged stretch the CPU had the PPU step dot by dot, which
+// the render steps dot by dot again
+int agnes_ppu_log_lines_caught_up(const agnes_ppu_log_t *log);
+
 agnes_color_t agnes_get_screen_pixel(const agnes_t *agnes, int x, int y);
+// The finished frame as palette indices (0-63), AGNES_SCREEN_WIDTH a row
+const uint8_t* agnes_get_screen_buffer(const agnes_t *agnes);
+// Whether any pixel of the screen buffer changed since the last call
+bool agnes_take_screen_changed(agnes_t *agnes);
+// agnes' own 64-colour palette, for building a lookup table
+const agnes_color_t* agnes_get_palette(void);
 
 // APU handler functions
 void agnes_set_apu_handler(agnes_t *agnes, 
@@ -89,9 +179,35 @@ void agnes_set_apu_handler(agnes_t *agnes,
                            agnes_apu_read_func read_func,
                            void *user_data);
 
+// Called when the CPU strobes the controllers ($4016 bit 0 set), before
+// they latch the buttons, so the handler can agnes_set_input() what was
+// held at that cycle rather than at the start of the frame
+void agnes_set_input_handler(agnes_t *agnes, agnes_input_strobe_func strobe_func, void *user_data);
+
 // Get current CPU cycle count (for APU synchronization)
 uint64_t agnes_get_cpu_cycles(const agnes_t *agnes);
 
+#ifdef AGNES_PROFILE
+const agnes_profile_t* agnes_get_profile(const agnes_t *agnes);
+void agnes_clear_profile(agnes_t *agnes);
+#endif
+
+// The byte the CPU would read at addr from RAM, PRG RAM or PRG ROM, as
+// banked now, without the side effects of a bus read; 0 for registers and
+// unmapped addresses. For the APU's DMC sample fetches, which only read.
+uint8_t agnes_peek(const agnes_t *agnes, uint16_t addr);
+
+// Battery-backed PRG RAM, for a save file: its size, 0 unless the cartridge
+// has a battery (iNES flags 6 bit 1) and a mapper with PRG RAM
+size_t agnes_prg_ram_size(const agnes_t *agnes);
+// Copies PRG RAM to out if the CPU wrote it since the last take, or since
+// the ROM was loaded; false, leaving out alone, if not. Restoring a state
+// whose PRG RAM differs counts as a write.
+bool agnes_take_prg_ram(agnes_t *agnes, void *out);
+// PRG RAM from a save file, after agnes_load_ines_data(); false if size is
+// not agnes_prg_ram_size()
+bool agnes_load_prg_ram(agnes_t *agnes, const void *data, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -2107,6 +2107,37 @@ typedef enum sapp_mouse_cursor {
     _SAPP_MOUSECURSOR_NUM,
 } sapp_mouse_cursor;
 
+/*
+    sapp_present_mode
+
+    How the swapchain hands finished frames to the display, see
+    sapp_set_present_mode(). Only the Vulkan backend can switch at
+    runtime; elsewhere the mode is always SAPP_PRESENTMODE_FIFO.
+*/
+typedef enum sapp_present_mode {
+    SAPP_PRESENTMODE_FIFO = 0,      // vsync, frames queue up (the default)
+    SAPP_PRESENTMODE_MAILBOX,       // vsync, a newer frame replaces a queued one
+    SAPP_PRESENTMODE_IMMEDIATE,     // no vsync, may tear
+    _SAPP_PRESENTMODE_NUM,
+} sapp_present_mode;
+
+/*
+    sapp_capture_frame
+
+    A presented frame read back for sapp_set_capture_callback(), valid
+    only during the callback.
+*/
+typedef struct sapp_capture_frame {
+    const void* pixels;     // 4 bytes per pixel, top row first
+    int width;
+    int height;
+    int row_pitch;          // bytes
+    bool bgra;              // bytes in B, G, R, A order, otherwise R, G, B, A
+    uint64_t frame_count;   // sapp_frame_count() during the frame captured
+} sapp_capture_frame;
+
+typedef void (*sapp_capture_callback)(const sapp_capture_frame* frame, void* user_data);
+
 /* user-provided functions */
 extern sapp_desc sokol_main(int argc, char* argv[]);
 
@@ -2170,6 +2201,20 @@ SOKOL_APP_API_DECL void sapp_consume_event(void);
 SOKOL_APP_API_DECL uint64_t sapp_frame_count(void);
 /* get an averaged/smoothed frame duration in seconds */
 SOKOL_APP_API_DECL double sapp_frame_duration(void);
+/* true if the display surface can present with this mode */
+SOKOL_APP_API_DECL bool sapp_present_mode_supported(sapp_present_mode mode);
+/* switch the present mode, the swapchain is recreated after the current frame */
+SOKOL_APP_API_DECL void sapp_set_present_mode(sapp_present_mode mode);
+/* the present mode in use */
+SOKOL_APP_API_DECL sapp_present_mode sapp_get_present_mode(void);
+/* true if presented frames can be read back (Vulkan only) */
+SOKOL_APP_API_DECL bool sapp_capture_supported(void);
+/* read back every presented frame and hand it to callback a few frames later, from
+   the thread that calls frame_cb; frames the GPU has not copied yet are skipped, never
+   waited for; null stops */
+SOKOL_APP_API_DECL void sapp_set_capture_callback(sapp_capture_callback callback, void* user_data);
+/* wait for the GPU instead, so that every frame is captured (offline rendering) */
+SOKOL_APP_API_DECL void sapp_set_capture_wait(bool wait);
 /* write string into clipboard */
 SOKOL_APP_API_DECL void sapp_set_clipboard_string(const char* str);
 /* read string from clipboard (usually during SAPP_EVENTTYPE_CLIPBOARD_PASTED) */
@@ -2768,6 +2813,7 @@ typedef struct {
 
 #if defined(SOKOL_VULKAN)
 #define _SAPP_VK_MAX_SWAPCHAIN_IMAGES (8)
+#define _SAPP_VK_NUM_CAPTURE_SLOTS (3)
 
 typedef struct {
     VkImage img;
@@ -2775,6 +2821,30 @@ typedef struct {
     VkImageView view;
 } _sapp_vk_swapchain_surface_t;
 
+typedef struct {
+    VkBuffer buf;
+    VkDeviceMemory mem;
+    void* ptr;                  // persistently mapped
+    VkCommandBuffer cmd;
+    VkFence fence;
+    VkSemaphore copy_finished_sem;
+    uint32_t width;
+    uint32_t height;
+    bool pending;               // copy submitted, fence not seen signalled yet
+    bool deliver;               // hand the copy to the callback once it is done
+    uint64_t frame_count;
+} _sapp_vk_capture_slot_t;
+
+typedef struct {
+    sapp_capture_callback callback;
+    void* user_data;
+    bool supported;             // swapchain images can be copied from
+    bool wait;                  // wait for a slot's copy instead of skipping the frame
+    VkCommandPool cmd_pool;
+    uint32_t cur_slot;
+    _sapp_vk_capture_slot_t slots[_SAPP_VK_NUM_CAPTURE_SLOTS];
+} _sapp_vk_capture_t;
+
 typedef struct {
     VkInstance instance;
     VkSurfaceKHR surface;
@@ -2795,6 +2865,9 @@ typedef struct {
         VkSemaphore render_finished_sem;
         VkSemaphore present_complete_sem;
     } sync[_SAPP_VK_MAX_SWAPCHAIN_IMAGES];
+    sapp_present_mode requested_present_mode;
+    sapp_present_mode present_mode;
+    _sapp_vk_capture_t capture;
 } _sapp_vk_t;
 #endif
 
@@ -4702,6 +4775,36 @@ _SOKOL_PRIVATE void _sapp_vk_swapchain_create_surface(
     SOKOL_ASSERT(surf->view);
 }
 
+_SOKOL_PRIVATE VkPresentModeKHR _sapp_vk_present_mode(sapp_present_mode mode) {
+    switch (mode) {
+        case SAPP_PRESENTMODE_MAILBOX: return VK_PRESENT_MODE_MAILBOX_KHR;
+        case SAPP_PRESENTMODE_IMMEDIATE: return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        default: return VK_PRESENT_MODE_FIFO_KHR;
+    }
+}
+
+_SOKOL_PRIVATE bool _sapp_vk_present_mode_supported(sapp_present_mode mode) {
+    if (mode == SAPP_PRESENTMODE_FIFO) {
+        return true;
+    }
+    if (!_sapp.vk.physical_device || !_sapp.vk.surface) {
+        return false;
+    }
+    VkPresentModeKHR modes[16];
+    uint32_t num_modes = 16;
+    VkResult res = vkGetPhysicalDeviceSurfacePresentModesKHR(_sapp.vk.physical_device, _sapp.vk.surface, &num_modes, modes);
+    if ((res != VK_SUCCESS) && (res != VK_INCOMPLETE)) {
+        return false;
+    }
+    const VkPresentModeKHR wanted = _sapp_vk_present_mode(mode);
+    for (uint32_t i = 0; i < num_modes; i++) {
+        if (modes[i] == wanted) {
+            return true;
+        }
+    }
+    return false;
+}
+
 _SOKOL_PRIVATE void _sapp_vk_create_swapchain(bool recreate) {
     SOKOL_ASSERT(_sapp.vk.physical_device);
     SOKOL_ASSERT(_sapp.vk.surface);
@@ -4727,8 +4830,12 @@ _SOKOL_PRIVATE void _sapp_vk_create_swapchain(bool recreate) {
     const uint32_t height = surf_caps.currentExtent.height;
 
     _sapp.vk.surface_format = _sapp_vk_pick_surface_format();
-    // FIXME: pick better present-mode if supported
-    VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    // FIFO is always available, the others only where the surface has them
+    if (!_sapp_vk_present_mode_supported(_sapp.vk.requested_present_mode)) {
+        _sapp.vk.requested_present_mode = SAPP_PRESENTMODE_FIFO;
+    }
+    _sapp.vk.present_mode = _sapp.vk.requested_present_mode;
+    VkPresentModeKHR present_mode = _sapp_vk_present_mode(_sapp.vk.present_mode);
 
     // FIXME: better imageExtent (scale vs no-scale!)
     _SAPP_STRUCT(VkSwapchainCreateInfoKHR, create_info);
@@ -4742,6 +4849,14 @@ _SOKOL_PRIVATE void _sapp_vk_create_swapchain(bool recreate) {
     create_info.imageExtent.height = height;
     create_info.imageArrayLayers = 1;
     create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // for frame capture, in 4-byte formats only
+    const VkFormat fmt = _sapp.vk.surface_format.format;
+    _sapp.vk.capture.supported = (0 != (surf_caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) &&
+        ((fmt == VK_FORMAT_B8G8R8A8_UNORM) || (fmt == VK_FORMAT_B8G8R8A8_SRGB) ||
+         (fmt == VK_FORMAT_R8G8B8A8_UNORM) || (fmt == VK_FORMAT_R8G8B8A8_SRGB));
+    if (_sapp.vk.capture.supported) {
+        create_info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
     create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
     create_info.preTransform = surf_caps.currentTransform;
     create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
@@ -4839,6 +4954,235 @@ _SOKOL_PRIVATE void _sapp_vk_destroy_swapchain(void) {
     _sapp.vk.num_swapchain_images = 0;
 }
 
+_SOKOL_PRIVATE void _sapp_vk_capture_free_buffer(_sapp_vk_capture_slot_t* slot) {
+    if (slot->buf) {
+        vkDestroyBuffer(_sapp.vk.device, slot->buf, 0);
+        slot->buf = 0;
+    }
+    if (slot->mem) {
+        vkUnmapMemory(_sapp.vk.device, slot->mem);
+        vkFreeMemory(_sapp.vk.device, slot->mem, 0);
+        slot->mem = 0;
+        slot->ptr = 0;
+    }
+    slot->width = 0;
+    slot->height = 0;
+}
+
+// host-visible staging buffer for one frame, cached memory where there is some
+_SOKOL_PRIVATE bool _sapp_vk_capture_alloc_buffer(_sapp_vk_capture_slot_t* slot, uint32_t width, uint32_t height) {
+    _sapp_vk_capture_free_buffer(slot);
+    _SAPP_STRUCT(VkBufferCreateInfo, buf_info);
+    buf_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buf_info.size = (VkDeviceSize)width * height * 4;
+    buf_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buf_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(_sapp.vk.device, &buf_info, 0, &slot->buf) != VK_SUCCESS) {
+        slot->buf = 0;
+        return false;
+    }
+    _SAPP_STRUCT(VkMemoryRequirements, mem_reqs);
+    vkGetBufferMemoryRequirements(_sapp.vk.device, slot->buf, &mem_reqs);
+    const VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    int mem_type_index = _sapp_vk_mem_find_memory_type_index(mem_reqs.memoryTypeBits, host | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    if (-1 == mem_type_index) {
+        mem_type_index = _sapp_vk_mem_find_memory_type_index(mem_reqs.memoryTypeBits, host);
+    }
+    if (-1 == mem_type_index) {
+        _sapp_vk_capture_free_buffer(slot);
+        return false;
+    }
+    _SAPP_STRUCT(VkMemoryAllocateInfo, alloc_info);
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = mem_reqs.size;
+    alloc_info.memoryTypeIndex = (uint32_t) mem_type_index;
+    if (vkAllocateMemory(_sapp.vk.device, &alloc_info, 0, &slot->mem) != VK_SUCCESS) {
+        slot->mem = 0;
+        _sapp_vk_capture_free_buffer(slot);
+        return false;
+    }
+    vkBindBufferMemory(_sapp.vk.device, slot->buf, slot->mem, 0);
+    if (vkMapMemory(_sapp.vk.device, slot->mem, 0, VK_WHOLE_SIZE, 0, &slot->ptr) != VK_SUCCESS) {
+        slot->ptr = 0;
+        vkFreeMemory(_sapp.vk.device, slot->mem, 0);
+        slot->mem = 0;
+        _sapp_vk_capture_free_buffer(slot);
+        return false;
+    }
+    slot->width = width;
+    slot->height = height;
+    return true;
+}
+
+_SOKOL_PRIVATE bool _sapp_vk_create_capture(void) {
+    _SAPP_STRUCT(VkCommandPoolCreateInfo, pool_info);
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = _sapp.vk.queue_family_index;
+    if (vkCreateCommandPool(_sapp.vk.device, &pool_info, 0, &_sapp.vk.capture.cmd_pool) != VK_SUCCESS) {
+        _sapp.vk.capture.cmd_pool = 0;
+        return false;
+    }
+    _SAPP_STRUCT(VkCommandBufferAllocateInfo, cmd_info);
+    cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmd_info.commandPool = _sapp.vk.capture.cmd_pool;
+    cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmd_info.commandBufferCount = 1;
+    _SAPP_STRUCT(VkFenceCreateInfo, fence_info);
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    _SAPP_STRUCT(VkSemaphoreCreateInfo, sem_info);
+    sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    for (int i = 0; i < _SAPP_VK_NUM_CAPTURE_SLOTS; i++) {
+        _sapp_vk_capture_slot_t* slot = &_sapp.vk.capture.slots[i];
+        if ((vkAllocateCommandBuffers(_sapp.vk.device, &cmd_info, &slot->cmd) != VK_SUCCESS) ||
+            (vkCreateFence(_sapp.vk.device, &fence_info, 0, &slot->fence) != VK_SUCCESS) ||
+            (vkCreateSemaphore(_sapp.vk.device, &sem_info, 0, &slot->copy_finished_sem) != VK_SUCCESS))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+_SOKOL_PRIVATE void _sapp_vk_discard_capture(void) {
+    SOKOL_ASSERT(_sapp.vk.device);
+    for (int i = 0; i < _SAPP_VK_NUM_CAPTURE_SLOTS; i++) {
+        _sapp_vk_capture_slot_t* slot = &_sapp.vk.capture.slots[i];
+        _sapp_vk_capture_free_buffer(slot);
+        if (slot->fence) {
+            vkDestroyFence(_sapp.vk.device, slot->fence, 0);
+        }
+        if (slot->copy_finished_sem) {
+            vkDestroySemaphore(_sapp.vk.device, slot->copy_finished_sem, 0);
+        }
+        slot->cmd = 0;
+        slot->fence = 0;
+        slot->copy_finished_sem = 0;
+        slot->pending = false;
+        slot->deliver = false;
+    }
+    if (_sapp.vk.capture.cmd_pool) {
+        vkDestroyCommandPool(_sapp.vk.device, _sapp.vk.capture.cmd_pool, 0);
+        _sapp.vk.capture.cmd_pool = 0;
+    }
+}
+
+_SOKOL_PRIVATE void _sapp_vk_capture_image_barrier(VkCommandBuffer cmd, VkImage img,
+    VkImageLayout old_layout, VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access,
+    VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage)
+{
+    _SAPP_STRUCT(VkImageMemoryBarrier, barrier);
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = img;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, 0, 0, 0, 1, &barrier);
+}
+
+// Copy the frame about to be presented into the next staging slot, after handing
+// the slot's previous frame to the callback. Returns the semaphore the present must
+// wait on instead of render_finished_sem, or 0 if this frame is not captured.
+_SOKOL_PRIVATE VkSemaphore _sapp_vk_capture_frame(VkSemaphore render_finished_sem) {
+    if (!_sapp.vk.capture.cmd_pool && !_sapp_vk_create_capture()) {
+        _sapp_vk_discard_capture();
+        _sapp.vk.capture.supported = false;
+        return 0;
+    }
+    _sapp_vk_capture_slot_t* slot = &_sapp.vk.capture.slots[_sapp.vk.capture.cur_slot];
+    if (slot->pending) {
+        if (_sapp.vk.capture.wait) {
+            vkWaitForFences(_sapp.vk.device, 1, &slot->fence, VK_TRUE, UINT64_MAX);
+        } else if (vkGetFenceStatus(_sapp.vk.device, slot->fence) != VK_SUCCESS) {
+            // GPU is behind, skip capturing rather than stall the frame
+            return 0;
+        }
+        _SAPP_STRUCT(sapp_capture_frame, frame);
+        frame.pixels = slot->ptr;
+        frame.width = (int)slot->width;
+        frame.height = (int)slot->height;
+        frame.row_pitch = (int)slot->width * 4;
+        frame.bgra = (_sapp.vk.surface_format.format == VK_FORMAT_B8G8R8A8_UNORM) ||
+                     (_sapp.vk.surface_format.format == VK_FORMAT_B8G8R8A8_SRGB);
+        frame.frame_count = slot->frame_count;
+        slot->pending = false;
+        if (slot->deliver) {
+            slot->deliver = false;
+            _sapp.vk.capture.callback(&frame, _sapp.vk.capture.user_data);
+            if (!_sapp.vk.capture.callback) {
+                return 0;
+            }
+        }
+    }
+    const uint32_t width = (uint32_t)_sapp.framebuffer_width;
+    const uint32_t height = (uint32_t)_sapp.framebuffer_height;
+    if ((width == 0) || (height == 0)) {
+        return 0;
+    }
+    if (((slot->width != width) || (slot->height != height)) && !_sapp_vk_capture_alloc_buffer(slot, width, height)) {
+        return 0;
+    }
+
+    VkCommandBuffer cmd = slot->cmd;
+    VkImage img = _sapp.vk.swapchain_images[_sapp.vk.cur_swapchain_image_index];
+    vkResetFences(_sapp.vk.device, 1, &slot->fence);
+    vkResetCommandBuffer(cmd, 0);
+    _SAPP_STRUCT(VkCommandBufferBeginInfo, begin_info);
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(cmd, &begin_info);
+    _sapp_vk_capture_image_barrier(cmd, img,
+        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        0, VK_ACCESS_TRANSFER_READ_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    _SAPP_STRUCT(VkBufferImageCopy, region);
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent.width = width;
+    region.imageExtent.height = height;
+    region.imageExtent.depth = 1;
+    vkCmdCopyImageToBuffer(cmd, img, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buf, 1, &region);
+    _sapp_vk_capture_image_barrier(cmd, img,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        VK_ACCESS_TRANSFER_READ_BIT, 0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    _SAPP_STRUCT(VkBufferMemoryBarrier, host_barrier);
+    host_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    host_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    host_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    host_barrier.buffer = slot->buf;
+    host_barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, 0, 1, &host_barrier, 0, 0);
+    vkEndCommandBuffer(cmd);
+
+    const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    _SAPP_STRUCT(VkSubmitInfo, submit_info);
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &render_finished_sem;
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &cmd;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &slot->copy_finished_sem;
+    if (vkQueueSubmit(_sapp.vk.queue, 1, &submit_info, slot->fence) != VK_SUCCESS) {
+        return 0;
+    }
+    slot->pending = true;
+    slot->deliver = true;
+    slot->frame_count = _sapp.frame_count - 1;  // _sapp_frame() has counted it already
+    _sapp.vk.capture.cur_slot = (_sapp.vk.capture.cur_slot + 1) % _SAPP_VK_NUM_CAPTURE_SLOTS;
+    return slot->copy_finished_sem;
+}
+
 #if defined(_SAPP_LINUX)
 _SOKOL_PRIVATE void _sapp_x11_app_event(sapp_event_type type);
 #elif defined(_SAPP_WIN32)
@@ -4874,6 +5218,7 @@ _SOKOL_PRIVATE void _sapp_vk_init(void) {
 _SOKOL_PRIVATE void _sapp_vk_discard(void) {
     SOKOL_ASSERT(_sapp.vk.device);
     vkDeviceWaitIdle(_sapp.vk.device);
+    _sapp_vk_discard_capture();
     _sapp_vk_destroy_sync_objects();
     _sapp_vk_destroy_swapchain();
     _sapp_vk_destroy_device();
@@ -4898,10 +5243,18 @@ _SOKOL_PRIVATE void _sapp_vk_swapchain_next(void) {
 
 _SOKOL_PRIVATE void _sapp_vk_present(void) {
     SOKOL_ASSERT(_sapp.vk.queue);
+    VkSemaphore wait_sem = _sapp.vk.sync[_sapp.vk.cur_swapchain_image_index].render_finished_sem;
+    if (_sapp.vk.capture.callback && _sapp.vk.capture.supported) {
+        // the present then waits for the copy, which waited for rendering
+        VkSemaphore copy_sem = _sapp_vk_capture_frame(wait_sem);
+        if (copy_sem) {
+            wait_sem = copy_sem;
+        }
+    }
     _SAPP_STRUCT(VkPresentInfoKHR, present_info);
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = &_sapp.vk.sync[_sapp.vk.cur_swapchain_image_index].render_finished_sem;
+    present_info.pWaitSemaphores = &wait_sem;
     present_info.swapchainCount = 1;
     present_info.pSwapchains = &_sapp.vk.swapchain;
     present_info.pImageIndices = &_sapp.vk.cur_swapchain_image_index;
@@ -4917,6 +5270,9 @@ _SOKOL_PRIVATE void _sapp_vk_frame(void) {
     _sapp_frame();
     _sapp_vk_present();
     _sapp.vk.sync_slot = (_sapp.vk.sync_slot + 1) % _sapp.vk.num_swapchain_images;
+    if (_sapp.vk.requested_present_mode != _sapp.vk.present_mode) {
+        _sapp_vk_recreate_swapchain();
+    }
 }
 
 #endif // SOKOL_VULKAN
@@ -13467,6 +13823,62 @@ SOKOL_API_IMPL double sapp_frame_duration(void) {
     return _sapp_timing_get_avg(&_sapp.timing);
 }
 
+SOKOL_API_IMPL bool sapp_present_mode_supported(sapp_present_mode mode) {
+    SOKOL_ASSERT((mode >= 0) && (mode < _SAPP_PRESENTMODE_NUM));
+    #if defined(SOKOL_VULKAN)
+    return _sapp_vk_present_mode_supported(mode);
+    #else
+    return mode == SAPP_PRESENTMODE_FIFO;
+    #endif
+}
+
+SOKOL_API_IMPL void sapp_set_present_mode(sapp_present_mode mode) {
+    SOKOL_ASSERT((mode >= 0) && (mode < _SAPP_PRESENTMODE_NUM));
+    #if defined(SOKOL_VULKAN)
+    _sapp.vk.requested_present_mode = mode;
+    #else
+    _SOKOL_UNUSED(mode);
+    #endif
+}
+
+SOKOL_API_IMPL sapp_present_mode sapp_get_present_mode(void) {
+    #if defined(SOKOL_VULKAN)
+    return _sapp.vk.present_mode;
+    #else
+    return SAPP_PRESENTMODE_FIFO;
+    #endif
+}
+
+SOKOL_API_IMPL bool sapp_capture_supported(void) {
+    #if defined(SOKOL_VULKAN)
+    return _sapp.vk.capture.supported;
+    #else
+    return false;
+    #endif
+}
+
+SOKOL_API_IMPL void sapp_set_capture_callback(sapp_capture_callback callback, void* user_data) {
+    #if defined(SOKOL_VULKAN)
+    _sapp.vk.capture.callback = callback;
+    _sapp.vk.capture.user_data = user_data;
+    // copies still in flight are dropped, not handed to a new callback
+    for (int i = 0; i < _SAPP_VK_NUM_CAPTURE_SLOTS; i++) {
+        _sapp.vk.capture.slots[i].deliver = false;
+    }
+    #else
+    _SOKOL_UNUSED(callback);
+    _SOKOL_UNUSED(user_data);
+    #endif
+}
+
+SOKOL_API_IMPL void sapp_set_capture_wait(bool wait) {
+    #if defined(SOKOL_VULKAN)
+    _sapp.vk.capture.wait = wait;
+    #else
+    _SOKOL_UNUSED(wait);
+    #endif
+}
+
 SOKOL_API_IMPL int sapp_width(void) {
     return (_sapp.framebuffer_width > 0) ? _sapp.framebuffer_width : 1;
 }
@@ -2031,6 +2031,7 @@ enum {
     SG_MAX_PORTABLE_TEXTURE_BINDINGS_PER_STAGE = 16,
     SG_MAX_PORTABLE_STORAGEBUFFER_BINDINGS_PER_STAGE = 8,   // assuming sg_features.compute = true
     SG_MAX_PORTABLE_STORAGEIMAGE_BINDINGS_PER_STAGE = 4,    // assuming sg_features.compute = true
+    SG_MAX_GPU_TIMERS = 8,
 };
 
 /*
@@ -5092,6 +5093,17 @@ SOKOL_GFX_API_DECL void sg_draw_ex(int base_element, int num_elements, int num_i
 SOKOL_GFX_API_DECL void sg_dispatch(int num_groups_x, int num_groups_y, int num_groups_z);
 SOKOL_GFX_API_DECL void sg_end_pass(void);
 SOKOL_GFX_API_DECL void sg_commit(void);
+// GPU timing, read back once the GPU has finished a frame; nothing waits for it
+/* true if sg_begin_gpu_timer() measures anything (Vulkan with timestamp support only) */
+SOKOL_GFX_API_DECL bool sg_gpu_timers_supported(void);
+/* timestamp the GPU's work between begin and end, inside or between passes, at most once
+   per timer (0..SG_MAX_GPU_TIMERS-1) and frame */
+SOKOL_GFX_API_DECL void sg_begin_gpu_timer(int timer);
+SOKOL_GFX_API_DECL void sg_end_gpu_timer(int timer);
+/* milliseconds of the timer in the newest frame read back, -1 if it was not timed there */
+SOKOL_GFX_API_DECL double sg_query_gpu_timer(int timer);
+/* milliseconds the newest frame read back kept the GPU busy, -1 if not known (Vulkan and Metal) */
+SOKOL_GFX_API_DECL double sg_query_gpu_frame_time(void);
 
 // getting information
 SOKOL_GFX_API_DECL sg_desc sg_query_desc(void);
@@ -6746,6 +6758,7 @@ typedef struct {
     id<MTLComputeCommandEncoder> compute_cmd_encoder;
     id<CAMetalDrawable> cur_drawable;
     id<MTLBuffer> uniform_buffers[SG_NUM_INFLIGHT_FRAMES];
+    uint64_t gpu_frame_ns;      // written by the command buffer's completed handler, 0 until known
 } _sg_mtl_backend_t;
 
 #elif defined(SOKOL_WGPU)
@@ -7071,6 +7084,21 @@ typedef struct {
     VkDescriptorGetInfoEXT get_info;
 } _sg_vk_uniform_bindinfo_t;
 
+// GPU timers: a begin and an end query per timer, then the frame's own pair
+#define _SG_VK_FRAME_TIMER (SG_MAX_GPU_TIMERS)
+#define _SG_VK_NUM_TIMESTAMP_QUERIES (2 * (SG_MAX_GPU_TIMERS + 1))
+typedef struct {
+    bool supported;
+    double ns_per_tick;
+    uint64_t valid_mask;
+    struct {
+        VkQueryPool pool;
+        uint32_t begun;     // bit per timer, and _SG_VK_FRAME_TIMER's
+        uint32_t ended;
+    } slot[SG_NUM_INFLIGHT_FRAMES];
+    double ms[SG_MAX_GPU_TIMERS + 1];  // newest frame read back, -1 if not timed there
+} _sg_vk_timestamps_t;
+
 typedef struct {
     bool valid;
     VkPhysicalDevice phys_dev;
@@ -7119,6 +7147,8 @@ typedef struct {
     bool uniforms_dirty;
     _sg_vk_shared_buffer_t uniform;
     _sg_vk_uniform_bindinfo_t uniform_bindinfos[SG_MAX_UNIFORMBLOCK_BINDSLOTS];
+    // GPU timers (timestamp queries)
+    _sg_vk_timestamps_t timestamps;
     // resource binding system (using descriptor buffers)
     _sg_vk_shared_buffer_t bind;
     // hazard tracking system for buffers and images
@@ -16051,7 +16081,12 @@ _SOKOL_PRIVATE void _sg_mtl_begin_pass(const sg_pass* pass, const _sg_attachment
         [_sg.mtl.cmd_buffer enqueue];
         [_sg.mtl.cmd_buffer addCompletedHandler:^(id<MTLCommandBuffer> cmd_buf) {
             // NOTE: this code is called on a different thread!
-            _SOKOL_UNUSED(cmd_buf);
+            if (@available(macOS 10.15, iOS 10.3, *)) {
+                const double gpu_s = cmd_buf.GPUEndTime - cmd_buf.GPUStartTime;
+                if (gpu_s > 0.0) {
+                    __atomic_store_n(&_sg.mtl.gpu_frame_ns, (uint64_t)(gpu_s * 1e9), __ATOMIC_RELAXED);
+                }
+            }
             dispatch_semaphore_signal(_sg.mtl.sem);
         }];
     }
@@ -20467,6 +20502,91 @@ _SOKOL_PRIVATE void _sg_vk_destroy_fences(void) {
     }
 }
 
+_SOKOL_PRIVATE void _sg_vk_timestamps_init(void) {
+    SOKOL_ASSERT(_sg.vk.dev && _sg.vk.phys_dev);
+    for (size_t i = 0; i <= SG_MAX_GPU_TIMERS; i++) {
+        _sg.vk.timestamps.ms[i] = -1.0;
+    }
+    // the queue's family must write timestamps; a period of 0 means none are
+    uint32_t num_families = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(_sg.vk.phys_dev, &num_families, 0);
+    _SG_STRUCT(VkQueueFamilyProperties, families[16]);
+    if (num_families > 16) {
+        num_families = 16;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(_sg.vk.phys_dev, &num_families, families);
+    if (_sg.vk.queue_family_index >= num_families) {
+        return;
+    }
+    const uint32_t valid_bits = families[_sg.vk.queue_family_index].timestampValidBits;
+    const float period = _sg.vk.dev_props.properties.limits.timestampPeriod;
+    if ((0 == valid_bits) || (period <= 0.0f)) {
+        return;
+    }
+    _SG_STRUCT(VkQueryPoolCreateInfo, create_info);
+    create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    create_info.queryCount = _SG_VK_NUM_TIMESTAMP_QUERIES;
+    for (size_t i = 0; i < SG_NUM_INFLIGHT_FRAMES; i++) {
+        SOKOL_ASSERT(0 == _sg.vk.timestamps.slot[i].pool);
+        if (vkCreateQueryPool(_sg.vk.dev, &create_info, 0, &_sg.vk.timestamps.slot[i].pool) != VK_SUCCESS) {
+            _sg.vk.timestamps.slot[i].pool = 0;
+            return;
+        }
+    }
+    _sg.vk.timestamps.ns_per_tick = (double)period;
+    _sg.vk.timestamps.valid_mask = (valid_bits >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << valid_bits) - 1);
+    _sg.vk.timestamps.supported = true;
+}
+
+_SOKOL_PRIVATE void _sg_vk_timestamps_discard(void) {
+    SOKOL_ASSERT(_sg.vk.dev);
+    for (size_t i = 0; i < SG_NUM_INFLIGHT_FRAMES; i++) {
+        if (_sg.vk.timestamps.slot[i].pool) {
+            vkDestroyQueryPool(_sg.vk.dev, _sg.vk.timestamps.slot[i].pool, 0);
+            _sg.vk.timestamps.slot[i].pool = 0;
+        }
+    }
+    _sg.vk.timestamps.supported = false;
+}
+
+// the frame slot's fence has signalled: read what its last frame timed, then
+// reset its queries and start timing the new frame
+_SOKOL_PRIVATE void _sg_vk_timestamps_after_acquire(void) {
+    if (!_sg.vk.timestamps.supported) {
+        return;
+    }
+    SOKOL_ASSERT(_sg.vk.frame.cmd_buf);
+    const uint32_t frame_slot = _sg.vk.frame_slot;
+    VkQueryPool pool = _sg.vk.timestamps.slot[frame_slot].pool;
+    const uint32_t ended = _sg.vk.timestamps.slot[frame_slot].ended;
+    if (ended & (1u << _SG_VK_FRAME_TIMER)) {
+        for (uint32_t i = 0; i <= SG_MAX_GPU_TIMERS; i++) {
+            uint64_t ticks[2] = { 0, 0 };
+            _sg.vk.timestamps.ms[i] = -1.0;
+            if ((ended & (1u << i)) &&
+                (VK_SUCCESS == vkGetQueryPoolResults(_sg.vk.dev, pool, 2 * i, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)))
+            {
+                const uint64_t elapsed = (ticks[1] - ticks[0]) & _sg.vk.timestamps.valid_mask;
+                _sg.vk.timestamps.ms[i] = (double)elapsed * _sg.vk.timestamps.ns_per_tick * 1e-6;
+            }
+        }
+    }
+    _sg.vk.timestamps.slot[frame_slot].begun = 1u << _SG_VK_FRAME_TIMER;
+    _sg.vk.timestamps.slot[frame_slot].ended = 0;
+    vkCmdResetQueryPool(_sg.vk.frame.cmd_buf, pool, 0, _SG_VK_NUM_TIMESTAMP_QUERIES);
+    vkCmdWriteTimestamp(_sg.vk.frame.cmd_buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, 2 * _SG_VK_FRAME_TIMER);
+}
+
+_SOKOL_PRIVATE void _sg_vk_timestamps_before_submit(void) {
+    if (!_sg.vk.timestamps.supported) {
+        return;
+    }
+    const uint32_t frame_slot = _sg.vk.frame_slot;
+    vkCmdWriteTimestamp(_sg.vk.frame.cmd_buf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _sg.vk.timestamps.slot[frame_slot].pool, 2 * _SG_VK_FRAME_TIMER + 1);
+    _sg.vk.timestamps.slot[frame_slot].ended |= 1u << _SG_VK_FRAME_TIMER;
+}
+
 _SOKOL_PRIVATE void _sg_vk_create_frame_command_pool_and_buffers(void) {
     SOKOL_ASSERT(_sg.vk.dev);
     SOKOL_ASSERT(0 == _sg.vk.frame.cmd_pool);
@@ -20548,6 +20668,7 @@ _SOKOL_PRIVATE void _sg_vk_acquire_frame_command_buffers(void) {
         _sg_vk_uniform_after_acquire();
         _sg_vk_bind_after_acquire();
         _sg_vk_staging_stream_after_acquire();
+        _sg_vk_timestamps_after_acquire();
     }
     SOKOL_ASSERT(_sg.vk.frame.cmd_buf);
 }
@@ -20561,6 +20682,7 @@ _SOKOL_PRIVATE void _sg_vk_submit_frame_command_buffers(void) {
     _sg_vk_staging_stream_before_submit();
     _sg_vk_bind_before_submit();
     _sg_vk_uniform_before_submit();
+    _sg_vk_timestamps_before_submit();
 
     res = vkEndCommandBuffer(_sg.vk.frame.stream_cmd_buf);
     SOKOL_ASSERT(res == VK_SUCCESS);
@@ -20595,6 +20717,37 @@ _SOKOL_PRIVATE void _sg_vk_submit_frame_command_buffers(void) {
     // buffer that was just submitted
 }
 
+_SOKOL_PRIVATE void _sg_vk_begin_gpu_timer(int timer) {
+    if (!_sg.vk.timestamps.supported) {
+        return;
+    }
+    // a timer opened before the frame's first pass starts the frame
+    _sg_vk_acquire_frame_command_buffers();
+    if (0 == _sg.vk.frame.cmd_buf) {
+        return;
+    }
+    const uint32_t frame_slot = _sg.vk.frame_slot;
+    const uint32_t bit = 1u << timer;
+    if (_sg.vk.timestamps.slot[frame_slot].begun & bit) {
+        return;
+    }
+    vkCmdWriteTimestamp(_sg.vk.frame.cmd_buf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _sg.vk.timestamps.slot[frame_slot].pool, 2 * (uint32_t)timer);
+    _sg.vk.timestamps.slot[frame_slot].begun |= bit;
+}
+
+_SOKOL_PRIVATE void _sg_vk_end_gpu_timer(int timer) {
+    if (!_sg.vk.timestamps.supported || (0 == _sg.vk.frame.cmd_buf)) {
+        return;
+    }
+    const uint32_t frame_slot = _sg.vk.frame_slot;
+    const uint32_t bit = 1u << timer;
+    if (!(_sg.vk.timestamps.slot[frame_slot].begun & bit) || (_sg.vk.timestamps.slot[frame_slot].ended & bit)) {
+        return;
+    }
+    vkCmdWriteTimestamp(_sg.vk.frame.cmd_buf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _sg.vk.timestamps.slot[frame_slot].pool, 2 * (uint32_t)timer + 1);
+    _sg.vk.timestamps.slot[frame_slot].ended |= bit;
+}
+
 _SOKOL_PRIVATE void _sg_vk_setup_backend(const sg_desc* desc) {
     SOKOL_ASSERT(desc);
     SOKOL_ASSERT(desc->environment.vulkan.physical_device);
@@ -20613,6 +20766,7 @@ _SOKOL_PRIVATE void _sg_vk_setup_backend(const sg_desc* desc) {
     _sg_vk_init_caps();
     _sg_vk_create_fences();
     _sg_vk_create_frame_command_pool_and_buffers();
+    _sg_vk_timestamps_init();
     _sg_vk_staging_copy_init();
     _sg_vk_staging_stream_init();
     _sg_vk_uniform_init();
@@ -20629,6 +20783,7 @@ _SOKOL_PRIVATE void _sg_vk_discard_backend(void) {
     _sg_vk_uniform_discard();
     _sg_vk_staging_stream_discard();
     _sg_vk_staging_copy_discard();
+    _sg_vk_timestamps_discard();
     _sg_vk_destroy_frame_command_pool();
     _sg_vk_destroy_fences();
     _sg_track_discard(&_sg.vk.track.images);
@@ -25496,6 +25651,58 @@ SOKOL_API_IMPL void sg_commit(void) {
     _sg.frame_index++;
 }
 
+SOKOL_API_IMPL bool sg_gpu_timers_supported(void) {
+    SOKOL_ASSERT(_sg.valid);
+    #if defined(SOKOL_VULKAN)
+    return _sg.vk.timestamps.supported;
+    #else
+    return false;
+    #endif
+}
+
+SOKOL_API_IMPL void sg_begin_gpu_timer(int timer) {
+    SOKOL_ASSERT(_sg.valid);
+    SOKOL_ASSERT((timer >= 0) && (timer < SG_MAX_GPU_TIMERS));
+    #if defined(SOKOL_VULKAN)
+    _sg_vk_begin_gpu_timer(timer);
+    #else
+    _SOKOL_UNUSED(timer);
+    #endif
+}
+
+SOKOL_API_IMPL void sg_end_gpu_timer(int timer) {
+    SOKOL_ASSERT(_sg.valid);
+    SOKOL_ASSERT((timer >= 0) && (timer < SG_MAX_GPU_TIMERS));
+    #if defined(SOKOL_VULKAN)
+    _sg_vk_end_gpu_timer(timer);
+    #else
+    _SOKOL_UNUSED(timer);
+    #endif
+}
+
+SOKOL_API_IMPL double sg_query_gpu_timer(int timer) {
+    SOKOL_ASSERT(_sg.valid);
+    SOKOL_ASSERT((timer >= 0) && (timer < SG_MAX_GPU_TIMERS));
+    #if defined(SOKOL_VULKAN)
+    return _sg.vk.timestamps.ms[timer];
+    #else
+    _SOKOL_UNUSED(timer);
+    return -1.0;
+    #endif
+}
+
+SOKOL_API_IMPL double sg_query_gpu_frame_time(void) {
+    SOKOL_ASSERT(_sg.valid);
+    #if defined(SOKOL_VULKAN)
+    return _sg.vk.timestamps.ms[_SG_VK_FRAME_TIMER];
+    #elif defined(SOKOL_METAL)
+    const uint64_t ns = __atomic_load_n(&_sg.mtl.gpu_frame_ns, __ATOMIC_RELAXED);
+    return (ns > 0) ? ((double)ns * 1e-6) : -1.0;
+    #else
+    return -1.0;
+    #endif
+}
+
 SOKOL_API_IMPL void sg_reset_state_cache(void) {
     SOKOL_ASSERT(_sg.valid);
     _sg_reset_state_cache();
@@ -0,0 +1,160 @@
+#include "ApuTimeline.h"
+#include <algorithm>
+
+namespace {
+
+// Sweep units are clocked every other frame counter step (4-step mode)
+constexpr double SWEEP_RATE = 120.0;
+constexpr int MAX_SWEEP_STEPS = 64;
+
+// Writes an APU can log between two captures: a render chunk of DMC-driven
+// PCM comes to about a thousand
+constexpr size_t STAGING_WRITES = 8192;
+
+}  // namespace
+
+ApuTimeline::ApuTimeline(size_t capacity) {
+    ring_.resize(capacity);
+    reset();
+}
+
+void ApuTimeline::attach(Nes_Apu* apu) {
+    if (apu == apu_) return;
+    apu_ = apu;
+    has_end_ = false;
+    if (!apu_) return;
+    staging_.resize(STAGING_WRITES);
+    apu_->set_write_log(staging_.data(), static_cast<int>(staging_.size()));
+}
+
+void ApuTimeline::discard() {
+    if (apu_) apu_->clear_write_log();
+    has_end_ = false;
+}
+
+void ApuTimeline::push(const Event& event) {
+    if (ring_.push(&event, 1) == 0) dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ApuTimeline::capture(int64_t start, int64_t span, int64_t lead) {
+    if (!apu_) return;
+    const int64_t end = start + span + lead;
+    const int64_t from = has_end_ ? std::min(last_end_, end) : start;
+    last_end_ = end;
+    has_end_ = true;
+    const Nes_Apu::write_t* log = apu_->write_log();
+    const int count = apu_->write_log_count();
+    const int64_t clocks = apu_->write_log_clocks();
+    if (count == static_cast<int>(staging_.size())) dropped_.fetch_add(1, std::memory_order_relaxed);
+
+    for (int i = 0; i < count; ++i) {
+        const Nes_Apu::write_t& write = log[i];
+        const int64_t offset = clocks > 0 ? std::min<int64_t>(write.time, clocks) * (end - from) / clocks : 0;
+        const unsigned index = write.addr - Nes_Apu::start_addr;
+        push({from + offset, static_cast<uint8_t>(index >> 2), static_cast<uint8_t>(index & 3), write.data});
+    }
+    apu_->clear_write_log();
+
+    // The block's end as the APU has it: envelopes, counters and sweeps the
+    // writes alone don't tell
+    int periods[Nes_Apu::osc_count], lengths[Nes_Apu::osc_count], amplitudes[Nes_Apu::osc_count];
+    int volumes[Nes_Apu::osc_count];
+    apu_->osc_state(periods, lengths, amplitudes);
+    apu_->osc_volumes(volumes);
+    for (int o = 0; o < Nes_Apu::osc_count; ++o) {
+        const uint8_t channel = static_cast<uint8_t>(o);
+        const int volume = std::clamp(volumes[o], 0, 0xFF);
+        push({end, channel, 0, static_cast<uint16_t>(apu_->osc_register(o, 0))});
+        push({end, channel, SAMPLED_PERIOD, static_cast<uint16_t>(periods[o])});
+        push({end, channel, SAMPLED_VOLUME, static_cast<uint16_t>(lengths[o] > 0 ? 0x100 | volume : 0)});
+    }
+}
+
+void ApuTimeline::reset() {
+    for (Osc& osc : osc_) osc = Osc();
+    enables_ = 0x1F;
+}
+
+void ApuTimeline::apply(const Event& event) {
+    if (event.channel == CONTROL) {
+        // $4015: a cleared bit silences its oscillator at once; the DMC starts on a set one
+        if (event.reg != 1) return;
+        enables_ = event.value & 0x1F;
+        for (int o = 0; o < Nes_Apu::osc_count; ++o) {
+            if (!((enables_ >> o) & 1)) osc_[o].sounding = false;
+        }
+        if (enables_ & 0x10) osc_[4].sounding = true;
+        return;
+    }
+    if (event.channel >= Nes_Apu::osc_count) return;
+
+    const int o = event.channel;
+    Osc& osc = osc_[o];
+    const int value = event.value;
+    // Writes go to the period as swept so far
+    osc.period = periodAt(o, event.time);
+    osc.sweep_from = event.time;
+    switch (event.reg) {
+    case 0:
+        osc.reg0 = value;
+        // Constant volume takes effect at once; an envelope waits for the next key-on
+        if ((o == 0 || o == 1 || o == 3) && (value & 0x10) && osc.sounding) osc.volume = value & 0x0F;
+        break;
+    case 1:
+        if (o < 2) osc.sweep = value;
+        break;
+    case 2:
+        if (o < 4) osc.period = (osc.period & 0x700) | value;
+        break;
+    case 3:
+        if (o == 4) break;
+        osc.period = (osc.period & 0xFF) | ((value & 0x07) << 8);
+        // Loading the length counter keys the note on, the envelope from 15
+        if ((enables_ >> o) & 1) {
+            if (o == 2) {
+                osc.sounding = (osc.reg0 & 0x7F) != 0;  // Linear counter reload
+                osc.volume = 15;
+            } else {
+                osc.sounding = true;
+                osc.volume = (osc.reg0 & 0x10) ? osc.reg0 & 0x0F : 15;
+            }
+        }
+        break;
+    case SAMPLED_PERIOD:
+        osc.period = value;
+        break;
+    case SAMPLED_VOLUME:
+        osc.sounding = (value & 0x100) != 0;
+        osc.volume = value & 0xFF;
+        break;
+    default:
+        break;
+    }
+}
+
+int ApuTimeline::periodAt(int o, int64_t time) const {
+    const Osc& osc = osc_[o];
+    const int shift = osc.sweep & 0x07;
+    if (o >= 2 || !(osc.sweep & 0x80) || shift == 0 || clock_rate_ <= 0.0 || time <= osc.sweep_from) return osc.period;
+
+    // As Nes_Square::clock_sweep(): square 1 negates in one's complement
+    const int divider = ((osc.sweep >> 4) & 0x07) + 1;
+    int steps = static_cast<int>((time - osc.sweep_from) * SWEEP_RATE / (clock_rate_ * divider));
+    steps = std::min(steps, MAX_SWEEP_STEPS);
+    int period = osc.period;
+    for (int i = 0; i < steps && period >= 8; ++i) {
+        int offset = period >> shift;
+        if (osc.sweep & 0x08) offset = (o == 0 ? -1 : 0) - offset;
+        if (period + offset >= 0x800) break;
+        period += offset;
+    }
+    return period;
+}
+
+void ApuTimeline::fill(Voices& voices, int64_t time) const {
+    for (int o = 0; o < Nes_Apu::osc_count; ++o) {
+        voices.periods[o] = periodAt(o, time);
+        voices.lengths[o] = osc_[o].sounding ? 1 : 0;
+        voices.volumes[o] = osc_[o].sounding ? osc_[o].volume : 0;
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "SpscRing.h"
+#include "gme/Nes_Apu.h"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// The 2A03 APU's register writes as they happened inside each audio block,
+// so visualizers see vibrato, arpeggios and key-ons that come and go
+// between two once-a-block register samples. The producer (the thread
+// running the Nes_Apu) drains the APU's write log after each block with
+// capture(), which places the writes on the consumer's clock and closes the
+// block with the oscillators' sampled state; replay() then applies them in
+// order to a shadow of the registers, giving the oscillators' state at any
+// point in between in the form ChannelTable::sampleApu() takes. No
+// emulation is repeated: pitch comes from the period writes, and what only
+// the APU knows (envelopes, length counters, sweeps) is corrected by each
+// block's sample.
+//
+// One producer and one consumer thread, as SpscRing.
+class ApuTimeline {
+public:
+    struct Event {
+        int64_t time;      // On the producer's clock: stream frames, CPU cycles
+        uint8_t channel;   // (addr - $4000) / 4: 0-4 the oscillators, 5 $4015/$4017
+        uint8_t reg;       // addr & 3, or SAMPLED_* for a block's closing sample
+        uint16_t value;
+    };
+    static constexpr uint8_t CONTROL = 5;
+    static constexpr uint8_t SAMPLED_PERIOD = 4;
+    static constexpr uint8_t SAMPLED_VOLUME = 5;  // 0x100 | volume while sounding, else 0
+
+    // The shadow's oscillators, as sampleApu(periods, lengths, volumes, volumes)
+    struct Voices {
+        int periods[Nes_Apu::osc_count];
+        int lengths[Nes_Apu::osc_count];  // 1 while sounding
+        int volumes[Nes_Apu::osc_count];
+    };
+
+    explicit ApuTimeline(size_t capacity = 16384);
+    ApuTimeline(const ApuTimeline&) = delete;
+    ApuTimeline& operator=(const ApuTimeline&) = delete;
+
+    // Producer side. attach() points apu's write log at this timeline's
+    // staging buffer, leaving the one before alone as it may be gone
+    // (nullptr: capture nothing). capture() empties it into the ring after
+    // a block [start, start + span) went out, when the APU has run lead
+    // units past its end (an emulator's own buffering): the clocks since the
+    // last capture map onto the time since then, closed by a sample there.
+    void attach(Nes_Apu* apu);
+    void capture(int64_t start, int64_t span, int64_t lead = 0);
+    // Forget the writes since the last capture (speculative frames)
+    void discard();
+
+    // Consumer side: apply the events up to until, calling changed(voices,
+    // time) after each clock's worth and once more at until. reset()
+    // forgets the shadow. Square sweeps move the pitch between writes, at
+    // the clock rate (event time units a second) set here.
+    template <typename Changed>
+    void replay(int64_t until, Changed&& changed);
+    void reset();
+    void setClockRate(double units_per_second) { clock_rate_ = units_per_second; }
+
+    // Events lost to a full ring or APU log
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Osc {
+        int period = 0;          // As of sweep_from
+        int64_t sweep_from = 0;
+        int sweep = 0;           // $4001/$4005
+        int reg0 = 0;
+        int volume = 0;
+        bool sounding = false;
+    };
+
+    void push(const Event& event);
+    void apply(const Event& event);
+    int periodAt(int osc, int64_t time) const;
+    void fill(Voices& voices, int64_t time) const;
+
+    Nes_Apu* apu_ = nullptr;
+    std::vector<Nes_Apu::write_t> staging_;
+    int64_t last_end_ = 0;   // Where the last capture left the APU
+    bool has_end_ = false;
+    SpscRing<Event> ring_;
+    std::atomic<uint32_t> dropped_{0};
+
+    // Consumer state
+    Event front_ = {};
+    bool has_front_ = false;
+    Osc osc_[Nes_Apu::osc_count];
+    int enables_ = 0;
+    double clock_rate_ = 0.0;
+};
+
+template <typename Changed>
+void ApuTimeline::replay(int64_t until, Changed&& changed) {
+    Voices voices;
+    for (;;) {
+        if (!has_front_) {
+            if (ring_.pop(&front_, 1) == 0) break;
+            has_front_ = true;
+        }
+        if (front_.time > until) break;
+
+        // Writes on one clock are one change, as is a block's closing sample
+        const int64_t time = front_.time;
+        do {
+            apply(front_);
+            has_front_ = ring_.pop(&front_, 1) == 1;
+        } while (has_front_ && front_.time == time);
+        fill(voices, time);
+        changed(static_cast<const Voices&>(voices), time);
+    }
+    fill(voices, until);
+    changed(static_cast<const Voices&>(voices), until);
+}
@@ -0,0 +1,719 @@
+#include "AudioKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#if defined(__arm__) && defined(__linux__) && !defined(FC_Q15_ANALYSIS)
+#include <sys/auxv.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIO_KERNELS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define AUDIO_KERNELS_NEON 1
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define AUDIO_KERNELS_WASM 1
+#include <wasm_simd128.h>
+#endif
+
+static constexpr float S16_SCALE = 1.0f / 32768.0f;
+
+void AudioKernels::s16ToF32(const short* in, float* out, int count, float gain) {
+    const float scale = gain * S16_SCALE;
+    int i = 0;
+
+#if AUDIO_KERNELS_SSE2
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by placing each int16 in the high half and shifting down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+#elif AUDIO_KERNELS_NEON
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t s = vld1q_s16(in + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+        vst1q_f32(out + i, vmulq_n_f32(lo, scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(hi, scale));
+    }
+#elif AUDIO_KERNELS_WASM
+    const v128_t vscale = wasm_f32x4_splat(scale);
+    for (; i + 8 <= count; i += 8) {
+        v128_t s = wasm_v128_load(in + i);
+        v128_t lo = wasm_f32x4_convert_i32x4(wasm_i32x4_extend_low_i16x8(s));
+        v128_t hi = wasm_f32x4_convert_i32x4(wasm_i32x4_extend_high_i16x8(s));
+        wasm_v128_store(out + i, wasm_f32x4_mul(lo, vscale));
+        wasm_v128_store(out + i + 4, wasm_f32x4_mul(hi, vscale));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        out[i] = in[i] * scale;
+    }
+}
+
+void AudioKernels::s16MonoToF32Stereo(const short* in, float* out, int frames, float gain) {
+    const float scale = gain * S16_SCALE;
+    int i = 0;
+
+#if AUDIO_KERNELS_SSE2
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 4 <= frames; i += 4) {
+        // Load 4 mono samples into the low half and sign-extend
+        __m128i s = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+        __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)), vscale);
+        // a b c d -> a a b b, c c d d
+        _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(f, f));
+        _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(f, f));
+    }
+#elif AUDIO_KERNELS_NEON
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t f = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(in + i))), scale);
+        float32x4x2_t lr = vzipq_f32(f, f);
+        vst1q_f32(out + i * 2, lr.val[0]);
+        vst1q_f32(out + i * 2 + 4, lr.val[1]);
+    }
+#elif AUDIO_KERNELS_WASM
+    const v128_t vscale = wasm_f32x4_splat(scale);
+    for (; i + 4 <= frames; i += 4) {
+        v128_t s = wasm_v128_load64_zero(in + i);
+        v128_t f = wasm_f32x4_mul(wasm_f32x4_convert_i32x4(wasm_i32x4_extend_low_i16x8(s)), vscale);
+        wasm_v128_store(out + i * 2, wasm_i32x4_shuffle(f, f, 0, 0, 1, 1));
+        wasm_v128_store(out + i * 2 + 4, wasm_i32x4_shuffle(f, f, 2, 2, 3, 3));
+    }
+#endif
+
+    for (; i < frames; ++i) {
+        float sample = in[i] * scale;
+        out[i * 2] = sample;      // Left channel
+        out[i * 2 + 1] = sample;  // Right channel
+    }
+}
+
+void AudioKernels::s16StereoAnalyze(const short* in, float* left, float* right, float* mono, int frames,
+                                   float* sum_squares, float* peak) {
+    float sum = 0.0f;
+    float max_abs = *peak;
+    int i = 0;
+
+#if AUDIO_KERNELS_SSE2
+    const __m128 vscale = _mm_set1_ps(S16_SCALE);
+    const __m128 vhalf = _mm_set1_ps(0.5f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 vsum = _mm_setzero_ps();
+    __m128 vpeak = _mm_set1_ps(max_abs);
+    for (; i + 4 <= frames; i += 4) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+        __m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)), vscale);  // L0 R0 L1 R1
+        __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)), vscale);  // L2 R2 L3 R3
+        __m128 l = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 r = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 m = _mm_mul_ps(_mm_add_ps(l, r), vhalf);
+        _mm_storeu_ps(left + i, l);
+        _mm_storeu_ps(right + i, r);
+        _mm_storeu_ps(mono + i, m);
+        vsum = _mm_add_ps(vsum, _mm_mul_ps(m, m));
+        vpeak = _mm_max_ps(vpeak, _mm_max_ps(_mm_andnot_ps(sign, l), _mm_andnot_ps(sign, r)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, vsum);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_store_ps(lanes, vpeak);
+    max_abs = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif AUDIO_KERNELS_NEON
+    float32x4_t vsum = vdupq_n_f32(0.0f);
+    float32x4_t vpeak = vdupq_n_f32(max_abs);
+    for (; i + 4 <= frames; i += 4) {
+        int16x4x2_t s = vld2_s16(in + i * 2);  // Deinterleaves left / right
+        float32x4_t l = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(s.val[0])), S16_SCALE);
+        float32x4_t r = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(s.val[1])), S16_SCALE);
+        float32x4_t m = vmulq_n_f32(vaddq_f32(l, r), 0.5f);
+        vst1q_f32(left + i, l);
+        vst1q_f32(right + i, r);
+        vst1q_f32(mono + i, m);
+        vsum = vmlaq_f32(vsum, m, m);
+        vpeak = vmaxq_f32(vpeak, vmaxq_f32(vabsq_f32(l), vabsq_f32(r)));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, vsum);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    vst1q_f32(lanes, vpeak);
+    max_abs = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif AUDIO_KERNELS_WASM
+    const v128_t vscale = wasm_f32x4_splat(S16_SCALE);
+    const v128_t vhalf = wasm_f32x4_splat(0.5f);
+    v128_t vsum = wasm_f32x4_splat(0.0f);
+    v128_t vpeak = wasm_f32x4_splat(max_abs);
+    for (; i + 4 <= frames; i += 4) {
+        v128_t s = wasm_v128_load(in + i * 2);
+        v128_t lo = wasm_f32x4_mul(wasm_f32x4_convert_i32x4(wasm_i32x4_extend_low_i16x8(s)), vscale);
+        v128_t hi = wasm_f32x4_mul(wasm_f32x4_convert_i32x4(wasm_i32x4_extend_high_i16x8(s)), vscale);
+        v128_t l = wasm_i32x4_shuffle(lo, hi, 0, 2, 4, 6);
+        v128_t r = wasm_i32x4_shuffle(lo, hi, 1, 3, 5, 7);
+        v128_t m = wasm_f32x4_mul(wasm_f32x4_add(l, r), vhalf);
+        wasm_v128_store(left + i, l);
+        wasm_v128_store(right + i, r);
+        wasm_v128_store(mono + i, m);
+        vsum = wasm_f32x4_add(vsum, wasm_f32x4_mul(m, m));
+        vpeak = wasm_f32x4_max(vpeak, wasm_f32x4_max(wasm_f32x4_abs(l), wasm_f32x4_abs(r)));
+    }
+    sum = (wasm_f32x4_extract_lane(vsum, 0) + wasm_f32x4_extract_lane(vsum, 1)) +
+          (wasm_f32x4_extract_lane(vsum, 2) + wasm_f32x4_extract_lane(vsum, 3));
+    max_abs = std::max(std::max(wasm_f32x4_extract_lane(vpeak, 0), wasm_f32x4_extract_lane(vpeak, 1)),
+                       std::max(wasm_f32x4_extract_lane(vpeak, 2), wasm_f32x4_extract_lane(vpeak, 3)));
+#endif
+
+    for (; i < frames; ++i) {
+        float l = in[i * 2] * S16_SCALE;
+        float r = in[i * 2 + 1] * S16_SCALE;
+        float m = (l + r) * 0.5f;
+        left[i] = l;
+        right[i] = r;
+        mono[i] = m;
+        sum += m * m;
+        max_abs = std::max(max_abs, std::max(std::abs(l), std::abs(r)));
+    }
+
+    *sum_squares += sum;
+    *peak = max_abs;
+}
+
+void AudioKernels::s16MonoAnalyze(const short* in, float* out, int frames, float* sum_squares, float* peak) {
+    float sum = 0.0f;
+    float max_abs = *peak;
+    int i = 0;
+
+#if AUDIO_KERNELS_SSE2
+    const __m128 vscale = _mm_set1_ps(S16_SCALE);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 vsum = _mm_setzero_ps();
+    __m128 vpeak = _mm_set1_ps(max_abs);
+    for (; i + 8 <= frames; i += 8) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)), vscale);
+        __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)), vscale);
+        _mm_storeu_ps(out + i, lo);
+        _mm_storeu_ps(out + i + 4, hi);
+        vsum = _mm_add_ps(vsum, _mm_add_ps(_mm_mul_ps(lo, lo), _mm_mul_ps(hi, hi)));
+        vpeak = _mm_max_ps(vpeak, _mm_max_ps(_mm_andnot_ps(sign, lo), _mm_andnot_ps(sign, hi)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, vsum);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_store_ps(lanes, vpeak);
+    max_abs = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif AUDIO_KERNELS_NEON
+    float32x4_t vsum = vdupq_n_f32(0.0f);
+    float32x4_t vpeak = vdupq_n_f32(max_abs);
+    for (; i + 8 <= frames; i += 8) {
+        int16x8_t s = vld1q_s16(in + i);
+        float32x4_t lo = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), S16_SCALE);
+        float32x4_t hi = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), S16_SCALE);
+        vst1q_f32(out + i, lo);
+        vst1q_f32(out + i + 4, hi);
+        vsum = vmlaq_f32(vmlaq_f32(vsum, lo, lo), hi, hi);
+        vpeak = vmaxq_f32(vpeak, vmaxq_f32(vabsq_f32(lo), vabsq_f32(hi)));
+    }
+    float lanes[4];
+    vst1q_f32(lanes, vsum);
+    sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    vst1q_f32(lanes, vpeak);
+    max_abs = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif AUDIO_KERNELS_WASM
+    const v128_t vscale = wasm_f32x4_splat(S16_SCALE);
+    v128_t vsum = wasm_f32x4_splat(0.0f);
+    v128_t vpeak = wasm_f32x4_splat(max_abs);
+    for (; i + 8 <= frames; i += 8) {
+        v128_t s = wasm_v128_load(in + i);
+        v128_t lo = wasm_f32x4_mul(wasm_f32x4_convert_i32x4(wasm_i32x4_extend_low_i16x8(s)), vscale);
+        v128_t hi = wasm_f32x4_mul(wasm_f32x4_convert_i32x4(wasm_i32x4_extend_high_i16x8(s)), vscale);
+        wasm_v128_store(out + i, lo);
+        wasm_v128_store(out + i + 4, hi);
+        vsum = wasm_f32x4_add(vsum, wasm_f32x4_add(wasm_f32x4_mul(lo, lo), wasm_f32x4_mul(hi, hi)));
+        vpeak = wasm_f32x4_max(vpeak, wasm_f32x4_max(wasm_f32x4_abs(lo), wasm_f32x4_abs(hi)));
+    }
+    sum = (wasm_f32x4_extract_lane(vsum, 0) + wasm_f32x4_extract_lane(vsum, 1)) +
+          (wasm_f32x4_extract_lane(vsum, 2) + wasm_f32x4_extract_lane(vsum, 3));
+    max_abs = std::max(std::max(wasm_f32x4_extract_lane(vpeak, 0), wasm_f32x4_extract_lane(vpeak, 1)),
+                       std::max(wasm_f32x4_extract_lane(vpeak, 2), wasm_f32x4_extract_lane(vpeak, 3)));
+#endif
+
+    for (; i < frames; ++i) {
+        float m = in[i] * S16_SCALE;
+        out[i] = m;
+        sum += m * m;
+        max_abs = std::max(max_abs, std::abs(m));
+    }
+
+    *sum_squares += sum;
+    *peak = max_abs;
+}
+
+void AudioKernels::applyGain(float* samples, int count, float gain) {
+    if (gain == 1.0f) return;
+    int i = 0;
+
+#if AUDIO_KERNELS_SSE2
+    const __m128 vgain = _mm_set1_ps(gain);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), vgain));
+    }
+#elif AUDIO_KERNELS_NEON
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(samples + i, vmulq_n_f32(vld1q_f32(samples + i), gain));
+    }
+#elif AUDIO_KERNELS_WASM
+    const v128_t vgain = wasm_f32x4_splat(gain);
+    for (; i + 4 <= count; i += 4) {
+        wasm_v128_store(samples + i, wasm_f32x4_mul(wasm_v128_load(samples + i), vgain));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        samples[i] *= gain;
+    }
+}
+
+void AudioKernels::complexPower(const float* in, float* out, int count) {
+    int i = 0;
+
+#if AUDIO_KERNELS_SSE2
+    for (; i + 4 <= count; i += 4) {
+        __m128 a = _mm_loadu_ps(in + i * 2);      // r0 i0 r1 i1
+        __m128 b = _mm_loadu_ps(in + i * 2 + 4);  // r2 i2 r3 i3
+        a = _mm_mul_ps(a, a);
+        b = _mm_mul_ps(b, b);
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out + i, _mm_add_ps(re, im));
+    }
+#elif AUDIO_KERNELS_NEON
+    for (; i + 4 <= count; i += 4) {
+        float32x4x2_t c = vld2q_f32(in + i * 2);  // Deinterleaves re / im
+        vst1q_f32(out + i, vmlaq_f32(vmulq_f32(c.val[0], c.val[0]), c.val[1], c.val[1]));
+    }
+#elif AUDIO_KERNELS_WASM
+    for (; i + 4 <= count; i += 4) {
+        v128_t a = wasm_v128_load(in + i * 2);
+        v128_t b = wasm_v128_load(in + i * 2 + 4);
+        a = wasm_f32x4_mul(a, a);
+        b = wasm_f32x4_mul(b, b);
+        v128_t re = wasm_i32x4_shuffle(a, b, 0, 2, 4, 6);
+        v128_t im = wasm_i32x4_shuffle(a, b, 1, 3, 5, 7);
+        wasm_v128_store(out + i, wasm_f32x4_add(re, im));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        float re = in[i * 2];
+        float im = in[i * 2 + 1];
+        out[i] = re * re + im * im;
+    }
+}
+
+void AudioKernels::fftButterflies(float* data, int half, const float* twiddles, int stride) {
+    float* upper = data + half * 2;
+    int j = 0;
+
+    // Two butterflies per vector: v = x * w is x * w.re + swap(x) * w.im
+    // with the real lane's sign flipped
+#if AUDIO_KERNELS_SSE2
+    const __m128 flip = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    for (; j + 2 <= half; j += 2) {
+        __m128 w = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(twiddles + j * stride * 2));
+        w = _mm_loadh_pi(w, reinterpret_cast<const __m64*>(twiddles + (j + 1) * stride * 2));
+        const __m128 x = _mm_loadu_ps(upper + j * 2);
+        const __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+        const __m128 wi = _mm_xor_ps(_mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1)), flip);
+        const __m128 v = _mm_add_ps(_mm_mul_ps(x, wr),
+                                    _mm_mul_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1)), wi));
+        const __m128 u = _mm_loadu_ps(data + j * 2);
+        _mm_storeu_ps(data + j * 2, _mm_add_ps(u, v));
+        _mm_storeu_ps(upper + j * 2, _mm_sub_ps(u, v));
+    }
+#elif AUDIO_KERNELS_NEON
+    const float32x4_t flip = {-1.0f, 1.0f, -1.0f, 1.0f};
+    for (; j + 2 <= half; j += 2) {
+        const float32x4_t w = vcombine_f32(vld1_f32(twiddles + j * stride * 2),
+                                           vld1_f32(twiddles + (j + 1) * stride * 2));
+        const float32x4_t x = vld1q_f32(upper + j * 2);
+        const float32x4x2_t parts = vtrnq_f32(w, w);  // wr wr wr' wr', wi wi wi' wi'
+        const float32x4_t v = vaddq_f32(vmulq_f32(x, parts.val[0]),
+                                        vmulq_f32(vrev64q_f32(x), vmulq_f32(parts.val[1], flip)));
+        const float32x4_t u = vld1q_f32(data + j * 2);
+        vst1q_f32(data + j * 2, vaddq_f32(u, v));
+        vst1q_f32(upper + j * 2, vsubq_f32(u, v));
+    }
+#elif AUDIO_KERNELS_WASM
+    const v128_t flip = wasm_f32x4_make(-0.0f, 0.0f, -0.0f, 0.0f);
+    for (; j + 2 <= half; j += 2) {
+        v128_t w = wasm_v128_load64_zero(twiddles + j * stride * 2);
+        w = wasm_v128_load64_lane(twiddles + (j + 1) * stride * 2, w, 1);
+        const v128_t x = wasm_v128_load(upper + j * 2);
+        const v128_t wr = wasm_i32x4_shuffle(w, w, 0, 0, 2, 2);
+        const v128_t wi = wasm_v128_xor(wasm_i32x4_shuffle(w, w, 1, 1, 3, 3), flip);
+        const v128_t v = wasm_f32x4_add(wasm_f32x4_mul(x, wr), wasm_f32x4_mul(wasm_i32x4_shuffle(x, x, 1, 0, 3, 2), wi));
+        const v128_t u = wasm_v128_load(data + j * 2);
+        wasm_v128_store(data + j * 2, wasm_f32x4_add(u, v));
+        wasm_v128_store(upper + j * 2, wasm_f32x4_sub(u, v));
+    }
+#endif
+
+    for (; j < half; ++j) {
+        const float wr = twiddles[j * stride * 2];
+        const float wi = twiddles[j * stride * 2 + 1];
+        const float xr = upper[j * 2];
+        const float xi = upper[j * 2 + 1];
+        const float vr = xr * wr - xi * wi;
+        const float vi = xr * wi + xi * wr;
+        const float ur = data[j * 2];
+        const float ui = data[j * 2 + 1];
+        data[j * 2] = ur + vr;
+        data[j * 2 + 1] = ui + vi;
+        upper[j * 2] = ur - vr;
+        upper[j * 2 + 1] = ui - vi;
+    }
+}
+
+void AudioKernels::fftButterfliesLanes(float* re, float* im, int half, int lanes, const float* twiddles,
+                                       int stride) {
+    for (int j = 0; j < half; ++j) {
+        const float wr = twiddles[j * stride * 2];
+        const float wi = twiddles[j * stride * 2 + 1];
+        float* ur = re + static_cast<size_t>(j) * lanes;
+        float* ui = im + static_cast<size_t>(j) * lanes;
+        float* xr = ur + static_cast<size_t>(half) * lanes;
+        float* xi = ui + static_cast<size_t>(half) * lanes;
+        int c = 0;
+
+#if AUDIO_KERNELS_SSE2
+        const __m128 vwr = _mm_set1_ps(wr);
+        const __m128 vwi = _mm_set1_ps(wi);
+        for (; c + 4 <= lanes; c += 4) {
+            const __m128 r = _mm_loadu_ps(xr + c);
+            const __m128 i = _mm_loadu_ps(xi + c);
+            const __m128 vr = _mm_sub_ps(_mm_mul_ps(r, vwr), _mm_mul_ps(i, vwi));
+            const __m128 vi = _mm_add_ps(_mm_mul_ps(r, vwi), _mm_mul_ps(i, vwr));
+            const __m128 a = _mm_loadu_ps(ur + c);
+            const __m128 b = _mm_loadu_ps(ui + c);
+            _mm_storeu_ps(ur + c, _mm_add_ps(a, vr));
+            _mm_storeu_ps(ui + c, _mm_add_ps(b, vi));
+            _mm_storeu_ps(xr + c, _mm_sub_ps(a, vr));
+            _mm_storeu_ps(xi + c, _mm_sub_ps(b, vi));
+        }
+#elif AUDIO_KERNELS_NEON
+        for (; c + 4 <= lanes; c += 4) {
+            const float32x4_t r = vld1q_f32(xr + c);
+            const float32x4_t i = vld1q_f32(xi + c);
+            const float32x4_t vr = vmlsq_n_f32(vmulq_n_f32(r, wr), i, wi);
+            const float32x4_t vi = vmlaq_n_f32(vmulq_n_f32(r, wi), i, wr);
+            const float32x4_t a = vld1q_f32(ur + c);
+            const float32x4_t b = vld1q_f32(ui + c);
+            vst1q_f32(ur + c, vaddq_f32(a, vr));
+            vst1q_f32(ui + c, vaddq_f32(b, vi));
+            vst1q_f32(xr + c, vsubq_f32(a, vr));
+            vst1q_f32(xi + c, vsubq_f32(b, vi));
+        }
+#elif AUDIO_KERNELS_WASM
+        const v128_t vwr = wasm_f32x4_splat(wr);
+        const v128_t vwi = wasm_f32x4_splat(wi);
+        for (; c + 4 <= lanes; c += 4) {
+            const v128_t r = wasm_v128_load(xr + c);
+            const v128_t i = wasm_v128_load(xi + c);
+            const v128_t vr = wasm_f32x4_sub(wasm_f32x4_mul(r, vwr), wasm_f32x4_mul(i, vwi));
+            const v128_t vi = wasm_f32x4_add(wasm_f32x4_mul(r, vwi), wasm_f32x4_mul(i, vwr));
+            const v128_t a = wasm_v128_load(ur + c);
+            const v128_t b = wasm_v128_load(ui + c);
+            wasm_v128_store(ur + c, wasm_f32x4_add(a, vr));
+            wasm_v128_store(ui + c, wasm_f32x4_add(b, vi));
+            wasm_v128_store(xr + c, wasm_f32x4_sub(a, vr));
+            wasm_v128_store(xi + c, wasm_f32x4_sub(b, vi));
+        }
+#endif
+
+        for (; c < lanes; ++c) {
+            const float vr = xr[c] * wr - xi[c] * wi;
+            const float vi = xr[c] * wi + xi[c] * wr;
+            const float a = ur[c];
+            const float b = ui[c];
+            ur[c] = a + vr;
+            ui[c] = b + vi;
+            xr[c] = a - vr;
+            xi[c] = b - vi;
+        }
+    }
+}
+
+int AudioKernels::findLastRisingCross(const float* samples, int count, float level) {
+    int i = count - 1;
+
+    // Scalar until the remaining candidates [1, i] split into blocks of 4
+    for (; i >= 1 && (i & 3) != 0; --i) {
+        if (samples[i - 1] < level && samples[i] >= level) return i;
+    }
+
+#if AUDIO_KERNELS_SSE2
+    const __m128 vlevel = _mm_set1_ps(level);
+    for (; i >= 4; i -= 4) {
+        const int base = i - 3;
+        __m128 below = _mm_cmplt_ps(_mm_loadu_ps(samples + base - 1), vlevel);
+        __m128 above = _mm_cmpge_ps(_mm_loadu_ps(samples + base), vlevel);
+        int mask = _mm_movemask_ps(_mm_and_ps(below, above));
+        if (mask) return base + (mask & 8 ? 3 : mask & 4 ? 2 : mask & 2 ? 1 : 0);
+    }
+#elif AUDIO_KERNELS_NEON
+    const float32x4_t vlevel = vdupq_n_f32(level);
+    for (; i >= 4; i -= 4) {
+        const int base = i - 3;
+        uint32x4_t hit = vandq_u32(vcltq_f32(vld1q_f32(samples + base - 1), vlevel),
+                                   vcgeq_f32(vld1q_f32(samples + base), vlevel));
+        uint32x2_t any = vorr_u32(vget_low_u32(hit), vget_high_u32(hit));
+        if (vget_lane_u32(any, 0) | vget_lane_u32(any, 1)) {
+            if (vgetq_lane_u32(hit, 3)) return base + 3;
+            if (vgetq_lane_u32(hit, 2)) return base + 2;
+            if (vgetq_lane_u32(hit, 1)) return base + 1;
+            return base;
+        }
+    }
+#elif AUDIO_KERNELS_WASM
+    const v128_t vlevel = wasm_f32x4_splat(level);
+    for (; i >= 4; i -= 4) {
+        const int base = i - 3;
+        v128_t hit = wasm_v128_and(wasm_f32x4_lt(wasm_v128_load(samples + base - 1), vlevel),
+                                   wasm_f32x4_ge(wasm_v128_load(samples + base), vlevel));
+        int mask = static_cast<int>(wasm_i32x4_bitmask(hit));
+        if (mask) return base + (mask & 8 ? 3 : mask & 4 ? 2 : mask & 2 ? 1 : 0);
+    }
+#endif
+
+    for (; i >= 1; --i) {
+        if (samples[i - 1] < level && samples[i] >= level) return i;
+    }
+    return -1;
+}
+
+void AudioKernels::s16StereoAnalyzeQ15(const short* in, float* left, float* right, float* mono, short* mono_q15,
+                                      int frames, int64_t* sum_squares, int32_t* peak) {
+    int64_t sum = 0;
+    int32_t max_value = 0;
+    int32_t min_value = 0;
+    int i = 0;
+
+#if AUDIO_KERNELS_NEON
+    int64x2_t vsum = vdupq_n_s64(0);
+    int16x8_t vmax = vdupq_n_s16(0);
+    int16x8_t vmin = vdupq_n_s16(0);
+    for (; i + 8 <= frames; i += 8) {
+        const int16x8x2_t s = vld2q_s16(in + i * 2);  // Deinterleaves left / right
+        const int16x8_t m = vhaddq_s16(s.val[0], s.val[1]);
+        vst1q_s16(mono_q15 + i, m);
+        vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s.val[0]))), S16_SCALE));
+        vst1q_f32(left + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s.val[0]))), S16_SCALE));
+        vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s.val[1]))), S16_SCALE));
+        vst1q_f32(right + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s.val[1]))), S16_SCALE));
+        vst1q_f32(mono + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(m))), S16_SCALE));
+        vst1q_f32(mono + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(m))), S16_SCALE));
+        // Each square is at most 2^30, so pairs of them add up in int64 lanes
+        vsum = vpadalq_s32(vsum, vmull_s16(vget_low_s16(m), vget_low_s16(m)));
+        vsum = vpadalq_s32(vsum, vmull_s16(vget_high_s16(m), vget_high_s16(m)));
+        vmax = vmaxq_s16(vmax, vmaxq_s16(s.val[0], s.val[1]));
+        vmin = vminq_s16(vmin, vminq_s16(s.val[0], s.val[1]));
+    }
+    sum = vgetq_lane_s64(vsum, 0) + vgetq_lane_s64(vsum, 1);
+    int16x4_t v = vpmax_s16(vget_low_s16(vmax), vget_high_s16(vmax));
+    v = vpmax_s16(v, v);
+    max_value = std::max(vget_lane_s16(v, 0), vget_lane_s16(v, 1));
+    v = vpmin_s16(vget_low_s16(vmin), vget_high_s16(vmin));
+    v = vpmin_s16(v, v);
+    min_value = std::min(vget_lane_s16(v, 0), vget_lane_s16(v, 1));
+#endif
+
+    for (; i < frames; ++i) {
+        const int32_t l = in[i * 2];
+        const int32_t r = in[i * 2 + 1];
+        const int32_t m = (l + r) >> 1;
+        mono_q15[i] = static_cast<short>(m);
+        left[i] = l * S16_SCALE;
+        right[i] = r * S16_SCALE;
+        mono[i] = m * S16_SCALE;
+        sum += m * m;
+        max_value = std::max(max_value, std::max(l, r));
+        min_value = std::min(min_value, std::min(l, r));
+    }
+
+    *sum_squares += sum;
+    *peak = std::max(*peak, std::max(max_value, -min_value));
+}
+
+void AudioKernels::s16MonoAnalyzeQ15(const short* in, float* out, short* out_q15, int frames, int64_t* sum_squares,
+                                    int32_t* peak) {
+    int64_t sum = 0;
+    int32_t max_value = 0;
+    int32_t min_value = 0;
+    int i = 0;
+
+#if AUDIO_KERNELS_NEON
+    int64x2_t vsum = vdupq_n_s64(0);
+    int16x8_t vmax = vdupq_n_s16(0);
+    int16x8_t vmin = vdupq_n_s16(0);
+    for (; i + 8 <= frames; i += 8) {
+        const int16x8_t s = vld1q_s16(in + i);
+        vst1q_s16(out_q15 + i, s);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), S16_SCALE));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), S16_SCALE));
+        vsum = vpadalq_s32(vsum, vmull_s16(vget_low_s16(s), vget_low_s16(s)));
+        vsum = vpadalq_s32(vsum, vmull_s16(vget_high_s16(s), vget_high_s16(s)));
+        vmax = vmaxq_s16(vmax, s);
+        vmin = vminq_s16(vmin, s);
+    }
+    sum = vgetq_lane_s64(vsum, 0) + vgetq_lane_s64(vsum, 1);
+    int16x4_t v = vpmax_s16(vget_low_s16(vmax), vget_high_s16(vmax));
+    v = vpmax_s16(v, v);
+    max_value = std::max(vget_lane_s16(v, 0), vget_lane_s16(v, 1));
+    v = vpmin_s16(vget_low_s16(vmin), vget_high_s16(vmin));
+    v = vpmin_s16(v, v);
+    min_value = std::min(vget_lane_s16(v, 0), vget_lane_s16(v, 1));
+#endif
+
+    for (; i < frames; ++i) {
+        const int32_t m = in[i];
+        out_q15[i] = in[i];
+        out[i] = m * S16_SCALE;
+        sum += m * m;
+        max_value = std::max(max_value, m);
+        min_value = std::min(min_value, m);
+    }
+
+    *sum_squares += sum;
+    *peak = std::max(*peak, std::max(max_value, -min_value));
+}
+
+// Q31 product, rounded: what vqrdmulhq_s32 gives for all but -1 * -1
+static inline int32_t mulQ31(int32_t a, int32_t b) {
+    return static_cast<int32_t>((static_cast<int64_t>(a) * b + (int64_t(1) << 30)) >> 31);
+}
+
+void AudioKernels::windowQ15(const short* in, const int32_t* window, int32_t* out, int count, int shift) {
+    const int64_t round = int64_t(1) << (shift - 1);
+    int i = 0;
+
+#if AUDIO_KERNELS_NEON
+    const int32x4_t vshift = vdupq_n_s32(-shift);  // A rounding shift left by -shift
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t s = vld1q_s16(in + i);
+        const int32x4_t lo = vqrdmulhq_s32(vshll_n_s16(vget_low_s16(s), 16), vld1q_s32(window + i));
+        const int32x4_t hi = vqrdmulhq_s32(vshll_n_s16(vget_high_s16(s), 16), vld1q_s32(window + i + 4));
+        vst1q_s32(out + i, vrshlq_s32(lo, vshift));
+        vst1q_s32(out + i + 4, vrshlq_s32(hi, vshift));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        out[i] = static_cast<int32_t>((mulQ31(in[i] * 65536, window[i]) + round) >> shift);
+    }
+}
+
+void AudioKernels::fftButterfliesQ31(int32_t* data, int half, const int32_t* twiddles, int stride) {
+    int32_t* upper = data + half * 2;
+    int j = 0;
+
+    // Four butterflies per vector, in split real and imaginary lanes
+#if AUDIO_KERNELS_NEON
+    for (; j + 4 <= half; j += 4) {
+        int32x4x2_t w;
+        if (stride == 1) {
+            w = vld2q_s32(twiddles + j * 2);
+        } else {
+            w.val[0] = w.val[1] = vdupq_n_s32(0);
+            w = vld2q_lane_s32(twiddles + j * stride * 2, w, 0);
+            w = vld2q_lane_s32(twiddles + (j + 1) * stride * 2, w, 1);
+            w = vld2q_lane_s32(twiddles + (j + 2) * stride * 2, w, 2);
+            w = vld2q_lane_s32(twiddles + (j + 3) * stride * 2, w, 3);
+        }
+        const int32x4x2_t x = vld2q_s32(upper + j * 2);
+        const int32x4_t vr = vsubq_s32(vqrdmulhq_s32(x.val[0], w.val[0]), vqrdmulhq_s32(x.val[1], w.val[1]));
+        const int32x4_t vi = vaddq_s32(vqrdmulhq_s32(x.val[0], w.val[1]), vqrdmulhq_s32(x.val[1], w.val[0]));
+        const int32x4x2_t u = vld2q_s32(data + j * 2);
+        int32x4x2_t out;
+        out.val[0] = vaddq_s32(u.val[0], vr);
+        out.val[1] = vaddq_s32(u.val[1], vi);
+        vst2q_s32(data + j * 2, out);
+        out.val[0] = vsubq_s32(u.val[0], vr);
+        out.val[1] = vsubq_s32(u.val[1], vi);
+        vst2q_s32(upper + j * 2, out);
+    }
+#endif
+
+    for (; j < half; ++j) {
+        const int32_t wr = twiddles[j * stride * 2];
+        const int32_t wi = twiddles[j * stride * 2 + 1];
+        const int32_t xr = upper[j * 2];
+        const int32_t xi = upper[j * 2 + 1];
+        const int32_t vr = mulQ31(xr, wr) - mulQ31(xi, wi);
+        const int32_t vi = mulQ31(xr, wi) + mulQ31(xi, wr);
+        const int32_t ur = data[j * 2];
+        const int32_t ui = data[j * 2 + 1];
+        data[j * 2] = ur + vr;
+        data[j * 2 + 1] = ui + vi;
+        upper[j * 2] = ur - vr;
+        upper[j * 2 + 1] = ui - vi;
+    }
+}
+
+void AudioKernels::complexMagnitudeQ(const int32_t* in, int32_t* out, int count) {
+    int i = 0;
+
+#if AUDIO_KERNELS_NEON
+    for (; i + 4 <= count; i += 4) {
+        const int32x4x2_t c = vld2q_s32(in + i * 2);  // Deinterleaves re / im
+        const int32x4_t re = vabsq_s32(c.val[0]);
+        const int32x4_t im = vabsq_s32(c.val[1]);
+        const int32x4_t hi = vmaxq_s32(re, im);
+        const int32x4_t lo = vminq_s32(re, im);
+        const int32x4_t blend = vaddq_s32(vsubq_s32(hi, vshrq_n_s32(hi, 3)), vshrq_n_s32(lo, 1));
+        vst1q_s32(out + i, vmaxq_s32(hi, blend));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const int32_t re = std::abs(in[i * 2]);
+        const int32_t im = std::abs(in[i * 2 + 1]);
+        const int32_t hi = std::max(re, im);
+        const int32_t lo = std::min(re, im);
+        out[i] = std::max(hi, hi - (hi >> 3) + (lo >> 1));
+    }
+}
+
+bool AudioKernels::q15Preferred() {
+#if defined(FC_Q15_ANALYSIS)
+    return FC_Q15_ANALYSIS != 0;
+#elif defined(__arm__) && defined(__SOFTFP__)
+    return true;  // Every float operation is a library call
+#elif defined(__arm__) && defined(__linux__)
+    // From asm/hwcap.h; a VFPv3 without NEON (Tegra 2) or the ARM11's VFPv2
+    // is several times slower at the float FFT than the integers are
+    constexpr unsigned long HWCAP_ARM_NEON = 1ul << 12;
+    constexpr unsigned long HWCAP_ARM_VFPV4 = 1ul << 16;
+    const unsigned long hwcap = getauxval(AT_HWCAP);
+    return (hwcap & HWCAP_ARM_NEON) == 0 || (hwcap & HWCAP_ARM_VFPV4) == 0;
+#else
+    return false;
+#endif
+}
+
+const char* AudioKernels::simdName() {
+#if AUDIO_KERNELS_SSE2
+    return "SSE2";
+#elif AUDIO_KERNELS_NEON
+    return "NEON";
+#elif AUDIO_KERNELS_WASM
+    return "WASM SIMD";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+
+// Sample format conversion and analysis kernels for the audio path.
+// Each kernel has SSE2, NEON and WASM SIMD paths with a scalar tail/fallback.
+// The Q15 kernels are for ARM boards whose FPU is weak or missing: they have
+// NEON paths and the scalar fallback only, and give the same integers on
+// either.
+class AudioKernels {
+public:
+    // Interleaved int16 -> float with gain (count = total samples)
+    static void s16ToF32(const short* in, float* out, int count, float gain);
+
+    // Mono int16 -> interleaved stereo float with gain (out holds frames * 2)
+    static void s16MonoToF32Stereo(const short* in, float* out, int frames, float gain);
+
+    // Interleaved stereo int16 -> left, right and mono float planes in one pass.
+    // Adds the mono sum of squares to *sum_squares and raises *peak to the
+    // largest left/right magnitude seen.
+    static void s16StereoAnalyze(const short* in, float* left, float* right, float* mono, int frames,
+                                 float* sum_squares, float* peak);
+
+    // Mono int16 -> float plane; same *sum_squares and *peak accumulation
+    static void s16MonoAnalyze(const short* in, float* out, int frames, float* sum_squares, float* peak);
+
+    // In-place float gain (count = total samples)
+    static void applyGain(float* samples, int count, float gain);
+
+    // Squared magnitude of interleaved complex values: out[i] = re^2 + im^2
+    static void complexPower(const float* in, float* out, int count);
+
+    // One radix-2 group over interleaved complex values, in place:
+    // u = data[j], v = data[j + half] * tw[j * stride]; data[j] = u + v,
+    // data[j + half] = u - v, for j < half
+    static void fftButterflies(float* data, int half, const float* twiddles, int stride);
+
+    // The same group for lanes transforms in lockstep, in split real and
+    // imaginary planes with the lanes of value j at j * lanes: every lane of
+    // a value shares its twiddle, so each vector holds one butterfly of four
+    // transforms
+    static void fftButterfliesLanes(float* re, float* im, int half, int lanes, const float* twiddles, int stride);
+
+    // Last index i in [1, count) with samples[i - 1] < level <= samples[i]
+    // (a rising crossing), or -1. Scans backwards and stops at the first hit.
+    static int findLastRisingCross(const float* samples, int count, float level);
+
+    // s16StereoAnalyze() with the mono mix in Q15 as well, (l + r) >> 1, and
+    // the float planes converted from the integers. *sum_squares adds the
+    // mono squares in Q30; *peak is raised to the largest left/right |sample|.
+    static void s16StereoAnalyzeQ15(const short* in, float* left, float* right, float* mono, short* mono_q15,
+                                    int frames, int64_t* sum_squares, int32_t* peak);
+
+    // s16MonoAnalyze() with a Q15 copy of the samples; the same integer sums
+    static void s16MonoAnalyzeQ15(const short* in, float* out, short* out_q15, int frames, int64_t* sum_squares,
+                                  int32_t* peak);
+
+    // Q15 samples times a Q31 window, the rounded Q31 product then rounded
+    // down shift bits (1 to 30); a Q15 window's own rounding would set the
+    // noise floor at the display's. Samples 2k and 2k + 1 land as the real
+    // and imaginary parts of value k, packed for the half-size FFT.
+    static void windowQ15(const short* in, const int32_t* window, int32_t* out, int count, int shift);
+
+    // fftButterflies() in integers: interleaved complex int32 values, Q31
+    // twiddles, v = x * w rounded as (x * w + 2^30) >> 31. No stage scales
+    // down; the input leaves the headroom (FftPlanQ15::inputShift()).
+    static void fftButterfliesQ31(int32_t* data, int half, const int32_t* twiddles, int stride);
+
+    // Approximate |re + i*im| of interleaved int32 values, alpha-max-beta-min:
+    // max(M, M - M/8 + m/2) of the larger and smaller of |re| and |im|,
+    // within 3% (0.3 dB) of the exact magnitude
+    static void complexMagnitudeQ(const int32_t* in, int32_t* out, int count);
+
+    // Whether this CPU is better off with the Q15 kernels: FC_Q15_ANALYSIS=1
+    // or 0 from the build decides outright; otherwise true on 32-bit ARM with
+    // a soft-float ABI, or (Linux) without NEON or VFPv4, and false elsewhere
+    static bool q15Preferred();
+
+    // Name of the compiled-in SIMD path ("SSE2", "NEON", "WASM SIMD" or "scalar")
+    static const char* simdName();
+};
@@ -0,0 +1,220 @@
+#include "AudioTelemetry.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cstdio>
+
+AudioTelemetry::AudioTelemetry() {
+    durations_.resize(WINDOW_BLOCKS * 4);
+}
+
+const char* AudioTelemetry::synthQualityName(int quality) {
+    static const char* const NAMES[SYNTH_QUALITIES] = {"Fast (linear)", "Standard", "High (16-point)"};
+    return NAMES[std::clamp(quality, 0, SYNTH_QUALITIES - 1)];
+}
+
+void AudioTelemetry::reset() {
+    reset_requested_.store(true);
+    render_reset_requested_.store(true);
+    window_count_ = 0;
+    window_pos_ = 0;
+}
+
+void AudioTelemetry::applyReset() {
+    blocks_.store(0, std::memory_order_relaxed);
+    total_us_.store(0.0, std::memory_order_relaxed);
+    min_us_.store(0.0, std::memory_order_relaxed);
+    max_us_.store(0.0, std::memory_order_relaxed);
+    deadline_misses_.store(0, std::memory_order_relaxed);
+    short_blocks_.store(0, std::memory_order_relaxed);
+    missing_frames_.store(0, std::memory_order_relaxed);
+}
+
+void AudioTelemetry::endBlock(Clock::time_point start, int num_frames, long sample_rate) {
+    if (reset_requested_.exchange(false)) {
+        applyReset();
+    }
+
+    const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    const double budget = sample_rate > 0 ? num_frames * 1e6 / sample_rate : 0.0;
+
+    // Single writer: plain load/store pairs are enough
+    const uint64_t blocks = blocks_.load(std::memory_order_relaxed);
+    if (blocks == 0 || us < min_us_.load(std::memory_order_relaxed)) {
+        min_us_.store(us, std::memory_order_relaxed);
+    }
+    if (us > max_us_.load(std::memory_order_relaxed)) {
+        max_us_.store(us, std::memory_order_relaxed);
+    }
+    total_us_.store(total_us_.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    budget_us_.store(budget, std::memory_order_relaxed);
+    if (budget > 0.0 && us > budget) {
+        deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+    }
+    blocks_.store(blocks + 1, std::memory_order_relaxed);
+
+    // Dropped when the UI is not draining (window closed); the window just gets stale
+    const float sample = static_cast<float>(us);
+    durations_.push(&sample, 1);
+}
+
+void AudioTelemetry::recordShortBlock(int missing_frames) {
+    if (missing_frames <= 0) return;
+    short_blocks_.fetch_add(1, std::memory_order_relaxed);
+    missing_frames_.fetch_add(static_cast<uint64_t>(missing_frames), std::memory_order_relaxed);
+}
+
+void AudioTelemetry::recordQueueDepth(long frames, long capacity) {
+    queue_frames_.store(frames, std::memory_order_relaxed);
+    queue_capacity_.store(capacity, std::memory_order_relaxed);
+}
+
+void AudioTelemetry::recordRender(Clock::time_point start, long lookahead_frames, int synth_quality,
+                                  double audio_ms) {
+    if (render_reset_requested_.exchange(false)) {
+        render_blocks_.store(0, std::memory_order_relaxed);
+        render_total_us_.store(0.0, std::memory_order_relaxed);
+        render_max_us_.store(0.0, std::memory_order_relaxed);
+        lookahead_max_frames_.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < SYNTH_QUALITIES; ++i) {
+            synth_render_us_[i].store(0.0, std::memory_order_relaxed);
+            synth_audio_ms_[i].store(0.0, std::memory_order_relaxed);
+        }
+    }
+
+    const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    if (us > render_max_us_.load(std::memory_order_relaxed)) {
+        render_max_us_.store(us, std::memory_order_relaxed);
+    }
+    render_total_us_.store(render_total_us_.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    render_blocks_.store(render_blocks_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    const int tier = std::clamp(synth_quality, 0, SYNTH_QUALITIES - 1);
+    synth_render_us_[tier].store(synth_render_us_[tier].load(std::memory_order_relaxed) + us,
+                                 std::memory_order_relaxed);
+    synth_audio_ms_[tier].store(synth_audio_ms_[tier].load(std::memory_order_relaxed) + audio_ms,
+                                std::memory_order_relaxed);
+    synth_quality_.store(tier, std::memory_order_relaxed);
+    lookahead_frames_.store(lookahead_frames, std::memory_order_relaxed);
+    if (lookahead_frames > lookahead_max_frames_.load(std::memory_order_relaxed)) {
+        lookahead_max_frames_.store(lookahead_frames, std::memory_order_relaxed);
+    }
+}
+
+AudioTelemetry::Stats AudioTelemetry::query() {
+    // Pull new durations into the sliding window
+    float incoming[256];
+    size_t got;
+    drained_max_us_ = 0.0f;
+    while ((got = durations_.pop(incoming, 256)) > 0) {
+        for (size_t i = 0; i < got; ++i) {
+            drained_max_us_ = std::max(drained_max_us_, incoming[i]);
+            window_[window_pos_] = incoming[i];
+            window_pos_ = (window_pos_ + 1) % WINDOW_BLOCKS;
+            window_count_ = std::min(window_count_ + 1, WINDOW_BLOCKS);
+        }
+    }
+
+    Stats stats;
+    stats.blocks = blocks_.load(std::memory_order_relaxed);
+    stats.min_us = min_us_.load(std::memory_order_relaxed);
+    stats.max_us = max_us_.load(std::memory_order_relaxed);
+    stats.avg_us = stats.blocks ? total_us_.load(std::memory_order_relaxed) / stats.blocks : 0.0;
+    stats.budget_us = budget_us_.load(std::memory_order_relaxed);
+    stats.deadline_misses = deadline_misses_.load(std::memory_order_relaxed);
+    stats.short_blocks = short_blocks_.load(std::memory_order_relaxed);
+    stats.missing_frames = missing_frames_.load(std::memory_order_relaxed);
+    stats.queue_frames = queue_frames_.load(std::memory_order_relaxed);
+    stats.queue_capacity = queue_capacity_.load(std::memory_order_relaxed);
+    stats.render_blocks = render_blocks_.load(std::memory_order_relaxed);
+    stats.render_avg_us =
+        stats.render_blocks ? render_total_us_.load(std::memory_order_relaxed) / stats.render_blocks : 0.0;
+    stats.render_max_us = render_max_us_.load(std::memory_order_relaxed);
+    stats.lookahead_frames = lookahead_frames_.load(std::memory_order_relaxed);
+    stats.lookahead_max_frames = lookahead_max_frames_.load(std::memory_order_relaxed);
+    for (int i = 0; i < SYNTH_QUALITIES; ++i) {
+        const double audio_ms = synth_audio_ms_[i].load(std::memory_order_relaxed);
+        stats.synth_cost[i] = audio_ms > 0.0 ? synth_render_us_[i].load(std::memory_order_relaxed) / audio_ms : 0.0;
+    }
+    stats.synth_quality = synth_quality_.load(std::memory_order_relaxed);
+
+    if (window_count_ > 0) {
+        std::array<float, WINDOW_BLOCKS> sorted;
+        std::copy_n(window_.begin(), window_count_, sorted.begin());
+        const int index = (window_count_ * 99) / 100;
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.begin() + window_count_);
+        stats.p99_us = sorted[index];
+    }
+
+    return stats;
+}
+
+void AudioTelemetry::drawPerformanceWindow(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(360, 380), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Performance", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    const Stats stats = query();
+
+    // Plot the worst block of each UI frame against the block budget
+    const float frame_max = drained_max_us_;
+    plot_history_[plot_pos_] = frame_max;
+    plot_pos_ = (plot_pos_ + 1) % static_cast<int>(plot_history_.size());
+
+    ImGui::Text("Audio callback");
+    ImGui::Separator();
+    ImGui::Text("Blocks:   %llu", static_cast<unsigned long long>(stats.blocks));
+    ImGui::Text("Budget:   %.0f us", stats.budget_us);
+    ImGui::Text("Min/Avg:  %.1f / %.1f us", stats.min_us, stats.avg_us);
+    ImGui::Text("P99/Max:  %.1f / %.1f us", stats.p99_us, stats.max_us);
+
+    char overlay[32];
+    snprintf(overlay, sizeof(overlay), "frame max %.1f us", frame_max);
+    ImGui::PlotLines("##callback_us", plot_history_.data(), static_cast<int>(plot_history_.size()),
+                     plot_pos_, overlay, 0.0f, static_cast<float>(std::max(stats.budget_us, stats.max_us)),
+                     ImVec2(-1, 60));
+
+    ImGui::Spacing();
+    ImGui::Text("Underruns");
+    ImGui::Separator();
+    ImVec4 warn(1.0f, 0.5f, 0.3f, 1.0f);
+    ImVec4 ok(0.6f, 0.9f, 0.6f, 1.0f);
+    ImGui::TextColored(stats.deadline_misses ? warn : ok, "Deadline misses: %llu",
+                       static_cast<unsigned long long>(stats.deadline_misses));
+    ImGui::TextColored(stats.short_blocks ? warn : ok, "Short blocks:    %llu (%llu frames)",
+                       static_cast<unsigned long long>(stats.short_blocks),
+                       static_cast<unsigned long long>(stats.missing_frames));
+
+    ImGui::Spacing();
+    ImGui::Text("Queue");
+    ImGui::Separator();
+    float fill = stats.queue_capacity > 0 ? static_cast<float>(stats.queue_frames) / stats.queue_capacity : 0.0f;
+    char fill_str[32];
+    snprintf(fill_str, sizeof(fill_str), "%ld / %ld frames", stats.queue_frames, stats.queue_capacity);
+    ImGui::ProgressBar(std::clamp(fill, 0.0f, 1.0f), ImVec2(-1, 0), fill_str);
+
+    if (stats.render_blocks) {
+        ImGui::Spacing();
+        ImGui::Text("NSF render thread");
+        ImGui::Separator();
+        ImGui::Text("gme_play: %.1f avg / %.1f max us", stats.render_avg_us, stats.render_max_us);
+        ImGui::Text("Silence lookahead: %ld frames (max %ld)", stats.lookahead_frames, stats.lookahead_max_frames);
+        // Each tier's cost since the last reset, as it was played; switch
+        // tiers to fill in the others
+        for (int i = 0; i < SYNTH_QUALITIES; ++i) {
+            const char* marker = i == stats.synth_quality ? ">" : " ";
+            if (stats.synth_cost[i] > 0.0) {
+                ImGui::Text("%s %-16s %.2f us per ms of audio", marker, synthQualityName(i), stats.synth_cost[i]);
+            } else {
+                ImGui::TextDisabled("%s %-16s not played", marker, synthQualityName(i));
+            }
+        }
+    }
+
+    ImGui::Spacing();
+    if (ImGui::Button("Reset Counters")) {
+        reset();
+    }
+
+    ImGui::End();
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "SpscRing.h"
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// Audio pipeline counters recorded by the audio callback and the NSF render
+// thread. Each counter has a single writer that never blocks or allocates.
+// Block durations are handed to the UI thread through a ring so query() can
+// work out percentiles over the most recent blocks.
+class AudioTelemetry {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Number of recent blocks the percentile is taken over
+    static constexpr int WINDOW_BLOCKS = 1024;
+
+    // Resampling tiers, blip_synth_linear to blip_synth_wide
+    static constexpr int SYNTH_QUALITIES = 3;
+    static const char* synthQualityName(int quality);
+
+    struct Stats {
+        uint64_t blocks = 0;           // Callbacks since the last reset
+        double min_us = 0.0;           // Callback wall time
+        double avg_us = 0.0;
+        double p99_us = 0.0;           // Over the last WINDOW_BLOCKS blocks
+        double max_us = 0.0;
+        double budget_us = 0.0;        // Audio duration of the last block
+        uint64_t deadline_misses = 0;  // Blocks that took longer than their budget
+        uint64_t short_blocks = 0;     // Blocks the source could not fill completely
+        uint64_t missing_frames = 0;   // Frames replaced with silence
+        long queue_frames = 0;         // Source buffer fill at the last block
+        long queue_capacity = 0;       // Source buffer size, or its target depth
+        uint64_t render_blocks = 0;    // gme_play calls on the render thread
+        double render_avg_us = 0.0;
+        double render_max_us = 0.0;
+        long lookahead_frames = 0;     // Emulated ahead of output looking for end of track
+        long lookahead_max_frames = 0;
+        double synth_cost[SYNTH_QUALITIES] = {};  // gme_play us per ms of audio at each tier; 0 unplayed
+        int synth_quality = 0;         // Tier of the latest gme_play
+    };
+
+    // Times one callback from construction to destruction
+    class BlockScope {
+    public:
+        BlockScope(AudioTelemetry& telemetry, int num_frames, long sample_rate)
+            : telemetry_(telemetry), start_(telemetry.beginBlock()),
+              num_frames_(num_frames), sample_rate_(sample_rate) {}
+        ~BlockScope() { telemetry_.endBlock(start_, num_frames_, sample_rate_); }
+
+    private:
+        AudioTelemetry& telemetry_;
+        Clock::time_point start_;
+        int num_frames_;
+        long sample_rate_;
+    };
+
+    AudioTelemetry();
+
+    // Audio thread: bracket one callback
+    Clock::time_point beginBlock() const { return Clock::now(); }
+    void endBlock(Clock::time_point start, int num_frames, long sample_rate);
+
+    // Audio thread: the source delivered fewer frames than requested
+    void recordShortBlock(int missing_frames);
+
+    // Audio thread: fill level of the buffer the callback reads from
+    void recordQueueDepth(long frames, long capacity);
+
+    // Render thread: one gme_play call started at start, rendering audio_ms
+    // of audio at synth_quality, and how far the emulator now runs ahead of
+    // its output for silence detection
+    void recordRender(Clock::time_point start, long lookahead_frames, int synth_quality, double audio_ms);
+
+    // UI thread: current statistics
+    Stats query();
+
+    // UI thread: clear all counters (applied by the audio thread on its next block)
+    void reset();
+
+    // Draw the "Performance" window
+    void drawPerformanceWindow(bool* p_open);
+
+private:
+    void applyReset();
+
+    // Written by the audio thread only; each writer's counters start a cache
+    // line of their own, so the two threads' stores do not contend
+    alignas(64) std::atomic<uint64_t> blocks_{0};
+    std::atomic<double> total_us_{0.0};
+    std::atomic<double> min_us_{0.0};
+    std::atomic<double> max_us_{0.0};
+    std::atomic<double> budget_us_{0.0};
+    std::atomic<uint64_t> deadline_misses_{0};
+    std::atomic<uint64_t> short_blocks_{0};
+    std::atomic<uint64_t> missing_frames_{0};
+    std::atomic<long> queue_frames_{0};
+    std::atomic<long> queue_capacity_{0};
+    std::atomic<bool> reset_requested_{false};
+
+    // Written by the render thread only
+    alignas(64) std::atomic<uint64_t> render_blocks_{0};
+    std::atomic<double> render_total_us_{0.0};
+    std::atomic<double> render_max_us_{0.0};
+    std::atomic<long> lookahead_frames_{0};
+    std::atomic<long> lookahead_max_frames_{0};
+    std::array<std::atomic<double>, SYNTH_QUALITIES> synth_render_us_{};
+    std::array<std::atomic<double>, SYNTH_QUALITIES> synth_audio_ms_{};
+    std::atomic<int> synth_quality_{0};
+    std::atomic<bool> render_reset_requested_{false};
+
+    // Block durations in microseconds, audio thread -> UI thread
+    SpscRing<float> durations_;
+
+    // UI thread: sliding window of recent durations
+    std::array<float, WINDOW_BLOCKS> window_{};
+    int window_pos_ = 0;
+    int window_count_ = 0;
+    float drained_max_us_ = 0.0f;  // Slowest block pulled in by the last query()
+
+    // UI thread: history for the plot
+    std::array<float, 256> plot_history_{};
+    int plot_pos_ = 0;
+};
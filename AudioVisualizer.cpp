@@ -1,5 +1,14 @@
 #include "AudioVisualizer.h"
+#include "AudioKernels.h"
+#include "FrameProfiler.h"
+#include "Trace.h"
+#include "PianoVisualizer.h"
+#ifndef NES_HEADLESS
+#include "sokol_app.h"
+#include "util/sokol_imgui.h"
+#endif
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 
 #ifndef M_PI
@@ -10,6 +19,46 @@
 // SimpleFFT Implementation
 // ============================================================================
 
+void FftPlan::resize(size_t size) {
+    if (size == size_) return;
+    size_ = size;
+    
+    twiddles_.resize(size / 2);
+    for (size_t k = 0; k < size / 2; ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size);
+        twiddles_[k] = std::complex<float>(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+    }
+    
+    auto build_bit_reverse = [](std::vector<uint32_t>& table, size_t n) {
+        table.resize(n);
+        int bits = 0;
+        while ((size_t(1) << bits) < n) ++bits;
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t r = 0;
+            for (int b = 0; b < bits; ++b) {
+                r |= ((i >> b) & 1u) << (bits - 1 - b);
+            }
+            table[i] = r;
+        }
+    };
+    build_bit_reverse(bit_reverse_, size);
+    build_bit_reverse(half_bit_reverse_, size / 2);
+    
+    // Hann window
+    window_.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        window_[i] = size > 1 ? 0.5f * (1.0f - static_cast<float>(std::cos(2.0 * M_PI * i / (size - 1)))) : 1.0f;
+    }
+    
+    scratch_.assign(size, std::complex<float>(0.0f, 0.0f));
+}
+
+size_t FftPlan::memoryBytes() const {
+    return (twiddles_.capacity() + scratch_.capacity()) * sizeof(std::complex<float>) +
+           (bit_reverse_.capacity() + half_bit_reverse_.capacity()) * sizeof(uint32_t) +
+           window_.capacity() * sizeof(float);
+}
+
 void SimpleFFT::fft(std::vector<std::complex<float>>& data) {
     const size_t n = data.size();
     if (n <= 1) return;
@@ -41,10 +90,267 @@ void SimpleFFT::fft(std::vector<std::complex<float>>& data) {
     }
 }
 
+// Complex FFT of n values; tw holds e^(-2*pi*i*k/(n * tw_stride)) at k * tw_stride
+static void fftWithTables(std::complex<float>* data, size_t n, const uint32_t* rev,
+                          const std::complex<float>* tw, size_t tw_stride) {
+    if (n <= 1) return;
+    
+    // Bit-reversal permutation from the table
+    for (size_t i = 1; i < n; ++i) {
+        size_t j = rev[i];
+        if (i < j) std::swap(data[i], data[j]);
+    }
+    
+    // Cooley-Tukey iterative FFT; stage len uses every (n / len)-th twiddle
+    float* values = reinterpret_cast<float*>(data);
+    const float* twiddles = reinterpret_cast<const float*>(tw);
+    for (size_t i = 0; i < n; i += 2) {
+        // First stage: the twiddle is 1
+        const std::complex<float> u = data[i];
+        const std::complex<float> v = data[i + 1];
+        data[i] = u + v;
+        data[i + 1] = u - v;
+    }
+    for (size_t len = 4; len <= n; len <<= 1) {
+        const size_t half = len / 2;
+        const size_t step = (n / len) * tw_stride;
+        for (size_t i = 0; i < n; i += len) {
+            AudioKernels::fftButterflies(values + i * 2, static_cast<int>(half), twiddles, static_cast<int>(step));
+        }
+    }
+}
+
+void SimpleFFT::fft(std::complex<float>* data, const FftPlan& plan) {
+    fftWithTables(data, plan.size(), plan.bitReverse(), plan.twiddles(), 1);
+}
+
+void SimpleFFT::rfft(const float* input, const float* window, std::complex<float>* output, const FftPlan& plan) {
+    const size_t n = plan.size();
+    const size_t h = n / 2;
+    if (h < 1) return;
+    
+    // Pack even/odd samples as real/imaginary parts: z[k] = x[2k] + i*x[2k+1]
+    for (size_t k = 0; k < h; ++k) {
+        float re = input[2 * k];
+        float im = input[2 * k + 1];
+        if (window) {
+            re *= window[2 * k];
+            im *= window[2 * k + 1];
+        }
+        output[k] = std::complex<float>(re, im);
+    }
+    
+    // Half-size FFT; its twiddles are every other entry of the full table
+    const std::complex<float>* tw = plan.twiddles();
+    fftWithTables(output, h, plan.halfBitReverse(), tw, 2);
+    
+    // Untangle the even and odd spectra:
+    // X[k] = (Z[k] + conj(Z[h-k])) / 2 - i/2 * W^k * (Z[k] - conj(Z[h-k]))
+    const std::complex<float> z0 = output[0];
+    output[0] = std::complex<float>(z0.real() + z0.imag(), 0.0f);
+    output[h] = std::complex<float>(z0.real() - z0.imag(), 0.0f);
+    
+    for (size_t k = 1; k <= h / 2; ++k) {
+        const size_t m = h - k;
+        const std::complex<float> zk = output[k];
+        const std::complex<float> zm = output[m];
+        
+        // W^m = -conj(W^k)
+        const std::complex<float> wk = tw[k];
+        const std::complex<float> wm = -std::conj(wk);
+        
+        const std::complex<float> ek = 0.5f * (zk + std::conj(zm));
+        const std::complex<float> ok = std::complex<float>(0.0f, -0.5f) * (zk - std::conj(zm));
+        const std::complex<float> em = 0.5f * (zm + std::conj(zk));
+        const std::complex<float> om = std::complex<float>(0.0f, -0.5f) * (zm - std::conj(zk));
+        
+        output[k] = ek + wk * ok;
+        output[m] = em + wm * om;
+    }
+}
+
+void FftPlanQ15::resize(size_t size) {
+    if (size == size_) return;
+    size_ = size;
+    
+    // Rounded from the double angles, as FftPlan's; cos(0) = 1 saturates
+    auto to_q31 = [](double v) {
+        return static_cast<int32_t>(std::clamp(std::llround(v * 2147483648.0), -2147483647LL, 2147483647LL));
+    };
+    twiddles_.resize(size);
+    for (size_t k = 0; k < size / 2; ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size);
+        twiddles_[k * 2] = to_q31(std::cos(angle));
+        twiddles_[k * 2 + 1] = to_q31(std::sin(angle));
+    }
+    
+    const size_t h = size / 2;
+    half_bit_reverse_.resize(h);
+    int bits = 0;
+    while ((size_t(1) << bits) < h) ++bits;
+    scale_bits_ = 30 - bits;
+    for (size_t i = 0; i < h; ++i) {
+        uint32_t r = 0;
+        for (int b = 0; b < bits; ++b) {
+            r |= ((i >> b) & 1u) << (bits - 1 - b);
+        }
+        half_bit_reverse_[i] = r;
+    }
+    
+    window_.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        double w = size > 1 ? 0.5 * (1.0 - std::cos(2.0 * M_PI * i / (size - 1))) : 1.0;
+        window_[i] = to_q31(w);
+    }
+    
+    scratch_.assign(size + 2, 0);
+}
+
+size_t FftPlanQ15::memoryBytes() const {
+    return (twiddles_.capacity() + window_.capacity() + scratch_.capacity()) * sizeof(int32_t) +
+           half_bit_reverse_.capacity() * sizeof(uint32_t);
+}
+
+void SimpleFFT::rfftQ15(int32_t* data, const FftPlanQ15& plan) {
+    const size_t h = plan.size() / 2;
+    if (h < 2) return;
+    
+    // Half-size FFT as fftWithTables() does it, on int32 pairs
+    const uint32_t* rev = plan.halfBitReverse();
+    for (size_t i = 1; i < h; ++i) {
+        size_t j = rev[i];
+        if (i < j) {
+            std::swap(data[i * 2], data[j * 2]);
+            std::swap(data[i * 2 + 1], data[j * 2 + 1]);
+        }
+    }
+    for (size_t i = 0; i < h * 2; i += 4) {
+        const int32_t ur = data[i], ui = data[i + 1];
+        const int32_t vr = data[i + 2], vi = data[i + 3];
+        data[i] = ur + vr;
+        data[i + 1] = ui + vi;
+        data[i + 2] = ur - vr;
+        data[i + 3] = ui - vi;
+    }
+    const int32_t* tw = plan.twiddles();
+    for (size_t len = 4; len <= h; len <<= 1) {
+        const size_t half = len / 2;
+        const size_t step = (h / len) * 2;
+        for (size_t i = 0; i < h; i += len) {
+            AudioKernels::fftButterfliesQ31(data + i * 2, static_cast<int>(half), tw, static_cast<int>(step));
+        }
+    }
+    
+    // Untangle as rfft() does, with E[m] = conj(E[k]) and O[m] = conj(O[k]):
+    // X[k] = E + W^k * O, X[h-k] = conj(E - W^k * O). The halvings go through
+    // int64 so the sums cannot wrap.
+    const int32_t z0r = data[0], z0i = data[1];
+    data[0] = z0r + z0i;
+    data[1] = 0;
+    data[h * 2] = z0r - z0i;
+    data[h * 2 + 1] = 0;
+    
+    auto halve = [](int64_t v) { return static_cast<int32_t>(v >> 1); };
+    auto mul = [](int32_t a, int32_t b) {
+        return static_cast<int32_t>((static_cast<int64_t>(a) * b + (int64_t(1) << 30)) >> 31);
+    };
+    for (size_t k = 1; k <= h / 2; ++k) {
+        const size_t m = h - k;
+        const int32_t zkr = data[k * 2], zki = data[k * 2 + 1];
+        const int32_t zmr = data[m * 2], zmi = data[m * 2 + 1];
+        
+        const int32_t er = halve(int64_t(zkr) + zmr);
+        const int32_t ei = halve(int64_t(zki) - zmi);
+        const int32_t orr = halve(int64_t(zki) + zmi);
+        const int32_t oi = halve(int64_t(zmr) - zkr);
+        
+        const int32_t wr = tw[k * 2], wi = tw[k * 2 + 1];
+        const int32_t tr = mul(orr, wr) - mul(oi, wi);
+        const int32_t ti = mul(orr, wi) + mul(oi, wr);
+        
+        data[k * 2] = er + tr;
+        data[k * 2 + 1] = ei + ti;
+        data[m * 2] = er - tr;
+        data[m * 2 + 1] = ti - ei;
+    }
+}
+
+void SimpleFFT::rfftLanes(const float* input, const float* window, float* re, float* im, int lanes,
+                          const FftPlan& plan) {
+    const size_t n = plan.size();
+    const size_t h = n / 2;
+    if (h < 1 || lanes <= 0) return;
+    const size_t row = static_cast<size_t>(lanes);
+    
+    // Pack as rfft() does, each lane on its own; rows are bit-reversed on the way
+    const uint32_t* rev = plan.halfBitReverse();
+    for (size_t k = 0; k < h; ++k) {
+        const float* even = input + 2 * k * row;
+        const float* odd = even + row;
+        const float we = window ? window[2 * k] : 1.0f;
+        const float wo = window ? window[2 * k + 1] : 1.0f;
+        float* dst_re = re + rev[k] * row;
+        float* dst_im = im + rev[k] * row;
+        for (size_t c = 0; c < row; ++c) {
+            dst_re[c] = even[c] * we;
+            dst_im[c] = odd[c] * wo;
+        }
+    }
+    
+    // Half-size FFT over whole rows; stage len uses every (h / len)-th
+    // twiddle of the half table, every other one of the plan's
+    const float* twiddles = reinterpret_cast<const float*>(plan.twiddles());
+    for (size_t len = 2; len <= h; len <<= 1) {
+        const size_t half = len / 2;
+        const int step = static_cast<int>((h / len) * 2);
+        for (size_t i = 0; i < h; i += len) {
+            AudioKernels::fftButterfliesLanes(re + i * row, im + i * row, static_cast<int>(half), lanes, twiddles,
+                                              step);
+        }
+    }
+    
+    // Untangle as rfft(): with t = W^k * O[k], X[k] = E[k] + t and
+    // X[h-k] = conj(E[k] - t)
+    for (size_t c = 0; c < row; ++c) {
+        const float zr = re[c];
+        const float zi = im[c];
+        re[c] = zr + zi;
+        im[c] = 0.0f;
+        re[h * row + c] = zr - zi;
+        im[h * row + c] = 0.0f;
+    }
+    const std::complex<float>* tw = plan.twiddles();
+    for (size_t k = 1; k <= h / 2; ++k) {
+        const size_t m = h - k;
+        const float wr = tw[k].real();
+        const float wi = tw[k].imag();
+        float* kr = re + k * row;
+        float* ki = im + k * row;
+        float* mr = re + m * row;
+        float* mi = im + m * row;
+        for (size_t c = 0; c < row; ++c) {
+            const float er = 0.5f * (kr[c] + mr[c]);
+            const float ei = 0.5f * (ki[c] - mi[c]);
+            const float or_ = 0.5f * (ki[c] + mi[c]);
+            const float oi = -0.5f * (kr[c] - mr[c]);
+            const float tr = wr * or_ - wi * oi;
+            const float ti = wr * oi + wi * or_;
+            kr[c] = er + tr;
+            ki[c] = ei + ti;
+            mr[c] = er - tr;
+            mi[c] = ti - ei;
+        }
+    }
+}
+
 void SimpleFFT::computeMagnitude(const std::vector<std::complex<float>>& fftData,
                                   std::vector<float>& magnitudes, int numBins) {
+    computeMagnitude(fftData.data(), fftData.size(), magnitudes, numBins);
+}
+
+void SimpleFFT::computeMagnitude(const std::complex<float>* fftData, size_t fftSize,
+                                  std::vector<float>& magnitudes, int numBins) {
     magnitudes.resize(numBins);
-    const size_t fftSize = fftData.size();
     const size_t usefulBins = fftSize / 2;
     
     // Map FFT bins to display bins (logarithmic scale for better visualization)
@@ -70,6 +376,131 @@ void SimpleFFT::computeMagnitude(const std::vector<std::complex<float>>& fftData
     }
 }
 
+void SpectrumBinMap::build(size_t fft_size, int num_bins) {
+    if (fft_size == fft_size_ && num_bins == binCount()) return;
+    fft_size_ = fft_size;
+    start_.resize(num_bins);
+    end_.resize(num_bins);
+    
+    // Same mapping as computeMagnitude
+    const size_t usefulBins = fft_size / 2;
+    for (int i = 0; i < num_bins; ++i) {
+        float t = static_cast<float>(i) / static_cast<float>(num_bins);
+        size_t startBin = static_cast<size_t>(std::pow(t, 2.0f) * usefulBins);
+        size_t endBin = static_cast<size_t>(std::pow(static_cast<float>(i + 1) / num_bins, 2.0f) * usefulBins);
+        
+        if (startBin >= usefulBins) startBin = usefulBins - 1;
+        if (endBin >= usefulBins) endBin = usefulBins;
+        if (endBin <= startBin) endBin = startBin + 1;
+        
+        start_[i] = static_cast<uint32_t>(startBin);
+        end_[i] = static_cast<uint32_t>(endBin);
+    }
+}
+
+// log2 via exponent bits and a quadratic fit of the mantissa (under 0.02 dB error)
+static inline float fastLog2(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    // The fit below is log2(m) + 1, hence the bias of 128 instead of 127
+    float exponent = static_cast<float>(static_cast<int>((bits >> 23) & 0xFF) - 128);
+    bits = (bits & 0x007FFFFF) | 0x3F800000;  // Mantissa in [1, 2)
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    return exponent + (-0.34484843f * m + 2.02466578f) * m - 0.67487759f;
+}
+
+void NoteFilterBank::configure(long sample_rate, int midi_min, int midi_max) {
+    midi_min_ = midi_min;
+    filters_.assign(std::max(0, midi_max - midi_min + 1), Filter{});
+    
+    // Q for semitone spacing: f / (f * (2^(1/12) - 1))
+    const float q = 1.0f / (std::pow(2.0f, 1.0f / 12.0f) - 1.0f);
+    for (size_t i = 0; i < filters_.size(); ++i) {
+        float freq = PianoVisualizer::midiToFrequency(midi_min + static_cast<int>(i));
+        Filter& f = filters_[i];
+        f.length = std::max(1, static_cast<int>(std::lround(q * sample_rate / freq)));
+        // Snap to the bin centre of the block so the note is not scalloped
+        float k = std::round(f.length * freq / sample_rate);
+        f.coeff = 2.0f * std::cos(2.0f * static_cast<float>(M_PI) * k / f.length);
+    }
+}
+
+void NoteFilterBank::reset() {
+    for (auto& f : filters_) {
+        f.count = 0;
+        f.s1 = f.s2 = 0.0f;
+        f.level = 0.0f;
+    }
+}
+
+void NoteFilterBank::process(const float* samples, int count) {
+    for (auto& f : filters_) {
+        float s1 = f.s1, s2 = f.s2;
+        const float coeff = f.coeff;
+        for (int i = 0; i < count; ++i) {
+            float s0 = samples[i] + coeff * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+            if (++f.count == f.length) {
+                // |X|^2 of the block; a full-scale sine gives (N/2)^2
+                float power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+                float amplitude2 = 4.0f * power / (static_cast<float>(f.length) * f.length);
+                float db = 10.0f * std::log10(amplitude2 + 1e-20f);
+                f.level = std::clamp((db + 60.0f) / 60.0f, 0.0f, 1.0f);
+                s1 = s2 = 0.0f;
+                f.count = 0;
+            }
+        }
+        f.s1 = s1;
+        f.s2 = s2;
+    }
+}
+
+#ifndef NES_HEADLESS
+// Writes axis-aligned gradient quads straight into a draw list's buffers.
+// A single PrimReserve covers the whole batch instead of one per rectangle,
+// and the unused tail is handed back on destruction.
+class QuadWriter {
+public:
+    QuadWriter(ImDrawList* draw_list, int max_quads)
+        : draw_list_(draw_list), reserved_(max_quads), uv_(ImGui::GetFontTexUvWhitePixel()) {
+        draw_list_->PrimReserve(max_quads * 6, max_quads * 4);
+    }
+    ~QuadWriter() {
+        const int unused = reserved_ - written_;
+        if (unused > 0) draw_list_->PrimUnreserve(unused * 6, unused * 4);
+    }
+    QuadWriter(const QuadWriter&) = delete;
+    QuadWriter& operator=(const QuadWriter&) = delete;
+
+    // Rectangle from a (top-left) to b (bottom-right), colours by edge
+    void add(ImVec2 a, ImVec2 b, ImU32 top, ImU32 bottom) {
+        if (written_ == reserved_) return;
+        ++written_;
+        const ImDrawIdx idx = static_cast<ImDrawIdx>(draw_list_->_VtxCurrentIdx);
+        ImDrawIdx* ip = draw_list_->_IdxWritePtr;
+        ip[0] = idx; ip[1] = static_cast<ImDrawIdx>(idx + 1); ip[2] = static_cast<ImDrawIdx>(idx + 2);
+        ip[3] = idx; ip[4] = static_cast<ImDrawIdx>(idx + 2); ip[5] = static_cast<ImDrawIdx>(idx + 3);
+        ImDrawVert* vp = draw_list_->_VtxWritePtr;
+        vp[0] = {a, uv_, top};
+        vp[1] = {ImVec2(b.x, a.y), uv_, top};
+        vp[2] = {b, uv_, bottom};
+        vp[3] = {ImVec2(a.x, b.y), uv_, bottom};
+        draw_list_->_IdxWritePtr += 6;
+        draw_list_->_VtxWritePtr += 4;
+        draw_list_->_VtxCurrentIdx += 4;
+    }
+    void add(ImVec2 a, ImVec2 b, ImU32 color) { add(a, b, color, color); }
+
+private:
+    ImDrawList* draw_list_;
+    int reserved_;
+    int written_ = 0;
+    ImVec2 uv_;
+};
+#endif
+
 // ============================================================================
 // AudioVisualizer Implementation
 // ============================================================================
@@ -83,24 +514,48 @@ AudioVisualizer::AudioVisualizer()
     , spectrum_smoothing_(0.7f)
     , spectrum_history_pos_(0)
     , peak_decay_rate_(0.95f)
-    , has_vrc6_(false)
 {
     // Initialize buffers
-    waveform_buffer_.resize(WAVEFORM_SIZE, 0.0f);
-    waveform_buffer_left_.resize(WAVEFORM_SIZE, 0.0f);
-    waveform_buffer_right_.resize(WAVEFORM_SIZE, 0.0f);
-    fft_input_.resize(FFT_SIZE, 0.0f);
+    scope_left_.resize(SCOPE_SIZE, 0.0f);
+    scope_right_.resize(SCOPE_SIZE, 0.0f);
+    scope_mono_.resize(SCOPE_SIZE, 0.0f);
+    fft_input_.resize(MAX_FFT_SIZE, 0.0f);
+    trigger_scratch_.resize(WAVEFORM_SIZE + 1, 0.0f);
+    fft_power_.resize(MAX_FFT_SIZE / 2, 0.0f);
+    setFftSize(DEFAULT_FFT_SIZE);
+    setFixedPointAnalysis(AudioKernels::q15Preferred());
+    note_bank_.configure(sample_rate_, PianoVisualizer::MIDI_NOTE_MIN, PianoVisualizer::MIDI_NOTE_MAX);
+    note_data_.resize(note_bank_.noteCount(), 0.0f);
+    note_peaks_.resize(note_bank_.noteCount(), 0.0f);
     spectrum_data_.resize(SPECTRUM_BINS, 0.0f);
     spectrum_peaks_.resize(SPECTRUM_BINS, 0.0f);
     
     // Initialize spectrum history for waterfall
-    spectrum_history_.resize(HISTORY_SIZE);
-    for (auto& row : spectrum_history_) {
-        row.resize(SPECTRUM_BINS, 0.0f);
-    }
+    spectrum_history_.resize(HISTORY_SIZE * SPECTRUM_BINS, 0.0f);
+    spectrogram_pixels_.resize(HISTORY_SIZE * SPECTRUM_BINS, 0);
+    rebuildColorLut();
+    
+    // Sample queue between the audio callback and the render thread
+    sample_ring_.resize(RING_SIZE);
+    mono_ring_.resize(RING_SIZE / 2);
+    tag_ring_.resize(TAG_RING_SIZE);
+    drain_buffer_.resize(RING_SIZE, 0);
+    tap_ring_.resize(TAP_RING_FRAMES * TAP_CHANNELS);
+    tap_drain_.resize(TAP_RING_FRAMES * TAP_CHANNELS, 0);
+    tap_scopes_.resize(TAP_CHANNELS * TAP_SCOPE_SIZE, 0.0f);
+    level_ring_.resize(LEVEL_RING_SIZE);
+    channel_plan_.resize(CHANNEL_FFT_SIZE);
+    channel_bin_map_.build(CHANNEL_FFT_SIZE, CHANNEL_SPECTRUM_BINS);
+    channel_fft_input_.resize(static_cast<size_t>(CHANNEL_FFT_SIZE) * TAP_CHANNELS, 0.0f);
+    channel_fft_re_.resize(static_cast<size_t>(CHANNEL_FFT_SIZE / 2 + 1) * TAP_CHANNELS, 0.0f);
+    channel_fft_im_.resize(channel_fft_re_.size(), 0.0f);
+    channel_spectra_.resize(static_cast<size_t>(TAP_CHANNELS) * CHANNEL_SPECTRUM_BINS, 0.0f);
+    channel_spectrum_peaks_.resize(channel_spectra_.size(), 0.0f);
     
     // Initialize channel data
-    channel_amplitudes_.fill(0.0f);
+    for (auto& amp : channel_amplitudes_) {
+        amp.store(0.0f, std::memory_order_relaxed);
+    }
     channel_peaks_.fill(0.0f);
 }
 
@@ -109,126 +564,497 @@ AudioVisualizer::~AudioVisualizer() {
 }
 
 bool AudioVisualizer::init(Music_Emu* emu, long sample_rate) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
     emu_ = emu;
     sample_rate_ = sample_rate;
     is_initialized_ = (emu != nullptr);
+    note_bank_.configure(sample_rate_, PianoVisualizer::MIDI_NOTE_MIN, PianoVisualizer::MIDI_NOTE_MAX);
+    loudness_.configure(sample_rate_);
+    scrub_history_.configure(sample_rate_, SCRUB_SECONDS);
     
-    // Call internal reset without locking (we already hold the lock)
-    resetInternal();
+    reset();
     
     return is_initialized_;
 }
 
 void AudioVisualizer::reset() {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    resetInternal();
-}
-
-void AudioVisualizer::resetInternal() {
-    // Note: This function assumes the caller already holds audio_mutex_
+    // Render thread only: we are the ring's consumer, so dropping queued
+    // samples is safe while the audio thread keeps pushing
+    tag_ring_.discard();
+    has_front_tag_ = false;
+    sample_ring_.discard();
+    mono_ring_.discard();
+    tap_ring_.discard();
+    std::fill(tap_scopes_.begin(), tap_scopes_.end(), 0.0f);
+    tap_write_ = 0;
+    channel_analysis_pos_ = 0;
+    std::fill(channel_spectra_.begin(), channel_spectra_.end(), 0.0f);
+    std::fill(channel_spectrum_peaks_.begin(), channel_spectrum_peaks_.end(), 0.0f);
+    taps_active_.store(false, std::memory_order_relaxed);
+    level_ring_.discard();
+    has_level_from_ = false;
+    has_level_to_ = false;
     
     // Clear all buffers
-    std::fill(waveform_buffer_.begin(), waveform_buffer_.end(), 0.0f);
-    std::fill(waveform_buffer_left_.begin(), waveform_buffer_left_.end(), 0.0f);
-    std::fill(waveform_buffer_right_.begin(), waveform_buffer_right_.end(), 0.0f);
+    std::fill(scope_left_.begin(), scope_left_.end(), 0.0f);
+    std::fill(scope_right_.begin(), scope_right_.end(), 0.0f);
+    std::fill(scope_mono_.begin(), scope_mono_.end(), 0.0f);
+    std::fill(scope_mono_q15_.begin(), scope_mono_q15_.end(), short(0));
+    scope_write_ = 0;
+    output_peak_ = 0.0f;
+    loudness_.reset();
+    history_left_.reset();
+    history_right_.reset();
+    phosphor_.clear();
     std::fill(fft_input_.begin(), fft_input_.end(), 0.0f);
     std::fill(spectrum_data_.begin(), spectrum_data_.end(), 0.0f);
     std::fill(spectrum_peaks_.begin(), spectrum_peaks_.end(), 0.0f);
     
-    for (auto& row : spectrum_history_) {
-        std::fill(row.begin(), row.end(), 0.0f);
-    }
+    std::fill(spectrum_history_.begin(), spectrum_history_.end(), 0.0f);
+    rebuildColorLut();
     
-    channel_amplitudes_.fill(0.0f);
+    for (auto& amp : channel_amplitudes_) {
+        amp.store(0.0f, std::memory_order_relaxed);
+    }
     channel_peaks_.fill(0.0f);
     spectrum_history_pos_ = 0;
+    analysis_pos_ = 0;
+    note_bank_.reset();
+    note_pos_ = 0;
+    std::fill(note_data_.begin(), note_data_.end(), 0.0f);
+    std::fill(note_peaks_.begin(), note_peaks_.end(), 0.0f);
+    scrub_history_.reset();
+    scrubbed_ = false;
+}
+
+void AudioVisualizer::setFftSize(int size) {
+    int pow2 = MIN_FFT_SIZE;
+    while (pow2 < size && pow2 < MAX_FFT_SIZE) pow2 <<= 1;
+    requested_fft_size_ = pow2;
+    
+    fft_size_ = std::min(requested_fft_size_, fft_size_limit_);
+    fft_plan_.resize(fft_size_);
+    if (fixed_point_) fft_plan_q15_.resize(fft_size_);
+    bin_map_.build(fft_size_, SPECTRUM_BINS);
+}
+
+// Float samples back to Q15, for a ring rebuilt or taken over in float
+static void toQ15(const float* in, short* out, int count) {
+    for (int i = 0; i < count; ++i) {
+        out[i] = static_cast<short>(std::clamp(std::lround(in[i] * 32768.0f), -32768L, 32767L));
+    }
 }
 
-void AudioVisualizer::updateAudioData(const short* samples, int sample_count) {
+void AudioVisualizer::setFixedPointAnalysis(bool fixed_point) {
+    if (fixed_point == fixed_point_) return;
+    fixed_point_ = fixed_point;
+    if (fixed_point_) {
+        // The ring takes over the float history so the next windows are whole
+        scope_mono_q15_.resize(SCOPE_SIZE);
+        toQ15(scope_mono_.data(), scope_mono_q15_.data(), SCOPE_SIZE);
+        fft_plan_q15_.resize(fft_size_);
+        fft_magnitude_q15_.resize(MAX_FFT_SIZE / 2);
+    } else {
+        // Desktops never hold the integer buffers
+        std::vector<short>().swap(scope_mono_q15_);
+        std::vector<int32_t>().swap(fft_magnitude_q15_);
+        fft_plan_q15_ = FftPlanQ15();
+    }
+}
+
+void AudioVisualizer::setFftSizeLimit(int limit) {
+    fft_size_limit_ = std::max(limit, MIN_FFT_SIZE);
+    if (std::min(requested_fft_size_, fft_size_limit_) != fft_size_) setFftSize(requested_fft_size_);
+}
+
+void AudioVisualizer::updateAudioData(const short* samples, int sample_count, int64_t stream_frame) {
     if (!samples || sample_count <= 0) return;
+    queueBlock(samples, sample_count / 2, false, stream_frame);
+}
+
+void AudioVisualizer::updateAudioDataMono(const short* samples, int frame_count, int64_t stream_frame) {
+    if (!samples || frame_count <= 0) return;
+    queueBlock(samples, frame_count, true, stream_frame);
+}
+
+void AudioVisualizer::queueBlock(const short* samples, int frames, bool mono, int64_t stream_frame) {
+    // Hand the raw block to the render thread; if it has fallen behind the
+    // excess is dropped rather than waiting for space. Drops are counted in
+    // stereo samples whatever the source.
+    SpscRing<short>& ring = mono ? mono_ring_ : sample_ring_;
+    const size_t channels = mono ? 1 : 2;
+    const size_t ring_pos = ring.writePosition();
+    size_t written = 0;
+    if (tag_ring_.writeAvailable() > 0) {
+        written = ring.push(samples, static_cast<size_t>(frames) * channels) / channels;
+        if (written > 0) {
+            const BlockTag tag = {stream_frame, ring_pos, static_cast<uint32_t>(written), mono};
+            tag_ring_.push(&tag, 1);
+        }
+    }
+    if (written < static_cast<size_t>(frames)) {
+        dropped_samples_.fetch_add(static_cast<uint32_t>(frames - written) * 2, std::memory_order_relaxed);
+    }
+}
+
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AudioVisualizer::setPlaybackClock(int64_t stream_frame, int period_frames) {
+    clock_time_ns_.store(steadyNowNs(), std::memory_order_relaxed);
+    clock_period_.store(period_frames, std::memory_order_relaxed);
+    clock_frame_.store(stream_frame, std::memory_order_release);
+}
+
+int64_t AudioVisualizer::playbackClock() const {
+    const int64_t frame = clock_frame_.load(std::memory_order_acquire);
+    if (frame == UNTIMED) return UNTIMED;
+    const int64_t elapsed_ns = steadyNowNs() - clock_time_ns_.load(std::memory_order_relaxed);
+    if (elapsed_ns > CLOCK_TIMEOUT_MS * 1000000LL) return UNTIMED;
+    
+    // The device plays on between callbacks, but never past the buffer it was handed
+    const int64_t advanced = elapsed_ns * sample_rate_ / 1000000000LL;
+    return frame + std::min<int64_t>(advanced, clock_period_.load(std::memory_order_relaxed));
+}
+
+void AudioVisualizer::updateChannelTaps(const short* taps, int frames, int tap_count, const int* tap_channels,
+                                        int64_t stream_frame) {
+    if (!taps || frames <= 0 || tap_count <= 0) {
+        taps_active_.store(false, std::memory_order_relaxed);
+        return;
+    }
+    taps_active_.store(true, std::memory_order_relaxed);
+    
+    // Regroup into table order a chunk at a time, tracking each channel's peak
+    constexpr int CHUNK_FRAMES = 256;
+    short chunk[CHUNK_FRAMES * TAP_CHANNELS];
+    int peaks[TAP_CHANNELS] = {};
+    for (int offset = 0; offset < frames; offset += CHUNK_FRAMES) {
+        const int n = std::min(CHUNK_FRAMES, frames - offset);
+        std::fill(chunk, chunk + n * TAP_CHANNELS, static_cast<short>(0));
+        
+        int chunk_peaks[TAP_CHANNELS] = {};
+        for (int t = 0; t < tap_count; ++t) {
+            const int channel = tap_channels ? tap_channels[t] : t;
+            if (channel < 0 || channel >= TAP_CHANNELS) continue;
+            
+            const short* src = taps + static_cast<size_t>(offset) * tap_count + t;
+            int peak = chunk_peaks[channel];
+            for (int i = 0; i < n; ++i) {
+                short v = src[static_cast<size_t>(i) * tap_count];
+                chunk[i * TAP_CHANNELS + channel] = v;
+                peak = std::max(peak, std::abs(static_cast<int>(v)));
+            }
+            chunk_peaks[channel] = peak;
+        }
+        for (int c = 0; c < TAP_CHANNELS; ++c) peaks[c] = std::max(peaks[c], chunk_peaks[c]);
+        
+        // Whole frames only, so the consumer never sees a torn frame
+        const size_t needed = static_cast<size_t>(n) * TAP_CHANNELS;
+        if (tap_ring_.writeAvailable() >= needed) {
+            tap_ring_.push(chunk, needed);
+        }
+        
+        // Timed: a point per chunk, decayed pro rata so a call decays as an untimed one does
+        if (stream_frame != UNTIMED) {
+            const float decay = std::pow(0.85f, static_cast<float>(n) / frames);
+            for (int c = 0; c < TAP_CHANNELS; ++c) {
+                timed_levels_[c] = std::max(timed_levels_[c] * decay, chunk_peaks[c] / 32768.0f);
+            }
+            pushLevelPoint(stream_frame + offset + n);
+        }
+    }
+    if (stream_frame != UNTIMED) return;
     
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
-    // Convert stereo samples to mono and update waveform buffer
-    int mono_count = sample_count / 2;
-    
-    // Rolling window update for waveform
-    int shift = std::min(mono_count, WAVEFORM_SIZE);
-    
-    if (shift < WAVEFORM_SIZE) {
-        // Shift existing samples
-        std::memmove(waveform_buffer_.data(), 
-                     waveform_buffer_.data() + shift,
-                     (WAVEFORM_SIZE - shift) * sizeof(float));
-        std::memmove(waveform_buffer_left_.data(),
-                     waveform_buffer_left_.data() + shift,
-                     (WAVEFORM_SIZE - shift) * sizeof(float));
-        std::memmove(waveform_buffer_right_.data(),
-                     waveform_buffer_right_.data() + shift,
-                     (WAVEFORM_SIZE - shift) * sizeof(float));
+    for (int c = 0; c < TAP_CHANNELS; ++c) {
+        float normalized = peaks[c] / 32768.0f;
+        float prev = channel_amplitudes_[c].load(std::memory_order_relaxed);
+        channel_amplitudes_[c].store(std::max(prev * 0.85f, normalized), std::memory_order_relaxed);
+    }
+}
+
+void AudioVisualizer::pushLevelPoint(int64_t stream_frame) {
+    LevelPoint point;
+    point.stream_frame = stream_frame;
+    point.levels = timed_levels_;
+    level_ring_.push(&point, 1);  // Dropped if the render thread fell behind
+}
+
+void AudioVisualizer::processPendingAudio() {
+    drainBlocks();
+    drainChannelTaps();
+    drainLevelPoints();
+    
+    // Samples drained since a scrub went into the live rings; put the
+    // scrubbed moment back over them
+    if (scrubbed_ && scrub_history_.outputEnd() != scrub_drained_) {
+        rebuildFromHistory(std::max(scrub_end_, scrub_history_.outputStart()));
     }
     
-    // Add new samples
-    int start_idx = std::max(0, mono_count - shift);
-    for (int i = 0; i < shift; ++i) {
-        int src_idx = (start_idx + i) * 2;
-        float left = samples[src_idx] / 32768.0f;
-        float right = samples[src_idx + 1] / 32768.0f;
-        float mono = (left + right) * 0.5f;
+    // Peak hold follows the levels published by the audio thread
+    for (size_t i = 0; i < channel_peaks_.size(); ++i) {
+        channel_peaks_[i] = std::max(channel_peaks_[i], channel_amplitudes_[i].load(std::memory_order_relaxed));
+    }
+}
+
+void AudioVisualizer::drainBlocks() {
+    // Blocks are consumed in queue order up to the frame being heard, so the
+    // displays follow the listener rather than the renderer. A block the
+    // clock is partway through is split and its tail kept for next time.
+    const int64_t clock = playbackClock();
+    const int64_t max_lead = static_cast<int64_t>(sample_rate_) * 2;  // Beyond this the tag predates a clock reset
+    for (;;) {
+        if (!has_front_tag_) {
+            if (tag_ring_.pop(&front_tag_, 1) == 0) break;
+            has_front_tag_ = true;
+        }
+        BlockTag& tag = front_tag_;
+        SpscRing<short>& ring = tag.mono ? mono_ring_ : sample_ring_;
+        const size_t channels = tag.mono ? 1 : 2;
         
-        int dst_idx = WAVEFORM_SIZE - shift + i;
-        waveform_buffer_[dst_idx] = mono;
-        waveform_buffer_left_[dst_idx] = left;
-        waveform_buffer_right_[dst_idx] = right;
+        // Realign with the ring: drop data no tag describes, or the part of
+        // this block that a reset already discarded
+        const size_t read_pos = ring.readPosition();
+        if (read_pos < tag.ring_pos) {
+            ring.skip(tag.ring_pos - read_pos);
+        } else if (read_pos > tag.ring_pos) {
+            const size_t lost = (read_pos - tag.ring_pos) / channels;
+            if (lost >= tag.frames) {
+                has_front_tag_ = false;
+                continue;
+            }
+            tag.frames -= static_cast<uint32_t>(lost);
+            tag.ring_pos += lost * channels;
+            if (tag.stream_frame != UNTIMED) tag.stream_frame += static_cast<int64_t>(lost);
+        }
+        
+        uint32_t frames = tag.frames;
+        if (tag.stream_frame != UNTIMED && clock != UNTIMED && tag.stream_frame - clock < max_lead) {
+            const int64_t due = clock - tag.stream_frame;
+            if (due <= 0) break;
+            frames = static_cast<uint32_t>(std::min<int64_t>(due, frames));
+        }
+        
+        const size_t count = ring.pop(drain_buffer_.data(), frames * channels);
+        if (tag.mono) {
+            appendMonoSamples(drain_buffer_.data(), static_cast<int>(count));
+        } else {
+            appendSamples(drain_buffer_.data(), static_cast<int>(count));
+        }
+        scrub_history_.pushOutput(drain_buffer_.data(), static_cast<int>(count / channels), tag.mono,
+                                  tag.stream_frame);
+        
+        tag.frames -= frames;
+        tag.ring_pos += frames * channels;
+        if (tag.stream_frame != UNTIMED) tag.stream_frame += frames;
+        if (tag.frames > 0) break;
+        has_front_tag_ = false;
     }
-    
-    // Update FFT input buffer
-    int fft_shift = std::min(mono_count, FFT_SIZE);
-    if (fft_shift < FFT_SIZE) {
-        std::memmove(fft_input_.data(),
-                     fft_input_.data() + fft_shift,
-                     (FFT_SIZE - fft_shift) * sizeof(float));
+}
+
+void AudioVisualizer::appendSamples(const short* samples, int sample_count) {
+    // Frames older than the history can never be displayed
+    int frame_count = sample_count / 2;
+    int first = std::max(0, frame_count - SCOPE_SIZE);
+    
+    // One fused pass per contiguous span of the circular buffers: convert,
+    // split, downmix and accumulate the block's power and peak
+    const uint32_t mask = SCOPE_SIZE - 1;
+    uint32_t pos = scope_write_;
+    float sum_squares = 0.0f;
+    float peak = 0.0f;
+    int64_t sum_q30 = 0;
+    int32_t peak_q15 = 0;
+    for (int i = first; i < frame_count;) {
+        const uint32_t dst = pos & mask;
+        const int n = std::min(frame_count - i, static_cast<int>(SCOPE_SIZE - dst));
+        if (fixed_point_) {
+            AudioKernels::s16StereoAnalyzeQ15(samples + i * 2, &scope_left_[dst], &scope_right_[dst],
+                                              &scope_mono_[dst], &scope_mono_q15_[dst], n, &sum_q30, &peak_q15);
+        } else {
+            AudioKernels::s16StereoAnalyze(samples + i * 2, &scope_left_[dst], &scope_right_[dst],
+                                           &scope_mono_[dst], n, &sum_squares, &peak);
+        }
+        loudness_.process(&scope_left_[dst], &scope_right_[dst], n);
+        history_left_.push(&scope_left_[dst], n);
+        history_right_.push(&scope_right_[dst], n);
+        i += n;
+        pos += n;
+    }
+    scope_write_ = pos;
+    if (fixed_point_) {
+        sum_squares = static_cast<float>(sum_q30) * (1.0f / (1 << 30));
+        peak = static_cast<float>(peak_q15) * (1.0f / 32768.0f);
     }
     
-    start_idx = std::max(0, mono_count - fft_shift);
-    for (int i = 0; i < fft_shift; ++i) {
-        int src_idx = (start_idx + i) * 2;
-        float left = samples[src_idx] / 32768.0f;
-        float right = samples[src_idx + 1] / 32768.0f;
-        fft_input_[FFT_SIZE - fft_shift + i] = (left + right) * 0.5f;
+    output_peak_ = std::max(output_peak_, peak);
+    
+    // Rough per-channel levels from the overall signal, unless taps give real ones
+    if (frame_count > first && !taps_active_.load(std::memory_order_relaxed)) {
+        updateChannelAmplitudes(std::sqrt(sum_squares / (frame_count - first)));
+    }
+}
+
+void AudioVisualizer::appendMonoSamples(const short* samples, int frame_count) {
+    int first = std::max(0, frame_count - SCOPE_SIZE);
+    
+    // Convert once into the mono plane; left and right are copies of it
+    const uint32_t mask = SCOPE_SIZE - 1;
+    uint32_t pos = scope_write_;
+    float sum_squares = 0.0f;
+    float peak = 0.0f;
+    int64_t sum_q30 = 0;
+    int32_t peak_q15 = 0;
+    for (int i = first; i < frame_count;) {
+        const uint32_t dst = pos & mask;
+        const int n = std::min(frame_count - i, static_cast<int>(SCOPE_SIZE - dst));
+        if (fixed_point_) {
+            AudioKernels::s16MonoAnalyzeQ15(samples + i, &scope_mono_[dst], &scope_mono_q15_[dst], n, &sum_q30,
+                                            &peak_q15);
+        } else {
+            AudioKernels::s16MonoAnalyze(samples + i, &scope_mono_[dst], n, &sum_squares, &peak);
+        }
+        std::memcpy(&scope_left_[dst], &scope_mono_[dst], n * sizeof(float));
+        std::memcpy(&scope_right_[dst], &scope_mono_[dst], n * sizeof(float));
+        loudness_.process(&scope_left_[dst], &scope_right_[dst], n);
+        history_left_.push(&scope_mono_[dst], n);
+        history_right_.push(&scope_mono_[dst], n);
+        i += n;
+        pos += n;
+    }
+    scope_write_ = pos;
+    if (fixed_point_) {
+        sum_squares = static_cast<float>(sum_q30) * (1.0f / (1 << 30));
+        peak = static_cast<float>(peak_q15) * (1.0f / 32768.0f);
     }
     
-    // Process FFT and update spectrum
-    processFFT();
+    output_peak_ = std::max(output_peak_, peak);
     
-    // Update channel amplitudes (rough estimation from overall signal)
-    updateChannelAmplitudes(samples, sample_count);
+    if (frame_count > first && !taps_active_.load(std::memory_order_relaxed)) {
+        updateChannelAmplitudes(std::sqrt(sum_squares / (frame_count - first)));
+    }
+}
+
+void AudioVisualizer::drainLevelPoints() {
+    // Pass the points the clock has reached, as drainBlocks() does the
+    // blocks; without a clock, or for a point from before a clock reset,
+    // the newest is shown at once
+    const int64_t clock = playbackClock();
+    const int64_t max_lead = static_cast<int64_t>(sample_rate_) * 2;
+    bool passed = false;
+    for (;;) {
+        if (!has_level_to_) {
+            if (level_ring_.pop(&level_to_, 1) == 0) break;
+            has_level_to_ = true;
+        }
+        if (clock != UNTIMED && level_to_.stream_frame > clock && level_to_.stream_frame - clock < max_lead) break;
+        level_from_ = level_to_;
+        has_level_from_ = true;
+        has_level_to_ = false;
+        passed = true;
+    }
+    // Nothing timed in flight: leave the levels to untimed producers
+    if (!has_level_from_ || (!passed && !has_level_to_)) return;
+    
+    float t = 0.0f;
+    const int64_t span = level_to_.stream_frame - level_from_.stream_frame;
+    if (has_level_to_ && clock != UNTIMED && span > 0) {
+        t = std::clamp(static_cast<float>(clock - level_from_.stream_frame) / span, 0.0f, 1.0f);
+    }
+    for (int c = 0; c < ChannelTable::MAX_CHANNELS; ++c) {
+        const float from = level_from_.levels[c];
+        const float to = has_level_to_ ? level_to_.levels[c] : from;
+        channel_amplitudes_[c].store(from + (to - from) * t, std::memory_order_relaxed);
+    }
 }
 
-void AudioVisualizer::processFFT() {
-    // Apply Hann window and prepare complex data
-    std::vector<std::complex<float>> fftData(FFT_SIZE);
-    for (int i = 0; i < FFT_SIZE; ++i) {
-        float window = 0.5f * (1.0f - std::cos(2.0f * static_cast<float>(M_PI) * i / (FFT_SIZE - 1)));
-        fftData[i] = std::complex<float>(fft_input_[i] * window, 0.0f);
+void AudioVisualizer::drainChannelTaps() {
+    // Only the last TAP_SCOPE_SIZE frames of each channel can be shown
+    const size_t max_samples = static_cast<size_t>(TAP_SCOPE_SIZE) * TAP_CHANNELS;
+    size_t available = tap_ring_.readAvailable();
+    if (available > max_samples) {
+        tap_ring_.skip(available - max_samples);
     }
     
-    // Perform FFT
-    SimpleFFT::fft(fftData);
+    size_t count = tap_ring_.pop(tap_drain_.data(), max_samples);
+    const int frame_count = static_cast<int>(count / TAP_CHANNELS);
+    const uint32_t mask = TAP_SCOPE_SIZE - 1;
+    for (int c = 0; c < TAP_CHANNELS; ++c) {
+        float* ring = tap_scopes_.data() + static_cast<size_t>(c) * TAP_SCOPE_SIZE;
+        const short* src = tap_drain_.data() + c;
+        uint32_t pos = tap_write_;
+        for (int i = 0; i < frame_count; ++i, ++pos) {
+            ring[pos & mask] = src[i * TAP_CHANNELS] / 32768.0f;
+        }
+    }
+    tap_write_ += static_cast<uint32_t>(frame_count);
+    scrub_history_.pushTaps(tap_drain_.data(), frame_count, TAP_CHANNELS, std::min(channels_.count, TAP_CHANNELS));
+}
+
+// Display level of a bin's mean power: -60..0 dB as 0..1
+static float spectrumLevel(float power, bool precise) {
+    // Add small value to avoid log(0); 10*log10(p) == 20*log10(|X|)
+    power += 1e-20f;
+    float db = precise ? 10.0f * std::log10(power) : 3.01029996f * fastLog2(power);
+    return std::clamp((db + 60.0f) / 60.0f, 0.0f, 1.0f);
+}
+
+void AudioVisualizer::processFFT(uint32_t end_pos) {
+    FrameProfiler::Scope profile_scope(FrameProfiler::FFT);
+    FC_ZONE("processFFT");
+    // Unwrap the fft_size_ mono frames ending at end_pos (oldest first)
+    const int n = fft_size_;
+    const uint32_t start = (end_pos - n) & (SCOPE_SIZE - 1);
+    const size_t head = std::min<size_t>(n, SCOPE_SIZE - start);
+    if (fixed_point_) {
+        // Both spans of the Q15 ring windowed straight into the packed input,
+        // then approximate magnitudes; no float until the display bins
+        int32_t* fftData = fft_plan_q15_.scratch();
+        const int shift = fft_plan_q15_.inputShift();
+        AudioKernels::windowQ15(scope_mono_q15_.data() + start, fft_plan_q15_.window(), fftData,
+                                static_cast<int>(head), shift);
+        AudioKernels::windowQ15(scope_mono_q15_.data(), fft_plan_q15_.window() + head, fftData + head,
+                                static_cast<int>(n - head), shift);
+        SimpleFFT::rfftQ15(fftData, fft_plan_q15_);
+        AudioKernels::complexMagnitudeQ(fftData, fft_magnitude_q15_.data(), n / 2);
+    } else {
+        std::memcpy(fft_input_.data(), scope_mono_.data() + start, head * sizeof(float));
+        std::memcpy(fft_input_.data() + head, scope_mono_.data(), (n - head) * sizeof(float));
+        
+        // Real-input FFT with the cached Hann window, into the plan's scratch buffer
+        std::complex<float>* fftData = fft_plan_.scratch();
+        SimpleFFT::rfft(fft_input_.data(), fft_plan_.window(), fftData, fft_plan_);
+        
+        // Squared magnitudes of the useful bins; no sqrt needed since dB works on power
+        AudioKernels::complexPower(reinterpret_cast<const float*>(fftData), fft_power_.data(), n / 2);
+    }
     
-    // Compute magnitudes
-    std::vector<float> newSpectrum;
-    SimpleFFT::computeMagnitude(fftData, newSpectrum, SPECTRUM_BINS);
+    // Window gain grows with the size; keep levels where REFERENCE_FFT_SIZE put them
+    const float size_scale = static_cast<float>(REFERENCE_FFT_SIZE) / n;
+    const float power_scale = size_scale * size_scale;
+    const float q15_power_scale = std::ldexp(power_scale, -2 * fft_plan_q15_.scaleBits());
     
-    // Convert to dB and normalize
+    // Average power per display bin, convert to dB and normalize
     for (int i = 0; i < SPECTRUM_BINS; ++i) {
-        // Add small value to avoid log(0)
-        float db = 20.0f * std::log10(newSpectrum[i] + 1e-10f);
-        // Normalize to 0-1 range (assuming -60dB to 0dB range)
-        float normalized = (db + 60.0f) / 60.0f;
-        normalized = std::clamp(normalized, 0.0f, 1.0f);
+        const uint32_t begin = bin_map_.start(i);
+        const uint32_t end = bin_map_.end(i);
+        float power = 0.0f;
+        if (fixed_point_) {
+            // Bounded by Parseval's sum over the window, which fits in 2^63
+            uint64_t sum = 0;
+            for (uint32_t j = begin; j < end; ++j) {
+                const uint64_t magnitude = static_cast<uint32_t>(fft_magnitude_q15_[j]);
+                sum += magnitude * magnitude;
+            }
+            power = static_cast<float>(sum) * (q15_power_scale / static_cast<float>(end - begin));
+        } else {
+            for (uint32_t j = begin; j < end; ++j) {
+                power += fft_power_[j];
+            }
+            power *= power_scale / static_cast<float>(end - begin);
+        }
+        const float normalized = spectrumLevel(power, precise_spectrum_);
         
         // Smooth with previous values
         spectrum_data_[i] = spectrum_smoothing_ * spectrum_data_[i] + 
@@ -240,155 +1066,352 @@ void AudioVisualizer::processFFT() {
         }
     }
     
-    // Update history for waterfall display
-    spectrum_history_[spectrum_history_pos_] = spectrum_data_;
+    // Append one row to the waterfall ring and its pixel copy; a rebuilt
+    // past leaves the waterfall as it was
+    if (scrubbed_) return;
+    float* row = spectrum_history_.data() + spectrum_history_pos_ * SPECTRUM_BINS;
+    uint32_t* pixels = spectrogram_pixels_.data() + spectrum_history_pos_ * SPECTRUM_BINS;
+    for (int i = 0; i < SPECTRUM_BINS; ++i) {
+        row[i] = spectrum_data_[i];
+        pixels[i] = lookupSpectrumColor(spectrum_data_[i], static_cast<float>(i) / SPECTRUM_BINS);
+    }
     spectrum_history_pos_ = (spectrum_history_pos_ + 1) % HISTORY_SIZE;
+    spectrogram_dirty_ = true;
 }
 
-void AudioVisualizer::updateChannelAmplitudes(const short* samples, int sample_count) {
-    // Calculate overall RMS
-    float rms = 0.0f;
-    int mono_count = sample_count / 2;
-    for (int i = 0; i < mono_count; ++i) {
-        float left = samples[i * 2] / 32768.0f;
-        float right = samples[i * 2 + 1] / 32768.0f;
-        float mono = (left + right) * 0.5f;
-        rms += mono * mono;
+void AudioVisualizer::updateSpectrumIfDirty() {
+    // One FFT per completed hop since the last analysis, shared by the bars and
+    // the waterfall, so the cost follows the hop rate and not the block size
+    const uint32_t hop = static_cast<uint32_t>(fft_size_ / FFT_HOP_DIVISOR);
+    uint32_t pending = (scope_write_ - analysis_pos_) / hop;
+    if (pending > MAX_HOPS_PER_FRAME) {
+        analysis_pos_ += (pending - MAX_HOPS_PER_FRAME) * hop;
+        pending = MAX_HOPS_PER_FRAME;
     }
-    rms = std::sqrt(rms / std::max(1, mono_count));
-    
-    // Distribute amplitude across channels (estimation)
-    // In reality, we'd need separate channel buffers from the APU
-    // For now, we simulate based on frequency content
-    for (int i = 0; i < static_cast<int>(NesChannel::BaseCount); ++i) {
-        // Decay existing amplitude
-        channel_amplitudes_[i] *= 0.9f;
-        
-        // Add contribution based on overall amplitude
-        // This is a rough approximation
-        float contribution = rms * (1.0f - (mute_mask_ & (1 << i) ? 1.0f : 0.0f));
-        channel_amplitudes_[i] = std::max(channel_amplitudes_[i], contribution);
-        
-        // Update peaks
-        if (channel_amplitudes_[i] > channel_peaks_[i]) {
-            channel_peaks_[i] = channel_amplitudes_[i];
-        }
+    for (uint32_t i = 0; i < pending; ++i) {
+        analysis_pos_ += hop;
+        processFFT(analysis_pos_);
     }
 }
 
-void AudioVisualizer::updateChannelAmplitudesFromAPU(const int* amplitudes) {
-    // Deprecated: use the version with lengths parameter for accurate display
-    // This version doesn't know if channels are actually active
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
-    for (int i = 0; i < static_cast<int>(NesChannel::BaseCount); ++i) {
-        int amp = std::abs(amplitudes[i]);
-        float normalized = 0.0f;
-        
-        if (i == static_cast<int>(NesChannel::Square1) || 
-            i == static_cast<int>(NesChannel::Square2) ||
-            i == static_cast<int>(NesChannel::Noise)) {
-            // These channels: last_amp reflects actual volume (0-15)
-            normalized = amp / 15.0f;
-        } else if (i == static_cast<int>(NesChannel::Triangle)) {
-            // Triangle: use amp > 0 as activity indicator, fixed level
-            normalized = (amp > 0) ? 0.8f : 0.0f;
-            normalized = amp / 15.0f;
-        } else if (i == static_cast<int>(NesChannel::DMC)) {
-            // DMC: use amp > 0 as activity indicator, fixed level
-            normalized = (amp > 0) ? 0.7f : 0.0f;
+void AudioVisualizer::processChannelFFT(uint32_t end_pos) {
+    FrameProfiler::Scope profile_scope(FrameProfiler::FFT);
+    FC_ZONE("processChannelFFT");
+    // Every channel's window interleaved, padded to whole vectors of lanes
+    const int channel_count = std::min(channels_.count, TAP_CHANNELS);
+    const int lanes = std::min((channel_count + 3) & ~3, TAP_CHANNELS);
+    const int n = CHANNEL_FFT_SIZE;
+    const uint32_t mask = TAP_SCOPE_SIZE - 1;
+    const uint32_t start = end_pos - n;
+    for (int c = 0; c < lanes; ++c) {
+        float* dst = channel_fft_input_.data() + c;
+        if (c >= channel_count) {
+            for (int i = 0; i < n; ++i) dst[static_cast<size_t>(i) * lanes] = 0.0f;
+            continue;
         }
-        
-        channel_amplitudes_[i] = std::max(channel_amplitudes_[i] * 0.85f, normalized);
-        
-        if (channel_amplitudes_[i] > channel_peaks_[i]) {
-            channel_peaks_[i] = channel_amplitudes_[i];
+        const float* ring = tap_scopes_.data() + static_cast<size_t>(c) * TAP_SCOPE_SIZE;
+        for (int i = 0; i < n; ++i) dst[static_cast<size_t>(i) * lanes] = ring[(start + i) & mask];
+    }
+    
+    // One transform for all of them, each as its own rfft() would give
+    float* re = channel_fft_re_.data();
+    float* im = channel_fft_im_.data();
+    SimpleFFT::rfftLanes(channel_fft_input_.data(), channel_plan_.window(), re, im, lanes, channel_plan_);
+    
+    // Levels as the mixed spectrum's, per channel
+    const float size_scale = static_cast<float>(REFERENCE_FFT_SIZE) / n;
+    const float power_scale = size_scale * size_scale;
+    for (int c = 0; c < channel_count; ++c) {
+        float* data = channel_spectra_.data() + static_cast<size_t>(c) * CHANNEL_SPECTRUM_BINS;
+        float* peaks = channel_spectrum_peaks_.data() + static_cast<size_t>(c) * CHANNEL_SPECTRUM_BINS;
+        for (int i = 0; i < CHANNEL_SPECTRUM_BINS; ++i) {
+            const uint32_t begin = channel_bin_map_.start(i);
+            const uint32_t end = channel_bin_map_.end(i);
+            float power = 0.0f;
+            for (uint32_t j = begin; j < end; ++j) {
+                const size_t at = static_cast<size_t>(j) * lanes + c;
+                power += re[at] * re[at] + im[at] * im[at];
+            }
+            power *= power_scale / static_cast<float>(end - begin);
+            const float normalized = spectrumLevel(power, precise_spectrum_);
+            data[i] = spectrum_smoothing_ * data[i] + (1.0f - spectrum_smoothing_) * normalized;
+            peaks[i] = std::max(peaks[i], data[i]);
         }
     }
 }
 
-void AudioVisualizer::updateChannelAmplitudesFromAPU(const int* amplitudes, const int* lengths) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
+void AudioVisualizer::updateChannelSpectraIfDirty() {
+    // Per hop of channel frames, as the mixed spectrum
+    const uint32_t hop = CHANNEL_FFT_SIZE / FFT_HOP_DIVISOR;
+    if (tap_write_ < static_cast<uint32_t>(CHANNEL_FFT_SIZE)) return;
+    if (channel_analysis_pos_ < static_cast<uint32_t>(CHANNEL_FFT_SIZE) - hop) {
+        channel_analysis_pos_ = CHANNEL_FFT_SIZE - hop;
+    }
+    uint32_t pending = (tap_write_ - channel_analysis_pos_) / hop;
+    if (pending > MAX_HOPS_PER_FRAME) {
+        channel_analysis_pos_ += (pending - MAX_HOPS_PER_FRAME) * hop;
+        pending = MAX_HOPS_PER_FRAME;
+    }
+    for (uint32_t i = 0; i < pending; ++i) {
+        channel_analysis_pos_ += hop;
+        processChannelFFT(channel_analysis_pos_);
+    }
+}
+
+void AudioVisualizer::updateNoteSpectrum() {
+    // Feed the filters everything written since the last frame, oldest first
+    if (scope_write_ - note_pos_ > static_cast<uint32_t>(SCOPE_SIZE)) {
+        note_pos_ = scope_write_ - SCOPE_SIZE;
+    }
+    while (note_pos_ != scope_write_) {
+        uint32_t start = note_pos_ & (SCOPE_SIZE - 1);
+        uint32_t count = std::min<uint32_t>(scope_write_ - note_pos_, SCOPE_SIZE - start);
+        note_bank_.process(scope_mono_.data() + start, static_cast<int>(count));
+        note_pos_ += count;
+    }
     
-    // NES APU channel characteristics:
-    // Square 1/2: last_amp is actual output amplitude (-15 to +15), reflects volume
-    // Triangle: last_amp is waveform position (0-15 oscillating), NO volume control!
-    // Noise: last_amp is actual output amplitude, reflects volume  
-    // DMC: last_amp is DAC value (0-127), doesn't reset when stopped
+    for (int i = 0; i < note_bank_.noteCount(); ++i) {
+        note_data_[i] = spectrum_smoothing_ * note_data_[i] + (1.0f - spectrum_smoothing_) * note_bank_.level(i);
+        note_peaks_[i] = std::max(note_peaks_[i], note_data_[i]);
+    }
+}
+
+void AudioVisualizer::setScrubAllowed(bool allowed) {
+    scrub_allowed_ = allowed;
+    if (allowed || !scrubbed_) return;
+    // Back to the newest samples for playback to continue from; their
+    // spectra are already in the waterfall
+    rebuildFromHistory(scrub_history_.outputEnd());
+    analysis_pos_ = scope_write_;
+    scrubbed_ = false;
+}
+
+void AudioVisualizer::scrubTo(float seconds_back) {
+    if (!scrub_allowed_ || scrub_history_.outputEnd() == 0) return;
+    const uint64_t held = scrub_history_.outputEnd() - scrub_history_.outputStart();
+    const uint64_t back = std::min<uint64_t>(static_cast<uint64_t>(std::max(seconds_back, 0.0f) * sample_rate_), held);
+    scrubbed_ = true;
+    rebuildFromHistory(scrub_history_.outputEnd() - back);
+}
+
+float AudioVisualizer::scrubPosition() const {
+    if (!scrubbed_ || sample_rate_ <= 0) return 0.0f;
+    return static_cast<float>(scrub_history_.outputEnd() - scrub_end_) / sample_rate_;
+}
+
+float AudioVisualizer::scrubRange() const {
+    if (sample_rate_ <= 0) return 0.0f;
+    return static_cast<float>(scrub_history_.outputEnd() - scrub_history_.outputStart()) / sample_rate_;
+}
+
+void AudioVisualizer::rebuildFromHistory(uint64_t end) {
+    // The rings as if end had just been drained, from position 0; frames
+    // before the history read as silence
+    const ScrubHistory& history = scrub_history_;
+    history.readOutput(end, SCOPE_SIZE, scope_left_.data(), scope_right_.data());
+    for (int i = 0; i < SCOPE_SIZE; ++i) scope_mono_[i] = (scope_left_[i] + scope_right_[i]) * 0.5f;
+    if (fixed_point_) toQ15(scope_mono_.data(), scope_mono_q15_.data(), SCOPE_SIZE);
+    scope_write_ = SCOPE_SIZE;
+    
+    // Long scope windows: re-summarize what they span, a slice at a time
+    constexpr int SLICE = 4096;
+    scrub_scratch_.resize(SLICE * 2);
+    float* left = scrub_scratch_.data();
+    float* right = left + SLICE;
+    const uint64_t span = std::min<uint64_t>(end - std::min(end, history.outputStart()),
+                                             static_cast<uint64_t>(sample_rate_ * MAX_SCOPE_WINDOW_MS / 1000.0f));
+    history_left_.reset();
+    history_right_.reset();
+    for (uint64_t at = end - span; at < end;) {
+        const int n = static_cast<int>(std::min<uint64_t>(SLICE, end - at));
+        at += n;
+        history.readOutput(at, n, left, right);
+        history_left_.push(left, n);
+        history_right_.push(right, n);
+    }
     
-    for (int i = 0; i < static_cast<int>(NesChannel::BaseCount); ++i) {
-        float normalized = 0.0f;
-        bool use_averaging = false;  // Use averaging instead of max for some channels
-        
-        // Check if channel is active (length counter > 0)
-        bool is_active = (lengths[i] > 0);
-        
-        if (is_active) {
-            int amp = std::abs(amplitudes[i]);
-            
-            if (i == static_cast<int>(NesChannel::Square1) || 
-                i == static_cast<int>(NesChannel::Square2)) {
-                // Square waves: last_amp reflects actual volume (0-15)
-                normalized = amp / 15.0f;
-            } else if (i == static_cast<int>(NesChannel::Triangle)) {
-                // Triangle: NO volume control, waveform oscillates 0-15
-                // Use averaging to get stable ~0.5 level when active
-                normalized = amp / 15.0f;
-                use_averaging = true;
-            } else if (i == static_cast<int>(NesChannel::Noise)) {
-                // Noise: last_amp reflects actual volume (0-15)
-                normalized = amp / 15.0f;
-            } else if (i == static_cast<int>(NesChannel::DMC)) {
-                // DMC: DAC value (0-127), use it as activity level
-                normalized = amp / 127.0f;
-                use_averaging = true;
+    // Sample peak of the newest video frame's worth, as the readout shows live
+    const int frame_span = std::clamp(static_cast<int>(sample_rate_ / 60), 1, SCOPE_SIZE);
+    float peak = 0.0f;
+    for (int i = SCOPE_SIZE - frame_span; i < SCOPE_SIZE; ++i) {
+        peak = std::max({peak, std::abs(scope_left_[i]), std::abs(scope_right_[i])});
+    }
+    output_peak_ = peak;
+    
+    // Taps run ahead of the output by the render-ahead while playing, and
+    // catch up once paused: their newest frames line up with the output's
+    if (history.tapChannels() > 0) {
+        const uint64_t back = history.outputEnd() - end;
+        const uint64_t tap_end = history.tapEnd() - std::min(back, history.tapEnd());
+        const int tap_span = std::min(frame_span, TAP_SCOPE_SIZE);
+        for (int c = 0; c < TAP_CHANNELS; ++c) {
+            float* ring = tap_scopes_.data() + static_cast<size_t>(c) * TAP_SCOPE_SIZE;
+            history.readTap(c, tap_end, TAP_SCOPE_SIZE, ring);
+            float tap_peak = 0.0f;
+            for (int i = TAP_SCOPE_SIZE - tap_span; i < TAP_SCOPE_SIZE; ++i) {
+                tap_peak = std::max(tap_peak, std::abs(ring[i]));
             }
+            if (c < history.tapChannels()) channel_amplitudes_[c].store(tap_peak, std::memory_order_relaxed);
         }
-        
-        // Apply smoothing
-        if (use_averaging) {
-            // For Triangle/DMC: use exponential moving average (smoother)
-            channel_amplitudes_[i] = channel_amplitudes_[i] * 0.95f + normalized * 0.05f;
-        } else {
-            // For Square/Noise: use max with decay (responsive to peaks)
-            channel_amplitudes_[i] = std::max(channel_amplitudes_[i] * 0.85f, normalized);
-        }
-        
-        // Update peaks
-        if (channel_amplitudes_[i] > channel_peaks_[i]) {
-            channel_peaks_[i] = channel_amplitudes_[i];
-        }
+        tap_write_ = TAP_SCOPE_SIZE;
+        channel_analysis_pos_ = tap_write_ - MAX_HOPS_PER_FRAME * (CHANNEL_FFT_SIZE / FFT_HOP_DIVISOR);
     }
+    
+    // The spectra recompute over the newest hops on their next draw, the
+    // note filters over the whole ring
+    analysis_pos_ = scope_write_ - MAX_HOPS_PER_FRAME * static_cast<uint32_t>(fft_size_ / FFT_HOP_DIVISOR);
+    note_bank_.reset();
+    note_pos_ = 0;
+    phosphor_.clear();
+    
+    scrub_end_ = end;
+    scrub_drained_ = history.outputEnd();
+}
+
+#ifndef NES_HEADLESS
+void AudioVisualizer::createSpectrogramTexture() {
+    if (texture_created_) return;
+    
+    // One texel per bin and history row, re-uploaded whole when rows were added
+    sg_image_desc img_desc = {};
+    img_desc.width = SPECTRUM_BINS;
+    img_desc.height = HISTORY_SIZE;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.usage.stream_update = true;
+    
+    spectrogram_texture_ = sg_make_image(&img_desc);
+    
+    // Repeat vertically so the ring can be drawn as one quad with a V offset
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_REPEAT;
+    
+    spectrogram_sampler_ = sg_make_sampler(&smp_desc);
+    
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = spectrogram_texture_;
+    
+    spectrogram_view_ = sg_make_view(&view_desc);
+    
+    texture_created_ = true;
+    spectrogram_dirty_ = true;
 }
 
-void AudioVisualizer::updateVRC6ChannelAmplitudes(const int* amplitudes) {
-    if (!has_vrc6_) return;
+void AudioVisualizer::createPhosphorTexture() {
+    if (phosphor_created_) return;
     
-    std::lock_guard<std::mutex> lock(audio_mutex_);
+    phosphor_pixels_.assign(static_cast<size_t>(PhosphorScope::WIDTH) * PhosphorScope::HEIGHT, 0);
     
-    // VRC6 channels: Pulse1, Pulse2, Saw
-    // Pulse1/Pulse2: 4-bit volume (0-15)
-    // Saw: accumulator output (0-31 typical)
+    sg_image_desc img_desc = {};
+    img_desc.width = PhosphorScope::WIDTH;
+    img_desc.height = PhosphorScope::HEIGHT;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.usage.stream_update = true;
     
-    for (int i = 0; i < static_cast<int>(NesChannel::VRC6Count); ++i) {
-        int channel_idx = static_cast<int>(NesChannel::VRC6_Pulse1) + i;
-        int amp = std::abs(amplitudes[i]);
-        float normalized;
+    phosphor_texture_ = sg_make_image(&img_desc);
+    
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    
+    phosphor_sampler_ = sg_make_sampler(&smp_desc);
+    
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = phosphor_texture_;
+    
+    phosphor_view_ = sg_make_view(&view_desc);
+    
+    phosphor_created_ = true;
+}
+
+void AudioVisualizer::destroyTextures() {
+    if (texture_created_) {
+        sg_destroy_view(spectrogram_view_);
+        sg_destroy_sampler(spectrogram_sampler_);
+        sg_destroy_image(spectrogram_texture_);
+        texture_created_ = false;
+    }
+    if (phosphor_created_) {
+        sg_destroy_view(phosphor_view_);
+        sg_destroy_sampler(phosphor_sampler_);
+        sg_destroy_image(phosphor_texture_);
+        phosphor_created_ = false;
+    }
+}
+#endif
+
+void AudioVisualizer::setPhosphorPersistence(float ms) {
+    // Start from a dark screen rather than the glow left from last time
+    if (phosphor_ms_ <= 0.0f && ms > 0.0f) phosphor_.clear();
+    phosphor_ms_ = std::max(0.0f, ms);
+}
+
+void AudioVisualizer::reportMemory(MemoryReport::Sample& sample) const {
+    using MR = MemoryReport;
+    size_t bytes = sizeof(*this) + sample_ring_.memoryBytes() + mono_ring_.memoryBytes() +
+                   tag_ring_.memoryBytes() + tap_ring_.memoryBytes() + fft_plan_.memoryBytes() +
+                   fft_plan_q15_.memoryBytes() + channel_plan_.memoryBytes() +
+                   history_left_.memoryBytes() + history_right_.memoryBytes() + phosphor_.memoryBytes() +
+                   scrub_history_.memoryBytes();
+    for (const std::vector<float>* v : {&tap_scopes_, &scope_left_, &scope_right_, &scope_mono_, &column_lo_,
+                                        &column_hi_, &fft_input_, &trigger_scratch_, &note_data_, &note_peaks_,
+                                        &fft_power_, &spectrum_data_, &spectrum_peaks_, &spectrum_history_,
+                                        &channel_fft_input_, &channel_fft_re_, &channel_fft_im_, &channel_spectra_,
+                                        &channel_spectrum_peaks_}) {
+        bytes += MR::heapBytes(*v);
+    }
+    bytes += MR::heapBytes(drain_buffer_) + MR::heapBytes(tap_drain_) + MR::heapBytes(scope_points_) +
+             MR::heapBytes(color_lut_) + MR::heapBytes(spectrogram_pixels_) + MR::heapBytes(phosphor_pixels_) +
+             MR::heapBytes(scrub_scratch_) + MR::heapBytes(scope_mono_q15_) + MR::heapBytes(fft_magnitude_q15_);
+    sample.add(MR::VISUALIZER, bytes);
+    
+    // RGBA8 on the device
+    if (texture_created_) sample.add(MR::TEXTURES, size_t(SPECTRUM_BINS) * HISTORY_SIZE * 4);
+    if (phosphor_created_) sample.add(MR::TEXTURES, size_t(PhosphorScope::WIDTH) * PhosphorScope::HEIGHT * 4);
+}
+
+void AudioVisualizer::updateChannelAmplitudes(float rms) {
+    // Distribute amplitude across channels (estimation)
+    // In reality, we'd need separate channel buffers from the APU
+    // For now, we simulate based on frequency content
+    int mute_mask = mute_mask_.load(std::memory_order_relaxed);
+    for (int i = 0; i < ChannelTable::APU_CHANNELS; ++i) {
+        // Decay existing amplitude
+        float amp = channel_amplitudes_[i].load(std::memory_order_relaxed) * 0.9f;
         
-        if (i == 2) {
-            // Saw wave - uses accumulator, typical range 0-31
-            normalized = std::min(1.0f, amp / 31.0f);
-        } else {
-            // Pulse waves - 4-bit volume (0-15)
-            normalized = amp / 15.0f;
+        // Add contribution based on overall amplitude
+        // This is a rough approximation
+        float contribution = rms * (1.0f - (mute_mask & (1 << i) ? 1.0f : 0.0f));
+        channel_amplitudes_[i].store(std::max(amp, contribution), std::memory_order_relaxed);
+    }
+}
+
+void AudioVisualizer::updateChannelLevels(const ChannelTable& table, int64_t stream_frame) {
+    if (taps_active_.load(std::memory_order_relaxed)) return;
+    
+    if (stream_frame != UNTIMED) {
+        for (int i = 0; i < table.count; ++i) {
+            const float prev = timed_levels_[i];
+            timed_levels_[i] = table.smooth_level[i] ? prev * 0.95f + table.level[i] * 0.05f
+                                                     : std::max(prev * 0.85f, table.level[i]);
         }
-        
-        // Apply smoothing
-        channel_amplitudes_[channel_idx] = std::max(channel_amplitudes_[channel_idx] * 0.85f, normalized);
-        
-        // Update peaks
-        if (channel_amplitudes_[channel_idx] > channel_peaks_[channel_idx]) {
-            channel_peaks_[channel_idx] = channel_amplitudes_[channel_idx];
+        std::fill(timed_levels_.begin() + table.count, timed_levels_.end(), 0.0f);
+        pushLevelPoint(stream_frame);
+        return;
+    }
+    
+    for (int i = 0; i < table.count; ++i) {
+        float prev = channel_amplitudes_[i].load(std::memory_order_relaxed);
+        if (table.smooth_level[i]) {
+            // Triangle/DMC report a waveform step or DAC value: exponential moving average (smoother)
+            channel_amplitudes_[i].store(prev * 0.95f + table.level[i] * 0.05f, std::memory_order_relaxed);
+        } else {
+            // Volume-driven outputs: max with decay (responsive to peaks)
+            channel_amplitudes_[i].store(std::max(prev * 0.85f, table.level[i]), std::memory_order_relaxed);
         }
     }
 }
@@ -400,27 +1423,38 @@ void AudioVisualizer::decayPeaks(float delta_time) {
         peak *= decay;
     }
     
+    for (auto& peak : note_peaks_) {
+        peak *= decay;
+    }
+    
+    for (auto& peak : channel_spectrum_peaks_) {
+        peak *= decay;
+    }
+    
     for (auto& peak : channel_peaks_) {
         peak *= decay;
     }
+    
+    output_peak_ *= decay;
 }
 
-void AudioVisualizer::setChannelMute(NesChannel channel, bool mute) {
-    int bit = 1 << static_cast<int>(channel);
+void AudioVisualizer::setChannelMute(int channel, bool mute) {
+    if (channel < 0 || channel >= channels_.count) return;
+    int bit = 1 << channels_.voice[channel];
     if (mute) {
-        mute_mask_ |= bit;
+        mute_mask_.fetch_or(bit, std::memory_order_relaxed);
     } else {
-        mute_mask_ &= ~bit;
-    }
-    
-    // Apply to emulator if available
-    if (emu_) {
-        gme_mute_voices(emu_, mute_mask_);
+        mute_mask_.fetch_and(~bit, std::memory_order_relaxed);
     }
 }
 
-bool AudioVisualizer::isChannelMuted(NesChannel channel) const {
-    return (mute_mask_ & (1 << static_cast<int>(channel))) != 0;
+void AudioVisualizer::setMutesInEmulator(bool in_emulator) {
+    mutes_in_emulator_ = in_emulator;
+}
+
+bool AudioVisualizer::isChannelMuted(int channel) const {
+    if (channel < 0 || channel >= channels_.count) return false;
+    return (getMuteMask() & (1 << channels_.voice[channel])) != 0;
 }
 
 ImU32 AudioVisualizer::vec4ToU32(const ImVec4& col) {
@@ -434,9 +1468,9 @@ ImU32 AudioVisualizer::vec4ToU32(const ImVec4& col) {
 
 ImU32 AudioVisualizer::getSpectrumColor(float normalized_value, float normalized_freq) {
     // Create a nice gradient from blue (low) to cyan to green to yellow to red (high)
-    float h = (1.0f - normalized_value) * 0.7f; // Hue from red to blue
+    float h = (1.0f - normalized_value) * gradient_hue_span_; // Hue from red to blue
     float s = 0.8f + 0.2f * normalized_freq;
-    float v = 0.3f + 0.7f * normalized_value;
+    float v = gradient_min_brightness_ + (1.0f - gradient_min_brightness_) * normalized_value;
     
     // HSV to RGB conversion
     float c = v * s;
@@ -462,6 +1496,33 @@ ImU32 AudioVisualizer::getSpectrumColor(float normalized_value, float normalized
     );
 }
 
+void AudioVisualizer::rebuildColorLut() {
+    color_lut_.resize(COLOR_LUT_FREQS * COLOR_LUT_VALUES);
+    for (int f = 0; f < COLOR_LUT_FREQS; ++f) {
+        float freq = static_cast<float>(f) / (COLOR_LUT_FREQS - 1);
+        for (int v = 0; v < COLOR_LUT_VALUES; ++v) {
+            color_lut_[f * COLOR_LUT_VALUES + v] = getSpectrumColor(static_cast<float>(v) / (COLOR_LUT_VALUES - 1), freq);
+        }
+    }
+    
+    // Recolour the waterfall from its stored levels
+    for (int i = 0; i < HISTORY_SIZE * SPECTRUM_BINS; ++i) {
+        spectrogram_pixels_[i] = lookupSpectrumColor(spectrum_history_[i],
+                                                     static_cast<float>(i % SPECTRUM_BINS) / SPECTRUM_BINS);
+    }
+    spectrogram_dirty_ = true;
+}
+
+void AudioVisualizer::setSpectrumGradient(float hue_span, float min_brightness) {
+    hue_span = std::clamp(hue_span, 0.0f, 1.0f);
+    min_brightness = std::clamp(min_brightness, 0.0f, 1.0f);
+    if (hue_span == gradient_hue_span_ && min_brightness == gradient_min_brightness_ && !color_lut_.empty()) return;
+    gradient_hue_span_ = hue_span;
+    gradient_min_brightness_ = min_brightness;
+    rebuildColorLut();
+}
+
+#ifndef NES_HEADLESS
 void AudioVisualizer::drawVisualizerWindow(bool* p_open) {
     ImGui::SetNextWindowSize(ImVec2(600, 500), ImGuiCond_FirstUseEver);
     
@@ -470,15 +1531,21 @@ void AudioVisualizer::drawVisualizerWindow(bool* p_open) {
         return;
     }
     
-    // Decay peaks
+    // Drain audio queued since the last frame, then decay peaks
+    processPendingAudio();
     decayPeaks(ImGui::GetIO().DeltaTime);
     
-    // Top section: Waveform and Spectrum side by side
+    // Paused: back through what was heard
     float available_width = ImGui::GetContentRegionAvail().x;
+    if (scrub_allowed_ && scrubRange() > 0.0f) drawScrubBar(available_width);
+    
+    // Top section: Waveform and Spectrum side by side
     float section_width = (available_width - 10) / 2;
     
     ImGui::BeginChild("Waveform Section", ImVec2(section_width, 180), true);
     ImGui::Text("Waveform");
+    ImGui::SameLine();
+    ImGui::TextDisabled("peak %.1f dBFS", 20.0f * std::log10(std::max(output_peak_, 1e-5f)));
     ImGui::Separator();
     drawWaveformScope("##waveform", section_width - 16, 140);
     ImGui::EndChild();
@@ -491,6 +1558,35 @@ void AudioVisualizer::drawVisualizerWindow(bool* p_open) {
     drawSpectrumAnalyzer("##spectrum", section_width - 16, 140);
     ImGui::EndChild();
     
+    // Waterfall of recent spectra
+    ImGui::BeginChild("Spectrogram Section", ImVec2(available_width, 150), true);
+    ImGui::Text("Spectrogram");
+    ImGui::Separator();
+    FrameProfiler::beginGpuDraw(ImGui::GetWindowDrawList(), FrameProfiler::GPU_WATERFALL);
+    drawSpectrogram("##spectrogram", available_width - 16, 110);
+    FrameProfiler::endGpuDraw(ImGui::GetWindowDrawList(), FrameProfiler::GPU_WATERFALL);
+    ImGui::EndChild();
+    
+    // Real per-channel waveforms, when the emulator provides taps
+    if (hasChannelTaps()) {
+        ImGui::BeginChild("Channel Scopes Section", ImVec2(available_width, 150), true);
+        ImGui::Text("Channel Scopes");
+        ImGui::Separator();
+        drawChannelScopes(available_width - 16, 110);
+        ImGui::EndChild();
+        
+        ImGui::BeginChild("Channel Spectra Section", ImVec2(available_width, 150), true);
+        ImGui::Text("Channel Spectra");
+        ImGui::Separator();
+        drawChannelSpectra(available_width - 16, 110);
+        ImGui::EndChild();
+    }
+    
+    // Loudness readout
+    ImGui::BeginChild("Loudness Section", ImVec2(available_width, 60), true);
+    drawLoudness();
+    ImGui::EndChild();
+    
     // Middle section: Volume meters
     ImGui::BeginChild("Meters Section", ImVec2(available_width, 100), true);
     ImGui::Text("Channel Levels");
@@ -508,9 +1604,26 @@ void AudioVisualizer::drawVisualizerWindow(bool* p_open) {
     ImGui::End();
 }
 
+void AudioVisualizer::drawScrubBar(float width) {
+    float position = -scrubPosition();
+    const float range = scrubRange();
+    ImGui::SetNextItemWidth(std::max(width - 170.0f, 100.0f));
+    if (ImGui::SliderFloat("##scrub", &position, -range, 0.0f, "%.2f s")) scrubTo(-position);
+    ImGui::SameLine();
+    // Where the shown moment sat on the playback clock
+    const uint64_t end = scrubbed_ ? scrub_end_ : scrub_history_.outputEnd();
+    const int64_t clock = end > 0 ? scrub_history_.streamFrameAt(end - 1) : ScrubHistory::UNTIMED;
+    if (clock != ScrubHistory::UNTIMED && sample_rate_ > 0) {
+        const double seconds = static_cast<double>(clock) / sample_rate_;
+        ImGui::TextDisabled("clock %d:%05.2f", static_cast<int>(seconds / 60), std::fmod(seconds, 60.0));
+    } else {
+        ImGui::TextDisabled("scrub (paused)");
+    }
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Latest")) scrubTo(0.0f);
+}
+
 void AudioVisualizer::drawWaveformScope(const char* label, float width, float height) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
-    
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
     ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
     ImVec2 canvas_size(width, height);
@@ -535,40 +1648,20 @@ void AudioVisualizer::drawWaveformScope(const char* label, float width, float he
                       ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y - quarter_y),
                       IM_COL32(40, 40, 60, 255), 1.0f);
     
-    // Draw left channel (cyan)
-    if (waveform_buffer_left_.size() > 1) {
-        int sample_count = static_cast<int>(waveform_buffer_left_.size());
-        float step_x = canvas_size.x / static_cast<float>(sample_count - 1);
-        
-        for (int i = 1; i < sample_count; ++i) {
-            float x1 = canvas_pos.x + (i - 1) * step_x;
-            float x2 = canvas_pos.x + i * step_x;
-            float y1 = center_y - waveform_buffer_left_[i - 1] * canvas_size.y * 0.45f * waveform_zoom_;
-            float y2 = center_y - waveform_buffer_left_[i] * canvas_size.y * 0.45f * waveform_zoom_;
-            
-            y1 = std::clamp(y1, canvas_pos.y, canvas_pos.y + canvas_size.y);
-            y2 = std::clamp(y2, canvas_pos.y, canvas_pos.y + canvas_size.y);
-            
-            draw_list->AddLine(ImVec2(x1, y1), ImVec2(x2, y2), IM_COL32(100, 200, 255, 180), 1.0f);
-        }
-    }
-    
-    // Draw right channel (orange)
-    if (waveform_buffer_right_.size() > 1) {
-        int sample_count = static_cast<int>(waveform_buffer_right_.size());
-        float step_x = canvas_size.x / static_cast<float>(sample_count - 1);
-        
-        for (int i = 1; i < sample_count; ++i) {
-            float x1 = canvas_pos.x + (i - 1) * step_x;
-            float x2 = canvas_pos.x + i * step_x;
-            float y1 = center_y - waveform_buffer_right_[i - 1] * canvas_size.y * 0.45f * waveform_zoom_;
-            float y2 = center_y - waveform_buffer_right_[i] * canvas_size.y * 0.45f * waveform_zoom_;
-            
-            y1 = std::clamp(y1, canvas_pos.y, canvas_pos.y + canvas_size.y);
-            y2 = std::clamp(y2, canvas_pos.y, canvas_pos.y + canvas_size.y);
-            
-            draw_list->AddLine(ImVec2(x1, y1), ImVec2(x2, y2), IM_COL32(255, 180, 100, 180), 1.0f);
-        }
+    // Draw left channel (cyan), then right channel (orange)
+    const ImU32 left_color = IM_COL32(100, 200, 255, 180);
+    const ImU32 right_color = IM_COL32(255, 180, 100, 180);
+    if (phosphor_ms_ > 0.0f) {
+        drawPhosphorScope(draw_list, canvas_pos, canvas_size, left_color, right_color);
+    } else if (scope_window_ > WAVEFORM_SIZE) {
+        // Long windows scroll from the summary pyramids
+        drawHistoryChannel(draw_list, history_left_, canvas_pos, canvas_size, left_color);
+        drawHistoryChannel(draw_list, history_right_, canvas_pos, canvas_size, right_color);
+    } else {
+        // Both aligned on the mono mix
+        const uint32_t start = scopeStart(scope_mono_.data(), SCOPE_SIZE - 1, scope_write_);
+        drawScopeChannel(draw_list, scope_left_.data(), SCOPE_SIZE - 1, start, canvas_pos, canvas_size, left_color);
+        drawScopeChannel(draw_list, scope_right_.data(), SCOPE_SIZE - 1, start, canvas_pos, canvas_size, right_color);
     }
     
     // Border
@@ -579,13 +1672,156 @@ void AudioVisualizer::drawWaveformScope(const char* label, float width, float he
     ImGui::Dummy(canvas_size);
 }
 
-void AudioVisualizer::drawSpectrumAnalyzer(const char* label, float width, float height) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
+uint32_t AudioVisualizer::scopeStart(const float* ring, uint32_t mask, uint32_t write_pos) {
+    const uint32_t free_running = write_pos - WAVEFORM_SIZE;
+    if (!scope_trigger_ || write_pos < 2 * WAVEFORM_SIZE) return free_running;
+    
+    // Search the WAVEFORM_SIZE frames before the free-running start, so a
+    // full view always follows the trigger; the latest crossing wins
+    const uint32_t base = write_pos - 2 * WAVEFORM_SIZE;
+    for (int i = 0; i <= WAVEFORM_SIZE; ++i) {
+        trigger_scratch_[i] = ring[(base + i) & mask];
+    }
+    int hit = AudioKernels::findLastRisingCross(trigger_scratch_.data(), WAVEFORM_SIZE + 1, 0.0f);
+    return hit < 0 ? free_running : base + static_cast<uint32_t>(hit);
+}
+
+void AudioVisualizer::drawScopeChannel(ImDrawList* draw_list, const float* ring, uint32_t mask, uint32_t start,
+                                       ImVec2 pos, ImVec2 size, ImU32 color) {
+    // Wrapped view of WAVEFORM_SIZE frames from start
+    const float center_y = pos.y + size.y * 0.5f;
+    const float scale = size.y * 0.45f * waveform_zoom_;
+    auto to_y = [&](float sample) {
+        return std::clamp(center_y - sample * scale, pos.y, pos.y + size.y);
+    };
+    
+    scope_points_.clear();
+    const int columns = std::max(2, static_cast<int>(size.x));
+    if (WAVEFORM_SIZE <= columns) {
+        // Fewer samples than pixels: one vertex per sample
+        const float step_x = size.x / static_cast<float>(WAVEFORM_SIZE - 1);
+        for (int i = 0; i < WAVEFORM_SIZE; ++i) {
+            scope_points_.push_back(ImVec2(pos.x + i * step_x, to_y(ring[(start + i) & mask])));
+        }
+    } else {
+        // Min/max per pixel column: vertex count follows the widget width, and
+        // a column's extremes are joined so transients are not dropped
+        const float step_x = size.x / static_cast<float>(columns - 1);
+        for (int c = 0; c < columns; ++c) {
+            int first = static_cast<int>(static_cast<int64_t>(c) * WAVEFORM_SIZE / columns);
+            int last = static_cast<int>(static_cast<int64_t>(c + 1) * WAVEFORM_SIZE / columns);
+            float lo = ring[(start + first) & mask];
+            float hi = lo;
+            for (int i = first + 1; i < last; ++i) {
+                float v = ring[(start + i) & mask];
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+            }
+            float x = pos.x + c * step_x;
+            scope_points_.push_back(ImVec2(x, to_y(hi)));
+            if (hi != lo) {
+                scope_points_.push_back(ImVec2(x, to_y(lo)));
+            }
+        }
+    }
     
+    draw_list->AddPolyline(scope_points_.data(), static_cast<int>(scope_points_.size()), color, ImDrawFlags_None, 1.0f);
+}
+
+void AudioVisualizer::drawHistoryChannel(ImDrawList* draw_list, const WaveformHistory& history, ImVec2 pos,
+                                         ImVec2 size, ImU32 color) {
+    // One min/max pair per pixel column over the newest scope_window_ frames,
+    // right-aligned while the history is still filling
+    const int columns = std::max(2, static_cast<int>(size.x));
+    column_lo_.resize(columns);
+    column_hi_.resize(columns);
+    const int filled = history.summarize(scope_window_, columns, column_lo_.data(), column_hi_.data());
+    if (filled < 2) return;
+    
+    const float center_y = pos.y + size.y * 0.5f;
+    const float scale = size.y * 0.45f * waveform_zoom_;
+    auto to_y = [&](float sample) {
+        return std::clamp(center_y - sample * scale, pos.y, pos.y + size.y);
+    };
+    const uint64_t shown = std::min<uint64_t>(scope_window_, history.available());
+    const float width = size.x * static_cast<float>(shown) / static_cast<float>(scope_window_);
+    const float step_x = width / static_cast<float>(filled - 1);
+    const float left = pos.x + size.x - width;
+    
+    scope_points_.clear();
+    for (int c = 0; c < filled; ++c) {
+        float x = left + c * step_x;
+        scope_points_.push_back(ImVec2(x, to_y(column_hi_[c])));
+        if (column_hi_[c] != column_lo_[c]) {
+            scope_points_.push_back(ImVec2(x, to_y(column_lo_[c])));
+        }
+    }
+    draw_list->AddPolyline(scope_points_.data(), static_cast<int>(scope_points_.size()), color, ImDrawFlags_None, 1.0f);
+}
+
+void AudioVisualizer::drawPhosphorScope(ImDrawList* draw_list, ImVec2 pos, ImVec2 size, ImU32 left_color,
+                                        ImU32 right_color) {
+    createPhosphorTexture();
+    
+    // Fade by this frame's share of the persistence, then lay the current
+    // trace on top; earlier traces are never redrawn
+    const float dt = ImGui::GetIO().DeltaTime;
+    phosphor_.decay(std::pow(0.1f, dt * 1000.0f / phosphor_ms_));
+    
+    const int width = PhosphorScope::WIDTH;
+    column_lo_.resize(width);
+    column_hi_.resize(width);
+    if (scope_window_ > WAVEFORM_SIZE) {
+        // Right-aligned while the history fills, as in drawHistoryChannel
+        const WaveformHistory* histories[PhosphorScope::TRACES] = {&history_left_, &history_right_};
+        for (int t = 0; t < PhosphorScope::TRACES; ++t) {
+            const uint64_t shown = std::min<uint64_t>(scope_window_, histories[t]->available());
+            const int columns = std::max(2, static_cast<int>(width * shown / scope_window_));
+            const int filled = histories[t]->summarize(scope_window_, columns, column_lo_.data(), column_hi_.data());
+            phosphor_.addTrace(t, column_lo_.data(), column_hi_.data(), filled, width - filled, waveform_zoom_);
+        }
+    } else {
+        const uint32_t mask = SCOPE_SIZE - 1;
+        const uint32_t start = scopeStart(scope_mono_.data(), mask, scope_write_);
+        const float* rings[PhosphorScope::TRACES] = {scope_left_.data(), scope_right_.data()};
+        for (int t = 0; t < PhosphorScope::TRACES; ++t) {
+            for (int c = 0; c < width; ++c) {
+                const int first = c * WAVEFORM_SIZE / width;
+                const int last = std::max(first + 1, (c + 1) * WAVEFORM_SIZE / width);
+                float lo = rings[t][(start + first) & mask];
+                float hi = lo;
+                for (int i = first + 1; i < last; ++i) {
+                    const float v = rings[t][(start + i) & mask];
+                    lo = std::min(lo, v);
+                    hi = std::max(hi, v);
+                }
+                column_lo_[c] = lo;
+                column_hi_[c] = hi;
+            }
+            phosphor_.addTrace(t, column_lo_.data(), column_hi_.data(), width, 0, waveform_zoom_);
+        }
+    }
+    
+    phosphor_.render(phosphor_pixels_.data(), {left_color, right_color});
+    sg_image_data data = {};
+    data.mip_levels[0].ptr = phosphor_pixels_.data();
+    data.mip_levels[0].size = phosphor_pixels_.size() * sizeof(uint32_t);
+    sg_update_image(phosphor_texture_, &data);
+    
+    uint64_t imtex_id = simgui_imtextureid_with_sampler(phosphor_view_, phosphor_sampler_);
+    draw_list->AddImage(imtex_id, pos, ImVec2(pos.x + size.x, pos.y + size.y));
+}
+
+void AudioVisualizer::drawSpectrumAnalyzer(const char* label, float width, float height) {
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
     ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
     ImVec2 canvas_size(width, height);
     
+    // No FFT while the view is clipped
+    if (ImGui::IsRectVisible(canvas_size)) {
+        updateSpectrumIfDirty();
+    }
+    
     // Background with gradient
     draw_list->AddRectFilledMultiColor(
         canvas_pos,
@@ -596,99 +1832,226 @@ void AudioVisualizer::drawSpectrumAnalyzer(const char* label, float width, float
         IM_COL32(20, 15, 30, 255)
     );
     
-    // Draw spectrum bars
-    float bar_width = canvas_size.x / static_cast<float>(SPECTRUM_BINS);
-    float bar_gap = 1.0f;
+    if (spectrum_mode_ == SpectrumMode::Notes) {
+        // Catches up on everything written since the last draw
+        updateNoteSpectrum();
+        drawSpectrumBars(draw_list, note_data_.data(), note_peaks_.data(), note_bank_.noteCount(),
+                         canvas_pos, canvas_size);
+    } else {
+        drawSpectrumBars(draw_list, spectrum_data_.data(), spectrum_peaks_.data(), SPECTRUM_BINS,
+                         canvas_pos, canvas_size);
+    }
     
-    for (int i = 0; i < SPECTRUM_BINS; ++i) {
+    // Border
+    draw_list->AddRect(canvas_pos,
+                      ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y),
+                      IM_COL32(80, 80, 100, 255));
+    
+    ImGui::Dummy(canvas_size);
+}
+
+void AudioVisualizer::drawSpectrumBars(ImDrawList* draw_list, const float* values, const float* peaks, int count,
+                                       ImVec2 canvas_pos, ImVec2 canvas_size) {
+    float bar_width = canvas_size.x / static_cast<float>(count);
+    float bar_gap = bar_width > 3.0f ? 1.0f : 0.0f;
+    const float bottom = canvas_pos.y + canvas_size.y;
+    
+    // Bars and peak markers in one batch of at most two quads per bin
+    QuadWriter quads(draw_list, count * 2);
+    for (int i = 0; i < count; ++i) {
         float x = canvas_pos.x + i * bar_width;
-        float bar_height = spectrum_data_[i] * canvas_size.y;
-        float peak_height = spectrum_peaks_[i] * canvas_size.y;
+        float bar_height = values[i] * canvas_size.y;
+        float peak_height = peaks[i] * canvas_size.y;
         
         // Bar gradient
-        float normalized_freq = static_cast<float>(i) / SPECTRUM_BINS;
-        ImU32 bar_color_top = getSpectrumColor(spectrum_data_[i], normalized_freq);
-        ImU32 bar_color_bottom = getSpectrumColor(spectrum_data_[i] * 0.3f, normalized_freq);
-        
-        // Draw bar with gradient
-        draw_list->AddRectFilledMultiColor(
-            ImVec2(x + bar_gap, canvas_pos.y + canvas_size.y - bar_height),
-            ImVec2(x + bar_width - bar_gap, canvas_pos.y + canvas_size.y),
-            bar_color_top, bar_color_top,
-            bar_color_bottom, bar_color_bottom
-        );
+        if (bar_height > 0.0f) {
+            float normalized_freq = static_cast<float>(i) / count;
+            ImU32 bar_color_top = lookupSpectrumColor(values[i], normalized_freq);
+            ImU32 bar_color_bottom = lookupSpectrumColor(values[i] * 0.3f, normalized_freq);
+            quads.add(ImVec2(x + bar_gap, bottom - bar_height), ImVec2(x + bar_width - bar_gap, bottom),
+                      bar_color_top, bar_color_bottom);
+        }
         
-        // Draw peak indicator
+        // Peak indicator
         if (peak_height > 2) {
-            draw_list->AddRectFilled(
-                ImVec2(x + bar_gap, canvas_pos.y + canvas_size.y - peak_height),
-                ImVec2(x + bar_width - bar_gap, canvas_pos.y + canvas_size.y - peak_height + 2),
-                IM_COL32(255, 255, 255, 200)
-            );
+            quads.add(ImVec2(x + bar_gap, bottom - peak_height), ImVec2(x + bar_width - bar_gap, bottom - peak_height + 2),
+                      IM_COL32(255, 255, 255, 200));
         }
     }
+}
+
+void AudioVisualizer::drawSpectrogram(const char* label, float width, float height) {
+    ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+    ImVec2 canvas_size(width, height);
     
-    // Border
-    draw_list->AddRect(canvas_pos,
-                      ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y),
-                      IM_COL32(80, 80, 100, 255));
+    if (!ImGui::IsRectVisible(canvas_size)) {
+        ImGui::Dummy(canvas_size);
+        return;
+    }
+    updateSpectrumIfDirty();
+    
+    createSpectrogramTexture();
+    if (spectrogram_dirty_ && ++spectrogram_frames_waited_ >= spectrogram_upload_interval_) {
+        spectrogram_frames_waited_ = 0;
+        sg_image_data data = {};
+        data.mip_levels[0].ptr = spectrogram_pixels_.data();
+        data.mip_levels[0].size = spectrogram_pixels_.size() * sizeof(uint32_t);
+        sg_update_image(spectrogram_texture_, &data);
+        spectrogram_dirty_ = false;
+    }
     
-    ImGui::Dummy(canvas_size);
+    // Newest row at the top: V runs backwards from the write position
+    float v_top = static_cast<float>(spectrum_history_pos_) / HISTORY_SIZE;
+    uint64_t imtex_id = simgui_imtextureid_with_sampler(spectrogram_view_, spectrogram_sampler_);
+    ImGui::Image(imtex_id, canvas_size, ImVec2(0.0f, v_top), ImVec2(1.0f, v_top - 1.0f));
+    
+    ImGui::GetWindowDrawList()->AddRect(canvas_pos,
+                                        ImVec2(canvas_pos.x + canvas_size.x, canvas_pos.y + canvas_size.y),
+                                        IM_COL32(80, 80, 100, 255));
 }
 
-void AudioVisualizer::drawVolumeMeters(float width, float height) {
-    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+void AudioVisualizer::drawChannelScopes(float width, float height) {
     ImVec2 start_pos = ImGui::GetCursorScreenPos();
+    ImVec2 canvas_size(width, height);
+    if (!ImGui::IsRectVisible(canvas_size)) {
+        ImGui::Dummy(canvas_size);
+        return;
+    }
     
-    int channel_count = getActiveChannelCount();
-    float meter_width = (width - 20) / static_cast<float>(channel_count);
-    float meter_height = height - 20;
+    // Grid of small scopes, four per row
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    const int channel_count = getActiveChannelCount();
+    const int columns = 4;
+    const int rows = (channel_count + columns - 1) / columns;
+    const ImVec2 cell(width / columns, height / rows);
     
     for (int i = 0; i < channel_count; ++i) {
-        float x = start_pos.x + i * (meter_width + 4);
-        float y = start_pos.y;
+        ImVec2 pos(start_pos.x + (i % columns) * cell.x, start_pos.y + (i / columns) * cell.y);
+        ImVec2 size(cell.x - 4, cell.y - 4);
         
-        // Background
-        draw_list->AddRectFilled(
-            ImVec2(x, y),
-            ImVec2(x + meter_width - 4, y + meter_height),
-            IM_COL32(30, 30, 40, 255)
-        );
-        
-        // Level bar
-        float level = channel_amplitudes_[i];
-        float bar_height = level * meter_height * 5.0f; // Scale up for visibility
-        bar_height = std::min(bar_height, meter_height);
+        draw_list->AddRectFilled(pos, ImVec2(pos.x + size.x, pos.y + size.y), IM_COL32(15, 15, 25, 255));
+        draw_list->AddLine(ImVec2(pos.x, pos.y + size.y * 0.5f), ImVec2(pos.x + size.x, pos.y + size.y * 0.5f),
+                           IM_COL32(40, 40, 60, 255), 1.0f);
         
-        ImVec4 color = ChannelColors[i];
-        if (mute_mask_ & (1 << i)) {
+        ImVec4 color = ImGui::ColorConvertU32ToFloat4(channels_.color[i]);
+        if (isChannelMuted(i)) {
             color.w = 0.3f; // Dim if muted
         }
+        // Each channel triggers on its own signal
+        const float* ring = tap_scopes_.data() + static_cast<size_t>(i) * TAP_SCOPE_SIZE;
+        const uint32_t start = scopeStart(ring, TAP_SCOPE_SIZE - 1, tap_write_);
+        drawScopeChannel(draw_list, ring, TAP_SCOPE_SIZE - 1, start, pos, size, vec4ToU32(color));
         
-        // Gradient bar
-        draw_list->AddRectFilledMultiColor(
-            ImVec2(x, y + meter_height - bar_height),
-            ImVec2(x + meter_width - 4, y + meter_height),
-            vec4ToU32(color),
-            vec4ToU32(color),
-            vec4ToU32(ImVec4(color.x * 0.5f, color.y * 0.5f, color.z * 0.5f, color.w)),
-            vec4ToU32(ImVec4(color.x * 0.5f, color.y * 0.5f, color.z * 0.5f, color.w))
-        );
+        draw_list->AddText(ImVec2(pos.x + 3, pos.y + 2), channels_.color[i], channels_.name[i]);
+        draw_list->AddRect(pos, ImVec2(pos.x + size.x, pos.y + size.y), IM_COL32(80, 80, 100, 255));
+    }
+    
+    ImGui::Dummy(canvas_size);
+}
+
+void AudioVisualizer::drawChannelSpectra(float width, float height) {
+    ImVec2 start_pos = ImGui::GetCursorScreenPos();
+    ImVec2 canvas_size(width, height);
+    if (!ImGui::IsRectVisible(canvas_size)) {
+        ImGui::Dummy(canvas_size);
+        return;
+    }
+    updateChannelSpectraIfDirty();
+    
+    // Laid out as the channel scopes
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    const int channel_count = std::min(getActiveChannelCount(), TAP_CHANNELS);
+    const int columns = 4;
+    const int rows = std::max(1, (channel_count + columns - 1) / columns);
+    const ImVec2 cell(width / columns, height / rows);
+    
+    for (int i = 0; i < channel_count; ++i) {
+        ImVec2 pos(start_pos.x + (i % columns) * cell.x, start_pos.y + (i / columns) * cell.y);
+        ImVec2 size(cell.x - 4, cell.y - 4);
         
-        // Peak indicator
-        float peak_y = y + meter_height - channel_peaks_[i] * meter_height * 5.0f;
-        peak_y = std::max(peak_y, y);
-        draw_list->AddLine(
-            ImVec2(x, peak_y),
-            ImVec2(x + meter_width - 4, peak_y),
-            IM_COL32(255, 255, 255, 200),
-            2.0f
-        );
+        draw_list->AddRectFilled(pos, ImVec2(pos.x + size.x, pos.y + size.y), IM_COL32(10, 10, 20, 255));
+        const size_t offset = static_cast<size_t>(i) * CHANNEL_SPECTRUM_BINS;
+        drawSpectrumBars(draw_list, channel_spectra_.data() + offset, channel_spectrum_peaks_.data() + offset,
+                         CHANNEL_SPECTRUM_BINS, pos, size);
         
-        // Border
+        ImU32 color = channels_.color[i];
+        if (isChannelMuted(i)) {
+            ImVec4 dimmed = ImGui::ColorConvertU32ToFloat4(color);
+            dimmed.w = 0.3f;
+            color = vec4ToU32(dimmed);
+        }
+        draw_list->AddText(ImVec2(pos.x + 3, pos.y + 2), color, channels_.name[i]);
+        draw_list->AddRect(pos, ImVec2(pos.x + size.x, pos.y + size.y), IM_COL32(80, 80, 100, 255));
+    }
+    
+    ImGui::Dummy(canvas_size);
+}
+
+void AudioVisualizer::drawLoudness() {
+    ImGui::Text("Loudness");
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Reset##loudness")) {
+        loudness_.reset();
+    }
+    ImGui::Separator();
+    
+    // Silence reads as the -70 LUFS gate
+    auto lufs = [](float value) { return value > LoudnessMeter::SILENCE_LUFS ? value : -INFINITY; };
+    ImGui::Text("M %6.1f  S %6.1f  I %6.1f LUFS   True peak %6.1f dBTP (max %.1f)",
+                lufs(loudness_.momentaryLufs()), lufs(loudness_.shortTermLufs()), lufs(loudness_.integratedLufs()),
+                loudness_.truePeakDb(), loudness_.maxTruePeakDb());
+}
+
+void AudioVisualizer::drawVolumeMeters(float width, float height) {
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 start_pos = ImGui::GetCursorScreenPos();
+    
+    int channel_count = getActiveChannelCount();
+    float meter_width = (width - 20) / static_cast<float>(channel_count);
+    float meter_height = height - 20;
+    
+    // Background, bar and peak of every meter in one batch; the borders are
+    // outlines, which go through ImGui's own stroking afterwards
+    {
+        QuadWriter quads(draw_list, channel_count * 3);
+        for (int i = 0; i < channel_count; ++i) {
+            float x = start_pos.x + i * (meter_width + 4);
+            float y = start_pos.y;
+            float right = x + meter_width - 4;
+            float bottom = y + meter_height;
+            
+            // Background
+            quads.add(ImVec2(x, y), ImVec2(right, bottom), IM_COL32(30, 30, 40, 255));
+            
+            // Level bar
+            float level = channel_amplitudes_[i].load(std::memory_order_relaxed);
+            float bar_height = level * meter_height * 5.0f; // Scale up for visibility
+            bar_height = std::min(bar_height, meter_height);
+            
+            ImVec4 color = ImGui::ColorConvertU32ToFloat4(channels_.color[i]);
+            if (isChannelMuted(i)) {
+                color.w = 0.3f; // Dim if muted
+            }
+            
+            // Gradient bar
+            if (bar_height > 0.0f) {
+                quads.add(ImVec2(x, bottom - bar_height), ImVec2(right, bottom), vec4ToU32(color),
+                          vec4ToU32(ImVec4(color.x * 0.5f, color.y * 0.5f, color.z * 0.5f, color.w)));
+            }
+            
+            // Peak indicator, a 2px line
+            float peak_y = y + meter_height - channel_peaks_[i] * meter_height * 5.0f;
+            peak_y = std::max(peak_y, y);
+            quads.add(ImVec2(x, peak_y - 1.0f), ImVec2(right, peak_y + 1.0f), IM_COL32(255, 255, 255, 200));
+        }
+    }
+    
+    // Borders
+    for (int i = 0; i < channel_count; ++i) {
+        float x = start_pos.x + i * (meter_width + 4);
         draw_list->AddRect(
-            ImVec2(x, y),
-            ImVec2(x + meter_width - 4, y + meter_height),
+            ImVec2(x, start_pos.y),
+            ImVec2(x + meter_width - 4, start_pos.y + meter_height),
             IM_COL32(80, 80, 100, 255)
         );
     }
@@ -699,9 +2062,9 @@ void AudioVisualizer::drawVolumeMeters(float width, float height) {
         if (i > 0) ImGui::SameLine();
         float label_width = meter_width - 4;
         ImGui::PushItemWidth(label_width);
-        // Use shorter names for VRC6 channels to fit
-        const char* short_names[] = {"Sq1", "Sq2", "Tri", "Noi", "DMC", "V-P1", "V-P2", "V-Saw"};
-        ImGui::TextColored(ChannelColors[i], "%s", channel_count > 5 ? short_names[i] : ChannelNames[i]);
+        // Use shorter names once expansion channels share the row
+        const char* label = channel_count > ChannelTable::APU_CHANNELS ? channels_.short_name[i] : channels_.name[i];
+        ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(channels_.color[i]), "%s", label);
         ImGui::PopItemWidth();
     }
 }
@@ -712,20 +2075,19 @@ void AudioVisualizer::drawChannelInfo() {
     ImGui::Columns(channel_count, "channel_controls", false);
     
     for (int i = 0; i < channel_count; ++i) {
-        NesChannel channel = static_cast<NesChannel>(i);
-        bool muted = isChannelMuted(channel);
+        bool muted = isChannelMuted(i);
         
-        ImGui::PushStyleColor(ImGuiCol_CheckMark, ChannelColors[i]);
+        ImGui::PushStyleColor(ImGuiCol_CheckMark, channels_.color[i]);
         
         char label[32];
-        snprintf(label, sizeof(label), "%s##mute%d", ChannelNames[i], i);
+        snprintf(label, sizeof(label), "%s##mute%d", channels_.name[i], i);
         
         if (ImGui::Checkbox(label, &muted)) {
-            setChannelMute(channel, muted);
+            setChannelMute(i, muted);
         }
         
         // Show amplitude bar
-        float amp = channel_amplitudes_[i];
+        float amp = channel_amplitudes_[i].load(std::memory_order_relaxed);
         ImGui::ProgressBar(amp * 5.0f, ImVec2(-1, 8), "");
         
         ImGui::PopStyleColor();
@@ -739,27 +2101,76 @@ void AudioVisualizer::drawChannelInfo() {
     // Settings
     ImGui::Text("Settings");
     ImGui::SliderFloat("Waveform Zoom", &waveform_zoom_, 0.5f, 4.0f);
+    
+    const float min_window_ms = WAVEFORM_SIZE * 1000.0f / sample_rate_;
+    float window_ms = scope_window_ * 1000.0f / sample_rate_;
+    if (ImGui::SliderFloat("Scope Window", &window_ms, min_window_ms, MAX_SCOPE_WINDOW_MS, "%.0f ms",
+                           ImGuiSliderFlags_Logarithmic)) {
+        window_ms = std::clamp(window_ms, min_window_ms, MAX_SCOPE_WINDOW_MS);
+        setScopeWindow(static_cast<uint32_t>(window_ms * sample_rate_ / 1000.0f));
+    }
+    ImGui::Checkbox("Trigger Scopes", &scope_trigger_);
+    float persistence = phosphor_ms_;
+    if (ImGui::SliderFloat("Phosphor Persistence", &persistence, 0.0f, 2000.0f, persistence > 0.0f ? "%.0f ms" : "Off")) {
+        setPhosphorPersistence(persistence);
+    }
     ImGui::SliderFloat("Spectrum Smoothing", &spectrum_smoothing_, 0.0f, 0.95f);
+    ImGui::Checkbox("Precise Spectrum dB", &precise_spectrum_);
+    bool fixed_point = fixed_point_;
+    if (ImGui::Checkbox("Integer (Q15) Spectrum", &fixed_point)) setFixedPointAnalysis(fixed_point);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Fixed-point FFT, magnitudes and levels, for CPUs with a weak FPU (%s kernels)",
+                          AudioKernels::simdName());
+    }
+    
+    float hue_span = gradient_hue_span_;
+    float min_brightness = gradient_min_brightness_;
+    bool gradient_changed = ImGui::SliderFloat("Gradient Hue Span", &hue_span, 0.1f, 1.0f);
+    gradient_changed |= ImGui::SliderFloat("Gradient Floor", &min_brightness, 0.0f, 0.8f);
+    if (gradient_changed) {
+        setSpectrumGradient(hue_span, min_brightness);
+    }
+    
+    int mode = static_cast<int>(spectrum_mode_);
+    ImGui::Text("Spectrum Mode:");
+    ImGui::SameLine();
+    ImGui::RadioButton("FFT", &mode, static_cast<int>(SpectrumMode::FFT));
+    ImGui::SameLine();
+    ImGui::RadioButton("Notes (A0-C8)", &mode, static_cast<int>(SpectrumMode::Notes));
+    spectrum_mode_ = static_cast<SpectrumMode>(mode);
+    
+    char fft_label[32];
+    if (fft_size_ != requested_fft_size_) {
+        snprintf(fft_label, sizeof(fft_label), "%d (%d now)", requested_fft_size_, fft_size_);  // Governed
+    } else {
+        snprintf(fft_label, sizeof(fft_label), "%d", fft_size_);
+    }
+    if (ImGui::BeginCombo("FFT Size", fft_label)) {
+        for (int size = MIN_FFT_SIZE; size <= MAX_FFT_SIZE; size <<= 1) {
+            snprintf(fft_label, sizeof(fft_label), "%d", size);
+            if (ImGui::Selectable(fft_label, size == requested_fft_size_)) {
+                setFftSize(size);
+            }
+        }
+        ImGui::EndCombo();
+    }
     
     // Quick mute buttons
     ImGui::Separator();
     if (ImGui::Button("Mute All")) {
-        mute_mask_ = 0x1F; // All 5 channels
-        if (emu_) gme_mute_voices(emu_, mute_mask_);
+        mute_mask_.store(static_cast<int>(channels_.voiceMask())); // Every channel in the layout
     }
     ImGui::SameLine();
     if (ImGui::Button("Unmute All")) {
-        mute_mask_ = 0;
-        if (emu_) gme_mute_voices(emu_, mute_mask_);
+        mute_mask_.store(0);
     }
     ImGui::SameLine();
     if (ImGui::Button("Solo Square")) {
-        mute_mask_ = 0x1C; // Mute Triangle, Noise, DMC
-        if (emu_) gme_mute_voices(emu_, mute_mask_);
+        mute_mask_.store(0x1C); // Mute Triangle, Noise, DMC
     }
     ImGui::SameLine();
     if (ImGui::Button("Solo Triangle")) {
-        mute_mask_ = 0x1B; // Mute others
-        if (emu_) gme_mute_voices(emu_, mute_mask_);
+        mute_mask_.store(0x1B); // Mute others
     }
 }
+#endif
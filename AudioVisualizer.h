@@ -1,62 +1,156 @@
 #pragma once
 
+// NES_HEADLESS builds (imgui_fc_visualizer_bench) keep the analysis only:
+// there is no sokol_gfx, and nothing is drawn
 #include "gme/gme.h"
 #include "gme/Music_Emu.h"
 #include "imgui.h"
+#ifndef NES_HEADLESS
+#include "sokol_gfx.h"
+#endif
+#include "SpscRing.h"
+#include "LoudnessMeter.h"
+#include "ChannelRegistry.h"
+#include "WaveformHistory.h"
+#include "PhosphorScope.h"
+#include "ScrubHistory.h"
+#include "MemoryReport.h"
 #include <vector>
 #include <array>
-#include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cmath>
 #include <complex>
 
-// NES APU channel types (base + expansion chips)
-enum class NesChannel {
-    // Base APU (5 channels)
-    Square1 = 0,
-    Square2 = 1,
-    Triangle = 2,
-    Noise = 3,
-    DMC = 4,
-    // VRC6 expansion (3 channels)
-    VRC6_Pulse1 = 5,
-    VRC6_Pulse2 = 6,
-    VRC6_Saw = 7,
-    // Counts
-    BaseCount = 5,
-    VRC6Count = 3,
-    MaxCount = 8
+// Per-size FFT tables: twiddles, bit-reversal permutation and Hann window.
+// Built once by resize() and reused, along with a scratch buffer, for every
+// transform of that size.
+class FftPlan {
+public:
+    explicit FftPlan(size_t size = 0) { resize(size); }
+
+    // Rebuild the tables for a power-of-two size (no-op if unchanged)
+    void resize(size_t size);
+    size_t size() const { return size_; }
+
+    const std::complex<float>* twiddles() const { return twiddles_.data(); }  // e^(-2*pi*i*k/N), k < N/2
+    const uint32_t* bitReverse() const { return bit_reverse_.data(); }
+    const uint32_t* halfBitReverse() const { return half_bit_reverse_.data(); }  // For the N/2 packed real FFT
+    const float* window() const { return window_.data(); }
+    std::complex<float>* scratch() { return scratch_.data(); }
+
+    // Bytes held by the tables and scratch
+    size_t memoryBytes() const;
+
+private:
+    size_t size_ = 0;
+    std::vector<std::complex<float>> twiddles_;
+    std::vector<uint32_t> bit_reverse_;
+    std::vector<uint32_t> half_bit_reverse_;
+    std::vector<float> window_;
+    std::vector<std::complex<float>> scratch_;
 };
 
-// Channel names
-inline const char* const ChannelNames[] = {
-    "Square 1",
-    "Square 2",
-    "Triangle",
-    "Noise",
-    "DMC",
-    "VRC6 Pulse1",
-    "VRC6 Pulse2",
-    "VRC6 Saw"
+// FftPlan's tables in fixed point, for SimpleFFT::rfftQ15(): Q31 twiddles
+// (interleaved int32 pairs), a Q31 Hann window and the N/2 bit reversal,
+// with an int32 scratch of N + 2 for the packed input and the bins.
+// Windowed samples go in at 2^scaleBits(), 31 - log2(N): as large as lets
+// the N/2 additions of the unscaled butterflies stay within int32, so the
+// smaller sizes keep more bits below the display's floor.
+class FftPlanQ15 {
+public:
+    explicit FftPlanQ15(size_t size = 0) { resize(size); }
+
+    void resize(size_t size);
+    size_t size() const { return size_; }
+    int scaleBits() const { return scale_bits_; }
+    int inputShift() const { return 31 - scale_bits_; }  // For AudioKernels::windowQ15()
+
+    const int32_t* twiddles() const { return twiddles_.data(); }
+    const uint32_t* halfBitReverse() const { return half_bit_reverse_.data(); }
+    const int32_t* window() const { return window_.data(); }
+    int32_t* scratch() { return scratch_.data(); }
+
+    size_t memoryBytes() const;
+
+private:
+    size_t size_ = 0;
+    int scale_bits_ = 17;
+    std::vector<int32_t> twiddles_;
+    std::vector<uint32_t> half_bit_reverse_;
+    std::vector<int32_t> window_;
+    std::vector<int32_t> scratch_;
 };
 
-// Channel colors (RGBA)
-inline const ImVec4 ChannelColors[] = {
-    ImVec4(1.0f, 0.3f, 0.3f, 1.0f),  // Square 1 - Red
-    ImVec4(1.0f, 0.6f, 0.2f, 1.0f),  // Square 2 - Orange
-    ImVec4(0.3f, 0.7f, 1.0f, 1.0f),  // Triangle - Blue
-    ImVec4(0.9f, 0.3f, 0.9f, 1.0f),  // Noise - Magenta
-    ImVec4(0.9f, 0.9f, 0.3f, 1.0f),  // DMC - Yellow
-    ImVec4(0.2f, 0.9f, 0.5f, 1.0f),  // VRC6 Pulse1 - Green
-    ImVec4(0.4f, 0.9f, 0.7f, 1.0f),  // VRC6 Pulse2 - Light Green
-    ImVec4(0.6f, 0.4f, 0.9f, 1.0f)   // VRC6 Saw - Purple
+// Display bin -> FFT bin ranges (quadratic frequency scale for more bass
+// detail). Rebuilt only when the FFT size or bin count changes.
+class SpectrumBinMap {
+public:
+    void build(size_t fft_size, int num_bins);
+    int binCount() const { return static_cast<int>(start_.size()); }
+    uint32_t start(int bin) const { return start_[bin]; }
+    uint32_t end(int bin) const { return end_[bin]; }
+
+private:
+    size_t fft_size_ = 0;
+    std::vector<uint32_t> start_;
+    std::vector<uint32_t> end_;
+};
+
+// Constant-Q Goertzel filters at equal-tempered note frequencies. Each
+// filter integrates about Q periods of its note (one semitone of
+// resolution) and publishes a level whenever its block completes, so the
+// low notes resolve far better than with a same-cost FFT.
+class NoteFilterBank {
+public:
+    void configure(long sample_rate, int midi_min, int midi_max);
+    void reset();
+    
+    // Feed mono samples; cost is a multiply-add pair per sample and note
+    void process(const float* samples, int count);
+    
+    int noteCount() const { return static_cast<int>(filters_.size()); }
+    int midiMin() const { return midi_min_; }
+    float level(int note) const { return filters_[note].level; }  // 0-1 over -60..0 dBFS
+    
+private:
+    struct Filter {
+        float coeff = 0.0f;   // 2*cos(omega)
+        int length = 1;       // Block length in samples
+        int count = 0;
+        float s1 = 0.0f;
+        float s2 = 0.0f;
+        float level = 0.0f;
+    };
+    std::vector<Filter> filters_;
+    int midi_min_ = 0;
 };
 
 // Simple FFT implementation for spectrum analysis
 class SimpleFFT {
 public:
     static void fft(std::vector<std::complex<float>>& data);
+    // In-place transform of plan.size() values using the plan's tables
+    static void fft(std::complex<float>* data, const FftPlan& plan);
+    // Real-input transform of plan.size() samples, optionally windowed, done as
+    // an N/2 complex FFT plus a post-twiddle. Writes bins 0..N/2 (N/2 + 1 values).
+    static void rfft(const float* input, const float* window, std::complex<float>* output, const FftPlan& plan);
+    // rfft() of lanes signals in lockstep, for one vector op per butterfly
+    // across them. Sample k of lane c is input[k * lanes + c]; bin k of lane c
+    // goes to re/im[k * lanes + c], plan.size() / 2 + 1 rows. Lanes best a
+    // multiple of 4.
+    static void rfftLanes(const float* input, const float* window, float* re, float* im, int lanes,
+                          const FftPlan& plan);
+    // rfft() in integers. data holds plan.size() samples already windowed by
+    // AudioKernels::windowQ15() with plan.inputShift() (even/odd packed as
+    // re/im) and has room for plan.size() + 2; the bins 0..N/2 replace them,
+    // interleaved, as the float rfft()'s times 2^plan.scaleBits().
+    static void rfftQ15(int32_t* data, const FftPlanQ15& plan);
     static void computeMagnitude(const std::vector<std::complex<float>>& fftData, 
                                   std::vector<float>& magnitudes, int numBins);
+    static void computeMagnitude(const std::complex<float>* fftData, size_t fftSize,
+                                  std::vector<float>& magnitudes, int numBins);
 };
 
 // Audio visualizer class
@@ -67,93 +161,382 @@ public:
 
     // Initialize visualizer
     bool init(Music_Emu* emu, long sample_rate);
-    
+
+    // Retarget mute controls without clearing buffers (gapless track switch)
+    void setEmulator(Music_Emu* emu) { emu_ = emu; }
+
     // Reset when loading new file
     void reset();
 
-    // Update audio data (called in audio callback)
-    void updateAudioData(const short* samples, int sample_count);
+    // Blocks without a stream position are shown as soon as they are drained
+    static constexpr int64_t UNTIMED = -1;
     
-    // Update channel amplitudes from APU (for accurate per-channel levels)
-    void updateChannelAmplitudesFromAPU(const int* amplitudes);
-    void updateChannelAmplitudesFromAPU(const int* amplitudes, const int* lengths);
+    // Update audio data (called in audio callback, lock-free). stream_frame is
+    // the position of the block's first frame on the playback clock.
+    void updateAudioData(const short* samples, int sample_count, int64_t stream_frame = UNTIMED);
     
-    // VRC6 expansion support
-    void setVRC6Enabled(bool enabled) { has_vrc6_ = enabled; }
-    bool hasVRC6() const { return has_vrc6_; }
-    void updateVRC6ChannelAmplitudes(const int* amplitudes);  // 3 VRC6 channels
-    int getActiveChannelCount() const { return has_vrc6_ ? static_cast<int>(NesChannel::MaxCount) : static_cast<int>(NesChannel::BaseCount); }
+    // Mono source (NES emulator): queued and analysed as one channel
+    void updateAudioDataMono(const short* samples, int frame_count, int64_t stream_frame = UNTIMED);
+    
+    // Stream frame reaching the listener now, published by the audio thread
+    // once per device buffer of period_frames. Timed blocks are held back
+    // until the clock, extrapolated up to one period, reaches them.
+    void setPlaybackClock(int64_t stream_frame, int period_frames);
+    // That clock now, or UNTIMED if stopped (any thread)
+    int64_t playbackClock() const;
+    
+    // Drain samples queued by the audio thread (called on the render thread).
+    // The FFT runs when the spectrum is drawn, once per completed hop.
+    void processPendingAudio();
+    
+    // Samples dropped because the render thread fell behind
+    uint32_t getDroppedSampleCount() const { return dropped_samples_.load(std::memory_order_relaxed); }
+    
+    // Channels of the loaded source (UI thread): names, colours and the gme
+    // voice behind each meter, scope and mute toggle
+    void setChannelLayout(const ChannelTable& layout) { channels_ = layout; }
+    const ChannelTable& getChannelLayout() const { return channels_; }
+    int getActiveChannelCount() const { return channels_.count; }
+    // Smoothed meter level of a channel, 0..1 (any thread)
+    float getChannelLevel(int channel) const { return channel_amplitudes_[channel].load(std::memory_order_relaxed); }
+    
+    // Per-channel level estimates from a sampled table (producer thread).
+    // stream_frame is where on the playback clock the table was sampled:
+    // timed levels are shown as the clock passes them, interpolated between
+    // samples, rather than as soon as they are rendered.
+    void updateChannelLevels(const ChannelTable& table, int64_t stream_frame = UNTIMED);
+    
+    // Real per-channel samples (producer thread, lock-free): tap_count samples
+    // per frame, tap_channels maps each tap to a table entry or -1 (nullptr:
+    // tap i is entry i). While taps arrive they drive the levels instead of the
+    // APU estimates; a call without frames falls back to the estimates.
+    // Timed as updateChannelLevels(), stream_frame being the first frame's.
+    void updateChannelTaps(const short* taps, int frames, int tap_count, const int* tap_channels,
+                           int64_t stream_frame = UNTIMED);
+    bool hasChannelTaps() const { return taps_active_.load(std::memory_order_relaxed); }
 
+    // Scrubbing while paused (UI thread). The last SCRUB_SECONDS of drained
+    // output and taps are kept; while allowed, scrubTo() rebuilds the scopes,
+    // spectra and levels as they were seconds_back before the newest sample.
+    // Disallowing it, as playback resumes, goes back to the newest.
+    static constexpr int SCRUB_SECONDS = 30;
+    void setScrubAllowed(bool allowed);
+    bool isScrubAllowed() const { return scrub_allowed_; }
+    void scrubTo(float seconds_back);
+    float scrubPosition() const;  // Seconds back shown, 0 when live
+    float scrubRange() const;     // Seconds held
+    
+#ifndef NES_HEADLESS
     // Draw the complete visualizer window
     void drawVisualizerWindow(bool* p_open = nullptr);
 
     // Individual drawing functions
     void drawWaveformScope(const char* label, float width, float height);
     void drawSpectrumAnalyzer(const char* label, float width, float height);
+    void drawSpectrogram(const char* label, float width, float height);
     void drawVolumeMeters(float width, float height);
+    void drawChannelScopes(float width, float height);
+    void drawChannelSpectra(float width, float height);
+    void drawLoudness();
     void drawChannelInfo();
+    void drawScrubBar(float width);
+#endif
     
-    // Channel muting control
-    void setChannelMute(NesChannel channel, bool mute);
-    bool isChannelMuted(NesChannel channel) const;
-    int getMuteMask() const { return mute_mask_; }
+    // Loudness of the drained output (render thread)
+    const LoudnessMeter& getLoudness() const { return loudness_; }
+    void resetLoudness() { loudness_.reset(); }
+    
+    // Channel muting control, by table entry
+    void setChannelMute(int channel, bool mute);
+    bool isChannelMuted(int channel) const;
+    int getMuteMask() const { return mute_mask_.load(std::memory_order_relaxed); }
+    // Where mutes take effect: in the emulator through gme_mute_voices(), or
+    // when false downstream of it (a MixBus), leaving every voice rendering.
+    // emulatorMuteMask() is the mask to give gme_mute_voices() either way;
+    // the render thread does so between blocks, the UI thread never does.
+    void setMutesInEmulator(bool in_emulator);
+    int emulatorMuteMask() const { return mutes_in_emulator_ ? getMuteMask() : 0; }
+    
+#ifndef NES_HEADLESS
+    // Release GPU resources (call before sg_shutdown)
+    void destroyTextures();
+#endif
     
     // Settings
     void setWaveformZoom(float zoom) { waveform_zoom_ = zoom; }
     float getWaveformZoom() const { return waveform_zoom_; }
     
+    // Frames across the waveform scope; past WAVEFORM_SIZE the untriggered
+    // min/max history is drawn, up to MAX_SCOPE_WINDOW_MS
+    void setScopeWindow(uint32_t frames) { scope_window_ = std::max<uint32_t>(frames, WAVEFORM_SIZE); }
+    uint32_t getScopeWindow() const { return scope_window_; }
+    
+    // Start scopes at the latest rising zero crossing instead of free-running
+    void setScopeTrigger(bool trigger) { scope_trigger_ = trigger; }
+    bool getScopeTrigger() const { return scope_trigger_; }
+    
+    // Afterglow of the waveform scope: time for a trace to fade to 10%, 0 for none
+    void setPhosphorPersistence(float ms);
+    float getPhosphorPersistence() const { return phosphor_ms_; }
+    
     void setSpectrumSmoothing(float smooth) { spectrum_smoothing_ = smooth; }
     float getSpectrumSmoothing() const { return spectrum_smoothing_; }
+    
+    // Spectrum analyzer source: FFT bins, or note-aligned Goertzel filters
+    enum class SpectrumMode { FFT, Notes };
+    void setSpectrumMode(SpectrumMode mode) { spectrum_mode_ = mode; }
+    SpectrumMode getSpectrumMode() const { return spectrum_mode_; }
+    
+    // Analysis size, clamped to a power of 2 in [512, 16384]; the hop is a quarter of it
+    void setFftSize(int size);
+    int getFftSize() const { return requested_fft_size_; }
+    
+    // Quality governor (UI thread): the largest FFT run whatever size was
+    // asked for, and how many frames the waterfall texture goes between
+    // uploads (rows still arrive at the hop rate)
+    void setFftSizeLimit(int limit);
+    void setSpectrogramUploadInterval(int frames) { spectrogram_upload_interval_ = std::max(frames, 1); }
+    
+    // Spectrum gradient: hue travelled from loud (red) towards quiet, and the
+    // brightness of silent cells. Changing either rebuilds the colour LUT.
+    void setSpectrumGradient(float hue_span, float min_brightness);
+    float getSpectrumHueSpan() const { return gradient_hue_span_; }
+    float getSpectrumMinBrightness() const { return gradient_min_brightness_; }
+    
+    // Exact log10 for the dB scale instead of the fast approximation
+    void setPreciseSpectrum(bool precise) { precise_spectrum_ = precise; }
+    bool getPreciseSpectrum() const { return precise_spectrum_; }
+    
+    // Integer spectrum analysis: the FFT, bin magnitudes and block RMS from
+    // a Q15 mono ring with AudioKernels' Q15 kernels, for ARM boards with a
+    // weak FPU. Starts as AudioKernels::q15Preferred() says; the per-channel
+    // spectra stay float.
+    void setFixedPointAnalysis(bool fixed_point);
+    bool getFixedPointAnalysis() const { return fixed_point_; }
+    
+    // Rings, scope and spectrum buffers, and the textures once created
+    void reportMemory(MemoryReport::Sample& sample) const;
 
 private:
     // Buffer sizes
     static constexpr int WAVEFORM_SIZE = 1024;    // Samples for waveform display
-    static constexpr int FFT_SIZE = 2048;         // FFT size (must be power of 2)
+    static constexpr float MAX_SCOPE_WINDOW_MS = 10000.0f; // Longest scope window (within WaveformHistory)
+    static constexpr int MIN_FFT_SIZE = 512;      // Selectable FFT sizes (powers of 2)
+    static constexpr int MAX_FFT_SIZE = 16384;
+    static constexpr int DEFAULT_FFT_SIZE = 2048;
+    static constexpr int REFERENCE_FFT_SIZE = 2048; // Size the dB range below was tuned for
+    static constexpr int FFT_HOP_DIVISOR = 4;     // Hop = size / 4 (75% overlap)
+    static constexpr int MAX_HOPS_PER_FRAME = 4;  // Older hops are skipped when the UI falls behind
     static constexpr int SPECTRUM_BINS = 64;      // Number of frequency bins to display
-    static constexpr int HISTORY_SIZE = 128;      // History for waterfall display
+    static constexpr int HISTORY_SIZE = 256;      // Rows in the waterfall ring / texture
+    static constexpr int RING_SIZE = 65536;       // Stereo samples queued, covers the longest render-ahead
+    static constexpr int TAG_RING_SIZE = 1024;    // Blocks queued
+    static constexpr int CLOCK_TIMEOUT_MS = 250;  // A clock this old is ignored (audio stopped or NES mode)
+    static constexpr int SCOPE_SIZE = MAX_FFT_SIZE * 2; // Circular history, covers waveform and pending FFT windows
+    static_assert((SCOPE_SIZE & (SCOPE_SIZE - 1)) == 0, "SCOPE_SIZE must be a power of 2");
+    static_assert(SCOPE_SIZE >= WAVEFORM_SIZE, "SCOPE_SIZE too small");
+    static_assert(SCOPE_SIZE >= MAX_FFT_SIZE + MAX_HOPS_PER_FRAME * (MAX_FFT_SIZE / FFT_HOP_DIVISOR),
+                  "SCOPE_SIZE must hold every window analysed in one frame");
+    static constexpr int TAP_CHANNELS = ChannelTable::MAX_CHANNELS;
+    static constexpr int TAP_RING_FRAMES = 8192;  // Per-channel frames queued between threads
+    static constexpr int TAP_SCOPE_SIZE = WAVEFORM_SIZE * 2; // Circular history per channel
+    static constexpr int LEVEL_RING_SIZE = 512;   // Timed level points queued, a tap chunk or table each
+    static_assert((TAP_SCOPE_SIZE & (TAP_SCOPE_SIZE - 1)) == 0, "TAP_SCOPE_SIZE must be a power of 2");
+    static constexpr int CHANNEL_FFT_SIZE = 1024; // Per-channel spectra, from the tap scopes
+    static constexpr int CHANNEL_SPECTRUM_BINS = 32;
+    static_assert(TAP_SCOPE_SIZE >= CHANNEL_FFT_SIZE + MAX_HOPS_PER_FRAME * (CHANNEL_FFT_SIZE / FFT_HOP_DIVISOR),
+                  "TAP_SCOPE_SIZE must hold every channel window analysed in one frame");
+    
+    // Raw int16 blocks from the audio callback, drained on the render thread.
+    // Mono sources queue on their own ring so they are never widened to stereo.
+    SpscRing<short> sample_ring_;
+    SpscRing<short> mono_ring_;
+    std::vector<short> drain_buffer_;
+    std::atomic<uint32_t> dropped_samples_{0};
+    
+    // One tag per queued block, in queue order across both rings. ring_pos
+    // lets the reader resync if a reset discarded the rings between the two
+    // pushes of a block.
+    struct BlockTag {
+        int64_t stream_frame;  // UNTIMED or the first frame's clock position
+        size_t ring_pos;       // writePosition() of its ring before the block
+        uint32_t frames;
+        bool mono;
+    };
+    SpscRing<BlockTag> tag_ring_;
+    BlockTag front_tag_{};                        // Partly consumed block (UI thread)
+    bool has_front_tag_ = false;
     
-    // Audio buffers
-    std::vector<float> waveform_buffer_;          // Current waveform
-    std::vector<float> waveform_buffer_left_;     // Left channel
-    std::vector<float> waveform_buffer_right_;    // Right channel
-    std::vector<float> fft_input_;                // FFT input buffer
+    std::atomic<int64_t> clock_frame_{UNTIMED};
+    std::atomic<int64_t> clock_time_ns_{0};       // steady_clock time of clock_frame_
+    std::atomic<int> clock_period_{0};
+    
+    // Per-channel frames (TAP_CHANNELS shorts each) from updateChannelTaps
+    SpscRing<short> tap_ring_;
+    std::vector<short> tap_drain_;
+    std::vector<float> tap_scopes_;               // TAP_CHANNELS rings of TAP_SCOPE_SIZE
+    uint32_t tap_write_ = 0;                      // Frames written to each ring
+    uint32_t channel_analysis_pos_ = 0;           // tap_write_ at the end of the last channel window
+    std::atomic<bool> taps_active_{false};
+    
+    // Audio buffers: circular, indexed by scope_write_ & (SCOPE_SIZE - 1)
+    std::vector<float> scope_left_;               // Left channel
+    std::vector<float> scope_right_;              // Right channel
+    std::vector<float> scope_mono_;               // Mono mix for the FFT
+    std::vector<short> scope_mono_q15_;           // The same in Q15, while fixed_point_
+    uint32_t scope_write_ = 0;                    // Frames written so far
+    float output_peak_ = 0.0f;                    // Decaying sample peak of the output
+    LoudnessMeter loudness_;                      // Fed from the same pass as the scope rings
+    WaveformHistory history_left_;                // Seconds of min/max summaries for long scope windows
+    WaveformHistory history_right_;
+    std::vector<float> column_lo_;                // Per-pixel extremes from the history, reused per draw
+    std::vector<float> column_hi_;
+    std::vector<float> fft_input_;                // Linearized FFT window, filled by processFFT
+    std::vector<ImVec2> scope_points_;            // Decimated waveform vertices, reused per draw
+    std::vector<float> trigger_scratch_;          // Linearized trigger search window
+    int fft_size_ = DEFAULT_FFT_SIZE;             // Current analysis size
+    int requested_fft_size_ = DEFAULT_FFT_SIZE;   // As set; fft_size_ is at most fft_size_limit_
+    int fft_size_limit_ = MAX_FFT_SIZE;
+    uint32_t analysis_pos_ = 0;                   // scope_write_ at the end of the last analysed window
+    SpectrumMode spectrum_mode_ = SpectrumMode::FFT;
+    NoteFilterBank note_bank_;                    // PianoVisualizer's MIDI range
+    uint32_t note_pos_ = 0;                       // scope_write_ fed to note_bank_ so far
+    std::vector<float> note_data_;                // Smoothed note levels
+    std::vector<float> note_peaks_;
+    FftPlan fft_plan_;                            // Tables and scratch for fft_size_ (real input)
+    SpectrumBinMap bin_map_;                      // Display bins over FFT bins
+    std::vector<float> fft_power_;                // Squared magnitude per FFT bin
+    bool fixed_point_ = false;
+    FftPlanQ15 fft_plan_q15_;                     // Sized with fft_plan_ while fixed_point_
+    std::vector<int32_t> fft_magnitude_q15_;      // Approximate magnitude per FFT bin, at the plan's scale
     std::vector<float> spectrum_data_;            // Current spectrum
     std::vector<float> spectrum_peaks_;           // Peak hold for spectrum
-    std::vector<std::vector<float>> spectrum_history_; // History for waterfall
+    std::vector<float> spectrum_history_;         // Waterfall ring, HISTORY_SIZE rows of SPECTRUM_BINS
+    
+    // Per-channel spectra: every channel's window in one batched transform,
+    // lanes interleaved (CHANNEL_FFT_SIZE rows of up to TAP_CHANNELS)
+    FftPlan channel_plan_;
+    SpectrumBinMap channel_bin_map_;
+    std::vector<float> channel_fft_input_;
+    std::vector<float> channel_fft_re_;
+    std::vector<float> channel_fft_im_;
+    std::vector<float> channel_spectra_;          // TAP_CHANNELS rows of CHANNEL_SPECTRUM_BINS
+    std::vector<float> channel_spectrum_peaks_;
     
-    // Per-channel amplitude (estimated from mixed output)
-    std::array<float, static_cast<size_t>(NesChannel::MaxCount)> channel_amplitudes_;
-    std::array<float, static_cast<size_t>(NesChannel::MaxCount)> channel_peaks_;
+    // Per-channel amplitude (written by the audio thread, or by the render
+    // thread from timed points; read by the render thread)
+    std::array<std::atomic<float>, ChannelTable::MAX_CHANNELS> channel_amplitudes_;
     
-    // Expansion chip flags
-    bool has_vrc6_;
+    // Timed levels: the producer runs the meter ballistics on its own copy
+    // and queues the result at each point's clock position; the render
+    // thread holds the points either side of the clock and blends them
+    struct LevelPoint {
+        int64_t stream_frame;
+        std::array<float, ChannelTable::MAX_CHANNELS> levels;
+    };
+    SpscRing<LevelPoint> level_ring_;
+    std::array<float, ChannelTable::MAX_CHANNELS> timed_levels_{};  // Producer thread
+    LevelPoint level_from_{};                     // Last point passed (render thread)
+    LevelPoint level_to_{};                       // Next point due
+    bool has_level_from_ = false;
+    bool has_level_to_ = false;
+    // Peak hold (render thread only)
+    std::array<float, ChannelTable::MAX_CHANNELS> channel_peaks_;
     
-    // Thread safety
-    std::mutex audio_mutex_;
+    // Channel layout (UI thread only)
+    ChannelTable channels_;
     
     // State
     Music_Emu* emu_;
     long sample_rate_;
-    int mute_mask_;
+    std::atomic<int> mute_mask_;
+    bool mutes_in_emulator_ = true;
     bool is_initialized_;
     
     // Visual settings
     float waveform_zoom_;
+    uint32_t scope_window_ = WAVEFORM_SIZE;
+    bool scope_trigger_ = true;
     float spectrum_smoothing_;
+    bool precise_spectrum_ = false;
+    float gradient_hue_span_ = 0.7f;
+    float gradient_min_brightness_ = 0.3f;
+    std::vector<ImU32> color_lut_;               // COLOR_LUT_FREQS rows of COLOR_LUT_VALUES
     int spectrum_history_pos_;
     
+    // Waterfall texture: RGBA copy of the history ring, uploaded at most once per frame
+    std::vector<uint32_t> spectrogram_pixels_;
+    bool spectrogram_dirty_ = false;
+    int spectrogram_upload_interval_ = 1;
+    int spectrogram_frames_waited_ = 0;
+    bool texture_created_ = false;
+#ifndef NES_HEADLESS
+    sg_image spectrogram_texture_ = {};
+    sg_view spectrogram_view_ = {};
+    sg_sampler spectrogram_sampler_ = {};
+#endif
+    
+    // Phosphor scope: decaying intensity planes, re-uploaded every frame it is shown
+    PhosphorScope phosphor_;
+    std::vector<uint32_t> phosphor_pixels_;
+    float phosphor_ms_ = 0.0f;
+    bool phosphor_created_ = false;
+#ifndef NES_HEADLESS
+    sg_image phosphor_texture_ = {};
+    sg_view phosphor_view_ = {};
+    sg_sampler phosphor_sampler_ = {};
+#endif
+    
+    // Scrub history; while scrubbed_ the rings hold a rebuilt past, not live data
+    ScrubHistory scrub_history_;
+    std::vector<float> scrub_scratch_;            // Slices read back for the waveform histories
+    bool scrub_allowed_ = false;
+    bool scrubbed_ = false;
+    uint64_t scrub_end_ = 0;                      // Output frame the rebuilt rings end at
+    uint64_t scrub_drained_ = 0;                  // scrub_history_.outputEnd() when rebuilt
+    
     // Timing for peak decay
     float peak_decay_rate_;
     
     // Helper functions
-    void resetInternal();  // Internal reset without locking (caller must hold mutex)
-    void processFFT();
-    void updateChannelAmplitudes(const short* samples, int sample_count);
+    void appendSamples(const short* samples, int sample_count);
+    void appendMonoSamples(const short* samples, int frame_count);
+    void queueBlock(const short* samples, int frames, bool mono, int64_t stream_frame);
+    void drainBlocks();
+    void drainChannelTaps();
+    void pushLevelPoint(int64_t stream_frame);
+    void drainLevelPoints();
+    void processFFT(uint32_t end_pos);
+    void updateSpectrumIfDirty();
+    void processChannelFFT(uint32_t end_pos);
+    void updateChannelSpectraIfDirty();
+    void updateChannelAmplitudes(float rms);
+    void rebuildFromHistory(uint64_t end);
+#ifndef NES_HEADLESS
+    void createSpectrogramTexture();
+    void createPhosphorTexture();
     void drawWaveformGraph(const std::vector<float>& samples, ImVec2 pos, ImVec2 size, ImVec4 color);
-    void drawSpectrumBars(ImVec2 pos, ImVec2 size);
+    uint32_t scopeStart(const float* ring, uint32_t mask, uint32_t write_pos);
+    void drawScopeChannel(ImDrawList* draw_list, const float* ring, uint32_t mask, uint32_t start,
+                          ImVec2 pos, ImVec2 size, ImU32 color);
+    void drawHistoryChannel(ImDrawList* draw_list, const WaveformHistory& history, ImVec2 pos, ImVec2 size,
+                            ImU32 color);
+    void drawPhosphorScope(ImDrawList* draw_list, ImVec2 pos, ImVec2 size, ImU32 left_color, ImU32 right_color);
+    void drawSpectrumBars(ImDrawList* draw_list, const float* values, const float* peaks, int count,
+                          ImVec2 pos, ImVec2 size);
+#endif
+    void updateNoteSpectrum();
     void decayPeaks(float delta_time);
     
     // Color helpers
-    ImU32 getSpectrumColor(float normalized_value, float normalized_freq);
+    static constexpr int COLOR_LUT_VALUES = 256;  // Quantized level steps
+    static constexpr int COLOR_LUT_FREQS = 32;    // Quantized frequency steps
+    ImU32 getSpectrumColor(float normalized_value, float normalized_freq);  // Exact HSV, used to build the LUT
+    ImU32 lookupSpectrumColor(float normalized_value, float normalized_freq) const {
+        int v = static_cast<int>(std::clamp(normalized_value, 0.0f, 1.0f) * (COLOR_LUT_VALUES - 1) + 0.5f);
+        int f = static_cast<int>(std::clamp(normalized_freq, 0.0f, 1.0f) * (COLOR_LUT_FREQS - 1) + 0.5f);
+        return color_lut_[f * COLOR_LUT_VALUES + v];
+    }
+    void rebuildColorLut();
     ImU32 vec4ToU32(const ImVec4& col);
 };
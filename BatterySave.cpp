@@ -0,0 +1,105 @@
+#include "BatterySave.h"
+#include "NesEmulator.h"
+#include "SaveSlots.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+std::string BatterySave::defaultDirectory() {
+    const std::string states = SaveSlots::defaultDirectory();
+    if (states.empty()) return std::string();
+    return (std::filesystem::path(states).parent_path() / "saves").string();
+}
+
+void BatterySave::open(const std::string& dir, uint64_t rom_hash, NesEmulator& emu) {
+    close(nullptr);
+    frames_ = 0;
+    const size_t size = emu.batteryRamSize();
+    if (size == 0 || dir.empty()) return;
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.sav", static_cast<unsigned long long>(rom_hash));
+    const std::string path = (std::filesystem::path(dir) / name).string();
+
+    // One small read before the game runs; a file of the wrong size is not
+    // this cartridge's and is left for the next save to replace
+    std::vector<uint8_t> ram;
+    std::ifstream file(path, std::ios::binary);
+    if (file.is_open()) {
+        ram.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (ram.size() != size || !emu.loadBatteryRam(ram)) ram.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    written_ = std::move(ram);
+}
+
+void BatterySave::close(NesEmulator* emu) {
+    // What the game wrote since the last interval
+    if (emu && emu->takeBatteryRam(taken_)) queue();
+    JobPool::shared().wait(io_job_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_.clear();
+    written_.clear();
+}
+
+void BatterySave::onFrame(NesEmulator& emu) {
+    if (++frames_ < SAVE_INTERVAL_FRAMES) return;
+    frames_ = 0;
+    // Unchanged RAM costs a flag test, a change an 8KB copy
+    if (emu.takeBatteryRam(taken_)) queue();
+}
+
+void BatterySave::queue() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (path_.empty()) return;
+    pending_.swap(taken_);
+    write_pending_ = true;
+    kick();
+}
+
+void BatterySave::kick() {
+    if (draining_) return;
+    draining_ = true;
+    JobPool::shared().submit(io_job_, JobPool::Priority::Normal, [this]() { drain(); });
+}
+
+void BatterySave::drain() {
+    std::vector<uint8_t> ram;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (write_pending_) {
+        write_pending_ = false;
+        ram.swap(pending_);
+        const std::filesystem::path path = path_;
+        // A game that rewrites its RAM with what it held, or a state load
+        // that puts back what is on disk, has nothing to write
+        const bool changed = ram != written_;
+        lock.unlock();
+
+        bool ok = true;
+        if (changed) {
+            // Written aside and renamed over, so a crash never leaves half a save
+            std::error_code ec;
+            std::filesystem::create_directories(path.parent_path(), ec);
+            std::filesystem::path temp = path;
+            temp += ".tmp";
+            {
+                std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+                ok = file.write(reinterpret_cast<const char*>(ram.data()), static_cast<std::streamsize>(ram.size()))
+                         .good();
+            }
+            if (ok) std::filesystem::rename(temp, path, ec);
+            if (!ok || ec) {
+                std::filesystem::remove(temp, ec);
+                ok = false;
+            }
+        }
+
+        lock.lock();
+        if (ok && changed) written_ = ram;
+    }
+    draining_ = false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "JobPool.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class NesEmulator;
+
+// The game's own saves: battery-backed PRG RAM kept in a .sav file per ROM,
+// the raw bytes as other emulators write them. open() reads the file into
+// the emulator after the ROM is loaded; from then on onFrame() asks the
+// emulator every SAVE_INTERVAL_FRAMES frames for the RAM, which it copies
+// only when the game wrote it since (agnes' dirty flag), and an I/O job on
+// the shared JobPool writes it aside and renames it over the file. The
+// emulation thread never waits on the disk. close() takes what is left,
+// writes it and waits for the job, for exit and a change of ROM.
+class BatterySave {
+public:
+    static constexpr int SAVE_INTERVAL_FRAMES = 60;  // A second at 60 Hz
+
+    // Per-user data directory for the platform, beside SaveSlots' states;
+    // empty if there is none
+    static std::string defaultDirectory();
+
+    ~BatterySave() { close(nullptr); }
+
+    // Start on emu's ROM, just loaded: its .sav in dir, if it has one, goes
+    // into emu. Nothing to do for a cartridge without a battery.
+    void open(const std::string& dir, uint64_t rom_hash, NesEmulator& emu);
+    // Take emu's RAM if it changed, and wait for it to be written; emu may
+    // be null when it is gone
+    void close(NesEmulator* emu);
+
+    // After every frame, on the thread running emu
+    void onFrame(NesEmulator& emu);
+
+private:
+    void queue();  // taken_ to the I/O job
+    void kick();   // Queue the I/O job unless it is running; mutex_ held
+    void drain();  // The I/O job: writes until nothing is pending
+
+    std::mutex mutex_;
+    JobPool::Group io_job_;
+    bool draining_ = false;  // The I/O job is queued or running
+    std::string path_;       // Empty when closed, or with no battery
+    std::vector<uint8_t> pending_;  // RAM to write
+    bool write_pending_ = false;
+    std::vector<uint8_t> written_;  // What the file holds, so an unchanged take is not written
+
+    // Emulation thread
+    std::vector<uint8_t> taken_;
+    int frames_ = 0;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "gme/gme.h"
+#include "gme/Nsf_Emu.h"
+#include "gme/Nes_Apu.h"
+#include "gme/Nes_Vrc6_Apu.h"
+#include "gme/Nes_Fme7_Apu.h"
+#include "gme/Nes_Namco_Apu.h"
+#include "ChannelTaps.h"
+
+// Typed view of a Music_Emu's sound chips, resolved once when a file is
+// loaded so the audio path can read oscillator state without RTTI
+struct ChannelProbe {
+    Nsf_Emu* nsf = nullptr;
+    Nes_Apu* apu = nullptr;
+    Nes_Vrc6_Apu* vrc6 = nullptr;
+    Nes_Fme7_Apu* fme7 = nullptr;
+    Nes_Namco_Apu* namco = nullptr;
+
+    // Per-voice sample taps (emulators opened with open_tapped_emu); tap i is
+    // gme voice i, ChannelTable::voice_channel maps it to a table entry
+    ChannelTapBuffer* taps = nullptr;
+
+    // Nsfe_Emu derives from Nsf_Emu, so both types share one static_cast
+    static ChannelProbe resolve(Music_Emu* emu, ChannelTapBuffer* taps = nullptr) {
+        ChannelProbe probe;
+        if (!emu) return probe;
+        gme_type_t type = gme_type(emu);
+        if (type == gme_nsf_type || type == gme_nsfe_type) {
+            probe.nsf = static_cast<Nsf_Emu*>(emu);
+            probe.apu = probe.nsf->apu_();
+            probe.vrc6 = probe.nsf->vrc6_();
+            probe.fme7 = probe.nsf->fme7_();
+            probe.namco = probe.nsf->namco_();
+            probe.taps = taps;
+        }
+        return probe;
+    }
+
+    bool hasApu() const { return apu != nullptr; }
+    bool hasVRC6() const { return vrc6 != nullptr; }
+    bool hasFme7() const { return fme7 != nullptr; }
+    bool hasNamco() const { return namco != nullptr; }
+    int voiceCount() const { return nsf ? nsf->voice_count() : 0; }
+    double playInterval() const { return nsf ? nsf->play_interval() : 0.0; }  // Seconds between play calls
+    bool hasTaps() const { return taps != nullptr; }
+
+    // Frames captured by the taps since the last call (thread calling gme_play)
+    int takeTaps(const short** frames) const { return taps ? taps->takeTaps(frames) : 0; }
+
+    // 5 base APU oscillators: Square1, Square2, Triangle, Noise, DMC
+    void readApu(int* periods, int* lengths, int* amplitudes, int* volumes) const {
+        apu->osc_state(periods, lengths, amplitudes);
+        apu->osc_volumes(volumes);
+    }
+
+    // 3 VRC6 oscillators: Pulse1, Pulse2, Saw
+    void readVRC6(int* periods, int* amplitudes, int* volumes, bool* enabled) const {
+        vrc6->osc_state(periods, amplitudes, volumes, enabled);
+    }
+
+    // 3 FME7 square oscillators
+    void readFme7(int* periods, int* volumes) const {
+        fme7->osc_state(periods, volumes);
+    }
+
+    // 8 Namco 163 wave oscillators; only the top active_count are clocked
+    void readNamco(long* freqs, int* wave_sizes, int* volumes, int* active_count) const {
+        namco->osc_state(freqs, wave_sizes, volumes);
+        *active_count = namco->active_osc_count();
+    }
+};
@@ -0,0 +1,280 @@
+#include "ChannelRegistry.h"
+#include "ChannelProbe.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+struct ChannelInfo {
+    const char* name;
+    const char* short_name;
+    ImU32 color;
+    bool smooth_level;
+};
+
+// Descriptors per chip, indexed by oscillator
+const ChannelInfo APU_INFO[] = {
+    {"Square 1", "Sq1", IM_COL32(255, 77, 77, 255), false},
+    {"Square 2", "Sq2", IM_COL32(255, 153, 51, 255), false},
+    {"Triangle", "Tri", IM_COL32(77, 179, 255, 255), true},   // last_amp is the waveform step
+    {"Noise", "Noi", IM_COL32(230, 77, 230, 255), false},
+    {"DMC", "DMC", IM_COL32(230, 230, 77, 255), true},        // last_amp is the DAC, kept when stopped
+};
+const ChannelInfo VRC6_INFO[] = {
+    {"VRC6 Pulse1", "V-P1", IM_COL32(51, 230, 128, 255), false},
+    {"VRC6 Pulse2", "V-P2", IM_COL32(102, 230, 179, 255), false},
+    {"VRC6 Saw", "V-Saw", IM_COL32(153, 102, 230, 255), false},
+};
+const ChannelInfo FME7_INFO[] = {
+    {"FME7 Square A", "F-A", IM_COL32(60, 200, 220, 255), false},
+    {"FME7 Square B", "F-B", IM_COL32(100, 170, 240, 255), false},
+    {"FME7 Square C", "F-C", IM_COL32(140, 215, 245, 255), false},
+};
+const ChannelInfo NAMCO_INFO[] = {
+    {"N163 Wave 1", "N1", IM_COL32(255, 120, 160, 255), false},
+    {"N163 Wave 2", "N2", IM_COL32(255, 135, 140, 255), false},
+    {"N163 Wave 3", "N3", IM_COL32(255, 150, 120, 255), false},
+    {"N163 Wave 4", "N4", IM_COL32(255, 165, 100, 255), false},
+    {"N163 Wave 5", "N5", IM_COL32(255, 180, 90, 255), false},
+    {"N163 Wave 6", "N6", IM_COL32(245, 195, 90, 255), false},
+    {"N163 Wave 7", "N7", IM_COL32(235, 210, 100, 255), false},
+    {"N163 Wave 8", "N8", IM_COL32(225, 225, 110, 255), false},
+};
+const ChannelInfo* const CHIP_INFO[] = {APU_INFO, VRC6_INFO, FME7_INFO, NAMCO_INFO};
+
+constexpr int APU_OSCS = 5;
+constexpr int VRC6_OSCS = 3;
+constexpr int FME7_OSCS = 3;
+constexpr int NAMCO_OSCS = 8;
+
+static_assert(ChannelTable::MAX_VOICES == ChannelTapBuffer::MAX_TAPS, "Voices and taps share numbering");
+
+int frequencyToMidi(float frequency) {
+    if (frequency <= 0.0f) return -1;
+    int note = static_cast<int>(std::round(69.0f + 12.0f * std::log2(frequency / 440.0f)));
+    return (note < 0 || note > 127) ? -1 : note;
+}
+
+// MIDI note of every 12-bit period, built at startup, so sampling is a load
+// instead of a divide and a log2. The APU pulses and triangle and the VRC6
+// oscillators step every 16 * (period + 1) clocks here, the FME7 squares
+// every 32 * period.
+constexpr int PERIOD_COUNT = 0x1000;
+struct PeriodTables {
+    std::array<int8_t, PERIOD_COUNT> clocks16;
+    std::array<int8_t, PERIOD_COUNT> clocks32;
+
+    PeriodTables() {
+        for (int p = 0; p < PERIOD_COUNT; ++p) {
+            clocks16[p] = static_cast<int8_t>(frequencyToMidi(ChannelTable::NES_CPU_CLOCK / (16.0f * (p + 1))));
+            clocks32[p] = static_cast<int8_t>(p > 0 ? frequencyToMidi(ChannelTable::NES_CPU_CLOCK / (32.0f * p)) : -1);
+        }
+    }
+};
+const PeriodTables PERIOD_TABLES;
+
+int periodToMidi16(int period) {
+    return period >= 0 && period < PERIOD_COUNT ? PERIOD_TABLES.clocks16[period]
+                                                : frequencyToMidi(ChannelTable::NES_CPU_CLOCK / (16.0f * (period + 1)));
+}
+
+int periodToMidi32(int period) {
+    return period >= 0 && period < PERIOD_COUNT ? PERIOD_TABLES.clocks32[period]
+                                                : frequencyToMidi(ChannelTable::NES_CPU_CLOCK / (32.0f * period));
+}
+
+}  // namespace
+
+ChannelTable::ChannelTable() {
+    first.fill(-1);
+    voice_channel.fill(-1);
+    for (int i = 0; i < APU_OSCS; ++i) add(SoundChip::Apu, i, i);
+}
+
+void ChannelTable::add(SoundChip c, int osc_index, int voice_index) {
+    if (count >= MAX_CHANNELS || voice_index < 0 || voice_index >= MAX_VOICES) return;
+    const ChannelInfo& info = CHIP_INFO[static_cast<size_t>(c)][osc_index];
+    const int i = count++;
+    if (first[static_cast<size_t>(c)] < 0) first[static_cast<size_t>(c)] = static_cast<int8_t>(i);
+    chip[i] = c;
+    osc[i] = static_cast<uint8_t>(osc_index);
+    voice[i] = static_cast<uint8_t>(voice_index);
+    smooth_level[i] = info.smooth_level;
+    name[i] = info.name;
+    short_name[i] = info.short_name;
+    color[i] = info.color;
+    voice_channel[voice_index] = i;
+    silence(i);
+}
+
+void ChannelTable::silence(int entry) {
+    note[entry] = -1;
+    velocity[entry] = 0.0f;
+    level[entry] = 0.0f;
+}
+
+void ChannelTable::settle(SoundChip c, int oscs) {
+    const int base = first[static_cast<size_t>(c)];
+    for (int i = base; i < base + oscs; ++i) {
+        active[i] = note[i] >= 0 && note[i] <= 127 && velocity[i] > MIN_VELOCITY;
+        if (!active[i]) note[i] = -1;
+    }
+}
+
+ChannelTable ChannelTable::forProbe(const ChannelProbe& probe) {
+    ChannelTable table;
+    if (!probe.nsf) return table;
+
+    // Follows Nsf_Emu::set_voice: after the APU come the FME7 squares, else
+    // the VRC6 with its saw first, then the Namco waves. Chips behind the
+    // FME7 share its voice numbers and never get an output, so they are left
+    // out, as are voices beyond voice_count().
+    const int voices = probe.voiceCount();
+    auto add_voice = [&](SoundChip c, int osc_index, int voice_index) {
+        if (voice_index < voices) table.add(c, osc_index, voice_index);
+    };
+    int base = APU_OSCS;
+    if (probe.hasFme7()) {
+        for (int i = 0; i < FME7_OSCS; ++i) add_voice(SoundChip::Fme7, i, base + i);
+        return table;
+    }
+    if (probe.hasVRC6()) {
+        add_voice(SoundChip::Vrc6, 0, base + 1);
+        add_voice(SoundChip::Vrc6, 1, base + 2);
+        add_voice(SoundChip::Vrc6, 2, base);
+        base += VRC6_OSCS;
+    }
+    if (probe.hasNamco()) {
+        for (int i = 0; i < NAMCO_OSCS; ++i) add_voice(SoundChip::Namco, i, base + i);
+    }
+    return table;
+}
+
+ChannelTable ChannelTable::forNesEmulator(bool has_vrc6) {
+    ChannelTable table;
+    if (has_vrc6) {
+        for (int i = 0; i < VRC6_OSCS; ++i) table.add(SoundChip::Vrc6, i, APU_OSCS + i);
+    }
+    return table;
+}
+
+uint32_t ChannelTable::voiceMask() const {
+    uint32_t mask = 0;
+    for (int i = 0; i < count; ++i) mask |= 1u << voice[i];
+    return mask;
+}
+
+void ChannelTable::sample(const ChannelProbe& probe) {
+    if (probe.hasApu() && hasChip(SoundChip::Apu)) {
+        int periods[APU_OSCS], lengths[APU_OSCS], amplitudes[APU_OSCS], volumes[APU_OSCS];
+        probe.readApu(periods, lengths, amplitudes, volumes);
+        sampleApu(periods, lengths, amplitudes, volumes);
+    }
+    if (probe.hasVRC6() && hasChip(SoundChip::Vrc6)) {
+        int periods[VRC6_OSCS], amplitudes[VRC6_OSCS], volumes[VRC6_OSCS];
+        bool enabled[VRC6_OSCS];
+        probe.readVRC6(periods, amplitudes, volumes, enabled);
+        sampleVrc6(periods, amplitudes, volumes, enabled);
+    }
+    if (probe.hasFme7() && hasChip(SoundChip::Fme7)) {
+        int periods[FME7_OSCS], volumes[FME7_OSCS];
+        probe.readFme7(periods, volumes);
+        sampleFme7(periods, volumes);
+    }
+    if (probe.hasNamco() && hasChip(SoundChip::Namco)) {
+        long freqs[NAMCO_OSCS];
+        int wave_sizes[NAMCO_OSCS], volumes[NAMCO_OSCS], active_count;
+        probe.readNamco(freqs, wave_sizes, volumes, &active_count);
+        sampleNamco(freqs, wave_sizes, volumes, active_count);
+    }
+}
+
+void ChannelTable::sampleApu(const int* periods, const int* lengths, const int* amplitudes, const int* volumes) {
+    // Square 1/2 and Noise: last_amp is the output amplitude, so it follows the volume;
+    // register volumes, when given, decide the notes instead, as they hold while the
+    // output is 0 in the low half of a cycle or detached. Triangle has no volume; DMC
+    // counts down bytes in its length.
+    const int base = first[static_cast<size_t>(SoundChip::Apu)];
+    if (base < 0) return;
+    for (int o = 0; o < APU_OSCS; ++o) {
+        const int i = base + o;
+        const int period = periods[o];
+        const bool active = lengths[o] > 0;
+        const int amp = volumes ? volumes[o] : std::abs(amplitudes[o]);
+        silence(i);
+        if (!active) continue;
+
+        level[i] = std::abs(amplitudes[o]) / (o == 4 ? 127.0f : 15.0f);
+        switch (o) {
+        case 3:  // Noise: the period index, mapped onto C2-C3
+            if (amp > 0) {
+                note[i] = static_cast<int16_t>(36 + (15 - (period & 0x0F)));
+                velocity[i] = std::min(1.0f, amp / 15.0f);
+            }
+            break;
+        case 4:  // DMC: a fixed low note while playing
+            note[i] = 28;
+            velocity[i] = 0.8f;
+            break;
+        default:  // Squares and Triangle
+            if ((o == 2 || amp > 0) && period >= 8) {
+                note[i] = static_cast<int16_t>(periodToMidi16(period));
+                velocity[i] = o == 2 ? 0.8f : std::min(1.0f, amp / 15.0f);
+            }
+            break;
+        }
+    }
+    settle(SoundChip::Apu, APU_OSCS);
+}
+
+void ChannelTable::sampleVrc6(const int* periods, const int* amplitudes, const int* volumes, const bool* enabled) {
+    // Pulses have a 4-bit volume; the saw's volume is its accumulator rate (0-63, ~42 at most in practice)
+    const int base = first[static_cast<size_t>(SoundChip::Vrc6)];
+    if (base < 0) return;
+    for (int o = 0; o < VRC6_OSCS; ++o) {
+        const int i = base + o;
+        const bool saw = o == 2;
+        silence(i);
+        level[i] = std::min(1.0f, std::abs(amplitudes[o]) / (saw ? 31.0f : 15.0f));
+        if (enabled[o] && volumes[o] > 0 && periods[o] >= 1) {
+            note[i] = static_cast<int16_t>(periodToMidi16(periods[o]));
+            velocity[i] = std::min(1.0f, volumes[o] / (saw ? 42.0f : 15.0f));
+        }
+    }
+    settle(SoundChip::Vrc6, VRC6_OSCS);
+}
+
+void ChannelTable::sampleFme7(const int* periods, const int* volumes) {
+    // Squares toggle every 16 * period clocks; very short periods are muted by the emulator
+    const int base = first[static_cast<size_t>(SoundChip::Fme7)];
+    if (base < 0) return;
+    for (int o = 0; o < FME7_OSCS; ++o) {
+        const int i = base + o;
+        silence(i);
+        if (volumes[o] <= 0 || periods[o] * 16 < 50) continue;
+        level[i] = volumes[o] / 15.0f;
+        note[i] = static_cast<int16_t>(periodToMidi32(periods[o]));
+        velocity[i] = level[i];
+    }
+    settle(SoundChip::Fme7, FME7_OSCS);
+}
+
+void ChannelTable::sampleNamco(const long* freqs, const int* wave_sizes, const int* volumes, int active_count) {
+    // The active oscillators are time-multiplexed, each stepping one wave
+    // sample every 15 * 65536 * active_count / freq clocks
+    const int base = first[static_cast<size_t>(SoundChip::Namco)];
+    if (base < 0) return;
+    for (int o = 0; o < NAMCO_OSCS; ++o) {
+        const int i = base + o;
+        silence(i);
+        if (o < NAMCO_OSCS - active_count || wave_sizes[o] <= 0 || volumes[o] <= 0) continue;
+        if (freqs[o] < 64L * active_count) continue;
+        level[i] = volumes[o] / 15.0f;
+        const float hz = NES_CPU_CLOCK * freqs[o] / (983040.0f * active_count * wave_sizes[o]);
+        note[i] = static_cast<int16_t>(frequencyToMidi(hz));
+        velocity[i] = level[i];
+    }
+    settle(SoundChip::Namco, NAMCO_OSCS);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "imgui.h"
+#include <array>
+#include <cstdint>
+
+struct ChannelProbe;
+
+// Sound chips that can contribute channels, in table order
+enum class SoundChip : uint8_t { Apu, Vrc6, Fme7, Namco, Count };
+
+// Flat struct-of-arrays table of every channel the loaded file can sound.
+// The descriptor columns (chip, voice, name, colour) are built once per file
+// from the chips that are present; the per-frame columns are refreshed from
+// the chip registers by the sample functions, which hold all the per-chip
+// decoding and the one test of whether a channel sounds a note. Each
+// snapshot is decoded once; meters, scopes, the piano and its note passes
+// read the result, iterating entries 0..count-1.
+struct ChannelTable {
+    static constexpr int MAX_CHANNELS = 16;  // APU 5 + VRC6 3 + Namco 8, the largest set gme wires up
+    static constexpr int MAX_VOICES = 24;    // gme voices a table can map (ChannelTapBuffer::MAX_TAPS)
+    static constexpr int APU_CHANNELS = 5;   // Always entries 0-4
+    static constexpr float NES_CPU_CLOCK = 1789773.0f;  // NTSC
+    static constexpr float MIN_VELOCITY = 0.01f;  // Quieter is silence
+
+    // The 2A03 channels alone, which every NES source has
+    ChannelTable();
+
+    int count = 0;
+
+    // Descriptors, fixed for the loaded file
+    std::array<SoundChip, MAX_CHANNELS> chip{};
+    std::array<uint8_t, MAX_CHANNELS> osc{};          // Oscillator within its chip
+    std::array<uint8_t, MAX_CHANNELS> voice{};        // gme voice: mute bit and tap index
+    std::array<bool, MAX_CHANNELS> smooth_level{};    // Level is a waveform position or DAC value, average it
+    std::array<const char*, MAX_CHANNELS> name{};
+    std::array<const char*, MAX_CHANNELS> short_name{};
+    std::array<ImU32, MAX_CHANNELS> color{};
+    std::array<int, MAX_VOICES> voice_channel{};      // Entry for each gme voice, -1 if none
+    std::array<int8_t, static_cast<size_t>(SoundChip::Count)> first{};  // First entry per chip, -1 if absent
+
+    // Sampled per frame
+    std::array<int16_t, MAX_CHANNELS> note{};         // MIDI note, -1 when silent
+    std::array<float, MAX_CHANNELS> velocity{};       // 0..1 from the volume registers
+    std::array<float, MAX_CHANNELS> level{};          // 0..1 meter estimate from the output
+    std::array<bool, MAX_CHANNELS> active{};          // Sounding note: 0-127, above MIN_VELOCITY
+
+    // Channels of a resolved NSF/NSFE in gme voice numbering; other files get
+    // the APU entries only
+    static ChannelTable forProbe(const ChannelProbe& probe);
+    // NesEmulator: APU plus VRC6, voices in NesEmulator tap order
+    static ChannelTable forNesEmulator(bool has_vrc6);
+
+    bool hasChip(SoundChip c) const { return first[static_cast<size_t>(c)] >= 0; }
+    uint32_t voiceMask() const;  // Every voice in the table
+
+    // Refresh the per-frame columns from live chips (thread calling gme_play)
+    void sample(const ChannelProbe& probe);
+
+    // Or from register snapshots, one function per chip
+    void sampleApu(const int* periods, const int* lengths, const int* amplitudes, const int* volumes = nullptr);
+    void sampleVrc6(const int* periods, const int* amplitudes, const int* volumes, const bool* enabled);
+    void sampleFme7(const int* periods, const int* volumes);
+    void sampleNamco(const long* freqs, const int* wave_sizes, const int* volumes, int active_count);
+
+private:
+    void add(SoundChip c, int osc, int voice);
+    void silence(int entry);
+    // After a chip's entries are decoded: which sound a note, the others' note -1
+    void settle(SoundChip c, int oscs);
+};
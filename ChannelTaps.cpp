@@ -0,0 +1,303 @@
+#include "ChannelTaps.h"
+#include "ZipArchive.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+ChannelTapBuffer::ChannelTapBuffer(int samples_per_frame)
+    : Multi_Buffer(samples_per_frame)
+{
+    for (int i = 0; i < MAX_TAPS; ++i) {
+        tap_ptrs_[i] = &taps_[i];
+        pan_left_[i].store(PAN_UNITY, std::memory_order_relaxed);
+        pan_right_[i].store(PAN_UNITY, std::memory_order_relaxed);
+    }
+}
+
+void ChannelTapBuffer::setPan(int index, float pan) {
+    if (index < 0 || index >= MAX_TAPS) return;
+    pan = std::clamp(pan, -1.0f, 1.0f);
+    pan_left_[index].store(static_cast<int32_t>(std::lround(PAN_UNITY * std::min(1.0f, 1.0f - pan))),
+                           std::memory_order_relaxed);
+    pan_right_[index].store(static_cast<int32_t>(std::lround(PAN_UNITY * std::min(1.0f, 1.0f + pan))),
+                            std::memory_order_relaxed);
+}
+
+float ChannelTapBuffer::pan(int index) const {
+    if (index < 0 || index >= MAX_TAPS) return 0.0f;
+    const int32_t left = pan_left_[index].load(std::memory_order_relaxed);
+    const int32_t right = pan_right_[index].load(std::memory_order_relaxed);
+    return static_cast<float>(right - left) / PAN_UNITY;
+}
+
+blargg_err_t ChannelTapBuffer::configureTap(Blip_Buffer& tap) {
+    if (sample_rate() == 0) return nullptr;  // Configured later by set_sample_rate
+    blargg_err_t err = tap.set_sample_rate(sample_rate(), length());
+    if (err) return err;
+    if (clock_rate_) tap.clock_rate(clock_rate_);
+    tap.bass_freq(bass_freq_);
+    return nullptr;
+}
+
+blargg_err_t ChannelTapBuffer::set_channel_count(int count) {
+    if (count < 1 || count > MAX_TAPS) return "Too many voices for ChannelTapBuffer";
+
+    for (int i = tap_count_; i < count; ++i) {
+        blargg_err_t err = configureTap(taps_[i]);
+        if (err) return err;
+    }
+    tap_count_ = count;
+
+    chunk_.assign(static_cast<size_t>(READ_CHUNK) * count, 0);
+    captured_.assign(static_cast<size_t>(CAPTURE_FRAMES) * count, 0);
+    captured_frames_ = 0;
+    channels_changed();
+    return nullptr;
+}
+
+Multi_Buffer::channel_t ChannelTapBuffer::channel(int index, int) {
+    // Every output of a voice goes to its tap, so panned voices are kept too
+    Blip_Buffer* tap = &taps_[std::clamp(index, 0, MAX_TAPS - 1)];
+    channel_t ch;
+    ch.center = tap;
+    ch.left = tap;
+    ch.right = tap;
+    return ch;
+}
+
+blargg_err_t ChannelTapBuffer::set_sample_rate(long rate, int msec) {
+    // Only the first tap is needed to learn the rounded rate and length
+    blargg_err_t err = taps_[0].set_sample_rate(rate, msec);
+    if (err) return err;
+    err = Multi_Buffer::set_sample_rate(taps_[0].sample_rate(), taps_[0].length());
+    if (err) return err;
+
+    for (int i = 1; i < std::max(1, tap_count_); ++i) {
+        err = configureTap(taps_[i]);
+        if (err) return err;
+    }
+    return nullptr;
+}
+
+void ChannelTapBuffer::clock_rate(long rate) {
+    clock_rate_ = rate;
+    for (int i = 0; i < std::max(1, tap_count_); ++i) {
+        taps_[i].clock_rate(rate);
+    }
+}
+
+void ChannelTapBuffer::bass_freq(int freq) {
+    bass_freq_ = freq;
+    for (int i = 0; i < std::max(1, tap_count_); ++i) {
+        taps_[i].bass_freq(freq);
+    }
+}
+
+void ChannelTapBuffer::synth_quality(int quality) {
+    // Every tap, so voices added later by set_channel_count() get it too
+    for (Blip_Buffer& tap : taps_) tap.synth_quality(quality);
+}
+
+void ChannelTapBuffer::clear() {
+    for (int i = 0; i < std::max(1, tap_count_); ++i) {
+        taps_[i].clear();
+    }
+    captured_frames_ = 0;
+}
+
+void ChannelTapBuffer::end_frame(blip_time_t time) {
+    for (int i = 0; i < std::max(1, tap_count_); ++i) {
+        taps_[i].end_frame(time);
+    }
+}
+
+long ChannelTapBuffer::samples_avail() const {
+    return taps_[0].samples_avail() * samples_per_frame();
+}
+
+void ChannelTapBuffer::remove_samples(long count) {
+    const long frames = std::min(count / samples_per_frame(), taps_[0].samples_avail());
+    for (int i = 0; i < std::max(1, tap_count_); ++i) {
+        taps_[i].remove_samples(frames);
+    }
+}
+
+long ChannelTapBuffer::read_samples(blip_sample_t* out, long count) {
+    const int spf = samples_per_frame();
+    return mix(out, count / spf, spf, spf == 2) * spf;
+}
+
+long ChannelTapBuffer::readStereo(blip_sample_t* out, long frames) {
+    return mix(out, frames, 2, true);
+}
+
+long ChannelTapBuffer::mix(blip_sample_t* out, long frames, int out_channels, bool stereo) {
+    const int taps = std::max(1, tap_count_);
+    frames = std::min(frames, taps_[0].samples_avail());
+    if (chunk_.empty()) {
+        // set_channel_count() not called yet: plain single-buffer read
+        const long read = taps_[0].read_samples(out, frames);
+        for (long i = read; i-- > 0;) {
+            for (int c = 0; c < out_channels; ++c) out[i * out_channels + c] = out[i];
+        }
+        return read;
+    }
+
+    // Gains once a read; all at unity is the mono mix on both sides
+    int32_t left[MAX_TAPS];
+    int32_t right[MAX_TAPS];
+    bool centred = true;
+    for (int t = 0; t < taps; ++t) {
+        left[t] = pan_left_[t].load(std::memory_order_relaxed);
+        right[t] = pan_right_[t].load(std::memory_order_relaxed);
+        centred &= left[t] == PAN_UNITY && right[t] == PAN_UNITY;
+    }
+    stereo &= !centred;
+
+    long done = 0;
+    while (done < frames) {
+        const int n = static_cast<int>(std::min<long>(READ_CHUNK, frames - done));
+
+        // All taps in one lockstep pass (four at a time with BLIP_BUFFER_SIMD),
+        // then mix frame by frame
+        Blip_Buffer::read_samples(tap_ptrs_, taps, chunk_.data(), READ_CHUNK, n);
+
+        blip_sample_t* dst = out + done * out_channels;
+        if (stereo) {
+            for (int i = 0; i < n; ++i) {
+                int64_t sum_left = 0;
+                int64_t sum_right = 0;
+                for (int t = 0; t < taps; ++t) {
+                    const int32_t s = chunk_[static_cast<size_t>(t) * READ_CHUNK + i];
+                    sum_left += s * left[t];
+                    sum_right += s * right[t];
+                }
+                sum_left /= PAN_UNITY;
+                sum_right /= PAN_UNITY;
+                dst[i * 2] = static_cast<blip_sample_t>(std::clamp<int64_t>(sum_left, -32768, 32767));
+                dst[i * 2 + 1] = static_cast<blip_sample_t>(std::clamp<int64_t>(sum_right, -32768, 32767));
+            }
+        } else {
+            for (int i = 0; i < n; ++i) {
+                int32_t sum = 0;
+                for (int t = 0; t < taps; ++t) {
+                    sum += chunk_[static_cast<size_t>(t) * READ_CHUNK + i];
+                }
+                const blip_sample_t s = static_cast<blip_sample_t>(std::clamp<int32_t>(sum, -32768, 32767));
+                for (int c = 0; c < out_channels; ++c) {
+                    dst[i * out_channels + c] = s;
+                }
+            }
+        }
+
+        // Keep the per-tap samples, interleaved, for takeTaps()
+        if (capture_) {
+            const int room = std::min(n, CAPTURE_FRAMES - captured_frames_);
+            short* cap = captured_.data() + static_cast<size_t>(captured_frames_) * taps;
+            for (int i = 0; i < room; ++i) {
+                for (int t = 0; t < taps; ++t) {
+                    cap[i * taps + t] = chunk_[static_cast<size_t>(t) * READ_CHUNK + i];
+                }
+            }
+            captured_frames_ += room;
+        }
+
+        done += n;
+    }
+    return frames;
+}
+
+int ChannelTapBuffer::takeTaps(const short** frames) {
+    *frames = captured_.data();
+    int count = captured_frames_;
+    captured_frames_ = 0;
+    return count;
+}
+
+size_t ChannelTapBuffer::memoryBytes() const {
+    size_t bytes = MemoryReport::heapBytes(chunk_) + MemoryReport::heapBytes(captured_);
+    for (const Blip_Buffer& tap : taps_) bytes += static_cast<size_t>(tap.buffer_bytes());
+    return bytes;
+}
+
+std::shared_ptr<const MusicFile> MusicFile::read(const char* path, gme_err_t* err) {
+    std::shared_ptr<const MappedFile> image = ZipArchive::openPath(path, err);
+    if (!image) return nullptr;
+
+    auto file = std::make_shared<MusicFile>();
+    file->path = path;
+    file->image = std::move(image);
+    return file;
+}
+
+// As gme_identify_file(), which tries the extension before the header
+gme_type_t identify_music_file(const MusicFile& file) {
+    gme_type_t type = gme_identify_extension(file.path.c_str());
+    if (!type && file.size() >= 4) {
+        type = gme_identify_extension(gme_identify_header(file.data()));
+    }
+    return type;
+}
+
+gme_err_t open_music_emu(const MusicFile& file, Music_Emu** out, long sample_rate) {
+    *out = nullptr;
+    gme_type_t type = identify_music_file(file);
+    if (!type) return gme_wrong_file_type;
+
+    Music_Emu* emu = gme_new_emu(type, sample_rate);
+    if (!emu) return "Out of memory";
+    gme_err_t err = gme_load_data(emu, file.data(), static_cast<long>(file.size()));
+    if (err) {
+        gme_delete(emu);
+        return err;
+    }
+    *out = emu;
+    return nullptr;
+}
+
+gme_err_t open_tapped_emu(const MusicFile& file, Music_Emu** out, long sample_rate, ChannelTapBuffer** taps_out) {
+    *out = nullptr;
+    *taps_out = nullptr;
+
+    gme_type_t type = identify_music_file(file);
+    if (type != gme_nsf_type && type != gme_nsfe_type) {
+        return open_music_emu(file, out, sample_rate);
+    }
+
+    // Same steps as gme_new_emu, but with our buffer instead of Effects_Buffer
+    Music_Emu* emu;
+    ChannelTapBuffer* taps;
+    if (type == gme_nsfe_type) {
+        auto* tapped = new TappedEmu<Nsfe_Emu>;
+        emu = tapped;
+        taps = &tapped->taps();
+    } else {
+        auto* tapped = new TappedEmu<Nsf_Emu>;
+        emu = tapped;
+        taps = &tapped->taps();
+    }
+
+    gme_err_t err = emu->set_sample_rate(sample_rate);
+    if (!err) err = gme_load_data(emu, file.data(), static_cast<long>(file.size()));
+    if (err) {
+        delete emu;
+        return err;
+    }
+
+    *out = emu;
+    *taps_out = taps;
+    return nullptr;
+}
+
+void report_music_emu_memory(Music_Emu* emu, MemoryReport::Sample& sample) {
+    if (!emu) return;
+    if (auto* nsf = dynamic_cast<TappedEmu<Nsf_Emu>*>(emu)) {
+        sample.add(MemoryReport::MUSIC_EMU, sizeof(*nsf));
+        sample.add(MemoryReport::BLIP_BUFFERS, nsf->taps().memoryBytes());
+    } else if (auto* nsfe = dynamic_cast<TappedEmu<Nsfe_Emu>*>(emu)) {
+        sample.add(MemoryReport::MUSIC_EMU, sizeof(*nsfe));
+        sample.add(MemoryReport::BLIP_BUFFERS, nsfe->taps().memoryBytes());
+    } else {
+        sample.add(MemoryReport::MUSIC_EMU, dynamic_cast<Nsf_Emu*>(emu) ? sizeof(Nsf_Emu) : sizeof(Music_Emu));
+    }
+}
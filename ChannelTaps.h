@@ -0,0 +1,126 @@
+#pragma once
+
+#include "gme/gme.h"
+#include "gme/Multi_Buffer.h"
+#include "gme/Nsf_Emu.h"
+#include "gme/Nsfe_Emu.h"
+#include "MappedFile.h"
+#include "MemoryReport.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Multi_Buffer that gives every voice its own Blip_Buffer ("tap").
+// read_samples() mixes the taps into the normal output and, while capture
+// is on, keeps each tap's samples so visualizers get real per-channel
+// waveforms. Voices are centred, as with gme's default Effects_Buffer,
+// unless setPan() places them.
+class ChannelTapBuffer : public Multi_Buffer {
+public:
+    static constexpr int MAX_TAPS = 24;           // 5 APU + every expansion chip
+    static constexpr int CAPTURE_FRAMES = 8192;   // Captured frames kept until takeTaps()
+
+    explicit ChannelTapBuffer(int samples_per_frame = 2);
+
+    // Multi_Buffer
+    blargg_err_t set_channel_count(int count) override;
+    channel_t channel(int index, int type) override;
+    blargg_err_t set_sample_rate(long rate, int msec = blip_default_length) override;
+    void clock_rate(long rate) override;
+    void bass_freq(int freq) override;
+    void synth_quality(int quality) override;
+    void clear() override;
+    void end_frame(blip_time_t time) override;
+    long read_samples(blip_sample_t* out, long count) override;
+    long samples_avail() const override;
+    void remove_samples(long count);  // Drop the oldest count samples unread
+
+    // Direct wiring for emulators that drive the oscillators themselves
+    Blip_Buffer* tap(int index) { return &taps_[index]; }
+    int tapCount() const { return tap_count_; }
+
+    // Stereo placement of a tap, -1 left to 1 right (any thread). A centred
+    // tap is at full level on both sides, as in the mono mix; turning it
+    // lowers the far side only.
+    void setPan(int index, float pan);
+    float pan(int index) const;
+    // frames of interleaved stereo mixed with the pans, whatever
+    // samples_per_frame; the synthesis is the same as for a mono read, only
+    // the mix of the taps differs. Returns the frames read.
+    long readStereo(blip_sample_t* out, long frames);
+
+    // Record per-tap samples during read_samples (off by default)
+    void setCapture(bool capture) { capture_ = capture; captured_frames_ = 0; }
+
+    // Captured samples since the last call, interleaved tapCount() per frame.
+    // Same thread as read_samples. Frames beyond CAPTURE_FRAMES are dropped.
+    int takeTaps(const short** frames);
+
+    // Sample buffers of every tap, with the read and capture scratch
+    size_t memoryBytes() const;
+
+private:
+    static constexpr int READ_CHUNK = 1024;
+    static constexpr int PAN_UNITY = 1 << 14;  // Gain fixed point
+
+    // Read frames, mixed into out with out_channels per frame: one copies
+    // the sum to every sample of the mono mix, two applies the pans
+    long mix(blip_sample_t* out, long frames, int out_channels, bool stereo);
+
+    Blip_Buffer taps_[MAX_TAPS];
+    Blip_Buffer* tap_ptrs_[MAX_TAPS];  // &taps_[i], for Blip_Buffer::read_samples
+    int tap_count_ = 0;
+    long clock_rate_ = 0;
+    int bass_freq_ = 16;
+    bool capture_ = false;
+
+    std::vector<short> chunk_;     // READ_CHUNK samples per tap
+    std::vector<short> captured_;  // CAPTURE_FRAMES * tap_count_, interleaved
+    int captured_frames_ = 0;
+    std::array<std::atomic<int32_t>, MAX_TAPS> pan_left_;   // PAN_UNITY fixed point
+    std::array<std::atomic<int32_t>, MAX_TAPS> pan_right_;
+
+    blargg_err_t configureTap(Blip_Buffer& tap);
+};
+
+// NSF/NSFE emulator that renders through its own ChannelTapBuffer
+template <class Emu>
+class TappedEmu : public Emu {
+public:
+    TappedEmu() { this->set_buffer(&taps_); }
+    ChannelTapBuffer& taps() { return taps_; }
+
+private:
+    ChannelTapBuffer taps_;
+};
+
+// A music file in memory once. Every emulator for it, the player's and the
+// background ones, is opened from these bytes instead of the disk. Any
+// MappedFile will do, so an archive entry can be wrapped as a view.
+struct MusicFile {
+    std::string path;  // Its extension picks the type when the header does not
+    std::shared_ptr<const MappedFile> image;
+
+    const unsigned char* data() const { return image->data(); }
+    size_t size() const { return image->size(); }
+
+    // Map path; nullptr with *err set if it cannot be read
+    static std::shared_ptr<const MusicFile> read(const char* path, gme_err_t* err);
+};
+
+// The file's type as gme_identify_file() finds it: by extension, then by
+// header; nullptr if gme reads neither
+gme_type_t identify_music_file(const MusicFile& file);
+
+// gme_open_data() for a MusicFile, also identifying types by extension
+gme_err_t open_music_emu(const MusicFile& file, Music_Emu** out, long sample_rate);
+
+// open_music_emu() replacement: NSF and NSFE files get a TappedEmu, other
+// types open normally and report no taps
+gme_err_t open_tapped_emu(const MusicFile& file, Music_Emu** out, long sample_rate, ChannelTapBuffer** taps_out);
+
+// An open emulator's size under MUSIC_EMU and, for a TappedEmu, its taps
+// under BLIP_BUFFERS. Other types' own buffers are not visible from here.
+void report_music_emu_memory(Music_Emu* emu, MemoryReport::Sample& sample);
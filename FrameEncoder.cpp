@@ -0,0 +1,250 @@
+#include "FrameEncoder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+constexpr int MAX_THREADS = 8;
+constexpr int BUFFERS_PER_THREAD = 2;
+
+// CRC-32 as PNG chunks use it
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putBE32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Deflate bits go out least significant first; Huffman codes most
+// significant first, so those are reversed on the way in
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void bits(uint32_t value, int count) {
+        acc_ |= static_cast<uint64_t>(value) << used_;
+        used_ += count;
+        while (used_ >= 8) {
+            out_.push_back(static_cast<uint8_t>(acc_));
+            acc_ >>= 8;
+            used_ -= 8;
+        }
+    }
+
+    void code(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; ++i) reversed |= ((code >> i) & 1) << (length - 1 - i);
+        bits(reversed, length);
+    }
+
+    void flush() {
+        if (used_ > 0) out_.push_back(static_cast<uint8_t>(acc_));
+        acc_ = 0;
+        used_ = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int used_ = 0;
+};
+
+// Fixed Huffman literal/length code (RFC 1951 3.2.6)
+void fixedSymbol(BitWriter& w, int symbol) {
+    if (symbol < 144) w.code(0x30 + symbol, 8);
+    else if (symbol < 256) w.code(0x190 + symbol - 144, 9);
+    else if (symbol < 280) w.code(symbol - 256, 7);
+    else w.code(0xC0 + symbol - 280, 8);
+}
+
+const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// One fixed-Huffman block: literals, and runs of the previous byte as
+// distance-1 matches
+void deflateRuns(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    BitWriter w(out);
+    w.bits(1, 1);  // Final block
+    w.bits(1, 2);  // Fixed codes
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 0;
+        if (i > 0) {
+            while (run < 258 && i + run < size && data[i + run] == data[i - 1]) ++run;
+        }
+        if (run < 3) {
+            fixedSymbol(w, data[i]);
+            ++i;
+            continue;
+        }
+        int code = 28;
+        while (LENGTH_BASE[code] > run) --code;
+        fixedSymbol(w, 257 + code);
+        w.bits(static_cast<uint32_t>(run - LENGTH_BASE[code]), LENGTH_EXTRA[code]);
+        w.code(0, 5);  // Distance code 0: one byte back
+        i += run;
+    }
+    fixedSymbol(w, 256);
+    w.flush();
+}
+
+uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        const size_t n = std::min<size_t>(size, 5552);  // Largest block without overflowing b
+        for (size_t i = 0; i < n; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += n;
+        size -= n;
+    }
+    return (b << 16) | a;
+}
+
+void chunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+    putBE32(png, static_cast<uint32_t>(data.size()));
+    const size_t type_at = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    putBE32(png, crc32(0, png.data() + type_at, png.size() - type_at));
+}
+
+}  // namespace
+
+bool FrameEncoder::writePng(const std::string& path, const uint8_t* rgb, int width, int height) {
+    // Sub filter: flat rows become zeros
+    const size_t row_bytes = static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> filtered((row_bytes + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = rgb + y * row_bytes;
+        uint8_t* out = filtered.data() + y * (row_bytes + 1);
+        out[0] = 1;
+        for (size_t x = 0; x < row_bytes; ++x) out[1 + x] = static_cast<uint8_t>(row[x] - (x >= 3 ? row[x - 3] : 0));
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    deflateRuns(filtered.data(), filtered.size(), zlib);
+    putBE32(zlib, adler32(filtered.data(), filtered.size()));
+
+    std::vector<uint8_t> header;
+    putBE32(header, static_cast<uint32_t>(width));
+    putBE32(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, 2, 0, 0, 0});  // 8-bit RGB, deflate, adaptive filters, no interlace
+
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<uint8_t> png(SIGNATURE, SIGNATURE + 8);
+    chunk(png, "IHDR", header);
+    chunk(png, "IDAT", zlib);
+    chunk(png, "IEND", {});
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool ok = std::fwrite(png.data(), 1, png.size(), f) == png.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+FrameEncoder::~FrameEncoder() {
+    finish();
+}
+
+bool FrameEncoder::start(const std::string& dir, const std::string& stem, Format format, int width, int height,
+                         int threads, std::string* error) {
+    finish();
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec)) {
+        if (error) *error = dir + " is not a folder";
+        return false;
+    }
+    dir_ = dir;
+    stem_ = stem;
+    format_ = format;
+    width_ = width;
+    height_ = height;
+    if (threads <= 0) threads = JobPool::shared().threadCount();
+    threads = std::clamp(threads, 1, MAX_THREADS);
+
+    free_.assign(threads * BUFFERS_PER_THREAD, std::vector<uint8_t>(static_cast<size_t>(width_) * height_ * 3));
+    written_.store(0);
+    failed_.store(0);
+    running_ = true;
+    return true;
+}
+
+void FrameEncoder::finish() {
+    if (!running_) return;
+    JobPool::shared().wait(jobs_);
+    running_ = false;
+    free_.clear();
+}
+
+void FrameEncoder::submit(int index, const void* pixels, int width, int height, int row_pitch, bool bgra) {
+    Job job;
+    job.index = index;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        freed_.wait(lock, [&] { return !free_.empty(); });
+        job.rgb = std::move(free_.back());
+        free_.pop_back();
+    }
+
+    const int r_at = bgra ? 2 : 0;
+    const int b_at = bgra ? 0 : 2;
+    const int copy_width = std::min(width, width_);
+    std::fill(job.rgb.begin(), job.rgb.end(), uint8_t{0});
+    for (int y = 0; y < std::min(height, height_); ++y) {
+        const uint8_t* src = static_cast<const uint8_t*>(pixels) + static_cast<size_t>(y) * row_pitch;
+        uint8_t* dst = job.rgb.data() + static_cast<size_t>(y) * width_ * 3;
+        for (int x = 0; x < copy_width; ++x) {
+            dst[x * 3 + 0] = src[x * 4 + r_at];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + b_at];
+        }
+    }
+
+    JobPool::shared().submit(jobs_, JobPool::Priority::Normal, [this, job = std::move(job)]() mutable { encode(job); });
+}
+
+std::string FrameEncoder::framePath(int index) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "-%06d.%s", index, format_ == Format::PNG ? "png" : "rgb");
+    return (std::filesystem::path(dir_) / (stem_ + name)).string();
+}
+
+void FrameEncoder::encode(Job& job) {
+    const std::string path = framePath(job.index);
+    bool ok = false;
+    if (format_ == Format::PNG) {
+        ok = writePng(path, job.rgb.data(), width_, height_);
+    } else if (FILE* f = std::fopen(path.c_str(), "wb")) {
+        ok = std::fwrite(job.rgb.data(), 1, job.rgb.size(), f) == job.rgb.size();
+        ok = std::fclose(f) == 0 && ok;
+    }
+    (ok ? written_ : failed_).fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(std::move(job.rgb));
+    }
+    freed_.notify_one();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "JobPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Numbered images written as jobs on the shared JobPool: dir/stem-000000.png, or raw
+// RGB24 frames (.rgb) for tools that read them as they are, e.g.
+//
+//   ffmpeg -framerate 60 -i stem-%06d.png -i audio.wav out.mp4
+//   ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -framerate 60 -i ... (cat the .rgb files)
+//
+// submit() converts into one of a fixed set of buffers and queues its job;
+// when every buffer is waiting it blocks until a job frees one, so a fast
+// producer is paced by the disk rather than growing memory. PNGs use a
+// Sub filter and distance-1 runs under fixed Huffman codes: no zlib, and
+// the flat areas visualizations are made of compress well.
+class FrameEncoder {
+public:
+    enum class Format { PNG, RAW };
+
+    FrameEncoder() = default;
+    ~FrameEncoder();
+    FrameEncoder(const FrameEncoder&) = delete;
+    FrameEncoder& operator=(const FrameEncoder&) = delete;
+
+    // Frames of width x height into dir; threads frames encoded at once, 0
+    // for one per pool worker. False with error set if dir is not a directory.
+    bool start(const std::string& dir, const std::string& stem, Format format, int width, int height,
+               int threads, std::string* error);
+    // Write what is queued and wait for the jobs
+    void finish();
+    bool isRunning() const { return running_; }
+
+    // Frame index of 4-byte pixels, cropped or padded with black to the
+    // encoder's size (one producer thread)
+    void submit(int index, const void* pixels, int width, int height, int row_pitch, bool bgra);
+
+    int framesWritten() const { return written_.load(std::memory_order_relaxed); }
+    int framesFailed() const { return failed_.load(std::memory_order_relaxed); }
+
+    // Tightly packed RGB24 rows as an 8-bit RGB PNG
+    static bool writePng(const std::string& path, const uint8_t* rgb, int width, int height);
+
+private:
+    struct Job {
+        int index = 0;
+        std::vector<uint8_t> rgb;
+    };
+
+    void encode(Job& job);
+    std::string framePath(int index) const;
+
+    std::string dir_;
+    std::string stem_;
+    Format format_ = Format::PNG;
+    int width_ = 0;
+    int height_ = 0;
+
+    JobPool::Group jobs_;
+    bool running_ = false;
+    std::mutex mutex_;
+    std::condition_variable freed_;    // submit() waits for free_
+    std::vector<std::vector<uint8_t>> free_;
+
+    std::atomic<int> written_{0};
+    std::atomic<int> failed_{0};
+};
@@ -0,0 +1,232 @@
+#include "FrameProfiler.h"
+#include "Trace.h"
+#include "imgui.h"
+#include "sokol_gfx.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+constexpr const char* SECTION_NAMES[FrameProfiler::SECTION_COUNT] = {
+    "Emulation", "Audio callback", "FFT", "Piano roll", "ImGui build", "Submit",
+};
+constexpr const char* GPU_PASS_NAMES[FrameProfiler::GPU_PASS_COUNT] = {
+    "NES palette", "NES filter", "Main pass", "Piano roll", "Waterfall",
+};
+static_assert(static_cast<int>(FrameProfiler::GPU_PASS_COUNT) <= static_cast<int>(SG_MAX_GPU_TIMERS));
+
+// Draw callbacks, run by simgui_render() inside the main pass
+void beginGpuCallback(const ImDrawList*, const ImDrawCmd* cmd) {
+    sg_begin_gpu_timer(static_cast<int>(reinterpret_cast<intptr_t>(cmd->UserCallbackData)));
+}
+void endGpuCallback(const ImDrawList*, const ImDrawCmd* cmd) {
+    sg_end_gpu_timer(static_cast<int>(reinterpret_cast<intptr_t>(cmd->UserCallbackData)));
+}
+
+}  // namespace
+
+void FrameProfiler::endFrame(const ImDrawData* draw_data) {
+    const Clock::time_point now = Clock::now();
+    for (int s = 0; s < SECTION_COUNT; ++s) {
+        history_[s][history_pos_] = static_cast<float>(totals_[s].exchange(0, std::memory_order_relaxed) * 1e-6);
+    }
+    for (int i = 0; i < MAX_INSTANCES; ++i) {
+        instance_history_[i][history_pos_] =
+            static_cast<float>(instance_totals_[i].exchange(0, std::memory_order_relaxed) * 1e-6);
+    }
+    interval_history_[history_pos_] =
+        last_end_ == Clock::time_point() ? 0.0f : std::chrono::duration<float, std::milli>(now - last_end_).count();
+    last_end_ = now;
+    // The newest frame the GPU has finished, not this one
+    for (int p = 0; p < GPU_PASS_COUNT; ++p) {
+        gpu_history_[p][history_pos_] = static_cast<float>(std::max(sg_query_gpu_timer(p), 0.0));
+    }
+    const double gpu_frame_ms = sg_query_gpu_frame_time();
+    gpu_frame_timed_ = gpu_frame_timed_ || gpu_frame_ms >= 0.0;
+    gpu_frame_history_[history_pos_] = static_cast<float>(std::max(gpu_frame_ms, 0.0));
+    history_pos_ = (history_pos_ + 1) % HISTORY_FRAMES;
+
+    if (!draw_data) return;
+    windows_.resize(static_cast<size_t>(draw_data->CmdListsCount));
+    for (int i = 0; i < draw_data->CmdListsCount; ++i) {
+        const ImDrawList* list = draw_data->CmdLists[i];
+        WindowCounts& counts = windows_[i];
+        counts.name = list->_OwnerName ? list->_OwnerName : "?";
+        counts.vertices = list->VtxBuffer.Size;
+        counts.indices = list->IdxBuffer.Size;
+    }
+}
+
+void FrameProfiler::beginGpu(GpuPass pass) {
+    sg_begin_gpu_timer(pass);
+}
+
+void FrameProfiler::endGpu(GpuPass pass) {
+    sg_end_gpu_timer(pass);
+}
+
+void FrameProfiler::beginGpuDraw(ImDrawList* draw_list, GpuPass pass) {
+    // Each callback costs simgui a state reset, so none where they time nothing
+    if (!sg_gpu_timers_supported()) return;
+    draw_list->AddCallback(beginGpuCallback, reinterpret_cast<void*>(static_cast<intptr_t>(pass)));
+}
+
+void FrameProfiler::endGpuDraw(ImDrawList* draw_list, GpuPass pass) {
+    if (!sg_gpu_timers_supported()) return;
+    draw_list->AddCallback(endGpuCallback, reinterpret_cast<void*>(static_cast<intptr_t>(pass)));
+}
+
+void FrameProfiler::addInputLatency(Clock::time_point input, Clock::time_point presented) {
+#if FC_TRACE
+    const auto ns = [](Clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    };
+    Trace::record("input_to_present", ns(input), ns(presented));
+#endif
+    latency_history_[latency_pos_] = std::chrono::duration<float, std::milli>(presented - input).count();
+    latency_pos_ = (latency_pos_ + 1) % LATENCY_SAMPLES;
+    latency_count_ = std::min(latency_count_ + 1, LATENCY_SAMPLES);
+}
+
+FrameProfiler::Averages FrameProfiler::averages() {
+    Averages averages;
+    for (int s = 0; s < SECTION_COUNT; ++s) {
+        float sum = 0.0f;
+        for (float ms : history_[s]) sum += ms;
+        averages.section_ms[s] = sum / HISTORY_FRAMES;
+    }
+    // Slots not yet filled hold 0
+    float sum = 0.0f;
+    int count = 0;
+    for (float ms : interval_history_) {
+        if (ms <= 0.0f) continue;
+        sum += ms;
+        averages.worst_interval_ms = std::max(averages.worst_interval_ms, ms);
+        ++count;
+    }
+    averages.interval_ms = count ? sum / count : 0.0f;
+
+    auto mean = [](const std::array<float, HISTORY_FRAMES>& values) {
+        float total = 0.0f;
+        for (float ms : values) total += ms;
+        return total / HISTORY_FRAMES;
+    };
+    averages.gpu_frame_ms = mean(gpu_frame_history_);
+    for (int p = 0; p < GPU_PASS_COUNT; ++p) averages.gpu_ms[p] = mean(gpu_history_[p]);
+    return averages;
+}
+
+const char* FrameProfiler::sectionName(Section section) {
+    return SECTION_NAMES[section];
+}
+
+const char* FrameProfiler::gpuPassName(GpuPass pass) {
+    return GPU_PASS_NAMES[pass];
+}
+
+void FrameProfiler::drawWindow(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(380, 560), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Frame Profiler", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    // One row per section: the newest frame's time, the average and worst
+    // over the history, plotted on a shared scale so sections compare
+    float scale = 1.0f;
+    for (const auto& section : history_) scale = std::max(scale, *std::max_element(section.begin(), section.end()));
+    const int newest = (history_pos_ + HISTORY_FRAMES - 1) % HISTORY_FRAMES;
+    auto plot = [&](const char* id, const std::array<float, HISTORY_FRAMES>& values, float max) {
+        float sum = 0.0f;
+        for (float v : values) sum += v;
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%.2f ms  avg %.2f  max %.2f", values[newest], sum / HISTORY_FRAMES,
+                 *std::max_element(values.begin(), values.end()));
+        ImGui::PlotLines(id, values.data(), HISTORY_FRAMES, history_pos_, overlay, 0.0f, max, ImVec2(-1, 40));
+    };
+    for (int s = 0; s < SECTION_COUNT; ++s) {
+        ImGui::TextUnformatted(SECTION_NAMES[s]);
+        ImGui::PushID(s);
+        plot("##section", history_[s], scale);
+        ImGui::PopID();
+    }
+    ImGui::TextUnformatted("Frame interval");
+    plot("##interval", interval_history_, std::max(scale, 34.0f));
+
+    // GPU rows on a scale of their own; the piano roll and waterfall are
+    // shares of the main pass
+    if (gpu_frame_timed_) {
+        float gpu_scale = std::max(1.0f, *std::max_element(gpu_frame_history_.begin(), gpu_frame_history_.end()));
+        ImGui::Spacing();
+        ImGui::TextUnformatted("GPU frame");
+        plot("##gpu_frame", gpu_frame_history_, gpu_scale);
+        if (sg_gpu_timers_supported()) {
+            for (int p = 0; p < GPU_PASS_COUNT; ++p) {
+                ImGui::Text("GPU: %s", GPU_PASS_NAMES[p]);
+                ImGui::PushID(SECTION_COUNT + MAX_INSTANCES + p);
+                plot("##gpu_pass", gpu_history_[p], gpu_scale);
+                ImGui::PopID();
+            }
+        }
+    }
+
+    // Grid instances, scaled among themselves: each is a share of Emulation
+    float instance_scale = 1.0f;
+    for (int i = 0; i < MAX_INSTANCES; ++i) {
+        if (instance_names_[i].empty()) continue;
+        const auto& values = instance_history_[i];
+        instance_scale = std::max(instance_scale, *std::max_element(values.begin(), values.end()));
+    }
+    for (int i = 0; i < MAX_INSTANCES; ++i) {
+        if (instance_names_[i].empty()) continue;
+        ImGui::Text("Instance %d: %s", i + 1, instance_names_[i].c_str());
+        ImGui::PushID(SECTION_COUNT + i);
+        plot("##instance", instance_history_[i], instance_scale);
+        ImGui::PopID();
+    }
+
+    // Emulator input changes, newest last; display scanout comes on top
+    if (latency_count_ > 0) {
+        const int first = latency_count_ < LATENCY_SAMPLES ? 0 : latency_pos_;
+        float sum = 0.0f;
+        float worst = 0.0f;
+        for (int i = 0; i < latency_count_; ++i) {
+            sum += latency_history_[i];
+            worst = std::max(worst, latency_history_[i]);
+        }
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "%.1f ms  avg %.1f  max %.1f",
+                 latency_history_[(latency_pos_ + LATENCY_SAMPLES - 1) % LATENCY_SAMPLES], sum / latency_count_, worst);
+        ImGui::TextUnformatted("Input to present");
+        ImGui::PlotLines("##latency", latency_history_.data(), latency_count_, first, overlay, 0.0f,
+                         std::max(worst, 50.0f), ImVec2(-1, 40));
+    }
+
+    // Draw lists of the previous frame, biggest first
+    ImGui::Spacing();
+    ImGui::Text("Draw lists");
+    ImGui::Separator();
+    std::vector<WindowCounts> windows = windows_;
+    std::sort(windows.begin(), windows.end(),
+              [](const WindowCounts& a, const WindowCounts& b) { return a.vertices > b.vertices; });
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("##draw_lists", 3, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Window");
+        ImGui::TableSetupColumn("Vertices", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+        ImGui::TableSetupColumn("Indices", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+        ImGui::TableHeadersRow();
+        for (const WindowCounts& counts : windows) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(counts.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", counts.vertices);
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", counts.indices);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
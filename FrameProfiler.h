@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ImDrawData;
+struct ImDrawList;
+
+// CPU time per UI frame of the app's main stages, to see which one blows the
+// frame budget on a given machine. Any thread adds the time it spent in a
+// section to the open frame's total with one relaxed atomic add; the UI
+// thread closes each frame into a rolling history, along with the vertex
+// and index counts of every window's draw list. Sections may nest: the
+// ImGui build includes the FFT and the piano roll, which run inside it.
+//
+// GPU time comes from sokol_gfx's timestamps, read back a frame or two late
+// without waiting: the whole frame (Vulkan and Metal), and on Vulkan each
+// offscreen pass, the main pass and the views drawn inside it, bracketed by
+// ImGui draw callbacks.
+class FrameProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Section {
+        EMULATION,       // NES frames and gme_play, on their own threads
+        AUDIO_CALLBACK,  // Device callback, audio thread
+        FFT,             // Spectrum analysis
+        PIANO_ROLL,      // Piano roll note culling and drawing
+        IMGUI_BUILD,     // frame() from new frame to render
+        SUBMIT,          // ImGui render, sokol pass and commit
+        SECTION_COUNT
+    };
+
+    enum GpuPass {
+        GPU_NES_PALETTE,  // NES frame's palette lookup pass
+        GPU_NES_FILTER,   // CRT or xBR scaling pass
+        GPU_MAIN_PASS,    // Swapchain pass, all of ImGui
+        GPU_PIANO_ROLL,   // Piano roll draws, inside the main pass
+        GPU_WATERFALL,    // Spectrogram draw, inside the main pass
+        GPU_PASS_COUNT
+    };
+
+    static constexpr int HISTORY_FRAMES = 240;
+    static constexpr int LATENCY_SAMPLES = 120;
+    static constexpr int MAX_INSTANCES = 9;  // MultiView cells
+
+    // Adds its lifetime to a section
+    class Scope {
+    public:
+        explicit Scope(Section section) : section_(section), start_(Clock::now()) {}
+        ~Scope() { add(section_, Clock::now() - start_); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Section section_;
+        Clock::time_point start_;
+    };
+
+    // Any thread
+    static void add(Section section, Clock::duration time) {
+        totals_[section].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(),
+                                   std::memory_order_relaxed);
+    }
+
+    // Time one emulator instance of the grid (MultiView) spent, from any
+    // thread, shown on a row of its own while it has a name (UI thread;
+    // empty hides the row)
+    static void addInstance(int index, Clock::duration time) {
+        instance_totals_[index].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(),
+                                          std::memory_order_relaxed);
+    }
+    static void setInstanceName(int index, const std::string& name) { instance_names_[index] = name; }
+
+    // Render thread: time the commands recorded from begin to end, once a
+    // frame; nothing where the backend has no timestamps
+    static void beginGpu(GpuPass pass);
+    static void endGpu(GpuPass pass);
+    // UI thread: the same, around what draw_list draws in between, for
+    // views inside the main pass
+    static void beginGpuDraw(ImDrawList* draw_list, GpuPass pass);
+    static void endGpuDraw(ImDrawList* draw_list, GpuPass pass);
+
+    // UI thread, after the frame was submitted: close the frame. draw_data
+    // (ImGui::GetDrawData()) gives the per-window counts; null to skip them.
+    static void endFrame(const ImDrawData* draw_data);
+
+    // UI thread: an input change was presented, in the first frame to show
+    // it. Kept for the window's latency row, and with FC_TRACE recorded as
+    // an "input_to_present" zone.
+    static void addInputLatency(Clock::time_point input, Clock::time_point presented);
+
+    // UI thread: each section's time per frame and the frame interval,
+    // averaged over the history, for TelemetryExport
+    struct Averages {
+        std::array<float, SECTION_COUNT> section_ms{};
+        float interval_ms = 0.0f;
+        float worst_interval_ms = 0.0f;
+        float gpu_frame_ms = 0.0f;  // 0 where the GPU is not timed
+        std::array<float, GPU_PASS_COUNT> gpu_ms{};
+    };
+    static Averages averages();
+    static const char* sectionName(Section section);
+    static const char* gpuPassName(GpuPass pass);
+
+    // Draw the "Frame Profiler" window
+    static void drawWindow(bool* p_open);
+
+private:
+    struct WindowCounts {
+        std::string name;
+        int vertices = 0;
+        int indices = 0;
+    };
+
+    static inline std::array<std::atomic<int64_t>, SECTION_COUNT> totals_{};
+    static inline std::array<std::atomic<int64_t>, MAX_INSTANCES> instance_totals_{};
+
+    // UI thread only
+    static inline std::array<std::array<float, HISTORY_FRAMES>, SECTION_COUNT> history_{};  // ms
+    static inline std::array<float, HISTORY_FRAMES> interval_history_{};                  // ms between frames
+    static inline std::array<std::array<float, HISTORY_FRAMES>, GPU_PASS_COUNT> gpu_history_{};  // ms, 0 if untimed
+    static inline std::array<float, HISTORY_FRAMES> gpu_frame_history_{};                        // ms, 0 if untimed
+    static inline bool gpu_frame_timed_ = false;  // The backend has given a frame time
+    static inline std::array<std::array<float, HISTORY_FRAMES>, MAX_INSTANCES> instance_history_{};  // ms
+    static inline std::array<std::string, MAX_INSTANCES> instance_names_;
+    static inline int history_pos_ = 0;
+    static inline Clock::time_point last_end_{};
+    static inline std::array<float, LATENCY_SAMPLES> latency_history_{};  // ms, one per input change
+    static inline int latency_pos_ = 0;
+    static inline int latency_count_ = 0;
+    static inline std::vector<WindowCounts> windows_;
+};
@@ -0,0 +1,185 @@
+#include "GoldenCheck.h"
+#include "ChannelProbe.h"
+#include "ChannelTaps.h"
+#include "NesFarm.h"
+#include "PianoVisualizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+constexpr int RENDER_CHUNK = 2048;  // Samples per gme_play call, as the render thread
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t hashValue(const T& value, uint64_t hash) {
+    return hashBytes(&value, sizeof(value), hash);
+}
+
+void runNsf(const GoldenCheck::Case& c, GoldenCheck::Digest& digest) {
+    gme_err_t err = nullptr;
+    std::shared_ptr<const MusicFile> file = MusicFile::read(c.path.c_str(), &err);
+    Music_Emu* emu = nullptr;
+    if (file) err = open_music_emu(*file, &emu, GoldenCheck::SAMPLE_RATE);
+    if (!err && emu) err = gme_start_track(emu, c.track);
+    if (err || !emu) {
+        digest.error = err ? err : "could not open " + c.path;
+        gme_delete(emu);
+        return;
+    }
+
+    // The player's output: interleaved stereo from gme_play
+    const long total = static_cast<long>(c.seconds * GoldenCheck::SAMPLE_RATE) * 2;
+    std::vector<short> pcm(RENDER_CHUNK);
+    digest.audio = FNV_OFFSET;
+    while (digest.audio_samples < total) {
+        const int count = static_cast<int>(std::min<long>(RENDER_CHUNK, total - digest.audio_samples));
+        if ((err = gme_play(emu, count, pcm.data()))) break;
+        digest.audio = hashBytes(pcm.data(), count * sizeof(short), digest.audio);
+        digest.audio_samples += count;
+    }
+
+    // The piano's notes over the same stretch, sampled as the player does
+    const ChannelProbe probe = ChannelProbe::resolve(emu);
+    const ChannelTable layout = ChannelTable::forProbe(probe);
+    const long max_ms = static_cast<long>(c.seconds * 1000.0);
+    PianoVisualizer piano;
+    const bool notes_ok = !err && piano.preprocessTrack(
+        emu, c.track, GoldenCheck::SAMPLE_RATE, layout,
+        [&probe](Music_Emu*, ChannelTable& table) { table.sample(probe); },
+        probe.playInterval(), nullptr, [max_ms](Music_Emu* e) { return gme_tell(e) < max_ms; });
+    gme_delete(emu);
+    if (err || !notes_ok) {
+        digest.error = err ? err : "preprocessing failed";
+        return;
+    }
+    const PreprocessedTrack track = piano.takePreprocessedData();
+    digest.notes = FNV_OFFSET;
+    for (const PianoRollNote& note : track.notes) {
+        digest.notes = hashValue(note.channel, digest.notes);
+        digest.notes = hashValue(note.midi_note, digest.notes);
+        digest.notes = hashValue(note.velocity, digest.notes);
+        digest.notes = hashValue(note.start, digest.notes);
+        digest.notes = hashValue(note.end, digest.notes);
+    }
+    digest.note_count = static_cast<int>(track.notes.size());
+    digest.ok = true;
+}
+
+void runRom(const GoldenCheck::Case& c, GoldenCheck::Digest& digest) {
+    NesFarm::Job job;
+    job.rom = c.path;
+    job.script = c.script;
+    job.frames = c.frames;
+    const NesFarm::Result result = NesFarm::runJob(job);
+    if (!result.ok) {
+        digest.error = result.error;
+        return;
+    }
+    digest.screen = hashBytes(result.frame_hashes.data(), result.frame_hashes.size() * sizeof(uint64_t),
+                              FNV_OFFSET);
+    digest.audio = result.audio_hash;
+    digest.audio_samples = result.audio_samples;
+    digest.ok = true;
+}
+
+}  // namespace
+
+std::string GoldenCheck::Case::key() const {
+    char numbers[64];
+    if (kind == NSF) {
+        std::snprintf(numbers, sizeof(numbers), " %d %g", track, seconds);
+        return "nsf " + path + numbers;
+    }
+    std::snprintf(numbers, sizeof(numbers), " %d", frames);
+    return "rom " + path + " " + (script.empty() ? "-" : script) + numbers;
+}
+
+std::string GoldenCheck::Digest::text() const {
+    char buffer[160];
+    std::snprintf(buffer, sizeof(buffer), "audio %016" PRIx64 " %ld screen %016" PRIx64 " notes %016" PRIx64 " %d",
+                  audio, audio_samples, screen, notes, note_count);
+    return buffer;
+}
+
+bool GoldenCheck::readCases(const std::string& path, std::vector<Case>* cases, std::string* error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        *error = "could not read " + path;
+        return false;
+    }
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string kind;
+        Case c;
+        if (!(words >> kind)) continue;
+        bool ok = static_cast<bool>(words >> c.path);
+        std::string word;
+        if (ok && kind == "nsf") {
+            c.kind = Case::NSF;
+            if (words >> word) ok = (c.track = std::atoi(word.c_str())) >= 0;
+            if (ok && words >> word) ok = (c.seconds = std::atof(word.c_str())) > 0;
+        } else if (ok && kind == "rom") {
+            c.kind = Case::ROM;
+            if (words >> word && word != "-") c.script = word;
+            if (words >> word) ok = (c.frames = std::atoi(word.c_str())) > 0;
+        } else {
+            ok = false;
+        }
+        if (!ok || words >> word) {
+            *error = path + ":" + std::to_string(line_no) + ": expected \"nsf <file> [track] [seconds]\" or "
+                     "\"rom <file> [script|-] [frames]\"";
+            return false;
+        }
+        cases->push_back(c);
+    }
+    return true;
+}
+
+GoldenCheck::Digest GoldenCheck::runCase(const Case& c) {
+    Digest digest;
+    if (c.kind == Case::NSF) {
+        runNsf(c, digest);
+    } else {
+        runRom(c, digest);
+    }
+    return digest;
+}
+
+std::vector<GoldenCheck::Digest> GoldenCheck::run(const std::vector<Case>& cases, int threads) {
+    std::vector<Digest> digests(cases.size());
+    if (threads <= 0) threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = static_cast<int>(std::min<size_t>(static_cast<size_t>(threads), std::max<size_t>(cases.size(), 1)));
+
+    // Each worker takes the next case not yet taken, as in NesFarm
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next.fetch_add(1); i < cases.size(); i = next.fetch_add(1)) {
+            digests[i] = runCase(cases[i]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers) worker.join();
+    return digests;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Fixed renders of NSF tracks and ROMs whose output must not change, for
+// checking that an optimization is exact. A case's digest is an FNV-1a hash
+// of what it produced: the player's 16-bit stereo for an NSF track, with the
+// piano's notes for the same stretch; every frame's palette indices and the
+// audio for a ROM run with an input movie (NesFarm's run). Digests are
+// recorded once into a goldens file and later builds are checked against it.
+class GoldenCheck {
+public:
+    struct Case {
+        enum Kind { NSF, ROM } kind = NSF;
+        std::string path;
+        int track = 0;        // NSF, from 0
+        double seconds = 30;  // NSF
+        std::string script;   // ROM: InputScript path, empty for no input
+        int frames = 3600;    // ROM
+
+        // "nsf <file> <track> <seconds>" or "rom <file> <script|-> <frames>",
+        // as the cases file and the goldens file name a case
+        std::string key() const;
+    };
+
+    struct Digest {
+        bool ok = false;
+        std::string error;
+        uint64_t audio = 0;
+        long audio_samples = 0;
+        uint64_t screen = 0;  // ROM
+        uint64_t notes = 0;   // NSF
+        int note_count = 0;   // NSF
+
+        // "audio <hash> <samples> screen <hash> notes <hash> <count>"
+        std::string text() const;
+    };
+
+    static constexpr long SAMPLE_RATE = 44100;
+
+    // Cases, one per line: "nsf <file> [track] [seconds]" or
+    // "rom <file> [script|-] [frames]"; # starts a comment. False with *error
+    // set for a line that does not parse.
+    static bool readCases(const std::string& path, std::vector<Case>* cases, std::string* error);
+
+    // Digest of every case on a pool of threads (0: one per hardware
+    // thread), in case order
+    static std::vector<Digest> run(const std::vector<Case>& cases, int threads);
+    static Digest runCase(const Case& c);
+};
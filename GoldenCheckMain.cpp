@@ -0,0 +1,108 @@
+// Golden-output check: renders a fixed list of NSF tracks and ROM runs and
+// records their digests, or compares them with digests recorded before, so
+// a change that should not alter output (a faster FFT, SIMD in Blip_Buffer,
+// a PPU fast path) can be checked exactly.
+//
+//   fc_golden <cases.txt> --record <goldens.txt> [--threads N]
+//   fc_golden <cases.txt> --check <goldens.txt> [--threads N]
+//
+// Cases are as GoldenCheck::readCases() reads them, e.g.
+//
+//   nsf music/smb.nsf 0 60
+//   rom roms/smb.nes movies/smb-1-1.txt 3600
+//
+// The goldens file has one "<case>\t<digest>" line per case. --check prints
+// every case that differs or has no golden and exits 1 if there is one.
+
+#include "GoldenCheck.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    const char* cases_path = nullptr;
+    const char* record_path = nullptr;
+    const char* check_path = nullptr;
+    int threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+            check_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && !cases_path) {
+            cases_path = argv[i];
+        } else {
+            cases_path = nullptr;
+            break;
+        }
+    }
+    if (!cases_path || !record_path == !check_path || threads < 0) {
+        std::fprintf(stderr, "usage: %s <cases.txt> (--record | --check) <goldens.txt> [--threads N]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<GoldenCheck::Case> cases;
+    std::string error;
+    if (!GoldenCheck::readCases(cases_path, &cases, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::map<std::string, std::string> goldens;
+    if (check_path) {
+        std::ifstream in(check_path);
+        if (!in.is_open()) {
+            std::fprintf(stderr, "could not read %s\n", check_path);
+            return 1;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            const size_t tab = line.find('\t');
+            if (tab != std::string::npos) goldens[line.substr(0, tab)] = line.substr(tab + 1);
+        }
+    }
+
+    const std::vector<GoldenCheck::Digest> digests = GoldenCheck::run(cases, threads);
+
+    int failed = 0;
+    FILE* out = nullptr;
+    if (record_path && !(out = std::fopen(record_path, "w"))) {
+        std::fprintf(stderr, "could not write %s\n", record_path);
+        return 1;
+    }
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const std::string key = cases[i].key();
+        const GoldenCheck::Digest& digest = digests[i];
+        if (!digest.ok) {
+            std::printf("FAILED   %s: %s\n", key.c_str(), digest.error.c_str());
+            ++failed;
+            continue;
+        }
+        const std::string text = digest.text();
+        if (out) {
+            std::fprintf(out, "%s\t%s\n", key.c_str(), text.c_str());
+            continue;
+        }
+        const auto golden = goldens.find(key);
+        if (golden == goldens.end()) {
+            std::printf("NO GOLDEN %s\n          got  %s\n", key.c_str(), text.c_str());
+            ++failed;
+        } else if (golden->second != text) {
+            std::printf("CHANGED  %s\n          want %s\n          got  %s\n", key.c_str(), golden->second.c_str(),
+                        text.c_str());
+            ++failed;
+        }
+    }
+    if (out && std::fclose(out) != 0) {
+        std::fprintf(stderr, "could not write %s\n", record_path);
+        return 1;
+    }
+    std::printf("%zu cases, %d %s\n", cases.size(), failed, record_path ? "failed" : "differ or failed");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+#include "InputMovie.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+constexpr char MOVIE_MAGIC[4] = {'F', 'C', 'M', 'V'};
+constexpr uint16_t MOVIE_VERSION = 1;
+
+struct MovieHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t frames;
+    uint32_t runs;      // Records that follow
+    uint64_t rom_hash;
+};
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+void putVarLen(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// false past end or beyond 32 bits
+bool getVarLen(const uint8_t*& in, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 32; shift += 7) {
+        const uint8_t byte = *in++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+bool fail(std::string* error, const std::string& message) {
+    if (error) *error = message;
+    return false;
+}
+
+}  // namespace
+
+uint8_t InputMovie::pack(const agnes_input_t& input) {
+    return static_cast<uint8_t>(input.a << 0 | input.b << 1 | input.select << 2 | input.start << 3 |
+                                input.up << 4 | input.down << 5 | input.left << 6 | input.right << 7);
+}
+
+agnes_input_t InputMovie::unpack(uint8_t bits) {
+    agnes_input_t input;
+    input.a = bits & 0x01;
+    input.b = bits & 0x02;
+    input.select = bits & 0x04;
+    input.start = bits & 0x08;
+    input.up = bits & 0x10;
+    input.down = bits & 0x20;
+    input.left = bits & 0x40;
+    input.right = bits & 0x80;
+    return input;
+}
+
+uint64_t InputMovie::hashRom(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ bytes[i]) * FNV_PRIME;
+    return hash;
+}
+
+void InputMovie::clear() {
+    runs_.clear();
+    frames_ = 0;
+}
+
+void InputMovie::append(const agnes_input_t& player1, const agnes_input_t& player2) {
+    const uint8_t input[2] = {pack(player1), pack(player2)};
+    if (runs_.empty() || std::memcmp(runs_.back().input, input, sizeof(input)) != 0) {
+        runs_.push_back({frames_, {input[0], input[1]}});
+    }
+    ++frames_;
+}
+
+agnes_input_t InputMovie::at(int frame, int player) const {
+    auto next = std::upper_bound(runs_.begin(), runs_.end(), frame,
+                                 [](int f, const Run& run) { return f < run.start; });
+    if (next == runs_.begin()) return agnes_input_t{};
+    return unpack(std::prev(next)->input[player & 1]);
+}
+
+bool InputMovie::save(const char* path, std::string* error) const {
+    MovieHeader header = {};
+    std::memcpy(header.magic, MOVIE_MAGIC, sizeof(header.magic));
+    header.version = MOVIE_VERSION;
+    header.frames = static_cast<uint32_t>(frames_);
+    header.runs = static_cast<uint32_t>(runs_.size());
+    header.rom_hash = rom_hash_;
+
+    std::vector<uint8_t> out(sizeof(header));
+    std::memcpy(out.data(), &header, sizeof(header));
+    for (size_t i = 0; i < runs_.size(); ++i) {
+        const int end = i + 1 < runs_.size() ? runs_[i + 1].start : frames_;
+        putVarLen(out, static_cast<uint32_t>(end - runs_[i].start));
+        out.push_back(runs_[i].input[0]);
+        out.push_back(runs_[i].input[1]);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open() || !file.write(reinterpret_cast<const char*>(out.data()), out.size())) {
+        return fail(error, std::string("could not write movie ") + path);
+    }
+    return true;
+}
+
+bool InputMovie::load(const char* path, std::string* error) {
+    clear();
+    rom_hash_ = 0;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return fail(error, std::string("could not read movie ") + path);
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    MovieHeader header;
+    if (bytes.size() < sizeof(header)) return fail(error, std::string(path) + ": not a movie");
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, MOVIE_MAGIC, sizeof(header.magic)) != 0) {
+        return fail(error, std::string(path) + ": not a movie");
+    }
+    if (header.version != MOVIE_VERSION) {
+        return fail(error, std::string(path) + ": movie version " + std::to_string(header.version));
+    }
+    if (header.frames > static_cast<uint32_t>(INT32_MAX)) {
+        return fail(error, std::string(path) + ": movie is cut short or corrupt");
+    }
+
+    const uint8_t* in = bytes.data() + sizeof(header);
+    const uint8_t* end = bytes.data() + bytes.size();
+    runs_.reserve(std::min<size_t>(header.runs, bytes.size() / 3));
+    for (uint32_t i = 0; i < header.runs; ++i) {
+        uint32_t length = 0;
+        if (!getVarLen(in, end, length) || end - in < 2 || length == 0 ||
+            length > header.frames - static_cast<uint32_t>(frames_)) {
+            clear();
+            return fail(error, std::string(path) + ": movie is cut short or corrupt");
+        }
+        runs_.push_back({frames_, {in[0], in[1]}});
+        in += 2;
+        frames_ += static_cast<int>(length);
+    }
+    if (static_cast<uint32_t>(frames_) != header.frames) {
+        clear();
+        return fail(error, std::string(path) + ": movie is cut short or corrupt");
+    }
+    rom_hash_ = header.rom_hash;
+    return true;
+}
+
+bool InputMovie::isMovie(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(MOVIE_MAGIC)] = {};
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, MOVIE_MAGIC, sizeof(magic)) == 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "agnes/agnes.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Both controllers' input for every frame since power-on, recorded from a
+// run and played back frame for frame: from the same ROM the same movie
+// gives the same frames and audio, so it doubles as a benchmark workload
+// and a regression case. Frames are kept as runs of unchanged input, and a
+// file is a header (magic, the frame count and an FNV-1a hash of the ROM it
+// was recorded on) followed by each run as a variable-length frame count and
+// one byte per controller.
+class InputMovie {
+public:
+    struct Run {
+        int start;          // First frame
+        uint8_t input[2];   // pack() of each controller
+    };
+
+    // A in bit 0 through B, Select, Start, Up, Down, Left and Right in bit 7,
+    // the order the controller shifts them out in
+    static uint8_t pack(const agnes_input_t& input);
+    static agnes_input_t unpack(uint8_t bits);
+
+    static uint64_t hashRom(const void* data, size_t size);
+
+    void clear();
+    // The next frame's input
+    void append(const agnes_input_t& player1, const agnes_input_t& player2);
+
+    int frames() const { return frames_; }
+    bool empty() const { return frames_ == 0; }
+    const std::vector<Run>& runs() const { return runs_; }
+    // A frame's input for player 0 or 1; past the end, the last frame's
+    agnes_input_t at(int frame, int player) const;
+
+    // 0 when unknown
+    uint64_t romHash() const { return rom_hash_; }
+    void setRomHash(uint64_t hash) { rom_hash_ = hash; }
+
+    // false, with *error set if given, when the file cannot be written or
+    // read, or is not a movie
+    bool save(const char* path, std::string* error = nullptr) const;
+    bool load(const char* path, std::string* error = nullptr);
+    // Whether path starts as a movie file does
+    static bool isMovie(const char* path);
+
+private:
+    std::vector<Run> runs_;  // By start frame
+    int frames_ = 0;
+    uint64_t rom_hash_ = 0;
+};
@@ -0,0 +1,64 @@
+#include "InputScript.h"
+#include "InputMovie.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+bool InputScript::load(const char* path, std::string* error) {
+    changes_.clear();
+    if (InputMovie::isMovie(path)) {
+        InputMovie movie;
+        if (!movie.load(path, error)) return false;
+        for (const InputMovie::Run& run : movie.runs()) {
+            changes_.push_back({run.start, {InputMovie::unpack(run.input[0]), InputMovie::unpack(run.input[1])}});
+        }
+        return true;
+    }
+    
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        if (error) *error = std::string("could not read input script ") + path;
+        return false;
+    }
+
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        Change change = {};
+        if (!(words >> change.frame)) continue;
+
+        std::string button;
+        agnes_input_t* input = &change.input[0];
+        while (words >> button) {
+            if (button == "p2") input = &change.input[1];
+            else if (button == "a") input->a = true;
+            else if (button == "b") input->b = true;
+            else if (button == "select") input->select = true;
+            else if (button == "start") input->start = true;
+            else if (button == "up") input->up = true;
+            else if (button == "down") input->down = true;
+            else if (button == "left") input->left = true;
+            else if (button == "right") input->right = true;
+            else {
+                if (error) *error = std::string(path) + ":" + std::to_string(line_no) + ": unknown button '" + button + "'";
+                changes_.clear();
+                return false;
+            }
+        }
+        changes_.push_back(change);
+    }
+    // Scripts are written in order; a later line for the same frame wins
+    std::stable_sort(changes_.begin(), changes_.end(),
+                     [](const Change& a, const Change& b) { return a.frame < b.frame; });
+    return true;
+}
+
+agnes_input_t InputScript::at(int frame, int player) const {
+    auto next = std::upper_bound(changes_.begin(), changes_.end(), frame,
+                                 [](int f, const Change& change) { return f < change.frame; });
+    if (next == changes_.begin()) return agnes_input_t{};
+    return std::prev(next)->input[player & 1];
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "agnes/agnes.h"
+#include <string>
+#include <vector>
+
+// Scripted controller input (an input movie) for headless runs. A script
+// has one "<frame> [buttons...]" line per change of input, held from that
+// frame on; buttons are a b select start up down left right, those after
+// p2 are player 2's, and # starts a comment. A recorded InputMovie file
+// loads as well.
+class InputScript {
+public:
+    // false, with the file and line in *error, if path cannot be read or
+    // names an unknown button, or is a movie that does not load
+    bool load(const char* path, std::string* error = nullptr);
+
+    bool empty() const { return changes_.empty(); }
+    // Input held at frame for player 0 or 1: the last change at or before it
+    agnes_input_t at(int frame, int player = 0) const;
+
+private:
+    struct Change {
+        int frame;
+        agnes_input_t input[2];
+    };
+    std::vector<Change> changes_;  // In frame order
+};
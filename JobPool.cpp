@@ -0,0 +1,206 @@
+#include "JobPool.h"
+#include <algorithm>
+
+namespace {
+
+// Threads the app runs besides the pool: the audio render and the NES emulation
+constexpr int RESERVED_THREADS = 2;
+
+// The pool a thread works for, and its index there
+thread_local JobPool* t_pool = nullptr;
+thread_local int t_worker = -1;
+
+}  // namespace
+
+int JobPool::defaultThreadCount() {
+    const int cores = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, cores - RESERVED_THREADS);
+}
+
+JobPool& JobPool::shared() {
+    // Never destroyed: owners in static storage may still cancel and wait at exit
+    static JobPool* pool = new JobPool(defaultThreadCount());
+    return *pool;
+}
+
+JobPool::JobPool(int threads) {
+    threads = std::max(1, threads);
+    background_limit_ = threads > 1 ? threads - 1 : 1;
+    for (int i = 0; i < threads; ++i) workers_.push_back(std::make_unique<Worker>());
+    for (int i = 0; i < threads; ++i) workers_[i]->thread = std::thread(&JobPool::workerLoop, this, i);
+}
+
+JobPool::~JobPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) worker->thread.join();
+}
+
+void JobPool::submit(Group& group, Priority priority, std::function<void()> job) {
+    if (!group.busy()) group.cancelled_.store(false, std::memory_order_relaxed);
+    group.pending_.fetch_add(1, std::memory_order_relaxed);
+    group.queued_.fetch_add(1, std::memory_order_relaxed);
+
+    // A worker's own jobs stay with it until stolen
+    const int p = static_cast<int>(priority);
+    const int n = static_cast<int>(workers_.size());
+    const int index = t_pool == this ? t_worker : static_cast<int>(next_worker_.fetch_add(1) % n);
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+        workers_[index]->queues[p].push_back({std::move(job), &group});
+    }
+    queued_[p].fetch_add(1, std::memory_order_release);
+
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    wake_.notify_one();
+    done_.notify_all();
+}
+
+void JobPool::cancel(Group& group) {
+    group.cancelled_.store(true, std::memory_order_relaxed);
+
+    std::vector<Task> dropped;
+    for (auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        for (int p = 0; p < PRIORITIES; ++p) {
+            std::deque<Task>& queue = worker->queues[p];
+            auto end = std::stable_partition(queue.begin(), queue.end(),
+                                             [&](const Task& task) { return task.group != &group; });
+            for (auto it = end; it != queue.end(); ++it) dropped.push_back(std::move(*it));
+            queued_[p].fetch_sub(static_cast<int>(queue.end() - end), std::memory_order_relaxed);
+            queue.erase(end, queue.end());
+        }
+    }
+    group.queued_.fetch_sub(static_cast<int>(dropped.size()), std::memory_order_relaxed);
+
+    // Their captures go before the group may be seen idle
+    for (Task& task : dropped) {
+        task.run = nullptr;
+        finish(group);
+    }
+}
+
+void JobPool::wait(Group& group) {
+    const bool on_worker = t_pool == this;
+    for (;;) {
+        if (!group.busy()) return;
+        Task task;
+        if (on_worker && takeFromGroup(group, task)) {
+            execute(task, false);  // In the caller's place: already counted
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        done_.wait(lock, [&] {
+            return !group.busy() || (on_worker && group.queued_.load(std::memory_order_acquire) > 0);
+        });
+    }
+}
+
+void JobPool::parallel(Priority priority, int copies, const std::function<void()>& work) {
+    Group group;
+    for (int i = 1; i < copies; ++i) submit(group, priority, [&work]() { work(); });
+    work();
+    wait(group);
+}
+
+bool JobPool::runnable() const {
+    if (queued_[0].load(std::memory_order_acquire) > 0) return true;
+    if (background_running_.load(std::memory_order_acquire) >= background_limit_) return false;
+    for (int p = 1; p < PRIORITIES; ++p) {
+        if (queued_[p].load(std::memory_order_acquire) > 0) return true;
+    }
+    return false;
+}
+
+int JobPool::take(int self, Task& task) {
+    const int n = static_cast<int>(workers_.size());
+    for (int p = 0; p < PRIORITIES; ++p) {
+        if (queued_[p].load(std::memory_order_acquire) <= 0) continue;
+
+        // A slot for Normal and Low first, so they never hold every worker
+        const bool background = p > 0;
+        if (background && background_running_.fetch_add(1, std::memory_order_acq_rel) >= background_limit_) {
+            background_running_.fetch_sub(1, std::memory_order_acq_rel);
+            return -1;
+        }
+
+        for (int k = 0; k < n; ++k) {
+            Worker& worker = *workers_[(self + k) % n];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            std::deque<Task>& queue = worker.queues[p];
+            if (queue.empty()) continue;
+            if (k == 0) {
+                task = std::move(queue.back());
+                queue.pop_back();
+            } else {
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            queued_[p].fetch_sub(1, std::memory_order_relaxed);
+            task.group->queued_.fetch_sub(1, std::memory_order_relaxed);
+            return p;
+        }
+        if (background) background_running_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    return -1;
+}
+
+bool JobPool::takeFromGroup(Group& group, Task& task) {
+    if (group.queued_.load(std::memory_order_acquire) <= 0) return false;
+    for (auto& worker : workers_) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        for (int p = 0; p < PRIORITIES; ++p) {
+            std::deque<Task>& queue = worker->queues[p];
+            auto it = std::find_if(queue.begin(), queue.end(), [&](const Task& t) { return t.group == &group; });
+            if (it == queue.end()) continue;
+            task = std::move(*it);
+            queue.erase(it);
+            queued_[p].fetch_sub(1, std::memory_order_relaxed);
+            group.queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobPool::execute(Task& task, bool background) {
+    Group& group = *task.group;
+    {
+        std::function<void()> run = std::move(task.run);
+        if (!group.cancelled()) run();
+    }
+    if (background) {
+        background_running_.fetch_sub(1, std::memory_order_acq_rel);
+        // A held-back Normal or Low job may go now
+        { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+        wake_.notify_one();
+    }
+    finish(group);
+}
+
+void JobPool::finish(Group& group) {
+    // The owner may free group as soon as it is idle: nothing after this touches it
+    if (group.pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        done_.notify_all();
+    }
+}
+
+void JobPool::workerLoop(int index) {
+    t_pool = this;
+    t_worker = index;
+    for (;;) {
+        Task task;
+        const int priority = take(index, task);
+        if (priority >= 0) {
+            execute(task, priority > 0);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [&] { return quit_ || runnable(); });
+        if (quit_ && !runnable()) return;
+    }
+}
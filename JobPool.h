@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The background threads: every job that is not the audio, render or NES
+// thread runs here (preprocessing, file loads, library scans, exports,
+// lookahead forks, frame encoding, save-slot I/O), so their threads never
+// outnumber the cores. Each worker keeps a deque per priority; jobs it
+// submits go to its own, others' go round the workers, and an idle worker
+// steals the oldest job of the highest priority anywhere. One worker is
+// kept for High jobs while the others run Normal and Low ones, so a file
+// load never waits behind a batch of tracks.
+//
+// Jobs belong to a Group, which they are waited for and cancelled by. A
+// cancelled group's queued jobs are dropped at once; the running ones see
+// cancelled() and return early. wait() on a worker runs the group's queued
+// jobs itself, so a job can fan out and wait without holding a worker idle.
+class JobPool {
+public:
+    enum class Priority { High, Normal, Low };
+    static constexpr int PRIORITIES = 3;
+
+    class Group {
+    public:
+        Group() = default;
+        Group(const Group&) = delete;
+        Group& operator=(const Group&) = delete;
+
+        bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+        // Jobs submitted and not yet done (or dropped)
+        bool busy() const { return pending_.load(std::memory_order_acquire) > 0; }
+
+    private:
+        friend class JobPool;
+        std::atomic<int> pending_{0};
+        std::atomic<int> queued_{0};  // Of pending_, not started yet
+        std::atomic<bool> cancelled_{false};
+    };
+
+    // The hardware threads less the audio and render ones, at least one
+    static int defaultThreadCount();
+    // The process's pool of defaultThreadCount() workers, started on first use
+    static JobPool& shared();
+
+    explicit JobPool(int threads);
+    ~JobPool();  // Runs what is queued, then joins the workers
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    int threadCount() const { return static_cast<int>(workers_.size()); }
+
+    // Queue job under group, whose cancel flag it is cleared of if idle
+    void submit(Group& group, Priority priority, std::function<void()> job);
+    // Drop group's queued jobs and flag the running ones
+    void cancel(Group& group);
+    // Until group has no job left; on a worker, runs its queued ones meanwhile
+    void wait(Group& group);
+    // copies of work at once, one on the calling thread, and wait for them
+    // all: NesFarm's worker loop on the pool's threads
+    void parallel(Priority priority, int copies, const std::function<void()>& work);
+
+private:
+    struct Task {
+        std::function<void()> run;
+        Group* group = nullptr;
+    };
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> queues[PRIORITIES];
+        std::thread thread;
+    };
+
+    void workerLoop(int index);
+    // Highest priority first: the worker's own newest, else the oldest of
+    // another's. The task's priority, or -1 with none it may take.
+    int take(int self, Task& task);
+    bool takeFromGroup(Group& group, Task& task);
+    void execute(Task& task, bool background);
+    void finish(Group& group);
+    bool runnable() const;  // A job some idle worker may take
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<int> queued_[PRIORITIES] = {};
+    std::atomic<unsigned> next_worker_{0};  // Round robin for outside submitters
+    std::atomic<int> background_running_{0};
+    int background_limit_ = 1;              // Workers Normal and Low jobs may hold
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;          // Workers: a job was queued
+    std::condition_variable done_;          // wait(): a group's job ended, or a job was queued
+    bool quit_ = false;
+};
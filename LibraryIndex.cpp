@@ -0,0 +1,530 @@
+#include "LibraryIndex.h"
+#include "ChannelTaps.h"
+#include "NoteCache.h"
+#include "NsfMetadata.h"
+#include "ZipArchive.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr char MAGIC[4] = {'F', 'C', 'L', 'I'};
+
+// Host byte order, like the note cache. After the header: the folders, then
+// the entries, with strings as a u32 length and their bytes.
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t folder_count;
+    uint32_t entry_count;
+};
+static_assert(sizeof(Header) == 16, "Header is written as is");
+
+class Writer {
+public:
+    template <typename T>
+    void put(T value) {
+        const size_t at = data.size();
+        data.resize(at + sizeof(T));
+        std::memcpy(data.data() + at, &value, sizeof(T));
+    }
+    void put(const std::string& text) {
+        put(static_cast<uint32_t>(text.size()));
+        data.insert(data.end(), text.begin(), text.end());
+    }
+
+    std::vector<unsigned char> data;
+};
+
+// Every read is checked against the end; one short read fails the rest
+class Reader {
+public:
+    Reader(const unsigned char* p, size_t size) : p_(p), end_(p + size) {}
+
+    template <typename T>
+    bool get(T* value) {
+        if (static_cast<size_t>(end_ - p_) < sizeof(T)) return ok_ = false;
+        std::memcpy(value, p_, sizeof(T));
+        p_ += sizeof(T);
+        return true;
+    }
+    bool get(std::string* text) {
+        uint32_t size = 0;
+        if (!get(&size) || static_cast<size_t>(end_ - p_) < size) return ok_ = false;
+        text->assign(reinterpret_cast<const char*>(p_), size);
+        p_ += size;
+        return true;
+    }
+    bool good() const { return ok_; }
+    bool ok() const { return ok_ && p_ == end_; }
+
+private:
+    const unsigned char* p_;
+    const unsigned char* end_;
+    bool ok_ = true;
+};
+
+struct Found {
+    std::string path;
+    int64_t mtime;
+    uint64_t size;
+};
+
+bool isMusicFile(const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".nsf" || ext == ".nsfe";
+}
+
+// A zip's music entries, each as an entry path with the archive's mtime and
+// size. While those hold, the entries come from the old index and the
+// archive is not opened; otherwise its directory is read, once.
+void findArchiveEntries(const std::string& path, int64_t mtime, uint64_t size,
+                        const std::vector<LibraryIndex::Entry>& old, std::vector<Found>& found) {
+    const std::string prefix = ZipArchive::entryPath(path, std::string());
+    auto it = std::lower_bound(old.begin(), old.end(), prefix,
+                               [](const LibraryIndex::Entry& entry, const std::string& key) { return entry.path < key; });
+    const size_t first = found.size();
+    bool unchanged = true;
+    for (; it != old.end() && it->path.compare(0, prefix.size(), prefix) == 0; ++it) {
+        unchanged = unchanged && it->mtime == mtime && it->size == size;
+        found.push_back({it->path, mtime, size});
+    }
+    if (unchanged && found.size() > first) return;
+
+    found.resize(first);
+    std::shared_ptr<const ZipArchive> archive = ZipArchive::open(path);
+    if (!archive) return;
+    for (const ZipArchive::Entry& entry : archive->entries()) {
+        if (isMusicFile(entry.name)) found.push_back({ZipArchive::entryPath(path, entry.name), mtime, size});
+    }
+}
+
+void appendLower(std::string& out, const std::string& text) {
+    for (unsigned char c : text) out += c == '\n' ? ' ' : static_cast<char>(std::tolower(c));
+}
+
+void buildSearchText(LibraryIndex::Entry& entry) {
+    std::string& text = entry.search_text;
+    text.clear();
+    appendLower(text, entry.game);
+    text += '\n';
+    appendLower(text, entry.author);
+    text += '\n';
+    appendLower(text, entry.copyright);
+    text += '\n';
+    appendLower(text, std::filesystem::path(entry.path).stem().string());
+    text += '\n';
+    entry.songs_at = text.size();
+    for (const LibraryIndex::Track& track : entry.tracks) {
+        appendLower(text, track.song);
+        text += '\n';
+    }
+}
+
+// Titles and track lengths of one file, numbered as the player numbers
+// them (no playlist); false if gme cannot open it
+bool readEntry(LibraryIndex::Entry& entry) {
+    gme_err_t err = nullptr;
+    std::shared_ptr<const MusicFile> file = MusicFile::read(entry.path.c_str(), &err);
+    if (!file) return false;
+    entry.hash = NoteCache::hashData(file->data(), file->size());
+
+    // The header or chunks read in place, for a file that is what its
+    // extension says; gme, which goes by the extension, reads anything else
+    NsfMetadata metadata;
+    const gme_type_t type = gme_identify_extension(entry.path.c_str());
+    if (NsfMetadata::read(file->data(), file->size(), &metadata) &&
+        (!type || type == (metadata.nsfe ? gme_nsfe_type : gme_nsf_type))) {
+        entry.game = std::move(metadata.game);
+        entry.author = std::move(metadata.author);
+        entry.copyright = std::move(metadata.copyright);
+        entry.tracks.resize(metadata.tracks.size());
+        for (size_t t = 0; t < entry.tracks.size(); ++t) {
+            entry.tracks[t].song = std::move(metadata.tracks[t].song);
+            entry.tracks[t].length_ms = metadata.tracks[t].length_ms;
+        }
+        return true;
+    }
+
+    Music_Emu* emu = nullptr;
+    if (open_music_emu(*file, &emu, gme_info_only) != nullptr || !emu) return false;
+    track_info_t info;
+    if (gme_track_info(emu, &info, 0) == nullptr) {
+        entry.game = info.game;
+        entry.author = info.author;
+        entry.copyright = info.copyright;
+    }
+    entry.tracks.resize(static_cast<size_t>(std::max(gme_track_count(emu), 0)));
+    for (size_t t = 0; t < entry.tracks.size(); ++t) {
+        if (gme_track_info(emu, &info, static_cast<int>(t)) != nullptr) continue;
+        entry.tracks[t].song = info.song;
+        entry.tracks[t].length_ms = static_cast<int32_t>(info.length);
+    }
+    gme_delete(emu);
+    return true;
+}
+
+// Track whose song line holds text position at, -1 for the file's own lines
+int trackAt(const LibraryIndex::Entry& entry, size_t at) {
+    if (at < entry.songs_at) return -1;
+    const auto begin = entry.search_text.begin();
+    return static_cast<int>(std::count(begin + static_cast<std::ptrdiff_t>(entry.songs_at),
+                                       begin + static_cast<std::ptrdiff_t>(at), '\n'));
+}
+
+// How well term (lowercase, no spaces) matches entry, 0 if not at all. A
+// substring beats a subsequence, and one at a word start beats one inside a
+// word; a subsequence has to lie within one line and scores by how tight it
+// is. *track is set to the matching song, or -1.
+int termScore(const LibraryIndex::Entry& entry, const std::string& term, int* track) {
+    const std::string& text = entry.search_text;
+    size_t first = std::string::npos;
+    for (size_t at = text.find(term); at != std::string::npos; at = text.find(term, at + 1)) {
+        if (at == 0 || !std::isalnum(static_cast<unsigned char>(text[at - 1]))) {
+            *track = trackAt(entry, at);
+            return 150 + static_cast<int>(term.size());
+        }
+        if (first == std::string::npos) first = at;
+    }
+    if (first != std::string::npos) {
+        *track = trackAt(entry, first);
+        return 100 + static_cast<int>(term.size());
+    }
+
+    int best = 0;
+    for (size_t begin = 0; begin < text.size();) {
+        const size_t end = text.find('\n', begin);
+        size_t start = std::string::npos, i = begin;
+        size_t matched = 0;
+        for (; matched < term.size(); ++matched, ++i) {
+            while (i < end && text[i] != term[matched]) ++i;
+            if (i == end) break;
+            if (matched == 0) start = i;
+        }
+        if (matched == term.size()) {
+            const int score = std::max(1, 50 - static_cast<int>(i - start - term.size()));
+            if (score > best) {
+                best = score;
+                *track = trackAt(entry, start);
+            }
+        }
+        begin = end + 1;
+    }
+    return best;
+}
+
+}  // namespace
+
+std::string LibraryIndex::defaultPath() {
+    std::filesystem::path base;
+#if defined(_WIN32)
+    if (const char* appdata = std::getenv("APPDATA")) base = appdata;
+#elif defined(__APPLE__)
+    if (const char* home = std::getenv("HOME")) base = std::filesystem::path(home) / "Library" / "Application Support";
+#else
+    if (const char* xdg = std::getenv("XDG_DATA_HOME"); xdg && xdg[0]) {
+        base = xdg;
+    } else if (const char* home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / ".local" / "share";
+    }
+#endif
+    if (base.empty()) return std::string();
+    return (base / "imgui_fc_visualizer" / "library.index").string();
+}
+
+LibraryIndex::~LibraryIndex() {
+    stop();
+}
+
+void LibraryIndex::open(const std::string& path) {
+    stop();
+    auto entries = std::make_shared<std::vector<Entry>>();
+    std::vector<std::string> folders;
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    const std::streamoff size = file.is_open() ? static_cast<std::streamoff>(file.tellg()) : 0;
+    std::vector<unsigned char> data(size > 0 ? static_cast<size_t>(size) : 0);
+    file.seekg(0, std::ios::beg);
+    Header header{};
+    if (data.size() >= sizeof(Header) && file.read(reinterpret_cast<char*>(data.data()), size)) {
+        std::memcpy(&header, data.data(), sizeof(header));
+    }
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+        header.folder_count <= data.size()) {
+        Reader reader(data.data() + sizeof(Header), data.size() - sizeof(Header));
+        folders.resize(header.folder_count);
+        for (std::string& folder : folders) reader.get(&folder);
+        // Counts are only trusted as far as the bytes go
+        for (uint32_t i = 0; i < header.entry_count && reader.good(); ++i) {
+            Entry entry;
+            uint32_t track_count = 0;
+            reader.get(&entry.path);
+            reader.get(&entry.mtime);
+            reader.get(&entry.size);
+            reader.get(&entry.hash);
+            reader.get(&entry.game);
+            reader.get(&entry.author);
+            reader.get(&entry.copyright);
+            if (!reader.get(&track_count)) break;
+            for (uint32_t t = 0; t < track_count; ++t) {
+                Track track;
+                reader.get(&track.song);
+                if (!reader.get(&track.length_ms)) break;
+                entry.tracks.push_back(std::move(track));
+            }
+            buildSearchText(entry);
+            entries->push_back(std::move(entry));
+        }
+        if (!reader.ok() || entries->size() != header.entry_count) {
+            entries->clear();
+            folders.clear();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    folders_ = std::move(folders);
+    index_ = std::move(entries);
+}
+
+void LibraryIndex::addFolder(const std::string& dir) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (std::find(folders_.begin(), folders_.end(), dir) == folders_.end()) folders_.push_back(dir);
+    }
+    rescan();
+}
+
+void LibraryIndex::removeFolder(size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index >= folders_.size()) return;
+        folders_.erase(folders_.begin() + static_cast<std::ptrdiff_t>(index));
+    }
+    rescan();
+}
+
+std::vector<std::string> LibraryIndex::folders() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return folders_;
+}
+
+void LibraryIndex::rescan() {
+    if (scanning_.load()) return;
+    JobPool::shared().wait(scan_job_);
+    cancel_ = false;
+    scan_found_ = 0;
+    scan_to_read_ = 0;
+    scan_read_ = 0;
+    scanning_ = true;
+    JobPool::shared().submit(scan_job_, JobPool::Priority::Low,
+                             [this, folders = folders()]() mutable { scan(std::move(folders)); });
+}
+
+void LibraryIndex::stop() {
+    cancel_ = true;
+    JobPool::shared().cancel(scan_job_);
+    JobPool::shared().wait(scan_job_);
+    scanning_ = false;  // Also when the scan was dropped before it started
+}
+
+size_t LibraryIndex::size() const {
+    return load()->size();
+}
+
+std::shared_ptr<const std::vector<LibraryIndex::Entry>> LibraryIndex::load() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!index_) return std::make_shared<const std::vector<Entry>>();
+    return index_;
+}
+
+void LibraryIndex::scan(std::vector<std::string> folders) {
+    const std::shared_ptr<const std::vector<Entry>> old = load();
+
+    // Walk first: the file list is cheap, reading the files is not
+    std::vector<Found> found;
+    for (const std::string& folder : folders) {
+        std::error_code ec;
+        for (std::filesystem::recursive_directory_iterator it(folder, ec), end; !ec && it != end && !cancel_;
+             it.increment(ec)) {
+            if (!it->is_regular_file(ec)) continue;
+            const std::string path = it->path().string();
+            const bool archive = ZipArchive::isArchive(path);
+            if (!archive && !isMusicFile(it->path())) continue;
+            const auto mtime = it->last_write_time(ec);
+            const uint64_t size = it->file_size(ec);
+            if (ec) {
+                ec.clear();
+                continue;
+            }
+            const int64_t stamp =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+            const size_t before = found.size();
+            if (archive) {
+                findArchiveEntries(path, stamp, size, *old, found);
+            } else {
+                found.push_back({path, stamp, size});
+            }
+            scan_found_ += static_cast<int>(found.size() - before);
+        }
+    }
+    std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.path < b.path; });
+    found.erase(std::unique(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.path == b.path; }),
+                found.end());
+
+    // Unchanged files keep their entries; old is sorted by path too
+    std::vector<Entry> entries(found.size());
+    std::vector<unsigned char> keep(found.size(), 0);  // Bytes, as workers set their own
+    std::vector<size_t> jobs;
+    auto previous = old->begin();
+    for (size_t i = 0; i < found.size(); ++i) {
+        while (previous != old->end() && previous->path < found[i].path) ++previous;
+        if (previous != old->end() && previous->path == found[i].path && previous->mtime == found[i].mtime &&
+            previous->size == found[i].size) {
+            entries[i] = *previous;
+            keep[i] = 1;
+            continue;
+        }
+        entries[i].path = found[i].path;
+        entries[i].mtime = found[i].mtime;
+        entries[i].size = found[i].size;
+        jobs.push_back(i);
+    }
+    scan_to_read_ = static_cast<int>(jobs.size());
+
+    // The rest across the pool, as NesFarm runs its jobs
+    const size_t copies = std::min(static_cast<size_t>(JobPool::shared().threadCount()), std::max<size_t>(jobs.size(), 1));
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next.fetch_add(1); i < jobs.size() && !cancel_; i = next.fetch_add(1)) {
+            Entry& entry = entries[jobs[i]];
+            if (readEntry(entry)) {
+                buildSearchText(entry);
+                keep[jobs[i]] = 1;
+            }
+            ++scan_read_;
+        }
+    };
+    JobPool::shared().parallel(JobPool::Priority::Low, static_cast<int>(copies), work);
+
+    if (!cancel_) {
+        // Files gme cannot open are left out, and read again next scan
+        auto index = std::make_shared<std::vector<Entry>>();
+        index->reserve(entries.size());
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (keep[i]) index->push_back(std::move(entries[i]));
+        }
+        save(*index, folders);
+        std::lock_guard<std::mutex> lock(mutex_);
+        index_ = std::move(index);
+    } else {
+        // Keep a folder change made before the stop
+        save(*old, folders);
+    }
+    scanning_ = false;
+}
+
+bool LibraryIndex::save(const std::vector<Entry>& entries, const std::vector<std::string>& folders) const {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        path = path_;
+    }
+    if (path.empty()) return false;
+
+    Writer writer;
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.folder_count = static_cast<uint32_t>(folders.size());
+    header.entry_count = static_cast<uint32_t>(entries.size());
+    writer.data.resize(sizeof(Header));
+    std::memcpy(writer.data.data(), &header, sizeof(header));
+    for (const std::string& folder : folders) writer.put(folder);
+    for (const Entry& entry : entries) {
+        writer.put(entry.path);
+        writer.put(entry.mtime);
+        writer.put(entry.size);
+        writer.put(entry.hash);
+        writer.put(entry.game);
+        writer.put(entry.author);
+        writer.put(entry.copyright);
+        writer.put(static_cast<uint32_t>(entry.tracks.size()));
+        for (const Track& track : entry.tracks) {
+            writer.put(track.song);
+            writer.put(track.length_ms);
+        }
+    }
+
+    // Written aside and renamed over, as the note cache does
+    std::error_code ec;
+    const std::filesystem::path target(path);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), ec);
+    std::filesystem::path temp = target;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(writer.data.data()),
+                        static_cast<std::streamsize>(writer.data.size()))) {
+            return false;
+        }
+    }
+    std::filesystem::rename(temp, target, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+std::vector<LibraryIndex::Match> LibraryIndex::search(const std::string& query, size_t max_results) const {
+    const std::shared_ptr<const std::vector<Entry>> index = load();
+    std::vector<Match> matches;
+
+    std::vector<std::string> terms;
+    std::string term;
+    for (unsigned char c : query + ' ') {
+        if (std::isspace(c)) {
+            if (!term.empty()) terms.push_back(std::move(term));
+            term.clear();
+        } else {
+            term += static_cast<char>(std::tolower(c));
+        }
+    }
+
+    if (terms.empty()) {
+        for (size_t i = 0; i < index->size() && i < max_results; ++i) matches.push_back({index, &(*index)[i], -1, 0});
+        return matches;
+    }
+
+    for (const Entry& entry : *index) {
+        // Every word has to match; the first one naming a song picks the track
+        int score = 0;
+        int track = -1;
+        for (const std::string& word : terms) {
+            int word_track = -1;
+            const int word_score = termScore(entry, word, &word_track);
+            if (word_score == 0) {
+                score = 0;
+                break;
+            }
+            score += word_score;
+            if (track < 0) track = word_track;
+        }
+        if (score > 0) matches.push_back({index, &entry, track, score});
+    }
+
+    const size_t count = std::min(max_results, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(count), matches.end(),
+                      [](const Match& a, const Match& b) {
+                          return a.score != b.score ? a.score > b.score : a.entry->path < b.entry->path;
+                      });
+    matches.resize(count);
+    return matches;
+}
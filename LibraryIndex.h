@@ -0,0 +1,104 @@
+#pragma once
+
+#include "JobPool.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Index of the NSF/NSFE files under a set of library folders: path, mtime,
+// size, content hash, titles and track lengths, kept in one compact file.
+// A background scan walks the folders and re-reads only files that are new
+// or whose mtime or size changed, as Low jobs on the shared JobPool; the rest is
+// carried over. Searches run on the last published index and never wait
+// for a scan.
+//
+// The files in a zip archive are indexed as ZipArchive entry paths, with
+// the archive's mtime and size, so an unchanged archive is carried over
+// from the index as a whole without being opened.
+class LibraryIndex {
+public:
+    // Bump when the file layout changes; other versions read as empty
+    static constexpr uint32_t VERSION = 1;
+
+    struct Track {
+        std::string song;
+        int32_t length_ms = -1;  // -1 if unknown
+    };
+
+    struct Entry {
+        std::string path;
+        int64_t mtime = 0;  // Nanoseconds on the file system's clock
+        uint64_t size = 0;
+        uint64_t hash = 0;  // NoteCache::hashData of the contents
+        std::string game, author, copyright;
+        std::vector<Track> tracks;
+        // Lowercased game, author, copyright and file name, then the songs,
+        // one per line from songs_at; built when the entry is read
+        std::string search_text;
+        size_t songs_at = 0;
+    };
+
+    struct Match {
+        std::shared_ptr<const std::vector<Entry>> index;  // Keeps entry alive
+        const Entry* entry = nullptr;
+        int track = -1;  // Track whose title matched, -1 for the file as a whole
+        int score = 0;
+    };
+
+    // Per-user data file for the platform, empty if there is none
+    static std::string defaultPath();
+
+    LibraryIndex() = default;
+    ~LibraryIndex();
+    LibraryIndex(const LibraryIndex&) = delete;
+    LibraryIndex& operator=(const LibraryIndex&) = delete;
+
+    // Read the index and its folder list from path (UI thread, no scan running);
+    // a missing or damaged file gives an empty index
+    void open(const std::string& path);
+
+    // Add a folder and scan (UI thread)
+    void addFolder(const std::string& dir);
+    void removeFolder(size_t index);
+    std::vector<std::string> folders() const;
+
+    // Walk the folders in the background; ignored while a scan is running.
+    // The index is saved when the scan ends.
+    void rescan();
+    void stop();
+
+    bool scanning() const { return scanning_.load(); }
+    // Files found by the running scan, and how many of those needed reading
+    int scanFound() const { return scan_found_.load(); }
+    int scanToRead() const { return scan_to_read_.load(); }
+    int scanRead() const { return scan_read_.load(); }
+
+    // Entries in the published index
+    size_t size() const;
+
+    // Every entry matching all the query's words, best first. A word matches
+    // as a substring, or failing that as a subsequence, of the titles and the
+    // file name; substrings and word starts score higher. Empty query: all
+    // entries in path order.
+    std::vector<Match> search(const std::string& query, size_t max_results) const;
+
+private:
+    std::shared_ptr<const std::vector<Entry>> load() const;
+    void scan(std::vector<std::string> folders);
+    bool save(const std::vector<Entry>& entries, const std::vector<std::string>& folders) const;
+
+    mutable std::mutex mutex_;
+    std::string path_;
+    std::vector<std::string> folders_;                // Guarded by mutex_
+    std::shared_ptr<const std::vector<Entry>> index_; // Sorted by path; guarded by mutex_, immutable once published
+
+    JobPool::Group scan_job_;
+    std::atomic<bool> scanning_{false};
+    std::atomic<bool> cancel_{false};
+    std::atomic<int> scan_found_{0};
+    std::atomic<int> scan_to_read_{0};
+    std::atomic<int> scan_read_{0};
+};
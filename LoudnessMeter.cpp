@@ -0,0 +1,197 @@
+#include "LoudnessMeter.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr double PI = 3.14159265358979323846;
+
+static float energyToLufs(double mean_square) {
+    if (mean_square <= 0.0) return LoudnessMeter::SILENCE_LUFS;
+    return std::max(LoudnessMeter::SILENCE_LUFS, static_cast<float>(-0.691 + 10.0 * std::log10(mean_square)));
+}
+
+void LoudnessMeter::configure(long sample_rate) {
+    const double rate = static_cast<double>(std::max(8000L, sample_rate));
+
+    // K-weighting for an arbitrary rate: the BS.1770 48 kHz filters
+    // re-derived from their analog prototypes
+    Biquad shelf;
+    {
+        const double f0 = 1681.974450955533;
+        const double gain_db = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(PI * f0 / rate);
+        const double vh = std::pow(10.0, gain_db / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        shelf.b1 = 2.0 * (k * k - vh) / a0;
+        shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        shelf.a2 = (1.0 - k / q + k * k) / a0;
+    }
+    Biquad highpass;
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(PI * f0 / rate);
+        const double a0 = 1.0 + k / q + k * k;
+        highpass.b0 = 1.0;
+        highpass.b1 = -2.0;
+        highpass.b2 = 1.0;
+        highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+        highpass.a2 = (1.0 - k / q + k * k) / a0;
+    }
+    for (Channel& channel : channels_) {
+        channel.shelf = shelf;
+        channel.highpass = highpass;
+    }
+
+    // Windowed-sinc interpolator split into OVERSAMPLE phases, each
+    // normalized to unity DC gain
+    constexpr int length = OVERSAMPLE * PHASE_TAPS;
+    const double center = (length - 1) * 0.5;
+    for (int phase = 0; phase < OVERSAMPLE; ++phase) {
+        double sum = 0.0;
+        for (int k = 0; k < PHASE_TAPS; ++k) {
+            const int n = phase + k * OVERSAMPLE;
+            const double x = (n - center) / OVERSAMPLE;
+            const double sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(PI * x) / (PI * x);
+            const double window = 0.5 - 0.5 * std::cos(2.0 * PI * (n + 0.5) / length);
+            taps_[phase * PHASE_TAPS + k] = static_cast<float>(sinc * window);
+            sum += sinc * window;
+        }
+        for (int k = 0; k < PHASE_TAPS; ++k) {
+            taps_[phase * PHASE_TAPS + k] = static_cast<float>(taps_[phase * PHASE_TAPS + k] / sum);
+        }
+    }
+
+    block_frames_ = static_cast<int>(rate / 10.0);
+    reset();
+}
+
+void LoudnessMeter::reset() {
+    for (Channel& channel : channels_) {
+        channel.shelf.z1 = channel.shelf.z2 = 0.0;
+        channel.highpass.z1 = channel.highpass.z2 = 0.0;
+        channel.history.fill(0.0f);
+        channel.history_pos = 0;
+    }
+    block_pos_ = 0;
+    block_energy_ = 0.0;
+    blocks_.fill(0.0);
+    block_count_ = 0;
+    block_index_ = 0;
+    gate_counts_.fill(0);
+    gate_energy_.fill(0.0);
+    momentary_lufs_ = SILENCE_LUFS;
+    short_term_lufs_ = SILENCE_LUFS;
+    integrated_lufs_ = SILENCE_LUFS;
+    block_peak_ = 0.0f;
+    recent_peaks_.fill(0.0f);
+    peak_index_ = 0;
+    max_peak_ = 0.0f;
+}
+
+float LoudnessMeter::oversampledPeak(Channel& channel, float sample) {
+    // Newest sample first: history[pos + k] is the input k samples ago
+    channel.history_pos = (channel.history_pos + PHASE_TAPS - 1) % PHASE_TAPS;
+    channel.history[channel.history_pos] = sample;
+    channel.history[channel.history_pos + PHASE_TAPS] = sample;
+    const float* history = channel.history.data() + channel.history_pos;
+
+    float peak = std::abs(sample);
+    for (int phase = 0; phase < OVERSAMPLE; ++phase) {
+        const float* taps = taps_.data() + phase * PHASE_TAPS;
+        float acc = 0.0f;
+        for (int k = 0; k < PHASE_TAPS; ++k) {
+            acc += taps[k] * history[k];
+        }
+        peak = std::max(peak, std::abs(acc));
+    }
+    return peak;
+}
+
+void LoudnessMeter::process(const float* left, const float* right, int frames) {
+    Channel& l = channels_[0];
+    Channel& r = channels_[1];
+    for (int i = 0; i < frames; ++i) {
+        const double wl = l.highpass.run(l.shelf.run(left[i]));
+        const double wr = r.highpass.run(r.shelf.run(right[i]));
+        block_energy_ += wl * wl + wr * wr;  // Left and right both weigh 1.0
+
+        block_peak_ = std::max(block_peak_, std::max(oversampledPeak(l, left[i]), oversampledPeak(r, right[i])));
+
+        if (++block_pos_ == block_frames_) {
+            addBlock(block_energy_ / block_frames_);
+            block_energy_ = 0.0;
+            block_pos_ = 0;
+        }
+    }
+}
+
+void LoudnessMeter::addBlock(double energy) {
+    blocks_[block_index_] = energy;
+    block_index_ = (block_index_ + 1) % SHORT_TERM_BLOCKS;
+    block_count_ = std::min(block_count_ + 1, SHORT_TERM_BLOCKS);
+
+    recent_peaks_[peak_index_] = block_peak_;
+    peak_index_ = (peak_index_ + 1) % MOMENTARY_BLOCKS;
+    max_peak_ = std::max(max_peak_, block_peak_);
+    block_peak_ = 0.0f;
+
+    // Windows are means of the newest 100 ms blocks: 30 adds per block at most
+    auto window_mean = [this](int count) {
+        double sum = 0.0;
+        for (int i = 1; i <= count; ++i) {
+            sum += blocks_[(block_index_ + SHORT_TERM_BLOCKS - i) % SHORT_TERM_BLOCKS];
+        }
+        return sum / count;
+    };
+    const double momentary = window_mean(std::min(block_count_, MOMENTARY_BLOCKS));
+    momentary_lufs_ = energyToLufs(momentary);
+    short_term_lufs_ = energyToLufs(window_mean(block_count_));
+
+    // Every full 400 ms window (75% overlap) is a gating block
+    if (block_count_ >= MOMENTARY_BLOCKS && momentary_lufs_ > SILENCE_LUFS) {
+        int bin = static_cast<int>((momentary_lufs_ - HISTOGRAM_MIN) / HISTOGRAM_STEP);
+        bin = std::clamp(bin, 0, HISTOGRAM_BINS - 1);
+        gate_counts_[bin]++;
+        gate_energy_[bin] += momentary;
+        updateIntegrated();
+    }
+}
+
+void LoudnessMeter::updateIntegrated() {
+    // Relative gate: 10 LU below the mean of the absolute-gated blocks
+    double energy = 0.0;
+    uint64_t count = 0;
+    for (int i = 0; i < HISTOGRAM_BINS; ++i) {
+        energy += gate_energy_[i];
+        count += gate_counts_[i];
+    }
+    if (count == 0) return;
+    const float relative_gate = energyToLufs(energy / count) - 10.0f;
+
+    energy = 0.0;
+    count = 0;
+    const int first = std::max(0, static_cast<int>((relative_gate - HISTOGRAM_MIN) / HISTOGRAM_STEP));
+    for (int i = first; i < HISTOGRAM_BINS; ++i) {
+        energy += gate_energy_[i];
+        count += gate_counts_[i];
+    }
+    if (count > 0) {
+        integrated_lufs_ = energyToLufs(energy / count);
+    }
+}
+
+float LoudnessMeter::truePeakDb() const {
+    float peak = block_peak_;
+    for (float p : recent_peaks_) {
+        peak = std::max(peak, p);
+    }
+    return 20.0f * std::log10(std::max(peak, 1e-6f));
+}
+
+float LoudnessMeter::maxTruePeakDb() const {
+    return 20.0f * std::log10(std::max(std::max(max_peak_, block_peak_), 1e-6f));
+}
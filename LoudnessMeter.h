@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// BS.1770-style stereo loudness and true-peak meter, fed incrementally.
+// Samples are K-weighted and summed into 100 ms blocks; momentary (400 ms)
+// and short-term (3 s) loudness come from a ring of block energies, and
+// integrated loudness from a histogram of gated 400 ms blocks, so the
+// state is fixed-size and no history is ever re-scanned. True peak uses
+// 4x polyphase oversampling.
+class LoudnessMeter {
+public:
+    static constexpr float SILENCE_LUFS = -70.0f;  // Absolute gate; also reported for silence
+
+    LoudnessMeter() { configure(44100); }
+
+    // Rebuilds the filters for the rate and clears everything
+    void configure(long sample_rate);
+    void reset();
+
+    // One call per block of frames (render thread)
+    void process(const float* left, const float* right, int frames);
+
+    float momentaryLufs() const { return momentary_lufs_; }
+    float shortTermLufs() const { return short_term_lufs_; }
+    float integratedLufs() const { return integrated_lufs_; }
+
+    // Highest oversampled peak over the last momentary window, and since reset (dBTP)
+    float truePeakDb() const;
+    float maxTruePeakDb() const;
+
+private:
+    static constexpr int MOMENTARY_BLOCKS = 4;     // 400 ms of 100 ms blocks
+    static constexpr int SHORT_TERM_BLOCKS = 30;   // 3 s
+    static constexpr int OVERSAMPLE = 4;
+    static constexpr int PHASE_TAPS = 12;          // 48-tap interpolation filter
+    static constexpr float HISTOGRAM_MIN = SILENCE_LUFS;
+    static constexpr float HISTOGRAM_STEP = 0.1f;  // LU per integrated-loudness bin
+    static constexpr int HISTOGRAM_BINS = 750;     // -70 .. +5 LUFS
+
+    struct Biquad {
+        double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+        double z1 = 0, z2 = 0;
+        double run(double x) {
+            double y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    struct Channel {
+        Biquad shelf;      // K-weighting stage 1: high-frequency shelf
+        Biquad highpass;   // Stage 2: RLB high-pass
+        std::array<float, PHASE_TAPS * 2> history{};  // Delay line, duplicated for contiguous reads
+        int history_pos = 0;
+    };
+
+    void addBlock(double energy);
+    void updateIntegrated();
+    float oversampledPeak(Channel& channel, float sample);
+
+    std::array<Channel, 2> channels_;
+    std::array<float, OVERSAMPLE * PHASE_TAPS> taps_{};  // Phase p uses taps_[p * PHASE_TAPS ...]
+
+    int block_frames_ = 4410;          // 100 ms
+    int block_pos_ = 0;
+    double block_energy_ = 0.0;        // Sum of weighted squares in the current block
+
+    std::array<double, SHORT_TERM_BLOCKS> blocks_{};  // Mean square per 100 ms block
+    int block_count_ = 0;              // Blocks received, saturating at SHORT_TERM_BLOCKS
+    int block_index_ = 0;              // Next slot in blocks_
+
+    std::array<uint32_t, HISTOGRAM_BINS> gate_counts_{};
+    std::array<double, HISTOGRAM_BINS> gate_energy_{};
+
+    float momentary_lufs_ = SILENCE_LUFS;
+    float short_term_lufs_ = SILENCE_LUFS;
+    float integrated_lufs_ = SILENCE_LUFS;
+
+    float block_peak_ = 0.0f;          // Linear, current 100 ms block
+    std::array<float, MOMENTARY_BLOCKS> recent_peaks_{};
+    int peak_index_ = 0;
+    float max_peak_ = 0.0f;
+};
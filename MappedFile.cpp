@@ -0,0 +1,111 @@
+#include "MappedFile.h"
+#include <fstream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Map path read-only; false if the platform or the file will not have it
+// (empty files cannot be mapped), and the caller reads it instead
+bool mapFile(const char* path, void** base, size_t* size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER length;
+    bool ok = GetFileSizeEx(file, &length) && length.QuadPart > 0 &&
+              static_cast<unsigned long long>(length.QuadPart) <= SIZE_MAX;
+    HANDLE mapping = ok ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    // The view keeps the mapping alive once both handles are closed
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (!view) return false;
+    *base = view;
+    *size = static_cast<size_t>(length.QuadPart);
+    return true;
+#else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    *base = view;
+    *size = static_cast<size_t>(st.st_size);
+    return true;
+#endif
+}
+
+void unmapFile(void* base, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, size);
+#endif
+}
+
+}  // namespace
+
+std::shared_ptr<const MappedFile> MappedFile::open(const char* path, const char** error) {
+    if (error) *error = nullptr;
+    std::shared_ptr<MappedFile> file(new MappedFile);
+    void* base;
+    size_t size;
+    if (mapFile(path, &base, &size)) {
+        file->mapping_ = base;
+        file->data_ = static_cast<const uint8_t*>(base);
+        file->size_ = size;
+        return file;
+    }
+
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        if (error) *error = "Couldn't open file";
+        return nullptr;
+    }
+    file->owned_.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0, std::ios::beg);
+    if (!in.read(reinterpret_cast<char*>(file->owned_.data()), static_cast<std::streamsize>(file->owned_.size()))) {
+        if (error) *error = "Couldn't read file";
+        return nullptr;
+    }
+    file->data_ = file->owned_.data();
+    file->size_ = file->owned_.size();
+    return file;
+}
+
+std::shared_ptr<const MappedFile> MappedFile::view(const void* data, size_t size, std::shared_ptr<const void> owner) {
+    std::shared_ptr<MappedFile> file(new MappedFile);
+    file->data_ = static_cast<const uint8_t*>(data);
+    file->size_ = size;
+    file->owner_ = std::move(owner);
+    return file;
+}
+
+std::shared_ptr<const MappedFile> MappedFile::copy(const void* data, size_t size) {
+    std::shared_ptr<MappedFile> file(new MappedFile);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    file->owned_.assign(bytes, bytes + size);
+    file->data_ = file->owned_.data();
+    file->size_ = file->owned_.size();
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    if (mapping_) unmapFile(mapping_, size_);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Read-only bytes of a file, shared by everything that reads them. Files are
+// memory-mapped where the platform allows, so opening one copies nothing and
+// pages come in as they are touched; anything else is read whole once. A
+// view wraps bytes already in memory, such as an archive entry, without
+// copying them. Like any mapping, a file truncated while open faults on read.
+class MappedFile {
+public:
+    // nullptr, with *error set if given, when path cannot be opened or read
+    static std::shared_ptr<const MappedFile> open(const char* path, const char** error = nullptr);
+    // data stays valid while owner lives; owner may be null for static data
+    static std::shared_ptr<const MappedFile> view(const void* data, size_t size, std::shared_ptr<const void> owner);
+    // A private copy of data
+    static std::shared_ptr<const MappedFile> copy(const void* data, size_t size);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool mapped() const { return mapping_ != nullptr; }
+
+private:
+    MappedFile() = default;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    void* mapping_ = nullptr;            // Base of the mapped view, if mapped
+    std::vector<uint8_t> owned_;         // Bytes read or copied
+    std::shared_ptr<const void> owner_;  // What keeps a view's bytes alive
+};
@@ -0,0 +1,136 @@
+#include "MemoryReport.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cstdio>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+namespace {
+
+// "812 B", "24.0 KB", "3.25 MB"
+void formatBytes(char* out, size_t size, size_t bytes) {
+    if (bytes < 1024) {
+        std::snprintf(out, size, "%zu B", bytes);
+    } else if (bytes < 1024 * 1024) {
+        std::snprintf(out, size, "%.1f KB", bytes / 1024.0);
+    } else {
+        std::snprintf(out, size, "%.2f MB", bytes / (1024.0 * 1024.0));
+    }
+}
+
+void bytesColumn(size_t bytes) {
+    char text[32];
+    formatBytes(text, sizeof(text), bytes);
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(text);
+}
+
+}  // namespace
+
+const char* MemoryReport::categoryName(Category category) {
+    switch (category) {
+        case VISUALIZER: return "Audio visualizer";
+        case PIANO_NOTES: return "Piano notes";
+        case BLIP_BUFFERS: return "Blip_Buffers";
+        case AGNES: return "NES emulators";
+        case SAVE_STATES: return "Save states and rewind";
+        case TEXTURES: return "Textures";
+        case MUSIC_EMU: return "Music emulators";
+        case AUDIO_QUEUES: return "Audio queues";
+        default: return "?";
+    }
+}
+
+size_t MemoryReport::Sample::total() const {
+    size_t sum = 0;
+    for (size_t b : bytes) sum += b;
+    return sum;
+}
+
+size_t MemoryReport::processResidentBytes() {
+#if defined(__linux__)
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    const bool ok = std::fscanf(f, "%lu %lu", &pages, &resident) == 2;
+    std::fclose(f);
+    return ok ? static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return static_cast<size_t>(info.resident_size);
+#else
+    return 0;
+#endif
+}
+
+size_t MemoryReport::processPeakResidentBytes() {
+#if defined(__linux__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);  // Bytes
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;  // KB
+#endif
+#else
+    return 0;
+#endif
+}
+
+void MemoryReport::record(const Sample& sample) {
+    current_ = sample;
+    for (int c = 0; c < CATEGORY_COUNT; ++c) peak_.bytes[c] = std::max(peak_.bytes[c], sample.bytes[c]);
+    peak_total_ = std::max(peak_total_, sample.total());
+}
+
+void MemoryReport::drawWindow(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(380, 320), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Memory", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV;
+    if (ImGui::BeginTable("##memory", 3, flags)) {
+        ImGui::TableSetupColumn("Held by");
+        ImGui::TableSetupColumn("Now", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableSetupColumn("Peak", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableHeadersRow();
+        for (int c = 0; c < CATEGORY_COUNT; ++c) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(categoryName(static_cast<Category>(c)));
+            bytesColumn(current_.bytes[c]);
+            bytesColumn(peak_.bytes[c]);
+        }
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted("Total");
+        bytesColumn(current_.total());
+        bytesColumn(peak_total_);
+        ImGui::EndTable();
+    }
+
+    // The rest is code, the font atlas, the allocator, drivers...
+    char resident[32];
+    char peak[32];
+    formatBytes(resident, sizeof(resident), processResidentBytes());
+    formatBytes(peak, sizeof(peak), processPeakResidentBytes());
+    ImGui::Spacing();
+    ImGui::Text("Process resident: %s (peak %s)", resident, peak);
+    if (ImGui::Button("Reset Peaks")) {
+        peak_ = current_;
+        peak_total_ = current_.total();
+    }
+    ImGui::End();
+}
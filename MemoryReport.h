@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Bytes held by the app's large buffers, by kind, with the most each kind
+// has held since start: what a board's RAM must fit. Owners add what they
+// hold to a Sample (reportMemory() on each), the UI thread records one
+// every so often. Sizes are what is allocated, not what is in use.
+class MemoryReport {
+public:
+    enum Category {
+        VISUALIZER,     // AudioVisualizer rings, scopes and spectra
+        PIANO_NOTES,    // Preprocessed and predicted notes, the live history
+        BLIP_BUFFERS,   // Blip_Buffer samples: the APUs' and every channel tap
+        AGNES,          // NES emulators: agnes, APUs, frame buffers
+        SAVE_STATES,    // Rewind ring, save slots, run-ahead state
+        TEXTURES,       // GPU images, at their size on the device
+        MUSIC_EMU,      // gme emulators and seek keyframes
+        AUDIO_QUEUES,   // Render-ahead ring and prefetched openings
+        CATEGORY_COUNT
+    };
+    static const char* categoryName(Category category);
+
+    struct Sample {
+        std::array<size_t, CATEGORY_COUNT> bytes{};
+        void add(Category category, size_t count) { bytes[category] += count; }
+        size_t total() const;
+    };
+
+    template <typename T>
+    static size_t heapBytes(const std::vector<T>& v) {
+        return v.capacity() * sizeof(T);
+    }
+
+    // Resident set of the whole process and its peak, 0 where unknown
+    static size_t processResidentBytes();
+    static size_t processPeakResidentBytes();
+
+    // UI thread
+    void record(const Sample& sample);
+    const Sample& current() const { return current_; }
+    const Sample& peak() const { return peak_; }
+    size_t peakTotal() const { return peak_total_; }
+
+    // Draw the "Memory" window from the last sample recorded
+    void drawWindow(bool* p_open);
+
+private:
+    Sample current_;
+    Sample peak_;
+    size_t peak_total_ = 0;
+};
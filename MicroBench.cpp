@@ -0,0 +1,271 @@
+// Microbenchmarks of the hot paths, for tracking over time: each one runs in
+// timed epochs of enough iterations to take EPOCH_MS, and the median and the
+// spread of the per-iteration time over the epochs are printed as JSON.
+// Built with NES_HEADLESS like nes_bench, so the analysis is timed without
+// sokol_gfx, ImGui drawing or a GPU.
+//
+//   imgui_fc_visualizer_bench [--nsf file.nsf] [--rom rom.nes] [--filter text] [--epochs N]
+//
+// The NSF defaults to the bundled Game_Music_Emu test.nsf; the NES
+// benchmarks run only with a ROM. "runFrame" is agnes_next_frame() with the
+// APU and no screen; "runFrame+screen" adds the palette conversion that
+// updateScreenTexture() picks up, so the difference is what conversion costs.
+// After the list, "preprocess" breaks the preprocessTrack() passes down into
+// emulation, note extraction and sort, and gives their realtime factor.
+
+#include "AudioKernels.h"
+#include "AudioVisualizer.h"
+#include "ChannelProbe.h"
+#include "ChannelTaps.h"
+#include "NesEmulator.h"
+#include "PianoVisualizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr long SAMPLE_RATE = 44100;
+constexpr double EPOCH_MS = 20.0;
+constexpr float PREPROCESS_SECONDS = 30.0f;  // Of the NSF track, per preprocessTrack() iteration
+
+struct Result {
+    std::string name;
+    long iterations = 0;   // Per epoch
+    double median_ns = 0;  // Per iteration
+    double min_ns = 0;
+    double max_ns = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+// Times a named body, or skips it when the filter does not match
+using Bench = std::function<void(const std::string& name, const std::function<void()>& body)>;
+
+// Prevents a result from being optimized away
+volatile float sink;
+
+double timeIterations(const std::function<void()>& body, long iterations) {
+    const Clock::time_point start = Clock::now();
+    for (long i = 0; i < iterations; ++i) body();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+Result measure(const std::string& name, int epochs, const std::function<void()>& body) {
+    // Double the batch until one epoch is long enough to time; this also warms up
+    long iterations = 1;
+    while (iterations < (1L << 30) && timeIterations(body, iterations) < EPOCH_MS * 1e6) iterations *= 2;
+
+    std::vector<double> per_iteration(static_cast<size_t>(epochs));
+    for (double& ns : per_iteration) ns = timeIterations(body, iterations) / static_cast<double>(iterations);
+    std::sort(per_iteration.begin(), per_iteration.end());
+
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.median_ns = per_iteration[per_iteration.size() / 2];
+    result.min_ns = per_iteration.front();
+    result.max_ns = per_iteration.back();
+    return result;
+}
+
+// A few tones in interleaved stereo int16, as the player queues them
+std::vector<short> testSignal(int frames) {
+    constexpr double TWO_PI = 6.283185307179586;
+    std::vector<short> pcm(static_cast<size_t>(frames) * 2);
+    for (int i = 0; i < frames; ++i) {
+        const double t = static_cast<double>(i) / SAMPLE_RATE;
+        const double v = 0.3 * std::sin(TWO_PI * 220 * t) + 0.2 * std::sin(TWO_PI * 277 * t) +
+                         0.1 * std::sin(TWO_PI * 3520 * t);
+        pcm[i * 2] = pcm[i * 2 + 1] = static_cast<short>(v * 32767);
+    }
+    return pcm;
+}
+
+void addFftBenchmarks(const Bench& bench) {
+    for (int n : {2048, 4096}) {
+        std::vector<std::complex<float>> input(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i) input[i] = std::sin(0.05f * i) + 0.5f * std::sin(0.31f * i);
+        std::vector<std::complex<float>> data;
+        bench("SimpleFFT::fft/" + std::to_string(n), [&] {
+            data = input;
+            SimpleFFT::fft(data);
+            sink = data[1].real();
+        });
+
+        FftPlan plan(static_cast<size_t>(n));
+        std::vector<float> samples(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i) samples[i] = input[i].real();
+        std::vector<std::complex<float>> bins(static_cast<size_t>(n / 2 + 1));
+        bench("SimpleFFT::rfft/" + std::to_string(n), [&] {
+            SimpleFFT::rfft(samples.data(), plan.window(), bins.data(), plan);
+            sink = bins[1].real();
+        });
+
+        // The integer path processFFT() takes with fixed-point analysis: window,
+        // transform and approximate magnitudes, from Q15 samples
+        FftPlanQ15 plan_q15(static_cast<size_t>(n));
+        std::vector<short> samples_q15(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i) samples_q15[i] = static_cast<short>(samples[i] * 16384);
+        std::vector<int32_t> magnitudes_q15(static_cast<size_t>(n / 2));
+        bench("SimpleFFT::rfftQ15/" + std::to_string(n), [&] {
+            int32_t* scratch = plan_q15.scratch();
+            AudioKernels::windowQ15(samples_q15.data(), plan_q15.window(), scratch, n, plan_q15.inputShift());
+            SimpleFFT::rfftQ15(scratch, plan_q15);
+            AudioKernels::complexMagnitudeQ(scratch, magnitudes_q15.data(), n / 2);
+            sink = static_cast<float>(magnitudes_q15[1]);
+        });
+
+        data = input;
+        SimpleFFT::fft(data);
+        std::vector<float> magnitudes;
+        bench("computeMagnitude/" + std::to_string(n) + "/64", [&] {
+            SimpleFFT::computeMagnitude(data, magnitudes, 64);
+            sink = magnitudes[1];
+        });
+    }
+}
+
+void addVisualizerBenchmarks(const Bench& bench) {
+    // A device-sized block queued by the audio thread and drained by the UI,
+    // as one frame of the player does it
+    constexpr int BLOCK_FRAMES = 1024;
+    auto visualizer = std::make_unique<AudioVisualizer>();
+    visualizer->init(nullptr, SAMPLE_RATE);
+    const std::vector<short> pcm = testSignal(SAMPLE_RATE);
+    size_t pos = 0;
+    bench("updateAudioData/1024", [&] {
+        visualizer->updateAudioData(pcm.data() + pos, BLOCK_FRAMES * 2);
+        visualizer->processPendingAudio();
+        pos = (pos + BLOCK_FRAMES * 2) % (pcm.size() - BLOCK_FRAMES * 2);
+    });
+}
+
+// pass_stats adds up the preprocessTrack() iterations
+void addNoteBenchmarks(const Bench& bench, const char* nsf_path, PreprocessStats* pass_stats) {
+    gme_err_t err = nullptr;
+    std::shared_ptr<const MusicFile> file = MusicFile::read(nsf_path, &err);
+    Music_Emu* emu = nullptr;
+    if (file) err = open_music_emu(*file, &emu, SAMPLE_RATE);
+    if (err || !emu) {
+        std::fprintf(stderr, "%s: %s\n", nsf_path, err ? err : "could not open");
+        return;
+    }
+    const ChannelProbe probe = ChannelProbe::resolve(emu);
+    const ChannelTable layout = ChannelTable::forProbe(probe);
+    const long max_ms = static_cast<long>(PREPROCESS_SECONDS * 1000.0f);
+
+    PianoVisualizer piano;
+    auto preprocess = [&] {
+        PreprocessStats stats;
+        piano.preprocessTrack(
+            emu, 0, SAMPLE_RATE, layout, [&probe](Music_Emu*, ChannelTable& table) { table.sample(probe); },
+            probe.playInterval(), nullptr, [max_ms](Music_Emu* e) { return gme_tell(e) < max_ms; }, nullptr,
+            &stats);
+        pass_stats->add(stats);
+    };
+    bench("preprocessTrack/30s", preprocess);
+
+    // The piano roll's culling: the notes overlapping a 5 s window, swept
+    // along the track a frame at a time
+    preprocess();
+    const PreprocessedTrack track = piano.takePreprocessedData();
+    gme_delete(emu);
+    if (track.notes.empty()) return;
+    const PianoVisualizer::NoteData notes(track.notes, track.duration);
+    std::vector<uint32_t> visible;
+    int64_t t = 0;
+    bench("notesBetween/5s", [&] {
+        notes.notesBetween(t, t + 5 * NoteClock::RATE, visible);
+        sink = static_cast<float>(visible.size());
+        t = t + NoteClock::RATE / 60 < track.duration ? t + NoteClock::RATE / 60 : 0;
+    });
+}
+
+void addNesBenchmarks(const Bench& bench, const char* rom_path) {
+    NesEmulator emu;
+    if (!emu.init(SAMPLE_RATE) || !emu.loadROM(rom_path)) {
+        std::fprintf(stderr, "could not load %s\n", rom_path);
+        return;
+    }
+    emu.resume();
+    std::vector<short> samples(SAMPLE_RATE / 10);
+    int frame = 0;
+    for (bool present : {false, true}) {
+        bench(present ? "runFrame+screen" : "runFrame", [&, present] {
+            // Start tapped, then Right held, as nes_bench does without a script
+            agnes_input_t input = {};
+            input.start = frame % 120 < 5;
+            input.right = frame >= 600;
+            emu.setInput(0, input);
+            emu.runFrame(present);
+            emu.updateScreenTexture();
+            emu.readAudioSamples(samples.data(), static_cast<int>(samples.size()));
+            ++frame;
+        });
+    }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const char* nsf_path = "3rd_party/Game_Music_Emu/test.nsf";
+    const char* rom_path = nullptr;
+    const char* filter = "";
+    int epochs = 11;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--nsf") == 0 && i + 1 < argc) {
+            nsf_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            rom_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--epochs") == 0 && i + 1 < argc) {
+            epochs = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::fprintf(stderr, "usage: %s [--nsf file.nsf] [--rom rom.nes] [--filter text] [--epochs N]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    auto bench = [&](const std::string& name, const std::function<void()>& body) {
+        if (name.find(filter) == std::string::npos) return;
+        results.push_back(measure(name, epochs, body));
+        std::fprintf(stderr, "%-28s %12.1f ns\n", name.c_str(), results.back().median_ns);
+    };
+    addFftBenchmarks(bench);
+    addVisualizerBenchmarks(bench);
+    PreprocessStats pass_stats;
+    addNoteBenchmarks(bench, nsf_path, &pass_stats);
+    if (rom_path) addNesBenchmarks(bench, rom_path);
+
+    std::printf("{\n  \"epochs\": %d,\n  \"benchmarks\": [", epochs);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::printf("%s\n    {\"name\": \"%s\", \"iterations\": %ld, \"median_ns\": %.1f, \"min_ns\": %.1f, "
+                    "\"max_ns\": %.1f}",
+                    i ? "," : "", r.name.c_str(), r.iterations, r.median_ns, r.min_ns, r.max_ns);
+    }
+    std::printf("\n  ]");
+    if (pass_stats.passes > 0 && pass_stats.wall_seconds > 0.0) {
+        // Where the preprocessTrack() iterations went, as fractions of their wall time
+        const PreprocessStats& p = pass_stats;
+        std::fprintf(stderr, "%-28s %12.1f x realtime\n", "preprocessTrack", p.realtimeFactor());
+        std::printf(",\n  \"preprocess\": {\"passes\": %d, \"realtime_factor\": %.1f, \"emulate\": %.3f, "
+                    "\"extract\": %.3f, \"sort\": %.3f, \"notes_per_pass\": %.1f}",
+                    p.passes, p.realtimeFactor(), p.emulate_seconds / p.wall_seconds,
+                    p.extract_seconds / p.wall_seconds, p.sort_seconds / p.wall_seconds,
+                    static_cast<double>(p.notes) / p.passes);
+    }
+    std::printf("\n}\n");
+    return 0;
+}
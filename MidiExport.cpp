@@ -0,0 +1,137 @@
+#include "MidiExport.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr int64_t TICKS_PER_SECOND = int64_t(MidiExport::TICKS_PER_QUARTER) * 1000000 / MidiExport::TEMPO_USEC_PER_QUARTER;
+
+// From NoteClock ticks, rounded
+uint32_t toTicks(int64_t time) {
+    return static_cast<uint32_t>((std::max<int64_t>(0, time) * TICKS_PER_SECOND + NoteClock::RATE / 2) / NoteClock::RATE);
+}
+
+void putBig(std::ofstream& out, uint32_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; --i) out.put(static_cast<char>((value >> (i * 8)) & 0xFF));
+}
+
+void putVarLen(std::ofstream& out, uint32_t value) {
+    unsigned char bytes[5];
+    int count = 0;
+    do {
+        bytes[count++] = value & 0x7F;
+        value >>= 7;
+    } while (value);
+    while (count > 1) out.put(static_cast<char>(bytes[--count] | 0x80));
+    out.put(static_cast<char>(bytes[0]));
+}
+
+// One MTrk chunk; its length is patched in once the events are written
+class TrackChunk {
+public:
+    explicit TrackChunk(std::ofstream& out) : out_(out) {
+        out_.write("MTrk", 4);
+        length_at_ = out_.tellp();
+        putBig(out_, 0, 4);
+    }
+
+    void event(uint32_t tick, const unsigned char* data, size_t size) {
+        putVarLen(out_, tick - last_tick_);
+        out_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        last_tick_ = tick;
+    }
+
+    void meta(uint32_t tick, unsigned char type, const void* data, size_t size) {
+        putVarLen(out_, tick - last_tick_);
+        out_.put(static_cast<char>(0xFF));
+        out_.put(static_cast<char>(type));
+        putVarLen(out_, static_cast<uint32_t>(size));
+        out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        last_tick_ = tick;
+    }
+
+    void finish() {
+        meta(last_tick_, 0x2F, nullptr, 0);
+        const std::streampos end = out_.tellp();
+        out_.seekp(length_at_);
+        putBig(out_, static_cast<uint32_t>(end - length_at_ - 4), 4);
+        out_.seekp(end);
+    }
+
+private:
+    std::ofstream& out_;
+    std::streampos length_at_;
+    uint32_t last_tick_ = 0;
+};
+
+}  // namespace
+
+bool MidiExport::write(const std::string& path, const PreprocessedTrack& track, const ChannelTable& layout) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    out.write("MThd", 4);
+    putBig(out, 6, 4);
+    putBig(out, 1, 2);                   // Simultaneous tracks
+    putBig(out, 1 + layout.count, 2);    // Tempo map, then one per channel
+    putBig(out, TICKS_PER_QUARTER, 2);
+
+    {
+        TrackChunk tempo(out);
+        const unsigned char usec[3] = {
+            static_cast<unsigned char>(TEMPO_USEC_PER_QUARTER >> 16),
+            static_cast<unsigned char>(TEMPO_USEC_PER_QUARTER >> 8),
+            static_cast<unsigned char>(TEMPO_USEC_PER_QUARTER),
+        };
+        tempo.meta(0, 0x51, usec, sizeof(usec));
+        tempo.finish();
+    }
+
+    // Notes come sorted by start. A channel rarely has more than one note
+    // sounding, so the offs still due are a short list kept sorted by tick.
+    struct NoteOff {
+        uint32_t tick;
+        unsigned char key;
+    };
+    std::vector<NoteOff> offs;
+    for (int ch = 0; ch < layout.count; ++ch) {
+        TrackChunk chunk(out);
+        chunk.meta(0, 0x03, layout.name[ch], std::strlen(layout.name[ch]));
+        const unsigned char status = static_cast<unsigned char>(ch & 0x0F);
+
+        auto flush_until = [&](uint32_t tick) {
+            size_t n = 0;
+            for (; n < offs.size() && offs[n].tick <= tick; ++n) {
+                const unsigned char off[3] = {static_cast<unsigned char>(0x80 | status), offs[n].key, 0};
+                chunk.event(offs[n].tick, off, sizeof(off));
+            }
+            offs.erase(offs.begin(), offs.begin() + n);
+        };
+
+        offs.clear();
+        for (const PianoRollNote& note : track.notes) {
+            if (note.channel != ch || note.midi_note < 0 || note.midi_note > 127) continue;
+            const uint32_t start = toTicks(note.start);
+            const uint32_t end = std::max(toTicks(note.end), start + 1);
+            flush_until(start);
+
+            const int velocity = std::clamp(static_cast<int>(std::lround(note.velocity * 127.0f)), 1, 127);
+            const unsigned char on[3] = {static_cast<unsigned char>(0x90 | status),
+                                         static_cast<unsigned char>(note.midi_note),
+                                         static_cast<unsigned char>(velocity)};
+            chunk.event(start, on, sizeof(on));
+
+            const NoteOff off = {end, static_cast<unsigned char>(note.midi_note)};
+            offs.insert(std::upper_bound(offs.begin(), offs.end(), off,
+                                         [](const NoteOff& a, const NoteOff& b) { return a.tick < b.tick; }),
+                        off);
+        }
+        flush_until(UINT32_MAX);
+        chunk.finish();
+    }
+    return static_cast<bool>(out.flush());
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ChannelRegistry.h"
+#include "PianoVisualizer.h"
+#include <string>
+
+// Standard MIDI File (format 1) writer for preprocessed notes. Events are
+// streamed straight from the note list to the file, one MIDI track per
+// channel of the layout, so nothing is copied however long the track is.
+// Velocity follows the sampled channel volume.
+class MidiExport {
+public:
+    // 120 bpm, so 960 ticks a second
+    static constexpr int TICKS_PER_QUARTER = 480;
+    static constexpr int TEMPO_USEC_PER_QUARTER = 500000;
+
+    // Write a track's notes to path; false if the file could not be written
+    static bool write(const std::string& path, const PreprocessedTrack& track, const ChannelTable& layout);
+};
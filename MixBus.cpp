@@ -0,0 +1,153 @@
+#include "MixBus.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Taps the delay line holds at most: the emulator's lead plus a capture's
+// worth, with room to spare
+constexpr size_t MAX_DELAY_FRAMES = 32768;
+
+// Frames fitted with one gain: Music_Emu's fade steps every 512 samples
+constexpr int GAIN_FRAMES = 256;
+
+}  // namespace
+
+void MixBus::resize(size_t frames) {
+    size_t size = 1;
+    while (size < frames) size <<= 1;
+    shares_.assign(size * ENTRIES, 0);
+    mask_ = size - 1;
+    delay_.clear();
+    delay_read_ = 0;
+}
+
+void MixBus::setChannels(const ChannelTable& table) {
+    for (int e = 0; e < ENTRIES; ++e) {
+        voices_[e].store(e < table.count ? table.voice[e] : -1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t MixBus::mutedEntries(int voice_mask) const {
+    uint32_t muted = 0;
+    for (int e = 0; e < ENTRIES; ++e) {
+        const int voice = voices_[e].load(std::memory_order_relaxed);
+        if (voice >= 0 && voice < 32 && (voice_mask >> voice) & 1) muted |= 1u << e;
+    }
+    return muted;
+}
+
+void MixBus::feed(const short* taps, int frames, int tap_count, const int* tap_channels) {
+    if (!taps || frames <= 0 || tap_count <= 0) return;
+
+    // Drop the oldest beyond the limit, and compact once the frames read
+    // outnumber those kept
+    const size_t kept = delay_.size() / ENTRIES - delay_read_;
+    if (kept + frames > MAX_DELAY_FRAMES) delay_read_ += std::min(kept, kept + frames - MAX_DELAY_FRAMES);
+    if (delay_read_ >= kept) {
+        delay_.erase(delay_.begin(), delay_.begin() + delay_read_ * ENTRIES);
+        delay_read_ = 0;
+    }
+
+    // Sum the taps of each entry, as the tap buffer sums them all
+    const size_t at = delay_.size();
+    delay_.resize(at + static_cast<size_t>(frames) * ENTRIES, 0);
+    short* dst = delay_.data() + at;
+    for (int i = 0; i < frames; ++i, dst += ENTRIES) {
+        const short* src = taps + static_cast<size_t>(i) * tap_count;
+        for (int t = 0; t < tap_count; ++t) {
+            const int entry = tap_channels ? tap_channels[t] : t;
+            if (entry < 0 || entry >= ENTRIES) continue;
+            dst[entry] = static_cast<short>(std::clamp(dst[entry] + src[t], -32768, 32767));
+        }
+    }
+}
+
+void MixBus::write(int64_t output_frame, const short* mix, int frames, long lead) {
+    if (shares_.empty() || frames <= 0) return;
+
+    // The block's taps are the ones captured before the last lead frames;
+    // frames older than the delay line are missing from the front
+    const int64_t queued = static_cast<int64_t>(delay_.size() / ENTRIES - delay_read_);
+    const int64_t older = queued - std::max<int64_t>(lead, 0) - frames;
+    if (older > 0) delay_read_ += static_cast<size_t>(older);
+    const int missing = static_cast<int>(std::clamp<int64_t>(-older, 0, frames));
+
+    for (int i = 0; i < missing; ++i) std::memset(frameAt(output_frame + i), 0, ENTRIES * sizeof(short));
+
+    // What of the taps reached the output (the fade, or clipping): the least
+    // squares gain of their sum against the mix, so a muted entry comes out
+    // of a fading track at its faded level
+    const short* src = delay_.data() + delay_read_ * ENTRIES;
+    for (int start = missing; start < frames; start += GAIN_FRAMES) {
+        const int end = std::min(frames, start + GAIN_FRAMES);
+        double match = 0.0, power = 0.0;
+        const short* frame = src;
+        for (int i = start; i < end; ++i, frame += ENTRIES) {
+            int sum = 0;
+            for (int e = 0; e < ENTRIES; ++e) sum += frame[e];
+            match += static_cast<double>(mix[i * 2]) * sum;
+            power += static_cast<double>(sum) * sum;
+        }
+        const float gain = power > 0.0 ? static_cast<float>(std::clamp(match / power, 0.0, 1.0)) : 1.0f;
+
+        for (int i = start; i < end; ++i, src += ENTRIES) {
+            short* dst = frameAt(output_frame + i);
+            if (gain == 1.0f) {
+                std::memcpy(dst, src, ENTRIES * sizeof(short));
+            } else {
+                for (int e = 0; e < ENTRIES; ++e) dst[e] = static_cast<short>(src[e] * gain);
+            }
+        }
+    }
+    delay_read_ += static_cast<size_t>(frames - missing);
+}
+
+void MixBus::writeSilent(int64_t output_frame, int frames) {
+    if (shares_.empty()) return;
+    for (int i = 0; i < frames; ++i) std::memset(frameAt(output_frame + i), 0, ENTRIES * sizeof(short));
+}
+
+void MixBus::restart() {
+    delay_.clear();
+    delay_read_ = 0;
+}
+
+int MixBus::listEntries(uint32_t muted, int* entries) {
+    int count = 0;
+    for (int e = 0; e < ENTRIES; ++e) {
+        if ((muted >> e) & 1) entries[count++] = e;
+    }
+    return count;
+}
+
+void MixBus::removeMuted(int64_t output_frame, float* stereo, int frames, float scale, uint32_t muted) const {
+    if (shares_.empty() || muted == 0) return;
+    int entries[ENTRIES];
+    const int count = listEntries(muted, entries);
+    for (int i = 0; i < frames; ++i) {
+        const short* share = frameAt(output_frame + i);
+        int sum = 0;
+        for (int m = 0; m < count; ++m) sum += share[entries[m]];
+        const float removed = sum * scale;
+        stereo[i * 2] -= removed;
+        stereo[i * 2 + 1] -= removed;
+    }
+}
+
+void MixBus::removeMuted(int64_t output_frame, short* stereo, int frames, uint32_t muted) const {
+    if (shares_.empty() || muted == 0) return;
+    int entries[ENTRIES];
+    const int count = listEntries(muted, entries);
+    for (int i = 0; i < frames; ++i) {
+        const short* share = frameAt(output_frame + i);
+        int sum = 0;
+        for (int m = 0; m < count; ++m) sum += share[entries[m]];
+        stereo[i * 2] = static_cast<short>(std::clamp(stereo[i * 2] - sum, -32768, 32767));
+        stereo[i * 2 + 1] = static_cast<short>(std::clamp(stereo[i * 2 + 1] - sum, -32768, 32767));
+    }
+}
+
+size_t MixBus::memoryBytes() const {
+    return shares_.capacity() * sizeof(short) + delay_.capacity() * sizeof(short);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ChannelRegistry.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Every table entry's share of the render-ahead queue, kept alongside it so
+// mutes and solos apply to audio already rendered, at the next sample
+// played, instead of after the queue drains as gme_mute_voices() does. The
+// NSF taps (ChannelTapBuffer) sum exactly to the output, so taking a muted
+// entry's share back out of the mix leaves what gme would have rendered
+// without it.
+//
+// The shares live in a circular array indexed by output frame, the stream
+// frame of the output ring, so they never need resyncing when that ring is
+// flushed. The render thread writes a block's shares before it publishes
+// the block's frames, and the audio callback reads them while it still
+// holds the frames, so the output ring's own ordering covers both.
+class MixBus {
+public:
+    static constexpr int ENTRIES = ChannelTable::MAX_CHANNELS;
+
+    MixBus() = default;
+    MixBus(const MixBus&) = delete;
+    MixBus& operator=(const MixBus&) = delete;
+
+    // Room for as many frames as the output ring holds (rounded up to a
+    // power of 2); before either thread runs
+    void resize(size_t frames);
+
+    // The voice behind each table entry, for mutedEntries() (any thread)
+    void setChannels(const ChannelTable& table);
+    // Entries whose voice is in voice_mask
+    uint32_t mutedEntries(int voice_mask) const;
+
+    // Render thread. feed() takes taps as ChannelTapBuffer::takeTaps()
+    // gives them, tap_channels mapping each to an entry or -1. They lead the
+    // output by the emulator's own buffering, so they wait in a delay line
+    // until write() is given that block: frames of output at output_frame,
+    // whose taps the emulator read lead frames ago. Those that never were
+    // (capture started late) are zero. restart() empties the delay line,
+    // for a seek or another emulator.
+    void feed(const short* taps, int frames, int tap_count, const int* tap_channels);
+    void write(int64_t output_frame, const short* mix, int frames, long lead);
+    // Frames rendered without taps, such as a prefetched opening
+    void writeSilent(int64_t output_frame, int frames);
+    void restart();
+
+    // Take the muted entries' shares out of frames of stereo at
+    // output_frame, as floats at scale per unit (the callback's volume over
+    // 32768) or in place as the int16 the emulator rendered
+    void removeMuted(int64_t output_frame, float* stereo, int frames, float scale, uint32_t muted) const;
+    void removeMuted(int64_t output_frame, short* stereo, int frames, uint32_t muted) const;
+
+    size_t memoryBytes() const;
+
+private:
+    short* frameAt(int64_t output_frame) { return &shares_[(static_cast<size_t>(output_frame) & mask_) * ENTRIES]; }
+    const short* frameAt(int64_t output_frame) const {
+        return &shares_[(static_cast<size_t>(output_frame) & mask_) * ENTRIES];
+    }
+
+    static int listEntries(uint32_t muted, int* entries);  // The set bits' entries, lowest first
+
+    std::vector<short> shares_;  // ENTRIES per frame
+    size_t mask_ = 0;
+    std::array<std::atomic<int>, ENTRIES> voices_{};
+
+    // Delay line (render thread): ENTRIES per frame, oldest at delay_read_
+    std::vector<short> delay_;
+    size_t delay_read_ = 0;
+};
@@ -0,0 +1,243 @@
+#include "MultiView.h"
+#include "Trace.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+namespace {
+
+constexpr int GME_CHUNK_FRAMES = 512;
+constexpr int SCRATCH_FRAMES = 4096;  // More than a NES frame's samples, and the emulator's leftovers
+
+bool isRom(const std::string& path) {
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".nes";
+}
+
+}  // namespace
+
+MultiView::~MultiView() {
+    clear();
+}
+
+bool MultiView::add(const std::string& path, std::string* error) {
+    auto fail = [&](const std::string& message) {
+        error_ = message;
+        if (error) *error = message;
+        return false;
+    };
+    int slot = 0;
+    while (slot < MAX_CELLS && cells_[slot]) ++slot;
+    if (slot == MAX_CELLS) return fail("The grid is full");
+
+    auto cell = std::make_unique<Cell>();
+    cell->name = std::filesystem::path(path).filename().string();
+    if (isRom(path)) {
+        cell->nes = std::make_unique<NesEmulator>();
+        if (!cell->nes->init(sample_rate_) || !cell->nes->loadROM(path.c_str())) {
+            cell->nes->destroyTextures();
+            return fail("Could not load " + cell->name);
+        }
+        cell->nes->resume();
+    } else {
+        gme_err_t err = nullptr;
+        cell->file = MusicFile::read(path.c_str(), &err);
+        if (cell->file) err = open_music_emu(*cell->file, &cell->music, sample_rate_);
+        if (!err && cell->music) err = gme_start_track(cell->music, 0);
+        if (err || !cell->music) {
+            if (cell->music) gme_delete(cell->music);
+            return fail(std::string(err ? err : "Could not open") + ": " + cell->name);
+        }
+    }
+    cell->bus.resize(static_cast<size_t>(sample_rate_) * BUS_MS / 1000 * 2);
+    cell->scratch.assign(SCRATCH_FRAMES * 2, 0);
+
+    live_[slot].store(cell.get(), std::memory_order_seq_cst);
+    cells_[slot] = std::move(cell);
+    ++count_;
+    error_.clear();
+    publishNames();
+    return true;
+}
+
+void MultiView::remove(int index) {
+    if (index < 0 || index >= MAX_CELLS || !cells_[index]) return;
+    // Out of the mix first: once no callback is inside mix(), none holds it
+    live_[index].store(nullptr, std::memory_order_seq_cst);
+    while (mixing_.load(std::memory_order_seq_cst)) std::this_thread::yield();
+    destroy(std::move(cells_[index]));
+    --count_;
+    publishNames();
+}
+
+void MultiView::clear() {
+    for (int i = 0; i < MAX_CELLS; ++i) remove(i);
+}
+
+void MultiView::destroy(std::unique_ptr<Cell> cell) {
+    JobPool::shared().cancel(cell->job);
+    JobPool::shared().wait(cell->job);
+    if (cell->nes) cell->nes->destroyTextures();
+    if (cell->music) gme_delete(cell->music);
+}
+
+void MultiView::publishNames() {
+    for (int i = 0; i < MAX_CELLS; ++i) {
+        FrameProfiler::setInstanceName(i, cells_[i] ? cells_[i]->name : std::string());
+    }
+}
+
+void MultiView::tick() {
+    const size_t target = static_cast<size_t>(sample_rate_) * TARGET_MS / 1000 * 2;
+    for (int i = 0; i < MAX_CELLS; ++i) {
+        Cell* cell = cells_[i].get();
+        if (!cell) continue;
+        if (cell->nes) cell->nes->updateScreenTexture();
+        // One job at a time per cell; High, as the cell's audio waits on it
+        if (cell->job.busy() || cell->failed.load(std::memory_order_relaxed)) continue;
+        if (cell->bus.readAvailable() >= target) continue;
+        JobPool::shared().submit(cell->job, JobPool::Priority::High, [this, cell, i]() { run(*cell, i); });
+    }
+}
+
+void MultiView::run(Cell& cell, int index) {
+    FC_ZONE("MultiView::run");
+    const FrameProfiler::Clock::time_point start = FrameProfiler::Clock::now();
+    const size_t target = static_cast<size_t>(sample_rate_) * TARGET_MS / 1000 * 2;
+    short* block = cell.scratch.data();
+
+    while (!cell.job.cancelled() && cell.bus.readAvailable() < target) {
+        int frames = 0;
+        if (cell.nes) {
+            // The emulator's frame of audio, centred voices as stereo
+            cell.nes->runFrame(true);
+            frames = cell.nes->readAudioStereo(block, SCRATCH_FRAMES);
+        } else {
+            if (gme_track_ended(cell.music)) gme_start_track(cell.music, 0);  // Around again, for a demo
+            if (gme_play(cell.music, GME_CHUNK_FRAMES * 2, block)) {
+                cell.failed.store(true, std::memory_order_relaxed);
+                break;
+            }
+            frames = GME_CHUNK_FRAMES;
+            std::lock_guard<std::mutex> lock(cell.scope_mutex);
+            for (int f = 0; f < SCOPE_FRAMES; ++f) {
+                const short* frame = block + (frames - SCOPE_FRAMES + f) * 2;
+                cell.scope[f] = (frame[0] + frame[1]) * (0.5f / 32768.0f);
+            }
+        }
+        if (frames <= 0) break;
+        cell.bus.push(block, static_cast<size_t>(frames) * 2);
+    }
+
+    const FrameProfiler::Clock::duration spent = FrameProfiler::Clock::now() - start;
+    FrameProfiler::add(FrameProfiler::EMULATION, spent);
+    FrameProfiler::addInstance(index, spent);
+    const float ms = std::chrono::duration<float, std::milli>(spent).count();
+    const float smoothed = cell.job_ms.load(std::memory_order_relaxed);
+    cell.job_ms.store(smoothed + (ms - smoothed) * 0.05f, std::memory_order_relaxed);
+}
+
+void MultiView::mix(float* out, int frames, float gain) {
+    mixing_.store(true, std::memory_order_seq_cst);
+    for (int i = 0; i < MAX_CELLS; ++i) {
+        Cell* cell = live_[i].load(std::memory_order_seq_cst);
+        if (!cell) continue;
+        // A muted cell still drains, so it comes back in step
+        const float cell_gain = cell->muted.load(std::memory_order_relaxed)
+                                    ? 0.0f
+                                    : gain * cell->gain.load(std::memory_order_relaxed) / 32768.0f;
+        const size_t got = cell->bus.popInPlace(static_cast<size_t>(frames) * 2,
+                                                [&](const short* src, size_t offset, size_t n) {
+                                                    float* dst = out + offset;
+                                                    for (size_t s = 0; s < n; ++s) dst[s] += src[s] * cell_gain;
+                                                });
+        if (got < static_cast<size_t>(frames) * 2) {
+            cell->underrun_frames.fetch_add(static_cast<int64_t>(frames - got / 2), std::memory_order_relaxed);
+        }
+    }
+    mixing_.store(false, std::memory_order_seq_cst);
+}
+
+bool MultiView::drawWindow(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(820, 700), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Multi View", p_open)) {
+        ImGui::End();
+        return false;
+    }
+
+    ImGui::BeginDisabled(count_ >= MAX_CELLS);
+    const bool add_pressed = ImGui::Button("Add...");
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) clear();
+    ImGui::SameLine();
+    ImGui::TextDisabled("%d of %d cells; costs in the Frame Profiler", count_, MAX_CELLS);
+    if (!error_.empty()) ImGui::TextColored(ImVec4(0.8f, 0.3f, 0.3f, 1.0f), "%s", error_.c_str());
+
+    // Square-ish grid of the cells, each scaled to its column
+    const int columns = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count_)))));
+    const float spacing = ImGui::GetStyle().ItemSpacing.x;
+    const float cell_width = std::max(64.0f, (ImGui::GetContentRegionAvail().x - spacing * (columns - 1)) / columns);
+    const float scale = cell_width / static_cast<float>(AGNES_SCREEN_WIDTH);
+    const ImVec2 screen_size(cell_width, static_cast<float>(AGNES_SCREEN_HEIGHT) * scale);
+    int shown = 0;
+    int remove_index = -1;
+    for (int i = 0; i < MAX_CELLS; ++i) {
+        Cell* cell = cells_[i].get();
+        if (!cell) continue;
+        if (shown++ % columns != 0) ImGui::SameLine();
+        ImGui::PushID(i);
+        ImGui::BeginGroup();
+        if (cell->nes) {
+            cell->nes->drawScreen(scale);
+        } else {
+            // No picture of its own: the newest block's waveform
+            const ImVec2 origin = ImGui::GetCursorScreenPos();
+            ImGui::Dummy(screen_size);
+            ImDrawList* draw = ImGui::GetWindowDrawList();
+            draw->AddRectFilled(origin, ImVec2(origin.x + screen_size.x, origin.y + screen_size.y),
+                                IM_COL32(16, 18, 24, 255));
+            ImVec2 points[SCOPE_FRAMES];
+            {
+                std::lock_guard<std::mutex> lock(cell->scope_mutex);
+                for (int f = 0; f < SCOPE_FRAMES; ++f) {
+                    points[f] = ImVec2(origin.x + screen_size.x * f / (SCOPE_FRAMES - 1),
+                                       origin.y + screen_size.y * (0.5f - 0.45f * cell->scope[f]));
+                }
+            }
+            draw->AddPolyline(points, SCOPE_FRAMES, IM_COL32(102, 230, 179, 255), ImDrawFlags_None, 1.5f);
+        }
+        ImGui::PushItemWidth(cell_width * 0.5f);
+        ImGui::TextUnformatted(cell->name.c_str());
+        float gain = cell->gain.load(std::memory_order_relaxed);
+        if (ImGui::SliderFloat("##gain", &gain, 0.0f, 1.0f, "%.2f")) cell->gain.store(gain);
+        ImGui::PopItemWidth();
+        ImGui::SameLine();
+        bool muted = cell->muted.load(std::memory_order_relaxed);
+        if (ImGui::Checkbox("Mute", &muted)) cell->muted.store(muted);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("X")) remove_index = i;
+        ImGui::TextDisabled("%.2f ms a job, %.0f ms short%s", cell->job_ms.load(std::memory_order_relaxed),
+                            cell->underrun_frames.load(std::memory_order_relaxed) * 1000.0 / sample_rate_,
+                            cell->failed.load(std::memory_order_relaxed) ? ", stopped on an error" : "");
+        ImGui::EndGroup();
+        ImGui::PopID();
+    }
+    if (remove_index >= 0) remove(remove_index);
+    ImGui::End();
+    return add_pressed;
+}
+
+void MultiView::reportMemory(MemoryReport::Sample& sample) const {
+    for (const auto& cell : cells_) {
+        if (!cell) continue;
+        if (cell->nes) cell->nes->reportMemory(sample);
+        if (cell->music) report_music_emu_memory(cell->music, sample);
+        sample.add(MemoryReport::AUDIO_QUEUES, cell->bus.memoryBytes() + MemoryReport::heapBytes(cell->scratch));
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ChannelTaps.h"
+#include "FrameProfiler.h"
+#include "JobPool.h"
+#include "MemoryReport.h"
+#include "NesEmulator.h"
+#include "SpscRing.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Several games and NSFs running at once in a grid, for demo stations. Each
+// cell is an emulator of its own, a NesEmulator with its own screen texture
+// or a gme Music_Emu, and has its own audio bus: a ring of stereo frames.
+// No cell has a thread. Once a UI frame tick() queues a job per cell on the
+// shared JobPool, which emulates until the bus holds TARGET_MS again, so the
+// cells are paced by what the audio callback takes; mix() adds every bus into
+// the device buffer. Each cell's job time shows as an instance row of the
+// Frame Profiler, and counts toward its Emulation section.
+class MultiView {
+public:
+    static constexpr int MAX_CELLS = FrameProfiler::MAX_INSTANCES;
+    static constexpr int TARGET_MS = 80;   // Bus fill each job restores: a UI frame and a device buffer, with room
+    static constexpr int BUS_MS = 250;     // Bus capacity
+    static constexpr int SCOPE_FRAMES = 256;  // Waveform drawn in an NSF's cell
+
+    explicit MultiView(long sample_rate) : sample_rate_(sample_rate) {}
+    ~MultiView();
+    MultiView(const MultiView&) = delete;
+    MultiView& operator=(const MultiView&) = delete;
+
+    // UI thread. A cell playing path: a .nes ROM, or the first track of any
+    // file gme reads. false with *error set if it cannot be opened or the
+    // grid is full.
+    bool add(const std::string& path, std::string* error);
+    void remove(int index);
+    void clear();
+    int count() const { return count_; }
+
+    // UI thread, once a frame: queue each cell's job and upload the screens
+    // of those that finished a frame
+    void tick();
+
+    // Audio thread: add frames of every unmuted bus into out (stereo), at gain
+    void mix(float* out, int frames, float gain);
+
+    // Draw the "Multi View" window (UI thread); true when its Add button
+    // was pressed, for the caller's file dialog
+    bool drawWindow(bool* p_open);
+
+    void reportMemory(MemoryReport::Sample& sample) const;
+
+private:
+    struct Cell {
+        std::string name;
+        std::unique_ptr<NesEmulator> nes;
+        std::shared_ptr<const MusicFile> file;  // The Music_Emu reads it in place
+        Music_Emu* music = nullptr;
+        SpscRing<short> bus;                  // Interleaved stereo
+        std::vector<short> scratch;           // A job's block, before the bus
+        JobPool::Group job;
+        std::atomic<float> gain{1.0f};
+        std::atomic<bool> muted{false};
+        std::atomic<bool> failed{false};      // gme_play() returned an error; the cell is silent
+        std::atomic<int64_t> underrun_frames{0};  // Frames mix() wanted and the bus lacked
+        std::atomic<float> job_ms{0.0f};      // Smoothed cost of a job
+        std::mutex scope_mutex;
+        std::array<float, SCOPE_FRAMES> scope{};  // Newest mono frames of an NSF's blocks
+    };
+
+    void run(Cell& cell, int index);  // A cell's job (pool worker)
+    void destroy(std::unique_ptr<Cell> cell);  // Stop its job, free it (UI thread)
+    void publishNames();  // Cell names to the Frame Profiler's instance rows
+
+    long sample_rate_;
+    // Cells by slot, which is also a cell's profiler row: the UI thread
+    // owns them, the audio thread reads through live_ while mixing_ is set,
+    // and remove() waits it out
+    std::array<std::unique_ptr<Cell>, MAX_CELLS> cells_;
+    std::array<std::atomic<Cell*>, MAX_CELLS> live_{};
+    std::atomic<bool> mixing_{false};
+    int count_ = 0;
+    std::string error_;  // The last add() that failed, for the window
+};
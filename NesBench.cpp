@@ -0,0 +1,116 @@
+// Headless NES emulation benchmark: runs a ROM for a number of frames with
+// scripted input, as fast as it goes, and reports throughput. Built from
+// NesEmulator with NES_HEADLESS, so nothing of sokol_gfx, ImGui or Vulkan
+// is in the measurement.
+//
+//   nes_bench <rom.nes> [--frames N] [--input script.txt] [--no-screen] [--dot-ppu] [--no-catch-up]
+//             [--pipelined-ppu]
+//
+// Scripts are as InputScript reads them, text or a recorded movie. Without one, Start is tapped every
+// two seconds and Right is held with A pulsed, which gets most games past
+// their menus.
+
+#include "NesEmulator.h"
+#include "InputScript.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+agnes_input_t defaultInput(int frame) {
+    agnes_input_t input = {};
+    input.start = frame % 120 < 5;
+    input.right = frame >= 600;
+    input.a = frame >= 600 && frame % 32 < 16;
+    return input;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const char* rom_path = nullptr;
+    const char* script_path = nullptr;
+    int frames = 3600;
+    bool present = true;
+    bool fast_ppu = true;
+    bool catch_up_ppu = true;
+    bool pipelined_ppu = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            script_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-screen") == 0) {
+            present = false;
+        } else if (std::strcmp(argv[i], "--dot-ppu") == 0) {
+            fast_ppu = false;
+        } else if (std::strcmp(argv[i], "--no-catch-up") == 0) {
+            catch_up_ppu = false;
+        } else if (std::strcmp(argv[i], "--pipelined-ppu") == 0) {
+            pipelined_ppu = true;
+        } else if (argv[i][0] != '-' && !rom_path) {
+            rom_path = argv[i];
+        } else {
+            rom_path = nullptr;
+            break;
+        }
+    }
+    if (!rom_path || frames <= 0) {
+        std::fprintf(stderr,
+                     "usage: %s <rom.nes> [--frames N] [--input script.txt] [--no-screen] [--dot-ppu]"
+                     " [--no-catch-up] [--pipelined-ppu]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    InputScript script;
+    std::string error;
+    if (script_path && !script.load(script_path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    constexpr long SAMPLE_RATE = 44100;
+    NesEmulator emu;
+    if (!emu.init(SAMPLE_RATE) || !emu.loadROM(rom_path)) {
+        std::fprintf(stderr, "could not load %s\n", rom_path);
+        return 1;
+    }
+    emu.setApuProfiling(true);
+    emu.setFastPpu(fast_ppu);
+    emu.setCatchUpPpu(catch_up_ppu);
+    emu.setPipelinedPpu(pipelined_ppu);
+    emu.resume();
+
+    // Audio is drained every frame, as the device would
+    std::vector<short> samples(SAMPLE_RATE / 10);
+    std::vector<short> taps(samples.size() * NesEmulator::TAP_COUNT);
+
+    const uint64_t start_cycles = emu.getCpuCycles();
+    const auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; ++f) {
+        emu.setInput(0, script_path ? script.at(f, 0) : defaultInput(f));
+        if (script_path) emu.setInput(1, script.at(f, 1));
+        emu.runFrame(present);
+        emu.updateScreenTexture();
+        emu.readAudioSamples(samples.data(), static_cast<int>(samples.size()));
+        emu.readChannelTaps(taps.data(), static_cast<int>(samples.size()));
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double cycles = static_cast<double>(emu.getCpuCycles() - start_cycles);
+    const double apu = emu.apuSeconds();
+
+    std::printf("rom      %s%s%s%s%s\n", rom_path, emu.hasVRC6() ? " (VRC6)" : "",
+                fast_ppu ? "" : " (dot-by-dot PPU)", catch_up_ppu ? "" : " (PPU kept in step)",
+                !pipelined_ppu ? "" : emu.ppuPipelineActive() ? " (PPU on a second core)" : " (PPU pipeline fell back to serial)");
+    std::printf("frames   %d in %.3f s: %.1f frames/s, %.1fx real time%s\n", frames, seconds, frames / seconds,
+                frames / seconds / (1789773.0 / 29780.5), present ? "" : " (no screen conversion)");
+    std::printf("cpu      %.1f M cycles: %.2f M cycles/s\n", cycles * 1e-6, cycles / seconds * 1e-6);
+    std::printf("apu      %.3f s: %.1f%% of the run, %.1f us a frame\n", apu, 100.0 * apu / seconds,
+                apu / frames * 1e6);
+    return 0;
+}
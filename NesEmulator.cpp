@@ -1,9 +1,29 @@
 #include "NesEmulator.h"
+#include "ApuTimeline.h"
+#include "FrameProfiler.h"
+#include "PpuPipeline.h"
+#include "Trace.h"
+#include "ZipArchive.h"
+#ifndef NES_HEADLESS
 #include "sokol_app.h"
 #include "util/sokol_imgui.h"
+#endif
 #include <cstring>
-#include <fstream>
 #include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#if defined(__AVX2__)
+#define NES_CONVERT_AVX2 1
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define NES_CONVERT_NEON 1
+#include <arm_neon.h>
+#elif defined(__wasm_simd128__)
+#define NES_CONVERT_WASM 1
+#include <wasm_simd128.h>
+#endif
 
 // NES color palette (NTSC - from Nestopia)
 const uint32_t NesEmulator::nes_palette_[64] = {
@@ -17,12 +37,240 @@ const uint32_t NesEmulator::nes_palette_[64] = {
     0xFFE4E594, 0xFFCFEF96, 0xFFBDF4AB, 0xFFB3F3CC, 0xFFB5EBF2, 0xFFB8B8B8, 0xFF000000, 0xFF000000
 };
 
+namespace {
+
+constexpr char STATE_MAGIC[4] = {'F', 'C', 'S', 'T'};
+
+struct StateHeader {
+    char magic[4];
+    uint16_t version;
+    uint8_t has_vrc6;
+    uint8_t reserved;
+    uint32_t machine_size;  // agnes_save_compact() bytes that follow
+};
+
+// hashState(): FNV-1a, as agnes_hash_state()
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ bytes[i]) * FNV_PRIME;
+    return hash;
+}
+
+uint32_t rgbaPixel(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    const uint8_t bytes[4] = {r, g, b, a};
+    uint32_t pixel;
+    std::memcpy(&pixel, bytes, sizeof(pixel));
+    return pixel;
+}
+
+// out[i] = lut[indices[i] & 0x3F]. AVX2 gathers 8 pixels at a time; on
+// AArch64 the table is split into byte planes for 16-byte four-register lookups.
+// WebAssembly has only a 16-entry swizzle, so each plane is four of them,
+// where an index out of a quarter's range picks zero.
+void indicesToPixels(const uint8_t* indices, const uint32_t* lut, uint32_t* out, int count) {
+    int i = 0;
+
+#if NES_CONVERT_AVX2
+    const __m256i mask = _mm256_set1_epi32(0x3F);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i));
+        const __m256i index = _mm256_and_si256(_mm256_cvtepu8_epi32(bytes), mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), index, 4));
+    }
+#elif NES_CONVERT_NEON
+    const uint8_t* table = reinterpret_cast<const uint8_t*>(lut);
+    uint8x16x4_t planes[4];  // r, g, b, a; 64 entries each
+    for (int k = 0; k < 4; ++k) {
+        const uint8x16x4_t quarter = vld4q_u8(table + k * 64);
+        for (int c = 0; c < 4; ++c) planes[c].val[k] = quarter.val[c];
+    }
+    const uint8x16_t mask = vdupq_n_u8(0x3F);
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16_t index = vandq_u8(vld1q_u8(indices + i), mask);
+        uint8x16x4_t pixels;
+        for (int c = 0; c < 4; ++c) pixels.val[c] = vqtbl4q_u8(planes[c], index);
+        vst4q_u8(reinterpret_cast<uint8_t*>(out + i), pixels);
+    }
+#elif NES_CONVERT_WASM
+    v128_t planes[4][4];  // [channel][quarter]: r, g, b, a of 16 entries each
+    for (int c = 0; c < 4; ++c) {
+        for (int k = 0; k < 4; ++k) {
+            uint8_t bytes[16];
+            for (int e = 0; e < 16; ++e) bytes[e] = static_cast<uint8_t>(lut[k * 16 + e] >> (c * 8));
+            planes[c][k] = wasm_v128_load(bytes);
+        }
+    }
+    const v128_t mask = wasm_i8x16_splat(0x3F);
+    const v128_t quarter = wasm_i8x16_splat(16);
+    for (; i + 16 <= count; i += 16) {
+        v128_t index = wasm_v128_and(wasm_v128_load(indices + i), mask);
+        v128_t channel[4];
+        for (int c = 0; c < 4; ++c) channel[c] = wasm_i8x16_swizzle(planes[c][0], index);
+        for (int k = 1; k < 4; ++k) {
+            index = wasm_i8x16_sub(index, quarter);
+            for (int c = 0; c < 4; ++c) channel[c] = wasm_v128_or(channel[c], wasm_i8x16_swizzle(planes[c][k], index));
+        }
+        
+        // Interleave the planes back into r, g, b, a pixels
+        const v128_t rg_lo = wasm_i8x16_shuffle(channel[0], channel[1], 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        const v128_t rg_hi = wasm_i8x16_shuffle(channel[0], channel[1], 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        const v128_t ba_lo = wasm_i8x16_shuffle(channel[2], channel[3], 0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        const v128_t ba_hi = wasm_i8x16_shuffle(channel[2], channel[3], 8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        wasm_v128_store(out + i, wasm_i16x8_shuffle(rg_lo, ba_lo, 0, 8, 1, 9, 2, 10, 3, 11));
+        wasm_v128_store(out + i + 4, wasm_i16x8_shuffle(rg_lo, ba_lo, 4, 12, 5, 13, 6, 14, 7, 15));
+        wasm_v128_store(out + i + 8, wasm_i16x8_shuffle(rg_hi, ba_hi, 0, 8, 1, 9, 2, 10, 3, 11));
+        wasm_v128_store(out + i + 12, wasm_i16x8_shuffle(rg_hi, ba_hi, 4, 12, 5, 13, 6, 14, 7, 15));
+    }
+#endif
+
+    for (; i < count; ++i) out[i] = lut[indices[i] & 0x3F];
+}
+
+// Adds the time until it goes out of scope to *total; does nothing with null
+class ScopedTimer {
+public:
+    explicit ScopedTimer(std::atomic<int64_t>* total) : total_(total) {
+        if (total_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (!total_) return;
+        const auto elapsed = std::chrono::steady_clock::now() - start_;
+        total_->fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                          std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t>* total_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#ifndef NES_HEADLESS
+// Palette lookup pass for Metal: one triangle covers the target, and each
+// pixel reads its index and then that entry of the palette
+const char* PALETTE_SHADER_MSL = R"(
+#include <metal_stdlib>
+using namespace metal;
+
+struct vs_out {
+    float4 pos [[position]];
+};
+
+vertex vs_out vs_main(uint vid [[vertex_id]]) {
+    const float2 corner = float2((vid << 1) & 2, vid & 2);
+    vs_out out;
+    out.pos = float4(corner * 2.0 - 1.0, 0.0, 1.0);
+    return out;
+}
+
+fragment float4 fs_main(vs_out in [[stage_in]],
+                        texture2d<float> indices [[texture(0)]],
+                        texture2d<float> palette [[texture(1)]],
+                        sampler smp [[sampler(0)]]) {
+    const uint index = uint(indices.read(uint2(in.pos.xy)).r * 255.0 + 0.5) & 63u;
+    return palette.read(uint2(index, 0));
+}
+)";
+
+// Screen filters for Metal, drawn over a target the size the screen is
+// shown at; both read the RGBA screen texel by texel
+const char* FILTER_SHADER_MSL = R"(
+#include <metal_stdlib>
+using namespace metal;
+
+struct vs_out {
+    float4 pos [[position]];
+    float2 uv;
+};
+
+vertex vs_out vs_main(uint vid [[vertex_id]]) {
+    const float2 corner = float2((vid << 1) & 2, vid & 2);
+    vs_out out;
+    out.pos = float4(corner * 2.0 - 1.0, 0.0, 1.0);
+    out.uv = float2(corner.x, 1.0 - corner.y);
+    return out;
+}
+
+static float3 texel(texture2d<float> screen, int2 p) {
+    p = clamp(p, int2(0), int2(screen.get_width() - 1, screen.get_height() - 1));
+    return screen.read(uint2(p)).rgb;
+}
+
+// Each NES line is a beam, brightest at its middle; pixels blend over a
+// steep ramp so edges stay crisp. An RGB grille runs over the output
+// pixels, and the light lost to both is made up in linear light.
+fragment float4 fs_crt(vs_out in [[stage_in]],
+                       texture2d<float> screen [[texture(0)]],
+                       sampler smp [[sampler(0)]]) {
+    const float2 pos = in.uv * float2(screen.get_width(), screen.get_height());
+    const float x = pos.x - 0.5;
+    const int2 p = int2(int(floor(x)), int(pos.y));
+    const float t = smoothstep(0.3, 0.7, fract(x));
+    float3 color = mix(powr(texel(screen, p), 2.2), powr(texel(screen, p + int2(1, 0)), 2.2), t);
+
+    const float dy = fract(pos.y) - 0.5;
+    color *= exp(-10.0 * dy * dy) * 1.8;
+    float3 grille = float3(0.7);
+    grille[uint(in.pos.x) % 3] = 1.0;
+    color *= grille;
+    return float4(powr(min(color, 1.0), 1.0 / 2.2), 1.0);
+}
+
+static float diff(float3 a, float3 b) {
+    return dot(abs(a - b), float3(0.299, 0.587, 0.114));
+}
+
+// xBR level 1: the corner of the source pixel E nearest the output point is
+// cut along the line between its two neighbours F and H there, when those
+// differ from E and the colour changes less along that line than across
+// it. Mirrored so the corner is always E's lower right in the names below:
+//        B  C
+//     D  E  F  F4
+//        H  I  I4
+//           H5 I5
+fragment float4 fs_xbr(vs_out in [[stage_in]],
+                       texture2d<float> screen [[texture(0)]],
+                       sampler smp [[sampler(0)]]) {
+    const float2 pos = in.uv * float2(screen.get_width(), screen.get_height());
+    const int2 e = int2(floor(pos));
+    const float2 f = fract(pos) - 0.5;
+    const int2 d = int2(f.x < 0.0 ? -1 : 1, f.y < 0.0 ? -1 : 1);
+#define AT(x, y) texel(screen, e + int2(x, y) * d)
+    const float3 E = AT(0, 0), B = AT(0, -1), C = AT(1, -1), D = AT(-1, 0), F = AT(1, 0);
+    const float3 G = AT(-1, 1), H = AT(0, 1), I = AT(1, 1);
+    const float3 F4 = AT(2, 0), I4 = AT(2, 1), H5 = AT(0, 2), I5 = AT(1, 2);
+#undef AT
+
+    const float along = diff(E, C) + diff(E, G) + diff(I, F4) + diff(I, H5) + 4.0 * diff(H, F);
+    const float across = diff(H, D) + diff(H, I5) + diff(F, I4) + diff(F, B) + 4.0 * diff(E, I);
+    if (along >= across || diff(E, F) == 0.0 || diff(E, H) == 0.0) {
+        return float4(E, 1.0);
+    }
+
+    // Past the line through the middles of E's right and bottom edges,
+    // antialiased over one output pixel
+    const float edge = abs(f.x) + abs(f.y) - 0.5;
+    const float w = fwidth(edge);
+    const float3 cut = diff(E, F) <= diff(E, H) ? F : H;
+    return float4(mix(E, cut, smoothstep(-w, w, edge)), 1.0);
+}
+)";
+#endif
+
+}  // namespace
+
 NesEmulator::NesEmulator() {
-    memset(screen_pixels_, 0, sizeof(screen_pixels_));
+    setPalette(Palette::Agnes);
     memset(input_, 0, sizeof(input_));
+    input_events_.reserve(MAX_INPUT_EVENTS);
+    frame_events_.reserve(MAX_INPUT_EVENTS);
 }
 
 NesEmulator::~NesEmulator() {
+    ppu_pipeline_.reset();  // May be drawing from agnes_' screen
     if (agnes_) {
         agnes_destroy(agnes_);
         agnes_ = nullptr;
@@ -38,9 +286,12 @@ bool NesEmulator::init(long audio_sample_rate) {
     if (!agnes_) {
         return false;
     }
+    agnes_set_fast_ppu(agnes_, fast_ppu_);
+    agnes_set_catch_up_ppu(agnes_, catch_up_ppu_);
     
     // Set up APU handlers
     agnes_set_apu_handler(agnes_, apuWriteCallback, apuReadCallback, this);
+    agnes_set_input_handler(agnes_, inputStrobeCallback, this);
     
     // Initialize APU
     initApu();
@@ -54,62 +305,60 @@ bool NesEmulator::init(long audio_sample_rate) {
 void NesEmulator::initApu() {
     // Set up Blip_Buffer
     // At 44100Hz, each frame generates ~735 samples
-    // Use 200ms buffer (~12 frames worth) for smooth audio with low latency
-    apu_buffer_.set_sample_rate(sample_rate_, 200);
-    apu_buffer_.clock_rate(static_cast<long>(CPU_CLOCK_NTSC));
+    // Default 200ms buffer (~12 frames worth), see setAudioBufferLength()
+    apu_buffer_.set_channel_count(TAP_COUNT);
+    apu_buffer_.setCapture(true);
+    apu_buffer_.set_sample_rate(sample_rate_, apu_buffer_ms_);
+    apu_buffer_.clock_rate(outputClockRate());
     
-    // Set up APU
-    apu_.output(&apu_buffer_);
+    // Set up APU, each oscillator into its own tap; VRC6 follows the APU's
+    // taps and is enabled if the game uses mapper 24/26
+    connectApuOutputs(true);
     apu_.dmc_reader(apuDmcReadCallback, this);
     apu_.reset(false);  // NTSC mode
-    
-    // Set up VRC6 APU (will be enabled if game uses mapper 24/26)
-    vrc6_apu_.output(&apu_buffer_);
     vrc6_apu_.reset();
     has_vrc6_ = false;
     
     last_apu_cycle_ = 0;
+    apu_log_.clear();
+    apu_log_.reserve(APU_LOG_RESERVE);
 }
 
 bool NesEmulator::loadROM(const char* path) {
-    std::ifstream file(path, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        return false;
-    }
-    
-    size_t size = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    rom_data_.resize(size);
-    if (!file.read(reinterpret_cast<char*>(rom_data_.data()), size)) {
-        return false;
-    }
-    
-    rom_path_ = path;
-    return loadROMData(rom_data_.data(), rom_data_.size());
+    std::shared_ptr<const MappedFile> image = ZipArchive::openPath(path);
+    return image && loadROMImage(std::move(image));
 }
 
 bool NesEmulator::loadROMData(const void* data, size_t size) {
-    if (!agnes_) return false;
+    return loadROMImage(MappedFile::copy(data, size));
+}
+
+bool NesEmulator::loadROMImage(std::shared_ptr<const MappedFile> image) {
+    if (!agnes_ || !image) return false;
     
     std::lock_guard<std::mutex> lock(mutex_);
     
     // Reset APU
     apu_.reset(false);
     vrc6_apu_.reset();
-    apu_buffer_.clear();
+    if (!lookahead_) apu_buffer_.clear();
     last_apu_cycle_ = 0;
+    apu_log_.clear();
     
-    // Load ROM into agnes
-    if (!agnes_load_ines_data(agnes_, const_cast<void*>(data), size)) {
+    // agnes only reads the cartridge, and does so from the image from now on
+    drainPpuPipeline();  // Power-on clears the screen buffer
+    const size_t size = image->size();
+    if (!agnes_load_ines_data(agnes_, const_cast<uint8_t*>(image->data()), size)) {
         rom_loaded_ = false;
         has_vrc6_ = false;
         return false;
     }
+    rom_ = std::move(image);
+    movie_mode_.store(MovieMode::None, std::memory_order_relaxed);
     
     // Check if this ROM uses VRC6 mapper (24 or 26)
     // Parse iNES header to get mapper number
-    const uint8_t* header = static_cast<const uint8_t*>(data);
+    const uint8_t* header = rom_->data();
     if (size >= 16 && header[0] == 'N' && header[1] == 'E' && header[2] == 'S' && header[3] == 0x1A) {
         uint8_t mapper_num = ((header[6] & 0xF0) >> 4) | (header[7] & 0xF0);
         has_vrc6_ = (mapper_num == 24 || mapper_num == 26);
@@ -119,180 +368,474 @@ bool NesEmulator::loadROMData(const void* data, size_t size) {
     
     rom_loaded_ = true;
     running_ = false;
+    screen_stale_ = true;
+    publishApuSnapshot();
     
     return true;
 }
 
-void NesEmulator::reset() {
+void NesEmulator::reset(bool hard) {
     if (!agnes_ || !rom_loaded_) return;
     
     std::lock_guard<std::mutex> lock(mutex_);
     
-    // Reload the ROM to reset
-    if (!rom_path_.empty()) {
-        std::ifstream file(rom_path_, std::ios::binary | std::ios::ate);
-        if (file.is_open()) {
-            size_t size = file.tellg();
-            file.seekg(0, std::ios::beg);
-            rom_data_.clear();
-            rom_data_.resize(size);
-            file.read(reinterpret_cast<char*>(rom_data_.data()), size);
-            agnes_load_ines_data(agnes_, rom_data_.data(), rom_data_.size());
-        }
-    }
+    drainPpuPipeline();  // A power cycle clears the screen buffer
+    agnes_reset(agnes_, hard);
     
-    // Reset APU
+    // The APU is part of the CPU and restarts with it; VRC6 is on the
+    // cartridge and only starts over with the power. A soft reset keeps
+    // counting CPU cycles, so the APU frame in progress lines up as it is.
     apu_.reset(false);
-    apu_buffer_.clear();
-    last_apu_cycle_ = 0;
+    if (hard) {
+        vrc6_apu_.reset();
+        last_apu_cycle_ = 0;
+    }
+    if (!lookahead_) apu_buffer_.clear();
+    publishApuSnapshot();
 }
 
-void NesEmulator::runFrame() {
+void NesEmulator::runFrame(bool present) {
     if (!agnes_ || !rom_loaded_ || !running_) return;
+    FC_ZONE("runFrame");
     
     std::lock_guard<std::mutex> lock(mutex_);
     
     // Set input
-    agnes_set_input(agnes_, &input_[0], &input_[1]);
+    const MovieMode movie_mode = movie_mode_.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> input_lock(input_mutex_);
+        const auto now = std::chrono::steady_clock::now();
+        frame_events_.clear();
+        frame_event_ = 0;
+        if (movie_mode == MovieMode::None && !input_events_.empty()) {
+            // The frame stands for the time since the one before; each change
+            // keeps its place in that span, from the frame's first cycle
+            const auto span = std::min<std::chrono::steady_clock::duration>(now - last_frame_at_, MAX_INPUT_SPAN);
+            const auto start = now - span;
+            const uint64_t first_cycle = agnes_get_cpu_cycles(agnes_);
+            for (InputEvent event : input_events_) {
+                const double at = span.count() > 0 ? std::clamp(std::chrono::duration<double>(event.at - start) / span, 0.0, 1.0) : 0.0;
+                event.cycle = first_cycle + static_cast<uint64_t>(at * CYCLES_PER_FRAME);
+                frame_events_.push_back(event);
+            }
+        }
+        // A player with no changes queued starts where input_ is
+        for (int player = 0; player < 2; ++player) {
+            const bool queued = std::any_of(frame_events_.begin(), frame_events_.end(),
+                                            [player](const InputEvent& event) { return event.player == player; });
+            if (!queued) frame_input_[player] = input_[player];
+        }
+        input_events_.clear();
+        last_frame_at_ = now;
+        // The oldest change not on screen yet is the one a picture shows first
+        if (unshown_input_at_ == std::chrono::steady_clock::time_point()) unshown_input_at_ = input_changed_at_;
+        input_changed_at_ = std::chrono::steady_clock::time_point();
+    }
+    // A movie's frame runs on its input, whatever is held live
+    if (movie_mode != MovieMode::None) {
+        const int frame = movie_frame_.load(std::memory_order_relaxed);
+        if (movie_mode == MovieMode::Playing) {
+            frame_input_[0] = movie_.at(frame, 0);
+            frame_input_[1] = movie_.at(frame, 1);
+            if (frame + 1 >= movie_.frames()) movie_mode_.store(MovieMode::None, std::memory_order_relaxed);
+        } else {
+            movie_.append(frame_input_[0], frame_input_[1]);
+        }
+        movie_frame_.store(frame + 1, std::memory_order_relaxed);
+    }
+    agnes_set_input(agnes_, &frame_input_[0], &frame_input_[1]);
     
     // Run one frame of emulation
+    agnes_ppu_log_t* ppu_log = beginPpuLog();
     agnes_next_frame(agnes_);
+    if (ppu_log) endPpuLog(ppu_log);
+    // Changes placed past the last strobe hold from here, as input_ does
+    applyInputEvents(UINT64_MAX);
     
     // End APU frame to generate audio samples
     endApuFrame();
+    publishApuSnapshot();
+    
+    // Hand the frame to the UI thread's next updateScreenTexture()
+    if (!present) return;
+    const int ahead = run_ahead_.load();
+    if (ahead > 0) {
+        runAheadAndConvert(ahead);
+    } else {
+        convertScreen();
+    }
+}
+
+// Emulation thread, mutex_ held. The oscillators are disconnected while running
+// ahead, so nothing reaches the buffer and their output levels are untouched.
+void NesEmulator::runAheadAndConvert(int frames) {
+    const auto start = std::chrono::steady_clock::now();
+    drainPpuPipeline();  // The frames ahead draw on the screen buffer
+    
+    run_ahead_state_.resize(agnes_save_compact(agnes_, nullptr));
+    agnes_save_compact(agnes_, run_ahead_state_.data());
+    nes_apu_snapshot_t apu;
+    apu_.save_snapshot(&apu);
+    vrc6_apu_state_t vrc6;
+    vrc6_apu_.save_state(&vrc6);
+    const uint64_t apu_cycle = last_apu_cycle_;
+    
+    connectApuOutputs(false);
+    for (int i = 0; i < frames; ++i) {
+        agnes_next_frame(agnes_);
+        endApuFrame(false);
+    }
+    convertScreen();
+    
+    agnes_load_compact(agnes_, run_ahead_state_.data(), run_ahead_state_.size());
+    apu_.load_snapshot(apu);
+    vrc6_apu_.load_state(vrc6);
+    last_apu_cycle_ = apu_cycle;
+    connectApuOutputs(true);
     
-    // Update screen texture
-    updateScreenTexture();
+    // Smoothed over about a second of frames
+    const float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    const float cost = run_ahead_cost_ms_.load(std::memory_order_relaxed);
+    run_ahead_cost_ms_.store(cost + (ms - cost) / 60.0f, std::memory_order_relaxed);
+}
+
+// Emulation thread, mutex_ held: the log the frame about to run goes into,
+// or null to draw it here, once the second core's last picture is in
+agnes_ppu_log_t* NesEmulator::beginPpuLog() {
+    const bool serial = !ppu_pipeline_ || !fast_ppu_ || run_ahead_.load() > 0 || ppu_serial_frames_ > 0;
+    if (ppu_serial_frames_ > 0) --ppu_serial_frames_;
+    ppu_pipeline_active_.store(!serial, std::memory_order_relaxed);
+    if (serial) {
+        drainPpuPipeline();
+        return nullptr;
+    }
+    agnes_ppu_log_t* log = ppu_pipeline_->nextLog();
+    agnes_log_ppu(agnes_, log);
+    return log;
+}
+
+// Takes in the frame before's picture and hands this one's log to the
+// second core; the screen buffer is left alone until the next call
+void NesEmulator::endPpuLog(agnes_ppu_log_t* log) {
+    agnes_log_ppu(agnes_, nullptr);
+    drainPpuPipeline();
+    ppu_pipeline_->render(agnes_get_screen_buffer(agnes_));
+    if (agnes_ppu_log_lines_caught_up(log) > PPU_PIPELINE_MAX_CAUGHT_UP) {
+        ppu_serial_frames_ = PPU_PIPELINE_RETRY_FRAMES;
+    }
+}
+
+// Emulation thread, mutex_ held: wait for the picture in flight, if any,
+// and put it in the screen buffer
+void NesEmulator::drainPpuPipeline() {
+    if (!ppu_pipeline_) return;
+    bool ok = true;
+    if (agnes_ppu_log_t* drawn = ppu_pipeline_->wait(&ok)) {
+        agnes_take_ppu_log_screen(agnes_, drawn);
+        if (!ok) ppu_serial_frames_ = PPU_PIPELINE_RETRY_FRAMES;
+    }
+}
+
+void NesEmulator::recordMovie() {
+    if (!agnes_ || !rom_loaded_) return;
+    reset(true);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    movie_.clear();
+    movie_.setRomHash(InputMovie::hashRom(rom_->data(), rom_->size()));
+    movie_frame_.store(0, std::memory_order_relaxed);
+    movie_frames_.store(0, std::memory_order_relaxed);
+    movie_mode_.store(MovieMode::Recording, std::memory_order_relaxed);
+}
+
+bool NesEmulator::playMovie(InputMovie movie) {
+    if (!agnes_ || !rom_loaded_) return false;
+    if (movie.romHash() != 0 && movie.romHash() != InputMovie::hashRom(rom_->data(), rom_->size())) return false;
+    reset(true);
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    movie_ = std::move(movie);
+    movie_frame_.store(0, std::memory_order_relaxed);
+    movie_frames_.store(movie_.frames(), std::memory_order_relaxed);
+    movie_mode_.store(movie_.empty() ? MovieMode::None : MovieMode::Playing, std::memory_order_relaxed);
+    return true;
+}
+
+InputMovie NesEmulator::stopMovie() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    movie_mode_.store(MovieMode::None, std::memory_order_relaxed);
+    return movie_;
 }
 
 void NesEmulator::setInput(int player, const agnes_input_t& input) {
     if (player >= 0 && player < 2) {
+        std::lock_guard<std::mutex> lock(input_mutex_);
+        const bool changed = std::memcmp(&input_[player], &input, sizeof(input)) != 0;
+        if (changed && input_changed_at_ == std::chrono::steady_clock::time_point()) {
+            input_changed_at_ = std::chrono::steady_clock::now();
+        }
         input_[player] = input;
+        // Supersedes what was queued for the player
+        std::erase_if(input_events_, [player](const InputEvent& event) { return event.player == player; });
+    }
+}
+
+void NesEmulator::queueInput(int player, const agnes_input_t& input, std::chrono::steady_clock::time_point at) {
+    if (player < 0 || player >= 2) return;
+    std::lock_guard<std::mutex> lock(input_mutex_);
+    if (std::memcmp(&input_[player], &input, sizeof(input)) == 0) return;
+    if (input_changed_at_ == std::chrono::steady_clock::time_point()) input_changed_at_ = at;
+    input_[player] = input;
+    // Reserved; a frame that long in coming loses its oldest changes
+    if (input_events_.size() == MAX_INPUT_EVENTS) input_events_.erase(input_events_.begin());
+    input_events_.push_back({at, 0, player, input});
+}
+
+// Emulation thread, mutex_ held, from inside agnes_next_frame()
+void NesEmulator::inputStrobeCallback(void* user_data, uint64_t cpu_cycle) {
+    static_cast<NesEmulator*>(user_data)->applyInputEvents(cpu_cycle);
+}
+
+void NesEmulator::applyInputEvents(uint64_t cpu_cycle) {
+    bool changed = false;
+    while (frame_event_ < frame_events_.size() && frame_events_[frame_event_].cycle <= cpu_cycle) {
+        const InputEvent& event = frame_events_[frame_event_++];
+        frame_input_[event.player] = event.input;
+        changed = true;
     }
+    if (changed) agnes_set_input(agnes_, &frame_input_[0], &frame_input_[1]);
+}
+
+std::chrono::steady_clock::time_point NesEmulator::takeShownInputTime() {
+    return std::exchange(shown_input_at_, std::chrono::steady_clock::time_point());
 }
 
+// Only logged here; syncApu() applies the writes, away from the CPU loop.
+// Nothing the CPU can see depends on them before then, as reads sync first.
 void NesEmulator::apuWriteCallback(void* user_data, uint16_t addr, uint8_t val, uint64_t cpu_cycle) {
     NesEmulator* emu = static_cast<NesEmulator*>(user_data);
     if (!emu) return;
     
-    // Sync APU to current cycle
-    emu->syncApu(cpu_cycle);
-    
     nes_time_t time = static_cast<nes_time_t>(cpu_cycle - emu->last_apu_cycle_);
-    
-    // Check if this is a VRC6 register write
-    if (emu->has_vrc6_) {
-        // VRC6 Pulse 1: $9000-$9002
-        if (addr >= 0x9000 && addr <= 0x9002) {
-            emu->vrc6_apu_.write_osc(time, 0, addr & 0x3, val);
-            return;
-        }
-        // VRC6 Pulse 2: $A000-$A002
-        if (addr >= 0xA000 && addr <= 0xA002) {
-            emu->vrc6_apu_.write_osc(time, 1, addr & 0x3, val);
-            return;
-        }
-        // VRC6 Saw: $B000-$B002
-        if (addr >= 0xB000 && addr <= 0xB002) {
-            emu->vrc6_apu_.write_osc(time, 2, addr & 0x3, val);
-            return;
-        }
-    }
-    
-    // Standard APU register write
-    emu->apu_.write_register(time, addr, val);
+    emu->apu_log_.push_back({time, addr, val});
 }
 
 uint8_t NesEmulator::apuReadCallback(void* user_data, uint16_t addr, uint64_t cpu_cycle) {
     NesEmulator* emu = static_cast<NesEmulator*>(user_data);
     if (!emu) return 0;
+    ScopedTimer timer(emu->profile_apu_ ? &emu->apu_time_ns_ : nullptr);
     
-    // Sync APU to current cycle
-    emu->syncApu(cpu_cycle);
+    // The status reflects every write before it
+    emu->syncApu();
     
-    // Read APU status (0x4015)
+    // Read APU status (0x4015). Nes_Apu runs to the cycle before the read,
+    // which for a read on a frame's first cycle is last frame's last cycle.
     if (addr == 0x4015) {
-        return emu->apu_.read_status(static_cast<nes_time_t>(cpu_cycle - emu->last_apu_cycle_));
+        const nes_time_t time = static_cast<nes_time_t>(cpu_cycle - emu->last_apu_cycle_);
+        return emu->apu_.read_status(std::max(time, static_cast<nes_time_t>(1)));
     }
     
     return 0;
 }
 
+// DMC sample bytes, $8000-$FFFF, straight from the CPU's PRG pages. Fetched
+// as syncApu() runs the APU, so from the banks mapped then.
 int NesEmulator::apuDmcReadCallback(void* user_data, unsigned addr) {
     NesEmulator* emu = static_cast<NesEmulator*>(user_data);
     if (!emu || !emu->agnes_) return 0;
-    
-    // Read from ROM via agnes CPU
-    // DMC reads from $8000-$FFFF
-    // We need to access agnes memory - for now return 0
-    // TODO: Implement proper DMC sample reading
-    return 0;
+    return agnes_peek(emu->agnes_, static_cast<uint16_t>(addr));
+}
+
+// Apply the logged writes in order, then forget them
+void NesEmulator::syncApu() {
+    for (const ApuWrite& write : apu_log_) {
+        const uint16_t addr = write.addr;
+        // VRC6 pulse 1, pulse 2 and saw: $9000-$9002, $A000-$A002, $B000-$B002
+        const int vrc6_osc = has_vrc6_ ? Nes_Vrc6_Apu::osc_at(addr) : -1;
+        if (vrc6_osc >= 0) {
+            vrc6_apu_.write_osc(write.time, vrc6_osc, addr & (Nes_Vrc6_Apu::addr_step - 1), write.value);
+        } else {
+            // Standard APU register write
+            apu_.write_register(write.time, addr, write.value);
+        }
+    }
+    apu_log_.clear();
+}
+
+void NesEmulator::setApuTimeline(ApuTimeline* timeline) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    apu_timeline_ = timeline;
+    if (timeline) {
+        timeline->attach(&apu_);
+    } else {
+        apu_.set_write_log(nullptr, 0);
+    }
 }
 
-void NesEmulator::syncApu(uint64_t cpu_cycle) {
-    // APU sync is handled through write_register timing
+void NesEmulator::connectApuOutputs(bool connect) {
+    for (int i = 0; i < Nes_Apu::osc_count; ++i) {
+        apu_.osc_output(i, connect ? apu_buffer_.tap(i) : nullptr);
+    }
+    for (int i = 0; i < Nes_Vrc6_Apu::osc_count; ++i) {
+        vrc6_apu_.osc_output(i, connect ? apu_buffer_.tap(Nes_Apu::osc_count + i) : nullptr);
+    }
 }
 
-void NesEmulator::endApuFrame() {
+void NesEmulator::endApuFrame(bool to_buffer) {
+    ScopedTimer timer(profile_apu_ ? &apu_time_ns_ : nullptr);
     // Now handled inline in generateAudioSamples() for better timing
     uint64_t current_cycle = agnes_get_cpu_cycles(agnes_);
     nes_time_t frame_length = static_cast<nes_time_t>(current_cycle - last_apu_cycle_);
     
+    syncApu();
     apu_.end_frame(frame_length);
     if (has_vrc6_) {
         vrc6_apu_.end_frame(frame_length);
     }
-    apu_buffer_.end_frame(frame_length);
+    if (apu_timeline_) {
+        // Frames run ahead are undone, and so are their writes
+        if (to_buffer && !lookahead_) {
+            apu_timeline_->capture(static_cast<int64_t>(last_apu_cycle_), frame_length);
+        } else {
+            apu_timeline_->discard();
+        }
+    }
+    if (to_buffer && !lookahead_) apu_buffer_.end_frame(frame_length);
     
     last_apu_cycle_ = current_cycle;
 }
 
+void NesEmulator::trimAudio(long max_samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    const long excess = apu_buffer_.samples_avail() - std::max(max_samples, 0L);
+    if (excess > 0) apu_buffer_.remove_samples(excess);
+}
+
+// CPU clock the buffer resamples from: a lower rate makes more samples a frame
+long NesEmulator::outputClockRate() const {
+    return static_cast<long>(CPU_CLOCK_NTSC / (1.0 + rate_adjust_));
+}
+
+void NesEmulator::setRateAdjust(double ratio) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    rate_adjust_ = std::clamp(ratio, -MAX_RATE_ADJUST, MAX_RATE_ADJUST);
+    apu_buffer_.clock_rate(outputClockRate());
+}
+
+void NesEmulator::setSynthQuality(int quality) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    apu_buffer_.synth_quality(quality);
+}
+
+bool NesEmulator::setAudioBufferLength(int msec) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // Must hold at least one emulated frame (~17ms)
+    msec = std::max(msec, 50);
+    if (apu_buffer_.set_sample_rate(sample_rate_, msec) != nullptr) {
+        // Keep the old length working
+        apu_buffer_.set_sample_rate(sample_rate_, apu_buffer_ms_);
+        apu_buffer_.clock_rate(outputClockRate());
+        return false;
+    }
+    apu_buffer_.clock_rate(outputClockRate());
+    apu_buffer_ms_ = msec;
+    return true;
+}
+
 long NesEmulator::samplesAvailable() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     return apu_buffer_.samples_avail();
 }
 
 int NesEmulator::readAudioSamples(short* buffer, int max_samples) {
     std::lock_guard<std::mutex> lock(mutex_);
+    ScopedTimer timer(profile_apu_ ? &apu_time_ns_ : nullptr);
     
     // Just read from buffer - emulation is driven by main thread
     long available = apu_buffer_.samples_avail();
+    buffered_at_read_.store(available, std::memory_order_relaxed);
     if (available <= 0) return 0;
     
     int to_read = std::min(static_cast<int>(available), max_samples);
     return static_cast<int>(apu_buffer_.read_samples(buffer, to_read));
 }
 
-void NesEmulator::getApuState(int* periods, int* lengths, int* amplitudes) {
+int NesEmulator::readAudioStereo(short* buffer, int max_frames) {
     std::lock_guard<std::mutex> lock(mutex_);
+    ScopedTimer timer(profile_apu_ ? &apu_time_ns_ : nullptr);
     
-    for (int i = 0; i < 5; ++i) {
-        periods[i] = apu_.osc_period(i);
-        lengths[i] = apu_.osc_length(i);
-        amplitudes[i] = apu_.osc_amplitude(i);
-    }
+    // The taps are synthesized for the mono mix anyway; only their sum differs
+    long available = apu_buffer_.samples_avail();
+    buffered_at_read_.store(available, std::memory_order_relaxed);
+    if (available <= 0) return 0;
+    
+    int to_read = std::min(static_cast<int>(available), max_frames);
+    return static_cast<int>(apu_buffer_.readStereo(buffer, to_read));
 }
 
-void NesEmulator::getVRC6State(int* periods, int* volumes, bool* enabled) {
-    if (!has_vrc6_) return;
-    
+int NesEmulator::readChannelTaps(short* buffer, int max_frames) {
     std::lock_guard<std::mutex> lock(mutex_);
     
-    for (int i = 0; i < 3; ++i) {
-        periods[i] = vrc6_apu_.osc_period(i);
-        volumes[i] = vrc6_apu_.osc_volume(i);
-        enabled[i] = vrc6_apu_.osc_enabled(i);
+    const short* taps = nullptr;
+    int frames = std::min(apu_buffer_.takeTaps(&taps), max_frames);
+    std::copy_n(taps, frames * TAP_COUNT, buffer);
+    return frames;
+}
+
+void NesEmulator::getApuState(int* periods, int* lengths, int* amplitudes) const {
+    const ApuSnapshot snapshot = apu_snapshot_.load();
+    std::memcpy(periods, snapshot.periods, sizeof(snapshot.periods));
+    std::memcpy(lengths, snapshot.lengths, sizeof(snapshot.lengths));
+    std::memcpy(amplitudes, snapshot.amplitudes, sizeof(snapshot.amplitudes));
+}
+
+void NesEmulator::getVRC6State(int* periods, int* volumes, bool* enabled) const {
+    const ApuSnapshot snapshot = apu_snapshot_.load();
+    if (!snapshot.has_vrc6) return;
+    
+    std::memcpy(periods, snapshot.vrc6_periods, sizeof(snapshot.vrc6_periods));
+    std::memcpy(volumes, snapshot.vrc6_volumes, sizeof(snapshot.vrc6_volumes));
+    std::memcpy(enabled, snapshot.vrc6_enabled, sizeof(snapshot.vrc6_enabled));
+}
+
+// Emulation thread, mutex_ held
+void NesEmulator::publishApuSnapshot() {
+    ApuSnapshot snapshot = {};
+    apu_.osc_state(snapshot.periods, snapshot.lengths, snapshot.amplitudes);
+    apu_.osc_volumes(snapshot.volumes);
+    snapshot.has_vrc6 = has_vrc6_;
+    if (has_vrc6_) {
+        vrc6_apu_.osc_state(snapshot.vrc6_periods, snapshot.vrc6_amplitudes, snapshot.vrc6_volumes,
+                            snapshot.vrc6_enabled);
     }
+    snapshot.cpu_cycles = agnes_ ? agnes_get_cpu_cycles(agnes_) : 0;
+    apu_snapshot_.store(snapshot);
 }
 
 void NesEmulator::createScreenTexture() {
     if (texture_created_) return;
     
-    // Create image with stream update usage (new sokol API)
+#ifndef NES_HEADLESS
+    const sg_backend backend = sg_query_backend();
+    const bool metal = backend == SG_BACKEND_METAL_MACOS || backend == SG_BACKEND_METAL_IOS ||
+                       backend == SG_BACKEND_METAL_SIMULATOR;
+    gpu_palette_ = metal;
+    gpu_filters_ = metal;
+    
+    // Create image with stream update usage (new sokol API); with the GPU
+    // lookup it is the target of the palette pass instead
     sg_image_desc img_desc = {};
     img_desc.width = AGNES_SCREEN_WIDTH;
     img_desc.height = AGNES_SCREEN_HEIGHT;
     img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
-    img_desc.usage.stream_update = true;  // New sokol API for stream updates
+    if (gpu_palette_) {
+        img_desc.usage.color_attachment = true;
+    } else {
+        img_desc.usage.stream_update = true;  // New sokol API for stream updates
+    }
     
     screen_texture_ = sg_make_image(&img_desc);
     
@@ -304,6 +847,9 @@ void NesEmulator::createScreenTexture() {
     smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
     
     screen_sampler_ = sg_make_sampler(&smp_desc);
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    smooth_sampler_ = sg_make_sampler(&smp_desc);
     
     // Create texture view for ImGui binding
     sg_view_desc view_desc = {};
@@ -311,53 +857,414 @@ void NesEmulator::createScreenTexture() {
     
     screen_view_ = sg_make_view(&view_desc);
     
+    if (gpu_palette_) createPalettePass();
+    if (gpu_filters_) createFilterPasses();
+#endif
+    
     texture_created_ = true;
 }
 
+#ifndef NES_HEADLESS
+void NesEmulator::createPalettePass() {
+    sg_image_desc index_desc = {};
+    index_desc.width = AGNES_SCREEN_WIDTH;
+    index_desc.height = AGNES_SCREEN_HEIGHT;
+    index_desc.pixel_format = SG_PIXELFORMAT_R8;
+    index_desc.usage.stream_update = true;
+    index_image_ = sg_make_image(&index_desc);
+    
+    sg_image_desc palette_desc = {};
+    palette_desc.width = 64;
+    palette_desc.height = 1;
+    palette_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    palette_desc.usage.dynamic_update = true;
+    palette_image_ = sg_make_image(&palette_desc);
+    
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = index_image_;
+    index_view_ = sg_make_view(&view_desc);
+    view_desc.texture.image = palette_image_;
+    palette_view_ = sg_make_view(&view_desc);
+    sg_view_desc target_desc = {};
+    target_desc.color_attachment.image = screen_texture_;
+    target_view_ = sg_make_view(&target_desc);
+    
+    // Both textures are read texel by texel; sokol still wants each paired
+    // with a (non-filtering) sampler
+    sg_shader_desc shd_desc = {};
+    shd_desc.vertex_func.source = PALETTE_SHADER_MSL;
+    shd_desc.vertex_func.entry = "vs_main";
+    shd_desc.fragment_func.source = PALETTE_SHADER_MSL;
+    shd_desc.fragment_func.entry = "fs_main";
+    for (int i = 0; i < 2; ++i) {
+        shd_desc.views[i].texture.stage = SG_SHADERSTAGE_FRAGMENT;
+        shd_desc.views[i].texture.image_type = SG_IMAGETYPE_2D;
+        shd_desc.views[i].texture.sample_type = SG_IMAGESAMPLETYPE_UNFILTERABLE_FLOAT;
+        shd_desc.views[i].texture.msl_texture_n = static_cast<uint8_t>(i);
+        shd_desc.texture_sampler_pairs[i].stage = SG_SHADERSTAGE_FRAGMENT;
+        shd_desc.texture_sampler_pairs[i].view_slot = static_cast<uint8_t>(i);
+        shd_desc.texture_sampler_pairs[i].sampler_slot = 0;
+    }
+    shd_desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    shd_desc.samplers[0].sampler_type = SG_SAMPLERTYPE_NONFILTERING;
+    shd_desc.samplers[0].msl_sampler_n = 0;
+    shd_desc.label = "nes-palette-shader";
+    palette_shader_ = sg_make_shader(&shd_desc);
+    
+    sg_pipeline_desc pip_desc = {};
+    pip_desc.shader = palette_shader_;
+    pip_desc.colors[0].pixel_format = SG_PIXELFORMAT_RGBA8;
+    pip_desc.depth.pixel_format = SG_PIXELFORMAT_NONE;
+    pip_desc.sample_count = 1;
+    pip_desc.label = "nes-palette-pipeline";
+    palette_pipeline_ = sg_make_pipeline(&pip_desc);
+    
+    // The palette goes up with the first frame
+    std::lock_guard<std::mutex> lock(palette_mutex_);
+    memcpy(upload_palette_, palette_lut_, sizeof(upload_palette_));
+    palette_pending_ = true;
+}
+
+void NesEmulator::createFilterPasses() {
+    // Same bindings as the palette pass: the screen read texel by texel,
+    // with the sampler sokol wants alongside
+    sg_shader_desc shd_desc = {};
+    shd_desc.vertex_func.source = FILTER_SHADER_MSL;
+    shd_desc.vertex_func.entry = "vs_main";
+    shd_desc.fragment_func.source = FILTER_SHADER_MSL;
+    shd_desc.views[0].texture.stage = SG_SHADERSTAGE_FRAGMENT;
+    shd_desc.views[0].texture.image_type = SG_IMAGETYPE_2D;
+    shd_desc.views[0].texture.sample_type = SG_IMAGESAMPLETYPE_UNFILTERABLE_FLOAT;
+    shd_desc.views[0].texture.msl_texture_n = 0;
+    shd_desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    shd_desc.samplers[0].sampler_type = SG_SAMPLERTYPE_NONFILTERING;
+    shd_desc.samplers[0].msl_sampler_n = 0;
+    shd_desc.texture_sampler_pairs[0].stage = SG_SHADERSTAGE_FRAGMENT;
+    shd_desc.texture_sampler_pairs[0].view_slot = 0;
+    shd_desc.texture_sampler_pairs[0].sampler_slot = 0;
+    
+    shd_desc.fragment_func.entry = "fs_crt";
+    shd_desc.label = "nes-crt-shader";
+    crt_shader_ = sg_make_shader(&shd_desc);
+    shd_desc.fragment_func.entry = "fs_xbr";
+    shd_desc.label = "nes-xbr-shader";
+    xbr_shader_ = sg_make_shader(&shd_desc);
+    
+    sg_pipeline_desc pip_desc = {};
+    pip_desc.colors[0].pixel_format = SG_PIXELFORMAT_RGBA8;
+    pip_desc.depth.pixel_format = SG_PIXELFORMAT_NONE;
+    pip_desc.sample_count = 1;
+    pip_desc.shader = crt_shader_;
+    pip_desc.label = "nes-crt-pipeline";
+    crt_pipeline_ = sg_make_pipeline(&pip_desc);
+    pip_desc.shader = xbr_shader_;
+    pip_desc.label = "nes-xbr-pipeline";
+    xbr_pipeline_ = sg_make_pipeline(&pip_desc);
+}
+
+void NesEmulator::destroyFilterTarget() {
+    if (filter_width_ == 0) return;
+    sg_destroy_view(filter_target_view_);
+    sg_destroy_view(filter_view_);
+    sg_destroy_image(filter_image_);
+    filter_width_ = 0;
+    filter_height_ = 0;
+}
+
+// UI thread, outside any pass
+void NesEmulator::runFilterPass(int width, int height) {
+    const int max_size = sg_query_limits().max_image_size_2d;
+    width = std::clamp(width, 1, max_size);
+    height = std::clamp(height, 1, max_size);
+    if (width != filter_width_ || height != filter_height_) {
+        destroyFilterTarget();
+        sg_image_desc img_desc = {};
+        img_desc.width = width;
+        img_desc.height = height;
+        img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        img_desc.usage.color_attachment = true;
+        img_desc.label = "nes-filter-target";
+        filter_image_ = sg_make_image(&img_desc);
+        
+        sg_view_desc view_desc = {};
+        view_desc.texture.image = filter_image_;
+        filter_view_ = sg_make_view(&view_desc);
+        sg_view_desc target_desc = {};
+        target_desc.color_attachment.image = filter_image_;
+        filter_target_view_ = sg_make_view(&target_desc);
+        filter_width_ = width;
+        filter_height_ = height;
+        filter_dirty_ = true;
+    }
+    if (!filter_dirty_) return;
+    filter_dirty_ = false;
+    
+    sg_pass pass = {};
+    pass.action.colors[0].load_action = SG_LOADACTION_DONTCARE;
+    pass.attachments.colors[0] = filter_target_view_;
+    pass.label = "nes-filter-pass";
+    FrameProfiler::beginGpu(FrameProfiler::GPU_NES_FILTER);
+    sg_begin_pass(&pass);
+    sg_apply_pipeline(screen_filter_ == ScreenFilter::Crt ? crt_pipeline_ : xbr_pipeline_);
+    sg_bindings bindings = {};
+    bindings.views[0] = screen_view_;
+    bindings.samplers[0] = screen_sampler_;
+    sg_apply_bindings(&bindings);
+    sg_draw(0, 3, 1);
+    sg_end_pass();
+    FrameProfiler::endGpu(FrameProfiler::GPU_NES_FILTER);
+}
+#endif
+
 void NesEmulator::destroyScreenTexture() {
     if (texture_created_) {
+#ifndef NES_HEADLESS
+        if (gpu_filters_) {
+            destroyFilterTarget();
+            sg_destroy_pipeline(xbr_pipeline_);
+            sg_destroy_pipeline(crt_pipeline_);
+            sg_destroy_shader(xbr_shader_);
+            sg_destroy_shader(crt_shader_);
+        }
+        if (gpu_palette_) {
+            sg_destroy_pipeline(palette_pipeline_);
+            sg_destroy_shader(palette_shader_);
+            sg_destroy_view(target_view_);
+            sg_destroy_view(palette_view_);
+            sg_destroy_view(index_view_);
+            sg_destroy_image(palette_image_);
+            sg_destroy_image(index_image_);
+        }
         sg_destroy_view(screen_view_);
+        sg_destroy_sampler(smooth_sampler_);
         sg_destroy_sampler(screen_sampler_);
         sg_destroy_image(screen_texture_);
+#endif
         texture_created_ = false;
     }
 }
 
-void NesEmulator::updateScreenTexture() {
-    if (!agnes_ || !texture_created_) return;
-    
-    // Convert agnes screen buffer to RGBA pixels
-    for (int y = 0; y < AGNES_SCREEN_HEIGHT; ++y) {
-        for (int x = 0; x < AGNES_SCREEN_WIDTH; ++x) {
-            agnes_color_t color = agnes_get_screen_pixel(agnes_, x, y);
-            screen_pixels_[y * AGNES_SCREEN_WIDTH + x] = 
-                (color.a << 24) | (color.b << 16) | (color.g << 8) | color.r;
+// Emulation thread, mutex_ held
+void NesEmulator::convertScreen() {
+    if (!texture_created_) return;
+    
+    // Static screens (menus, pauses, dialogue) leave the last upload standing
+    const bool changed = agnes_take_screen_changed(agnes_);
+    if (!changed && !screen_stale_) return;
+    screen_stale_ = false;
+    
+    // The GPU looks the colours up itself; otherwise convert agnes' palette
+    // indices to RGBA pixels
+    ScreenFrame& frame = frames_.back();
+    if (gpu_palette_) {
+        memcpy(frame.indices, agnes_get_screen_buffer(agnes_), sizeof(frame.indices));
+    } else {
+        indicesToPixels(agnes_get_screen_buffer(agnes_), palette_lut_, frame.pixels,
+                        AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT);
+    }
+    frame.input_time = std::exchange(unshown_input_at_, std::chrono::steady_clock::time_point());
+    
+    // Frames finished since the last upload replace each other
+    frames_.publish();
+}
+
+const char* NesEmulator::paletteName(Palette palette) {
+    switch (palette) {
+        case Palette::Agnes: return "agnes";
+        case Palette::Nestopia: return "Nestopia";
+    }
+    return "";
+}
+
+void NesEmulator::setPalette(Palette palette) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    palette_ = palette;
+    const agnes_color_t* colors = agnes_get_palette();
+    for (int i = 0; i < 64; ++i) {
+        if (palette == Palette::Nestopia) {
+            const uint32_t argb = nes_palette_[i];
+            palette_lut_[i] = rgbaPixel(static_cast<uint8_t>(argb >> 16), static_cast<uint8_t>(argb >> 8),
+                                        static_cast<uint8_t>(argb), static_cast<uint8_t>(argb >> 24));
+        } else {
+            palette_lut_[i] = rgbaPixel(colors[i].r, colors[i].g, colors[i].b, colors[i].a);
         }
     }
     
-    // Upload to GPU texture
-    sg_image_data data = {};
-    data.mip_levels[0].ptr = screen_pixels_;
-    data.mip_levels[0].size = sizeof(screen_pixels_);
-    sg_update_image(screen_texture_, &data);
+    // The GPU lookup only needs the new table; the CPU path reconverts a
+    // paused frame, since nothing runs to show it otherwise
+    if (gpu_palette_) {
+        std::lock_guard<std::mutex> palette_lock(palette_mutex_);
+        memcpy(upload_palette_, palette_lut_, sizeof(upload_palette_));
+        palette_pending_ = true;
+    } else {
+        screen_stale_ = true;
+        if (rom_loaded_ && !running_ && !lookahead_) convertScreen();
+    }
+}
+
+const char* NesEmulator::screenFilterName(ScreenFilter filter) {
+    switch (filter) {
+        case ScreenFilter::Nearest: return "Nearest";
+        case ScreenFilter::Smooth: return "Smooth";
+        case ScreenFilter::Crt: return "CRT scanlines";
+        case ScreenFilter::Xbr: return "xBR";
+    }
+    return "";
+}
+
+bool NesEmulator::screenFilterAvailable(ScreenFilter filter) const {
+    return filter == ScreenFilter::Nearest || filter == ScreenFilter::Smooth || gpu_filters_;
+}
+
+void NesEmulator::setScreenFilter(ScreenFilter filter) {
+    screen_filter_ = filter;
+    filter_dirty_ = true;
+}
+
+void NesEmulator::setFastPpu(bool fast) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fast_ppu_ = fast;
+    if (agnes_) agnes_set_fast_ppu(agnes_, fast);
+}
+
+void NesEmulator::setCatchUpPpu(bool catch_up) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    catch_up_ppu_ = catch_up;
+    if (agnes_) agnes_set_catch_up_ppu(agnes_, catch_up);
+}
+
+void NesEmulator::setPipelinedPpu(bool pipelined) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pipelined == (ppu_pipeline_ != nullptr)) return;
+    if (pipelined) {
+        ppu_pipeline_ = std::make_unique<PpuPipeline>();
+        if (!ppu_pipeline_->valid()) ppu_pipeline_.reset();
+        ppu_serial_frames_ = 0;
+    } else {
+        drainPpuPipeline();
+        ppu_pipeline_.reset();
+        ppu_pipeline_active_.store(false, std::memory_order_relaxed);
+    }
+    pipelined_ppu_.store(ppu_pipeline_ != nullptr, std::memory_order_relaxed);
+}
+
+#ifdef AGNES_PROFILE
+void NesEmulator::cpuProfile(CpuProfile& out, size_t max_spots) const {
+    out.hot.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!agnes_) return;
+    
+    const agnes_profile_t* profile = agnes_get_profile(agnes_);
+    for (uint32_t pc = 0; pc < 0x10000; ++pc) {
+        if (profile->pc_cycles[pc]) out.hot.push_back({static_cast<uint16_t>(pc), profile->pc_cycles[pc]});
+    }
+    const auto hotter = [](const CpuProfile::Spot& a, const CpuProfile::Spot& b) { return a.cycles > b.cycles; };
+    const size_t spots = std::min(max_spots, out.hot.size());
+    std::partial_sort(out.hot.begin(), out.hot.begin() + static_cast<std::ptrdiff_t>(spots), out.hot.end(), hotter);
+    out.hot.resize(spots);
+    
+    out.total_cycles = profile->total_cycles;
+    out.dma_cycles = profile->dma_cycles;
+    out.frames = profile->frames;
+    out.nmi_cycles = profile->nmi_cycles;
+    out.irq_cycles = profile->irq_cycles;
+    out.nmi_peak = profile->nmi_peak;
+    out.irq_peak = profile->irq_peak;
+}
+
+void NesEmulator::clearCpuProfile() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (agnes_) agnes_clear_profile(agnes_);
+}
+#endif
+
+void NesEmulator::updateScreenTexture() {
+    if (!texture_created_) return;
+    
+    // Upload to GPU texture (sokol copies the data, and allows one update per frame)
+    const bool new_frame = frames_.acquire();
+    const bool new_palette = gpu_palette_ && palette_pending_.exchange(false);
+    if (!new_frame && !new_palette) return;
+    if (new_frame && frames_.front().input_time != std::chrono::steady_clock::time_point()) {
+        shown_input_at_ = frames_.front().input_time;
+    }
+    filter_dirty_ = true;
+#ifndef NES_HEADLESS
+    const ScreenFrame& frame = frames_.front();
+    if (gpu_palette_) {
+        // A quarter of the bytes go up, and the pass recolours the frame
+        sg_image_data data = {};
+        if (new_palette) {
+            std::lock_guard<std::mutex> lock(palette_mutex_);
+            data.mip_levels[0].ptr = upload_palette_;
+            data.mip_levels[0].size = sizeof(upload_palette_);
+            sg_update_image(palette_image_, &data);
+        }
+        if (new_frame) {
+            data.mip_levels[0].ptr = frame.indices;
+            data.mip_levels[0].size = sizeof(frame.indices);
+            sg_update_image(index_image_, &data);
+        }
+        
+        sg_pass pass = {};
+        pass.action.colors[0].load_action = SG_LOADACTION_DONTCARE;
+        pass.attachments.colors[0] = target_view_;
+        pass.label = "nes-palette-pass";
+        FrameProfiler::beginGpu(FrameProfiler::GPU_NES_PALETTE);
+        sg_begin_pass(&pass);
+        sg_apply_pipeline(palette_pipeline_);
+        sg_bindings bindings = {};
+        bindings.views[0] = index_view_;
+        bindings.views[1] = palette_view_;
+        bindings.samplers[0] = screen_sampler_;
+        sg_apply_bindings(&bindings);
+        sg_draw(0, 3, 1);
+        sg_end_pass();
+        FrameProfiler::endGpu(FrameProfiler::GPU_NES_PALETTE);
+    } else {
+        sg_image_data data = {};
+        data.mip_levels[0].ptr = frame.pixels;
+        data.mip_levels[0].size = sizeof(frame.pixels);
+        sg_update_image(screen_texture_, &data);
+    }
+#endif
+}
+
+bool NesEmulator::screenPending() {
+    return frames_.pending();
 }
 
+#ifndef NES_HEADLESS
 void NesEmulator::drawScreen(float scale) {
     if (!texture_created_) return;
     
     float width = static_cast<float>(AGNES_SCREEN_WIDTH) * scale;
     float height = static_cast<float>(AGNES_SCREEN_HEIGHT) * scale;
     
+    // Filter passes draw at the size shown, in framebuffer pixels
+    sg_view view = screen_view_;
+    sg_sampler sampler = screen_sampler_;
+    if (screen_filter_ == ScreenFilter::Smooth) {
+        sampler = smooth_sampler_;
+    } else if (screen_filter_ != ScreenFilter::Nearest && screenFilterAvailable(screen_filter_)) {
+        const ImVec2 fb_scale = ImGui::GetIO().DisplayFramebufferScale;
+        runFilterPass(static_cast<int>(std::lround(width * fb_scale.x)),
+                      static_cast<int>(std::lround(height * fb_scale.y)));
+        view = filter_view_;
+        sampler = smooth_sampler_;
+    }
+    
     // Get ImTextureID from view and sampler using sokol_imgui helper
-    uint64_t imtex_id = simgui_imtextureid_with_sampler(screen_view_, screen_sampler_);
+    uint64_t imtex_id = simgui_imtextureid_with_sampler(view, sampler);
     
     // Draw the texture using ImGui
     ImGui::Image(imtex_id, ImVec2(width, height));
 }
+#endif
 
 uint64_t NesEmulator::getCpuCycles() const {
-    if (!agnes_) return 0;
-    return agnes_get_cpu_cycles(agnes_);
+    return apu_snapshot_.load().cpu_cycles;
 }
 
 int NesEmulator::getCurrentScanline() const {
@@ -365,23 +1272,206 @@ int NesEmulator::getCurrentScanline() const {
     return 0;
 }
 
+void NesEmulator::reportMemory(MemoryReport::Sample& sample) const {
+    using MR = MemoryReport;
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Pipelined, each of the two PPU logs holds a machine of its own
+    const size_t machines = (agnes_ ? 1 : 0) + (ppu_pipeline_ ? 2 : 0);
+    sample.add(MR::AGNES, sizeof(*this) + machines * agnes_size());
+    sample.add(MR::BLIP_BUFFERS, apu_buffer_.memoryBytes());
+    sample.add(MR::SAVE_STATES, MR::heapBytes(run_ahead_state_) + MR::heapBytes(apu_log_));
+#ifndef NES_HEADLESS
+    if (texture_created_.load(std::memory_order_acquire)) {
+        const size_t screen = size_t(AGNES_SCREEN_WIDTH) * AGNES_SCREEN_HEIGHT;
+        size_t bytes = screen * 4;
+        if (gpu_palette_) bytes += screen + 64 * 4;
+        if (gpu_filters_) bytes += size_t(filter_width_) * filter_height_ * 4;
+        sample.add(MR::TEXTURES, bytes);
+    }
+#endif
+}
+
 bool NesEmulator::saveState(std::vector<uint8_t>& out_state) {
     if (!agnes_ || !rom_loaded_) return false;
     
     std::lock_guard<std::mutex> lock(mutex_);
     
-    size_t state_size = agnes_state_size();
-    out_state.resize(state_size);
+    StateHeader header = {};
+    std::memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+    header.version = STATE_VERSION;
+    header.has_vrc6 = has_vrc6_ ? 1 : 0;
+    header.machine_size = static_cast<uint32_t>(agnes_save_compact(agnes_, nullptr));
+    
+    // Padding is zeroed so equal states are equal bytes
+    nes_apu_snapshot_t apu;
+    std::memset(&apu, 0, sizeof(apu));
+    apu_.save_snapshot(&apu);
+    vrc6_apu_state_t vrc6;
+    std::memset(&vrc6, 0, sizeof(vrc6));
+    vrc6_apu_.save_state(&vrc6);
     
-    agnes_dump_state(agnes_, reinterpret_cast<agnes_state_t*>(out_state.data()));
+    out_state.resize(sizeof(header) + header.machine_size + sizeof(apu) + (has_vrc6_ ? sizeof(vrc6) : 0));
+    uint8_t* out = out_state.data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    agnes_save_compact(agnes_, out);
+    out += header.machine_size;
+    std::memcpy(out, &apu, sizeof(apu));
+    out += sizeof(apu);
+    if (has_vrc6_) std::memcpy(out, &vrc6, sizeof(vrc6));
     return true;
 }
 
 bool NesEmulator::loadState(const std::vector<uint8_t>& state) {
     if (!agnes_ || !rom_loaded_) return false;
-    if (state.size() < agnes_state_size()) return false;
+    
+    StateHeader header;
+    if (state.size() < sizeof(header)) return false;
+    std::memcpy(&header, state.data(), sizeof(header));
+    if (std::memcmp(header.magic, STATE_MAGIC, sizeof(header.magic)) != 0 || header.version != STATE_VERSION ||
+        (header.has_vrc6 != 0) != has_vrc6_) {
+        return false;
+    }
+    const size_t vrc6_size = has_vrc6_ ? sizeof(vrc6_apu_state_t) : 0;
+    if (state.size() != sizeof(header) + header.machine_size + sizeof(nes_apu_snapshot_t) + vrc6_size) return false;
     
     std::lock_guard<std::mutex> lock(mutex_);
     
-    return agnes_restore_state(agnes_, reinterpret_cast<const agnes_state_t*>(state.data()));
+    // Rejects a state of another mapper or CHR layout, i.e. another ROM
+    const uint8_t* in = state.data() + sizeof(header);
+    if (!agnes_load_compact(agnes_, in, header.machine_size)) return false;
+    movie_mode_.store(MovieMode::None, std::memory_order_relaxed);
+    in += header.machine_size;
+    
+    nes_apu_snapshot_t apu;
+    std::memcpy(&apu, in, sizeof(apu));
+    apu_.load_snapshot(apu);
+    in += sizeof(apu);
+    if (has_vrc6_) {
+        vrc6_apu_state_t vrc6;
+        std::memcpy(&vrc6, in, sizeof(vrc6));
+        vrc6_apu_.load_state(vrc6);
+    }
+    last_apu_cycle_ = agnes_get_cpu_cycles(agnes_);
+    publishApuSnapshot();
+    return true;
+}
+
+size_t NesEmulator::batteryRamSize() const {
+    if (!agnes_ || !rom_loaded_) return 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return agnes_prg_ram_size(agnes_);
+}
+
+bool NesEmulator::takeBatteryRam(std::vector<uint8_t>& out) {
+    if (!agnes_ || !rom_loaded_) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t size = agnes_prg_ram_size(agnes_);
+    if (size == 0) return false;
+    out.resize(size);
+    return agnes_take_prg_ram(agnes_, out.data());
+}
+
+bool NesEmulator::loadBatteryRam(const std::vector<uint8_t>& ram) {
+    if (!agnes_ || !rom_loaded_) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return agnes_load_prg_ram(agnes_, ram.data(), ram.size());
+}
+
+const char* NesEmulator::hashPartName(int part) {
+    static const char* const NAMES[HASH_PARTS] = {"cpu", "ppu", "ram", "input", "mapper", "screen", "apu"};
+    return part >= 0 && part < HASH_PARTS ? NAMES[part] : "";
+}
+
+void NesEmulator::hashState(uint64_t out[HASH_PARTS]) const {
+    std::fill(out, out + HASH_PARTS, FNV_OFFSET);
+    if (!agnes_ || !rom_loaded_) return;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    agnes_hash_state(agnes_, out);
+    // Padding zeroed, as for saveState()
+    nes_apu_snapshot_t apu;
+    std::memset(&apu, 0, sizeof(apu));
+    apu_.save_snapshot(&apu);
+    out[HASH_APU] = fnv1a(&apu, sizeof(apu), out[HASH_APU]);
+    if (has_vrc6_) {
+        vrc6_apu_state_t vrc6;
+        std::memset(&vrc6, 0, sizeof(vrc6));
+        vrc6_apu_.save_state(&vrc6);
+        out[HASH_APU] = fnv1a(&vrc6, sizeof(vrc6), out[HASH_APU]);
+    }
+}
+
+bool NesEmulator::fork(Fork& out) {
+    if (!agnes_ || !rom_loaded_) return false;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    out.machine.resize(agnes_save_compact(agnes_, nullptr));
+    agnes_save_compact(agnes_, out.machine.data());
+    std::memset(&out.apu, 0, sizeof(out.apu));
+    apu_.save_snapshot(&out.apu);
+    std::memset(&out.vrc6, 0, sizeof(out.vrc6));
+    vrc6_apu_.save_state(&out.vrc6);
+    out.input[0] = frame_input_[0];
+    out.input[1] = frame_input_[1];
+    out.cpu_cycles = agnes_get_cpu_cycles(agnes_);
+    return true;
+}
+
+bool NesEmulator::initLookahead(const NesEmulator& source) {
+    if (!source.rom_loaded_) return false;
+    if (!agnes_) {
+        agnes_ = agnes_make();
+        if (!agnes_) return false;
+    }
+    lookahead_ = true;
+    fast_ppu_ = source.fast_ppu_;
+    agnes_set_fast_ppu(agnes_, fast_ppu_);
+    catch_up_ppu_ = source.catch_up_ppu_;
+    agnes_set_catch_up_ppu(agnes_, catch_up_ppu_);
+    
+    // Oscillators without outputs still clock their envelopes and counters
+    connectApuOutputs(false);
+    apu_.dmc_reader(apuDmcReadCallback, this);
+    
+    // Both read the one image
+    return loadROMImage(source.rom_);
+}
+
+bool NesEmulator::restoreFork(const Fork& fork) {
+    if (!agnes_ || !rom_loaded_) return false;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // Compact states leave this machine's own pointers and APU handler alone
+    if (!agnes_load_compact(agnes_, fork.machine.data(), fork.machine.size())) return false;
+    movie_mode_.store(MovieMode::None, std::memory_order_relaxed);
+    apu_.load_snapshot(fork.apu);
+    vrc6_apu_.load_state(fork.vrc6);
+    frame_input_[0] = fork.input[0];
+    frame_input_[1] = fork.input[1];
+    last_apu_cycle_ = fork.cpu_cycles;
+    publishApuSnapshot();
+    return true;
+}
+
+bool NesEmulator::rewindTo(const Fork& fork) {
+    if (!restoreFork(fork)) return false;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    runAheadAndConvert(1);
+    return true;
+}
+
+void NesEmulator::runAheadFrame() {
+    if (!agnes_ || !rom_loaded_ || !lookahead_) return;
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    agnes_set_input(agnes_, &frame_input_[0], &frame_input_[1]);
+    agnes_next_frame(agnes_);
+    endApuFrame();
+    publishApuSnapshot();
 }
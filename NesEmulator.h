@@ -4,65 +4,321 @@
 #include "gme/Nes_Apu.h"
 #include "gme/Nes_Vrc6_Apu.h"
 #include "gme/Blip_Buffer.h"
+#include "ChannelTaps.h"
+// NES_HEADLESS builds (nes_bench) have no sokol_gfx or ImGui: frames are
+// still converted, but there is no texture to upload them to or draw
+#ifndef NES_HEADLESS
 #include "sokol_gfx.h"
 #include "imgui.h"
+#endif
+#include "InputMovie.h"
+#include "MappedFile.h"
+#include "Seqlock.h"
+#include "TripleBuffer.h"
 
 #include <vector>
-#include <string>
 #include <mutex>
 #include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <memory>
 
 // NES Emulator class that integrates agnes (CPU/PPU) with gme's Nes_Apu
+class ApuTimeline;
+class PpuPipeline;
+
 class NesEmulator {
 public:
+    // Oscillator state published at the end of every emulated frame
+    struct ApuSnapshot {
+        int periods[5];
+        int lengths[5];
+        int amplitudes[5];
+        int volumes[5];       // Register volumes, see Nes_Apu::osc_volumes
+        int vrc6_periods[3];
+        int vrc6_amplitudes[3];
+        int vrc6_volumes[3];
+        bool vrc6_enabled[3];
+        bool has_vrc6;
+        uint64_t cpu_cycles;  // CPU time the snapshot was taken at
+    };
+    
+    // Machine state a copy can run on from: CPU/PPU/mapper, the APU and VRC6
+    // registers, and the input held at the time
+    struct Fork {
+        std::vector<uint8_t> machine;  // agnes_save_compact()
+        nes_apu_snapshot_t apu;
+        vrc6_apu_state_t vrc6;
+        agnes_input_t input[2];
+        uint64_t cpu_cycles;
+    };
+    
     NesEmulator();
     ~NesEmulator();
 
     // Initialize the emulator
     bool init(long audio_sample_rate);
     
-    // Load a ROM file
+    // Load a ROM: a file is mapped, bytes are copied, and an image is
+    // shared as it is (a view into an archive, or another emulator's).
+    // agnes reads the cartridge in place, and resets run from it too.
     bool loadROM(const char* path);
     bool loadROMData(const void* data, size_t size);
+    bool loadROMImage(std::shared_ptr<const MappedFile> image);
     
-    // Emulation control
-    void reset();
-    void runFrame();
+    // Emulation control. A soft reset is the console's Reset button: CPU,
+    // PPU and APU restart, while RAM, the mapper and VRC6 keep their state.
+    // A hard reset is a power cycle of all of it. Both run from the ROM
+    // image in memory.
+    void reset(bool hard = false);
+    // present=false skips the screen conversion, for frames nobody will see
+    void runFrame(bool present = true);
+    
+    // Run-ahead: a presented frame is followed by up to MAX_RUN_AHEAD silent
+    // frames with the same input, and the last of those is shown before the
+    // machine goes back to the real frame. Hides the game's own input lag.
+    static constexpr int MAX_RUN_AHEAD = 4;
+    void setRunAhead(int frames) { run_ahead_ = std::clamp(frames, 0, MAX_RUN_AHEAD); }
+    int runAhead() const { return run_ahead_; }
+    // Average time a presented frame spent on run-ahead (ms)
+    float runAheadCost() const { return run_ahead_cost_ms_.load(std::memory_order_relaxed); }
     void pause() { running_ = false; }
     void resume() { running_ = true; }
     bool isRunning() const { return running_; }
     bool isLoaded() const { return rom_loaded_; }
+    // The ROM image loaded last; null before that
+    const std::shared_ptr<const MappedFile>& romImage() const { return rom_; }
     
-    // Input
+    // Input, taken by the next runFrame(); safe from any thread
     void setInput(int player, const agnes_input_t& input);
+    // Or a change of input made at time at, from the event that made it,
+    // for input as it arrives. The next runFrame() spreads the changes since
+    // the frame before over its cycles as they were spread in time, and each
+    // reaches the game at the first controller strobe after its point; a
+    // movie takes them at the start of the frame, as setInput()'s
+    void queueInput(int player, const agnes_input_t& input, std::chrono::steady_clock::time_point at);
+    // When the input in the frame updateScreenTexture() uploaded last was
+    // first set, if it changed since the frame before; cleared by the call,
+    // so each change is reported once. For input-to-present latency (UI thread)
+    std::chrono::steady_clock::time_point takeShownInputTime();
+    // Input the last runFrame() ran with (emulation thread)
+    const agnes_input_t& frameInput(int player) const { return frame_input_[player & 1]; }
+    
+    // Input movie of both controllers from power-on. recordMovie() power
+    // cycles and keeps the input of every runFrame() from then on;
+    // playMovie() power cycles and runs each frame on the movie's input in
+    // place of setInput()'s until the movie ends, and live input takes over.
+    // Either stops at stopMovie(), and at a state load, a rewind or a new
+    // ROM, after which the movie no longer describes the run. Between frames;
+    // movieMode() and movieFrame() are safe from any thread.
+    enum class MovieMode {
+        None,
+        Recording,
+        Playing,
+    };
+    void recordMovie();
+    // false for a movie recorded on another ROM
+    bool playMovie(InputMovie movie);
+    // The recording so far, or the movie played
+    InputMovie stopMovie();
+    MovieMode movieMode() const { return movie_mode_.load(std::memory_order_relaxed); }
+    // Frames run since the movie started, and the length of one played
+    int movieFrame() const { return movie_frame_.load(std::memory_order_relaxed); }
+    int movieFrames() const { return movie_frames_.load(std::memory_order_relaxed); }
     
     // Audio - read samples from buffer (does NOT run emulation)
     int readAudioSamples(short* buffer, int max_samples);
+    // The same audio as interleaved stereo, each voice placed by
+    // setChannelPan(); in place of readAudioSamples, never alongside
+    int readAudioStereo(short* buffer, int max_frames);
+    // Stereo placement of a voice (ChannelTable::forNesEmulator order), -1
+    // left to 1 right; any thread, heard by the next readAudioStereo()
+    void setChannelPan(int voice, float pan) { apu_buffer_.setPan(voice, pan); }
+    float channelPan(int voice) const { return apu_buffer_.pan(voice); }
+    
+    // Per-oscillator samples behind the last readAudioSamples() calls, TAP_COUNT
+    // interleaved per frame in ChannelTable::forNesEmulator voice order; same
+    // thread as readAudioSamples
+    static constexpr int TAP_COUNT = 8;
+    int readChannelTaps(short* buffer, int max_frames);
+    
+    // Discard the oldest buffered audio so at most max_samples remain (fast-forward)
+    void trimAudio(long max_samples);
+    
+    // Resize the APU's Blip_Buffer (drops buffered audio); false if allocation failed
+    bool setAudioBufferLength(int msec);
+    int audioBufferLength() const { return apu_buffer_ms_; }
     
-    // Get APU data for visualization
-    void getApuState(int* periods, int* lengths, int* amplitudes);
+    // Dynamic rate control: make ratio more (or, negative, fewer) samples per
+    // emulated frame, clamped to MAX_RATE_ADJUST, so the buffer fill can follow
+    // the audio device's clock. Takes effect from the next frame.
+    static constexpr double MAX_RATE_ADJUST = 0.005;
+    void setRateAdjust(double ratio);
+    
+    // Resampling quality of the APU's synthesis, blip_synth_linear to
+    // blip_synth_wide (Blip_Buffer::synth_quality()); from the next frame
+    void setSynthQuality(int quality);
+    
+    // Latest published APU state; never waits on emulation, safe from any thread
+    ApuSnapshot getApuSnapshot() const { return apu_snapshot_.load(); }
+    
+    // Get APU data for visualization (from the published snapshot)
+    void getApuState(int* periods, int* lengths, int* amplitudes) const;
     
     // VRC6 expansion support
     bool hasVRC6() const { return has_vrc6_; }
-    void getVRC6State(int* periods, int* volumes, bool* enabled);
+    void getVRC6State(int* periods, int* volumes, bool* enabled) const;
     
     // Get samples available in buffer
     long samplesAvailable() const;
     
+    // Buffer fill seen by the most recent readAudioSamples(), and buffer size (samples)
+    long bufferedAtLastRead() const { return buffered_at_read_.load(std::memory_order_relaxed); }
+    long bufferCapacity() const { return sample_rate_ * apu_buffer_.length() / 1000; }
+    
+#ifndef NES_HEADLESS
     // Video - get screen texture for rendering
     sg_image getScreenTexture() const { return screen_texture_; }
+#endif
+    // Upload the latest finished frame, if runFrame() made one since (UI thread)
     void updateScreenTexture();
+    // A finished frame is still waiting for updateScreenTexture()
+    bool screenPending();
+    // Palette indices of the frame last emulated, AGNES_SCREEN_WIDTH per
+    // row, whether presented or not; null before init() (emulation thread)
+    const uint8_t* screenIndices() const { return agnes_ ? agnes_get_screen_buffer(agnes_) : nullptr; }
     
+#ifndef NES_HEADLESS
     // Draw emulator screen in ImGui window
     void drawScreen(float scale = 2.0f);
+#endif
+    // Free the screen texture and its passes, for an emulator going away
+    // before sokol_gfx does (UI thread)
+    void destroyTextures() { destroyScreenTexture(); }
     
-    // State
+    // Colours the screen is converted with; a change shows from the next
+    // frame, or at once while paused
+    enum class Palette {
+        Agnes,     // agnes' built-in colours
+        Nestopia,  // Nestopia's NTSC palette
+    };
+    static constexpr int PALETTE_COUNT = 2;
+    static const char* paletteName(Palette palette);
+    void setPalette(Palette palette);
+    Palette palette() const { return palette_; }
+    
+    // How drawScreen() scales the picture up. Nearest and Smooth only pick a
+    // sampler; the others are shader passes into a target of the drawn size
+    // (Metal, like the palette lookup), so they cost GPU time alone (UI thread)
+    enum class ScreenFilter {
+        Nearest,  // Sharp pixels
+        Smooth,   // Bilinear
+        Crt,      // Scanlines and an aperture grille
+        Xbr,      // xBR-style diagonal edge smoothing
+    };
+    static constexpr int SCREEN_FILTER_COUNT = 4;
+    static const char* screenFilterName(ScreenFilter filter);
+    bool screenFilterAvailable(ScreenFilter filter) const;
+    void setScreenFilter(ScreenFilter filter);
+    ScreenFilter screenFilter() const { return screen_filter_; }
+    
+    // Draw scanlines the CPU leaves alone in one go (agnes_set_fast_ppu);
+    // the picture is the same, so this is only for timing. On by default.
+    void setFastPpu(bool fast);
+    bool fastPpu() const { return fast_ppu_; }
+    // Let the CPU run ahead of the PPU between the points where it could
+    // tell (agnes_set_catch_up_ppu); same picture again. On by default.
+    void setCatchUpPpu(bool catch_up);
+    bool catchUpPpu() const { return catch_up_ppu_; }
+    // Draw each frame on a second core while the next one runs (PpuPipeline);
+    // the picture, and the screen part of hashState(), come a frame late.
+    // Takes the scanline PPU and no run-ahead, and a frame with more than
+    // PPU_PIPELINE_MAX_CAUGHT_UP lines stepped dot by dot (a game polling
+    // PPU status through the picture) sends the next PPU_PIPELINE_RETRY_FRAMES
+    // back to serial, as both cores would step those lines. Off by default.
+    static constexpr int PPU_PIPELINE_MAX_CAUGHT_UP = 60;
+    static constexpr int PPU_PIPELINE_RETRY_FRAMES = 600;
+    void setPipelinedPpu(bool pipelined);
+    bool pipelinedPpu() const { return pipelined_ppu_.load(std::memory_order_relaxed); }
+    // Whether the last frame was drawn on the second core
+    bool ppuPipelineActive() const { return ppu_pipeline_active_.load(std::memory_order_relaxed); }
+    
+#ifdef AGNES_PROFILE
+    // Where the 6502 spent its cycles since the ROM was loaded or the
+    // profile cleared (agnes_profile_t): the hottest instruction addresses
+    // first, and NMI/IRQ handler time a frame. Frames run ahead count too.
+    struct CpuProfile {
+        struct Spot {
+            uint16_t pc;
+            uint32_t cycles;
+        };
+        std::vector<Spot> hot;
+        uint64_t total_cycles = 0;
+        uint64_t dma_cycles = 0;
+        uint64_t frames = 0;
+        uint32_t nmi_cycles = 0;  // Last frame
+        uint32_t irq_cycles = 0;
+        uint32_t nmi_peak = 0;
+        uint32_t irq_peak = 0;
+    };
+    void cpuProfile(CpuProfile& out, size_t max_spots) const;
+    void clearCpuProfile();
+#endif
+    
+    // Wall time spent in the APU and the audio buffer while profiling is on:
+    // register writes, frame ends and sample reads. Off by default, as it
+    // reads the clock on every APU access.
+    void setApuProfiling(bool on) { profile_apu_ = on; }
+    
+    // Log the APU register writes of the frames that are heard into
+    // timeline, on the CPU cycle clock, or stop if nullptr (before the
+    // emulation thread runs, or on it)
+    void setApuTimeline(ApuTimeline* timeline);
+    double apuSeconds() const { return apu_time_ns_.load(std::memory_order_relaxed) * 1e-9; }
+    
+    // State (CPU time at the end of the last finished frame, safe from any thread)
     uint64_t getCpuCycles() const;
     int getCurrentScanline() const;
     
-    // Save/Load state
+    // Save/Load state: a versioned header, then the compact machine state
+    // (no screen or pointers), the APU snapshot and the VRC6 state. Only
+    // loads into the ROM it was saved from.
+    static constexpr uint16_t STATE_VERSION = 1;
     bool saveState(std::vector<uint8_t>& out_state);
     bool loadState(const std::vector<uint8_t>& state);
+    
+    // Battery-backed PRG RAM (agnes_prg_ram_size()), what a .sav file holds;
+    // 0 bytes for a cartridge without a battery. takeBatteryRam() copies it
+    // only if the game wrote it since the last take, and costs next to
+    // nothing otherwise (emulation thread); loadBatteryRam() goes in after
+    // loadROM(), before the game runs.
+    size_t batteryRamSize() const;
+    bool takeBatteryRam(std::vector<uint8_t>& out);
+    bool loadBatteryRam(const std::vector<uint8_t>& ram);
+    
+    // Each part of the machine hashed on its own: agnes_hash_state()'s, then
+    // the APUs'. Two runs, or two builds, diverge at the first frame whose
+    // hashes differ, in the part that differs. Between frames (emulation thread)
+    static constexpr int HASH_APU = AGNES_HASH_COUNT;
+    static constexpr int HASH_PARTS = AGNES_HASH_COUNT + 1;
+    static const char* hashPartName(int part);
+    void hashState(uint64_t out[HASH_PARTS]) const;
+    
+    // Capture the state between frames for a lookahead copy (emulation thread)
+    bool fork(Fork& out);
+    
+    // agnes, the APUs' buffers, run-ahead state and the screen textures
+    void reportMemory(MemoryReport::Sample& sample) const;
+    
+    // Lookahead copy of source's game: no audio, screen or texture. Each
+    // restoreFork() is followed by runAheadFrame() calls, which publish the
+    // APU state for getApuSnapshot() like runFrame(). Emulation thread.
+    bool initLookahead(const NesEmulator& source);
+    // Go back to a fork of this machine's own run (rewind). A fork has no
+    // screen, so the picture is that of the frame after it, run silently.
+    bool rewindTo(const Fork& fork);
+    bool restoreFork(const Fork& fork);
+    void runAheadFrame();
 
 private:
     // Agnes (CPU/PPU/Mappers)
@@ -71,46 +327,163 @@ private:
     // APU (from gme)
     Nes_Apu apu_;
     Nes_Vrc6_Apu vrc6_apu_;
-    Blip_Buffer apu_buffer_;
+    ChannelTapBuffer apu_buffer_{1};  // Mono; one tap per oscillator
     long sample_rate_ = 44100;
+    int apu_buffer_ms_ = 200;
+    double rate_adjust_ = 0.0;
     bool has_vrc6_ = false;
+    bool lookahead_ = false;  // A copy made by initLookahead(), with no audio output
+    
+    // Run-ahead; the saved state is reused to avoid allocating per frame
+    std::atomic<int> run_ahead_{0};
+    std::atomic<float> run_ahead_cost_ms_{0.0f};
+    std::vector<uint8_t> run_ahead_state_;
+    std::atomic<long> buffered_at_read_{0};
+    bool profile_apu_ = false;
+    ApuTimeline* apu_timeline_ = nullptr;
+    std::atomic<int64_t> apu_time_ns_{0};
+    Seqlock<ApuSnapshot> apu_snapshot_;
     
     // APU timing
     uint64_t last_apu_cycle_ = 0;
     static constexpr double CPU_CLOCK_NTSC = 1789773.0;
     static constexpr int CYCLES_PER_FRAME = 29780;  // ~60fps NTSC
     
+    // Register writes of the frame so far, in order, for syncApu() to apply.
+    // Reserved for a frame of back-to-back stores, so the CPU loop only
+    // appends to memory it already has.
+    struct ApuWrite {
+        nes_time_t time;  // CPU cycles into the APU frame
+        uint16_t addr;
+        uint8_t value;
+    };
+    static constexpr size_t APU_LOG_RESERVE = CYCLES_PER_FRAME / 4 + 1;
+    std::vector<ApuWrite> apu_log_;
+    
+#ifndef NES_HEADLESS
     // Screen texture (new sokol API uses image + view + sampler)
     sg_image screen_texture_;
     sg_view screen_view_;
     sg_sampler screen_sampler_;
-    uint32_t screen_pixels_[AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT];
-    bool texture_created_ = false;
+    
+    // GPU palette lookup (Metal): the frame goes up as an R8 texture of
+    // palette indices, and a pass over screen_texture_ looks up the colours
+    // in a 64x1 palette texture. Other backends convert on the CPU.
+    sg_image index_image_;
+    sg_image palette_image_;
+    sg_view index_view_;
+    sg_view palette_view_;
+    sg_view target_view_;
+    sg_shader palette_shader_;
+    sg_pipeline palette_pipeline_;
+    
+    // Screen filter passes (Metal): screen_texture_ is redrawn into
+    // filter_image_, sized to the draw in framebuffer pixels, when either
+    // changes. smooth_sampler_ shows it, and is the Smooth filter itself.
+    sg_sampler smooth_sampler_;
+    sg_image filter_image_ = {};
+    sg_view filter_view_ = {};
+    sg_view filter_target_view_ = {};
+    int filter_width_ = 0;
+    int filter_height_ = 0;
+    sg_shader crt_shader_;
+    sg_shader xbr_shader_;
+    sg_pipeline crt_pipeline_;
+    sg_pipeline xbr_pipeline_;
+#endif
+    bool gpu_palette_ = false;  // Set once by createScreenTexture()
+    bool gpu_filters_ = false;  // Likewise
+    ScreenFilter screen_filter_ = ScreenFilter::Nearest;  // UI thread, as is the rest
+    bool filter_dirty_ = true;  // screen_texture_ changed since the last filter pass
+    
+    // A finished frame: RGBA pixels, or with the GPU lookup palette indices
+    struct ScreenFrame {
+        uint32_t pixels[AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT];
+        uint8_t indices[AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT];
+        std::chrono::steady_clock::time_point input_time;  // Input change it shows first, or zero
+    };
+    
+    // convertScreen() (mutex_ held) fills and publishes the back frame, and
+    // updateScreenTexture() uploads the newest one without taking any lock
+    TripleBuffer<ScreenFrame> frames_;
+    bool screen_stale_ = true;  // Convert even an unchanged frame; guarded by mutex_
+    
+    // New palette for the GPU lookup; rare, so a plain mutex will do
+    uint32_t upload_palette_[64];
+    std::atomic<bool> palette_pending_{false};
+    std::mutex palette_mutex_;
+    std::atomic<bool> texture_created_{false};
     
     // State
     std::atomic<bool> running_{false};
     bool rom_loaded_ = false;
-    std::string rom_path_;
-    std::vector<uint8_t> rom_data_;
+    std::shared_ptr<const MappedFile> rom_;  // agnes reads the cartridge from here in place
     
     // Input
-    agnes_input_t input_[2] = {};
+    agnes_input_t input_[2] = {};        // Guarded by input_mutex_
+    agnes_input_t frame_input_[2] = {};  // Copy the current frame runs with
+    std::mutex input_mutex_;
+    std::chrono::steady_clock::time_point input_changed_at_;  // Guarded by input_mutex_
+    std::chrono::steady_clock::time_point unshown_input_at_;  // Not converted yet; mutex_
+    std::chrono::steady_clock::time_point shown_input_at_;    // UI thread
+    
+    // Timed input: queued by queueInput(), then placed on the frame's
+    // cycles by runFrame() and applied from the controller strobe callback
+    struct InputEvent {
+        std::chrono::steady_clock::time_point at;
+        uint64_t cycle;
+        int player;
+        agnes_input_t input;
+    };
+    static constexpr size_t MAX_INPUT_EVENTS = 64;  // Queued between two frames; older ones are dropped
+    static constexpr std::chrono::milliseconds MAX_INPUT_SPAN{33};  // Time one frame stands for, at most
+    std::vector<InputEvent> input_events_;  // Guarded by input_mutex_
+    std::vector<InputEvent> frame_events_;  // The running frame's, by cycle; mutex_
+    size_t frame_event_ = 0;                // Next of frame_events_ to apply
+    std::chrono::steady_clock::time_point last_frame_at_;  // When runFrame() last took input; mutex_
+    InputMovie movie_;  // Guarded by mutex_
+    std::atomic<MovieMode> movie_mode_{MovieMode::None};
+    std::atomic<int> movie_frame_{0};
+    std::atomic<int> movie_frames_{0};
     
     // Thread safety
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
     
     // APU callback functions (static, called by agnes)
     static void apuWriteCallback(void* user_data, uint16_t addr, uint8_t val, uint64_t cpu_cycle);
     static uint8_t apuReadCallback(void* user_data, uint16_t addr, uint64_t cpu_cycle);
     static int apuDmcReadCallback(void* user_data, unsigned addr);
+    static void inputStrobeCallback(void* user_data, uint64_t cpu_cycle);
     
     // Internal helpers
     void initApu();
-    void syncApu(uint64_t cpu_cycle);
-    void endApuFrame();
+    void syncApu();
+    void endApuFrame(bool to_buffer = true);
+    void connectApuOutputs(bool connect);
+    void applyInputEvents(uint64_t cpu_cycle);  // Those of frame_events_ due by then
+    void runAheadAndConvert(int frames);
+    agnes_ppu_log_t* beginPpuLog();
+    void endPpuLog(agnes_ppu_log_t* log);
+    void drainPpuPipeline();
+    long outputClockRate() const;
+    void publishApuSnapshot();
+    void convertScreen();
     void createScreenTexture();
+    void createPalettePass();
+    void createFilterPasses();
+    void destroyFilterTarget();
+    void runFilterPass(int width, int height);
     void destroyScreenTexture();
     
-    // NES color palette (NTSC)
+    // NES color palette (NTSC, from Nestopia), 0xAARRGGBB
     static const uint32_t nes_palette_[64];
+    // The selected palette as texture pixels (RGBA8 bytes), by index; mutex_
+    Palette palette_ = Palette::Agnes;
+    uint32_t palette_lut_[64];
+    bool fast_ppu_ = true;  // mutex_
+    bool catch_up_ppu_ = true;  // mutex_
+    std::unique_ptr<PpuPipeline> ppu_pipeline_;  // While pipelined; mutex_
+    std::atomic<bool> pipelined_ppu_{false};
+    std::atomic<bool> ppu_pipeline_active_{false};
+    int ppu_serial_frames_ = 0;  // Left before pipelining again; mutex_
 };
@@ -0,0 +1,98 @@
+#include "NesFarm.h"
+#include "InputScript.h"
+#include "MappedFile.h"
+#include "NesEmulator.h"
+#include "ZipArchive.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+}  // namespace
+
+NesFarm::Result NesFarm::runJob(const Job& job, std::shared_ptr<const MappedFile> rom) {
+    Result result;
+    const auto start = std::chrono::steady_clock::now();
+
+    InputScript script;
+    if (!job.script.empty() && !script.load(job.script.c_str(), &result.error)) return result;
+
+    // On the heap: an emulator carries its frame buffers inline
+    auto emu = std::make_unique<NesEmulator>();
+    if (!rom) rom = ZipArchive::openPath(job.rom.c_str());
+    if (!rom || !emu->init(SAMPLE_RATE) || !emu->loadROMImage(std::move(rom))) {
+        result.error = "could not load " + job.rom;
+        return result;
+    }
+    emu->resume();
+
+    // Drained every frame, as the device would
+    std::vector<short> samples(SAMPLE_RATE / 10);
+    std::vector<short> taps(samples.size() * NesEmulator::TAP_COUNT);
+    result.frame_hashes.reserve(static_cast<size_t>(std::max(job.frames, 0)));
+    result.audio_hash = FNV_OFFSET;
+    for (int f = 0; f < job.frames; ++f) {
+        emu->setInput(0, script.at(f, 0));
+        emu->setInput(1, script.at(f, 1));
+        emu->runFrame(false);
+        result.frame_hashes.push_back(
+            hashBytes(emu->screenIndices(), AGNES_SCREEN_WIDTH * AGNES_SCREEN_HEIGHT, FNV_OFFSET));
+
+        const int count = emu->readAudioSamples(samples.data(), static_cast<int>(samples.size()));
+        emu->readChannelTaps(taps.data(), static_cast<int>(samples.size()));
+        result.audio_hash = hashBytes(samples.data(), count * sizeof(short), result.audio_hash);
+        result.audio_samples += count;
+        if (job.keep_audio) result.audio.insert(result.audio.end(), samples.begin(), samples.begin() + count);
+    }
+
+    result.ok = true;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::vector<NesFarm::Result> NesFarm::run(const std::vector<Job>& jobs, int threads,
+                                          const std::function<void(size_t)>& done) {
+    std::vector<Result> results(jobs.size());
+    if (threads <= 0) threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = static_cast<int>(std::min<size_t>(static_cast<size_t>(threads), std::max<size_t>(jobs.size(), 1)));
+
+    // One image per ROM, however many jobs run it: a suite is mostly a few
+    // games under many movies. Each goes when its last job does.
+    std::vector<std::shared_ptr<const MappedFile>> images(jobs.size());
+    {
+        std::map<std::string, std::shared_ptr<const MappedFile>> opened;
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            auto [it, added] = opened.try_emplace(jobs[i].rom);
+            if (added) it->second = ZipArchive::openPath(jobs[i].rom.c_str());
+            images[i] = it->second;
+        }
+    }
+
+    // Each worker takes the next job not yet taken; results go to their own slots
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1)) {
+            results[i] = runJob(jobs[i], std::move(images[i]));
+            if (done) done(i);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers) worker.join();
+    return results;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+// Offline runs of many ROMs and input movies at once, for regression tests.
+// Each job gets its own headless NesEmulator (NES_HEADLESS: agnes and the
+// APUs, no sokol or ImGui), and a fixed pool of worker threads takes jobs
+// in order. Instances share nothing but the read-only tables of the cores
+// and, for jobs of the same ROM, its one image: agnes reads the cartridge in
+// place, and CHR-RAM and PRG-RAM are each machine's own state anyway.
+class NesFarm {
+public:
+    struct Job {
+        std::string rom;
+        std::string script;   // InputScript path; empty for no input
+        int frames = 3600;
+        bool keep_audio = false;  // Fill Result::audio
+    };
+
+    struct Result {
+        bool ok = false;
+        std::string error;
+        std::vector<uint64_t> frame_hashes;  // FNV-1a of each frame's palette indices
+        uint64_t audio_hash = 0;             // FNV-1a of all samples
+        long audio_samples = 0;
+        std::vector<short> audio;            // Mono at SAMPLE_RATE, if kept
+        double seconds = 0.0;
+    };
+
+    static constexpr long SAMPLE_RATE = 44100;
+
+    // Run every job on up to threads workers (0: one per hardware thread).
+    // Results are in job order; done, if set, is called with each job's
+    // index as it finishes, from its worker thread.
+    static std::vector<Result> run(const std::vector<Job>& jobs, int threads,
+                                   const std::function<void(size_t)>& done = {});
+    // One job on the calling thread, on rom if given (job.rom's image,
+    // shared with other jobs) or else on job.rom opened for it
+    static Result runJob(const Job& job, std::shared_ptr<const MappedFile> rom = nullptr);
+};
@@ -0,0 +1,170 @@
+// Runs a list of ROMs and input movies headless and in parallel, one
+// NesEmulator per job, and reports a hash of every frame and of the audio.
+// For regression runs: compare the summary or the hash files against a
+// previous build's.
+//
+//   nes_farm <jobs.txt> [--threads N] [--frames N] [--hashes-dir DIR] [--wav-dir DIR]
+//
+// The jobs file has one "<rom> [script.txt] [frames]" line per job; # starts
+// a comment, and "-" for the script means no input. --frames is the default
+// for lines without a count. With --hashes-dir, job i's frame hashes go to
+// DIR/job<i>.txt, one per line; with --wav-dir, its audio to DIR/job<i>.wav.
+
+#include "NesFarm.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool readJobs(const char* path, int default_frames, std::vector<NesFarm::Job>* jobs) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "could not read %s\n", path);
+        return false;
+    }
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        NesFarm::Job job;
+        job.frames = default_frames;
+        if (!(words >> job.rom)) continue;
+        std::string word;
+        if (words >> word && word != "-") job.script = word;
+        if (words >> word) {
+            char* end = nullptr;
+            job.frames = static_cast<int>(std::strtol(word.c_str(), &end, 10));
+            if (*end || job.frames <= 0) {
+                std::fprintf(stderr, "%s:%d: bad frame count '%s'\n", path, line_no, word.c_str());
+                return false;
+            }
+        }
+        jobs->push_back(job);
+    }
+    return true;
+}
+
+void put16(std::ofstream& out, uint32_t value) {
+    const char bytes[2] = {static_cast<char>(value), static_cast<char>(value >> 8)};
+    out.write(bytes, 2);
+}
+
+void put32(std::ofstream& out, uint32_t value) {
+    put16(out, value & 0xFFFF);
+    put16(out, value >> 16);
+}
+
+// 16-bit mono PCM; samples are host order, which is little-endian on every target
+bool writeWav(const std::string& path, const std::vector<short>& samples, long rate) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) return false;
+    const uint32_t data_size = static_cast<uint32_t>(samples.size() * sizeof(short));
+    out.write("RIFF", 4);
+    put32(out, 36 + data_size);
+    out.write("WAVEfmt ", 8);
+    put32(out, 16);
+    put16(out, 1);  // PCM
+    put16(out, 1);  // Channels
+    put32(out, static_cast<uint32_t>(rate));
+    put32(out, static_cast<uint32_t>(rate * sizeof(short)));
+    put16(out, sizeof(short));
+    put16(out, 16);
+    out.write("data", 4);
+    put32(out, data_size);
+    out.write(reinterpret_cast<const char*>(samples.data()), data_size);
+    return static_cast<bool>(out);
+}
+
+bool writeHashes(const std::string& path, const std::vector<uint64_t>& hashes) {
+    FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) return false;
+    for (uint64_t hash : hashes) std::fprintf(out, "%016llx\n", static_cast<unsigned long long>(hash));
+    return std::fclose(out) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const char* jobs_path = nullptr;
+    const char* hashes_dir = nullptr;
+    const char* wav_dir = nullptr;
+    int threads = 0;
+    int frames = 3600;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hashes-dir") == 0 && i + 1 < argc) {
+            hashes_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--wav-dir") == 0 && i + 1 < argc) {
+            wav_dir = argv[++i];
+        } else if (argv[i][0] != '-' && !jobs_path) {
+            jobs_path = argv[i];
+        } else {
+            jobs_path = nullptr;
+            break;
+        }
+    }
+    if (!jobs_path || frames <= 0 || threads < 0) {
+        std::fprintf(stderr,
+                     "usage: %s <jobs.txt> [--threads N] [--frames N] [--hashes-dir DIR] [--wav-dir DIR]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::vector<NesFarm::Job> jobs;
+    if (!readJobs(jobs_path, frames, &jobs)) return 1;
+    for (NesFarm::Job& job : jobs) job.keep_audio = wav_dir != nullptr;
+
+    // Progress on stderr as jobs finish; the summary below is in job order
+    std::mutex progress_mutex;
+    size_t finished = 0;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<NesFarm::Result> results = NesFarm::run(jobs, threads, [&](size_t) {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        std::fprintf(stderr, "\r%zu/%zu jobs", ++finished, jobs.size());
+    });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!jobs.empty()) std::fprintf(stderr, "\n");
+
+    int failed = 0;
+    long total_frames = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const NesFarm::Result& result = results[i];
+        if (!result.ok) {
+            std::printf("job%zu  %s  FAILED: %s\n", i, jobs[i].rom.c_str(), result.error.c_str());
+            ++failed;
+            continue;
+        }
+
+        // The last frame's hash and the audio's stand for the run
+        const uint64_t last = result.frame_hashes.empty() ? 0 : result.frame_hashes.back();
+        std::printf("job%zu  %s  frames %d  screen %016llx  audio %016llx  %.3f s\n", i, jobs[i].rom.c_str(),
+                    jobs[i].frames, static_cast<unsigned long long>(last),
+                    static_cast<unsigned long long>(result.audio_hash), result.seconds);
+        total_frames += jobs[i].frames;
+
+        const std::string name = "/job" + std::to_string(i);
+        if (hashes_dir && !writeHashes(hashes_dir + name + ".txt", result.frame_hashes)) {
+            std::fprintf(stderr, "could not write %s%s.txt\n", hashes_dir, name.c_str());
+            ++failed;
+        }
+        if (wav_dir && !writeWav(wav_dir + name + ".wav", result.audio, NesFarm::SAMPLE_RATE)) {
+            std::fprintf(stderr, "could not write %s%s.wav\n", wav_dir, name.c_str());
+            ++failed;
+        }
+    }
+    std::printf("%zu jobs, %ld frames in %.3f s: %.1f frames/s\n", jobs.size(), total_frames, seconds,
+                total_frames / seconds);
+    return failed ? 1 : 0;
+}
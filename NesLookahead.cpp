@@ -0,0 +1,159 @@
+#include "NesLookahead.h"
+#include <algorithm>
+#include <cstring>
+
+bool NesLookahead::start(const NesEmulator& source) {
+    stop();
+    if (!ahead_.initLookahead(source)) return false;
+
+    layout_ = ChannelTable::forNesEmulator(source.hasVRC6());
+    fork_input_ = {};
+    last_cycles_ = source.getCpuCycles();
+    frames_since_fork_ = FORK_FRAMES;  // The first frame forks
+    active_ = true;
+    return true;
+}
+
+void NesLookahead::stop() {
+    finishRun();
+    active_ = false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    notes_.reset();
+}
+
+void NesLookahead::onFrame(NesEmulator& emu, const agnes_input_t& input) {
+    if (!active_) return;
+
+    // A reset or a loaded state sends the clock back: nothing predicted holds.
+    // Otherwise the prediction holds up to the frame that saw other input.
+    const uint64_t cycles = emu.getCpuCycles();
+    const bool rewound = cycles < last_cycles_;
+    const bool diverged = rewound || std::memcmp(&input, &fork_input_, sizeof(input)) != 0;
+    const uint64_t frame_start = last_cycles_;
+    last_cycles_ = cycles;
+    ++frames_since_fork_;
+
+    if (diverged) {
+        finishRun();
+        if (rewound) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            notes_.reset();
+        } else {
+            cutAt(static_cast<int64_t>(frame_start));
+        }
+    }
+
+    // A run still going when the next fork is due delays it, bounding the cost at one copy
+    if (busy_.load()) return;
+    if (diverged || frames_since_fork_ >= FORK_FRAMES) launch(emu);
+}
+
+std::shared_ptr<const PreprocessedTrack> NesLookahead::notes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return notes_;
+}
+
+void NesLookahead::reportMemory(MemoryReport::Sample& sample) const {
+    ahead_.reportMemory(sample);
+    if (std::shared_ptr<const PreprocessedTrack> track = notes()) {
+        sample.add(MemoryReport::PIANO_NOTES, sizeof(*track) + MemoryReport::heapBytes(track->notes));
+    }
+}
+
+void NesLookahead::finishRun() {
+    cancel_.store(true);
+    JobPool::shared().cancel(job_);
+    JobPool::shared().wait(job_);
+    busy_.store(false);  // Also for a run dropped before it started
+}
+
+void NesLookahead::launch(NesEmulator& emu) {
+    JobPool::shared().wait(job_);
+
+    NesEmulator::Fork fork;
+    if (!emu.fork(fork)) return;
+    fork_input_ = fork.input[0];
+    frames_since_fork_ = 0;
+    cancel_.store(false);
+    busy_.store(true);
+    JobPool::shared().submit(job_, JobPool::Priority::High,
+                             [this, fork = std::move(fork)]() mutable { run(std::move(fork)); });
+}
+
+void NesLookahead::cutAt(int64_t time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!notes_) return;
+
+    auto cut = std::make_shared<PreprocessedTrack>();
+    for (PianoRollNote note : notes_->notes) {
+        if (note.start >= time) break;
+        note.end = std::min(note.end, time);
+        cut->notes.push_back(note);
+    }
+    cut->duration = time;
+    notes_ = std::move(cut);
+}
+
+void NesLookahead::run(NesEmulator::Fork fork) {
+    if (!ahead_.restoreFork(fork)) {
+        busy_.store(false);
+        return;
+    }
+
+    // Sampled once per frame, as the live keyboard sees the real run
+    PianoVisualizer piano;
+    ChannelTable table = layout_;
+    piano.beginNotes(layout_);
+    auto sample = [&]() {
+        const NesEmulator::ApuSnapshot apu = ahead_.getApuSnapshot();
+        table.sampleApu(apu.periods, apu.lengths, apu.amplitudes, apu.volumes);
+        if (apu.has_vrc6) {
+            table.sampleVrc6(apu.vrc6_periods, apu.vrc6_amplitudes, apu.vrc6_volumes, apu.vrc6_enabled);
+        }
+        piano.addChannelSample(table, static_cast<int64_t>(apu.cpu_cycles));
+    };
+
+    const int64_t fork_time = static_cast<int64_t>(fork.cpu_cycles);
+    const int frames = static_cast<int>(LOOKAHEAD_SECONDS * 60.0f);
+    sample();
+    for (int f = 0; f < frames && !cancel_.load(); ++f) {
+        ahead_.runAheadFrame();
+        sample();
+    }
+    const int64_t end_time = static_cast<int64_t>(ahead_.getCpuCycles());
+    piano.finishNotes(end_time);
+    PreprocessedTrack ahead = piano.takePreprocessedData();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!cancel_.load()) {
+        // Notes already shown before the fork are kept, about one screen of
+        // them; one still sounding there continues into its prediction
+        auto merged = std::make_shared<PreprocessedTrack>();
+        const int64_t keep_from = fork_time - NoteClock::fromSeconds(LOOKAHEAD_SECONDS);
+        if (notes_) {
+            for (PianoRollNote note : notes_->notes) {
+                if (note.start >= fork_time) break;
+                if (note.end <= keep_from) continue;
+                auto continued = std::find_if(ahead.notes.begin(), ahead.notes.end(), [&](const PianoRollNote& next) {
+                    return next.start <= fork_time && next.channel == note.channel &&
+                           next.midi_note == note.midi_note && note.end >= fork_time;
+                });
+                if (continued != ahead.notes.end()) {
+                    continued->start = note.start;
+                    continue;
+                }
+                note.end = std::min(note.end, fork_time);
+                merged->notes.push_back(note);
+            }
+        }
+        merged->notes.insert(merged->notes.end(), ahead.notes.begin(), ahead.notes.end());
+        std::stable_sort(merged->notes.begin(), merged->notes.end(),
+                         [](const PianoRollNote& a, const PianoRollNote& b) {
+                             return a.start < b.start;
+                         });
+        merged->duration = end_time;
+        notes_ = std::move(merged);
+    }
+    busy_.store(false);
+}
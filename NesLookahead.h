@@ -0,0 +1,58 @@
+#pragma once
+
+#include "JobPool.h"
+#include "NesEmulator.h"
+#include "PianoVisualizer.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// Predicted piano notes for NES emulator mode, where there is no track to
+// preprocess. Every FORK_FRAMES frames the running game is forked, and a
+// copy of it runs LOOKAHEAD_SECONDS ahead as a High job on the shared pool with the
+// input held at the fork. The prediction is exact until the real input
+// changes; then the part after that moment is dropped and the game forked
+// again at once. Times are CPU cycles, the NoteClock, as the roll's cursor
+// in this mode.
+class NesLookahead {
+public:
+    static constexpr int FORK_FRAMES = 60;
+    static constexpr float LOOKAHEAD_SECONDS = 4.0f;
+
+    ~NesLookahead() { stop(); }
+
+    // Predict for source's game from its next frame on (between frames)
+    bool start(const NesEmulator& source);
+    // Cancel the run in flight and drop the prediction
+    void stop();
+
+    // After each emulated frame of emu, with the input it was given (emulation thread)
+    void onFrame(NesEmulator& emu, const agnes_input_t& input);
+
+    // Notes predicted so far, nullptr before the first run. A new pointer means new data.
+    std::shared_ptr<const PreprocessedTrack> notes() const;
+
+    // The copy it runs and the notes predicted
+    void reportMemory(MemoryReport::Sample& sample) const;
+
+private:
+    void launch(NesEmulator& emu);
+    void finishRun();  // Cancel the run and wait for its job
+    void cutAt(int64_t time);  // Drop what was predicted after time
+    void run(NesEmulator::Fork fork);
+
+    NesEmulator ahead_;       // Only touched by the job once started
+    ChannelTable layout_;
+    JobPool::Group job_;
+    std::atomic<bool> busy_{false};
+    std::atomic<bool> cancel_{false};
+    bool active_ = false;
+
+    // Where the last fork was taken, to tell when the real run leaves it
+    agnes_input_t fork_input_ = {};
+    uint64_t last_cycles_ = 0;
+    int frames_since_fork_ = 0;
+
+    mutable std::mutex mutex_;
+    std::shared_ptr<const PreprocessedTrack> notes_;  // Guarded by mutex_
+};
@@ -0,0 +1,262 @@
+#include "NesRewind.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+void putVarLen(std::vector<uint8_t>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+size_t getVarLen(const uint8_t*& in) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        const uint8_t byte = *in++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+}
+
+// (zero run, literal run, literals) triples of data XOR base; base may be null
+void encodeXor(const std::vector<uint8_t>& data, const uint8_t* base, std::vector<uint8_t>& out) {
+    out.clear();
+    const size_t size = data.size();
+    size_t i = 0;
+    while (i < size) {
+        const size_t zeros_from = i;
+        while (i < size && data[i] == (base ? base[i] : 0)) ++i;
+        const size_t literals_from = i;
+        // A literal run ends at the first stretch of four unchanged bytes
+        while (i < size) {
+            size_t same = 0;
+            while (same < 4 && i + same < size && data[i + same] == (base ? base[i + same] : 0)) ++same;
+            if (same == 4 || i + same == size) break;
+            i += same + 1;
+        }
+        putVarLen(out, literals_from - zeros_from);
+        putVarLen(out, i - literals_from);
+        for (size_t j = literals_from; j < i; ++j) {
+            out.push_back(static_cast<uint8_t>(data[j] ^ (base ? base[j] : 0)));
+        }
+    }
+}
+
+// XOR an encoded record into data, which holds its base
+void applyXor(const uint8_t* in, size_t in_size, std::vector<uint8_t>& data) {
+    const uint8_t* end = in + in_size;
+    size_t pos = 0;
+    while (in < end) {
+        pos += getVarLen(in);
+        const size_t literals = getVarLen(in);
+        for (size_t j = 0; j < literals; ++j) data[pos + j] ^= in[j];
+        in += literals;
+        pos += literals;
+    }
+}
+
+template <typename T>
+void putRaw(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+void getRaw(const uint8_t*& in, T& value) {
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+}
+
+void flatten(const NesEmulator::Fork& fork, std::vector<uint8_t>& out) {
+    out.assign(fork.machine.begin(), fork.machine.end());
+    putRaw(out, fork.apu);
+    putRaw(out, fork.vrc6);
+    putRaw(out, fork.input);
+    putRaw(out, fork.cpu_cycles);
+}
+
+void unflatten(const std::vector<uint8_t>& in, NesEmulator::Fork& fork) {
+    const size_t machine_size = in.size() - sizeof(fork.apu) - sizeof(fork.vrc6) - sizeof(fork.input) -
+                                sizeof(fork.cpu_cycles);
+    fork.machine.assign(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(machine_size));
+    const uint8_t* p = in.data() + machine_size;
+    getRaw(p, fork.apu);
+    getRaw(p, fork.vrc6);
+    getRaw(p, fork.input);
+    getRaw(p, fork.cpu_cycles);
+}
+
+}  // namespace
+
+void NesRewind::start(size_t budget) {
+    stop();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_.assign(budget, 0);
+    records_.clear();
+    write_pos_ = 0;
+    frames_since_key_ = KEYFRAME_INTERVAL;
+    free_.clear();
+    pending_.clear();
+    pending_.reserve(POOL_SIZE);
+    for (int i = 0; i < POOL_SIZE; ++i) free_.push_back(i);
+    quit_ = false;
+    encoder_ = std::thread(&NesRewind::encoderLoop, this);
+}
+
+void NesRewind::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    if (encoder_.joinable()) encoder_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_.clear();
+    ring_.shrink_to_fit();
+    records_.clear();
+    free_.clear();
+    pending_.clear();
+}
+
+size_t NesRewind::budget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ring_.size();
+}
+
+int NesRewind::framesStored() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(records_.size() + pending_.size());
+}
+
+void NesRewind::reportMemory(MemoryReport::Sample& sample) const {
+    using MR = MemoryReport;
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Pool forks are filled outside the lock; each holds about a flattened frame
+    size_t bytes = MR::heapBytes(ring_) + MR::heapBytes(key_) + MR::heapBytes(flat_) + MR::heapBytes(scratch_) +
+                   records_.size() * sizeof(Record) + POOL_SIZE * flat_.capacity();
+    sample.add(MR::SAVE_STATES, bytes);
+}
+
+void NesRewind::capture(NesEmulator& emu) {
+    int slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty() || ring_.empty()) return;  // Encoder behind, or not started
+        slot = free_.back();
+        free_.pop_back();
+    }
+
+    const bool ok = emu.fork(pool_[slot]);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ok) {
+            pending_.push_back(slot);
+        } else {
+            free_.push_back(slot);
+        }
+    }
+    if (ok) wake_.notify_one();
+}
+
+bool NesRewind::stepBack(NesEmulator& emu) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Frames still queued are the newest
+    while (!pending_.empty()) {
+        const int slot = pending_.front();
+        pending_.erase(pending_.begin());
+        encode(pool_[slot]);
+        free_.push_back(slot);
+    }
+    if (records_.empty() || !decode(records_.size() - 1, restore_)) return false;
+
+    write_pos_ = records_.back().offset;
+    records_.pop_back();
+    frames_since_key_ = KEYFRAME_INTERVAL;  // key_ may be gone; the next frame starts afresh
+    lock.unlock();
+
+    return emu.rewindTo(restore_);
+}
+
+void NesRewind::encoderLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return quit_ || !pending_.empty(); });
+        if (quit_) return;
+
+        const int slot = pending_.front();
+        pending_.erase(pending_.begin());
+        encode(pool_[slot]);
+        free_.push_back(slot);
+    }
+}
+
+void NesRewind::encode(const NesEmulator::Fork& fork) {
+    flatten(fork, flat_);
+
+    const bool key = frames_since_key_ >= KEYFRAME_INTERVAL || key_.size() != flat_.size();
+    if (key) {
+        encodeXor(flat_, nullptr, scratch_);
+        key_.swap(flat_);
+        frames_since_key_ = 0;
+    } else {
+        encodeXor(flat_, key_.data(), scratch_);
+    }
+    ++frames_since_key_;
+    store(key);
+}
+
+void NesRewind::store(bool key) {
+    const size_t size = scratch_.size();
+    if (size > ring_.size()) {
+        records_.clear();
+        write_pos_ = 0;
+        frames_since_key_ = KEYFRAME_INTERVAL;
+        return;
+    }
+
+    // Records past the write position are the oldest; a record that doesn't
+    // fit before the end of the ring wraps to the start, evicting them
+    size_t pos = write_pos_;
+    if (records_.empty()) pos = 0;
+    if (pos + size > ring_.size()) {
+        while (!records_.empty() && records_.front().offset >= pos) records_.pop_front();
+        pos = 0;
+    }
+    while (!records_.empty() && records_.front().offset >= pos && records_.front().offset < pos + size) {
+        records_.pop_front();
+    }
+    // Deltas whose keyframe went are no use
+    while (!records_.empty() && !records_.front().key) records_.pop_front();
+
+    // A delta for a keyframe just evicted can't be stored either
+    if (!key && records_.empty()) {
+        frames_since_key_ = KEYFRAME_INTERVAL;
+        return;
+    }
+
+    std::memcpy(ring_.data() + pos, scratch_.data(), size);
+    records_.push_back({pos, size, key});
+    write_pos_ = pos + size;
+}
+
+bool NesRewind::decode(size_t index, NesEmulator::Fork& out) {
+    size_t key = index;
+    while (!records_[key].key) {
+        if (key == 0) return false;
+        --key;
+    }
+
+    // The keyframe against zeros, then the frame's own delta against it
+    flat_.assign(key_.size(), 0);
+    applyXor(ring_.data() + records_[key].offset, records_[key].size, flat_);
+    if (key != index) applyXor(ring_.data() + records_[index].offset, records_[index].size, flat_);
+    unflatten(flat_, out);
+    return true;
+}
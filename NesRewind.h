@@ -0,0 +1,75 @@
+#pragma once
+
+#include "NesEmulator.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Rewind history for NES emulator mode. Every emulated frame is forked into
+// one of a few pooled snapshots; a background thread XORs it against the
+// latest keyframe, run-length encodes the result and appends it to a byte
+// ring of fixed size. Keyframes (every KEYFRAME_INTERVAL frames) are stored
+// the same way against zeros, so any frame decodes from its keyframe and one
+// delta. When the ring is full the oldest keyframe goes with its deltas.
+class NesRewind {
+public:
+    static constexpr int KEYFRAME_INTERVAL = 60;
+    static constexpr int POOL_SIZE = 4;   // Frames waiting for the encoder; more are dropped
+    static constexpr size_t DEFAULT_BUDGET = size_t(64) << 20;
+
+    ~NesRewind() { stop(); }
+
+    // Drop any history and record into a ring of budget bytes
+    void start(size_t budget);
+    // Join the encoder and free the ring
+    void stop();
+    size_t budget() const;
+
+    // After each emulated frame of emu (emulation thread)
+    void capture(NesEmulator& emu);
+    // Put emu back one recorded frame and drop it from the history; false
+    // when there is nothing left (emulation thread)
+    bool stepBack(NesEmulator& emu);
+
+    // Frames stored, for the UI
+    int framesStored() const;
+    // The ring, the encoder's scratch and the snapshot pool
+    void reportMemory(MemoryReport::Sample& sample) const;
+
+private:
+    struct Record {
+        size_t offset;
+        size_t size;
+        bool key;
+    };
+
+    void encoderLoop();
+    void encode(const NesEmulator::Fork& fork);  // mutex_ held
+    void store(bool key);                        // Appends scratch_; mutex_ held
+    bool decode(size_t index, NesEmulator::Fork& out);  // mutex_ held
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::thread encoder_;
+    bool quit_ = false;
+
+    // Snapshot pool: the emulation thread forks into a free slot, the encoder drains pending_
+    NesEmulator::Fork pool_[POOL_SIZE];
+    std::vector<int> free_;
+    std::vector<int> pending_;
+
+    // Ring; everything below is guarded by mutex_
+    std::vector<uint8_t> ring_;
+    std::deque<Record> records_;  // Oldest first, always starting at a keyframe
+    size_t write_pos_ = 0;
+    int frames_since_key_ = KEYFRAME_INTERVAL;
+
+    std::vector<uint8_t> key_;      // Flattened keyframe the deltas are against
+    std::vector<uint8_t> flat_;     // Scratch: flattened frame
+    std::vector<uint8_t> scratch_;  // Scratch: encoded record
+    NesEmulator::Fork restore_;     // Frame being stepped back to (emulation thread)
+};
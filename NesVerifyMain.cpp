@@ -0,0 +1,214 @@
+// Determinism check for the NES core: runs a ROM with scripted input and
+// hashes each part of the machine after every frame (NesEmulator::hashState():
+// CPU, PPU, RAM, controllers, mapper, screen and APU), then reports the
+// first frame that differs from a reference run and the parts it differs in.
+// Performance work on agnes must leave every one of them alone.
+//
+//   nes_verify <rom.nes> [--input script] [--frames N] [--dot-ppu] [--no-catch-up]
+//              [--pipelined-ppu] [--record <hashes.txt> | --check <hashes.txt>]
+//
+// With neither --record nor --check the reference is a second emulator on
+// the slow, accurate path, dot-by-dot PPU kept in step with the CPU, run in
+// lockstep; --dot-ppu and --no-catch-up take the fast paths out of the run
+// under test too, and --pipelined-ppu draws its frames on a second core,
+// whose screen is checked against the reference's frame before. --record
+// writes this build's hashes, one line a frame, and --check compares with
+// those of another build. Hashes are of agnes_t's bytes, so builds compare
+// while its layout is the same. Exits 1 on a divergence.
+
+#include "InputScript.h"
+#include "NesEmulator.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Hashes = uint64_t[NesEmulator::HASH_PARTS];
+
+// As nes_bench's: past most menus without a script
+agnes_input_t defaultInput(int frame) {
+    agnes_input_t input = {};
+    input.start = frame % 120 < 5;
+    input.right = frame >= 600;
+    input.a = frame >= 600 && frame % 32 < 16;
+    return input;
+}
+
+std::unique_ptr<NesEmulator> makeEmulator(const char* rom_path, bool fast_ppu, bool catch_up_ppu,
+                                          bool pipelined_ppu) {
+    // On the heap: an emulator carries its frame buffers inline
+    auto emu = std::make_unique<NesEmulator>();
+    if (!emu->init(44100) || !emu->loadROM(rom_path)) return nullptr;
+    emu->setFastPpu(fast_ppu);
+    emu->setCatchUpPpu(catch_up_ppu);
+    emu->setPipelinedPpu(pipelined_ppu);
+    emu->resume();
+    return emu;
+}
+
+// samples: scratch to drain the audio into, as the device would; the APU's
+// state is in the hashes
+void runFrame(NesEmulator& emu, const InputScript* script, int frame, std::vector<short>& samples, Hashes out) {
+    emu.setInput(0, script ? script->at(frame, 0) : defaultInput(frame));
+    emu.setInput(1, script ? script->at(frame, 1) : agnes_input_t{});
+    emu.runFrame(true);
+    emu.hashState(out);
+    emu.readAudioSamples(samples.data(), static_cast<int>(samples.size()));
+}
+
+// "cpu ppu" for the parts a and b differ in; empty when none
+std::string differingParts(const Hashes a, const Hashes b) {
+    std::string parts;
+    for (int i = 0; i < NesEmulator::HASH_PARTS; ++i) {
+        if (a[i] == b[i]) continue;
+        if (!parts.empty()) parts += ' ';
+        parts += NesEmulator::hashPartName(i);
+    }
+    return parts;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const char* rom_path = nullptr;
+    const char* script_path = nullptr;
+    const char* record_path = nullptr;
+    const char* check_path = nullptr;
+    int frames = 3600;
+    bool fast_ppu = true;
+    bool catch_up_ppu = true;
+    bool pipelined_ppu = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            script_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+            check_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--dot-ppu") == 0) {
+            fast_ppu = false;
+        } else if (std::strcmp(argv[i], "--no-catch-up") == 0) {
+            catch_up_ppu = false;
+        } else if (std::strcmp(argv[i], "--pipelined-ppu") == 0) {
+            pipelined_ppu = true;
+        } else if (argv[i][0] != '-' && !rom_path) {
+            rom_path = argv[i];
+        } else {
+            rom_path = nullptr;
+            break;
+        }
+    }
+    // Hashes recorded a frame late would not check against anything
+    if (!rom_path || frames <= 0 || (record_path && check_path) || (record_path && pipelined_ppu)) {
+        std::fprintf(stderr,
+                     "usage: %s <rom.nes> [--input script] [--frames N] [--dot-ppu] [--no-catch-up]"
+                     " [--pipelined-ppu] [--record <hashes.txt> | --check <hashes.txt>]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    InputScript script;
+    std::string error;
+    if (script_path && !script.load(script_path, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const InputScript* input = script_path ? &script : nullptr;
+
+    std::unique_ptr<NesEmulator> emu = makeEmulator(rom_path, fast_ppu, catch_up_ppu, pipelined_ppu);
+    if (!emu) {
+        std::fprintf(stderr, "could not load %s\n", rom_path);
+        return 1;
+    }
+
+    // The reference: recorded hashes, or the accurate path alongside
+    std::unique_ptr<NesEmulator> accurate;
+    std::ifstream check;
+    FILE* record = nullptr;
+    if (check_path) {
+        check.open(check_path);
+        if (!check.is_open()) {
+            std::fprintf(stderr, "could not read %s\n", check_path);
+            return 1;
+        }
+    } else if (record_path) {
+        if (!(record = std::fopen(record_path, "w"))) {
+            std::fprintf(stderr, "could not write %s\n", record_path);
+            return 1;
+        }
+        std::fprintf(record, "# frame");
+        for (int i = 0; i < NesEmulator::HASH_PARTS; ++i) std::fprintf(record, " %s", NesEmulator::hashPartName(i));
+        std::fprintf(record, "\n");
+    } else {
+        accurate = makeEmulator(rom_path, false, false, false);
+        if (!accurate) {
+            std::fprintf(stderr, "could not load %s\n", rom_path);
+            return 1;
+        }
+    }
+
+    // The reference's screen a frame back, at first the one from power-on
+    Hashes power_on;
+    emu->hashState(power_on);
+    uint64_t reference_screen = power_on[AGNES_HASH_SCREEN];
+
+    std::vector<short> samples(44100 / 10);
+    for (int f = 0; f < frames; ++f) {
+        Hashes hashes;
+        runFrame(*emu, input, f, samples, hashes);
+        if (record) {
+            std::fprintf(record, "%d", f);
+            for (uint64_t hash : hashes) std::fprintf(record, " %016" PRIx64, hash);
+            std::fprintf(record, "\n");
+            continue;
+        }
+
+        Hashes reference;
+        if (accurate) {
+            runFrame(*accurate, input, f, samples, reference);
+        } else {
+            std::string line;
+            while (std::getline(check, line) && (line.empty() || line[0] == '#')) {}
+            std::istringstream words(line);
+            int frame = -1;
+            bool read = static_cast<bool>(words >> frame) && frame == f;
+            for (int i = 0; read && i < NesEmulator::HASH_PARTS; ++i) {
+                std::string hex;
+                read = static_cast<bool>(words >> hex);
+                if (read) reference[i] = std::strtoull(hex.c_str(), nullptr, 16);
+            }
+            if (!read) {
+                std::printf("%s has no hashes for frame %d; the %d before match\n", check_path, f, f);
+                return 1;
+            }
+        }
+        // A frame drawn on the second core shows the picture of the one before
+        const uint64_t screen = reference[AGNES_HASH_SCREEN];
+        if (emu->ppuPipelineActive()) reference[AGNES_HASH_SCREEN] = reference_screen;
+        reference_screen = screen;
+
+        const std::string parts = differingParts(hashes, reference);
+        if (!parts.empty()) {
+            std::printf("frame %d: %s differ%s from %s\n", f, parts.c_str(),
+                        parts.find(' ') == std::string::npos ? "s" : "", accurate ? "the accurate path" : check_path);
+            std::printf("the %d frames before match\n", f);
+            return 1;
+        }
+    }
+    if (record) {
+        std::fclose(record);
+        std::printf("%d frames of hashes written to %s\n", frames, record_path);
+    } else {
+        std::printf("%d frames match %s\n", frames, accurate ? "the accurate path" : check_path);
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "NoteCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr char MAGIC[4] = {'F', 'C', 'N', 'C'};
+
+// Host byte order: the cache never leaves the machine that wrote it
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t file_hash;
+    int64_t duration;  // NoteClock ticks
+    int32_t track;
+    int32_t sample_rate;
+    uint32_t note_count;
+    uint32_t reserved;  // 0
+};
+static_assert(sizeof(Header) == 40, "Header is written as is");
+
+// channel u8, midi_note u8, velocity u16 (1/65535 steps), start and end
+// i64 NoteClock ticks
+constexpr size_t NOTE_BYTES = 20;
+// Then PreprocessedTrack::activity whole, or nothing for a track without it
+constexpr size_t ACTIVITY_BYTES = size_t(PreprocessedTrack::ACTIVITY_COLUMNS) * ChannelTable::MAX_CHANNELS;
+
+std::filesystem::path cachePath(const std::string& dir, uint64_t file_hash, int track, long sample_rate) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%d-%ld.notes",
+                  static_cast<unsigned long long>(file_hash), track, sample_rate);
+    return std::filesystem::path(dir) / name;
+}
+
+}  // namespace
+
+std::string NoteCache::defaultDirectory() {
+    std::filesystem::path base;
+#if defined(_WIN32)
+    if (const char* local = std::getenv("LOCALAPPDATA")) base = local;
+#elif defined(__APPLE__)
+    if (const char* home = std::getenv("HOME")) base = std::filesystem::path(home) / "Library" / "Caches";
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && xdg[0]) {
+        base = xdg;
+    } else if (const char* home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / ".cache";
+    }
+#endif
+    if (base.empty()) return std::string();
+    return (base / "imgui_fc_visualizer" / "notes").string();
+}
+
+uint64_t NoteCache::hashData(const unsigned char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool NoteCache::load(const std::string& dir, uint64_t file_hash, int track, long sample_rate,
+                     PreprocessedTrack& out) {
+    if (dir.empty()) return false;
+    std::ifstream file(cachePath(dir, file_hash, track, sample_rate), std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+
+    // The whole file in one read, then checked against its header
+    const std::streamoff size = file.tellg();
+    if (size < static_cast<std::streamoff>(sizeof(Header))) return false;
+    std::vector<unsigned char> data(static_cast<size_t>(size));
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char*>(data.data()), size)) return false;
+
+    Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) return false;
+    if (header.file_hash != file_hash || header.track != track || header.sample_rate != sample_rate) return false;
+    const size_t notes_end = sizeof(Header) + size_t(header.note_count) * NOTE_BYTES;
+    if (data.size() != notes_end && data.size() != notes_end + ACTIVITY_BYTES) return false;
+
+    out.notes.resize(header.note_count);
+    out.duration = header.duration;
+    const unsigned char* p = data.data() + sizeof(Header);
+    for (PianoRollNote& note : out.notes) {
+        uint16_t velocity;
+        std::memcpy(&velocity, p + 2, sizeof(velocity));
+        note.channel = p[0];
+        note.midi_note = p[1];
+        note.velocity = velocity / 65535.0f;
+        std::memcpy(&note.start, p + 4, sizeof(int64_t));
+        std::memcpy(&note.end, p + 12, sizeof(int64_t));
+        p += NOTE_BYTES;
+    }
+    out.activity.assign(p, p + (data.size() - notes_end));
+    return true;
+}
+
+bool NoteCache::store(const std::string& dir, uint64_t file_hash, int track, long sample_rate,
+                      const PreprocessedTrack& notes) {
+    if (dir.empty()) return false;
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) return false;
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.file_hash = file_hash;
+    header.track = track;
+    header.sample_rate = static_cast<int32_t>(sample_rate);
+    header.duration = notes.duration;
+    header.note_count = static_cast<uint32_t>(notes.notes.size());
+    header.reserved = 0;
+
+    const bool activity = notes.activity.size() == ACTIVITY_BYTES;
+    std::vector<unsigned char> data(sizeof(Header) + notes.notes.size() * NOTE_BYTES + (activity ? ACTIVITY_BYTES : 0));
+    std::memcpy(data.data(), &header, sizeof(header));
+    unsigned char* p = data.data() + sizeof(Header);
+    for (const PianoRollNote& note : notes.notes) {
+        const uint16_t velocity = static_cast<uint16_t>(std::lround(std::clamp(note.velocity, 0.0f, 1.0f) * 65535.0f));
+        p[0] = static_cast<unsigned char>(note.channel);
+        p[1] = static_cast<unsigned char>(note.midi_note);
+        std::memcpy(p + 2, &velocity, sizeof(velocity));
+        std::memcpy(p + 4, &note.start, sizeof(int64_t));
+        std::memcpy(p + 12, &note.end, sizeof(int64_t));
+        p += NOTE_BYTES;
+    }
+    if (activity) std::copy(notes.activity.begin(), notes.activity.end(), p);
+
+    // Written aside and renamed over, so a reader never sees half a file
+    const std::filesystem::path path = cachePath(dir, file_hash, track, sample_rate);
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()))) {
+            return false;
+        }
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
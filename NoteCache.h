@@ -0,0 +1,30 @@
+#pragma once
+
+#include "PianoVisualizer.h"
+#include <cstdint>
+#include <string>
+
+// On-disk cache of preprocessed piano notes, one small file per track, keyed
+// by a hash of the music file's contents, the track and the sample rate.
+// Files carry a format version; any other version reads as a miss and is
+// overwritten by the next store.
+class NoteCache {
+public:
+    // Bump when the file layout or the note detection changes
+    // 2: the activity overview after the notes; 3: NoteClock ticks for times
+    static constexpr uint32_t VERSION = 3;
+
+    // Per-user cache directory for the platform, empty if there is none
+    static std::string defaultDirectory();
+
+    // 64-bit FNV-1a of a file's contents
+    static uint64_t hashData(const unsigned char* data, size_t size);
+
+    // Read a track's notes; false on a miss, a version mismatch or a damaged file
+    static bool load(const std::string& dir, uint64_t file_hash, int track, long sample_rate,
+                     PreprocessedTrack& out);
+
+    // Write a track's notes, creating dir if needed; false if it could not be written
+    static bool store(const std::string& dir, uint64_t file_hash, int track, long sample_rate,
+                      const PreprocessedTrack& notes);
+};
@@ -0,0 +1,212 @@
+#include "NsfAnalyzer.h"
+#include "ChannelProbe.h"
+#include "PianoVisualizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+namespace {
+
+struct Job {
+    size_t file;
+    int track;
+};
+
+NsfAnalyzer::TrackStats analyzeTrack(const MusicFile& file, int track, const NsfAnalyzer::Options& options) {
+    NsfAnalyzer::TrackStats stats;
+    const auto start = std::chrono::steady_clock::now();
+
+    Music_Emu* emu = nullptr;
+    if (open_music_emu(file, &emu, options.sample_rate) != nullptr || !emu) return stats;
+    const ChannelProbe probe = ChannelProbe::resolve(emu);
+    const ChannelTable layout = ChannelTable::forProbe(probe);
+
+    track_info_t info;
+    if (gme_track_info(emu, &info, track) == nullptr) {
+        stats.song = info.song;
+        stats.length_ms = info.length;
+    }
+
+    const long max_ms = static_cast<long>(options.max_seconds * 1000.0);
+    PianoVisualizer piano;
+    stats.ok = piano.preprocessTrack(
+        emu, track, options.sample_rate, layout,
+        [&probe](Music_Emu*, ChannelTable& table) {
+            table.sample(probe);
+        },
+        probe.playInterval(), nullptr,
+        [max_ms](Music_Emu* emu) {
+            return max_ms <= 0 || gme_tell(emu) < max_ms;
+        });
+    if (probe.nsf) {
+        const Nsf_Emu::play_cost_t& cost = probe.nsf->play_cost();
+        stats.play_peak_cycles = cost.peak;
+        stats.play_mean_cycles = cost.calls ? cost.total / cost.calls : 0.0;
+        stats.play_peak_load = static_cast<double>(cost.peak) / std::max(probe.nsf->play_period_clocks(), 1L);
+    }
+    gme_delete(emu);
+
+    const PreprocessedTrack notes = piano.takePreprocessedData();
+    stats.duration = NoteClock::toSeconds(notes.duration);
+    stats.notes = static_cast<int>(notes.notes.size());
+    stats.channels.resize(static_cast<size_t>(layout.count));
+    for (int c = 0; c < layout.count; ++c) {
+        stats.channels[c].name = layout.name[c];
+    }
+    for (const PianoRollNote& note : notes.notes) {
+        if (note.channel < 0 || note.channel >= layout.count) continue;
+        NsfAnalyzer::ChannelStats& channel = stats.channels[note.channel];
+        ++channel.notes;
+        channel.sounding_seconds += NoteClock::toSeconds(note.end - note.start);
+        if (channel.lowest_note < 0 || note.midi_note < channel.lowest_note) channel.lowest_note = note.midi_note;
+        channel.highest_note = std::max(channel.highest_note, note.midi_note);
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+// JSON and CSV strings, quotes included; control characters become spaces
+std::string quoted(const std::string& text, bool csv) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (static_cast<unsigned char>(c) < 0x20) c = ' ';
+        if (csv && c == '"') out += '"';
+        if (!csv && (c == '"' || c == '\\')) out += '\\';
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+std::string json(const std::string& text) {
+    return quoted(text, false);
+}
+
+std::string csv(const std::string& text) {
+    return quoted(text, true);
+}
+
+}  // namespace
+
+std::vector<NsfAnalyzer::FileStats> NsfAnalyzer::run(const std::vector<std::string>& paths, const Options& options,
+                                                     const std::function<void()>& done) {
+    // Open every file once for its track list; the tracks become the jobs
+    std::vector<FileStats> files(paths.size());
+    std::vector<std::shared_ptr<const MusicFile>> images(paths.size());
+    std::vector<Job> jobs;
+    for (size_t f = 0; f < paths.size(); ++f) {
+        FileStats& stats = files[f];
+        stats.path = paths[f];
+        gme_err_t err = nullptr;
+        images[f] = MusicFile::read(paths[f].c_str(), &err);
+        Music_Emu* emu = nullptr;
+        if (images[f]) err = open_music_emu(*images[f], &emu, options.sample_rate);
+        if (err || !emu) {
+            stats.error = err ? err : "could not read the file";
+            images[f].reset();
+            continue;
+        }
+
+        track_info_t info;
+        if (gme_track_info(emu, &info, 0) == nullptr) {
+            stats.system = info.system;
+            stats.game = info.game;
+            stats.author = info.author;
+            stats.copyright = info.copyright;
+        }
+        stats.tracks.resize(static_cast<size_t>(std::max(gme_track_count(emu), 0)));
+        for (int track = 0; track < static_cast<int>(stats.tracks.size()); ++track) jobs.push_back({f, track});
+        stats.ok = true;
+        gme_delete(emu);
+    }
+
+    int threads = options.threads;
+    if (threads <= 0) threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = static_cast<int>(std::min<size_t>(static_cast<size_t>(threads), std::max<size_t>(jobs.size(), 1)));
+
+    // Each worker takes the next track not yet taken; results go to their own slots
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1)) {
+            const Job& job = jobs[i];
+            files[job.file].tracks[job.track] = analyzeTrack(*images[job.file], job.track, options);
+            if (done) done();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers) worker.join();
+    return files;
+}
+
+std::vector<std::string> NsfAnalyzer::findFiles(const std::string& dir) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        std::string ext = it->path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (ext == ".nsf" || ext == ".nsfe") paths.push_back(it->path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+void NsfAnalyzer::writeJson(FILE* out, const std::vector<FileStats>& files) {
+    std::fprintf(out, "[\n");
+    for (size_t f = 0; f < files.size(); ++f) {
+        const FileStats& file = files[f];
+        std::fprintf(out, "  {\"path\": %s, \"ok\": %s", json(file.path).c_str(), file.ok ? "true" : "false");
+        if (!file.ok) {
+            std::fprintf(out, ", \"error\": %s}%s\n", json(file.error).c_str(), f + 1 < files.size() ? "," : "");
+            continue;
+        }
+        std::fprintf(out, ", \"system\": %s, \"game\": %s, \"author\": %s, \"copyright\": %s,\n   \"tracks\": [\n",
+                     json(file.system).c_str(), json(file.game).c_str(), json(file.author).c_str(),
+                     json(file.copyright).c_str());
+        for (size_t t = 0; t < file.tracks.size(); ++t) {
+            const TrackStats& track = file.tracks[t];
+            std::fprintf(out,
+                         "    {\"track\": %zu, \"ok\": %s, \"song\": %s, \"length_ms\": %ld, \"duration\": %.3f, "
+                         "\"notes\": %d, \"seconds\": %.3f, \"play_peak_cycles\": %ld, "
+                         "\"play_mean_cycles\": %.1f, \"play_peak_load\": %.4f, \"channels\": [",
+                         t + 1, track.ok ? "true" : "false", json(track.song).c_str(), track.length_ms,
+                         track.duration, track.notes, track.seconds, track.play_peak_cycles, track.play_mean_cycles,
+                         track.play_peak_load);
+            for (size_t c = 0; c < track.channels.size(); ++c) {
+                const ChannelStats& channel = track.channels[c];
+                std::fprintf(out,
+                             "%s\n      {\"name\": %s, \"notes\": %d, \"sounding\": %.3f, \"lowest\": %d, "
+                             "\"highest\": %d}",
+                             c ? "," : "", json(channel.name).c_str(), channel.notes, channel.sounding_seconds,
+                             channel.lowest_note, channel.highest_note);
+            }
+            std::fprintf(out, "]}%s\n", t + 1 < file.tracks.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]}%s\n", f + 1 < files.size() ? "," : "");
+    }
+    std::fprintf(out, "]\n");
+}
+
+void NsfAnalyzer::writeCsv(FILE* out, const std::vector<FileStats>& files) {
+    std::fprintf(out, "path,game,track,song,length_ms,duration,track_notes,channel,notes,sounding,lowest,highest,"
+                      "play_peak_cycles,play_peak_load\n");
+    for (const FileStats& file : files) {
+        for (size_t t = 0; t < file.tracks.size(); ++t) {
+            const TrackStats& track = file.tracks[t];
+            if (!track.ok) continue;
+            for (const ChannelStats& channel : track.channels) {
+                std::fprintf(out, "%s,%s,%zu,%s,%ld,%.3f,%d,%s,%d,%.3f,%d,%d,%ld,%.4f\n", csv(file.path).c_str(),
+                             csv(file.game).c_str(), t + 1, csv(track.song).c_str(), track.length_ms, track.duration,
+                             track.notes, csv(channel.name).c_str(), channel.notes, channel.sounding_seconds,
+                             channel.lowest_note, channel.highest_note, track.play_peak_cycles, track.play_peak_load);
+            }
+        }
+    }
+}
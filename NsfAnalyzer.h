@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Headless note analysis of many music files at once, for build servers and
+// library statistics. Every track goes through the piano's preprocessing
+// pass (PianoVisualizer::preprocessTrack with NES_HEADLESS: the note engine
+// without sokol or ImGui), spread over a pool of worker threads as in
+// NesFarm, one Music_Emu per track opened from the file's shared bytes.
+class NsfAnalyzer {
+public:
+    struct ChannelStats {
+        std::string name;
+        int notes = 0;
+        double sounding_seconds = 0.0;  // Sum of its note lengths
+        int lowest_note = -1;           // MIDI notes, -1 without notes
+        int highest_note = -1;
+    };
+
+    struct TrackStats {
+        bool ok = false;
+        std::string song;
+        long length_ms = -1;    // From track_info(), -1 if unknown
+        double duration = 0.0;  // Seconds the pass covered
+        int notes = 0;
+        std::vector<ChannelStats> channels;  // Every channel the file can sound
+        double seconds = 0.0;   // Wall time
+        // NSF play routine CPU clocks, worst and mean call, and the worst
+        // over the clocks between calls (above 1 it overran its frame)
+        long play_peak_cycles = 0;
+        double play_mean_cycles = 0.0;
+        double play_peak_load = 0.0;
+    };
+
+    struct FileStats {
+        std::string path;
+        bool ok = false;
+        std::string error;
+        std::string system, game, author, copyright;
+        std::vector<TrackStats> tracks;
+    };
+
+    struct Options {
+        long sample_rate = 44100;
+        double max_seconds = 0.0;  // Stop each pass there if above 0; else the piano's limits
+        int threads = 0;           // 0: one per hardware thread
+    };
+
+    // Files are opened in order on the calling thread, then their tracks
+    // are analysed in parallel. Results are in paths order; done, if set,
+    // is called after each track from its worker thread.
+    static std::vector<FileStats> run(const std::vector<std::string>& paths, const Options& options,
+                                      const std::function<void()>& done = {});
+
+    // The .nsf and .nsfe files under dir, sorted
+    static std::vector<std::string> findFiles(const std::string& dir);
+
+    static void writeJson(FILE* out, const std::vector<FileStats>& files);
+    // One row per channel of each track
+    static void writeCsv(FILE* out, const std::vector<FileStats>& files);
+};
@@ -0,0 +1,203 @@
+#include "NsfExport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+namespace {
+
+constexpr int RENDER_FRAMES = 8192;       // Frames per gme_play call
+constexpr size_t FILE_BUFFER = 1 << 20;   // stdio buffer per output file
+constexpr long WAV_HEADER_SIZE = 44;
+
+void put16(unsigned char* out, uint32_t value) {
+    out[0] = static_cast<unsigned char>(value);
+    out[1] = static_cast<unsigned char>(value >> 8);
+}
+
+void put32(unsigned char* out, uint32_t value) {
+    put16(out, value & 0xFFFF);
+    put16(out + 2, value >> 16);
+}
+
+// 16-bit stereo PCM header for frames frames
+void wavHeader(unsigned char* out, long rate, long frames) {
+    const uint32_t data_size = static_cast<uint32_t>(frames * 4);
+    std::copy_n("RIFF", 4, out);
+    put32(out + 4, 36 + data_size);
+    std::copy_n("WAVEfmt ", 8, out + 8);
+    put32(out + 16, 16);
+    put16(out + 20, 1);  // PCM
+    put16(out + 22, 2);  // Channels
+    put32(out + 24, static_cast<uint32_t>(rate));
+    put32(out + 28, static_cast<uint32_t>(rate * 4));
+    put16(out + 32, 4);
+    put16(out + 34, 16);
+    std::copy_n("data", 4, out + 36);
+    put32(out + 40, data_size);
+}
+
+struct EmuDeleter {
+    void operator()(Music_Emu* emu) const { gme_delete(emu); }
+};
+using EmuPtr = std::unique_ptr<Music_Emu, EmuDeleter>;
+
+gme_err_t openEmu(const MusicFile& file, const NsfExport::Options& options, EmuPtr* out) {
+    Music_Emu* emu = nullptr;
+    gme_err_t err = open_music_emu(file, &emu, options.sample_rate);
+    out->reset(emu);
+    if (!err && !options.m3u.empty()) err = gme_load_m3u(emu, options.m3u.c_str());
+    return err;
+}
+
+}  // namespace
+
+long NsfExport::playLength(const track_info_t& info, const Options& options) {
+    if (info.length > 0) return info.length;
+    if (info.loop_length > 0) return std::max(info.intro_length, 0L) + info.loop_length * 2;
+    return options.default_length_ms;
+}
+
+NsfExport::Result NsfExport::renderTrack(const MusicFile& file, int track, const std::string& path,
+                                         const Options& options, const std::atomic<bool>* cancel) {
+    Result result;
+    result.path = path;
+    const auto start = std::chrono::steady_clock::now();
+    if (cancel && cancel->load()) {
+        result.error = "cancelled";
+        return result;
+    }
+
+    EmuPtr emu;
+    track_info_t info;
+    gme_err_t err = openEmu(file, options, &emu);
+    if (!err) err = gme_track_info(emu.get(), &info, track);
+    if (!err) err = gme_start_track(emu.get(), track);
+    if (err) {
+        result.error = err;
+        return result;
+    }
+    const long length = playLength(info, options);
+    emu->set_fade(length, options.fade_ms);
+
+    FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        result.error = "could not write " + path;
+        return result;
+    }
+    std::setvbuf(out, nullptr, _IOFBF, FILE_BUFFER);
+
+    // The header's sizes are filled in once the track has ended
+    unsigned char header[WAV_HEADER_SIZE];
+    wavHeader(header, options.sample_rate, 0);
+    bool written = std::fwrite(header, sizeof(header), 1, out) == 1;
+
+    // Past the fade with a second to spare, in case it never reaches silence
+    const long max_frames = (length + options.fade_ms + 1000) / 1000 * options.sample_rate;
+    std::vector<short> pcm(RENDER_FRAMES * 2);
+    while (written && !gme_track_ended(emu.get()) && result.frames < max_frames) {
+        if (cancel && cancel->load()) {
+            err = "cancelled";
+            break;
+        }
+        err = gme_play(emu.get(), static_cast<int>(pcm.size()), pcm.data());
+        if (err) break;
+        written = std::fwrite(pcm.data(), sizeof(short), pcm.size(), out) == pcm.size();
+        result.frames += RENDER_FRAMES;
+    }
+
+    wavHeader(header, options.sample_rate, result.frames);
+    written = written && std::fseek(out, 0, SEEK_SET) == 0 && std::fwrite(header, sizeof(header), 1, out) == 1;
+    written = std::fclose(out) == 0 && written;
+    if (err || !written) {
+        result.error = err ? err : "could not write " + path;
+        std::remove(path.c_str());
+        return result;
+    }
+
+    result.ok = true;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+std::vector<NsfExport::Result> NsfExport::run(const std::shared_ptr<const MusicFile>& file, std::vector<int> tracks,
+                                              const std::string& out_dir, const std::string& stem,
+                                              const Options& options, const std::function<void(size_t)>& done,
+                                              const std::atomic<bool>* cancel) {
+    if (tracks.empty()) {
+        EmuPtr emu;
+        if (openEmu(*file, options, &emu) == nullptr) {
+            for (int track = 0; track < gme_track_count(emu.get()); ++track) tracks.push_back(track);
+        }
+    }
+
+    std::vector<Result> results(tracks.size());
+    int threads = options.threads;
+    if (threads <= 0 && options.pool) threads = options.pool->threadCount();
+    if (threads <= 0) threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = static_cast<int>(std::min<size_t>(static_cast<size_t>(threads), std::max<size_t>(tracks.size(), 1)));
+
+    // Each worker takes the next track not yet taken; results go to their own slots
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next.fetch_add(1); i < tracks.size(); i = next.fetch_add(1)) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "-%02d.wav", tracks[i] + 1);
+            const std::string path = (std::filesystem::path(out_dir) / (stem + name)).string();
+            results[i] = renderTrack(*file, tracks[i], path, options, cancel);
+            if (done) done(i);
+        }
+    };
+    if (options.pool) {
+        options.pool->parallel(JobPool::Priority::Normal, threads, work);
+        return results;
+    }
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers) worker.join();
+    return results;
+}
+
+NsfExport::~NsfExport() {
+    cancel();
+}
+
+void NsfExport::start(std::shared_ptr<const MusicFile> file, const std::string& out_dir, const std::string& stem,
+                      const Options& options) {
+    cancel();
+    if (!file) return;
+
+    // The track count comes in once the job has opened the file
+    cancel_.store(false);
+    track_count_.store(0);
+    failed_.store(0);
+    written_.store(0);
+    Options pooled = options;
+    pooled.pool = &JobPool::shared();
+    pooled.pool->submit(job_, JobPool::Priority::Normal, [this, file = std::move(file), out_dir, stem,
+                                                          options = pooled]() {
+        std::vector<int> tracks;
+        {
+            EmuPtr emu;
+            if (openEmu(*file, options, &emu) == nullptr) {
+                for (int track = 0; track < gme_track_count(emu.get()); ++track) tracks.push_back(track);
+            }
+        }
+        track_count_.store(static_cast<int>(tracks.size()));
+        if (tracks.empty()) return;
+
+        const std::vector<Result> results =
+            run(file, tracks, out_dir, stem, options, [this](size_t) { written_.fetch_add(1); }, &cancel_);
+        for (const Result& result : results) {
+            if (!result.ok) failed_.fetch_add(1);
+        }
+    });
+}
+
+void NsfExport::cancel() {
+    cancel_.store(true);
+    JobPool::shared().cancel(job_);
+    JobPool::shared().wait(job_);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ChannelTaps.h"
+#include "JobPool.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Offline rendering of a music file's tracks to WAV, every track as fast as
+// the emulator runs. Each worker opens its own Music_Emu from the shared
+// MusicFile bytes and takes the next track not yet taken, as in NesFarm.
+// A track plays for its length from track_info() (an .m3u playlist's when
+// one is given), or intro + two loops, or default_length_ms, then fades out.
+// Tracks that go silent end early, as when playing.
+class NsfExport {
+public:
+    struct Options {
+        long sample_rate = 44100;
+        long default_length_ms = 150000;  // Tracks with no length or loop information
+        long fade_ms = 8000;
+        std::string m3u;                  // Playlist loaded over the file's own track list
+        int threads = 0;                  // 0: one per hardware thread (or pool worker)
+        JobPool* pool = nullptr;          // Run on its workers instead of threads of our own
+    };
+
+    struct Result {
+        bool ok = false;
+        std::string path;
+        std::string error;
+        long frames = 0;      // Stereo frames written
+        double seconds = 0.0; // Wall time
+    };
+
+    // Render tracks (all of them when empty) to out_dir/<stem>-NN.wav, NN
+    // counting from 01. Results are in track list order; done, if set, is
+    // called with each index as it finishes, from its worker thread. Tracks
+    // not started when cancel is raised fail with "cancelled".
+    static std::vector<Result> run(const std::shared_ptr<const MusicFile>& file, std::vector<int> tracks,
+                                   const std::string& out_dir, const std::string& stem, const Options& options,
+                                   const std::function<void(size_t)>& done = {},
+                                   const std::atomic<bool>* cancel = nullptr);
+    // One track on the calling thread
+    static Result renderTrack(const MusicFile& file, int track, const std::string& path, const Options& options,
+                              const std::atomic<bool>* cancel = nullptr);
+    // How long track plays before its fade, in milliseconds
+    static long playLength(const track_info_t& info, const Options& options);
+
+    // Background export for the UI: run() as a job on the shared JobPool,
+    // its tracks spread over the pool. A second start() cancels and waits
+    // for the first.
+    NsfExport() = default;
+    ~NsfExport();
+    NsfExport(const NsfExport&) = delete;
+    NsfExport& operator=(const NsfExport&) = delete;
+
+    void start(std::shared_ptr<const MusicFile> file, const std::string& out_dir, const std::string& stem,
+               const Options& options);
+    void cancel();
+    // Tracks finished, written or not, since the last start(); -1 when none
+    // was asked for. trackCount() is 0 until the file has been opened.
+    int tracksWritten() const { return written_.load(); }
+    int trackCount() const { return track_count_.load(); }
+    // Set once the export is over
+    int tracksFailed() const { return failed_.load(); }
+
+private:
+    JobPool::Group job_;
+    std::atomic<bool> cancel_{false};
+    std::atomic<int> written_{-1};
+    std::atomic<int> track_count_{0};
+    std::atomic<int> failed_{0};
+};
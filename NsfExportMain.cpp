@@ -0,0 +1,115 @@
+// Renders the tracks of a music file (NSF, NSFE or any other type gme
+// plays) to WAV files, several tracks at once, for preparing audio outside
+// the player.
+//
+//   nsf_export <file> [--tracks 1,3-5] [--out-dir DIR] [--m3u FILE] [--threads N]
+//              [--rate HZ] [--length SEC] [--fade SEC]
+//
+// Track numbers count from 1, as in the output names: track 3 of song.nsf is
+// written to DIR/song-03.wav. --length is the play time of tracks with no
+// length or loop information; --fade is how long every track fades out.
+
+#include "NsfExport.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// "1,3-5" -> 0, 2, 3, 4
+bool parseTracks(const char* list, std::vector<int>* tracks) {
+    std::istringstream items(list);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        char* end = nullptr;
+        const long first = std::strtol(item.c_str(), &end, 10);
+        long last = first;
+        if (*end == '-') last = std::strtol(end + 1, &end, 10);
+        if (*end || first < 1 || last < first) {
+            std::fprintf(stderr, "bad track range '%s'\n", item.c_str());
+            return false;
+        }
+        for (long track = first; track <= last; ++track) tracks->push_back(static_cast<int>(track - 1));
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const char* path = nullptr;
+    const char* out_dir = ".";
+    std::vector<int> tracks;
+    NsfExport::Options options;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; ++i) {
+        if (std::strcmp(argv[i], "--tracks") == 0 && i + 1 < argc) {
+            usage = !parseTracks(argv[++i], &tracks);
+        } else if (std::strcmp(argv[i], "--out-dir") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--m3u") == 0 && i + 1 < argc) {
+            options.m3u = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            options.sample_rate = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--length") == 0 && i + 1 < argc) {
+            options.default_length_ms = static_cast<long>(std::atof(argv[++i]) * 1000);
+        } else if (std::strcmp(argv[i], "--fade") == 0 && i + 1 < argc) {
+            options.fade_ms = static_cast<long>(std::atof(argv[++i]) * 1000);
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || !path || options.threads < 0 || options.sample_rate <= 0 || options.default_length_ms <= 0 ||
+        options.fade_ms < 0) {
+        std::fprintf(stderr,
+                     "usage: %s <file> [--tracks 1,3-5] [--out-dir DIR] [--m3u FILE] [--threads N]\n"
+                     "       [--rate HZ] [--length SEC] [--fade SEC]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    gme_err_t err = nullptr;
+    std::shared_ptr<const MusicFile> file = MusicFile::read(path, &err);
+    if (!file) {
+        std::fprintf(stderr, "could not read %s: %s\n", path, err ? err : "unknown error");
+        return 1;
+    }
+    const std::string stem = std::filesystem::path(path).stem().string();
+
+    // Progress on stderr as tracks finish; the summary below is in track order
+    std::mutex progress_mutex;
+    size_t finished = 0;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<NsfExport::Result> results = NsfExport::run(file, tracks, out_dir, stem, options, [&](size_t) {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        std::fprintf(stderr, "\r%zu tracks", ++finished);
+    });
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!results.empty()) std::fprintf(stderr, "\n");
+
+    int failed = 0;
+    double audio_seconds = 0.0;
+    for (const NsfExport::Result& result : results) {
+        if (!result.ok) {
+            std::printf("%s  FAILED: %s\n", result.path.c_str(), result.error.c_str());
+            ++failed;
+            continue;
+        }
+        const double length = static_cast<double>(result.frames) / options.sample_rate;
+        std::printf("%s  %.1f s audio  %.3f s\n", result.path.c_str(), length, result.seconds);
+        audio_seconds += length;
+    }
+    std::printf("%zu tracks, %.1f s of audio in %.3f s: %.1fx realtime\n", results.size(), audio_seconds, seconds,
+                seconds > 0.0 ? audio_seconds / seconds : 0.0);
+    return failed || results.empty() ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+#include "NsfMetadata.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t NSF_GAME_AT = 0x0E;  // Then author and copyright, 32 bytes each
+constexpr size_t NSF_FIELD_SIZE = 32;
+constexpr size_t NSF_TRACK_COUNT_AT = 6;
+constexpr size_t NSFE_INFO_MIN = 8;       // Addresses and flags; the track count may be left off
+constexpr size_t NSFE_INFO_TRACK_COUNT_AT = 8;
+constexpr size_t NSFE_BANKS_MAX = 8;
+constexpr size_t FIELD_MAX = 255;  // track_info_t's, less its NUL
+
+uint32_t le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+           static_cast<uint32_t>(p[3]) << 24;
+}
+
+// As Gme_File::copy_field_: up to size bytes or a NUL, blanks and control
+// characters trimmed from both ends, and the "?" placeholders left empty
+std::string field(const uint8_t* in, size_t size) {
+    while (size && in[0] >= 1 && in[0] <= ' ') {
+        ++in;
+        --size;
+    }
+    size_t length = 0;
+    while (length < size && in[length]) ++length;
+    while (length && in[length - 1] <= ' ') --length;
+    std::string text(reinterpret_cast<const char*>(in), length);
+    if (text == "?" || text == "<?>" || text == "< ? >") text.clear();
+    return text;
+}
+
+// A chunk of NUL-separated strings, split as gme's read_strs splits it: a
+// final NUL ends the last string rather than starting an empty one
+std::vector<const uint8_t*> strings(const uint8_t* data, size_t size) {
+    std::vector<const uint8_t*> out;
+    for (size_t i = 0; i < size; ++i) {
+        out.push_back(data + i);
+        while (i < size && data[i]) ++i;
+    }
+    return out;
+}
+
+bool isTag(const uint8_t* p, const char* tag) {
+    return std::memcmp(p, tag, 4) == 0;
+}
+
+}  // namespace
+
+bool NsfMetadata::read(const uint8_t* data, size_t size, NsfMetadata* out) {
+    *out = NsfMetadata();
+    if (size >= 5 && std::memcmp(data, "NESM\x1A", 5) == 0) return readNsf(data, size, out);
+    if (size >= 4 && std::memcmp(data, "NSFE", 4) == 0) return readNsfe(data, size, out);
+    return false;
+}
+
+bool NsfMetadata::readNsf(const uint8_t* data, size_t size, NsfMetadata* out) {
+    if (size < NSF_HEADER_SIZE) return false;
+    out->game = field(data + NSF_GAME_AT, NSF_FIELD_SIZE);
+    out->author = field(data + NSF_GAME_AT + NSF_FIELD_SIZE, NSF_FIELD_SIZE);
+    out->copyright = field(data + NSF_GAME_AT + 2 * NSF_FIELD_SIZE, NSF_FIELD_SIZE);
+    // An NSF has neither names nor lengths for its tracks; gme counts none as one
+    out->tracks.resize(std::max<size_t>(data[NSF_TRACK_COUNT_AT], 1));
+    return true;
+}
+
+bool NsfMetadata::readNsfe(const uint8_t* data, size_t size, NsfMetadata* out) {
+    out->nsfe = true;
+    size_t track_count = 1;
+    const uint8_t* playlist = nullptr;
+    size_t playlist_size = 0;
+    std::vector<const uint8_t*> names;
+    const uint8_t* names_end = nullptr;
+    const uint8_t* times = nullptr;
+    size_t time_count = 0;
+
+    // Chunks of a u32 size and a tag, to NEND; one running past the end of
+    // the file fails the load in gme, so it fails here too
+    for (size_t at = 4;;) {
+        if (size - at < 8) return false;
+        const size_t chunk_size = le32(data + at);
+        const uint8_t* tag = data + at + 4;
+        const uint8_t* chunk = data + at + 8;
+        at += 8;
+        if (isTag(tag, "NEND")) break;
+        if (chunk_size > size - at) return false;
+        // gme reads a time chunk's whole entries and no further, so a stray
+        // byte or three after them is taken as the next chunk's start
+        at += isTag(tag, "time") ? chunk_size / 4 * 4 : chunk_size;
+
+        if (isTag(tag, "INFO")) {
+            if (chunk_size < NSFE_INFO_MIN) return false;
+            if (chunk_size > NSFE_INFO_TRACK_COUNT_AT) track_count = chunk[NSFE_INFO_TRACK_COUNT_AT];
+        } else if (isTag(tag, "BANK")) {
+            if (chunk_size > NSFE_BANKS_MAX) return false;
+        } else if (isTag(tag, "auth")) {
+            const std::vector<const uint8_t*> auth = strings(chunk, chunk_size);
+            const uint8_t* end = chunk + chunk_size;
+            auto take = [&](size_t n, std::string* text) {
+                if (auth.size() > n) {
+                    *text = field(auth[n], std::min<size_t>(FIELD_MAX, static_cast<size_t>(end - auth[n])));
+                }
+            };
+            take(0, &out->game);
+            take(1, &out->author);
+            take(2, &out->copyright);
+        } else if (isTag(tag, "plst")) {
+            playlist = chunk;
+            playlist_size = chunk_size;
+        } else if (isTag(tag, "tlbl")) {
+            names = strings(chunk, chunk_size);
+            names_end = chunk + chunk_size;
+        } else if (isTag(tag, "time")) {
+            times = chunk;
+            time_count = chunk_size / 4;
+        }
+        // DATA and the optional chunks are passed over
+    }
+
+    // gme plays the playlist in place of the tracks when there is one
+    if (playlist_size) track_count = playlist_size;
+    out->tracks.resize(std::max<size_t>(track_count, 1));
+    for (size_t t = 0; t < out->tracks.size(); ++t) {
+        const size_t track = t < playlist_size ? playlist[t] : t;
+        Track& entry = out->tracks[t];
+        if (track < time_count) {
+            const int32_t length = static_cast<int32_t>(le32(times + 4 * track));
+            if (length > 0) entry.length_ms = length;
+        }
+        if (track < names.size()) {
+            entry.song = field(names[track],
+                               std::min<size_t>(FIELD_MAX, static_cast<size_t>(names_end - names[track])));
+        }
+    }
+    return true;
+}
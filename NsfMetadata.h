@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Titles, track count and track lengths of an NSF or NSFE, read straight
+// from its bytes: the NSF's 128-byte header, or the NSFE's INFO, auth, plst,
+// tlbl and time chunks, passing over DATA without touching it. No Music_Emu
+// is made and nothing is allocated beyond the strings, so the library scan
+// reads a file in the time it takes to page in its first few kilobytes.
+//
+// The fields come out as gme's track_info() gives them, with its trimming
+// of blanks and of "?" placeholders, and the tracks numbered as gme numbers
+// them: through an NSFE's playlist when it has one.
+struct NsfMetadata {
+    static constexpr size_t NSF_HEADER_SIZE = 128;
+
+    struct Track {
+        std::string song;
+        int32_t length_ms = -1;  // -1 if unknown
+    };
+
+    bool nsfe = false;
+    std::string game, author, copyright;
+    std::vector<Track> tracks;
+
+    // false if data is not an NSF or NSFE, or is cut short where gme would
+    // refuse to load it
+    static bool read(const uint8_t* data, size_t size, NsfMetadata* out);
+
+private:
+    static bool readNsf(const uint8_t* data, size_t size, NsfMetadata* out);
+    static bool readNsfe(const uint8_t* data, size_t size, NsfMetadata* out);
+};
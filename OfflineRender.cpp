@@ -0,0 +1,99 @@
+#include "OfflineRender.h"
+#include "NsfExport.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Layout of the composition, as fractions of its height
+constexpr float ROLL_SHARE = 0.58f;
+constexpr float KEYBOARD_SHARE = 0.1f;
+
+}  // namespace
+
+OfflineRender::~OfflineRender() {
+    stop();
+}
+
+bool OfflineRender::start(std::shared_ptr<const MusicFile> file, int track, const PreprocessedTrack& notes,
+                          const ChannelTable& layout, long sample_rate, const std::string& out_dir,
+                          const std::string& stem, int width, int height, const Options& options,
+                          std::string* error) {
+    stop();
+    Music_Emu* emu = nullptr;
+    track_info_t info;
+    gme_err_t err = open_music_emu(*file, &emu, sample_rate);
+    emu_.reset(emu);
+    if (!err) err = gme_track_info(emu, &info, track);
+    if (!err) err = gme_start_track(emu, track);
+    if (err) {
+        if (error) *error = err;
+        emu_.reset();
+        return false;
+    }
+    if (!encoder_.start(out_dir, stem, options.format, width, height, options.threads, error)) {
+        emu_.reset();
+        return false;
+    }
+
+    // The same length WAV export gives, fade included
+    NsfExport::Options length_options;
+    length_options.fade_ms = options.fade_ms;
+    length_options.default_length_ms = options.default_length_ms;
+    const long length_ms = NsfExport::playLength(info, length_options);
+    emu->set_fade(length_ms, options.fade_ms);
+
+    options_ = options;
+    sample_rate_ = sample_rate;
+    file_ = std::move(file);
+    frames_total_ = static_cast<int>(std::ceil((length_ms + options.fade_ms) / 1000.0 * options.fps));
+    next_frame_ = 0;
+    audio_frames_ = 0;
+    pcm_.resize(static_cast<size_t>(sample_rate_ / options.fps + 1) * 2);
+
+    visualizer_.init(emu, sample_rate_);
+    visualizer_.setChannelLayout(layout);
+    piano_.setChannelLayout(layout);
+    piano_.setPreprocessedData(notes);
+    return true;
+}
+
+void OfflineRender::stop() {
+    encoder_.finish();
+    emu_.reset();
+    file_.reset();
+}
+
+int OfflineRender::nextFrame() {
+    if (!emu_ || next_frame_ >= frames_total_) return -1;
+    const int index = next_frame_++;
+
+    // Exactly the audio up to this frame's end, so the frames never drift
+    const int64_t end = static_cast<int64_t>(next_frame_) * sample_rate_ / options_.fps;
+    const int frames = static_cast<int>(end - audio_frames_);
+    audio_frames_ = end;
+    if (frames > 0 && !gme_play(emu_.get(), frames * 2, pcm_.data())) {
+        visualizer_.updateAudioData(pcm_.data(), frames * 2);
+    }
+    visualizer_.processPendingAudio();
+    piano_.updatePlaybackTime(index * NoteClock::RATE / options_.fps);
+    return index;
+}
+
+void OfflineRender::draw(float width, float height) {
+    const int64_t time = std::max(0, next_frame_ - 1) * NoteClock::RATE / options_.fps;
+    const float roll_height = std::floor(height * ROLL_SHARE);
+    const float keyboard_height = std::floor(height * KEYBOARD_SHARE);
+    piano_.drawPianoRoll("##offline_roll", width, roll_height, time);
+    piano_.drawPianoKeyboard("##offline_keyboard", width, keyboard_height);
+    visualizer_.drawSpectrumAnalyzer("##offline_spectrum", width, height - roll_height - keyboard_height);
+}
+
+void OfflineRender::submitFrame(int index, const void* pixels, int width, int height, int row_pitch, bool bgra) {
+    encoder_.submit(index, pixels, width, height, row_pitch, bgra);
+}
+
+void OfflineRender::destroyTextures() {
+    visualizer_.destroyTextures();
+    piano_.destroyTextures();
+}
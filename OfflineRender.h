@@ -0,0 +1,80 @@
+#pragma once
+
+#include "AudioVisualizer.h"
+#include "ChannelTaps.h"
+#include "FrameEncoder.h"
+#include "PianoVisualizer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// A whole track's piano roll, keyboard and spectrum rendered to numbered
+// images for making videos, as fast as the GPU and the encoders go. The
+// notes come from the background preprocessing pass (TrackNoteStore); a
+// private emulator renders the track's audio one video frame at a time
+// into a private AudioVisualizer, so playback and the live visualizers are
+// left alone. The app draws draw() full-window in place of its UI, reads
+// the frames back with sapp_set_capture_callback() in waiting mode and
+// hands them to submitFrame(), which queues them on a FrameEncoder.
+//
+// UI thread only.
+class OfflineRender {
+public:
+    struct Options {
+        int fps = 60;
+        FrameEncoder::Format format = FrameEncoder::Format::PNG;
+        int threads = 0;          // Encoders, 0: one per spare core
+        long fade_ms = 8000;      // As NsfExport
+        long default_length_ms = 150000;
+    };
+
+    OfflineRender() = default;
+    ~OfflineRender();
+    OfflineRender(const OfflineRender&) = delete;
+    OfflineRender& operator=(const OfflineRender&) = delete;
+
+    // Render track of file to out_dir/<stem>-NNNNNN.png at width x height;
+    // false with error set if the track does not open or out_dir is no
+    // folder. notes are the track's complete preprocessed notes.
+    bool start(std::shared_ptr<const MusicFile> file, int track, const PreprocessedTrack& notes,
+               const ChannelTable& layout, long sample_rate, const std::string& out_dir, const std::string& stem,
+               int width, int height, const Options& options, std::string* error);
+    // Stop early or after the last frame; frames already submitted are written
+    void stop();
+    bool isActive() const { return emu_ != nullptr; }
+
+    // Advance the analysis to the next video frame and return its index, or
+    // -1 once the track is over
+    int nextFrame();
+    // The frame nextFrame() last advanced to, full size at the cursor
+    void draw(float width, float height);
+    // A frame read back; blocks when every encoder buffer is waiting
+    void submitFrame(int index, const void* pixels, int width, int height, int row_pitch, bool bgra);
+
+    float frameSeconds() const { return 1.0f / options_.fps; }
+    int framesTotal() const { return frames_total_; }
+    int framesRendered() const { return next_frame_; }
+    int framesWritten() const { return encoder_.framesWritten(); }
+    int framesFailed() const { return encoder_.framesFailed(); }
+
+    // Release GPU resources (call before sg_shutdown)
+    void destroyTextures();
+
+private:
+    struct EmuDeleter {
+        void operator()(Music_Emu* emu) const { gme_delete(emu); }
+    };
+
+    Options options_;
+    long sample_rate_ = 44100;
+    std::shared_ptr<const MusicFile> file_;
+    std::unique_ptr<Music_Emu, EmuDeleter> emu_;
+    AudioVisualizer visualizer_;
+    PianoVisualizer piano_;
+    FrameEncoder encoder_;
+
+    std::vector<short> pcm_;
+    int next_frame_ = 0;
+    int frames_total_ = 0;
+    int64_t audio_frames_ = 0;  // Rendered so far
+};
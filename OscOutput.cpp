@@ -0,0 +1,197 @@
+#include "OscOutput.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__EMSCRIPTEN__)
+// Browsers have no UDP; start() reports it
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// OSC strings: NUL terminated, padded to a multiple of four
+void putString(std::vector<uint8_t>& out, const char* text) {
+    const size_t length = std::strlen(text);
+    out.insert(out.end(), text, text + length);
+    out.resize(out.size() + 4 - length % 4, 0);
+}
+
+// OSC numbers are big-endian
+void putInt(std::vector<uint8_t>& out, uint32_t value) {
+    const uint8_t bytes[4] = {static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                              static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value)};
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+void putFloat(std::vector<uint8_t>& out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putInt(out, bits);
+}
+
+// Bundle element: size, then the message
+template <typename Body>
+void putMessage(std::vector<uint8_t>& out, Body&& body) {
+    const size_t size_at = out.size();
+    putInt(out, 0);
+    body();
+    const uint32_t size = static_cast<uint32_t>(out.size() - size_at - 4);
+    for (int i = 0; i < 4; ++i) out[size_at + i] = static_cast<uint8_t>(size >> (24 - 8 * i));
+}
+
+#if !defined(__EMSCRIPTEN__)
+#if defined(_WIN32)
+using Socket = SOCKET;
+void closeSocket(intptr_t s) { closesocket(static_cast<SOCKET>(s)); }
+#else
+using Socket = int;
+void closeSocket(intptr_t s) { ::close(static_cast<int>(s)); }
+#endif
+#endif
+
+}  // namespace
+
+bool OscOutput::Snapshot::operator==(const Snapshot& other) const {
+    if (count != other.count) return false;
+    for (int c = 0; c < count; ++c) {
+        if (level[c] != other.level[c] || note[c] != other.note[c] || velocity[c] != other.velocity[c]) return false;
+    }
+    return true;
+}
+
+void OscOutput::encode(const Snapshot& snapshot, std::vector<uint8_t>& out) {
+    putString(out, "#bundle");
+    putInt(out, 0);
+    putInt(out, 1);  // Time tag: immediately
+    char address[32];
+    for (int c = 0; c < snapshot.count; ++c) {
+        putMessage(out, [&] {
+            std::snprintf(address, sizeof(address), "/fc/ch/%d/level", c);
+            putString(out, address);
+            putString(out, ",f");
+            putFloat(out, snapshot.level[c]);
+        });
+        putMessage(out, [&] {
+            std::snprintf(address, sizeof(address), "/fc/ch/%d/note", c);
+            putString(out, address);
+            putString(out, ",if");
+            putInt(out, static_cast<uint32_t>(static_cast<int32_t>(snapshot.note[c])));
+            putFloat(out, snapshot.velocity[c]);
+        });
+    }
+}
+
+OscOutput::~OscOutput() {
+    stop();
+}
+
+bool OscOutput::start(const std::string& host, int port, int max_rate, std::string* error) {
+    stop();
+#if defined(__EMSCRIPTEN__)
+    (void)host;
+    (void)port;
+    (void)max_rate;
+    if (error) *error = "No UDP in the browser";
+    return false;
+#else
+#if defined(_WIN32)
+    static const bool wsa_ready = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!wsa_ready) {
+        if (error) *error = "No network";
+        return false;
+    }
+#endif
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* found = nullptr;
+    const std::string service = std::to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &found) != 0 || !found) {
+        if (error) *error = "Could not resolve " + host;
+        return false;
+    }
+    const Socket s = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+#if defined(_WIN32)
+    const bool opened = s != INVALID_SOCKET;
+    u_long non_blocking = 1;
+    if (opened) ioctlsocket(s, FIONBIO, &non_blocking);
+#else
+    const bool opened = s >= 0;
+    if (opened) fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    if (!opened) {
+        freeaddrinfo(found);
+        if (error) *error = "Could not open a UDP socket";
+        return false;
+    }
+    const uint8_t* address = reinterpret_cast<const uint8_t*>(found->ai_addr);
+    address_.assign(address, address + found->ai_addrlen);
+    freeaddrinfo(found);
+
+    socket_ = static_cast<intptr_t>(s);
+    sent_.store(0);
+    dropped_.store(0);
+    running_.store(true, std::memory_order_release);
+    sender_ = std::thread(&OscOutput::senderLoop, this, max_rate < 1 ? 1 : max_rate);
+    return true;
+#endif
+}
+
+void OscOutput::stop() {
+    if (!sender_.joinable()) return;
+    running_.store(false, std::memory_order_release);
+    sender_.join();
+#if !defined(__EMSCRIPTEN__)
+    closeSocket(socket_);
+#endif
+    socket_ = -1;
+}
+
+void OscOutput::senderLoop(int max_rate) {
+#if !defined(__EMSCRIPTEN__)
+    const auto interval = std::chrono::microseconds(1000000 / max_rate);
+    auto next = std::chrono::steady_clock::now();
+    Snapshot last;
+    last.count = -1;
+    std::vector<uint8_t> packet;
+    while (running_.load(std::memory_order_acquire)) {
+        next += interval;
+        std::this_thread::sleep_until(next);
+        if (!snapshots_.acquire()) continue;
+        const Snapshot& snapshot = snapshots_.front();
+        if (snapshot == last) continue;
+        last = snapshot;
+
+        packet.clear();
+        encode(snapshot, packet);
+        const auto sent = sendto(static_cast<Socket>(socket_), reinterpret_cast<const char*>(packet.data()),
+                                 static_cast<int>(packet.size()), 0,
+                                 reinterpret_cast<const sockaddr*>(address_.data()),
+                                 static_cast<socklen_t>(address_.size()));
+        if (sent >= 0 && static_cast<size_t>(sent) == packet.size()) {
+            sent_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        // A stall (sleep, debugger) resumes the rate rather than bursting to catch up
+        const auto now = std::chrono::steady_clock::now();
+        if (now > next + interval) next = now;
+    }
+#else
+    (void)max_rate;
+#endif
+}
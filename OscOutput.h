@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ChannelRegistry.h"
+#include "TripleBuffer.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Channel state sent as OSC over UDP, for lighting desks and the like. The
+// UI thread publishes a snapshot each frame into a TripleBuffer and a sender
+// thread sends the newest one at most max_rate times a second, so neither
+// the audio nor the render thread ever touches the socket. Each packet is
+// one bundle (immediate time tag) with, for channel N of the source:
+//
+//   /fc/ch/N/level  f   meter level, 0..1
+//   /fc/ch/N/note   if  MIDI note (-1 when silent), velocity 0..1
+//
+// Snapshots equal to the last one sent are skipped. The socket never
+// blocks: a packet the OS will not take at once is dropped and counted.
+class OscOutput {
+public:
+    struct Snapshot {
+        int count = 0;
+        std::array<float, ChannelTable::MAX_CHANNELS> level{};
+        std::array<int8_t, ChannelTable::MAX_CHANNELS> note{};
+        std::array<float, ChannelTable::MAX_CHANNELS> velocity{};
+
+        bool operator==(const Snapshot& other) const;
+    };
+
+    static constexpr int DEFAULT_PORT = 9000;
+    static constexpr int DEFAULT_RATE = 30;  // Packets per second at most
+
+    OscOutput() = default;
+    ~OscOutput();
+    OscOutput(const OscOutput&) = delete;
+    OscOutput& operator=(const OscOutput&) = delete;
+
+    // Resolve host, open the socket and start sending; false with error set
+    // if the address does not resolve or there is no network. UI thread.
+    bool start(const std::string& host, int port, int max_rate, std::string* error);
+    void stop();
+    bool isRunning() const { return running_.load(std::memory_order_acquire); }
+
+    // UI thread: the producer's slot to fill, then publish(); lock-free
+    Snapshot& back() { return snapshots_.back(); }
+    void publish() { snapshots_.publish(); }
+
+    // Any thread, for the menu
+    uint32_t packetsSent() const { return sent_.load(std::memory_order_relaxed); }
+    uint32_t packetsDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // The bundle for snapshot, appended to out (exposed for tools)
+    static void encode(const Snapshot& snapshot, std::vector<uint8_t>& out);
+
+private:
+    void senderLoop(int max_rate);
+
+    TripleBuffer<Snapshot> snapshots_;
+    std::thread sender_;
+    std::atomic<bool> running_{false};
+    intptr_t socket_ = -1;
+    std::vector<uint8_t> address_;  // sockaddr for sendto()
+
+    std::atomic<uint32_t> sent_{0};
+    std::atomic<uint32_t> dropped_{0};
+};
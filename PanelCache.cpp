@@ -0,0 +1,105 @@
+#include "PanelCache.h"
+#include "imgui_internal.h"
+
+namespace {
+
+bool sameTexture(const ImTextureRef& a, const ImTextureRef& b) {
+    return a._TexData == b._TexData && a._TexID == b._TexID;
+}
+
+bool sameRect(const ImVec4& a, const ImVec4& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+
+}  // namespace
+
+bool PanelCache::Key::operator==(const Key& other) const {
+    return version == other.version && font_size == other.font_size && alpha == other.alpha &&
+           text_color == other.text_color && disabled_color == other.disabled_color &&
+           atlas_texture == other.atlas_texture && atlas_discards == other.atlas_discards;
+}
+
+PanelCache::Key PanelCache::currentKey(uint64_t version) const {
+    const ImFontAtlas* atlas = ImGui::GetIO().Fonts;
+    Key key;
+    key.version = version;
+    key.font_size = ImGui::GetFontSize();
+    key.alpha = ImGui::GetStyle().Alpha;
+    key.text_color = ImGui::GetColorU32(ImGuiCol_Text);
+    key.disabled_color = ImGui::GetColorU32(ImGuiCol_TextDisabled);
+    key.atlas_texture = atlas->TexData ? atlas->TexData->UniqueID : 0;
+    key.atlas_discards = atlas->Builder ? atlas->Builder->RectsDiscardedCount : 0;
+    return key;
+}
+
+bool PanelCache::begin(uint64_t version) {
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    const Key key = currentKey(version);
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+
+    // Glyphs are snapped to whole pixels, so a replay at another fraction of
+    // one would blur them
+    const ImVec2 fraction(origin.x - ImFloor(origin.x), origin.y - ImFloor(origin.y));
+    if (valid_ && key == key_ && sameTexture(draw_list->_CmdHeader.TexRef, texture_) &&
+        fraction.x == fraction_.x && fraction.y == fraction_.y) {
+        // Into the current command, as the recording was; the scissor clips
+        // whatever of it the window has scrolled out
+        const int vtx_count = static_cast<int>(vertices_.size());
+        draw_list->PrimReserve(static_cast<int>(indices_.size()), vtx_count);
+        const ImDrawIdx base = static_cast<ImDrawIdx>(draw_list->_VtxCurrentIdx);
+        for (const ImDrawVert& v : vertices_) {
+            draw_list->PrimWriteVtx(ImVec2(v.pos.x + origin.x, v.pos.y + origin.y), v.uv, v.col);
+        }
+        for (uint32_t index : indices_) draw_list->PrimWriteIdx(static_cast<ImDrawIdx>(base + index));
+        ImGui::Dummy(size_);
+        return true;
+    }
+
+    // Record this frame's drawing of it
+    valid_ = false;
+    recording_ = true;
+    key_ = key;
+    draw_list_ = draw_list;
+    origin_ = origin;
+    fraction_ = fraction;
+    cmd_count_ = draw_list->CmdBuffer.Size;
+    vtx_start_ = draw_list->VtxBuffer.Size;
+    idx_start_ = draw_list->IdxBuffer.Size;
+    vtx_index_ = draw_list->_VtxCurrentIdx;
+    clip_rect_ = draw_list->_CmdHeader.ClipRect;
+    texture_ = draw_list->_CmdHeader.TexRef;
+    ImGui::BeginGroup();
+    return false;
+}
+
+void PanelCache::end() {
+    if (!recording_) return;
+    recording_ = false;
+    ImGui::EndGroup();
+    size_ = ImGui::GetItemRectSize();
+
+    ImDrawList* draw_list = draw_list_;
+    const int vtx_count = draw_list->VtxBuffer.Size - vtx_start_;
+    const ImVec4& clip = draw_list->_CmdHeader.ClipRect;
+    const ImVec2 min = ImGui::GetItemRectMin();
+    const ImVec2 max = ImGui::GetItemRectMax();
+    // ImGui culls text outside the clip rect as it draws, so a recording
+    // made partly clipped would be missing lines
+    if (draw_list != ImGui::GetWindowDrawList() || draw_list->CmdBuffer.Size != cmd_count_ ||
+        !sameRect(clip, clip_rect_) || !sameTexture(draw_list->_CmdHeader.TexRef, texture_) ||
+        draw_list->_VtxCurrentIdx - vtx_index_ != static_cast<unsigned int>(vtx_count) || min.x < clip.x ||
+        min.y < clip.y || max.x > clip.z || max.y > clip.w) {
+        return;
+    }
+
+    vertices_.assign(draw_list->VtxBuffer.Data + vtx_start_, draw_list->VtxBuffer.Data + draw_list->VtxBuffer.Size);
+    for (ImDrawVert& v : vertices_) {
+        v.pos.x -= origin_.x;
+        v.pos.y -= origin_.y;
+    }
+    indices_.resize(static_cast<size_t>(draw_list->IdxBuffer.Size - idx_start_));
+    for (size_t i = 0; i < indices_.size(); ++i) {
+        indices_[i] = draw_list->IdxBuffer.Data[idx_start_ + i] - vtx_index_;
+    }
+    valid_ = true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "imgui.h"
+#include <cstdint>
+#include <vector>
+
+// Retained drawing for a panel whose look changes only with its content,
+// such as the player's track info: the vertices ImGui emits for it are
+// recorded once and copied into the window's draw list on later frames,
+// moved to wherever the panel now sits, until the content version, the
+// font atlas or the style colours it was drawn with change.
+//
+// Only what takes no input can go in: text, separators and fills, not
+// widgets, since a replay bypasses ImGui's item handling. A recording is
+// kept if it landed in the draw command it started in (one texture and clip
+// rect), wholly inside the clip rect, and within one 64K vertex block;
+// anything else is drawn live every frame, as if there were no cache.
+//
+//   if (!cache.begin(version)) {
+//       ImGui::Text(...);
+//       cache.end();
+//   }
+class PanelCache {
+public:
+    // Replays the recording for version and returns true, or starts
+    // recording it and returns false: draw the content, then call end()
+    bool begin(uint64_t version);
+    void end();
+
+    void invalidate() { valid_ = false; }
+    bool valid() const { return valid_; }
+
+private:
+    struct Key {
+        uint64_t version = 0;
+        float font_size = 0.0f;
+        float alpha = 0.0f;
+        ImU32 text_color = 0;
+        ImU32 disabled_color = 0;
+        int atlas_texture = 0;     // ImTextureData::UniqueID; a repack makes a new one
+        int atlas_discards = 0;    // Rectangles freed, whose pixels may be reused
+        bool operator==(const Key& other) const;
+    };
+    Key currentKey(uint64_t version) const;
+
+    bool valid_ = false;
+    bool recording_ = false;
+    Key key_;
+    ImTextureRef texture_;
+    ImVec2 size_;                     // Of the group the content was laid out in
+    ImVec2 fraction_;                 // Of the pixel the cursor was at
+    std::vector<ImDrawVert> vertices_;  // Relative to the cursor at begin()
+    std::vector<uint32_t> indices_;     // Relative to the first vertex
+
+    // Draw list state at begin() while recording
+    ImDrawList* draw_list_ = nullptr;
+    ImVec2 origin_;
+    int cmd_count_ = 0;
+    int vtx_start_ = 0;
+    int idx_start_ = 0;
+    unsigned int vtx_index_ = 0;
+    ImVec4 clip_rect_;
+};
@@ -0,0 +1,79 @@
+#include "PhosphorScope.h"
+#include <algorithm>
+#include <cmath>
+
+PhosphorScope::PhosphorScope() {
+    for (auto& plane : planes_) plane.assign(static_cast<size_t>(WIDTH) * HEIGHT, 0.0f);
+}
+
+void PhosphorScope::clear() {
+    for (auto& plane : planes_) std::fill(plane.begin(), plane.end(), 0.0f);
+}
+
+void PhosphorScope::decay(float factor) {
+    // Below one 8-bit step the glow is invisible; cut it to zero rather than
+    // letting it sink into denormals
+    constexpr float CUTOFF = 1.0f / 256.0f;
+    for (auto& plane : planes_) {
+        float* p = plane.data();
+        for (size_t i = 0, n = plane.size(); i < n; ++i) {
+            const float v = p[i] * factor;
+            p[i] = v < CUTOFF ? 0.0f : v;
+        }
+    }
+}
+
+void PhosphorScope::addTrace(int trace, const float* lo, const float* hi, int columns, int x0, float zoom) {
+    if (trace < 0 || trace >= TRACES) return;
+    float* plane = planes_[trace].data();
+    const float center = HEIGHT * 0.5f;
+    const float scale = HEIGHT * 0.45f * zoom;
+    auto to_row = [&](float sample) {
+        return std::clamp(static_cast<int>(std::lround(center - sample * scale)), 0, HEIGHT - 1);
+    };
+    
+    // Rows covered by the last column, so the next one can reach back to it
+    int prev_top = -1;
+    int prev_bottom = -1;
+    const int end = std::min(WIDTH, x0 + columns);
+    for (int x = std::max(0, x0); x < end; ++x) {
+        const int c = x - x0;
+        const int col_top = to_row(hi[c]);
+        const int col_bottom = to_row(lo[c]);
+        int top = col_top;
+        int bottom = col_bottom;
+        if (prev_top >= 0) {
+            top = std::min(top, prev_bottom);
+            bottom = std::max(bottom, prev_top);
+        }
+        for (int y = top; y <= bottom; ++y) plane[static_cast<size_t>(y) * WIDTH + x] = 1.0f;
+        prev_top = col_top;
+        prev_bottom = col_bottom;
+    }
+}
+
+void PhosphorScope::render(uint32_t* pixels, const std::array<uint32_t, TRACES>& colors) const {
+    // ImGui blends with straight alpha: the colour is the traces' mix and the
+    // alpha their glow, so an empty screen stays transparent over the scope
+    std::array<float, TRACES * 4> tint;
+    for (int t = 0; t < TRACES; ++t) {
+        for (int k = 0; k < 4; ++k) tint[t * 4 + k] = static_cast<float>((colors[t] >> (8 * k)) & 0xFF);
+    }
+    const float* a = planes_[0].data();
+    const float* b = planes_[1].data();
+    for (size_t i = 0, n = planes_[0].size(); i < n; ++i) {
+        const float sum = a[i] + b[i];
+        if (sum <= 0.0f) {
+            pixels[i] = 0;
+            continue;
+        }
+        const float wa = a[i] / sum;
+        const float wb = b[i] / sum;
+        const float r = wa * tint[0] + wb * tint[4];
+        const float g = wa * tint[1] + wb * tint[5];
+        const float bl = wa * tint[2] + wb * tint[6];
+        const float alpha = std::max(a[i] * tint[3], b[i] * tint[7]);
+        pixels[i] = static_cast<uint32_t>(r) | (static_cast<uint32_t>(g) << 8) |
+                    (static_cast<uint32_t>(bl) << 16) | (static_cast<uint32_t>(alpha) << 24);
+    }
+}
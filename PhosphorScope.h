@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Analog-scope persistence for the waveform display. Each trace has a
+// fixed-resolution intensity plane that fades geometrically every frame and
+// has only the newest trace drawn into it at full brightness, so the cost
+// per frame is the same however long the afterglow lasts. render() colours
+// the planes into texels for upload.
+class PhosphorScope {
+public:
+    static constexpr int WIDTH = 512;
+    static constexpr int HEIGHT = 128;
+    static constexpr int TRACES = 2;  // Left and right
+
+    PhosphorScope();
+
+    void clear();
+
+    // Fade everything drawn so far; factor 0 clears, 1 keeps
+    void decay(float factor);
+
+    // Draw one trace from per-column sample extremes, starting at column x0.
+    // Neighbouring columns are joined so steep edges stay continuous.
+    void addTrace(int trace, const float* lo, const float* hi, int columns, int x0, float zoom);
+
+    // RGBA8 texels (WIDTH * HEIGHT); each trace tints with its colour
+    void render(uint32_t* pixels, const std::array<uint32_t, TRACES>& colors) const;
+
+    std::size_t memoryBytes() const { return TRACES * planes_[0].capacity() * sizeof(float); }
+
+private:
+    std::array<std::vector<float>, TRACES> planes_;  // Row-major, 0..1 intensity
+};
@@ -1,39 +1,85 @@
 #include "PianoVisualizer.h"
+#include "Trace.h"
 #include "gme/gme.h"
-#include "gme/Nes_Apu.h"
-#include "gme/Nes_Vrc6_Apu.h"
+#include "gme/Music_Emu.h"
+#ifndef NES_HEADLESS
+#include "FrameProfiler.h"
+#include "sokol_app.h"
+#include "util/sokol_imgui.h"
+#endif
 #include <algorithm>
+#include <chrono>
 #include <cstring>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+namespace {
+
+// Notes a second a channel starts, to size a pass's note runs up front.
+// The bundled test track averages 1.5; arpeggios run higher, and runs
+// that outgrow this still grow as before.
+constexpr float NOTES_PER_CHANNEL_SECOND = 4.0f;
+// Reserved seconds at most, for tracks of unknown length
+constexpr float MAX_RESERVE_SECONDS = 600.0f;
+// Shorter notes are dropped, 10 ms
+constexpr int64_t MIN_NOTE_TICKS = NoteClock::RATE / 100;
+
+}  // namespace
+
 PianoVisualizer::PianoVisualizer() {
     reset();
 }
 
 void PianoVisualizer::reset() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    for (int i = 0; i < PIANO_NUM_CHANNELS_MAX; ++i) {
-        current_notes_[i] = {i, 0, 0.0f, false};
+    for (int i = 0; i < ChannelTable::MAX_CHANNELS; ++i) {
+        live_keys_[i].store(packKey(-1, 0.0f), std::memory_order_relaxed);
+        live_start_[i].store(0, std::memory_order_relaxed);
         preprocess_prev_notes_[i] = -1;
-        preprocess_note_start_[i] = 0.0f;
+        preprocess_note_start_[i] = 0;
         preprocess_note_velocity_[i] = 0.0f;
+        channel_notes_[i].clear();
     }
     
-    preprocessed_notes_.clear();
-    has_preprocessed_data_ = false;
-    track_duration_ = 0.0f;
+    publishNotes(nullptr);
+    
+    // The sampling thread drops its notes in flight on its next call
+    history_reset_.store(true, std::memory_order_release);
+    history_queue_.discard();
+    history_count_ = 0;
 }
 
-int PianoVisualizer::frequencyToMidi(float frequency) {
-    if (frequency <= 0) return -1;
-    float midi = 69.0f + 12.0f * std::log2(frequency / 440.0f);
-    int note = static_cast<int>(std::round(midi));
-    if (note < 0 || note > 127) return -1;
-    return note;
+uint32_t PianoVisualizer::packKey(int midi_note, float velocity) {
+    if (midi_note < 0 || midi_note > 127 || velocity <= ChannelTable::MIN_VELOCITY) return 0;
+    const uint32_t v = static_cast<uint32_t>(std::min(velocity, 1.0f) * 65535.0f + 0.5f);
+    return static_cast<uint32_t>(midi_note) | 0x100u | (v << 16);
+}
+
+int PianoVisualizer::getLiveNote(int channel, float* velocity) const {
+    const uint32_t key = live_keys_[channel].load(std::memory_order_relaxed);
+    *velocity = (key & 0x100u) ? (key >> 16) / 65535.0f : 0.0f;
+    return (key & 0x100u) ? static_cast<int>(key & 0x7F) : -1;
+}
+
+float PianoVisualizer::getTrackDuration() const {
+    auto data = loadNotes();
+    return data ? static_cast<float>(NoteClock::toSeconds(data->duration)) : 0.0f;
+}
+
+void PianoVisualizer::reportMemory(MemoryReport::Sample& sample) const {
+    using MR = MemoryReport;
+    size_t bytes = sizeof(*this) + history_queue_.memoryBytes() + MR::heapBytes(visible_notes_);
+    if (auto data = loadNotes()) bytes += sizeof(NoteData) + data->memoryBytes();
+#ifndef NES_HEADLESS
+    for (const KeyMesh* mesh : {&keyboard_cache_.white_keys, &keyboard_cache_.black_keys}) {
+        bytes += MR::heapBytes(mesh->vtx) + MR::heapBytes(mesh->idx);
+    }
+    if (note_texture_created_) sample.add(MR::TEXTURES, size_t(SPRITE_STRIDE) * SPRITE_COUNT * SPRITE_STRIDE * 4);
+    if (overview_texture_created_) sample.add(MR::TEXTURES, size_t(OVERVIEW_COLUMNS) * ChannelTable::MAX_CHANNELS * 4);
+    bytes += MR::heapBytes(overview_pixels_);
+#endif
+    sample.add(MR::PIANO_NOTES, bytes);
 }
 
 float PianoVisualizer::midiToFrequency(int midi_note) {
@@ -60,200 +106,296 @@ int PianoVisualizer::getNoteInOctave(int midi_note) {
     return midi_note % 12;
 }
 
-int PianoVisualizer::periodToMidi(int channel, int period) {
-    if (period < 8) return -1;  // Too high frequency / silent
-    
-    float freq = 0;
-    
-    if (channel == 3) {
-        // Noise channel - map to low notes
-        int noise_idx = period & 0x0F;
-        return 36 + (15 - noise_idx);  // C2 to C3 range
-    } else if (channel == 4) {
-        // DMC - fixed low note
-        return 28;  // E1
-    } else {
-        // Square1, Square2, Triangle
-        freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-    }
-    
-    return frequencyToMidi(freq);
-}
-
-void PianoVisualizer::processApuFrame(const int* periods, const int* lengths, const int* amplitudes, float current_time) {
-    for (int ch = 0; ch < PIANO_NUM_CHANNELS_BASE; ++ch) {
-        int period = periods[ch];
-        int length = lengths[ch];
-        int amp = std::abs(amplitudes[ch]);
-        
-        int midi_note = -1;
-        float velocity = 0;
-        
-        if (ch == 3) {
-            // Noise
-            if (length > 0 && amp > 0) {
-                midi_note = 36 + (15 - (period & 0x0F));
-                velocity = std::min(1.0f, amp / 15.0f);
-            }
-        } else if (ch == 4) {
-            // DMC - check if actively playing (length > 0 means bytes remaining)
-            if (length > 0) {
-                midi_note = 28;
-                velocity = 0.8f;  // Fixed velocity when DMC is playing
-            }
-        } else if (ch == 2) {
-            // Triangle - doesn't have volume control, just on/off
-            // last_amp is the waveform position (0-15), not volume
-            if (length > 0 && period >= 8) {
-                float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-                midi_note = frequencyToMidi(freq);
-                velocity = 0.8f;  // Fixed velocity for Triangle
-            }
-        } else {
-            // Square1, Square2
-            if (length > 0 && amp > 0 && period >= 8) {
-                float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-                midi_note = frequencyToMidi(freq);
-                velocity = std::min(1.0f, amp / 15.0f);
-            }
+void PianoVisualizer::processChannels(const ChannelTable& table, int64_t current_time) {
+    // Each sample's volumes into its activity bin; a sample before the
+    // first bin (times are not always from 0) joins the first
+    const size_t bin = static_cast<size_t>(std::max<int64_t>(0, current_time) * ACTIVITY_BINS_PER_SECOND / NoteClock::RATE);
+    if (activity_channels_ > 0) {
+        if (activity_count_.empty()) activity_origin_ = bin;
+        const size_t slot = bin - std::min(bin, activity_origin_);
+        if (slot >= activity_count_.size()) {
+            activity_count_.resize(slot + 1, 0);
+            activity_sum_.resize((slot + 1) * activity_channels_, 0.0f);
         }
-        
-        int prev_note = preprocess_prev_notes_[ch];
-        
-        // Note changed or ended
-        if (midi_note != prev_note || velocity < 0.01f) {
-            // End previous note
-            if (prev_note >= 0 && prev_note <= 127) {
-                PianoRollNote note;
-                note.channel = ch;
-                note.midi_note = prev_note;
-                note.velocity = preprocess_note_velocity_[ch];
-                note.start_time = preprocess_note_start_[ch];
-                note.end_time = current_time;
-                
-                // Only add if note has meaningful duration
-                if (note.end_time - note.start_time > 0.01f) {
-                    preprocessed_notes_.push_back(note);
-                }
-            }
-            
-            // Start new note
-            if (midi_note >= 0 && midi_note <= 127 && velocity > 0.01f) {
-                preprocess_prev_notes_[ch] = midi_note;
-                preprocess_note_start_[ch] = current_time;
-                preprocess_note_velocity_[ch] = velocity;
-            } else {
-                preprocess_prev_notes_[ch] = -1;
-            }
+        float* sums = &activity_sum_[slot * activity_channels_];
+        for (int ch = 0; ch < std::min(table.count, activity_channels_); ++ch) {
+            if (table.active[ch]) sums[ch] += std::min(table.velocity[ch], 1.0f);
         }
+        if (activity_count_[slot] < UINT16_MAX) ++activity_count_[slot];
     }
-}
-
-void PianoVisualizer::processVrc6Frame(const int* periods, const int* volumes, const bool* enabled, float current_time) {
-    // VRC6 channels: Pulse1 (ch 5), Pulse2 (ch 6), Saw (ch 7)
-    for (int i = 0; i < PIANO_NUM_CHANNELS_VRC6; ++i) {
-        int ch = PIANO_NUM_CHANNELS_BASE + i;  // 5, 6, 7
-        int period = periods[i];
-        int volume = volumes[i];
-        bool is_enabled = enabled[i];
-        
-        int midi_note = -1;
-        float velocity = 0;
-        
-        if (is_enabled && volume > 0 && period >= 1) {
-            // VRC6 period formula: freq = CPU_CLOCK / (16 * (period + 1))
-            float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-            midi_note = frequencyToMidi(freq);
-            
-            if (i < 2) {
-                // Pulse waves - 4-bit volume (0-15)
-                velocity = std::min(1.0f, volume / 15.0f);
-            } else {
-                // Saw wave - accumulator rate (0-63)
-                velocity = std::min(1.0f, volume / 42.0f);
-            }
-        }
-        
+    
+    for (int ch = 0; ch < table.count; ++ch) {
+        const int midi_note = table.active[ch] ? table.note[ch] : -1;
         int prev_note = preprocess_prev_notes_[ch];
         
         // Note changed or ended
-        if (midi_note != prev_note || velocity < 0.01f) {
+        if (midi_note != prev_note) {
             // End previous note
-            if (prev_note >= 0 && prev_note <= 127) {
+            if (prev_note >= 0) {
                 PianoRollNote note;
                 note.channel = ch;
                 note.midi_note = prev_note;
                 note.velocity = preprocess_note_velocity_[ch];
-                note.start_time = preprocess_note_start_[ch];
-                note.end_time = current_time;
+                note.start = preprocess_note_start_[ch];
+                note.end = current_time;
                 
-                if (note.end_time - note.start_time > 0.01f) {
-                    preprocessed_notes_.push_back(note);
+                // Only add if note has meaningful duration
+                if (note.end - note.start > MIN_NOTE_TICKS) {
+                    channel_notes_[ch].push_back(note);
                 }
             }
             
             // Start new note
-            if (midi_note >= 0 && midi_note <= 127 && velocity > 0.01f) {
-                preprocess_prev_notes_[ch] = midi_note;
+            preprocess_prev_notes_[ch] = midi_note;
+            if (midi_note >= 0) {
                 preprocess_note_start_[ch] = current_time;
-                preprocess_note_velocity_[ch] = velocity;
-            } else {
-                preprocess_prev_notes_[ch] = -1;
+                preprocess_note_velocity_[ch] = table.velocity[ch];
             }
         }
     }
 }
 
-void PianoVisualizer::finalizePreprocessing(float end_time) {
+void PianoVisualizer::finalizePreprocessing(int64_t end_time) {
     // End any notes still playing
-    for (int ch = 0; ch < PIANO_NUM_CHANNELS_MAX; ++ch) {
+    for (int ch = 0; ch < ChannelTable::MAX_CHANNELS; ++ch) {
         int prev_note = preprocess_prev_notes_[ch];
         if (prev_note >= 0 && prev_note <= 127) {
             PianoRollNote note;
             note.channel = ch;
             note.midi_note = prev_note;
             note.velocity = preprocess_note_velocity_[ch];
-            note.start_time = preprocess_note_start_[ch];
-            note.end_time = end_time;
+            note.start = preprocess_note_start_[ch];
+            note.end = end_time;
             
-            if (note.end_time - note.start_time > 0.01f) {
-                preprocessed_notes_.push_back(note);
+            if (note.end - note.start > MIN_NOTE_TICKS) {
+                channel_notes_[ch].push_back(note);
             }
         }
         preprocess_prev_notes_[ch] = -1;
     }
     
-    // Sort notes by start time
-    std::sort(preprocessed_notes_.begin(), preprocessed_notes_.end(),
-              [](const PianoRollNote& a, const PianoRollNote& b) {
-                  return a.start_time < b.start_time;
-              });
+    mergeChannelNotes(nullptr, merged_notes_);
+    std::vector<uint8_t> activity;
+    foldActivity(end_time, activity);
+    publishNotes(std::make_shared<const NoteData>(merged_notes_, end_time, std::move(activity)));
+    merged_notes_.clear();
+    for (auto& notes : channel_notes_) notes.clear();
+}
+
+void PianoVisualizer::reserveNotes(const ChannelTable& layout, float duration) {
+    const size_t per_channel = static_cast<size_t>(std::min(duration, MAX_RESERVE_SECONDS) * NOTES_PER_CHANNEL_SECOND);
+    for (int ch = 0; ch < layout.count; ++ch) channel_notes_[ch].reserve(per_channel);
+    merged_notes_.reserve(per_channel * layout.count);
+    const size_t bins = static_cast<size_t>(std::min(duration, MAX_RESERVE_SECONDS) * ACTIVITY_BINS_PER_SECOND) + 1;
+    activity_count_.reserve(bins);
+    activity_sum_.reserve(bins * layout.count);
+}
+
+void PianoVisualizer::foldActivity(int64_t duration, std::vector<uint8_t>& out) const {
+    out.clear();
+    if (activity_count_.empty() || duration <= 0) return;
     
-    track_duration_ = end_time;
-    has_preprocessed_data_ = true;
+    // Each column is the mean over the bins it spans, or the one it falls
+    // in when a column is shorter than a bin
+    constexpr int COLUMNS = PreprocessedTrack::ACTIVITY_COLUMNS;
+    out.assign(static_cast<size_t>(COLUMNS) * ChannelTable::MAX_CHANNELS, 0);
+    const double bins_per_column = NoteClock::toSeconds(duration) * ACTIVITY_BINS_PER_SECOND / COLUMNS;
+    for (int c = 0; c < COLUMNS; ++c) {
+        const size_t b0 = static_cast<size_t>(c * bins_per_column);
+        const size_t b1 = std::max(b0 + 1, static_cast<size_t>((c + 1) * bins_per_column));
+        const size_t s0 = b0 - std::min(b0, activity_origin_);
+        const size_t s1 = std::min(b1 - std::min(b1, activity_origin_), activity_count_.size());
+        uint32_t samples = 0;
+        float sums[ChannelTable::MAX_CHANNELS] = {};
+        for (size_t slot = s0; slot < s1; ++slot) {
+            samples += activity_count_[slot];
+            const float* bin = &activity_sum_[slot * activity_channels_];
+            for (int ch = 0; ch < activity_channels_; ++ch) sums[ch] += bin[ch];
+        }
+        if (samples == 0) continue;
+        for (int ch = 0; ch < activity_channels_; ++ch) {
+            out[static_cast<size_t>(ch) * COLUMNS + c] =
+                static_cast<uint8_t>(std::min(sums[ch] / samples, 1.0f) * 255.0f + 0.5f);
+        }
+    }
 }
 
-bool PianoVisualizer::preprocessTrack(Music_Emu* emu, int track, long sample_rate,
-                                       ApuDataCallback apu_callback,
-                                       std::function<void(float)> progress_callback,
-                                       Vrc6DataCallback vrc6_callback) {
-    if (!emu || !apu_callback) return false;
+void PianoVisualizer::mergeChannelNotes(const PianoRollNote* open, std::vector<PianoRollNote>& out) const {
+    // k-way merge: with at most MAX_CHANNELS runs, a branch-free scan of
+    // their next starts beats a heap. Runs stay in channel order, so the
+    // lower channel wins a tie.
+    const PianoRollNote* next[ChannelTable::MAX_CHANNELS];
+    const PianoRollNote* last[ChannelTable::MAX_CHANNELS];
+    int64_t start[ChannelTable::MAX_CHANNELS];
+    int runs = 0;
+    size_t total = 0;
+    for (const std::vector<PianoRollNote>& notes : channel_notes_) {
+        total += notes.size();
+        if (notes.empty()) continue;
+        next[runs] = notes.data();
+        last[runs] = notes.data() + notes.size();
+        start[runs] = notes.front().start;
+        ++runs;
+    }
+    out.clear();
+    out.reserve(total + (open ? ChannelTable::MAX_CHANNELS : 0));
+    while (runs > 0) {
+        int best = 0;
+        for (int r = 1; r < runs; ++r) best = start[r] < start[best] ? r : best;
+        out.push_back(*next[best]);
+        if (++next[best] != last[best]) {
+            start[best] = next[best]->start;
+            continue;
+        }
+        --runs;
+        std::copy(next + best + 1, next + runs + 1, next + best);
+        std::copy(last + best + 1, last + runs + 1, last + best);
+        std::copy(start + best + 1, start + runs + 1, start + best);
+    }
+    if (!open) return;
     
-    std::lock_guard<std::mutex> lock(mutex_);
+    // Notes still sounding start after their own channel's, not the others'
+    const size_t ended = out.size();
+    for (int ch = 0; ch < ChannelTable::MAX_CHANNELS; ++ch) {
+        if (open[ch].midi_note >= 0) out.push_back(open[ch]);
+    }
+    auto by_start = [](const PianoRollNote& a, const PianoRollNote& b) { return a.start < b.start; };
+    std::stable_sort(out.begin() + ended, out.end(), by_start);
+    std::inplace_merge(out.begin(), out.begin() + ended, out.end(), by_start);
+}
+
+PianoVisualizer::NoteData::NoteData(const std::vector<PianoRollNote>& sorted_notes, int64_t track_duration,
+                                    std::vector<uint8_t> activity)
+    : duration(track_duration) {
+    const bool has_activity = activity.size() == static_cast<size_t>(OVERVIEW_COLUMNS) * ChannelTable::MAX_CHANNELS;
+    if (has_activity) overview = std::move(activity);
+    const size_t note_count = sorted_notes.size();
+    start.resize(note_count);
+    length.resize(note_count);
+    channel.resize(note_count);
+    midi_note.resize(note_count);
+    velocity.resize(note_count);
+    for (size_t n = 0; n < note_count; ++n) {
+        const PianoRollNote& note = sorted_notes[n];
+        start[n] = toTicks(note.start);
+        length[n] = std::max(toTicks(note.end), start[n]) - start[n];
+        channel[n] = static_cast<uint8_t>(note.channel);
+        midi_note[n] = static_cast<uint8_t>(note.midi_note);
+        velocity[n] = static_cast<uint8_t>(std::clamp(note.velocity, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    if (note_count == 0) return;
     
-    // Reset state
-    preprocessed_notes_.clear();
-    has_preprocessed_data_ = false;
-    track_duration_ = 0.0f;
+    chunks.resize((start.back() >> CHUNK_SHIFT) + 1);
     
-    // Check if VRC6 is available
-    has_vrc6_ = (vrc6_callback != nullptr) && (vrc6_callback(emu) != nullptr);
+    size_t i = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        const uint32_t begin = static_cast<uint32_t>(c) << CHUNK_SHIFT;
+        while (i < note_count && start[i] < begin) ++i;
+        chunks[c].first = static_cast<uint32_t>(i);
+    }
     
-    for (int i = 0; i < PIANO_NUM_CHANNELS_MAX; ++i) {
-        preprocess_prev_notes_[i] = -1;
-        preprocess_note_start_[i] = 0.0f;
-        preprocess_note_velocity_[i] = 0.0f;
+    // A held note is carried into every later chunk it reaches
+    for (size_t n = 0; n < note_count; ++n) {
+        const uint32_t note_end = end(n);
+        NoteChunk& own = chunks[start[n] >> CHUNK_SHIFT];
+        own.max_length = std::max(own.max_length, length[n]);
+        for (size_t c = (start[n] >> CHUNK_SHIFT) + 1; c < chunks.size() && (c << CHUNK_SHIFT) < note_end; ++c) {
+            chunks[c].carried.push_back(static_cast<uint32_t>(n));
+        }
+    }
+    
+    // Overview without the pass's activity: each note adds its overlap with
+    // the columns it spans
+    if (has_activity) return;
+    const double column_ticks = std::max(1.0, toTicks(duration) / static_cast<double>(OVERVIEW_COLUMNS));
+    std::vector<float> covered(static_cast<size_t>(OVERVIEW_COLUMNS) * ChannelTable::MAX_CHANNELS, 0.0f);
+    for (size_t n = 0; n < note_count; ++n) {
+        if (channel[n] >= ChannelTable::MAX_CHANNELS) continue;
+        float* row = &covered[static_cast<size_t>(channel[n]) * OVERVIEW_COLUMNS];
+        const double t0 = start[n] / column_ticks;
+        const double t1 = std::min(end(n) / column_ticks, static_cast<double>(OVERVIEW_COLUMNS));
+        for (int c = static_cast<int>(t0); c < OVERVIEW_COLUMNS && c < t1; ++c) {
+            row[c] += static_cast<float>(std::min(t1, c + 1.0) - std::max(t0, static_cast<double>(c)));
+        }
+    }
+    overview.resize(covered.size());
+    for (size_t i = 0; i < covered.size(); ++i) {
+        overview[i] = static_cast<uint8_t>(std::min(covered[i], 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+PianoRollNote PianoVisualizer::NoteData::note(size_t n) const {
+    return {channel[n], midi_note[n], velocity[n] / 255.0f, toTime(start[n]), toTime(end(n))};
+}
+
+size_t PianoVisualizer::NoteData::memoryBytes() const {
+    using MR = MemoryReport;
+    size_t bytes = MR::heapBytes(start) + MR::heapBytes(length) + MR::heapBytes(channel) +
+                   MR::heapBytes(midi_note) + MR::heapBytes(velocity) + MR::heapBytes(chunks) +
+                   MR::heapBytes(overview);
+    for (const NoteChunk& chunk : chunks) bytes += MR::heapBytes(chunk.carried);
+    return bytes;
+}
+
+void PianoVisualizer::NoteData::notesBetween(int64_t t0, int64_t t1, std::vector<uint32_t>& out) const {
+    out.clear();
+    if (chunks.empty()) return;
+    
+    const uint32_t tick0 = toTicks(t0);
+    const uint32_t tick1 = toTicks(t1);
+    const size_t c = std::min<size_t>(tick0 >> CHUNK_SHIFT, chunks.size() - 1);
+    const NoteChunk& chunk = chunks[c];
+    for (uint32_t n : chunk.carried) {
+        if (end(n) >= tick0) out.push_back(n);
+    }
+    
+    // Notes of this chunk starting more than its longest note before t0 are
+    // over, so the scan starts at the first one that may still sound
+    const size_t note_count = size();
+    const size_t chunk_end = c + 1 < chunks.size() ? chunks[c + 1].first : note_count;
+    const uint32_t from = tick0 > chunk.max_length ? tick0 - chunk.max_length : 0;
+    size_t n = std::lower_bound(start.begin() + chunk.first, start.begin() + chunk_end, from) - start.begin();
+    for (; n < note_count && start[n] <= tick1; ++n) {
+        if (start[n] + length[n] >= tick0) out.push_back(static_cast<uint32_t>(n));
+    }
+}
+
+PreprocessedTrack PianoVisualizer::snapshotPreprocessing(int64_t covered_time) const {
+    // Notes still sounding end at the covered time, after their channel's others
+    PianoRollNote open[ChannelTable::MAX_CHANNELS];
+    for (int ch = 0; ch < ChannelTable::MAX_CHANNELS; ++ch) {
+        int prev_note = preprocess_prev_notes_[ch];
+        const bool sounding = prev_note >= 0 && prev_note <= 127;
+        open[ch] = {ch, sounding ? prev_note : -1, preprocess_note_velocity_[ch], preprocess_note_start_[ch],
+                    covered_time};
     }
+    PreprocessedTrack track;
+    mergeChannelNotes(open, track.notes);
+    track.duration = covered_time;
+    track.complete = false;
+    foldActivity(covered_time, track.activity);
+    return track;
+}
+
+bool PianoVisualizer::preprocessTrack(Music_Emu* emu, int track, long sample_rate,
+                                       const ChannelTable& layout, ChannelSampler sampler,
+                                       double sample_interval,
+                                       std::function<void(float)> progress_callback,
+                                       ChunkCallback chunk_callback,
+                                       PublishCallback publish_callback,
+                                       PreprocessStats* stats) {
+    FC_ZONE("preprocessTrack");
+    if (!emu || !sampler) return false;
+    
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point pass_start = Clock::now();
+    Clock::duration emulate_time{}, extract_time{}, sort_time{};
+    long timed_steps = 0;
+    
+    beginNotes(layout);
+    
+    // Sampled in place; the descriptors stay those of the layout
+    ChannelTable table = layout;
     
     // Get track info for duration estimate
     track_info_t info;
@@ -261,68 +403,102 @@ bool PianoVisualizer::preprocessTrack(Music_Emu* emu, int track, long sample_rat
         return false;
     }
     
-    // Estimate duration (use length if available, otherwise default to 3 minutes)
-    float estimated_duration = info.length > 0 ? info.length / 1000.0f : 180.0f;
-    // Cap at 5 minutes for preprocessing
-    estimated_duration = std::min(estimated_duration, 300.0f);
+    // The whole length when it is known. Otherwise the track may loop forever,
+    // and with synthesis off gme cannot end it on silence either.
+    const float estimated_duration = info.length > 0 ? info.length / 1000.0f : UNKNOWN_LENGTH_SECONDS;
+    const int64_t estimated_end = NoteClock::fromSeconds(estimated_duration);
+    reserveNotes(layout, estimated_duration);
     
     // Start the track
     if (gme_start_track(emu, track) != nullptr) {
         return false;
     }
     
-    // Process audio in chunks to extract note data
-    const int chunk_samples = 1024;  // Stereo samples
-    std::vector<short> buffer(chunk_samples * 2);
+    // Only the chip registers are read, so emulators that can skip synthesis
+    // run the CPU alone; the others still have to render each chunk
+    const bool registers_only = emu->set_registers_only(true);
     
-    float current_time = 0;
-    float time_per_chunk = static_cast<float>(chunk_samples) / sample_rate;
+    // Step once per play routine call where the interval is known, else in
+    // 1024-frame chunks. The first step is half long, so with play-rate steps
+    // every sample falls mid-frame and sees exactly one call's register writes;
+    // it is timed at the step's middle, the call for play-rate steps.
+    const double step_frames = sample_interval > 0.0 ? sample_interval * sample_rate : 1024.0;
+    std::vector<short> buffer(registers_only ? 0 : (static_cast<size_t>(step_frames) + 1) * 2);
+    
+    double due_frames = step_frames * 0.5;
+    long frames_done = 0;
+    int64_t current_time = 0;
     int chunks_processed = 0;
-    int total_chunks = static_cast<int>(estimated_duration / time_per_chunk);
     
-    while (current_time < estimated_duration && !gme_track_ended(emu)) {
-        // Generate audio (we need this to advance the emulator state)
-        gme_play(emu, chunk_samples * 2, buffer.data());
+    // Each prefix doubles the last, so the copies add up to twice the notes
+    int64_t next_publish = 10 * NoteClock::RATE;
+    
+    while (current_time < estimated_end && !gme_track_ended(emu)) {
+        const bool timed = stats && chunks_processed % PreprocessStats::STRIDE == 0;
+        Clock::time_point emulate_start, extract_start;
+        if (timed) emulate_start = Clock::now();
         
-        // Get APU state
-        Nes_Apu* apu = apu_callback(emu);
-        if (apu) {
-            int periods[5], lengths[5], amplitudes[5];
-            for (int i = 0; i < 5; ++i) {
-                periods[i] = apu->osc_period(i);
-                lengths[i] = apu->osc_length(i);
-                amplitudes[i] = apu->osc_amplitude(i);
-            }
-            processApuFrame(periods, lengths, amplitudes, current_time);
+        // Advance the emulator state
+        const long frames = static_cast<long>(due_frames) - frames_done;
+        due_frames += step_frames;
+        frames_done += frames;
+        if (registers_only) {
+            emu->skip(frames * 2);
+        } else {
+            gme_play(emu, static_cast<int>(frames * 2), buffer.data());
+        }
+        if (timed) emulate_time += Clock::now() - emulate_start;
+        if (chunk_callback && !chunk_callback(emu)) {
+            break;
         }
         
-        // Get VRC6 state if available
-        if (has_vrc6_ && vrc6_callback) {
-            Nes_Vrc6_Apu* vrc6 = vrc6_callback(emu);
-            if (vrc6) {
-                int vrc6_periods[3], vrc6_volumes[3];
-                bool vrc6_enabled[3];
-                for (int i = 0; i < 3; ++i) {
-                    vrc6_periods[i] = vrc6->osc_period(i);
-                    vrc6_volumes[i] = vrc6->osc_volume(i);
-                    vrc6_enabled[i] = vrc6->osc_enabled(i);
-                }
-                processVrc6Frame(vrc6_periods, vrc6_volumes, vrc6_enabled, current_time);
-            }
+        // Read the chips once per step
+        if (timed) extract_start = Clock::now();
+        sampler(emu, table);
+        const int64_t sample_time = NoteClock::fromSeconds((frames_done - step_frames * 0.5) / sample_rate);
+        processChannels(table, std::max<int64_t>(0, sample_time));
+        if (timed) {
+            extract_time += Clock::now() - extract_start;
+            ++timed_steps;
         }
         
-        current_time += time_per_chunk;
+        current_time = NoteClock::fromFrames(frames_done, sample_rate);
         chunks_processed++;
         
+        if (publish_callback && current_time >= next_publish) {
+            const Clock::time_point sort_start = Clock::now();
+            PreprocessedTrack prefix = snapshotPreprocessing(current_time);
+            sort_time += Clock::now() - sort_start;
+            publish_callback(std::move(prefix));
+            next_publish *= 2;
+        }
+        
         // Progress callback
         if (progress_callback && chunks_processed % 100 == 0) {
-            float progress = std::min(1.0f, current_time / estimated_duration);
+            float progress = std::min(1.0f, static_cast<float>(static_cast<double>(current_time) / estimated_end));
             progress_callback(progress);
         }
     }
     
     // Finalize
+    const Clock::time_point sort_start = Clock::now();
     finalizePreprocessing(current_time);
+    sort_time += Clock::now() - sort_start;
+    
+    if (stats) {
+        // The timed steps stand for all of them
+        const double scale = timed_steps ? static_cast<double>(chunks_processed) / timed_steps : 0.0;
+        const auto seconds = [](Clock::duration d) { return std::chrono::duration<double>(d).count(); };
+        *stats = PreprocessStats();
+        stats->passes = 1;
+        stats->emulated_seconds = NoteClock::toSeconds(current_time);
+        stats->wall_seconds = seconds(Clock::now() - pass_start);
+        stats->emulate_seconds = seconds(emulate_time) * scale;
+        stats->extract_seconds = seconds(extract_time) * scale;
+        stats->sort_seconds = seconds(sort_time);
+        const auto data = loadNotes();
+        stats->notes = data ? data->size() : 0;
+    }
     
     if (progress_callback) {
         progress_callback(1.0f);
@@ -331,123 +507,146 @@ bool PianoVisualizer::preprocessTrack(Music_Emu* emu, int track, long sample_rat
     return true;
 }
 
-void PianoVisualizer::updatePlaybackTime(float current_time) {
-    std::lock_guard<std::mutex> lock(mutex_);
+void PianoVisualizer::beginNotes(const ChannelTable& layout) {
+    // Reset state; readers keep whatever they loaded until the pass publishes
+    for (auto& notes : channel_notes_) notes.clear();
+    publishNotes(nullptr);
+    setChannelLayout(layout);
+    activity_sum_.clear();
+    activity_count_.clear();
+    activity_channels_ = std::min(layout.count, ChannelTable::MAX_CHANNELS);
+    activity_origin_ = 0;
     
-    // Update current notes based on preprocessed data
-    for (int ch = 0; ch < PIANO_NUM_CHANNELS_MAX; ++ch) {
-        current_notes_[ch].active = false;
+    for (int i = 0; i < ChannelTable::MAX_CHANNELS; ++i) {
+        preprocess_prev_notes_[i] = -1;
+        preprocess_note_start_[i] = 0;
+        preprocess_note_velocity_[i] = 0.0f;
     }
+}
+
+void PianoVisualizer::swapPreprocessedData(PianoVisualizer& other) {
+    if (&other == this) return;
+    
+    // Only the pointers move; each side is published whole
+    auto mine = loadNotes();
+    publishNotes(other.loadNotes());
+    other.publishNotes(std::move(mine));
+    // channels_ stays: the other track comes from the same file, so the layout matches
+}
+
+PreprocessedTrack PianoVisualizer::takePreprocessedData() {
+    PreprocessedTrack track;
+    if (auto data = loadNotes()) {
+        track.notes.reserve(data->size());
+        for (size_t n = 0; n < data->size(); ++n) {
+            track.notes.push_back(data->note(n));
+        }
+        track.duration = data->duration;
+        track.activity = data->overview;
+    }
+    publishNotes(nullptr);
+    return track;
+}
+
+void PianoVisualizer::setPreprocessedData(const PreprocessedTrack& track) {
+    // Also for a prefix: the roll shows what there is
+    publishNotes(std::make_shared<const NoteData>(track.notes, track.duration, track.activity));
+}
+
+void PianoVisualizer::updatePlaybackTime(int64_t current_time) {
+    std::array<uint32_t, ChannelTable::MAX_CHANNELS> keys{};
     
     // Find notes that are active at current_time
-    for (const auto& note : preprocessed_notes_) {
-        if (note.start_time <= current_time && note.end_time > current_time) {
-            int ch = note.channel;
-            if (ch >= 0 && ch < PIANO_NUM_CHANNELS_MAX) {
-                current_notes_[ch].midi_note = note.midi_note;
-                current_notes_[ch].velocity = note.velocity;
-                current_notes_[ch].active = true;
+    if (auto data = loadNotes()) {
+        const uint32_t tick = NoteData::toTicks(current_time);
+        data->notesBetween(current_time, current_time, visible_notes_);
+        for (uint32_t index : visible_notes_) {
+            if (data->start[index] <= tick && data->end(index) > tick) {
+                int ch = data->channel[index];
+                if (ch < ChannelTable::MAX_CHANNELS) {
+                    keys[ch] = packKey(data->midi_note[index], data->velocity[index] / 255.0f);
+                }
             }
         }
     }
+    
+    for (int ch = 0; ch < ChannelTable::MAX_CHANNELS; ++ch) {
+        live_keys_[ch].store(keys[ch], std::memory_order_relaxed);
+    }
 }
 
-void PianoVisualizer::updateFromAPU(const int* periods, const int* lengths, const int* amplitudes, float current_time) {
+void PianoVisualizer::setChannelLayout(const ChannelTable& layout) {
     std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Update current notes for live keyboard display (base APU channels only)
-    for (int ch = 0; ch < PIANO_NUM_CHANNELS_BASE; ++ch) {
-        int period = periods[ch];
-        int length = lengths[ch];
-        int amp = std::abs(amplitudes[ch]);
-        
-        int midi_note = -1;
-        float velocity = 0;
-        
-        if (ch == 3) {
-            if (length > 0 && amp > 0) {
-                midi_note = 36 + (15 - (period & 0x0F));
-                velocity = std::min(1.0f, amp / 15.0f);
-            }
-        } else if (ch == 4) {
-            // DMC - check if actively playing
-            if (length > 0) {
-                midi_note = 28;
-                velocity = 0.8f;  // Fixed velocity when DMC is playing
-            }
-        } else if (ch == 2) {
-            // Triangle - no volume control, just on/off
-            if (length > 0 && period >= 8) {
-                float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-                midi_note = frequencyToMidi(freq);
-                velocity = 0.8f;  // Fixed velocity for Triangle
-            }
-        } else {
-            // Square1, Square2
-            if (length > 0 && amp > 0 && period >= 8) {
-                float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-                midi_note = frequencyToMidi(freq);
-                velocity = std::min(1.0f, amp / 15.0f);
-            }
+    channels_ = layout;
+}
+
+void PianoVisualizer::updateFromChannels(const ChannelTable& table) {
+    updateKeys(table, 0, table.count);
+}
+
+void PianoVisualizer::updateKeys(const ChannelTable& table, int first, int end) {
+    // Update current notes for live keyboard display; packKey() gives 0 for silence
+    for (int ch = first; ch < std::min(end, table.count); ++ch) {
+        live_keys_[ch].store(tableKey(table, ch), std::memory_order_relaxed);
+    }
+}
+
+void PianoVisualizer::queueKeys(const ChannelTable& table, int first, int end, int64_t time) {
+    KeyFrame frame;
+    frame.time = time;
+    frame.first = first;
+    frame.end = std::min(end, table.count);
+    for (int ch = first; ch < frame.end; ++ch) frame.keys[ch] = tableKey(table, ch);
+    key_queue_.push(&frame, 1);
+}
+
+void PianoVisualizer::applyQueuedKeys(int64_t until) {
+    for (;;) {
+        if (!has_key_front_) {
+            if (key_queue_.pop(&key_front_, 1) == 0) break;
+            has_key_front_ = true;
         }
-        
-        if (midi_note >= 0 && midi_note <= 127 && velocity > 0.01f) {
-            current_notes_[ch].midi_note = midi_note;
-            current_notes_[ch].velocity = velocity;
-            current_notes_[ch].active = true;
-        } else {
-            current_notes_[ch].active = false;
+        if (key_front_.time > until) break;
+        for (int ch = key_front_.first; ch < key_front_.end; ++ch) {
+            live_keys_[ch].store(key_front_.keys[ch], std::memory_order_relaxed);
         }
+        has_key_front_ = false;
     }
 }
 
-void PianoVisualizer::updateFromVRC6(const int* periods, const int* volumes, const bool* enabled, float current_time) {
-    if (!has_vrc6_) return;
-    
-    std::lock_guard<std::mutex> lock(mutex_);
+void PianoVisualizer::updateFromChannels(const ChannelTable& table, int64_t time) {
+    if (history_reset_.exchange(false, std::memory_order_acquire)) {
+        history_note_.fill(-1);
+    }
     
-    // VRC6 channels: Pulse1 (5), Pulse2 (6), Saw (7)
-    for (int i = 0; i < PIANO_NUM_CHANNELS_VRC6; ++i) {
-        int ch = PIANO_NUM_CHANNELS_BASE + i;  // 5, 6, 7
-        int period = periods[i];
-        int volume = volumes[i];
-        bool is_enabled = enabled[i];
-        
-        int midi_note = -1;
-        float velocity = 0;
-        
-        if (is_enabled && volume > 0 && period >= 1) {
-            // VRC6 period formula: freq = CPU_CLOCK / (16 * (period + 1))
-            // Same as NES square waves
-            float freq = NES_CPU_CLOCK / (16.0f * (period + 1));
-            midi_note = frequencyToMidi(freq);
-            
-            if (i < 2) {
-                // Pulse waves - 4-bit volume (0-15)
-                velocity = std::min(1.0f, volume / 15.0f);
-            } else {
-                // Saw wave - accumulator rate (0-63)
-                velocity = std::min(1.0f, volume / 42.0f);  // Typical max is around 42
-            }
-        }
-        
-        if (midi_note >= 0 && midi_note <= 127 && velocity > 0.01f) {
-            current_notes_[ch].midi_note = midi_note;
-            current_notes_[ch].velocity = velocity;
-            current_notes_[ch].active = true;
-        } else {
-            current_notes_[ch].active = false;
+    // As processChannels(), a note ends when the channel changes note or falls silent
+    for (int ch = 0; ch < table.count; ++ch) {
+        const int midi_note = table.active[ch] ? table.note[ch] : -1;
+        const int prev_note = history_note_[ch];
+        if (midi_note == prev_note) continue;
+        if (prev_note >= 0 && prev_note <= 127) {
+            const int64_t start = live_start_[ch].load(std::memory_order_relaxed);
+            const PianoRollNote note = {ch, prev_note, history_velocity_[ch], start, time};
+            if (time - start > MIN_NOTE_TICKS) history_queue_.push(&note, 1);  // Dropped if the UI fell behind
         }
+        history_note_[ch] = midi_note;
+        history_velocity_[ch] = table.velocity[ch];
+        live_start_[ch].store(time, std::memory_order_relaxed);
     }
+    
+    // Keys last, so a key the UI sees sounding already has its start
+    std::atomic_thread_fence(std::memory_order_release);
+    updateFromChannels(table);
 }
 
+#ifndef NES_HEADLESS
 void PianoVisualizer::drawKey(ImDrawList* draw_list, ImVec2 pos, float width, float height,
                                int midi_note, bool is_black, int pressed_channel, float velocity) {
     ImU32 key_color;
     ImU32 border_color = IM_COL32(40, 40, 40, 255);
     
     if (pressed_channel >= 0 && velocity > 0.05f) {
-        key_color = PianoChannelColors[pressed_channel];
+        key_color = channels_.color[pressed_channel];
         int r = (key_color & 0xFF);
         int g = (key_color >> 8) & 0xFF;
         int b = (key_color >> 16) & 0xFF;
@@ -466,23 +665,102 @@ void PianoVisualizer::drawKey(ImDrawList* draw_list, ImVec2 pos, float width, fl
     draw_list->AddRect(pos, ImVec2(pos.x + width, pos.y + height), border_color, 2.0f);
 }
 
-void PianoVisualizer::drawPianoKeyboard(const char* label, float width, float height) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    ImDrawList* draw_list = ImGui::GetWindowDrawList();
-    ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+const PianoVisualizer::KeyLayout& PianoVisualizer::keyLayout(float canvas_width) {
+    KeyLayout& layout = key_layout_;
+    if (layout.canvas_width == canvas_width && layout.octave_low == octave_low_ &&
+        layout.octave_high == octave_high_) {
+        return layout;
+    }
     
-    int start_note = octave_low_ * 12 + 12;
-    int end_note = octave_high_ * 12 + 12;
+    layout.canvas_width = canvas_width;
+    layout.octave_low = octave_low_;
+    layout.octave_high = octave_high_;
+    layout.start_note = octave_low_ * 12 + 12;
+    layout.end_note = std::min(octave_high_ * 12 + 12, 127);
+    layout.x.fill(-1.0f);
+    layout.width.fill(0.0f);
     
     int white_key_count = 0;
-    for (int note = start_note; note <= end_note; ++note) {
+    for (int note = layout.start_note; note <= layout.end_note; ++note) {
         if (!isBlackKey(note)) white_key_count++;
     }
+    layout.white_width = canvas_width / std::max(white_key_count, 1);
+    const float black_width = layout.white_width * 0.65f;
+    
+    // Black keys straddle the line after the white key before them
+    int white_idx = 0;
+    for (int note = layout.start_note; note <= layout.end_note; ++note) {
+        if (isBlackKey(note)) {
+            layout.x[note] = white_idx * layout.white_width - black_width / 2;
+            layout.width[note] = black_width;
+        } else {
+            layout.x[note] = white_idx * layout.white_width;
+            layout.width[note] = layout.white_width - 1;
+            white_idx++;
+        }
+    }
+    return layout;
+}
+
+void PianoVisualizer::updateKeyboardCache(const ImDrawList* draw_list, float width, float height) {
+    KeyboardCache& cache = keyboard_cache_;
+    const ImVec2 uv_white = ImGui::GetFontTexUvWhitePixel();
+    if (cache.width == width && cache.height == height &&
+        cache.octave_low == octave_low_ && cache.octave_high == octave_high_ &&
+        cache.uv_white.x == uv_white.x && cache.uv_white.y == uv_white.y &&
+        cache.fringe_scale == draw_list->_FringeScale && cache.flags == draw_list->Flags) {
+        return;
+    }
+    
+    cache.width = width;
+    cache.height = height;
+    cache.octave_low = octave_low_;
+    cache.octave_high = octave_high_;
+    cache.uv_white = uv_white;
+    cache.fringe_scale = draw_list->_FringeScale;
+    cache.flags = draw_list->Flags;
     
-    float white_key_width = width / white_key_count;
+    // Tessellated with the window's settings into a scratch list
+    const KeyLayout& keys = keyLayout(width);
+    ImDrawList recorder(ImGui::GetDrawListSharedData());
+    auto record = [&](bool black, KeyMesh& mesh) {
+        recorder._ResetForNewFrame();
+        recorder.Flags = draw_list->Flags;
+        recorder._FringeScale = draw_list->_FringeScale;
+        for (int note = keys.start_note; note <= keys.end_note; ++note) {
+            if (isBlackKey(note) != black) continue;
+            drawKey(&recorder, ImVec2(keys.x[note], 0.0f), keys.width[note],
+                    black ? height * 0.6f : height, note, black, -1, 0.0f);
+        }
+        mesh.vtx.assign(recorder.VtxBuffer.begin(), recorder.VtxBuffer.end());
+        mesh.idx.assign(recorder.IdxBuffer.begin(), recorder.IdxBuffer.end());
+    };
+    record(false, cache.white_keys);
+    record(true, cache.black_keys);
+}
+
+void PianoVisualizer::appendMesh(ImDrawList* draw_list, const KeyMesh& mesh, ImVec2 offset) {
+    if (mesh.idx.empty()) return;
+    draw_list->PrimReserve(static_cast<int>(mesh.idx.size()), static_cast<int>(mesh.vtx.size()));
+    const ImDrawIdx base = static_cast<ImDrawIdx>(draw_list->_VtxCurrentIdx);
+    for (const ImDrawVert& v : mesh.vtx) {
+        *draw_list->_VtxWritePtr++ = {ImVec2(v.pos.x + offset.x, v.pos.y + offset.y), v.uv, v.col};
+    }
+    for (ImDrawIdx i : mesh.idx) {
+        *draw_list->_IdxWritePtr++ = static_cast<ImDrawIdx>(base + i);
+    }
+    draw_list->_VtxCurrentIdx += static_cast<unsigned int>(mesh.vtx.size());
+}
+
+void PianoVisualizer::drawPianoKeyboard(const char* label, float width, float height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+    
+    const KeyLayout& keys = keyLayout(width);
+    updateKeyboardCache(draw_list, width, height);
     float white_key_height = height;
-    float black_key_width = white_key_width * 0.65f;
     float black_key_height = height * 0.6f;
     
     // Build map of pressed keys
@@ -491,60 +769,237 @@ void PianoVisualizer::drawPianoKeyboard(const char* label, float width, float he
     note_channel.fill(-1);
     note_velocity.fill(0.0f);
     
-    for (int ch = 0; ch < getActiveChannelCount(); ++ch) {
-        if (current_notes_[ch].active && current_notes_[ch].midi_note >= 0 && 
-            current_notes_[ch].midi_note < 128) {
-            int note = current_notes_[ch].midi_note;
-            if (note_channel[note] < 0 || current_notes_[ch].velocity > note_velocity[note]) {
+    for (int ch = 0; ch < channels_.count; ++ch) {
+        const uint32_t key = live_keys_[ch].load(std::memory_order_relaxed);
+        if (key & 0x100u) {
+            int note = key & 0x7F;
+            float velocity = (key >> 16) / 65535.0f;
+            if (note_channel[note] < 0 || velocity > note_velocity[note]) {
                 note_channel[note] = ch;
-                note_velocity[note] = current_notes_[ch].velocity;
+                note_velocity[note] = velocity;
             }
         }
     }
     
-    // Draw white keys
-    int white_key_idx = 0;
-    for (int note = start_note; note <= end_note; ++note) {
-        if (!isBlackKey(note)) {
-            ImVec2 key_pos(canvas_pos.x + white_key_idx * white_key_width, canvas_pos.y);
-            drawKey(draw_list, key_pos, white_key_width - 1, white_key_height,
-                   note, false, note_channel[note], note_velocity[note]);
-            white_key_idx++;
-        }
-    }
-    
-    // Draw black keys
-    white_key_idx = 0;
-    for (int note = start_note; note <= end_note; ++note) {
-        if (!isBlackKey(note)) {
-            if (note + 1 <= end_note && isBlackKey(note + 1)) {
-                float black_x = canvas_pos.x + white_key_idx * white_key_width + 
-                               white_key_width - black_key_width / 2;
-                ImVec2 key_pos(black_x, canvas_pos.y);
-                drawKey(draw_list, key_pos, black_key_width, black_key_height,
-                       note + 1, true, note_channel[note + 1], note_velocity[note + 1]);
-            }
-            white_key_idx++;
+    // Draw white keys, then the black ones over them; only pressed keys are tessellated
+    auto draw_pressed = [&](bool black, float key_height) {
+        for (int note = keys.start_note; note <= keys.end_note; ++note) {
+            if (isBlackKey(note) != black || note_channel[note] < 0 || note_velocity[note] <= 0.05f) continue;
+            ImVec2 key_pos(canvas_pos.x + keys.x[note], canvas_pos.y);
+            drawKey(draw_list, key_pos, keys.width[note], key_height,
+                   note, black, note_channel[note], note_velocity[note]);
         }
-    }
+    };
+    appendMesh(draw_list, keyboard_cache_.white_keys, canvas_pos);
+    draw_pressed(false, white_key_height);
+    appendMesh(draw_list, keyboard_cache_.black_keys, canvas_pos);
+    draw_pressed(true, black_key_height);
     
     // Draw octave labels
-    white_key_idx = 0;
-    for (int note = start_note; note <= end_note; ++note) {
-        if (!isBlackKey(note) && getNoteInOctave(note) == 0) {
-            float label_x = canvas_pos.x + white_key_idx * white_key_width + 2;
+    for (int note = keys.start_note; note <= keys.end_note; ++note) {
+        if (getNoteInOctave(note) == 0) {
+            float label_x = canvas_pos.x + keys.x[note] + 2;
             float label_y = canvas_pos.y + white_key_height - 14;
             char octave_label[8];
             snprintf(octave_label, sizeof(octave_label), "C%d", getOctave(note));
             draw_list->AddText(ImVec2(label_x, label_y), IM_COL32(100, 100, 100, 255), octave_label);
         }
-        if (!isBlackKey(note)) white_key_idx++;
     }
     
     ImGui::Dummy(ImVec2(width, height));
 }
 
-void PianoVisualizer::drawPianoRoll(const char* label, float width, float height, float current_time) {
+namespace {
+
+struct SpriteShape {
+    float radius;  // Corner rounding in texels, the ImDrawList rounding it replaces
+    int margin;    // Corner slice in texels, covers the rounding and its AA edge
+    bool outline;  // A 1-texel stroke instead of a fill
+};
+const SpriteShape SPRITE_SHAPES[] = {
+    {3.0f, 4, false},  // SPRITE_FILL
+    {3.0f, 4, true},   // SPRITE_OUTLINE
+    {5.0f, 6, false},  // SPRITE_GLOW
+};
+
+// Signed distance from (x, y) to a rounded rect spanning [0, size]
+float roundedRectDistance(float x, float y, float size, float radius) {
+    const float half = size * 0.5f;
+    const float qx = std::abs(x - half) - (half - radius);
+    const float qy = std::abs(y - half) - (half - radius);
+    const float outside = std::sqrt(std::max(qx, 0.0f) * std::max(qx, 0.0f) + std::max(qy, 0.0f) * std::max(qy, 0.0f));
+    return outside + std::min(std::max(qx, qy), 0.0f) - radius;
+}
+
+}  // namespace
+
+void PianoVisualizer::rasterizeNoteSprites(std::vector<uint32_t>& pixels) {
+    const int width = SPRITE_STRIDE * SPRITE_COUNT;
+    pixels.assign(static_cast<size_t>(width) * SPRITE_STRIDE, 0);
+    const int pad = (SPRITE_STRIDE - SPRITE_SIZE) / 2;
+    for (int s = 0; s < SPRITE_COUNT; ++s) {
+        const SpriteShape& shape = SPRITE_SHAPES[s];
+        for (int y = 0; y < SPRITE_STRIDE; ++y) {
+            for (int x = 0; x < SPRITE_STRIDE; ++x) {
+                // The padding repeats the edge texels, so filtering never reaches a neighbour
+                const float cx = std::clamp(x - pad, 0, SPRITE_SIZE - 1) + 0.5f;
+                const float cy = std::clamp(y - pad, 0, SPRITE_SIZE - 1) + 0.5f;
+                float coverage;
+                if (shape.outline) {
+                    // As AddRect: a 1 px stroke on the outline inset by half a pixel
+                    const float d = roundedRectDistance(cx - 0.5f, cy - 0.5f, SPRITE_SIZE - 1.0f, shape.radius - 0.5f);
+                    coverage = std::clamp(1.0f - std::abs(d), 0.0f, 1.0f);
+                } else {
+                    coverage = std::clamp(0.5f - roundedRectDistance(cx, cy, SPRITE_SIZE, shape.radius), 0.0f, 1.0f);
+                }
+                // White, tinted by the vertex colour
+                const uint32_t alpha = static_cast<uint32_t>(coverage * 255.0f + 0.5f);
+                pixels[static_cast<size_t>(y) * width + s * SPRITE_STRIDE + x] = (alpha << 24) | 0x00FFFFFFu;
+            }
+        }
+    }
+}
+
+void PianoVisualizer::createNoteTexture() {
+    if (note_texture_created_) return;
+    
+    std::vector<uint32_t> pixels;
+    rasterizeNoteSprites(pixels);
+    
+    // Immutable: uploaded once with its contents
+    sg_image_desc img_desc = {};
+    img_desc.width = SPRITE_STRIDE * SPRITE_COUNT;
+    img_desc.height = SPRITE_STRIDE;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    img_desc.data.mip_levels[0].ptr = pixels.data();
+    img_desc.data.mip_levels[0].size = pixels.size() * sizeof(uint32_t);
+    
+    note_texture_ = sg_make_image(&img_desc);
+    
+    sg_sampler_desc smp_desc = {};
+    smp_desc.min_filter = SG_FILTER_LINEAR;
+    smp_desc.mag_filter = SG_FILTER_LINEAR;
+    smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    
+    note_sampler_ = sg_make_sampler(&smp_desc);
+    
+    sg_view_desc view_desc = {};
+    view_desc.texture.image = note_texture_;
+    
+    note_view_ = sg_make_view(&view_desc);
+    
+    note_texture_created_ = true;
+}
+
+void PianoVisualizer::updateOverviewTexture(const std::shared_ptr<const NoteData>& data, int lanes,
+                                            const std::array<ImU32, ChannelTable::MAX_CHANNELS>& colors) {
+    if (!overview_texture_created_) {
+        // Dynamic: rewritten on a new track or prefix, a handful of times a track
+        sg_image_desc img_desc = {};
+        img_desc.width = OVERVIEW_COLUMNS;
+        img_desc.height = ChannelTable::MAX_CHANNELS;
+        img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+        img_desc.usage.dynamic_update = true;
+        overview_texture_ = sg_make_image(&img_desc);
+        
+        // Nearest, so lanes never bleed into each other
+        sg_sampler_desc smp_desc = {};
+        smp_desc.min_filter = SG_FILTER_NEAREST;
+        smp_desc.mag_filter = SG_FILTER_NEAREST;
+        smp_desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+        smp_desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+        overview_sampler_ = sg_make_sampler(&smp_desc);
+        
+        sg_view_desc view_desc = {};
+        view_desc.texture.image = overview_texture_;
+        overview_view_ = sg_make_view(&view_desc);
+        overview_texture_created_ = true;
+        overview_data_.reset();
+    }
+    if (data == overview_data_ && lanes == overview_lanes_ && colors == overview_colors_) return;
+    overview_data_ = data;
+    overview_lanes_ = lanes;
+    overview_colors_ = colors;
+    
+    // Silent cells clear; the quietest sound is still visible, as the roll's notes are
+    overview_pixels_.assign(static_cast<size_t>(OVERVIEW_COLUMNS) * ChannelTable::MAX_CHANNELS, 0);
+    for (int lane = 0; lane < lanes; ++lane) {
+        const uint8_t* row = &data->overview[static_cast<size_t>(lane) * OVERVIEW_COLUMNS];
+        uint32_t* out = &overview_pixels_[static_cast<size_t>(lane) * OVERVIEW_COLUMNS];
+        const ImU32 rgb = colors[lane] & ~IM_COL32_A_MASK;
+        for (int c = 0; c < OVERVIEW_COLUMNS; ++c) {
+            if (row[c] == 0) continue;
+            const ImU32 alpha = static_cast<ImU32>(60 + row[c] * 195 / 255);
+            out[c] = rgb | (alpha << IM_COL32_A_SHIFT);
+        }
+    }
+    sg_image_data img_data = {};
+    img_data.mip_levels[0].ptr = overview_pixels_.data();
+    img_data.mip_levels[0].size = overview_pixels_.size() * sizeof(uint32_t);
+    sg_update_image(overview_texture_, &img_data);
+}
+
+void PianoVisualizer::destroyTextures() {
+    if (note_texture_created_) {
+        sg_destroy_view(note_view_);
+        sg_destroy_sampler(note_sampler_);
+        sg_destroy_image(note_texture_);
+        note_texture_created_ = false;
+    }
+    if (overview_texture_created_) {
+        sg_destroy_view(overview_view_);
+        sg_destroy_sampler(overview_sampler_);
+        sg_destroy_image(overview_texture_);
+        overview_texture_created_ = false;
+        overview_data_.reset();
+    }
+}
+
+void PianoVisualizer::appendNoteSprite(ImDrawList* draw_list, NoteSprite sprite, ImVec2 p_min, ImVec2 p_max,
+                                       ImU32 color) const {
+    // Corners keep their texel size; a note smaller than two corners squeezes them
+    const float atlas_w = static_cast<float>(SPRITE_STRIDE * SPRITE_COUNT);
+    const float atlas_h = static_cast<float>(SPRITE_STRIDE);
+    const int pad = (SPRITE_STRIDE - SPRITE_SIZE) / 2;
+    const float margin = static_cast<float>(SPRITE_SHAPES[sprite].margin);
+    const float mx = std::min(margin, (p_max.x - p_min.x) * 0.5f);
+    const float my = std::min(margin, (p_max.y - p_min.y) * 0.5f);
+    
+    const float x[4] = {p_min.x, p_min.x + mx, p_max.x - mx, p_max.x};
+    const float y[4] = {p_min.y, p_min.y + my, p_max.y - my, p_max.y};
+    const float u0 = static_cast<float>(sprite * SPRITE_STRIDE + pad);
+    const float u[4] = {u0 / atlas_w, (u0 + mx) / atlas_w, (u0 + SPRITE_SIZE - mx) / atlas_w, (u0 + SPRITE_SIZE) / atlas_w};
+    const float v[4] = {pad / atlas_h, (pad + my) / atlas_h, (pad + SPRITE_SIZE - my) / atlas_h, (pad + SPRITE_SIZE) / atlas_h};
+    
+    draw_list->PrimReserve(9 * 6, 16);
+    const ImDrawIdx base = static_cast<ImDrawIdx>(draw_list->_VtxCurrentIdx);
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 4; ++col) {
+            *draw_list->_VtxWritePtr++ = {ImVec2(x[col], y[row]), ImVec2(u[col], v[row]), color};
+        }
+    }
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            const ImDrawIdx i = static_cast<ImDrawIdx>(base + row * 4 + col);
+            const ImDrawIdx quad[6] = {i, static_cast<ImDrawIdx>(i + 1), static_cast<ImDrawIdx>(i + 5),
+                                       i, static_cast<ImDrawIdx>(i + 5), static_cast<ImDrawIdx>(i + 4)};
+            for (ImDrawIdx q : quad) *draw_list->_IdxWritePtr++ = q;
+        }
+    }
+    draw_list->_VtxCurrentIdx += 16;
+}
+
+void PianoVisualizer::appendNoteBar(ImDrawList* draw_list, ImVec2 p_min, ImVec2 p_max, ImU32 color) const {
+    // The middle of the fill sprite is solid
+    const ImVec2 uv((SPRITE_FILL * SPRITE_STRIDE + SPRITE_STRIDE * 0.5f) / (SPRITE_STRIDE * SPRITE_COUNT), 0.5f);
+    draw_list->PrimReserve(6, 4);
+    draw_list->PrimRectUV(p_min, p_max, uv, uv, color);
+}
+
+void PianoVisualizer::drawPianoRoll(const char* label, float width, float height, int64_t current_time) {
+    FrameProfiler::Scope profile_scope(FrameProfiler::PIANO_ROLL);
+    FC_ZONE("drawPianoRoll");
     std::lock_guard<std::mutex> lock(mutex_);
     
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
@@ -555,32 +1010,22 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
                             ImVec2(canvas_pos.x + width, canvas_pos.y + height),
                             IM_COL32(20, 20, 28, 255));
     
-    int start_note = octave_low_ * 12 + 12;
-    int end_note = octave_high_ * 12 + 12;
-    
-    // Count white keys
-    int white_key_count = 0;
-    for (int note = start_note; note <= end_note; ++note) {
-        if (!isBlackKey(note)) white_key_count++;
-    }
-    
-    float white_key_width = width / white_key_count;
-    float black_key_width = white_key_width * 0.65f;
+    const KeyLayout& keys = keyLayout(width);
     
     // Time range: show FUTURE notes (current_time at bottom, future at top)
-    float time_end = current_time + piano_roll_seconds_;
+    current_time = std::max<int64_t>(0, current_time);
+    const int64_t time_end = current_time + NoteClock::fromSeconds(piano_roll_seconds_);
     float pixels_per_second = height / piano_roll_seconds_;
     
     // Draw lane backgrounds
-    int white_key_idx = 0;
-    for (int note = start_note; note <= end_note; ++note) {
+    for (int note = keys.start_note; note <= keys.end_note; ++note) {
         if (!isBlackKey(note)) {
-            float x = canvas_pos.x + white_key_idx * white_key_width;
+            float x = canvas_pos.x + keys.x[note];
             ImU32 lane_color = (getNoteInOctave(note) == 0) ? 
                 IM_COL32(35, 35, 45, 255) : IM_COL32(28, 28, 36, 255);
             draw_list->AddRectFilled(
                 ImVec2(x, canvas_pos.y),
-                ImVec2(x + white_key_width, canvas_pos.y + height),
+                ImVec2(x + keys.white_width, canvas_pos.y + height),
                 lane_color
             );
             draw_list->AddLine(
@@ -588,17 +1033,24 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
                 ImVec2(x, canvas_pos.y + height),
                 IM_COL32(50, 50, 60, 255)
             );
-            white_key_idx++;
         }
     }
     
-    // Draw time grid lines
-    float time_grid = 0.5f;
-    float grid_start = std::floor(current_time / time_grid) * time_grid;
-    for (float t = grid_start; t <= time_end; t += time_grid) {
-        if (t < current_time) continue;
-        // Y: bottom = current_time, top = time_end
-        float y = canvas_pos.y + height - (t - current_time) * pixels_per_second;
+    // Without preprocessed notes the roll shows the live history instead,
+    // scrolling up from the keyboard
+    auto data = loadNotes();
+    
+    // Draw time grid lines, at multiples of time_grid; phase is how far
+    // current_time is past the last one
+    const float time_grid = 0.5f;
+    const float phase = static_cast<float>(
+        std::fmod(static_cast<double>(current_time), time_grid * static_cast<double>(NoteClock::RATE)) / NoteClock::RATE);
+    for (float t = 0.0f; t - phase <= piano_roll_seconds_; t += time_grid) {
+        if (data && t < phase) continue;
+        // Y: bottom = current_time, top = time_end; the history's lines are
+        // the same multiples counted back
+        const float offset = data ? t - phase : phase + t;
+        float y = canvas_pos.y + height - offset * pixels_per_second;
         if (y >= canvas_pos.y && y <= canvas_pos.y + height) {
             draw_list->AddLine(
                 ImVec2(canvas_pos.x, y),
@@ -608,37 +1060,44 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
         }
     }
     
-    // Helper to get X position for a note
-    auto getNoteX = [&](int midi_note) -> std::pair<float, float> {
-        if (midi_note < start_note || midi_note > end_note) 
-            return {-1, -1};
+    // Draw notes from preprocessed data
+    if (!data) {
+        drawHistory(draw_list, canvas_pos, height, current_time, keys);
+    } else {
+        createNoteTexture();
+        draw_list->PushTexture(simgui_imtextureid_with_sampler(note_view_, note_sampler_));
+        data->notesBetween(current_time, time_end, visible_notes_);
+        const int64_t glow_end = current_time + NoteClock::RATE / 10;
         
-        int white_idx = 0;
-        for (int n = start_note; n < midi_note; ++n) {
-            if (!isBlackKey(n)) white_idx++;
-        }
+        // Notes under a pixel tall join their lane's run and are drawn as one
+        // bar, so zoomed out the vertices follow the canvas, not the notes
+        struct LaneRun {
+            float y1 = 0.0f;
+            float y2 = -1.0f;  // Empty while y2 < y1
+            ImU32 color = 0;
+        };
+        std::array<LaneRun, 128> runs;
+        auto flush_run = [&](int midi_note) {
+            LaneRun& run = runs[midi_note];
+            if (run.y2 < run.y1) return;
+            const float note_x = canvas_pos.x + keys.x[midi_note];
+            const float mid = (run.y1 + run.y2) * 0.5f;
+            appendNoteBar(draw_list, ImVec2(note_x + 1, std::min(run.y1, mid - 0.5f)),
+                          ImVec2(note_x + keys.width[midi_note] - 1, std::max(run.y2, mid + 0.5f)), run.color);
+            run.y2 = run.y1 - 1.0f;
+        };
         
-        if (isBlackKey(midi_note)) {
-            float x = canvas_pos.x + white_idx * white_key_width - black_key_width / 2;
-            return {x, black_key_width};
-        } else {
-            float x = canvas_pos.x + white_idx * white_key_width;
-            return {x, white_key_width - 1};
-        }
-    };
-    
-    // Draw notes from preprocessed data
-    if (has_preprocessed_data_) {
-        for (const auto& note : preprocessed_notes_) {
+        for (uint32_t index : visible_notes_) {
+            const PianoRollNote note = data->note(index);
             // Only show notes in the visible time window
-            if (note.end_time < current_time || note.start_time > time_end) continue;
-            if (note.midi_note < start_note || note.midi_note > end_note) continue;
+            if (note.end < current_time || note.start > time_end) continue;
+            if (note.midi_note < keys.start_note || note.midi_note > keys.end_note) continue;
             
             // Y positions: bottom = current_time, top = future
-            // note.start_time -> y2 (note starts, appears from top)
-            // note.end_time -> y1 (note ends, reaches bottom and disappears)
-            float y_start = canvas_pos.y + height - (note.start_time - current_time) * pixels_per_second;
-            float y_end = canvas_pos.y + height - (note.end_time - current_time) * pixels_per_second;
+            // note.start -> y2 (note starts, appears from top)
+            // note.end -> y1 (note ends, reaches bottom and disappears)
+            float y_start = canvas_pos.y + height - NoteClock::between(current_time, note.start) * pixels_per_second;
+            float y_end = canvas_pos.y + height - NoteClock::between(current_time, note.end) * pixels_per_second;
             
             // y1 is top (smaller Y, earlier/end), y2 is bottom (larger Y, later/start)
             float y1 = std::max(y_end, canvas_pos.y);
@@ -646,36 +1105,60 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
             
             if (y2 <= y1) continue;
             
-            auto [note_x, note_width] = getNoteX(note.midi_note);
-            if (note_x < 0) continue;
+            float note_x = canvas_pos.x + keys.x[note.midi_note];
+            float note_width = keys.width[note.midi_note];
+            
+            ImU32 note_color = (channels_.color[note.channel] & 0x00FFFFFF) | 0xDC000000;  // Alpha 220
             
-            ImU32 note_color = PianoChannelColors[note.channel];
+            if (y2 - y1 < note_merge_pixels_) {
+                LaneRun& run = runs[note.midi_note];
+                if (run.y2 >= run.y1 && y2 >= run.y1 - 1.0f && y1 <= run.y2 + 1.0f) {
+                    run.y1 = std::min(run.y1, y1);
+                    run.y2 = std::max(run.y2, y2);
+                    continue;
+                }
+                flush_run(note.midi_note);
+                run = {y1, y2, note_color};
+                continue;
+            }
+            
+            // Outline and glow would cover a short note; a plain bar reads better
+            if (y2 - y1 < note_detail_pixels_) {
+                appendNoteBar(draw_list, ImVec2(note_x + 1, y1), ImVec2(note_x + note_width - 1, y2), note_color);
+                continue;
+            }
             
             // Glow effect for notes about to be played
-            bool about_to_play = (note.start_time <= current_time + 0.1f && note.start_time >= current_time);
-            if (about_to_play) {
+            bool about_to_play = (note.start <= glow_end && note.start >= current_time);
+            if (about_to_play && note_glow_) {
                 ImU32 glow_color = note_color & 0x00FFFFFF;
                 glow_color |= 0x60000000;
-                draw_list->AddRectFilled(
+                appendNoteSprite(draw_list, SPRITE_GLOW,
                     ImVec2(note_x - 3, y1 - 3),
                     ImVec2(note_x + note_width + 3, y2 + 3),
-                    glow_color, 5.0f
+                    glow_color
                 );
             }
             
             // Draw note
-            draw_list->AddRectFilled(
+            appendNoteSprite(draw_list, SPRITE_FILL,
                 ImVec2(note_x + 1, y1),
                 ImVec2(note_x + note_width - 1, y2),
-                note_color, 3.0f
+                note_color
             );
             
-            draw_list->AddRect(
-                ImVec2(note_x + 1, y1),
-                ImVec2(note_x + note_width - 1, y2),
-                IM_COL32(255, 255, 255, 80), 3.0f
-            );
+            if (note_outline_) {
+                appendNoteSprite(draw_list, SPRITE_OUTLINE,
+                    ImVec2(note_x + 1, y1),
+                    ImVec2(note_x + note_width - 1, y2),
+                    IM_COL32(255, 255, 255, 80)
+                );
+            }
+        }
+        for (int midi_note = keys.start_note; midi_note <= keys.end_note; ++midi_note) {
+            flush_run(midi_note);
         }
+        draw_list->PopTexture();
     }
     
     // Draw hit line at bottom
@@ -693,7 +1176,119 @@ void PianoVisualizer::drawPianoRoll(const char* label, float width, float height
     ImGui::Dummy(ImVec2(width, height));
 }
 
-void PianoVisualizer::drawPianoWindow(bool* p_open, float current_time) {
+void PianoVisualizer::drawHistory(ImDrawList* draw_list, ImVec2 canvas_pos, float height, int64_t current_time,
+                                  const KeyLayout& keys) {
+    // A clock that went back (a reset) leaves nothing to show
+    if (current_time < history_time_) {
+        history_queue_.discard();
+        history_count_ = 0;
+    }
+    history_time_ = current_time;
+    
+    // Ended notes into the ring, one at a time, the oldest overwritten
+    while (history_queue_.pop(&history_[history_next_], 1) == 1) {
+        history_next_ = (history_next_ + 1) % HISTORY_CAPACITY;
+        history_count_ = std::min(history_count_ + 1, HISTORY_CAPACITY);
+    }
+    
+    // Y: bottom = current_time, top = piano_roll_seconds_ ago
+    const float pixels_per_second = height / piano_roll_seconds_;
+    const int64_t oldest = current_time - NoteClock::fromSeconds(piano_roll_seconds_);
+    auto draw_note = [&](int channel, int midi_note, int64_t start_time, int64_t end_time) {
+        if (end_time < oldest || start_time > current_time) return;
+        if (midi_note < keys.start_note || midi_note > keys.end_note || channel >= channels_.count) return;
+        const float y1 = std::max(canvas_pos.y + height - NoteClock::between(start_time, current_time) * pixels_per_second,
+                                  canvas_pos.y);
+        const float y2 = std::min(canvas_pos.y + height - NoteClock::between(end_time, current_time) * pixels_per_second,
+                                  canvas_pos.y + height);
+        if (y2 <= y1) return;
+        const float note_x = canvas_pos.x + keys.x[midi_note];
+        const float note_width = keys.width[midi_note];
+        const ImU32 note_color = (channels_.color[channel] & 0x00FFFFFF) | 0xA0000000;  // Dimmer than the notes ahead
+        appendNoteSprite(draw_list, SPRITE_FILL, ImVec2(note_x + 1, y1), ImVec2(note_x + note_width - 1, y2), note_color);
+        appendNoteSprite(draw_list, SPRITE_OUTLINE, ImVec2(note_x + 1, y1), ImVec2(note_x + note_width - 1, y2),
+                         IM_COL32(255, 255, 255, 60));
+    };
+    
+    createNoteTexture();
+    draw_list->PushTexture(simgui_imtextureid_with_sampler(note_view_, note_sampler_));
+    for (size_t k = 1; k <= history_count_; ++k) {
+        const PianoRollNote& note = history_[(history_next_ + HISTORY_CAPACITY - k) % HISTORY_CAPACITY];
+        draw_note(note.channel, note.midi_note, note.start, note.end);
+    }
+    
+    // Notes still sounding reach down to the keyboard
+    for (int ch = 0; ch < ChannelTable::MAX_CHANNELS; ++ch) {
+        const uint32_t key = live_keys_[ch].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (key & 0x100u) {
+            draw_note(ch, static_cast<int>(key & 0xFF), live_start_[ch].load(std::memory_order_relaxed), current_time);
+        }
+    }
+    draw_list->PopTexture();
+}
+
+void PianoVisualizer::drawOverview(const char* label, float width, float height, int64_t current_time) {
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    const ImVec2 canvas_pos = ImGui::GetCursorScreenPos();
+    const float canvas_width = std::max(1.0f, width);
+    ImGui::InvisibleButton(label, ImVec2(canvas_width, height));
+    
+    draw_list->AddRectFilled(canvas_pos, ImVec2(canvas_pos.x + canvas_width, canvas_pos.y + height),
+                             IM_COL32(20, 20, 28, 255));
+    auto data = loadNotes();
+    if (!data || data->overview.empty() || data->duration <= 0) return;
+    const float duration = static_cast<float>(NoteClock::toSeconds(data->duration));
+    
+    int lanes;
+    std::array<ImU32, ChannelTable::MAX_CHANNELS> colors;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lanes = channels_.count;
+        std::copy(channels_.color.begin(), channels_.color.end(), colors.begin());
+    }
+    lanes = std::min(lanes, ChannelTable::MAX_CHANNELS);
+    if (lanes <= 0) return;
+    
+    // One quad whatever the track or canvas: a texel per column and lane,
+    // lines between the lanes
+    updateOverviewTexture(data, lanes, colors);
+    const float texture_rows = static_cast<float>(ChannelTable::MAX_CHANNELS);
+    draw_list->AddImage(simgui_imtextureid_with_sampler(overview_view_, overview_sampler_), canvas_pos,
+                        ImVec2(canvas_pos.x + canvas_width, canvas_pos.y + height), ImVec2(0.0f, 0.0f),
+                        ImVec2(1.0f, lanes / texture_rows));
+    const float lane_height = height / lanes;
+    for (int lane = 1; lane < lanes; ++lane) {
+        const float y = canvas_pos.y + lane * lane_height;
+        draw_list->AddLine(ImVec2(canvas_pos.x, y), ImVec2(canvas_pos.x + canvas_width, y), IM_COL32(20, 20, 28, 255));
+    }
+    
+    // Playback position
+    const float played = static_cast<float>(static_cast<double>(current_time) / data->duration);
+    const float cursor_x = canvas_pos.x + std::clamp(played, 0.0f, 1.0f) * canvas_width;
+    draw_list->AddLine(ImVec2(cursor_x, canvas_pos.y), ImVec2(cursor_x, canvas_pos.y + height),
+                       IM_COL32(255, 255, 255, 220), 2.0f);
+    
+    // Seek on the click and while dragging
+    const ImGuiIO& io = ImGui::GetIO();
+    if (ImGui::IsItemActivated() || (ImGui::IsItemActive() && io.MouseDelta.x != 0.0f)) {
+        const float fraction = std::clamp((io.MousePos.x - canvas_pos.x) / canvas_width, 0.0f, 1.0f);
+        seek_request_ = fraction * duration;
+    }
+    if (ImGui::IsItemHovered()) {
+        const float hover = std::clamp((io.MousePos.x - canvas_pos.x) / canvas_width, 0.0f, 1.0f) * duration;
+        ImGui::SetTooltip("%d:%02d", static_cast<int>(hover) / 60, static_cast<int>(hover) % 60);
+    }
+}
+
+bool PianoVisualizer::takeSeekRequest(float& seconds) {
+    if (seek_request_ < 0.0f) return false;
+    seconds = seek_request_;
+    seek_request_ = -1.0f;
+    return true;
+}
+
+void PianoVisualizer::drawPianoWindow(bool* p_open, int64_t current_time) {
     ImGui::SetNextWindowSize(ImVec2(900, 500), ImGuiCond_FirstUseEver);
     
     if (!ImGui::Begin("Piano Visualizer", p_open)) {
@@ -705,21 +1300,24 @@ void PianoVisualizer::drawPianoWindow(bool* p_open, float current_time) {
     float available_height = ImGui::GetContentRegionAvail().y;
     
     // Status and legend
-    if (has_preprocessed_data_) {
+    if (auto data = loadNotes()) {
         ImGui::TextColored(ImVec4(0.3f, 1.0f, 0.3f, 1.0f), "Ready");
         ImGui::SameLine();
-        ImGui::Text("(%.1fs)", track_duration_);
+        ImGui::Text("(%.1fs)", NoteClock::toSeconds(data->duration));
     } else {
         ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.3f, 1.0f), "No data - load a track to preprocess");
     }
     
     ImGui::SameLine(150);
-    for (int i = 0; i < getActiveChannelCount(); ++i) {
-        ImVec4 color = ImGui::ColorConvertU32ToFloat4(PianoChannelColors[i]);
-        ImGui::ColorButton(PianoChannelNames[i], color, ImGuiColorEditFlags_NoTooltip, ImVec2(16, 14));
-        ImGui::SameLine();
-        ImGui::Text("%s", PianoChannelNames[i]);
-        ImGui::SameLine();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);  // Preprocessing may be replacing the layout
+        for (int i = 0; i < channels_.count; ++i) {
+            ImVec4 color = ImGui::ColorConvertU32ToFloat4(channels_.color[i]);
+            ImGui::ColorButton(channels_.short_name[i], color, ImGuiColorEditFlags_NoTooltip, ImVec2(16, 14));
+            ImGui::SameLine();
+            ImGui::Text("%s", channels_.short_name[i]);
+            ImGui::SameLine();
+        }
     }
     
     ImGui::SameLine(available_width - 280);
@@ -738,13 +1336,20 @@ void PianoVisualizer::drawPianoWindow(bool* p_open, float current_time) {
     
     // Calculate sizes
     float keyboard_height = 90;
-    float roll_height = available_height - keyboard_height - 30;
+    float overview_height = 24;
+    float roll_height = available_height - keyboard_height - overview_height - 34;
     
     // Piano roll (future notes falling down)
+    FrameProfiler::beginGpuDraw(ImGui::GetWindowDrawList(), FrameProfiler::GPU_PIANO_ROLL);
     drawPianoRoll("##roll", available_width, roll_height, current_time);
+    FrameProfiler::endGpuDraw(ImGui::GetWindowDrawList(), FrameProfiler::GPU_PIANO_ROLL);
     
     // Keyboard (at bottom)
     drawPianoKeyboard("##keyboard", available_width, keyboard_height);
     
+    // Whole track, under the keyboard
+    drawOverview("##overview", available_width, overview_height, current_time);
+    
     ImGui::End();
 }
+#endif
@@ -1,24 +1,41 @@
 #pragma once
 
+// NES_HEADLESS builds (nsf_analyze) keep the note engine only: there is
+// no sokol_gfx, and nothing is drawn
 #include "imgui.h"
+#ifndef NES_HEADLESS
+#include "sokol_gfx.h"
+#endif
+#include "ChannelRegistry.h"
+#include "SpscRing.h"
+#include "MemoryReport.h"
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <array>
+#include <atomic>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <cmath>
 #include <functional>
 
 // Forward declarations
 struct Music_Emu;
-class Nes_Apu;
-class Nes_Vrc6_Apu;
-
-// NES APU channel info for piano visualization
-struct NesNoteInfo {
-    int channel;        // 0-7: Square1, Square2, Triangle, Noise, DMC, VRC6_Pulse1, VRC6_Pulse2, VRC6_Saw
-    int midi_note;      // MIDI note number (0-127)
-    float velocity;     // 0.0 - 1.0
-    bool active;        // Is the note currently playing
+
+// Note times are 64-bit ticks of the NES CPU clock, for every source: the
+// emulator's cycles as they are, sample positions scaled from their own
+// rate. Notes and the playback position compare exactly however long a
+// session runs; only a distance from the playback position goes to float,
+// for drawing.
+struct NoteClock {
+    static constexpr int64_t RATE = 1789773;  // Ticks a second, ChannelTable::NES_CPU_CLOCK
+    
+    static constexpr int64_t fromFrames(int64_t frames, long sample_rate) { return frames * RATE / sample_rate; }
+    static int64_t fromSeconds(double seconds) { return std::llround(seconds * RATE); }
+    static constexpr double toSeconds(int64_t ticks) { return static_cast<double>(ticks) / RATE; }
+    // Seconds from one time to another
+    static constexpr float between(int64_t from, int64_t to) { return static_cast<float>(toSeconds(to - from)); }
 };
 
 // Piano roll note event (preprocessed)
@@ -26,35 +43,63 @@ struct PianoRollNote {
     int channel;
     int midi_note;
     float velocity;
-    float start_time;   // In seconds
-    float end_time;     // In seconds (when note ends)
+    int64_t start;  // NoteClock ticks
+    int64_t end;    // NoteClock ticks (when note ends)
 };
 
-// Maximum channel count (base APU + VRC6)
-constexpr int PIANO_NUM_CHANNELS_BASE = 5;
-constexpr int PIANO_NUM_CHANNELS_VRC6 = 3;
-constexpr int PIANO_NUM_CHANNELS_MAX = 8;
-
-// Channel colors for piano visualization
-inline const ImU32 PianoChannelColors[] = {
-    IM_COL32(255, 80, 80, 220),   // Square 1 - Red
-    IM_COL32(255, 160, 60, 220),  // Square 2 - Orange
-    IM_COL32(80, 180, 255, 220),  // Triangle - Blue
-    IM_COL32(230, 80, 230, 220),  // Noise - Magenta
-    IM_COL32(230, 230, 80, 220),  // DMC - Yellow
-    IM_COL32(60, 230, 130, 220),  // VRC6 Pulse1 - Green
-    IM_COL32(100, 230, 180, 220), // VRC6 Pulse2 - Light Green
-    IM_COL32(150, 100, 230, 220)  // VRC6 Saw - Purple
+// Note data of one preprocessed track
+struct PreprocessedTrack {
+    static constexpr int ACTIVITY_COLUMNS = 512;
+    
+    std::vector<PianoRollNote> notes;  // Sorted by start
+    int64_t duration = 0;              // NoteClock ticks; covered so far while !complete
+    bool complete = true;              // False for a prefix published mid-pass
+    // Mean volume of each channel over each of ACTIVITY_COLUMNS equal parts
+    // of duration, 0-255, ChannelTable::MAX_CHANNELS rows; gathered by the
+    // pass from the registers it samples anyway. Empty for notes from
+    // elsewhere, which get the share of each column their notes cover.
+    std::vector<uint8_t> activity;
 };
 
-inline const char* PianoChannelNames[] = {
-    "Sq1", "Sq2", "Tri", "Noi", "DMC", "V-P1", "V-P2", "V-Saw"
+// Where preprocessTrack() passes spent their time. Emulation and note
+// extraction are clocked on one step in STRIDE and scaled up to the pass,
+// which keeps the clock reads off most steps; the rest is measured whole.
+struct PreprocessStats {
+    static constexpr int STRIDE = 8;
+
+    int passes = 0;
+    double emulated_seconds = 0.0;  // Track time covered
+    double wall_seconds = 0.0;
+    double emulate_seconds = 0.0;   // In gme_play(), or skip() without synthesis
+    double extract_seconds = 0.0;   // Reading the chips and turning that into notes
+    double sort_seconds = 0.0;      // Merging the channels' notes into time order, prefixes included
+    uint64_t notes = 0;
+
+    // Emulated seconds per wall second
+    double realtimeFactor() const { return wall_seconds > 0.0 ? emulated_seconds / wall_seconds : 0.0; }
+    void add(const PreprocessStats& pass) {
+        passes += pass.passes;
+        emulated_seconds += pass.emulated_seconds;
+        wall_seconds += pass.wall_seconds;
+        emulate_seconds += pass.emulate_seconds;
+        extract_seconds += pass.extract_seconds;
+        sort_seconds += pass.sort_seconds;
+        notes += pass.notes;
+    }
 };
 
-// Callback type for getting APU data during preprocessing
-using ApuDataCallback = std::function<Nes_Apu*(Music_Emu*)>;
-using Vrc6DataCallback = std::function<Nes_Vrc6_Apu*(Music_Emu*)>;
+// Fills a table's per-frame columns from the emulator during preprocessing
+using ChannelSampler = std::function<void(Music_Emu*, ChannelTable&)>;
+// Called after each rendered chunk during preprocessing (e.g. to capture seek keyframes).
+// Returning false stops preprocessing early.
+using ChunkCallback = std::function<bool(Music_Emu*)>;
+// Receives the notes of the part of the track preprocessed so far, at
+// 10, 20, 40... seconds in. Notes still sounding end at the covered time.
+using PublishCallback = std::function<void(PreprocessedTrack&&)>;
 
+// Threads: preprocessTrack() builds notes privately and publishes them with
+// an atomic pointer swap, so drawing never waits for a pass. Live key state
+// is per-channel atomics written by whichever thread samples the chips.
 class PianoVisualizer {
 public:
     PianoVisualizer();
@@ -65,87 +110,326 @@ public:
 
     // Preprocess a track to generate all note data ahead of time
     // Returns true if successful, false if preprocessing failed
+    // sample_interval: seconds between play routine calls (ChannelProbe::playInterval()),
+    // 0 to sample in fixed chunks
     // progress_callback: optional callback for progress updates (0.0-1.0)
+    // stats: if given, set to where the pass spent its time
     bool preprocessTrack(Music_Emu* emu, int track, long sample_rate,
-                        ApuDataCallback apu_callback,
+                        const ChannelTable& layout, ChannelSampler sampler,
+                        double sample_interval,
                         std::function<void(float)> progress_callback = nullptr,
-                        Vrc6DataCallback vrc6_callback = nullptr);
+                        ChunkCallback chunk_callback = nullptr,
+                        PublishCallback publish_callback = nullptr,
+                        PreprocessStats* stats = nullptr);
+    
+    // The same note detection over samples taken elsewhere, e.g. by an
+    // emulator run ahead: begin, add channel samples in time order, finish.
+    // The result is published as a complete track, as after preprocessTrack().
+    void beginNotes(const ChannelTable& layout);
+    void addChannelSample(const ChannelTable& table, int64_t time) { processChannels(table, time); }
+    void finishNotes(int64_t end_time) { finalizePreprocessing(end_time); }
+    
+    // Exchange preprocessed note data with another visualizer, e.g. one that
+    // preprocessed the next track in the background
+    void swapPreprocessedData(PianoVisualizer& other);
+    
+    // Move the preprocessed notes out, leaving none
+    PreprocessedTrack takePreprocessedData();
+    // Replace the preprocessed notes with a copy of a stored track's
+    void setPreprocessedData(const PreprocessedTrack& track);
     
     // Check if we have preprocessed data
-    bool hasPreprocessedData() const { return has_preprocessed_data_; }
+    bool hasPreprocessedData() const { return loadNotes() != nullptr; }
+    
+    // Get preprocessed track duration, in seconds
+    float getTrackDuration() const;
     
-    // Get preprocessed track duration
-    float getTrackDuration() const { return track_duration_; }
+    // Published notes, the live history and the UI thread's caches; the
+    // pending notes of a pass in progress are its thread's and not counted
+    void reportMemory(MemoryReport::Sample& sample) const;
 
-    // Update current playback time (for live keyboard display)
-    void updatePlaybackTime(float current_time);
+    // Update current playback time (for live keyboard display, UI thread)
+    void updatePlaybackTime(int64_t current_time);
     
-    // Update with NES APU register data for live keyboard highlighting
-    void updateFromAPU(const int* periods, const int* lengths, const int* amplitudes, float current_time);
+    // Channels of the loaded source, for colours and the legend
+    void setChannelLayout(const ChannelTable& layout);
     
-    // VRC6 support
-    void setVRC6Enabled(bool enabled) { has_vrc6_ = enabled; }
-    bool hasVRC6() const { return has_vrc6_; }
-    void updateFromVRC6(const int* periods, const int* volumes, const bool* enabled, float current_time);
-    int getActiveChannelCount() const { return has_vrc6_ ? PIANO_NUM_CHANNELS_MAX : PIANO_NUM_CHANNELS_BASE; }
+    // Update from sampled channel registers for live keyboard highlighting.
+    // Lock-free, safe from the audio callback.
+    void updateFromChannels(const ChannelTable& table);
+    // Only entries [first, end), for channels sampled elsewhere by another thread
+    void updateKeys(const ChannelTable& table, int first, int end);
+    // The same, held back until applyQueuedKeys() reaches time on the
+    // consumer's clock, for tables sampled ahead of the audio (one sampling
+    // thread; dropped if the UI fell behind). applyQueuedKeys() is UI thread.
+    void queueKeys(const ChannelTable& table, int first, int end, int64_t time);
+    void applyQueuedKeys(int64_t until);
+    // The same, also recording the notes into the live history at time, on
+    // the roll's clock. The roll scrolls the history up while it has no
+    // preprocessed notes. One sampling thread at a time; never allocates.
+    void updateFromChannels(const ChannelTable& table, int64_t time);
+    // The note a channel is sounding now, -1 if silent, with its velocity (any thread)
+    int getLiveNote(int channel, float* velocity) const;
 
+#ifndef NES_HEADLESS
     // Draw the piano keyboard
     void drawPianoKeyboard(const char* label, float width, float height);
 
     // Draw the piano roll (scrolling notes - shows FUTURE notes falling down)
-    void drawPianoRoll(const char* label, float width, float height, float current_time);
+    // current_time on the NoteClock, as every time the roll is given
+    void drawPianoRoll(const char* label, float width, float height, int64_t current_time);
+
+    // Draw the whole-track overview: how much each channel sounds along the
+    // track, with the playback position. Clicking or dragging asks for a seek.
+    void drawOverview(const char* label, float width, float height, int64_t current_time);
+    // Seek asked for in the overview since the last call, in seconds (UI thread)
+    bool takeSeekRequest(float& seconds);
 
     // Draw complete piano visualizer window
-    void drawPianoWindow(bool* p_open, float current_time);
+    void drawPianoWindow(bool* p_open, int64_t current_time);
+#endif
 
     // Settings
     void setPianoRollSpeed(float seconds_visible) { piano_roll_seconds_ = seconds_visible; }
     void setOctaveRange(int low, int high) { octave_low_ = low; octave_high_ = high; }
+    // Roll level of detail, for the quality governor: the glow and outline
+    // layers, notes shorter than merge_pixels joined into one bar per lane and
+    // notes shorter than detail_pixels drawn as plain bars
+    void setNoteEffects(bool glow, bool outline) { note_glow_ = glow; note_outline_ = outline; }
+    void setNoteDetail(float merge_pixels, float detail_pixels) {
+        note_merge_pixels_ = merge_pixels;
+        note_detail_pixels_ = detail_pixels;
+    }
 
-private:
-    // Constants
+    // Full detail: sub-pixel notes merge, notes under 4 px skip the outline and glow
+    static constexpr float NOTE_MERGE_PIXELS = 1.0f;
+    static constexpr float NOTE_DETAIL_PIXELS = 4.0f;
+
+    // Keyboard range (also used by the note spectrum in AudioVisualizer)
     static constexpr int MIDI_NOTE_MIN = 21;   // A0
     static constexpr int MIDI_NOTE_MAX = 108;  // C8
-    static constexpr float NES_CPU_CLOCK = 1789773.0f;  // NTSC
+    
+    // How far preprocessing follows a track of unknown length
+    static constexpr float UNKNOWN_LENGTH_SECONDS = 1800.0f;
+    // Output rate for a pass over an emulator that has to synthesise while
+    // it runs (one without set_registers_only()): its chips keep their own
+    // clocks, and only the resampling to this rate is left to do
+    static constexpr long PREPROCESS_SAMPLE_RATE = 8000;
+    static float midiToFrequency(int midi_note);
+    
+#ifndef NES_HEADLESS
+    // Release GPU resources (call before sg_shutdown)
+    void destroyTextures();
+#endif
+
+    // Time index over the notes, so the roll and the keyboard only visit
+    // the notes near the cursor however long the track is: chunks of
+    // 2^CHUNK_SHIFT ticks, 4.7 s
+    static constexpr int CHUNK_SHIFT = 13;
+    struct NoteChunk {
+        uint32_t first = 0;              // First note starting in the chunk
+        uint32_t max_length = 0;         // Longest note starting in it, in ticks
+        std::vector<uint32_t> carried;   // Earlier notes still sounding at its start
+    };
+    
+    // Published note data, immutable once built. Struct of arrays sorted by
+    // start, 11 bytes a note: the visibility scan only reads the tick columns.
+    // A tick is 2^TICK_SHIFT NoteClock ticks, 0.57 ms, taken from the 64-bit
+    // times by a shift, so 32 bits reach 28 days and never drift.
+    static constexpr int TICK_SHIFT = 10;
+    static constexpr int OVERVIEW_COLUMNS = PreprocessedTrack::ACTIVITY_COLUMNS;
+    struct NoteData {
+        std::vector<uint32_t> start;    // Ticks
+        std::vector<uint32_t> length;   // Ticks
+        std::vector<uint8_t> channel;
+        std::vector<uint8_t> midi_note;
+        std::vector<uint8_t> velocity;  // 1/255 steps
+        std::vector<NoteChunk> chunks;
+        int64_t duration = 0;  // NoteClock ticks
+        // PreprocessedTrack::activity, or the share of each column's time a
+        // channel's notes cover: OVERVIEW_COLUMNS per channel, 0-255; empty
+        // without either
+        std::vector<uint8_t> overview;
+        
+        NoteData(const std::vector<PianoRollNote>& sorted_notes, int64_t track_duration,
+                 std::vector<uint8_t> activity = {});
+        size_t size() const { return start.size(); }
+        uint32_t end(size_t n) const { return start[n] + length[n]; }
+        PianoRollNote note(size_t n) const;
+        size_t memoryBytes() const;
+        // Indices of the notes overlapping [t0, t1], NoteClock times
+        void notesBetween(int64_t t0, int64_t t1, std::vector<uint32_t>& out) const;
+        
+        static uint32_t toTicks(int64_t time) { return static_cast<uint32_t>(std::max<int64_t>(0, time) >> TICK_SHIFT); }
+        static int64_t toTime(uint32_t ticks) { return static_cast<int64_t>(ticks) << TICK_SHIFT; }
+    };
 
-    // Current note state per channel (for live keyboard display)
-    std::array<NesNoteInfo, PIANO_NUM_CHANNELS_MAX> current_notes_;
+private:
+    // Current note per channel (for live keyboard display): midi note in
+    // bits 0-7, bit 8 set while sounding, velocity * 65535 in bits 16-31
+    std::array<std::atomic<uint32_t>, ChannelTable::MAX_CHANNELS> live_keys_{};
+    static uint32_t packKey(int midi_note, float velocity);
+    static uint32_t tableKey(const ChannelTable& table, int ch) {
+        return table.active[ch] ? packKey(table.note[ch], table.velocity[ch]) : 0;
+    }
+    
+    // Keys from queueKeys() waiting for their time
+    struct KeyFrame {
+        int64_t time;
+        int first;
+        int end;
+        std::array<uint32_t, ChannelTable::MAX_CHANNELS> keys;
+    };
+    static constexpr size_t KEY_QUEUE_CAPACITY = 256;
+    SpscRing<KeyFrame> key_queue_{KEY_QUEUE_CAPACITY};
+    KeyFrame key_front_{};                 // UI thread
+    bool has_key_front_ = false;
+    ChannelTable channels_;  // Guarded by mutex_
     
-    // Preprocessed note data (sorted by start_time)
-    std::vector<PianoRollNote> preprocessed_notes_;
-    bool has_preprocessed_data_ = false;
-    float track_duration_ = 0.0f;
-    bool has_vrc6_ = false;
+    std::shared_ptr<const NoteData> notes_;  // Only through loadNotes()/publishNotes()
+    std::shared_ptr<const NoteData> loadNotes() const { return std::atomic_load(&notes_); }
+    void publishNotes(std::shared_ptr<const NoteData> data) { std::atomic_store(&notes_, std::move(data)); }
+    std::vector<uint32_t> visible_notes_;  // Scratch for notesBetween() (UI thread)
     
-    // For preprocessing: track note state
-    std::array<int, PIANO_NUM_CHANNELS_MAX> preprocess_prev_notes_;
-    std::array<float, PIANO_NUM_CHANNELS_MAX> preprocess_note_start_;
-    std::array<float, PIANO_NUM_CHANNELS_MAX> preprocess_note_velocity_;
+    // Live history: the sampling thread tracks each channel's note and
+    // queues it once it ends; the UI thread moves ended notes into a ring
+    // that overwrites the oldest. Notes still sounding are drawn from
+    // live_keys_ and live_start_.
+    static constexpr size_t HISTORY_CAPACITY = 1024;
+    SpscRing<PianoRollNote> history_queue_{HISTORY_CAPACITY};
+    std::array<std::atomic<int64_t>, ChannelTable::MAX_CHANNELS> live_start_{};
+    std::atomic<bool> history_reset_{false};  // Set by reset(), seen by the sampling thread
+    std::array<int, ChannelTable::MAX_CHANNELS> history_note_;      // Sampling thread
+    std::array<float, ChannelTable::MAX_CHANNELS> history_velocity_;
+    std::array<PianoRollNote, HISTORY_CAPACITY> history_{};         // UI thread
+    size_t history_next_ = 0;
+    size_t history_count_ = 0;
+    int64_t history_time_ = 0;
+    
+    // For preprocessing, owned by the thread running the pass (one at a time).
+    // A channel sounds one note at a time, so each channel's notes come out
+    // already in start order and are merged by time when the pass ends,
+    // rather than collected in end order and sorted. The vectors keep their
+    // capacity from pass to pass.
+    std::array<std::vector<PianoRollNote>, ChannelTable::MAX_CHANNELS> channel_notes_;
+    std::vector<PianoRollNote> merged_notes_;
+    std::array<int, ChannelTable::MAX_CHANNELS> preprocess_prev_notes_;
+    std::array<int64_t, ChannelTable::MAX_CHANNELS> preprocess_note_start_;
+    std::array<float, ChannelTable::MAX_CHANNELS> preprocess_note_velocity_;
+    // Volume summed per channel over bins of 1/ACTIVITY_BINS_PER_SECOND s,
+    // layout channels a bin, with the samples in each; folded into
+    // PreprocessedTrack::activity once the length is known
+    static constexpr int ACTIVITY_BINS_PER_SECOND = 16;
+    std::vector<float> activity_sum_;
+    std::vector<uint16_t> activity_count_;
+    int activity_channels_ = 0;
+    size_t activity_origin_ = 0;  // Bin of activity_count_[0], the first sampled
     
     // Settings
     float piano_roll_seconds_ = 3.0f;  // How many seconds of future notes to show
+    bool note_glow_ = true;
+    bool note_outline_ = true;
+    float note_merge_pixels_ = NOTE_MERGE_PIXELS;
+    float note_detail_pixels_ = NOTE_DETAIL_PIXELS;
     int octave_low_ = 2;   // C2
     int octave_high_ = 7;  // C7
+    float seek_request_ = -1.0f;  // From the overview, -1 when none (UI thread)
+    
+#ifndef NES_HEADLESS
+    // Where each key sits, shared by the keyboard and the roll; rebuilt when
+    // the width or the octave range changes (UI thread)
+    struct KeyLayout {
+        float canvas_width = -1.0f;
+        int octave_low = -1;
+        int octave_high = -1;
+        int start_note = 0;
+        int end_note = -1;
+        float white_width = 0.0f;
+        std::array<float, 128> x{};      // From the canvas's left edge, -1 outside the range
+        std::array<float, 128> width{};  // Drawn width, a pixel less than the lane for white keys
+    };
+    KeyLayout key_layout_;
+    const KeyLayout& keyLayout(float canvas_width);
+    void drawHistory(ImDrawList* draw_list, ImVec2 canvas_pos, float height, int64_t current_time, const KeyLayout& keys);
+    
+    // Unpressed keyboard, tessellated once at the canvas origin and copied
+    // into the draw list each frame; pressed keys are drawn over it. White
+    // and black keys are kept apart so a pressed white key stays under its
+    // black neighbours. Also rebuilt when the atlas's white pixel moves or
+    // the anti-aliasing setup changes, as both are baked into the vertices.
+    struct KeyMesh {
+        std::vector<ImDrawVert> vtx;
+        std::vector<ImDrawIdx> idx;
+    };
+    struct KeyboardCache {
+        float width = -1.0f;
+        float height = -1.0f;
+        int octave_low = -1;
+        int octave_high = -1;
+        ImVec2 uv_white{-1.0f, -1.0f};
+        float fringe_scale = 0.0f;
+        ImDrawListFlags flags = 0;
+        KeyMesh white_keys;
+        KeyMesh black_keys;
+    };
+    KeyboardCache keyboard_cache_;
+    void updateKeyboardCache(const ImDrawList* draw_list, float width, float height);
+    static void appendMesh(ImDrawList* draw_list, const KeyMesh& mesh, ImVec2 offset);
     
-    // Thread safety
+    // Roll notes are textured quads: the rounded fill, outline and glow are
+    // antialiased once into a small atlas and sampled 9-sliced, so corners
+    // keep their size and a note costs 16 vertices per layer instead of a
+    // tessellated path
+    enum NoteSprite { SPRITE_FILL, SPRITE_OUTLINE, SPRITE_GLOW, SPRITE_COUNT };
+    static constexpr int SPRITE_SIZE = 16;    // Texels of a sprite's content
+    static constexpr int SPRITE_STRIDE = 20;  // With a 2-texel edge copy each side
+    static void rasterizeNoteSprites(std::vector<uint32_t>& pixels);
+    void createNoteTexture();
+    void appendNoteSprite(ImDrawList* draw_list, NoteSprite sprite, ImVec2 p_min, ImVec2 p_max, ImU32 color) const;
+    // One untextured-looking quad for notes too short to show their shape
+    void appendNoteBar(ImDrawList* draw_list, ImVec2 p_min, ImVec2 p_max, ImU32 color) const;
+    // The overview as one texel per column and channel, tinted with the
+    // channels' colours; re-uploaded when other notes are published or the
+    // colours change, never per frame
+    void updateOverviewTexture(const std::shared_ptr<const NoteData>& data, int lanes,
+                               const std::array<ImU32, ChannelTable::MAX_CHANNELS>& colors);
+    bool overview_texture_created_ = false;
+    sg_image overview_texture_ = {};
+    sg_view overview_view_ = {};
+    sg_sampler overview_sampler_ = {};
+    std::shared_ptr<const NoteData> overview_data_;  // What the texture shows
+    int overview_lanes_ = 0;
+    std::array<ImU32, ChannelTable::MAX_CHANNELS> overview_colors_{};
+    std::vector<uint32_t> overview_pixels_;
+    bool note_texture_created_ = false;
+    sg_image note_texture_ = {};
+    sg_view note_view_ = {};
+    sg_sampler note_sampler_ = {};
+#endif
+    
+    // Channel layout; never held across a preprocessing pass
     std::mutex mutex_;
     
     // Helper functions
-    static int frequencyToMidi(float frequency);
-    static float midiToFrequency(int midi_note);
     static bool isBlackKey(int midi_note);
     static int getWhiteKeyIndex(int midi_note);
     static int getOctave(int midi_note);
     static int getNoteInOctave(int midi_note);
     
+#ifndef NES_HEADLESS
     void drawKey(ImDrawList* draw_list, ImVec2 pos, float width, float height, 
                  int midi_note, bool is_black, int pressed_channel, float velocity);
+#endif
     
-    // Process APU data during preprocessing
-    void processApuFrame(const int* periods, const int* lengths, const int* amplitudes, float current_time);
-    void processVrc6Frame(const int* periods, const int* volumes, const bool* enabled, float current_time);
-    void finalizePreprocessing(float end_time);
-    
-    // Convert APU period to MIDI note
-    int periodToMidi(int channel, int period);
+    // Turn sampled channel state into note events during preprocessing
+    void processChannels(const ChannelTable& table, int64_t current_time);
+    void finalizePreprocessing(int64_t end_time);
+    PreprocessedTrack snapshotPreprocessing(int64_t covered_time) const;
+    // The activity bins over duration (ticks) as PreprocessedTrack::activity
+    void foldActivity(int64_t duration, std::vector<uint8_t>& out) const;
+    // Room for the notes of a pass over duration seconds of the layout's channels
+    void reserveNotes(const ChannelTable& layout, float duration);
+    // The channels' notes into out in start order, ties by channel; open,
+    // if given, adds each channel's note still sounding (midi_note -1: none)
+    void mergeChannelNotes(const PianoRollNote* open, std::vector<PianoRollNote>& out) const;
 };
@@ -0,0 +1,273 @@
+#include "PlayQueue.h"
+#include "ChannelTaps.h"
+#include "NsfExport.h"
+#include "ZipArchive.h"
+#include "gme/M3u_Playlist.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+
+namespace {
+
+struct EmuDeleter {
+    void operator()(Music_Emu* emu) const { gme_delete(emu); }
+};
+using EmuPtr = std::unique_ptr<Music_Emu, EmuDeleter>;
+
+// Track info only, no sound
+EmuPtr openInfo(const std::string& path, std::string* error) {
+    gme_err_t err = nullptr;
+    std::shared_ptr<const MusicFile> file = MusicFile::read(path.c_str(), &err);
+    Music_Emu* emu = nullptr;
+    if (file) err = open_music_emu(*file, &emu, gme_info_only);
+    if (err || !emu) {
+        if (error) *error = path + ": " + (err ? err : "could not read the file");
+        return nullptr;
+    }
+    return EmuPtr(emu);
+}
+
+// "Song", or "Game #3" when the track has no title
+std::string trackTitle(const track_info_t& info, const std::string& path, int track) {
+    if (info.song[0]) return info.song;
+    const std::string name = info.game[0] ? info.game : std::filesystem::path(path).stem().string();
+    return name + " #" + std::to_string(track + 1);
+}
+
+bool hasExtension(const std::filesystem::path& path, const char* const* exts) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (; *exts; ++exts) {
+        if (ext == *exts) return true;
+    }
+    return false;
+}
+
+const char* const MUSIC_EXTENSIONS[] = {".nsf", ".nsfe", nullptr};
+const char* const PLAYLIST_EXTENSIONS[] = {".m3u", nullptr};
+
+// Music files in dir and below, in path order
+std::vector<std::string> musicFilesUnder(const std::string& dir, const JobPool::Group& job) {
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(dir, ec), end; !ec && it != end && !job.cancelled();
+         it.increment(ec)) {
+        if (it->is_regular_file(ec) && hasExtension(it->path(), MUSIC_EXTENSIONS)) files.push_back(it->path().string());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Music entries of a zip, as entry paths in name order
+std::vector<std::string> musicEntriesOf(const std::string& archive_path, std::string* error) {
+    std::vector<std::string> files;
+    const char* err = nullptr;
+    std::shared_ptr<const ZipArchive> archive = ZipArchive::open(archive_path, &err);
+    if (!archive) {
+        if (error) *error = archive_path + ": " + err;
+        return files;
+    }
+    for (const ZipArchive::Entry& entry : archive->entries()) {
+        if (hasExtension(entry.name, MUSIC_EXTENSIONS)) files.push_back(ZipArchive::entryPath(archive_path, entry.name));
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty() && error) *error = archive_path + ": no music files in the archive";
+    return files;
+}
+
+}  // namespace
+
+PlayQueue::~PlayQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        to_load_.clear();
+    }
+    JobPool::shared().cancel(load_job_);
+    JobPool::shared().wait(load_job_);
+}
+
+bool PlayQueue::addFile(const std::string& path, std::string* error) {
+    return readFile(path, items_, error);
+}
+
+bool PlayQueue::addPlaylist(const std::string& path, std::string* error) {
+    return readPlaylist(path, items_, error);
+}
+
+bool PlayQueue::readFile(const std::string& path, std::vector<Item>& out, std::string* error) {
+    EmuPtr emu = openInfo(path, error);
+    if (!emu) return false;
+
+    const NsfExport::Options defaults;
+    for (int track = 0; track < gme_track_count(emu.get()); ++track) {
+        track_info_t info;
+        if (gme_track_info(emu.get(), &info, track) != nullptr) continue;
+        Item item;
+        item.path = path;
+        item.track = track;
+        item.title = trackTitle(info, path, track);
+        item.length_ms = NsfExport::playLength(info, defaults);
+        item.fade_ms = defaults.fade_ms;
+        out.push_back(std::move(item));
+    }
+    return true;
+}
+
+bool PlayQueue::readPlaylist(const std::string& path, std::vector<Item>& out, std::string* error) {
+    M3u_Playlist playlist;
+    if (gme_err_t err = playlist.load(path.c_str())) {
+        if (error) *error = path + ": " + err;
+        return false;
+    }
+
+    // Entries usually share one file; it is opened once for their defaults
+    const std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    const NsfExport::Options defaults;
+    std::string open_path;
+    EmuPtr emu;
+    size_t added = 0;
+    for (int i = 0; i < playlist.size(); ++i) {
+        const M3u_Playlist::entry_t& entry = playlist[i];
+        const std::string file = (dir / entry.file).string();
+        if (file != open_path) {
+            open_path = file;
+            emu = openInfo(file, error);
+        }
+        if (!emu) continue;
+
+        // As Gme_File::remap_track_(): decimal numbers count from 1 unless the type says otherwise
+        int track = std::max(entry.track, 0);
+        const gme_type_t type = gme_type(emu.get());
+        if (entry.track >= 0 && !(type->flags_ & 0x02)) track -= entry.decimal_track;
+        track_info_t info;
+        if (track < 0 || gme_track_info(emu.get(), &info, track) != nullptr) continue;
+
+        Item item;
+        item.path = file;
+        item.track = track;
+        item.title = entry.name[0] ? entry.name : trackTitle(info, file, track);
+        item.length_ms = entry.length >= 0 ? entry.length * 1000L : NsfExport::playLength(info, defaults);
+        item.fade_ms = entry.fade >= 0 ? entry.fade * 1000L : defaults.fade_ms;
+        out.push_back(std::move(item));
+        ++added;
+    }
+    if (added == 0 && error && error->empty()) *error = path + ": no playable entries";
+    return added > 0;
+}
+
+void PlayQueue::remove(size_t index) {
+    if (index >= items_.size()) return;
+    items_.erase(items_.begin() + static_cast<std::ptrdiff_t>(index));
+    const int removed = static_cast<int>(index);
+    if (current_ == removed) {
+        current_ = -1;
+    } else if (current_ > removed) {
+        --current_;
+    }
+}
+
+void PlayQueue::addPaths(std::vector<std::string> paths) {
+    if (paths.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    to_load_.insert(to_load_.end(), std::make_move_iterator(paths.begin()), std::make_move_iterator(paths.end()));
+    kick();
+}
+
+void PlayQueue::kick() {
+    if (load_running_) return;
+    load_running_ = true;
+    JobPool::shared().submit(load_job_, JobPool::Priority::Low, [this]() { load(); });
+}
+
+bool PlayQueue::poll(std::string* error) {
+    std::vector<Item> loaded;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!load_error_.empty()) {
+            if (error) *error = load_error_;
+            load_error_.clear();
+        }
+        loaded.swap(loaded_);
+    }
+    if (loaded.empty()) return false;
+    items_.insert(items_.end(), std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.end()));
+    return true;
+}
+
+size_t PlayQueue::loadsPending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return to_load_.size() + (reading_ ? 1 : 0);
+}
+
+void PlayQueue::load() {
+    std::vector<Item> items;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!to_load_.empty() && !load_job_.cancelled()) {
+        const std::string path = std::move(to_load_.front());
+        to_load_.erase(to_load_.begin());
+        const size_t generation = load_generation_;
+        reading_ = true;
+        lock.unlock();
+
+        // A folder's files, or an archive's, take its place, so the order holds
+        std::error_code ec;
+        if (std::filesystem::is_directory(path, ec) || ZipArchive::isArchive(path)) {
+            std::string error;
+            std::vector<std::string> files = ZipArchive::isArchive(path) ? musicEntriesOf(path, &error)
+                                                                         : musicFilesUnder(path, load_job_);
+            lock.lock();
+            reading_ = false;
+            if (generation == load_generation_) {
+                if (!error.empty()) load_error_ = error;
+                to_load_.insert(to_load_.begin(), std::make_move_iterator(files.begin()),
+                                std::make_move_iterator(files.end()));
+            }
+            continue;
+        }
+
+        // Anything else dropped alongside, ROMs say, is passed over
+        items.clear();
+        std::string error;
+        bool read = true;
+        if (hasExtension(path, PLAYLIST_EXTENSIONS)) {
+            read = readPlaylist(path, items, &error);
+        } else if (hasExtension(path, MUSIC_EXTENSIONS)) {
+            read = readFile(path, items, &error);
+        }
+        lock.lock();
+        reading_ = false;
+        if (generation != load_generation_) continue;
+        if (!read) load_error_ = error;
+        loaded_.insert(loaded_.end(), std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+    }
+    load_running_ = false;
+}
+
+void PlayQueue::clear() {
+    items_.clear();
+    current_ = -1;
+    std::lock_guard<std::mutex> lock(mutex_);
+    to_load_.clear();
+    loaded_.clear();
+    load_error_.clear();
+    ++load_generation_;
+}
+
+void PlayQueue::move(size_t index, int direction) {
+    const long other = static_cast<long>(index) + direction;
+    if (index >= items_.size() || other < 0 || other >= static_cast<long>(items_.size())) return;
+    std::swap(items_[index], items_[static_cast<size_t>(other)]);
+    if (current_ == static_cast<int>(index)) {
+        current_ = static_cast<int>(other);
+    } else if (current_ == static_cast<int>(other)) {
+        current_ = static_cast<int>(index);
+    }
+}
+
+int PlayQueue::next() const {
+    if (current_ < 0) return -1;
+    if (current_ + 1 < static_cast<int>(items_.size())) return current_ + 1;
+    return repeat && !items_.empty() ? 0 : -1;
+}
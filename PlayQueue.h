@@ -0,0 +1,80 @@
+#pragma once
+
+#include "JobPool.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Tracks to play in order, across files. Every entry plays for a set length
+// and then fades out: an .m3u playlist's time and fade when it gives them,
+// otherwise the file's track info as NsfExport::playLength() reads it. The
+// player prefetches the entry after the current one so it starts at once.
+//
+// Many files at a time, a drop of folders say, are read by addPaths() in
+// the background: a Low job on the shared JobPool walks the folders and
+// reads each file's track info, and poll() appends what it has read so far,
+// in the order given, so the UI thread never opens a file itself.
+class PlayQueue {
+public:
+    struct Item {
+        std::string path;
+        int track = 0;        // As the player numbers them, from 0
+        std::string title;
+        long length_ms = 0;   // Play time before the fade
+        long fade_ms = 0;
+    };
+
+    // Every track of a music file; false with *error set if gme cannot open it
+    bool addFile(const std::string& path, std::string* error);
+    // The entries of an .m3u playlist, their files relative to it. Entries
+    // whose file cannot be opened are skipped; false if none could be added.
+    bool addPlaylist(const std::string& path, std::string* error);
+
+    // Music files, playlists, folders and zip archives, read in the
+    // background. A folder or an archive adds the NSF and NSFE files in it,
+    // in path order, an archive's as entry paths; other files are skipped.
+    void addPaths(std::vector<std::string> paths);
+    // Append the entries read since the last call (UI thread); true if any
+    // were. *error gets the last file that could not be read, if any.
+    bool poll(std::string* error);
+    // Files and folders given to addPaths() still to read
+    size_t loadsPending() const;
+
+    ~PlayQueue();
+
+    void remove(size_t index);
+    // Every entry, and whatever addPaths() is still reading
+    void clear();
+    // Move an entry up (-1) or down (+1); the current entry moves with it
+    void move(size_t index, int direction);
+
+    const std::vector<Item>& items() const { return items_; }
+    bool empty() const { return items_.empty(); }
+
+    // Entry playing, -1 while the player is not playing from the queue
+    int current() const { return current_; }
+    void setCurrent(int index) { current_ = index >= 0 && index < static_cast<int>(items_.size()) ? index : -1; }
+    // Entry to play after the current one, -1 at the end
+    int next() const;
+
+    bool repeat = false;  // Start over after the last entry
+
+private:
+    // A file's entries, or a playlist's, into out
+    static bool readFile(const std::string& path, std::vector<Item>& out, std::string* error);
+    static bool readPlaylist(const std::string& path, std::vector<Item>& out, std::string* error);
+    void load();  // The addPaths() job: reads until no path is left
+    void kick();  // Queue it unless it is running; mutex_ held
+
+    std::vector<Item> items_;
+    int current_ = -1;
+
+    mutable std::mutex mutex_;
+    JobPool::Group load_job_;
+    bool load_running_ = false;          // The job is queued or running
+    bool reading_ = false;               // It has a path out of to_load_
+    std::vector<std::string> to_load_;   // In order, folders not walked yet
+    std::vector<Item> loaded_;           // Read, for poll() to append
+    std::string load_error_;
+    size_t load_generation_ = 0;         // Bumped by clear(), which drops a read in flight
+};
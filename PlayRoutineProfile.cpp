@@ -0,0 +1,52 @@
+#include "PlayRoutineProfile.h"
+#include "gme/Nsf_Emu.h"
+#include <algorithm>
+
+void PlayRoutineProfile::capture(const Nsf_Emu* nsf) {
+    if (!nsf) {
+        if (source_) {
+            source_ = nullptr;
+            history_ = Snapshot();
+            head_ = 0;
+            publish();
+        }
+        return;
+    }
+
+    // Another emulator or track, or the same one started over
+    const Nsf_Emu::play_cost_t& cost = nsf->play_cost();
+    const int track = nsf->current_track();
+    if (nsf != source_ || track != history_.track || cost.calls < history_.calls) {
+        source_ = nsf;
+        history_ = Snapshot();
+        history_.track = track;
+        head_ = 0;
+    }
+    const long period = std::max(nsf->play_period_clocks(), 1L);
+    if (cost.calls == history_.calls && period == history_.period) return;
+
+    // Calls beyond the log's reach since the last block are lost to the
+    // history, not to last, peak or mean
+    const long first = std::max(history_.calls, cost.calls - static_cast<long>(Nsf_Emu::play_log_size));
+    for (long n = first; n < cost.calls; ++n) {
+        history_.load[head_] = static_cast<float>(cost.log[n % Nsf_Emu::play_log_size]) / period;
+        head_ = (head_ + 1) % HISTORY_CALLS;
+        history_.count = std::min(history_.count + 1, HISTORY_CALLS);
+    }
+    history_.calls = cost.calls;
+    history_.last = cost.last;
+    history_.peak = cost.peak;
+    history_.mean = cost.calls ? cost.total / cost.calls : 0.0;
+    history_.period = period;
+    publish();
+}
+
+void PlayRoutineProfile::publish() {
+    Snapshot& out = snapshots_.back();
+    out = history_;
+
+    // Oldest first: the ring starts at head_ once it is full
+    const int start = history_.count == HISTORY_CALLS ? head_ : 0;
+    for (int i = 0; i < history_.count; ++i) out.load[i] = history_.load[(start + i) % HISTORY_CALLS];
+    snapshots_.publish();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "TripleBuffer.h"
+#include <array>
+
+class Nsf_Emu;
+
+// How much of each frame an NSF's play routine takes: the CPU clocks from
+// its call to its return (Nsf_Emu::play_cost()) over the clocks between two
+// calls, per call, with the track's worst case. The render thread picks up
+// the calls that returned during each block with capture() and publishes
+// the history, which the UI thread reads without a lock.
+class PlayRoutineProfile {
+public:
+    static constexpr int HISTORY_CALLS = 240;  // Four seconds of 60 Hz calls
+
+    struct Snapshot {
+        std::array<float, HISTORY_CALLS> load{};  // Clocks over the period, oldest first
+        int count = 0;                            // Of load filled
+        int track = -1;                           // -1: no NSF playing
+        long calls = 0;                           // Since the track started
+        long last = 0;                            // Clocks
+        long peak = 0;
+        double mean = 0.0;
+        long period = 0;                          // Clocks between calls
+    };
+
+    // Render thread, after each block nsf rendered (nullptr: not an NSF)
+    void capture(const Nsf_Emu* nsf);
+
+    // UI thread: the newest history
+    const Snapshot& latest() {
+        snapshots_.acquire();
+        return snapshots_.front();
+    }
+
+private:
+    void publish();
+
+    TripleBuffer<Snapshot> snapshots_;
+
+    // Render thread
+    const Nsf_Emu* source_ = nullptr;
+    Snapshot history_;  // load is a ring here, next written at head_
+    int head_ = 0;
+};
@@ -0,0 +1,57 @@
+#include "PpuPipeline.h"
+
+PpuPipeline::PpuPipeline() {
+    logs_[0] = agnes_make_ppu_log();
+    logs_[1] = agnes_make_ppu_log();
+    if (valid()) worker_ = std::thread(&PpuPipeline::workerLoop, this);
+}
+
+PpuPipeline::~PpuPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    if (worker_.joinable()) worker_.join();
+    agnes_destroy_ppu_log(logs_[0]);
+    agnes_destroy_ppu_log(logs_[1]);
+}
+
+void PpuPipeline::render(const uint8_t* screen) {
+    in_flight_ = logs_[next_];
+    next_ ^= 1;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = in_flight_;
+        job_screen_ = screen;
+        finished_ = false;
+    }
+    wake_.notify_one();
+}
+
+agnes_ppu_log_t* PpuPipeline::wait(bool* ok) {
+    agnes_ppu_log_t* log = in_flight_;
+    if (!log) return nullptr;
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return finished_; });
+    in_flight_ = nullptr;
+    if (ok) *ok = ok_;
+    return log;
+}
+
+void PpuPipeline::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return quit_ || job_; });
+        if (quit_) return;
+        agnes_ppu_log_t* log = job_;
+        const uint8_t* screen = job_screen_;
+        job_ = nullptr;
+        lock.unlock();
+        const bool ok = agnes_render_ppu_log(log, screen);
+        lock.lock();
+        ok_ = ok;
+        finished_ = true;
+        done_.notify_one();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "agnes/agnes.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Draws an emulator's frames on a second core. A frame runs with one of
+// two agnes PPU logs attached (agnes_log_ppu), so the emulation thread
+// keeps the PPU's timing and flags but skips the pixels; a worker then
+// replays that log into the picture while the emulation thread goes on with
+// the next frame. Each picture comes out a frame late.
+class PpuPipeline {
+public:
+    PpuPipeline();
+    ~PpuPipeline();
+    PpuPipeline(const PpuPipeline&) = delete;
+    PpuPipeline& operator=(const PpuPipeline&) = delete;
+
+    // false if the logs could not be made
+    bool valid() const { return logs_[0] && logs_[1]; }
+
+    // The emulation thread's side, all between frames:
+    // The log for the next frame to run with; never the one being drawn
+    agnes_ppu_log_t* nextLog() const { return logs_[next_]; }
+    // Draw the ended nextLog() over screen, the picture before it, which
+    // must stay as it is until wait(); after a wait() if one is in flight
+    void render(const uint8_t* screen);
+    // Until the render in flight is done: its log, or null if there was
+    // none. *ok, if given, says whether the log held all of its frame
+    agnes_ppu_log_t* wait(bool* ok = nullptr);
+
+private:
+    void workerLoop();
+
+    agnes_ppu_log_t* logs_[2] = {};
+    int next_ = 0;
+    agnes_ppu_log_t* in_flight_ = nullptr;  // Emulation thread
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::thread worker_;
+    // Guarded by mutex_
+    agnes_ppu_log_t* job_ = nullptr;  // For the worker to draw
+    const uint8_t* job_screen_ = nullptr;
+    bool finished_ = false;
+    bool ok_ = true;
+    bool quit_ = false;
+};
@@ -0,0 +1,92 @@
+#include "QualityGovernor.h"
+#include <algorithm>
+
+namespace {
+
+// Load is the frame's work over the refresh period
+constexpr double STEP_DOWN_LOAD = 0.85;
+constexpr double STEP_UP_LOAD = 0.5;
+constexpr int STEP_DOWN_FRAMES = 20;   // A third of a second at 60 Hz
+constexpr int STEP_UP_FRAMES = 180;    // Three seconds
+constexpr int MAX_UP_WAIT_SCALE = 8;
+constexpr int HOLD_FRAMES = 30;        // For the new level to show in the load
+constexpr int FAILED_STEP_FRAMES = 600;  // A step down this soon after a step up takes it back
+constexpr double LOAD_SMOOTHING = 0.1;
+
+// Refresh period estimate
+constexpr int BUDGET_WINDOW_FRAMES = 120;
+constexpr double MAX_FRAME_SECONDS = 0.1;  // Longer: a stall or an idle wait, not the display
+constexpr double MIN_BUDGET = 1.0 / 360.0;
+constexpr double MAX_BUDGET = 1.0 / 20.0;
+
+}  // namespace
+
+QualityGovernor::Settings QualityGovernor::settings(int level) {
+    Settings s;
+    s.note_glow = level < 1;
+    s.note_outline = level < 3;
+    s.note_merge_pixels = level < 5 ? 1.0f : 3.0f;
+    s.note_detail_pixels = level < 3 ? 4.0f : level < 5 ? 8.0f : 16.0f;
+    s.max_fft_size = level < 4 ? 16384 : level < 5 ? 1024 : 512;
+    s.spectrogram_upload_interval = level < 2 ? 1 : level < 5 ? 2 : 4;
+    return s;
+}
+
+void QualityGovernor::setEnabled(bool enabled) {
+    if (enabled == enabled_) return;
+    enabled_ = enabled;
+    level_ = 0;
+    over_frames_ = under_frames_ = hold_frames_ = since_change_ = 0;
+    up_wait_scale_ = 1;
+    last_step_up_ = false;
+}
+
+void QualityGovernor::changeLevel(int level) {
+    const bool up = level < level_;
+    if (up) {
+        // The previous step up held: be quicker to try the next one
+        if (last_step_up_) up_wait_scale_ = std::max(1, up_wait_scale_ / 2);
+    } else if (last_step_up_ && since_change_ < FAILED_STEP_FRAMES) {
+        // The level just stepped up to could not keep up
+        up_wait_scale_ = std::min(up_wait_scale_ * 2, MAX_UP_WAIT_SCALE);
+    }
+    last_step_up_ = up;
+    level_ = level;
+    over_frames_ = under_frames_ = since_change_ = 0;
+    hold_frames_ = HOLD_FRAMES;
+}
+
+bool QualityGovernor::update(Clock::duration work, double frame_seconds) {
+    if (frame_seconds > 0.0 && frame_seconds < MAX_FRAME_SECONDS) {
+        window_min_ = window_frames_ ? std::min(window_min_, frame_seconds) : frame_seconds;
+        if (++window_frames_ >= BUDGET_WINDOW_FRAMES) {
+            budget_ = std::clamp(window_min_, MIN_BUDGET, MAX_BUDGET);
+            window_frames_ = 0;
+        }
+    }
+    const double frame_load = std::chrono::duration<double>(work).count() / budget_;
+    load_ += (frame_load - load_) * LOAD_SMOOTHING;
+
+    if (!enabled_) return false;
+    ++since_change_;
+    if (hold_frames_ > 0) {
+        --hold_frames_;
+        return false;
+    }
+    if (load_ > STEP_DOWN_LOAD) {
+        under_frames_ = 0;
+        if (++over_frames_ >= STEP_DOWN_FRAMES && level_ < MAX_LEVEL) {
+            changeLevel(level_ + 1);
+            return true;
+        }
+    } else if (load_ < STEP_UP_LOAD) {
+        over_frames_ = 0;
+        if (++under_frames_ >= STEP_UP_FRAMES * up_wait_scale_ && level_ > 0) {
+            changeLevel(level_ - 1);
+            return true;
+        }
+    } else {
+        over_frames_ = under_frames_ = 0;
+    }
+    return false;
+}
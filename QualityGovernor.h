@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+
+// Trades visual detail for frame time on hosts that cannot draw everything
+// inside a refresh. Each UI frame reports how long its build and submit took
+// and how long the whole frame lasted; the shortest frame over the last
+// couple of seconds stands for the display's refresh period, and the work
+// over that period is the load. Sustained load steps the level down one at a
+// time; sustained headroom steps it back up, waiting longer after each step
+// up that had to be taken back, so a host on the edge does not flicker
+// between two levels.
+//
+// Level 0 is full quality; what each further level drops:
+//
+//   1  glow on upcoming notes
+//   2  waterfall uploaded every 2nd frame
+//   3  note outlines, and short notes drawn as plain bars
+//   4  FFT capped at 1024 points
+//   5  FFT capped at 512, waterfall every 4th frame, coarser note merging
+class QualityGovernor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int MAX_LEVEL = 5;
+
+    // What a level asks of the visualizers
+    struct Settings {
+        bool note_glow;
+        bool note_outline;
+        float note_merge_pixels;
+        float note_detail_pixels;
+        int max_fft_size;
+        int spectrogram_upload_interval;  // Frames
+    };
+    static Settings settings(int level);
+
+    // UI thread, once a frame: work is the frame's build and submit,
+    // frame_seconds the time since the previous frame (sapp_frame_duration).
+    // Returns whether the level changed.
+    bool update(Clock::duration work, double frame_seconds);
+
+    int level() const { return enabled_ ? level_ : 0; }
+    // Load over the refresh period, smoothed
+    double load() const { return load_; }
+    double budgetMs() const { return budget_ * 1000.0; }
+
+    // Off holds full quality; on starts over from it
+    void setEnabled(bool enabled);
+    bool enabled() const { return enabled_; }
+
+private:
+    void changeLevel(int level);
+
+    bool enabled_ = true;
+    int level_ = 0;
+    double load_ = 0.0;
+    double budget_ = 1.0 / 60.0;  // Seconds
+
+    // Refresh period estimate: the minimum over a window of recent frames
+    double window_min_ = 0.0;
+    int window_frames_ = 0;
+
+    int over_frames_ = 0;    // In a row above STEP_DOWN_LOAD
+    int under_frames_ = 0;   // In a row below STEP_UP_LOAD
+    int hold_frames_ = 0;    // After a change, frames before the next
+    int since_change_ = 0;   // Frames at the current level
+    int up_wait_scale_ = 1;  // Doubles each time a step up is taken back soon after
+    bool last_step_up_ = false;
+};
@@ -0,0 +1,290 @@
+#include "SaveSlots.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+constexpr char MAGIC[4] = {'F', 'C', 'S', 'S'};
+
+// Host byte order: slots are for the machine that wrote them
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t rom_hash;
+    int64_t saved_at;
+    uint32_t state_size;
+    uint32_t packed_size;
+};
+static_assert(sizeof(Header) == 32, "Header is written as is");
+
+// Repeats shorter than this stay in the literals
+constexpr size_t MIN_RUN = 4;
+
+void putVarLen(std::vector<uint8_t>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool getVarLen(const uint8_t*& in, const uint8_t* end, size_t& value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        const uint8_t byte = *in++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+size_t runAt(const std::vector<uint8_t>& data, size_t i) {
+    size_t j = i + 1;
+    while (j < data.size() && data[j] == data[i]) ++j;
+    return j - i;
+}
+
+// (literal count, literals, run length, run byte if any) groups. Nametables,
+// RAM and attribute tables are mostly runs of one tile or zero.
+void pack(const std::vector<uint8_t>& data, std::vector<uint8_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < data.size()) {
+        const size_t literals_from = i;
+        size_t run = 0;
+        while (i < data.size()) {
+            run = runAt(data, i);
+            if (run >= MIN_RUN) break;
+            i += run;
+            run = 0;
+        }
+        putVarLen(out, i - literals_from);
+        out.insert(out.end(), data.begin() + static_cast<std::ptrdiff_t>(literals_from),
+                   data.begin() + static_cast<std::ptrdiff_t>(i));
+        putVarLen(out, run);
+        if (run) out.push_back(data[i]);
+        i += run;
+    }
+}
+
+bool unpack(const uint8_t* in, size_t size, size_t state_size, std::vector<uint8_t>& out) {
+    const uint8_t* end = in + size;
+    out.clear();
+    out.reserve(state_size);
+    while (in < end) {
+        size_t literals, run;
+        if (!getVarLen(in, end, literals) || literals > static_cast<size_t>(end - in)) return false;
+        if (out.size() + literals > state_size) return false;
+        out.insert(out.end(), in, in + literals);
+        in += literals;
+        if (!getVarLen(in, end, run)) return false;
+        if (run) {
+            if (in == end || out.size() + run > state_size) return false;
+            out.insert(out.end(), run, *in++);
+        }
+    }
+    return out.size() == state_size;
+}
+
+}  // namespace
+
+std::string SaveSlots::defaultDirectory() {
+    std::filesystem::path base;
+#if defined(_WIN32)
+    if (const char* appdata = std::getenv("APPDATA")) base = appdata;
+#elif defined(__APPLE__)
+    if (const char* home = std::getenv("HOME")) base = std::filesystem::path(home) / "Library" / "Application Support";
+#else
+    if (const char* xdg = std::getenv("XDG_DATA_HOME"); xdg && xdg[0]) {
+        base = xdg;
+    } else if (const char* home = std::getenv("HOME")) {
+        base = std::filesystem::path(home) / ".local" / "share";
+    }
+#endif
+    if (base.empty()) return std::string();
+    return (base / "imgui_fc_visualizer" / "states").string();
+}
+
+void SaveSlots::open(const std::string& dir, uint64_t rom_hash) {
+    close();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    dir_ = dir;
+    rom_hash_ = rom_hash;
+    for (Slot& slot : slots_) slot = Slot();
+    quit_ = false;
+    open_ = true;
+}
+
+void SaveSlots::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+        open_ = false;
+    }
+    JobPool::shared().wait(io_job_);
+}
+
+void SaveSlots::kick() {
+    if (draining_) return;
+    draining_ = true;
+    JobPool::shared().submit(io_job_, JobPool::Priority::Normal, [this]() { drain(); });
+}
+
+void SaveSlots::prefetch() {
+    for (int i = 0; i < SLOT_COUNT; ++i) prefetch(i);
+}
+
+void SaveSlots::prefetch(int slot) {
+    if (slot < 0 || slot >= SLOT_COUNT) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_ || slots_[slot].status != Status::Unknown) return;
+        slots_[slot].status = Status::Reading;
+        slots_[slot].read_pending = true;
+        kick();
+    }
+}
+
+SaveSlots::Status SaveSlots::status(int slot) const {
+    if (slot < 0 || slot >= SLOT_COUNT) return Status::Empty;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_[slot].status;
+}
+
+std::time_t SaveSlots::savedAt(int slot) const {
+    if (slot < 0 || slot >= SLOT_COUNT) return 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_[slot].status == Status::Ready ? slots_[slot].saved_at : 0;
+}
+
+void SaveSlots::reportMemory(MemoryReport::Sample& sample) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Slot& s : slots_) sample.add(MemoryReport::SAVE_STATES, MemoryReport::heapBytes(s.state));
+}
+
+bool SaveSlots::fetch(int slot, std::vector<uint8_t>& out) const {
+    if (slot < 0 || slot >= SLOT_COUNT) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slots_[slot].status != Status::Ready) return false;
+    out = slots_[slot].state;
+    return true;
+}
+
+void SaveSlots::store(int slot, std::vector<uint8_t> state) {
+    if (slot < 0 || slot >= SLOT_COUNT) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) return;
+        Slot& s = slots_[slot];
+        s.state = std::move(state);
+        s.saved_at = std::time(nullptr);
+        s.status = Status::Ready;
+        s.read_pending = false;  // What is on disk is out of date
+        s.write_pending = true;
+        kick();
+    }
+}
+
+std::string SaveSlots::slotPath(int slot) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%d.state", static_cast<unsigned long long>(rom_hash_), slot + 1);
+    return (std::filesystem::path(dir_) / name).string();
+}
+
+void SaveSlots::drain() {
+    std::vector<uint8_t> state;
+    std::vector<uint8_t> packed;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Writes first; on close only they are finished
+        int slot = -1;
+        bool write = false;
+        for (int i = 0; i < SLOT_COUNT && slot < 0; ++i) {
+            if (slots_[i].write_pending) {
+                slot = i;
+                write = true;
+            }
+        }
+        for (int i = 0; i < SLOT_COUNT && slot < 0 && !quit_; ++i) {
+            if (slots_[i].read_pending) slot = i;
+        }
+        if (slot < 0) {
+            draining_ = false;
+            return;
+        }
+
+        const std::string path = dir_.empty() ? std::string() : slotPath(slot);
+        if (write) {
+            Slot& s = slots_[slot];
+            s.write_pending = false;
+            state = s.state;
+            const int64_t saved_at = static_cast<int64_t>(s.saved_at);
+            lock.unlock();
+
+            if (!path.empty()) {
+                pack(state, packed);
+                Header header;
+                std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+                header.version = VERSION;
+                header.rom_hash = rom_hash_;
+                header.saved_at = saved_at;
+                header.state_size = static_cast<uint32_t>(state.size());
+                header.packed_size = static_cast<uint32_t>(packed.size());
+
+                // Written aside and renamed over, so a crash never leaves half a slot
+                std::error_code ec;
+                std::filesystem::create_directories(dir_, ec);
+                std::filesystem::path temp = path;
+                temp += ".tmp";
+                bool ok;
+                {
+                    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+                    ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) &&
+                         file.write(reinterpret_cast<const char*>(packed.data()),
+                                    static_cast<std::streamsize>(packed.size()));
+                }
+                if (ok) std::filesystem::rename(temp, path, ec);
+                if (!ok || ec) std::filesystem::remove(temp, ec);
+            }
+            lock.lock();
+            continue;
+        }
+
+        slots_[slot].read_pending = false;
+        lock.unlock();
+
+        bool found = false;
+        std::time_t saved_at = 0;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!path.empty() && file.is_open()) {
+            const std::streamoff size = file.tellg();
+            Header header;
+            file.seekg(0, std::ios::beg);
+            if (size >= static_cast<std::streamoff>(sizeof(header)) &&
+                file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+                std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+                header.rom_hash == rom_hash_ &&
+                static_cast<std::streamoff>(sizeof(header) + header.packed_size) == size) {
+                packed.resize(header.packed_size);
+                found = file.read(reinterpret_cast<char*>(packed.data()), header.packed_size) &&
+                        unpack(packed.data(), packed.size(), header.state_size, state);
+                saved_at = static_cast<std::time_t>(header.saved_at);
+            }
+        }
+
+        lock.lock();
+        // A store() while reading wins
+        Slot& s = slots_[slot];
+        if (s.status == Status::Reading) {
+            s.status = found ? Status::Ready : Status::Empty;
+            if (found) {
+                s.state.swap(state);
+                s.saved_at = saved_at;
+            }
+        }
+    }
+}
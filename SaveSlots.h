@@ -0,0 +1,76 @@
+#pragma once
+
+#include "JobPool.h"
+#include "MemoryReport.h"
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Numbered save states of one ROM, kept in memory and written behind to one
+// small file per slot. store() only copies the state; an I/O job on the shared
+// JobPool run-length packs it and writes it aside before renaming it over the
+// old file, and ends once nothing is pending. Slots on
+// disk are read only when prefetched, so a load has them at hand.
+class SaveSlots {
+public:
+    static constexpr int SLOT_COUNT = 4;
+    // Bump when the file layout changes
+    static constexpr uint32_t VERSION = 1;
+
+    enum class Status {
+        Unknown,   // Not read from disk yet
+        Reading,
+        Empty,
+        Ready,
+    };
+
+    // Per-user data directory for the platform, empty if there is none
+    static std::string defaultDirectory();
+
+    ~SaveSlots() { close(); }
+
+    // Forget any open ROM's slots and use rom_hash's in dir
+    void open(const std::string& dir, uint64_t rom_hash);
+    // Finish pending writes and wait for the I/O job
+    void close();
+
+    // Read every slot not yet read, in the background
+    void prefetch();
+    void prefetch(int slot);
+
+    Status status(int slot) const;
+    // When the slot was saved; 0 unless Ready
+    std::time_t savedAt(int slot) const;
+    // Copy of a Ready slot's state; false otherwise
+    bool fetch(int slot, std::vector<uint8_t>& out) const;
+    // Make state the slot's at once; the file follows (any thread)
+    void store(int slot, std::vector<uint8_t> state);
+
+    // States held in memory
+    void reportMemory(MemoryReport::Sample& sample) const;
+
+private:
+    struct Slot {
+        Status status = Status::Unknown;
+        std::vector<uint8_t> state;
+        std::time_t saved_at = 0;
+        bool read_pending = false;
+        bool write_pending = false;
+    };
+
+    void kick();   // Queue the I/O job unless it is running; mutex_ held
+    void drain();  // The I/O job: reads and writes until none is pending
+    std::string slotPath(int slot) const;
+
+    mutable std::mutex mutex_;
+    JobPool::Group io_job_;
+    bool draining_ = false;  // The I/O job is queued or running
+    bool open_ = false;
+    bool quit_ = false;
+
+    std::string dir_;
+    uint64_t rom_hash_ = 0;
+    Slot slots_[SLOT_COUNT];
+};
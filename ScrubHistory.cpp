@@ -0,0 +1,119 @@
+#include "ScrubHistory.h"
+
+namespace {
+
+constexpr float S16_SCALE = 1.0f / 32768.0f;
+
+}  // namespace
+
+void ScrubHistory::configure(long sample_rate, int seconds) {
+    const uint64_t capacity = static_cast<uint64_t>(std::max(sample_rate, 1L)) * std::max(seconds, 1);
+    if (capacity != capacity_) {
+        capacity_ = capacity;
+        output_.assign(static_cast<size_t>(capacity_) * 2, 0);
+        marks_.assign(MARK_COUNT, Mark{});
+    }
+    sample_rate_ = sample_rate;
+    reset();
+}
+
+void ScrubHistory::reset() {
+    output_written_ = 0;
+    marks_written_ = 0;
+    tap_written_ = 0;
+    // Freed, since the next source may have other channels or none
+    taps_.clear();
+    taps_.shrink_to_fit();
+    tap_channels_ = 0;
+}
+
+void ScrubHistory::pushOutput(const short* samples, int frames, bool mono, int64_t stream_frame) {
+    if (capacity_ == 0 || frames <= 0) return;
+
+    // A mark only where the clock jumps: untimed blocks, seeks, a new track
+    const Mark* last = marks_written_ ? &marks_[(marks_written_ - 1) % MARK_COUNT] : nullptr;
+    const bool continues = last && (stream_frame == UNTIMED
+                                        ? last->stream_frame == UNTIMED
+                                        : last->stream_frame != UNTIMED &&
+                                              last->stream_frame + static_cast<int64_t>(output_written_ - last->frame) ==
+                                                  stream_frame);
+    if (!continues) marks_[marks_written_++ % MARK_COUNT] = {output_written_, stream_frame};
+
+    // Only the newest capacity_ frames of a long block are kept
+    int first = 0;
+    if (static_cast<uint64_t>(frames) > capacity_) {
+        first = frames - static_cast<int>(capacity_);
+        output_written_ += static_cast<uint64_t>(first);
+    }
+    for (int i = first; i < frames;) {
+        const size_t dst = static_cast<size_t>(output_written_ % capacity_);
+        const int n = static_cast<int>(std::min<uint64_t>(frames - i, capacity_ - dst));
+        short* out = output_.data() + dst * 2;
+        if (mono) {
+            for (int j = 0; j < n; ++j) out[j * 2] = out[j * 2 + 1] = samples[i + j];
+        } else {
+            std::copy(samples + static_cast<size_t>(i) * 2, samples + static_cast<size_t>(i + n) * 2, out);
+        }
+        i += n;
+        output_written_ += static_cast<uint64_t>(n);
+    }
+}
+
+void ScrubHistory::pushTaps(const short* frames_data, int frames, int stride, int channels) {
+    if (capacity_ == 0 || frames <= 0 || channels <= 0) return;
+    if (tap_channels_ == 0) {
+        tap_channels_ = std::min(channels, stride);
+        taps_.assign(static_cast<size_t>(capacity_) * tap_channels_, 0);
+    }
+    const int kept = tap_channels_;
+    for (int i = 0; i < frames; ++i) {
+        short* out = taps_.data() + static_cast<size_t>(tap_written_ % capacity_) * kept;
+        const short* in = frames_data + static_cast<size_t>(i) * stride;
+        std::copy(in, in + kept, out);
+        ++tap_written_;
+    }
+}
+
+void ScrubHistory::readOutput(uint64_t end, int count, float* left, float* right) const {
+    end = std::min(end, output_written_);
+    const uint64_t start = outputStart();
+    for (int i = 0; i < count; ++i) {
+        const uint64_t frame = end - static_cast<uint64_t>(count - i);
+        if (end < static_cast<uint64_t>(count - i) || frame < start) {
+            left[i] = right[i] = 0.0f;
+            continue;
+        }
+        const short* in = output_.data() + static_cast<size_t>(frame % capacity_) * 2;
+        left[i] = in[0] * S16_SCALE;
+        right[i] = in[1] * S16_SCALE;
+    }
+}
+
+void ScrubHistory::readTap(int channel, uint64_t end, int count, float* out) const {
+    end = std::min(end, tap_written_);
+    const uint64_t start = tapStart();
+    for (int i = 0; i < count; ++i) {
+        const uint64_t frame = end - static_cast<uint64_t>(count - i);
+        if (channel >= tap_channels_ || end < static_cast<uint64_t>(count - i) || frame < start) {
+            out[i] = 0.0f;
+            continue;
+        }
+        out[i] = taps_[static_cast<size_t>(frame % capacity_) * tap_channels_ + channel] * S16_SCALE;
+    }
+}
+
+int64_t ScrubHistory::streamFrameAt(uint64_t frame) const {
+    // Newest mark at or before frame; marks are in frame order
+    const uint64_t held = std::min<uint64_t>(marks_written_, MARK_COUNT);
+    for (uint64_t back = 1; back <= held; ++back) {
+        const Mark& mark = marks_[(marks_written_ - back) % MARK_COUNT];
+        if (mark.frame > frame) continue;
+        if (mark.stream_frame == UNTIMED) return UNTIMED;
+        return mark.stream_frame + static_cast<int64_t>(frame - mark.frame);
+    }
+    return UNTIMED;
+}
+
+size_t ScrubHistory::memoryBytes() const {
+    return (output_.capacity() + taps_.capacity()) * sizeof(short) + marks_.capacity() * sizeof(Mark);
+}
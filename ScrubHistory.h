@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The last few seconds of what the visualizer was shown, kept as int16 so
+// that while playback is paused the scopes and spectra can be rebuilt at
+// any point in them without emulating anything again. Output frames are
+// stereo (a mono source stores each frame twice) and numbered from the
+// first ever pushed; blocks carry their playback-clock position, for the
+// time readout. Per-channel tap frames are numbered on their own, since
+// they reach the visualizer a render-ahead before the output does.
+class ScrubHistory {
+public:
+    static constexpr int64_t UNTIMED = -1;
+
+    // Room for seconds of sample_rate frames; clears what was held
+    void configure(long sample_rate, int seconds);
+    void reset();
+
+    // frames of interleaved stereo, or of mono; stream_frame is the first
+    // frame's position on the playback clock, or UNTIMED
+    void pushOutput(const short* samples, int frames, bool mono, int64_t stream_frame);
+    // frames of stride shorts each, of which the first channels are kept.
+    // The channel count is fixed by the first push after a reset.
+    void pushTaps(const short* frames_data, int frames, int stride, int channels);
+
+    // Frame numbers one past the newest and of the oldest still held
+    uint64_t outputEnd() const { return output_written_; }
+    uint64_t outputStart() const { return output_written_ - std::min<uint64_t>(output_written_, capacity_); }
+    uint64_t tapEnd() const { return tap_written_; }
+    uint64_t tapStart() const { return tap_written_ - std::min<uint64_t>(tap_written_, capacity_); }
+    int tapChannels() const { return tap_channels_; }
+    long sampleRate() const { return sample_rate_; }
+
+    // The count frames ending at frame end, -1..1; frames not held read 0
+    void readOutput(uint64_t end, int count, float* left, float* right) const;
+    void readTap(int channel, uint64_t end, int count, float* out) const;
+
+    // Playback-clock position of an output frame, or UNTIMED
+    int64_t streamFrameAt(uint64_t frame) const;
+
+    // Bytes held by the rings
+    size_t memoryBytes() const;
+
+private:
+    // Where a block's timing starts; blocks continuing the last mark's clock add none
+    struct Mark {
+        uint64_t frame;
+        int64_t stream_frame;
+    };
+    static constexpr size_t MARK_COUNT = 4096;
+
+    long sample_rate_ = 0;
+    uint64_t capacity_ = 0;            // Frames per ring
+    std::vector<short> output_;        // capacity_ stereo frames
+    uint64_t output_written_ = 0;
+    std::vector<short> taps_;          // capacity_ frames of tap_channels_, allocated on first use
+    int tap_channels_ = 0;
+    uint64_t tap_written_ = 0;
+    std::vector<Mark> marks_;          // Ring of MARK_COUNT
+    uint64_t marks_written_ = 0;
+};
@@ -0,0 +1,49 @@
+#include "SeekIndex.h"
+#include <algorithm>
+
+void SeekIndex::reset(int track, double tempo) {
+    keyframes_.clear();
+    track_ = track;
+    tempo_ = tempo;
+}
+
+long SeekIndex::snapshotTimeMs(const Nsf_Emu* nsf, const Nsf_Emu::snapshot_t& snapshot) {
+    // sample_time counts interleaved stereo samples
+    const long rate = nsf->sample_rate() * 2;
+    long sec = snapshot.sample_time / rate;
+    return sec * 1000 + (snapshot.sample_time - sec * rate) * 1000 / rate;
+}
+
+void SeekIndex::capture(Nsf_Emu* nsf) {
+    if (!nsf || !nsf->can_snapshot()) return;
+
+    auto snapshot = std::make_unique<Nsf_Emu::snapshot_t>();
+    nsf->save_snapshot(snapshot.get());
+    long time_ms = snapshotTimeMs(nsf, *snapshot);
+
+    // One keyframe per interval; playback after a seek may revisit covered ground
+    auto it = std::lower_bound(keyframes_.begin(), keyframes_.end(), time_ms,
+                               [](const Keyframe& k, long t) { return k.time_ms < t; });
+    long bucket = time_ms / interval_ms_;
+    if (it != keyframes_.end() && it->time_ms / interval_ms_ == bucket) return;
+    if (it != keyframes_.begin() && std::prev(it)->time_ms / interval_ms_ == bucket) return;
+
+    keyframes_.insert(it, Keyframe{time_ms, std::move(snapshot)});
+}
+
+bool SeekIndex::seek(Nsf_Emu* nsf, int track, double tempo, long target_ms) const {
+    if (!nsf || keyframes_.empty() || !matches(track, tempo)) return false;
+
+    // Last keyframe at or before the target
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), target_ms,
+                               [](long t, const Keyframe& k) { return t < k.time_ms; });
+    if (it == keyframes_.begin()) return false;
+    const Keyframe& key = *std::prev(it);
+
+    // Skipping forward from the current position may already be cheaper
+    long now_ms = nsf->tell();
+    if (now_ms <= target_ms && target_ms - now_ms <= target_ms - key.time_ms) return false;
+
+    nsf->load_snapshot(*key.snapshot);
+    return nsf->seek(target_ms) == nullptr;
+}
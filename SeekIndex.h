@@ -0,0 +1,48 @@
+#pragma once
+
+#include "gme/Nsf_Emu.h"
+#include <vector>
+#include <memory>
+
+// Keyframe index of Nsf_Emu snapshots for one track.
+// Keyframes are captured every interval while a track is played or
+// preprocessed; a seek restores the nearest earlier keyframe and only
+// emulates the remainder instead of re-running from the track start.
+class SeekIndex {
+public:
+    static constexpr long DEFAULT_INTERVAL_MS = 3000;
+
+    // Drop all keyframes and bind the index to a track/tempo combination
+    void reset(int track = -1, double tempo = 1.0);
+
+    // Snapshots are only valid for the track and tempo they were taken with
+    bool matches(int track, double tempo) const { return track_ == track && tempo_ == tempo; }
+
+    // Capture a keyframe if none exists yet for the emulator's current interval
+    void capture(Nsf_Emu* nsf);
+
+    // Seek nsf to target_ms through the nearest keyframe. Returns false when
+    // no keyframe helps or the index belongs to another track/tempo (caller
+    // should fall back to gme_seek).
+    bool seek(Nsf_Emu* nsf, int track, double tempo, long target_ms) const;
+
+    size_t size() const { return keyframes_.size(); }
+    size_t memoryBytes() const {
+        return keyframes_.capacity() * sizeof(Keyframe) + keyframes_.size() * sizeof(Nsf_Emu::snapshot_t);
+    }
+    long getInterval() const { return interval_ms_; }
+    void setInterval(long ms) { interval_ms_ = ms > 0 ? ms : DEFAULT_INTERVAL_MS; }
+
+private:
+    struct Keyframe {
+        long time_ms;
+        std::unique_ptr<Nsf_Emu::snapshot_t> snapshot;  // ~11 KB each
+    };
+
+    static long snapshotTimeMs(const Nsf_Emu* nsf, const Nsf_Emu::snapshot_t& snapshot);
+
+    std::vector<Keyframe> keyframes_;  // Sorted by time_ms
+    int track_ = -1;
+    double tempo_ = 1.0;
+    long interval_ms_ = DEFAULT_INTERVAL_MS;
+};
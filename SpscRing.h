@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+// Single-producer / single-consumer lock-free ring buffer.
+// Exactly one thread may call push() and exactly one other thread may call
+// pop()/discard(); neither side ever blocks or allocates. resize() and
+// clear() are not thread-safe and must only be used while both sides are idle.
+template <typename T>
+class SpscRing {
+public:
+    SpscRing() = default;
+    explicit SpscRing(size_t capacity) { resize(capacity); }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Allocate storage (rounded up to a power of two) and drop any contents
+    void resize(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        buffer_.assign(size, T{});
+        mask_ = size - 1;
+        clear();
+    }
+
+    void clear() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return buffer_.size(); }
+    size_t memoryBytes() const { return buffer_.capacity() * sizeof(T); }
+
+    // Producer side: copy up to count items in, returns the number written
+    size_t push(const T* data, size_t count) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t n = std::min(count, buffer_.size() - (head - tail));
+        if (n == 0) return 0;
+
+        const size_t start = head & mask_;
+        const size_t first = std::min(n, buffer_.size() - start);
+        std::memcpy(buffer_.data() + start, data, first * sizeof(T));
+        std::memcpy(buffer_.data(), data + first, (n - first) * sizeof(T));
+
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Producer side: like push(), but fill(dst, offset, n) writes items
+    // [offset, offset + n) straight into the ring, in at most two calls
+    template <typename Fill>
+    size_t pushInPlace(size_t count, Fill&& fill) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t n = std::min(count, buffer_.size() - (head - tail));
+        if (n == 0) return 0;
+
+        const size_t start = head & mask_;
+        const size_t first = std::min(n, buffer_.size() - start);
+        fill(buffer_.data() + start, size_t{0}, first);
+        if (n > first) fill(buffer_.data(), first, n - first);
+
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side: copy up to max_count items out, returns the number read
+    size_t pop(T* out, size_t max_count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t n = std::min(max_count, head - tail);
+        if (n == 0) return 0;
+
+        const size_t start = tail & mask_;
+        const size_t first = std::min(n, buffer_.size() - start);
+        std::memcpy(out, buffer_.data() + start, first * sizeof(T));
+        std::memcpy(out + first, buffer_.data(), (n - first) * sizeof(T));
+
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side: like pop(), but drain(src, offset, n) reads items
+    // [offset, offset + n) straight from the ring, in at most two calls
+    template <typename Drain>
+    size_t popInPlace(size_t max_count, Drain&& drain) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t n = std::min(max_count, head - tail);
+        if (n == 0) return 0;
+
+        const size_t start = tail & mask_;
+        const size_t first = std::min(n, buffer_.size() - start);
+        drain(static_cast<const T*>(buffer_.data() + start), size_t{0}, first);
+        if (n > first) drain(static_cast<const T*>(buffer_.data()), first, n - first);
+
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side: drop up to count of the oldest items, returns the number dropped
+    size_t skip(size_t count) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        const size_t n = std::min(count, head - tail);
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side: drop everything currently queued
+    void discard() {
+        tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Safe to call from either side, or a third thread (the value may be stale
+    // by the time it is used). The tail is loaded first: head only grows, so
+    // the difference never wraps, and the clamp covers the producer refilling
+    // behind a consumer that moved on between the two loads.
+    size_t readAvailable() const {
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t head = head_.load(std::memory_order_acquire);
+        return std::min(head - tail, buffer_.size());
+    }
+    size_t writeAvailable() const { return buffer_.size() - readAvailable(); }
+
+    // Items pushed / consumed since the last clear(), usable as stream positions
+    size_t writePosition() const { return head_.load(std::memory_order_acquire); }
+    size_t readPosition() const { return tail_.load(std::memory_order_acquire); }
+
+private:
+    std::vector<T> buffer_;
+    size_t mask_ = 0;
+
+    // Producer and consumer indices live on separate cache lines
+    alignas(64) std::atomic<size_t> head_{0};  // Next write position (producer)
+    alignas(64) std::atomic<size_t> tail_{0};  // Next read position (consumer)
+};
@@ -0,0 +1,283 @@
+#include "TelemetryExport.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+// "Audio callback" as a column, audio_callback
+std::string columnName(const char* name) {
+    std::string column;
+    for (const char* c = name; *c; ++c) {
+        column += std::isalnum(static_cast<unsigned char>(*c)) ? static_cast<char>(std::tolower(*c)) : '_';
+    }
+    return column;
+}
+
+// A record's line, as CSV or JSON writes it, and its names for the CSV header
+class Fields {
+public:
+    explicit Fields(bool json) : json_(json) {}
+
+    void add(const std::string& name, const char* value, bool quoted) {
+        if (!names_.empty()) {
+            line_ += json_ ? ", " : ",";
+            names_ += ',';
+        }
+        names_ += name;
+        if (json_) {
+            line_ += '"';
+            line_ += name;
+            line_ += "\": ";
+        }
+        if (quoted && json_) line_ += '"';
+        line_ += value;
+        if (quoted && json_) line_ += '"';
+    }
+    void add(const std::string& name, double value, int decimals) {
+        char text[48];
+        std::snprintf(text, sizeof(text), "%.*f", decimals, value);
+        add(name, text, false);
+    }
+    void add(const std::string& name, uint64_t value) {
+        char text[24];
+        std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+        add(name, text, false);
+    }
+
+    std::string line() const { return json_ ? "{" + line_ + "}\n" : line_ + "\n"; }
+    std::string names() const { return names_ + "\n"; }
+
+private:
+    bool json_;
+    std::string line_;
+    std::string names_;
+};
+
+// Every field of a record, in column order
+void addFields(Fields& f, const TelemetryExport::Record& r, int64_t time_ms, double uptime_s, uint64_t dropped) {
+    f.add("time_ms", static_cast<uint64_t>(time_ms));
+    f.add("uptime_s", uptime_s, 1);
+    f.add("mode", r.mode, true);
+    f.add("playing", static_cast<uint64_t>(r.playing));
+
+    const AudioTelemetry::Stats& a = r.audio;
+    f.add("audio_blocks", a.blocks);
+    f.add("audio_avg_us", a.avg_us, 1);
+    f.add("audio_p99_us", a.p99_us, 1);
+    f.add("audio_max_us", a.max_us, 1);
+    f.add("audio_budget_us", a.budget_us, 1);
+    f.add("deadline_misses", a.deadline_misses);
+    f.add("short_blocks", a.short_blocks);
+    f.add("missing_frames", a.missing_frames);
+    f.add("queue_frames", static_cast<uint64_t>(std::max(a.queue_frames, 0L)));
+    f.add("queue_capacity", static_cast<uint64_t>(std::max(a.queue_capacity, 0L)));
+    f.add("render_blocks", a.render_blocks);
+    f.add("render_avg_us", a.render_avg_us, 1);
+    f.add("render_max_us", a.render_max_us, 1);
+
+    f.add("frame_ms", r.frames.interval_ms, 2);
+    f.add("worst_frame_ms", r.frames.worst_interval_ms, 2);
+    for (int s = 0; s < FrameProfiler::SECTION_COUNT; ++s) {
+        f.add(columnName(FrameProfiler::sectionName(static_cast<FrameProfiler::Section>(s))) + "_ms",
+              r.frames.section_ms[s], 3);
+    }
+    f.add("gpu_frame_ms", r.frames.gpu_frame_ms, 3);
+    for (int p = 0; p < FrameProfiler::GPU_PASS_COUNT; ++p) {
+        f.add("gpu_" + columnName(FrameProfiler::gpuPassName(static_cast<FrameProfiler::GpuPass>(p))) + "_ms",
+              r.frames.gpu_ms[p], 3);
+    }
+
+    f.add("nes_run_ahead_ms", r.nes_run_ahead_ms, 3);
+    f.add("nes_skipped_frames", static_cast<uint64_t>(r.nes_skipped_frames));
+    f.add("nes_jitter_ms", r.nes_jitter_ms, 2);
+
+    const PreprocessStats& n = r.note_passes;
+    f.add("note_passes", static_cast<uint64_t>(n.passes));
+    f.add("note_realtime_factor", n.realtimeFactor(), 1);
+    f.add("note_emulated_s", n.emulated_seconds, 1);
+    f.add("note_wall_s", n.wall_seconds, 3);
+    f.add("note_emulate_s", n.emulate_seconds, 3);
+    f.add("note_extract_s", n.extract_seconds, 3);
+    f.add("note_sort_s", n.sort_seconds, 3);
+    f.add("note_count", n.notes);
+
+    for (int c = 0; c < MemoryReport::CATEGORY_COUNT; ++c) {
+        f.add("mem_" + columnName(MemoryReport::categoryName(static_cast<MemoryReport::Category>(c))),
+              static_cast<uint64_t>(r.memory.bytes[c]));
+    }
+    f.add("mem_total", static_cast<uint64_t>(r.memory.total()));
+    f.add("resident_bytes", static_cast<uint64_t>(r.resident_bytes));
+    f.add("dropped_records", dropped);
+}
+
+}  // namespace
+
+bool TelemetryExport::parseArgs(int argc, char** argv, Options* options, std::string* error) {
+    auto fail = [&](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--telemetry", 11) != 0) continue;
+        if (i + 1 >= argc) return fail(std::string(arg) + " needs a value");
+        const std::string value = argv[++i];
+        char* end = nullptr;
+        if (std::strcmp(arg, "--telemetry") == 0) {
+            options->path = value;
+        } else if (std::strcmp(arg, "--telemetry-format") == 0) {
+            if (value == "csv") {
+                options->format = Format::CSV;
+            } else if (value == "jsonl" || value == "json") {
+                options->format = Format::JSON_LINES;
+            } else {
+                return fail("--telemetry-format takes csv or jsonl");
+            }
+        } else if (std::strcmp(arg, "--telemetry-interval") == 0) {
+            const double seconds = std::strtod(value.c_str(), &end);
+            if (*end || seconds < 0.1) return fail("--telemetry-interval takes seconds, 0.1 or more");
+            options->interval_s = seconds;
+        } else if (std::strcmp(arg, "--telemetry-rotate-mb") == 0) {
+            const double mb = std::strtod(value.c_str(), &end);
+            if (*end || mb < 0.0) return fail("--telemetry-rotate-mb takes megabytes, 0 for no rotation");
+            options->rotate_bytes = static_cast<uint64_t>(mb * (1 << 20));
+        } else {
+            return fail(std::string("Unknown option ") + arg);
+        }
+    }
+    return true;
+}
+
+bool TelemetryExport::start(const Options& options, std::string* error) {
+    stop();
+    if (options.path.empty()) return true;
+    options_ = options;
+    if (options_.path == "-") {
+        file_ = stdout;
+        file_bytes_ = 0;
+    } else {
+        file_ = std::fopen(options_.path.c_str(), "ab");
+        if (!file_) {
+            if (error) *error = "Couldn't open " + options_.path + " for telemetry";
+            return false;
+        }
+        std::error_code ec;
+        file_bytes_ = std::filesystem::file_size(options_.path, ec);
+        if (ec) file_bytes_ = 0;
+    }
+    // A new file starts with its header; one appended to has it
+    if (file_bytes_ == 0 && options_.format == Format::CSV) {
+        const std::string line = header();
+        std::fwrite(line.data(), 1, line.size(), file_);
+        std::fflush(file_);
+        file_bytes_ += line.size();
+    }
+    active_ = true;
+    started_at_ = Clock::now();
+    next_at_ = started_at_;
+    return true;
+}
+
+void TelemetryExport::stop() {
+    if (!active_) return;
+    active_ = false;
+    // The job drains all that was submitted before it ends
+    JobPool::shared().wait(io_job_);
+    if (file_ && file_ != stdout) std::fclose(file_);
+    file_ = nullptr;
+}
+
+void TelemetryExport::submit(const Record& record, Clock::time_point now) {
+    if (!active_) return;
+    // On the schedule, not on the frame that happened to come after it
+    next_at_ += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.interval_s));
+    if (next_at_ <= now) next_at_ = now + std::chrono::duration_cast<Clock::duration>(
+                                              std::chrono::duration<double>(options_.interval_s));
+
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::swap(dropped, dropped_);
+    }
+    std::string line = format(record, dropped);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.size() >= MAX_PENDING) {
+        pending_.pop_front();
+        ++dropped_;
+    }
+    pending_.push_back(std::move(line));
+    kick();
+}
+
+std::string TelemetryExport::header() const {
+    Fields fields(false);
+    addFields(fields, Record(), 0, 0.0, 0);
+    return fields.names();
+}
+
+std::string TelemetryExport::format(const Record& record, uint64_t dropped) const {
+    const int64_t time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::system_clock::now().time_since_epoch())
+                                .count();
+    const double uptime_s = std::chrono::duration<double>(Clock::now() - started_at_).count();
+    Fields fields(options_.format == Format::JSON_LINES);
+    addFields(fields, record, time_ms, uptime_s, dropped);
+    return fields.line();
+}
+
+void TelemetryExport::kick() {
+    if (draining_) return;
+    draining_ = true;
+    JobPool::shared().submit(io_job_, JobPool::Priority::Low, [this]() { drain(); });
+}
+
+void TelemetryExport::drain() {
+    std::deque<std::string> lines;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!pending_.empty()) {
+        lines.swap(pending_);
+        lock.unlock();
+
+        for (const std::string& line : lines) {
+            if (options_.rotate_bytes && file_ != stdout && file_bytes_ + line.size() > options_.rotate_bytes &&
+                file_bytes_ > 0 && !rotate()) {
+                break;
+            }
+            if (!file_) break;
+            std::fwrite(line.data(), 1, line.size(), file_);
+            file_bytes_ += line.size();
+        }
+        if (file_) std::fflush(file_);
+        lines.clear();
+
+        lock.lock();
+    }
+    draining_ = false;
+}
+
+bool TelemetryExport::rotate() {
+    std::fclose(file_);
+    file_ = nullptr;
+    // path.N goes, the rest move up one, path becomes path.1
+    std::error_code ec;
+    const std::string& path = options_.path;
+    if (options_.keep_files > 0) {
+        std::filesystem::remove(path + "." + std::to_string(options_.keep_files), ec);
+        for (int n = options_.keep_files - 1; n >= 1; --n) {
+            std::filesystem::rename(path + "." + std::to_string(n), path + "." + std::to_string(n + 1), ec);
+        }
+        std::filesystem::rename(path, path + ".1", ec);
+    }
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) return false;
+    file_bytes_ = 0;
+    if (options_.format == Format::CSV) {
+        const std::string line = header();
+        std::fwrite(line.data(), 1, line.size(), file_);
+        file_bytes_ = line.size();
+    }
+    return true;
+}
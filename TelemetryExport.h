@@ -0,0 +1,98 @@
+#pragma once
+
+#include "AudioTelemetry.h"
+#include "FrameProfiler.h"
+#include "JobPool.h"
+#include "MemoryReport.h"
+#include "PianoVisualizer.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Performance counters written out every so often, for collecting kiosks'
+// numbers centrally: one record per interval of the audio callback and
+// render thread (AudioTelemetry), the NES thread, the Frame Profiler's
+// sections, the note passes and the memory report, as a CSV row or a JSON line, to a file
+// that rotates at a size, or to stdout. The UI thread takes the snapshot
+// from the counters' own readers and formats it, a few microseconds an
+// interval; an I/O job on the shared JobPool writes it, as BatterySave's
+// does, so no real-time thread goes near the disk. At most MAX_PENDING
+// records wait for a slow disk; beyond that the oldest are dropped, and
+// counted in the next record.
+class TelemetryExport {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Format { CSV, JSON_LINES };
+
+    static constexpr size_t MAX_PENDING = 64;
+
+    struct Options {
+        std::string path;  // "-" for stdout; empty for no export
+        Format format = Format::CSV;
+        double interval_s = 5.0;
+        uint64_t rotate_bytes = 8u << 20;  // A file this long moves to path.1; 0 never rotates
+        int keep_files = 3;                // path.1 up to path.keep_files
+    };
+
+    // The --telemetry options from a command line; arguments not for it are
+    // passed over. false with *error set on a bad value.
+    //   --telemetry PATH|-  --telemetry-format csv|jsonl
+    //   --telemetry-interval SECONDS  --telemetry-rotate-mb MB
+    static bool parseArgs(int argc, char** argv, Options* options, std::string* error);
+
+    struct Record {
+        const char* mode = "";  // "nsf" or "nes"
+        bool playing = false;
+        AudioTelemetry::Stats audio;
+        FrameProfiler::Averages frames;
+        float nes_run_ahead_ms = 0.0f;
+        uint32_t nes_skipped_frames = 0;
+        float nes_jitter_ms = 0.0f;
+        MemoryReport::Sample memory;
+        PreprocessStats note_passes;  // Of the loaded file, so far
+        size_t resident_bytes = 0;
+    };
+
+    TelemetryExport() = default;
+    ~TelemetryExport() { stop(); }
+    TelemetryExport(const TelemetryExport&) = delete;
+    TelemetryExport& operator=(const TelemetryExport&) = delete;
+
+    // UI thread. Open the file (appending), or take stdout; false with
+    // *error set if it cannot be opened
+    bool start(const Options& options, std::string* error);
+    // Write what is pending and close
+    void stop();
+    bool active() const { return active_; }
+
+    // UI thread, once a frame: whether a record is due, then the record
+    bool due(Clock::time_point now) const { return active_ && now >= next_at_; }
+    void submit(const Record& record, Clock::time_point now);
+
+private:
+    std::string format(const Record& record, uint64_t dropped) const;
+    std::string header() const;
+    void kick();   // Queue the I/O job unless it is running; mutex_ held
+    void drain();  // The I/O job: writes until nothing is pending
+    bool rotate(); // I/O job: path to path.1 and on, and a fresh file
+
+    Options options_;
+    bool active_ = false;
+    Clock::time_point started_at_{};
+    Clock::time_point next_at_{};
+
+    std::mutex mutex_;
+    JobPool::Group io_job_;
+    bool draining_ = false;
+    std::deque<std::string> pending_;  // Formatted records
+    uint64_t dropped_ = 0;             // Since the last record counted them
+
+    // I/O job, and start()/stop() once it is idle
+    std::FILE* file_ = nullptr;
+    uint64_t file_bytes_ = 0;
+};
@@ -0,0 +1,237 @@
+#include "ThreadScheduling.h"
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <avrt.h>
+#elif defined(__EMSCRIPTEN__)
+// Browser workers have no scheduling controls
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+#include <sys/qos.h>
+#else
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Linux nice value for High; the same as an interactive desktop session gets
+constexpr int HIGH_NICE = -10;
+
+// macOS time constraints: of each period the thread needs at most this
+// fraction of a core, within this fraction of it from waking
+constexpr double DEADLINE_COMPUTATION = 0.25;
+constexpr double DEADLINE_CONSTRAINT = 0.75;
+
+const char* priorityName(ThreadScheduling::Priority priority) {
+    switch (priority) {
+        case ThreadScheduling::Priority::Normal: return "OS default";
+        case ThreadScheduling::Priority::High: return "High";
+        case ThreadScheduling::Priority::Realtime: return "Real-time";
+    }
+    return "";
+}
+
+#if defined(_WIN32)
+
+// The cores the process may use
+DWORD_PTR processCores() {
+    DWORD_PTR process = 0, system = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process, &system) || process == 0) return ~DWORD_PTR(0);
+    return process;
+}
+
+bool setAffinity(DWORD_PTR mask) { return SetThreadAffinityMask(GetCurrentThread(), mask) != 0; }
+
+#elif !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+
+bool setAffinity(const cpu_set_t& cores) {
+    return pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) == 0;
+}
+
+// Nice is per thread on Linux, addressed by its thread ID
+bool setNice(int nice) { return setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice) == 0; }
+
+#endif
+
+}  // namespace
+
+ThreadScheduling::ThreadScheduling(const char* name, double period_ms, int fifo_priority)
+    : name_(name), period_ms_(period_ms), fifo_priority_(fifo_priority), status_(std::string(name) + ": OS default") {}
+
+void ThreadScheduling::request(Priority priority, int core) {
+    priority_.store(static_cast<int>(priority), std::memory_order_relaxed);
+    core_.store(core, std::memory_order_relaxed);
+    requested_.fetch_add(1, std::memory_order_release);
+}
+
+std::string ThreadScheduling::status() const {
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    return status_;
+}
+
+int ThreadScheduling::coreCount() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+bool ThreadScheduling::avoidCores(uint64_t excluded) {
+#if defined(_WIN32)
+    const DWORD_PTR all = processCores();
+    DWORD_PTR mask = all & ~static_cast<DWORD_PTR>(excluded);
+    return setAffinity(mask ? mask : all);
+#elif defined(__EMSCRIPTEN__) || defined(__APPLE__)
+    return excluded == 0;
+#else
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    const int count = std::min(coreCount(), CPU_SETSIZE);
+    for (int c = 0; c < count; ++c) {
+        if (c >= 64 || !((excluded >> c) & 1)) CPU_SET(c, &cores);
+    }
+    if (CPU_COUNT(&cores) == 0) {
+        for (int c = 0; c < count; ++c) CPU_SET(c, &cores);
+    }
+    return setAffinity(cores);
+#endif
+}
+
+void ThreadScheduling::poll() {
+    const uint32_t requested = requested_.load(std::memory_order_acquire);
+    if (requested == applied_) return;
+    applied_ = requested;
+
+    const Priority priority = this->priority();
+    const int core = this->core();
+    char status[160];
+    const char* got = priorityName(priority);
+    const char* note = "";
+
+#if defined(_WIN32)
+    if (mmcss_) {
+        AvRevertMmThreadCharacteristics(mmcss_);
+        mmcss_ = nullptr;
+    }
+    int level = THREAD_PRIORITY_NORMAL;
+    if (priority == Priority::Realtime) {
+        DWORD task = 0;
+        mmcss_ = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task);
+        if (mmcss_) {
+            AvSetMmThreadPriority(mmcss_, AVRT_PRIORITY_HIGH);
+            got = "MMCSS Pro Audio";
+        } else {
+            // The Multimedia Class Scheduler service is off
+            level = THREAD_PRIORITY_TIME_CRITICAL;
+            got = "Time critical";
+            note = " (MMCSS unavailable)";
+        }
+    } else if (priority == Priority::High) {
+        level = THREAD_PRIORITY_HIGHEST;
+    }
+    if (!mmcss_ && !SetThreadPriority(GetCurrentThread(), level)) {
+        got = "OS default";
+        note = " (priority refused)";
+    }
+
+    bool pinned = true;
+    if (core >= 0 && core < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+        pinned = setAffinity(DWORD_PTR(1) << core);
+    } else {
+        setAffinity(processCores());
+    }
+#elif defined(__EMSCRIPTEN__)
+    (void)period_ms_;
+    (void)fifo_priority_;
+    got = "Browser default";
+    if (priority != Priority::Normal) note = " (not available in the browser)";
+    bool pinned = core < 0;
+#elif defined(__APPLE__)
+    const thread_port_t thread = pthread_mach_thread_np(pthread_self());
+    (void)fifo_priority_;
+    if (priority == Priority::Realtime) {
+        mach_timebase_info_data_t timebase;
+        mach_timebase_info(&timebase);
+        const double units_per_ms = 1e6 * timebase.denom / timebase.numer;
+        thread_time_constraint_policy_data_t policy;
+        policy.period = static_cast<uint32_t>(period_ms_ * units_per_ms);
+        policy.computation = static_cast<uint32_t>(period_ms_ * DEADLINE_COMPUTATION * units_per_ms);
+        policy.constraint = static_cast<uint32_t>(period_ms_ * DEADLINE_CONSTRAINT * units_per_ms);
+        policy.preemptible = 1;
+        if (thread_policy_set(thread, THREAD_TIME_CONSTRAINT_POLICY, reinterpret_cast<thread_policy_t>(&policy),
+                              THREAD_TIME_CONSTRAINT_POLICY_COUNT) == KERN_SUCCESS) {
+            got = "Time constraint";
+        } else {
+            pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+            got = "User interactive";
+            note = " (time constraint refused)";
+        }
+    } else {
+        thread_standard_policy_data_t standard;
+        thread_policy_set(thread, THREAD_STANDARD_POLICY, reinterpret_cast<thread_policy_t>(&standard),
+                          THREAD_STANDARD_POLICY_COUNT);
+        pthread_set_qos_class_self_np(priority == Priority::High ? QOS_CLASS_USER_INTERACTIVE : QOS_CLASS_DEFAULT, 0);
+        if (priority == Priority::High) got = "User interactive";
+    }
+    (void)mmcss_;
+    bool pinned = core < 0;  // Cores are the OS's to pick
+#else
+    (void)period_ms_;
+    (void)mmcss_;
+    sched_param param{};
+    bool fifo = false;
+    if (priority == Priority::Realtime) {
+        param.sched_priority = std::clamp(fifo_priority_, sched_get_priority_min(SCHED_FIFO),
+                                          sched_get_priority_max(SCHED_FIFO));
+        fifo = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+        if (!fifo) note = " (SCHED_FIFO needs CAP_SYS_NICE or an rtprio limit)";
+    }
+    if (fifo) {
+        snprintf(status, sizeof(status), "SCHED_FIFO %d", param.sched_priority);
+        got = status;
+    } else {
+        // Back to the time-sharing class, niced as asked
+        param.sched_priority = 0;
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        const bool raise = priority != Priority::Normal;
+        if (setNice(raise ? HIGH_NICE : 0)) {
+            got = raise ? "Nice -10" : "OS default";
+        } else {
+            got = "OS default";
+            if (!*note) note = raise ? " (nice refused, needs CAP_SYS_NICE or a nice limit)" : "";
+        }
+    }
+
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    const int count = std::min(coreCount(), CPU_SETSIZE);
+    if (core >= 0 && core < count) {
+        CPU_SET(core, &cores);
+    } else {
+        for (int c = 0; c < count; ++c) CPU_SET(c, &cores);
+    }
+    const bool pinned = setAffinity(cores) ? core < count : core < 0;
+#endif
+
+    // got may point into status; copy it out first
+    const std::string level_name = got;
+    if (core >= 0) {
+        snprintf(status, sizeof(status), "%s: %s%s, %s %d", name_, level_name.c_str(), note,
+                 pinned ? "core" : "not pinned to core", core);
+    } else {
+        snprintf(status, sizeof(status), "%s: %s%s", name_, level_name.c_str(), note);
+    }
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    status_ = status;
+}
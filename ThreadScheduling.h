@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// OS scheduling for one time-critical thread (the render-ahead producer, the
+// NES emulation thread), so background load cannot starve it into an audio
+// dropout. The UI thread asks for a priority and optionally a core; the
+// thread itself applies them at its next poll(), since every OS sets these
+// on the calling thread:
+//
+//   Normal    the OS default
+//   High      Windows THREAD_PRIORITY_HIGHEST, Linux nice -10, macOS
+//             QOS_CLASS_USER_INTERACTIVE
+//   Realtime  Windows MMCSS "Pro Audio", Linux SCHED_FIFO, macOS time
+//             constraints of the thread's period
+//
+// What the OS refuses (SCHED_FIFO without CAP_SYS_NICE or an rtprio limit,
+// say) falls back a level, and status() says so. Cores are pinned on Windows
+// and Linux; macOS and the browser leave placement to the OS.
+class ThreadScheduling {
+public:
+    enum class Priority { Normal, High, Realtime };
+    static constexpr int ANY_CORE = -1;
+
+    // name for status(); period_ms how often the thread has a deadline, for
+    // macOS; fifo_priority its SCHED_FIFO priority on Linux
+    ThreadScheduling(const char* name, double period_ms, int fifo_priority);
+    ThreadScheduling(const ThreadScheduling&) = delete;
+    ThreadScheduling& operator=(const ThreadScheduling&) = delete;
+
+    // UI thread: what the thread should run at, from its next poll()
+    void request(Priority priority, int core);
+    Priority priority() const { return static_cast<Priority>(priority_.load(std::memory_order_relaxed)); }
+    int core() const { return core_.load(std::memory_order_relaxed); }
+
+    // The thread itself, once a loop: applies a request made since the last
+    // call, and costs one atomic load otherwise
+    void poll();
+
+    // What the last poll() got, e.g. "Render: SCHED_FIFO 60, core 3" (any thread)
+    std::string status() const;
+
+    // Logical cores the process may run on
+    static int coreCount();
+    // Keep the calling thread off the cores in excluded (bit per core, the
+    // first 64), or let it run anywhere again with 0
+    static bool avoidCores(uint64_t excluded);
+
+private:
+    const char* name_;
+    double period_ms_;
+    int fifo_priority_;
+
+    std::atomic<int> priority_{static_cast<int>(Priority::Normal)};
+    std::atomic<int> core_{ANY_CORE};
+    std::atomic<uint32_t> requested_{0};
+    uint32_t applied_ = 0;       // Owning thread
+    void* mmcss_ = nullptr;      // Owning thread: the MMCSS task handle while joined
+
+    mutable std::mutex status_mutex_;
+    std::string status_;
+};
@@ -0,0 +1,140 @@
+#include "Trace.h"
+
+#if FC_TRACE
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+namespace {
+
+struct Event {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> start{0};
+    std::atomic<int64_t> end{0};
+};
+
+// One thread writes a ring at a time; head counts every zone it ever took
+struct Ring {
+    std::array<Event, EVENTS_PER_THREAD> events;
+    std::atomic<uint64_t> head{0};
+    int tid = 0;
+};
+
+// Rings outlive their threads, so a trace still shows a worker that has
+// finished, and a new thread reuses a free ring rather than adding one:
+// the prefetch and loader threads come and go with every track. The trace's
+// thread ids are therefore rings, not OS threads.
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<Ring*> free;
+};
+
+Registry& registry() {
+    // Never destroyed: threads still running at exit return their rings
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+struct ThreadRing {
+    Ring* ring = nullptr;
+
+    ~ThreadRing() {
+        if (!ring) return;
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.free.push_back(ring);
+    }
+
+    Ring& get() {
+        if (ring) return *ring;
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (!reg.free.empty()) {
+            ring = reg.free.back();
+            reg.free.pop_back();
+        } else {
+            reg.rings.push_back(std::make_unique<Ring>());
+            ring = reg.rings.back().get();
+            ring->tid = static_cast<int>(reg.rings.size());
+        }
+        return *ring;
+    }
+};
+
+thread_local ThreadRing thread_ring;
+
+}  // namespace
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char* name, int64_t start, int64_t end) {
+    Ring& ring = thread_ring.get();
+    const uint64_t index = ring.head.load(std::memory_order_relaxed);
+    Event& event = ring.events[index % EVENTS_PER_THREAD];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    ring.head.store(index + 1, std::memory_order_release);
+}
+
+bool writeChromeJson(const std::string& path) {
+    struct Copy {
+        const char* name;
+        int64_t start;
+        int64_t end;
+        int tid;
+    };
+    std::vector<Copy> copies;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& ring : reg.rings) {
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            const uint64_t first = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+            const size_t base = copies.size();
+            for (uint64_t i = first; i < head; ++i) {
+                const Event& event = ring->events[i % EVENTS_PER_THREAD];
+                copies.push_back({event.name.load(std::memory_order_relaxed),
+                                  event.start.load(std::memory_order_relaxed),
+                                  event.end.load(std::memory_order_relaxed), ring->tid});
+            }
+            // Drop what the thread overwrote while it was copied. The event
+            // at head - EVENTS_PER_THREAD may be half written: still dropped.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t after = ring->head.load(std::memory_order_relaxed);
+            const uint64_t valid = after >= EVENTS_PER_THREAD ? after - EVENTS_PER_THREAD + 1 : 0;
+            if (valid > first) {
+                const size_t drop = static_cast<size_t>(std::min(valid, head) - first);
+                copies.erase(copies.begin() + static_cast<std::ptrdiff_t>(base),
+                             copies.begin() + static_cast<std::ptrdiff_t>(base + drop));
+            }
+        }
+    }
+
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    // Complete ("X") events in microseconds; names are literals and need no escaping
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", f);
+    for (size_t i = 0; i < copies.size(); ++i) {
+        const Copy& c = copies[i];
+        std::fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     i ? "," : "", c.name ? c.name : "?", c.tid, c.start / 1000.0, (c.end - c.start) / 1000.0);
+    }
+    std::fputs("\n]}\n", f);
+    return std::fclose(f) == 0;
+}
+
+}  // namespace Trace
+
+#endif
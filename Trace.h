@@ -0,0 +1,62 @@
+#pragma once
+
+// Scoped timing zones for a timeline of what every thread did, saved as a
+// Chrome trace (chrome://tracing, ui.perfetto.dev). Built with FC_TRACE
+// (cmake -DFC_TRACE=ON) a zone writes its name and start and end times into
+// its thread's ring of the last EVENTS_PER_THREAD zones; without it the
+// macros expand to nothing and this header declares nothing else.
+//
+//     void AudioVisualizer::processFFT(uint32_t end_pos) {
+//         FC_ZONE("processFFT");
+//         ...
+//
+// Names must be string literals (or otherwise outlive the trace).
+
+#ifndef FC_TRACE
+#define FC_TRACE 0
+#endif
+
+#if FC_TRACE
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Trace {
+
+constexpr int EVENTS_PER_THREAD = 1 << 15;
+
+// Nanoseconds on the steady clock
+int64_t now();
+
+// Append a finished zone to the calling thread's ring. Lock free; the
+// first zone on a thread takes a ring from the pool under a mutex.
+void record(const char* name, int64_t start, int64_t end);
+
+// Write what every ring holds as Chrome trace JSON; false if the file
+// could not be written. Any thread, while zones keep being recorded.
+bool writeChromeJson(const std::string& path);
+
+class Zone {
+public:
+    explicit Zone(const char* name) : name_(name), start_(now()) {}
+    ~Zone() { record(name_, start_, now()); }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_;
+};
+
+}  // namespace Trace
+
+#define FC_ZONE_CONCAT2(a, b) a##b
+#define FC_ZONE_CONCAT(a, b) FC_ZONE_CONCAT2(a, b)
+#define FC_ZONE(name) ::Trace::Zone FC_ZONE_CONCAT(fc_zone_, __LINE__)(name)
+
+#else
+
+#define FC_ZONE(name) ((void)0)
+
+#endif
@@ -0,0 +1,378 @@
+#include "TrackNoteStore.h"
+#include "ChannelProbe.h"
+#include "MidiExport.h"
+#include "NoteCache.h"
+#include "gme/gme.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+TrackNoteStore::TrackNoteStore() : cache_dir_(NoteCache::defaultDirectory()) {}
+
+void TrackNoteStore::start(std::shared_ptr<const MusicFile> file, int track_count, long sample_rate, int current) {
+    stop();
+    if (!file || track_count <= 0) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_ = std::move(file);
+    sample_rate_ = sample_rate;
+    file_hash_ = cache_dir_.empty() ? 0 : NoteCache::hashData(file_->data(), file_->size());
+    slots_.assign(static_cast<size_t>(track_count), Slot());
+    current_ = std::clamp(current, 0, track_count - 1);
+    done_ = 0;
+    pass_stats_ = PreprocessStats();
+    index_track_ = -1;
+    index_running_ = false;
+    index_ready_ = false;
+    index_.reset();
+    export_dir_.clear();
+    exported_ = 0;
+    cancel_.store(false);
+
+    // The pool keeps a worker for loads while these run
+    launch(std::clamp(JobPool::shared().threadCount(), 1, std::min(MAX_WORKERS, track_count)));
+}
+
+void TrackNoteStore::stop() {
+    cancel_.store(true);
+    JobPool::shared().cancel(jobs_);
+    JobPool::shared().wait(jobs_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    slots_.clear();
+    active_workers_ = 0;
+    done_ = 0;
+    pass_stats_ = PreprocessStats();
+    index_track_ = -1;
+    index_running_ = false;
+    index_ready_ = false;
+    index_.reset();
+    export_dir_.clear();
+    exported_ = 0;
+}
+
+void TrackNoteStore::setCurrentTrack(int track, bool build_index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (track < 0 || track >= static_cast<int>(slots_.size())) return;
+    current_ = track;
+
+    // A pass still running for another track finishes, but its keyframes are dropped
+    if (!build_index || index_track_ != track) {
+        index_track_ = build_index ? track : -1;
+        index_running_ = false;
+        index_ready_ = false;
+        index_.reset();
+    }
+
+    // Tracks left behind get read back from disk if they are wanted again
+    for (int t = 0; t < static_cast<int>(slots_.size()); ++t) {
+        if (slots_[t].on_disk && !resident(t)) slots_[t].notes.reset();
+    }
+
+    // Jobs stop once every track is done; a keyframe pass needs a new one
+    const bool pending = done_ < static_cast<int>(slots_.size()) || (index_track_ >= 0 && !index_ready_);
+    if (pending && active_workers_ == 0 && !cancel_.load()) {
+        launch(1);
+    }
+}
+
+std::shared_ptr<const PreprocessedTrack> TrackNoteStore::notes(int track) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (track < 0 || track >= static_cast<int>(slots_.size())) return nullptr;
+        const Slot& slot = slots_[track];
+        if (slot.notes || !slot.on_disk) return slot.notes;
+    }
+
+    // Evicted; the cache fields only change in start(), on this thread
+    PreprocessedTrack data;
+    const bool loaded = NoteCache::load(cache_dir_, file_hash_, track, sample_rate_, data);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slots_[track];
+    if (!loaded) {
+        // Gone from disk; work it out again
+        slot.on_disk = false;
+        slot.status = Slot::PENDING;
+        --done_;
+        if (active_workers_ == 0 && !cancel_.load()) launch(1);
+        return nullptr;
+    }
+    if (!slot.notes) slot.notes = std::make_shared<const PreprocessedTrack>(std::move(data));
+    return slot.notes;
+}
+
+bool TrackNoteStore::takeSeekIndex(int track, SeekIndex& index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!index_ready_ || index_track_ != track) return false;
+    index = std::move(index_);
+    index_.reset();
+    index_track_ = -1;
+    index_ready_ = false;
+    return true;
+}
+
+void TrackNoteStore::exportMidi(const std::string& dir, const std::string& stem) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slots_.empty() || dir.empty()) return;
+    export_dir_ = dir;
+    export_stem_ = stem;
+    exported_ = 0;
+    for (Slot& slot : slots_) {
+        slot.exported = false;
+    }
+    if (active_workers_ == 0 && !cancel_.load()) launch(1);
+}
+
+int TrackNoteStore::tracksExported() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return export_dir_.empty() ? -1 : exported_;
+}
+
+std::string TrackNoteStore::midiPath(int track) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "-%02d.mid", track + 1);
+    return (std::filesystem::path(export_dir_) / (export_stem_ + name)).string();
+}
+
+float TrackNoteStore::progress(int track) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (track < 0 || track >= static_cast<int>(slots_.size())) return -1.0f;
+    const Slot& slot = slots_[track];
+    return slot.status == Slot::WORKING ? slot.progress : -1.0f;
+}
+
+int TrackNoteStore::tracksDone() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_;
+}
+
+PreprocessStats TrackNoteStore::passStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pass_stats_;
+}
+
+int TrackNoteStore::trackCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(slots_.size());
+}
+
+void TrackNoteStore::reportMemory(MemoryReport::Sample& sample) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = MemoryReport::heapBytes(slots_);
+    for (const Slot& slot : slots_) {
+        if (!slot.notes) continue;
+        bytes += sizeof(PreprocessedTrack) + MemoryReport::heapBytes(slot.notes->notes) +
+                 MemoryReport::heapBytes(slot.notes->activity);
+    }
+    sample.add(MemoryReport::PIANO_NOTES, bytes);
+}
+
+bool TrackNoteStore::resident(int track) const {
+    const int count = static_cast<int>(slots_.size());
+    return track == current_ || (count > 0 && track == (current_ + 1) % count);
+}
+
+void TrackNoteStore::launch(int count) {
+    // Only called with no job active; mutex_ held
+    active_workers_ = count;
+    for (int i = 0; i < count; ++i) {
+        JobPool::shared().submit(jobs_, JobPool::Priority::Normal, [this]() { work(); });
+    }
+}
+
+int TrackNoteStore::nextTrack(bool& build_index, bool& export_only) {
+    build_index = false;
+    export_only = false;
+    if (cancel_.load()) return -1;
+
+    if (index_track_ >= 0 && !index_ready_ && !index_running_) {
+        index_running_ = true;
+        build_index = true;
+        Slot& slot = slots_[index_track_];
+        if (slot.status == Slot::PENDING) {
+            slot.status = Slot::WORKING;
+            slot.progress = 0.0f;
+        }
+        return index_track_;
+    }
+
+    const int count = static_cast<int>(slots_.size());
+    for (int k = 0; k < count; ++k) {
+        const int track = (current_ + k) % count;
+        Slot& slot = slots_[track];
+        if (slot.status == Slot::PENDING) {
+            slot.status = Slot::WORKING;
+            slot.progress = 0.0f;
+            return track;
+        }
+    }
+
+    // Tracks that were done before the export was asked for
+    if (!export_dir_.empty()) {
+        for (int k = 0; k < count; ++k) {
+            const int track = (current_ + k) % count;
+            Slot& slot = slots_[track];
+            if (slot.status == Slot::DONE && !slot.exported) {
+                slot.exported = true;
+                export_only = true;
+                return track;
+            }
+        }
+    }
+    return -1;
+}
+
+void TrackNoteStore::work() {
+    // file_, sample_rate_ and file_hash_ only change while no job runs.
+    // The emulator is opened at the first track the cache cannot supply.
+    Music_Emu* emu = nullptr;
+    bool emu_failed = false;
+    ChannelProbe probe;
+    ChannelTable layout;
+    PianoVisualizer piano;
+    SeekIndex index;
+
+    // An NSF's pass runs at the player's rate, as its keyframes are restored
+    // into the player and its notes are cached by that rate; it skips
+    // synthesis, so the rate costs nothing. Other types have no chips to
+    // sample but may still have to synthesise, at as low a rate as will do.
+    const gme_type_t type = identify_music_file(*file_);
+    const long emu_rate = type == gme_nsf_type || type == gme_nsfe_type
+                              ? sample_rate_
+                              : std::min(sample_rate_, PianoVisualizer::PREPROCESS_SAMPLE_RATE);
+
+    auto open_emu = [&]() {
+        if (emu || emu_failed) return;
+        gme_err_t err = open_music_emu(*file_, &emu, emu_rate);
+        emu_failed = err || !emu;
+        if (!emu_failed) {
+            probe = ChannelProbe::resolve(emu);
+            layout = ChannelTable::forProbe(probe);
+        }
+    };
+
+    int track = -1;
+    do {
+        bool build_index;
+        bool export_only;
+        std::string midi_path;
+        std::shared_ptr<const PreprocessedTrack> done_notes;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            track = nextTrack(build_index, export_only);
+            if (export_only) {
+                midi_path = midiPath(track);
+                done_notes = slots_[track].notes;
+            }
+        }
+        if (track < 0) break;
+
+        if (export_only) {
+            // The channel names come from the emulator's chips
+            PreprocessedTrack loaded;
+            const PreprocessedTrack* notes = done_notes.get();
+            if (!notes && NoteCache::load(cache_dir_, file_hash_, track, sample_rate_, loaded)) notes = &loaded;
+            open_emu();
+            const bool written = notes && emu && MidiExport::write(midi_path, *notes, layout);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (written) ++exported_;
+            continue;
+        }
+
+        // Keyframes need the emulator, notes may come from disk
+        PreprocessedTrack result;
+        PreprocessStats stats;
+        bool ok = !build_index && file_hash_ && NoteCache::load(cache_dir_, file_hash_, track, sample_rate_, result);
+        const bool cached = ok;
+        if (!cached) open_emu();
+        if (!cached && emu) {
+            index.reset(track, 1.0);
+            ok = piano.preprocessTrack(
+                emu,
+                track,
+                emu_rate,
+                layout,
+                [&probe](Music_Emu*, ChannelTable& table) {
+                    table.sample(probe);
+                },
+                probe.playInterval(),
+                [&](float p) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    slots_[track].progress = p;
+                },
+                [&](Music_Emu*) {
+                    if (build_index && probe.nsf) index.capture(probe.nsf);
+                    return !cancel_.load();
+                },
+                [&](PreprocessedTrack&& prefix) {
+                    // A keyframe re-run of a done track must not replace its notes
+                    auto published = std::make_shared<const PreprocessedTrack>(std::move(prefix));
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (slots_[track].status == Slot::WORKING && resident(track)) {
+                        slots_[track].notes = std::move(published);
+                    }
+                },
+                &stats
+            );
+            result = piano.takePreprocessedData();
+        }
+        if (cancel_.load()) break;
+        if (stats.passes) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pass_stats_.add(stats);
+        }
+        const bool on_disk = ok && (cached || (file_hash_ && NoteCache::store(cache_dir_, file_hash_, track, sample_rate_, result)));
+
+        // Written straight from the pass's notes. The slot is claimed first;
+        // an export asked for meanwhile writes the track again as a done one.
+        bool export_now;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            export_now = !export_dir_.empty() && slots_[track].status != Slot::DONE;
+            if (export_now) {
+                slots_[track].exported = true;
+                midi_path = midiPath(track);
+            }
+        }
+        if (export_now && ok) {
+            open_emu();
+            const bool written = emu && MidiExport::write(midi_path, result, layout);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (written) ++exported_;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& slot = slots_[track];
+        if (slot.status != Slot::DONE) {
+            slot.status = Slot::DONE;
+            slot.on_disk = on_disk;
+            slot.notes.reset();
+            if (ok && (resident(track) || !on_disk)) {
+                slot.notes = std::make_shared<const PreprocessedTrack>(std::move(result));
+            }
+            ++done_;
+        }
+        if (build_index && index_running_ && index_track_ == track) {
+            // Only NSF emulators can snapshot; the others never get keyframes
+            index_running_ = false;
+            if (emu && probe.nsf) {
+                index_ = std::move(index);
+                index_ready_ = true;
+            } else {
+                index_track_ = -1;
+            }
+        }
+    } while (false);
+    if (emu) {
+        gme_delete(emu);
+    }
+
+    // The next track is another job, so loads and other work get a turn
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (track >= 0 && !cancel_.load()) {
+        JobPool::shared().submit(jobs_, JobPool::Priority::Normal, [this]() { work(); });
+    } else {
+        --active_workers_;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ChannelTaps.h"
+#include "JobPool.h"
+#include "PianoVisualizer.h"
+#include "SeekIndex.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Piano notes for every track of the loaded file, worked out in the
+// background. Up to MAX_WORKERS jobs on the shared JobPool, each on its own
+// emulator, preprocess the tracks in priority order (the playing one, the
+// next, then the rest in order), a track per job, and keep the results per
+// track, so a track switch finds its roll
+// ready; a track still in progress shows the prefix published so far.
+// Results are kept in a NoteCache across runs, and only the playing and
+// next tracks stay in memory; the others are read back from the cache when
+// asked for. The pass over the playing track can also capture seek keyframes,
+// and every track can be written out as MIDI as its notes become available.
+class TrackNoteStore {
+public:
+    static constexpr int MAX_WORKERS = 8;
+
+    TrackNoteStore();
+    ~TrackNoteStore() { stop(); }
+
+    // Preprocess every track of file, starting with current
+    void start(std::shared_ptr<const MusicFile> file, int track_count, long sample_rate, int current);
+    // Cancel the passes in flight, wait for their jobs and drop all results
+    void stop();
+
+    // Move track to the front of the queue. With build_index its pass also
+    // captures seek keyframes (at 1.0x), re-running it if its notes are done.
+    void setCurrentTrack(int track, bool build_index);
+
+    // Notes of a track: complete once it is done, a growing prefix while it
+    // runs, nullptr before the first prefix or if it failed. A new pointer
+    // means new data. May read an evicted track back from disk.
+    std::shared_ptr<const PreprocessedTrack> notes(int track);
+    // Keyframes asked for by setCurrentTrack, once they are complete
+    bool takeSeekIndex(int track, SeekIndex& index);
+
+    // Write every track as dir/stem-NN.mid: tracks done so far are read back
+    // and written by a worker, the rest as their passes finish
+    void exportMidi(const std::string& dir, const std::string& stem);
+    // Tracks written since the last exportMidi(), -1 when none was asked for
+    int tracksExported() const;
+
+    // Progress of a track's pass (0..1), -1 when none is running
+    float progress(int track) const;
+    int tracksDone() const;
+    int trackCount() const;
+    // Over the passes run since start(); tracks read from the cache count for nothing
+    PreprocessStats passStats() const;
+
+    // Notes held in memory, over every track
+    void reportMemory(MemoryReport::Sample& sample) const;
+
+private:
+    struct Slot {
+        enum Status { PENDING, WORKING, DONE };
+        Status status = PENDING;
+        float progress = 0.0f;
+        bool on_disk = false;  // Done and in the cache, notes may be evicted
+        bool exported = false; // Written as MIDI, or claimed by a worker to be
+        std::shared_ptr<const PreprocessedTrack> notes;
+    };
+
+    bool resident(int track) const;  // Kept in memory: the playing or the next track; mutex_ held
+
+    void launch(int count);
+    // One track's pass or MIDI file, then the job queues itself again while
+    // tracks are left
+    void work();
+    // Claims a track, -1 when none is left; mutex_ held. export_only: a done
+    // track whose notes only need writing as MIDI.
+    int nextTrack(bool& build_index, bool& export_only);
+    std::string midiPath(int track) const;  // mutex_ held
+
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+    JobPool::Group jobs_;
+    std::atomic<bool> cancel_{false};
+    int active_workers_ = 0;  // Jobs queued or running
+    int current_ = 0;
+    int done_ = 0;
+    PreprocessStats pass_stats_;
+    std::shared_ptr<const MusicFile> file_;
+    long sample_rate_ = 0;
+    std::string cache_dir_;    // Empty disables the on-disk cache
+    uint64_t file_hash_ = 0;   // Of file_'s contents, 0 without a cache
+
+    // Keyframe pass of the playing track
+    int index_track_ = -1;
+    bool index_running_ = false;
+    bool index_ready_ = false;
+    SeekIndex index_;
+
+    // MIDI export, empty dir while none is asked for
+    std::string export_dir_;
+    std::string export_stem_;
+    int exported_ = 0;
+};
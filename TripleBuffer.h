@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Lock-free hand-off of whole values from one producer to one consumer.
+// The producer fills back() and publish()es it; the consumer acquire()s the
+// newest published value into front(). Neither side ever waits or copies:
+// the three slots just rotate, and a value published before the consumer
+// took the last one replaces it. Slots live on the heap, so large frames
+// don't bloat the owner.
+//
+// Producer calls may come from different threads if something else (a
+// mutex) orders them; the same goes for the consumer side.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : slots_(new T[3]()) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer side: the slot to fill next
+    T& back() { return slots_[back_]; }
+
+    // Producer side: make back() the newest value and take a free slot
+    void publish() {
+        back_ = middle_.exchange(static_cast<uint8_t>(back_ | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer side: move the newest value into front(); false if nothing
+    // was published since the last call
+    bool acquire() {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // Consumer side: the value last acquired
+    const T& front() const { return slots_[front_]; }
+
+    // A published value is waiting for acquire() (any thread)
+    bool pending() const { return middle_.load(std::memory_order_acquire) & FRESH; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    std::unique_ptr<T[]> slots_;
+    uint8_t back_ = 0;                 // Producer's
+    uint8_t front_ = 1;                // Consumer's
+    std::atomic<uint8_t> middle_{2};   // Slot in between, plus FRESH
+};
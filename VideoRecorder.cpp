@@ -0,0 +1,157 @@
+#include "VideoRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+constexpr size_t FILE_BUFFER = 1 << 20;  // stdio buffer for the video
+
+}  // namespace
+
+VideoRecorder::~VideoRecorder() {
+    stop();
+}
+
+bool VideoRecorder::start(const std::string& stem, long sample_rate, int width, int height, std::string* error) {
+    stop();
+    width &= ~1;
+    height &= ~1;
+    if (width <= 0 || height <= 0) {
+        if (error) *error = "Nothing to record";
+        return false;
+    }
+    const std::string video_path = stem + ".y4m";
+    video_file_ = std::fopen(video_path.c_str(), "wb");
+    if (!video_file_) {
+        if (error) *error = "Could not create " + video_path;
+        return false;
+    }
+    std::setvbuf(video_file_, nullptr, _IOFBF, FILE_BUFFER);
+    sample_rate_ = sample_rate;
+    width_ = width;
+    height_ = height;
+
+    // C420jpeg: chroma sited between each 2x2 block, as convertFrame() averages
+    std::fprintf(video_file_, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width_, height_, FPS);
+
+    // Everything the threads touch is sized here, before recording_ lets them in
+    const size_t frame_bytes = static_cast<size_t>(width_) * height_ * 4;
+    pool_.resize(POOL_FRAMES);
+    for (Frame& frame : pool_) frame.pixels.assign(frame_bytes, 0);
+    free_.resize(POOL_FRAMES);
+    full_.resize(POOL_FRAMES);
+    for (int i = 0; i < POOL_FRAMES; ++i) free_.push(&i, 1);
+    const size_t luma = static_cast<size_t>(width_) * height_;
+    yuv_.assign(luma + luma / 2, 128);
+    std::fill(yuv_.begin(), yuv_.begin() + luma, 16);  // Black until the first frame
+    video_written_.store(0);
+    frames_dropped_.store(0);
+
+    if (!audio_.start(stem + ".wav", sample_rate_, error)) {
+        std::fclose(video_file_);
+        video_file_ = nullptr;
+        return false;
+    }
+    stopping_.store(false);
+    recording_.store(true, std::memory_order_release);
+    writer_ = std::thread(&VideoRecorder::writerLoop, this);
+    return true;
+}
+
+void VideoRecorder::stop() {
+    if (!writer_.joinable()) return;
+    // The audio's final length first, for the writer to pad the video to
+    recording_.store(false, std::memory_order_release);
+    audio_.stop();
+    stopping_.store(true, std::memory_order_release);
+    writer_.join();
+
+    std::fclose(video_file_);
+    video_file_ = nullptr;
+}
+
+void VideoRecorder::submitFrame(const void* pixels, int width, int height, int row_pitch, bool bgra,
+                                int64_t audio_frame) {
+    if (!isRecording()) return;
+    int index = 0;
+    if (width < width_ || height < height_ || free_.pop(&index, 1) == 0) {
+        frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Frame& frame = pool_[index];
+    const uint8_t* src = static_cast<const uint8_t*>(pixels);
+    const size_t row_bytes = static_cast<size_t>(width_) * 4;
+    for (int y = 0; y < height_; ++y) {
+        std::memcpy(frame.pixels.data() + y * row_bytes, src + static_cast<size_t>(y) * row_pitch, row_bytes);
+    }
+    frame.bgra = bgra;
+    frame.audio_frame = std::max<int64_t>(audio_frame, 0);
+    full_.push(&index, 1);
+}
+
+void VideoRecorder::writerLoop() {
+    for (;;) {
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+        bool busy = false;
+        int index = 0;
+        while (full_.pop(&index, 1) == 1) {
+            // Slots before this picture was heard still show the one before
+            const Frame& frame = pool_[index];
+            writeVideoUntil(frame.audio_frame);
+            convertFrame(frame);
+            free_.push(&index, 1);
+            busy = true;
+        }
+        if (stopping) {
+            writeVideoUntil(audio_.framesWritten());
+            return;
+        }
+        if (!busy) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+// BT.601 studio range, chroma averaged over each 2x2 block
+void VideoRecorder::convertFrame(const Frame& frame) {
+    const int r_at = frame.bgra ? 2 : 0;
+    const int b_at = frame.bgra ? 0 : 2;
+    const size_t luma = static_cast<size_t>(width_) * height_;
+    uint8_t* y_plane = yuv_.data();
+    uint8_t* u_plane = y_plane + luma;
+    uint8_t* v_plane = u_plane + luma / 4;
+    for (int y = 0; y < height_; y += 2) {
+        const uint8_t* rows[2] = {
+            frame.pixels.data() + static_cast<size_t>(y) * width_ * 4,
+            frame.pixels.data() + static_cast<size_t>(y + 1) * width_ * 4,
+        };
+        for (int x = 0; x < width_; x += 2) {
+            int r_sum = 0, g_sum = 0, b_sum = 0;
+            for (int dy = 0; dy < 2; ++dy) {
+                for (int dx = 0; dx < 2; ++dx) {
+                    const uint8_t* p = rows[dy] + (x + dx) * 4;
+                    const int r = p[r_at], g = p[1], b = p[b_at];
+                    y_plane[static_cast<size_t>(y + dy) * width_ + x + dx] =
+                        static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                    r_sum += r;
+                    g_sum += g;
+                    b_sum += b;
+                }
+            }
+            const size_t c = static_cast<size_t>(y / 2) * (width_ / 2) + x / 2;
+            u_plane[c] = static_cast<uint8_t>(((-38 * r_sum - 74 * g_sum + 112 * b_sum + 512) >> 10) + 128);
+            v_plane[c] = static_cast<uint8_t>(((112 * r_sum - 94 * g_sum - 18 * b_sum + 512) >> 10) + 128);
+        }
+    }
+}
+
+// Video frame k covers audio from k * rate / FPS; write the picture for
+// every frame starting before audio_frame
+void VideoRecorder::writeVideoUntil(int64_t audio_frame) {
+    int64_t k = video_written_.load(std::memory_order_relaxed);
+    while (k * sample_rate_ / FPS < audio_frame) {
+        std::fputs("FRAME\n", video_file_);
+        std::fwrite(yuv_.data(), 1, yuv_.size(), video_file_);
+        ++k;
+    }
+    video_written_.store(k, std::memory_order_relaxed);
+}
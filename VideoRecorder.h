@@ -0,0 +1,88 @@
+#pragma once
+
+#include "SpscRing.h"
+#include "WavRecorder.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records what the window shows and what the audio device plays, as a
+// YUV4MPEG2 video and a WAV file side by side (<stem>.y4m, <stem>.wav),
+// for muxing afterwards:
+//
+//   ffmpeg -i rec.y4m -i rec.wav -c:v libx264 -c:a aac rec.mp4
+//
+// Presented frames come read back from the swapchain and are copied into a
+// small pool that a writer thread converts and writes; the sound goes
+// through a WavRecorder, so neither the UI nor the audio thread waits on
+// the disk. The video has a constant FPS on the audio clock: frame
+// k shows the newest picture heard by sample k * rate / FPS, repeated or
+// dropped as the display pacing needs, so it stays in sync with the sound.
+class VideoRecorder {
+public:
+    static constexpr int FPS = 60;
+    static constexpr int POOL_FRAMES = 4;   // Captured frames waiting for the writer
+
+    VideoRecorder() = default;
+    ~VideoRecorder();
+    VideoRecorder(const VideoRecorder&) = delete;
+    VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+    // Open <stem>.y4m and <stem>.wav for width x height frames (cropped to
+    // even sizes) of stereo audio at sample_rate; false with error set if a
+    // file could not be created. UI thread, as are stop() and submitFrame().
+    bool start(const std::string& stem, long sample_rate, int width, int height, std::string* error);
+    // Pad the video to the audio's length, finish both files and join the writer
+    void stop();
+    bool isRecording() const { return recording_.load(std::memory_order_acquire); }
+
+    // A presented frame, and the position in the recorded audio (frames
+    // since start()) being heard as it was presented. Copied into a free
+    // pool slot; dropped if there is none or its size is not the recording's.
+    void submitFrame(const void* pixels, int width, int height, int row_pitch, bool bgra, int64_t audio_frame);
+
+    // Audio thread: the device buffer as it will play, interleaved stereo
+    void pushAudio(const float* samples, int frames) { audio_.push(samples, frames); }
+    // Frames pushed since start(); any thread
+    int64_t audioFrames() const { return audio_.framesPushed(); }
+
+    // Any thread, for the status line
+    int64_t videoFramesWritten() const { return video_written_.load(std::memory_order_relaxed); }
+    uint32_t framesDropped() const { return frames_dropped_.load(std::memory_order_relaxed); }
+    uint32_t audioOverruns() const { return audio_.overruns(); }
+    long sampleRate() const { return audio_.sampleRate(); }
+
+private:
+    struct Frame {
+        std::vector<uint8_t> pixels;  // width_ * height_ * 4, top row first
+        bool bgra = true;
+        int64_t audio_frame = 0;
+    };
+
+    void writerLoop();
+    void convertFrame(const Frame& frame);
+    void writeVideoUntil(int64_t audio_frame);
+
+    std::thread writer_;
+    std::atomic<bool> recording_{false};
+    std::atomic<bool> stopping_{false};
+    FILE* video_file_ = nullptr;
+    long sample_rate_ = 44100;
+    int width_ = 0;
+    int height_ = 0;
+
+    // Pool slots go UI -> writer through full_ and back through free_
+    std::vector<Frame> pool_;
+    SpscRing<int> free_;
+    SpscRing<int> full_;
+    WavRecorder audio_;
+
+    // Writer thread
+    std::vector<uint8_t> yuv_;       // The picture the video shows now, I420
+
+    std::atomic<int64_t> video_written_{0};
+    std::atomic<uint32_t> frames_dropped_{0};
+};
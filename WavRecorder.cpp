@@ -0,0 +1,138 @@
+#include "WavRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+constexpr size_t FILE_BUFFER = 1 << 20;  // stdio buffer, a few chunks
+constexpr long HEADER_SIZE = 44;
+
+void put16(unsigned char* out, uint32_t value) {
+    out[0] = static_cast<unsigned char>(value);
+    out[1] = static_cast<unsigned char>(value >> 8);
+}
+
+void put32(unsigned char* out, uint32_t value) {
+    put16(out, value & 0xFFFF);
+    put16(out + 2, value >> 16);
+}
+
+// 16-bit stereo PCM header for frames frames
+void wavHeader(unsigned char* out, long rate, int64_t frames) {
+    const uint32_t data_size = static_cast<uint32_t>(std::min<int64_t>(frames * 4, UINT32_MAX - 36));
+    std::memcpy(out, "RIFF", 4);
+    put32(out + 4, 36 + data_size);
+    std::memcpy(out + 8, "WAVEfmt ", 8);
+    put32(out + 16, 16);
+    put16(out + 20, 1);  // PCM
+    put16(out + 22, 2);  // Channels
+    put32(out + 24, static_cast<uint32_t>(rate));
+    put32(out + 28, static_cast<uint32_t>(rate * 4));
+    put16(out + 32, 4);
+    put16(out + 34, 16);
+    std::memcpy(out + 36, "data", 4);
+    put32(out + 40, data_size);
+}
+
+}  // namespace
+
+WavRecorder::~WavRecorder() {
+    stop();
+}
+
+bool WavRecorder::start(const std::string& path, long sample_rate, std::string* error) {
+    stop();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        if (error) *error = "Could not create " + path;
+        return false;
+    }
+    std::setvbuf(file_, nullptr, _IOFBF, FILE_BUFFER);
+    sample_rate_ = sample_rate;
+    unsigned char header[HEADER_SIZE];
+    wavHeader(header, sample_rate_, 0);
+    std::fwrite(header, 1, sizeof(header), file_);
+
+    // Sized before recording_ lets the audio thread in. Pushes are whole
+    // stereo frames into an even capacity, so the ring never splits one.
+    ring_.resize(static_cast<size_t>(sample_rate_) * 2 * RING_SECONDS);
+    pcm_.resize(CHUNK_FRAMES * 2);
+    padded_ = 0;
+    pushed_.store(0);
+    dropped_.store(0);
+    written_.store(0);
+    overruns_.store(0);
+
+    stopping_.store(false);
+    recording_.store(true, std::memory_order_release);
+    writer_ = std::thread(&WavRecorder::writerLoop, this);
+    return true;
+}
+
+void WavRecorder::stop() {
+    if (!writer_.joinable()) return;
+    recording_.store(false, std::memory_order_release);
+    stopping_.store(true, std::memory_order_release);
+    writer_.join();
+
+    unsigned char header[HEADER_SIZE];
+    wavHeader(header, sample_rate_, written_.load());
+    std::fseek(file_, 0, SEEK_SET);
+    std::fwrite(header, 1, sizeof(header), file_);
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+void WavRecorder::push(const float* samples, int frames) {
+    if (!isRecording()) return;
+    const size_t pushed = ring_.push(samples, static_cast<size_t>(frames) * 2) / 2;
+    if (pushed < static_cast<size_t>(frames)) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        dropped_.fetch_add(frames - static_cast<int64_t>(pushed), std::memory_order_relaxed);
+    }
+    pushed_.fetch_add(frames, std::memory_order_release);
+}
+
+void WavRecorder::writerLoop() {
+    auto last_write = std::chrono::steady_clock::now();
+    for (;;) {
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+        const auto now = std::chrono::steady_clock::now();
+        const bool due = now - last_write >= std::chrono::milliseconds(WRITE_INTERVAL_MS);
+        if (drain(stopping || due)) last_write = now;
+        if (stopping) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+// Convert and write whole chunks, or everything when all is set; frames the
+// audio thread dropped go in as silence where the writer notices them
+bool WavRecorder::drain(bool all) {
+    bool wrote = false;
+    const int64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped > padded_) {
+        std::fill(pcm_.begin(), pcm_.end(), int16_t{0});
+        for (int64_t left = dropped - padded_; left > 0;) {
+            const int64_t n = std::min<int64_t>(left, CHUNK_FRAMES);
+            std::fwrite(pcm_.data(), sizeof(int16_t) * 2, static_cast<size_t>(n), file_);
+            written_.fetch_add(n, std::memory_order_relaxed);
+            left -= n;
+        }
+        padded_ = dropped;
+        wrote = true;
+    }
+    for (;;) {
+        const size_t available = ring_.readAvailable();
+        if (available == 0 || (!all && available < pcm_.size())) break;
+        const size_t samples = ring_.popInPlace(pcm_.size(), [&](const float* src, size_t offset, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                pcm_[offset + i] = static_cast<int16_t>(std::clamp(src[i], -1.0f, 1.0f) * 32767.0f);
+            }
+        });
+        std::fwrite(pcm_.data(), sizeof(int16_t), samples, file_);
+        written_.fetch_add(static_cast<int64_t>(samples / 2), std::memory_order_relaxed);
+        wrote = true;
+    }
+    return wrote;
+}
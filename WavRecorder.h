@@ -0,0 +1,63 @@
+#pragma once
+
+#include "SpscRing.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams what the audio device plays to a 16-bit stereo WAV file. The
+// audio callback only copies its finished buffer into a lock-free ring; a
+// writer thread empties the ring in large chunks, so no file I/O happens
+// on the audio thread. Samples that do not fit are counted as an overrun
+// and written as silence, so what follows keeps its place in time.
+class WavRecorder {
+public:
+    static constexpr int RING_SECONDS = 4;
+    static constexpr int CHUNK_FRAMES = 16384;  // Writer waits for this much, or WRITE_INTERVAL_MS
+    static constexpr int WRITE_INTERVAL_MS = 100;
+
+    WavRecorder() = default;
+    ~WavRecorder();
+    WavRecorder(const WavRecorder&) = delete;
+    WavRecorder& operator=(const WavRecorder&) = delete;
+
+    // Create path and start the writer; false with error set if the file
+    // could not be created. UI thread, as is stop().
+    bool start(const std::string& path, long sample_rate, std::string* error);
+    // Write out what is left, fill in the header and join the writer
+    void stop();
+    bool isRecording() const { return recording_.load(std::memory_order_acquire); }
+
+    // Audio thread: the device buffer as it will play, interleaved stereo
+    void push(const float* samples, int frames);
+
+    // Frames pushed since start(), including any dropped; any thread
+    int64_t framesPushed() const { return pushed_.load(std::memory_order_acquire); }
+    // Frames in the file, silence for drops included; final once stop() returns
+    int64_t framesWritten() const { return written_.load(std::memory_order_relaxed); }
+    uint32_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+    long sampleRate() const { return sample_rate_; }
+
+private:
+    void writerLoop();
+    bool drain(bool all);
+
+    std::thread writer_;
+    std::atomic<bool> recording_{false};
+    std::atomic<bool> stopping_{false};
+    FILE* file_ = nullptr;
+    long sample_rate_ = 44100;
+    SpscRing<float> ring_;
+
+    // Writer thread
+    std::vector<int16_t> pcm_;
+    int64_t padded_ = 0;  // Dropped frames already written as silence
+
+    std::atomic<int64_t> pushed_{0};
+    std::atomic<int64_t> dropped_{0};
+    std::atomic<int64_t> written_{0};
+    std::atomic<uint32_t> overruns_{0};
+};
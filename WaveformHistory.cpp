@@ -0,0 +1,125 @@
+#include "WaveformHistory.h"
+#include <algorithm>
+#include <limits>
+
+static_assert(WaveformHistory::FANOUT == 16, "samplesPerEntry() assumes 4 bits per level");
+
+static constexpr float EMPTY_LO = std::numeric_limits<float>::infinity();
+static constexpr float EMPTY_HI = -std::numeric_limits<float>::infinity();
+
+WaveformHistory::WaveformHistory() {
+    for (int i = 0; i < LEVELS; ++i) {
+        const size_t entries = size_t(1) << LEVEL_BITS[i];
+        levels_[i].lo.assign(entries, 0.0f);
+        if (i > 0) levels_[i].hi.assign(entries, 0.0f);
+        levels_[i].mask = static_cast<uint32_t>(entries - 1);
+    }
+    reset();
+}
+
+void WaveformHistory::reset() {
+    for (Level& level : levels_) {
+        std::fill(level.lo.begin(), level.lo.end(), 0.0f);
+        std::fill(level.hi.begin(), level.hi.end(), 0.0f);
+        level.written = 0;
+        level.part_lo = EMPTY_LO;
+        level.part_hi = EMPTY_HI;
+        level.part_count = 0;
+    }
+}
+
+void WaveformHistory::push(const float* samples, int count) {
+    Level& raw = levels_[0];
+    Level& first = levels_[1];
+    for (int i = 0; i < count;) {
+        // Raw samples a run at a time, up to the end of level 1's entry
+        const int n = std::min(count - i, FANOUT - first.part_count);
+        float lo = first.part_lo;
+        float hi = first.part_hi;
+        for (int k = 0; k < n; ++k) {
+            const float v = samples[i + k];
+            raw.lo[(raw.written + k) & raw.mask] = v;
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+        raw.written += n;
+        i += n;
+        first.part_lo = lo;
+        first.part_hi = hi;
+        first.part_count += n;
+        if (first.part_count == FANOUT) commit(1);
+    }
+}
+
+void WaveformHistory::commit(int index) {
+    Level& level = levels_[index];
+    const uint32_t at = level.written++ & level.mask;
+    level.lo[at] = level.part_lo;
+    level.hi[at] = level.part_hi;
+
+    if (index + 1 < LEVELS) {
+        Level& up = levels_[index + 1];
+        up.part_lo = std::min(up.part_lo, level.part_lo);
+        up.part_hi = std::max(up.part_hi, level.part_hi);
+        if (++up.part_count == FANOUT) commit(index + 1);
+    }
+    level.part_lo = EMPTY_LO;
+    level.part_hi = EMPTY_HI;
+    level.part_count = 0;
+}
+
+uint64_t WaveformHistory::available() const {
+    // Samples still in the accumulating top entry are held by the finer levels
+    const Level& top = levels_[LEVELS - 1];
+    const uint64_t top_samples = std::min<uint64_t>(top.written, top.mask + uint64_t(1)) * samplesPerEntry(LEVELS - 1);
+    const uint64_t raw_samples = std::min<uint64_t>(levels_[0].written, levels_[0].mask + uint64_t(1));
+    return std::max(top_samples, raw_samples);
+}
+
+size_t WaveformHistory::memoryBytes() const {
+    size_t bytes = 0;
+    for (const Level& level : levels_) {
+        bytes += (level.lo.capacity() + level.hi.capacity()) * sizeof(float);
+    }
+    return bytes;
+}
+
+int WaveformHistory::summarize(uint64_t span, int columns, float* lo, float* hi) const {
+    if (columns <= 0 || span == 0) return 0;
+
+    // Coarsest level that still gives every column at least one entry, so a
+    // column never aggregates more than FANOUT entries below the top level
+    int index = 0;
+    for (int i = LEVELS - 1; i > 0; --i) {
+        if (span / samplesPerEntry(i) >= static_cast<uint64_t>(columns)) {
+            index = i;
+            break;
+        }
+    }
+    // A finer level whose ring is too short for the span hands over to the next
+    while (index + 1 < LEVELS && (levels_[index].mask + uint64_t(1)) * samplesPerEntry(index) < span) {
+        ++index;
+    }
+    const Level& level = levels_[index];
+    const uint64_t held = std::min<uint64_t>(level.written, level.mask + uint64_t(1));
+    const uint64_t entries = std::min(held, span / samplesPerEntry(index));
+    if (entries == 0) return 0;
+    columns = static_cast<int>(std::min<uint64_t>(columns, entries));
+
+    const float* src_lo = level.lo.data();
+    const float* src_hi = index > 0 ? level.hi.data() : level.lo.data();
+    const uint64_t start = level.written - entries;
+    for (int c = 0; c < columns; ++c) {
+        const uint64_t begin = start + entries * c / columns;
+        const uint64_t end = start + entries * (c + 1) / columns;
+        float l = src_lo[begin & level.mask];
+        float h = src_hi[begin & level.mask];
+        for (uint64_t e = begin + 1; e < end; ++e) {
+            l = std::min(l, src_lo[e & level.mask]);
+            h = std::max(h, src_hi[e & level.mask]);
+        }
+        lo[c] = l;
+        hi[c] = h;
+    }
+    return columns;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Min/max summary pyramid over several seconds of one signal, so a scope
+// can be drawn at any zoom in O(pixels). Level 0 keeps raw samples; each
+// level above keeps the min and max of FANOUT entries of the one below.
+// Updated incrementally as samples arrive; memory is fixed at construction.
+class WaveformHistory {
+public:
+    static constexpr int LEVELS = 3;
+    static constexpr int FANOUT = 16;  // 1, 16, 256 samples per entry
+
+    WaveformHistory();
+
+    void reset();
+    void push(const float* samples, int count);
+
+    // Samples still held by the coarsest level
+    uint64_t available() const;
+
+    // Bytes held by the levels
+    size_t memoryBytes() const;
+
+    // Min and max of each of `columns` equal slices of the newest `span`
+    // samples (clamped to available()). Returns the columns filled, fewer
+    // than asked when the span holds fewer entries than that.
+    int summarize(uint64_t span, int columns, float* lo, float* hi) const;
+
+private:
+    struct Level {
+        std::vector<float> lo;
+        std::vector<float> hi;       // Empty on level 0, where lo is the sample
+        uint32_t mask = 0;
+        uint64_t written = 0;        // Entries written so far
+        float part_lo = 0.0f;        // Entry being accumulated (levels above 0)
+        float part_hi = 0.0f;
+        int part_count = 0;
+    };
+
+    static constexpr std::array<int, LEVELS> LEVEL_BITS = {15, 15, 13};  // log2 entries kept
+
+    void commit(int level);
+    static uint64_t samplesPerEntry(int level) { return uint64_t(1) << (4 * level); }
+
+    std::array<Level, LEVELS> levels_;
+};
@@ -0,0 +1,104 @@
+#include "WebAudio.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/webaudio.h>
+#include <atomic>
+#include <cstdint>
+
+namespace {
+
+constexpr int MAX_CHANNELS = 2;
+constexpr uint32_t WORKLET_STACK_SIZE = 64 * 1024;
+const char* const PROCESSOR_NAME = "fc-visualizer-output";
+
+struct Output {
+    EMSCRIPTEN_WEBAUDIO_T context = 0;
+    EMSCRIPTEN_AUDIO_WORKLET_NODE_T node = 0;
+    WebAudio::StreamCallback callback = nullptr;
+    void* user_data = nullptr;
+    int channels = 2;
+    std::atomic<bool> active{false};  // Checked by the worklet each quantum
+};
+
+Output output;
+alignas(16) uint8_t worklet_stack[WORKLET_STACK_SIZE];
+
+// Worklet thread: the stream callback writes interleaved, Web Audio wants planar
+bool processAudio(int, const AudioSampleFrame*, int num_outputs, AudioSampleFrame* outputs, int,
+                  const AudioParamFrame*, void*) {
+    if (num_outputs < 1) return true;
+    AudioSampleFrame& out = outputs[0];
+    const int frames = WebAudio::QUANTUM_FRAMES;
+    if (!output.active.load(std::memory_order_acquire)) {
+        for (int i = 0; i < frames * out.numberOfChannels; ++i) out.data[i] = 0.0f;
+        return true;
+    }
+
+    float interleaved[WebAudio::QUANTUM_FRAMES * MAX_CHANNELS];
+    output.callback(interleaved, frames, output.channels, output.user_data);
+    for (int c = 0; c < out.numberOfChannels; ++c) {
+        const int from = c < output.channels ? c : output.channels - 1;
+        float* plane = out.data + c * frames;
+        for (int i = 0; i < frames; ++i) plane[i] = interleaved[i * output.channels + from];
+    }
+    return true;
+}
+
+void processorCreated(EMSCRIPTEN_WEBAUDIO_T context, bool success, void*) {
+    if (!success || context != output.context) return;
+    int output_channels[1] = {output.channels};
+    EmscriptenAudioWorkletNodeCreateOptions options = {};
+    options.numberOfInputs = 0;
+    options.numberOfOutputs = 1;
+    options.outputChannelCounts = output_channels;
+    output.node = emscripten_create_wasm_audio_worklet_node(context, PROCESSOR_NAME, &options, processAudio, nullptr);
+    emscripten_audio_node_connect(output.node, context, 0, 0);
+    output.active.store(true, std::memory_order_release);
+}
+
+void workletStarted(EMSCRIPTEN_WEBAUDIO_T context, bool success, void*) {
+    if (!success || context != output.context) return;
+    WebAudioWorkletProcessorCreateOptions options = {};
+    options.name = PROCESSOR_NAME;
+    emscripten_create_wasm_audio_worklet_processor_async(context, &options, processorCreated, nullptr);
+}
+
+}  // namespace
+
+bool WebAudio::setup(long sample_rate, int num_channels, StreamCallback callback, void* user_data) {
+    if (output.context) return true;
+    output.callback = callback;
+    output.user_data = user_data;
+    output.channels = num_channels < 1 ? 1 : (num_channels > MAX_CHANNELS ? MAX_CHANNELS : num_channels);
+
+    EmscriptenWebAudioCreateAttributes attributes = {};
+    attributes.latencyHint = "interactive";
+    attributes.sampleRate = static_cast<uint32_t>(sample_rate);
+    output.context = emscripten_create_audio_context(&attributes);
+    if (!output.context) return false;
+
+    // The worklet thread gets its own stack in the shared heap
+    emscripten_start_wasm_audio_worklet_thread_async(output.context, worklet_stack, sizeof(worklet_stack),
+                                                     workletStarted, nullptr);
+    return true;
+}
+
+void WebAudio::shutdown() {
+    if (!output.context) return;
+    output.active.store(false, std::memory_order_release);
+    emscripten_destroy_audio_context(output.context);
+    output.context = 0;
+    output.node = 0;
+}
+
+bool WebAudio::isValid() {
+    return output.context != 0;
+}
+
+void WebAudio::resume() {
+    if (output.context && emscripten_audio_context_state(output.context) != AUDIO_CONTEXT_STATE_RUNNING) {
+        emscripten_resume_audio_context_sync(output.context);
+    }
+}
+
+#endif
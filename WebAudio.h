@@ -0,0 +1,35 @@
+#pragma once
+
+// Audio output for the web build: the sokol_audio stream callback, run on
+// an AudioWorklet instead of the page's main thread. gme and agnes already
+// render on their own threads (Web Workers under emscripten's pthreads)
+// into SpscRings in the shared wasm heap, a SharedArrayBuffer, so the
+// worklet only copies finished samples out and ImGui frames that run late
+// never starve the device. Needs -sAUDIO_WORKLET=1 -sWASM_WORKERS=1 and a
+// page served cross-origin isolated (COOP/COEP) for SharedArrayBuffer.
+#ifdef __EMSCRIPTEN__
+
+class WebAudio {
+public:
+    // As saudio_desc::stream_userdata_cb: fill num_frames interleaved frames
+    using StreamCallback = void (*)(float* buffer, int num_frames, int num_channels, void* user_data);
+
+    // Web Audio renders in quanta of this many frames
+    static constexpr int QUANTUM_FRAMES = 128;
+
+    // Create the context at sample_rate (the browser resamples to the
+    // device) and start the worklet; the callback runs once it is up and
+    // the context has been resumed. False if there is no Web Audio.
+    static bool setup(long sample_rate, int num_channels, StreamCallback callback, void* user_data);
+    // Stop calling back and close the context
+    static void shutdown();
+    static bool isValid();
+
+    // Browsers keep a context suspended until a user gesture; call from
+    // input events, it does nothing once running
+    static void resume();
+
+    static int bufferFrames() { return QUANTUM_FRAMES; }
+};
+
+#endif
@@ -0,0 +1,565 @@
+#include "ZipArchive.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+
+namespace {
+
+constexpr uint32_t LOCAL_SIGNATURE = 0x04034b50;
+constexpr uint32_t CENTRAL_SIGNATURE = 0x02014b50;
+constexpr uint32_t END_SIGNATURE = 0x06054b50;
+constexpr size_t LOCAL_HEADER_SIZE = 30;
+constexpr size_t CENTRAL_HEADER_SIZE = 46;
+constexpr size_t END_RECORD_SIZE = 22;
+constexpr size_t MAX_COMMENT = 0xFFFF;
+constexpr uint16_t METHOD_STORED = 0;
+constexpr uint16_t METHOD_DEFLATED = 8;
+constexpr uint16_t FLAG_ENCRYPTED = 0x0001;
+constexpr uint64_t MAX_DEFLATE_RATIO = 1032;  // Longest a deflate stream can expand, per input byte
+
+uint16_t le16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+uint32_t le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+           static_cast<uint32_t>(p[3]) << 24;
+}
+
+// CRC-32 as zip entries use it, the same as FrameEncoder's for PNG
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Canonical Huffman code of a deflate block. Codes of up to FAST_BITS bits
+// are decoded by one lookup of the next bits, as sym | length << 9 (0 for
+// none); longer ones walk count/symbol bit by bit, as zlib's puff does.
+struct Huffman {
+    static constexpr int MAX_BITS = 15;
+    static constexpr int FAST_BITS = 9;
+    std::array<uint16_t, MAX_BITS + 1> count{};
+    std::array<uint16_t, 288> symbol{};
+    std::array<uint16_t, 1 << FAST_BITS> fast{};
+
+    // false if the lengths over-subscribe the code; an incomplete code is
+    // allowed (one distance code is), and its gaps fail to decode
+    bool build(const uint8_t* lengths, int n) {
+        count.fill(0);
+        fast.fill(0);
+        for (int s = 0; s < n; ++s) ++count[lengths[s]];
+        count[0] = 0;
+        int left = 1;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            left = (left << 1) - count[len];
+            if (left < 0) return false;
+        }
+        std::array<uint16_t, MAX_BITS + 1> offset{};
+        for (int len = 1; len < MAX_BITS; ++len) offset[len + 1] = static_cast<uint16_t>(offset[len] + count[len]);
+        for (int s = 0; s < n; ++s) {
+            if (lengths[s]) symbol[offset[lengths[s]]++] = static_cast<uint16_t>(s);
+        }
+
+        // Codes count up in (length, symbol) order, and arrive bit-reversed
+        uint32_t code = 0;
+        int index = 0;
+        for (int len = 1; len <= FAST_BITS; ++len) {
+            for (int i = 0; i < count[len]; ++i, ++code) {
+                uint32_t reversed = 0;
+                for (int b = 0; b < len; ++b) reversed |= ((code >> b) & 1u) << (len - 1 - b);
+                const uint16_t packed = static_cast<uint16_t>(symbol[index + i] | len << 9);
+                for (uint32_t at = reversed; at < fast.size(); at += 1u << len) fast[at] = packed;
+            }
+            index += count[len];
+            code <<= 1;
+        }
+        return true;
+    }
+};
+
+// RFC 1951 into a buffer of the size the directory promised
+class Inflater {
+public:
+    Inflater(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size)
+        : in_(in), in_size_(in_size), out_(out), out_size_(out_size) {}
+
+    bool run() {
+        bool last = false;
+        while (!last) {
+            if (!need(3)) return false;
+            last = take(1) != 0;
+            const uint32_t type = take(2);
+            bool ok = false;
+            if (type == 0) {
+                ok = stored();
+            } else if (type == 1) {
+                ok = codes(fixedLengths(), fixedDistances());
+            } else if (type == 2) {
+                ok = dynamic();
+            }
+            if (!ok) return false;
+        }
+        return out_pos_ == out_size_;
+    }
+
+private:
+    // At least n bits in the buffer, up to 32; false past the input's end
+    bool need(int n) {
+        while (bit_count_ < n) {
+            if (in_pos_ == in_size_) return false;
+            bit_buffer_ |= static_cast<uint32_t>(in_[in_pos_++]) << bit_count_;
+            bit_count_ += 8;
+        }
+        return true;
+    }
+    uint32_t take(int n) {
+        const uint32_t value = bit_buffer_ & ((1u << n) - 1u);
+        bit_buffer_ >>= n;
+        bit_count_ -= n;
+        return value;
+    }
+    bool bits(int n, uint32_t* value) {
+        if (!need(n)) return false;
+        *value = take(n);
+        return true;
+    }
+
+    // A symbol of h, or -1
+    int decode(const Huffman& h) {
+        // Whatever bits there are, for the lookup
+        while (bit_count_ <= 24 && in_pos_ < in_size_) {
+            bit_buffer_ |= static_cast<uint32_t>(in_[in_pos_++]) << bit_count_;
+            bit_count_ += 8;
+        }
+        const uint16_t packed = h.fast[bit_buffer_ & ((1u << Huffman::FAST_BITS) - 1u)];
+        const int len = packed >> 9;
+        if (packed && len <= bit_count_) {
+            take(len);
+            return packed & 0x1FF;
+        }
+        int code = 0, first = 0, index = 0;
+        for (int l = 1; l <= Huffman::MAX_BITS; ++l) {
+            if (!need(1)) return -1;
+            code |= static_cast<int>(take(1));
+            const int count = h.count[l];
+            if (code - count < first) return h.symbol[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+    bool stored() {
+        // To the byte boundary, handing back the whole bytes read ahead
+        take(bit_count_ & 7);
+        in_pos_ -= static_cast<size_t>(bit_count_ / 8);
+        bit_buffer_ = 0;
+        bit_count_ = 0;
+        if (in_size_ - in_pos_ < 4) return false;
+        const uint16_t len = le16(in_ + in_pos_);
+        if (static_cast<uint16_t>(~le16(in_ + in_pos_ + 2)) != len) return false;
+        in_pos_ += 4;
+        if (in_size_ - in_pos_ < len || out_size_ - out_pos_ < len) return false;
+        std::memcpy(out_ + out_pos_, in_ + in_pos_, len);
+        in_pos_ += len;
+        out_pos_ += len;
+        return true;
+    }
+
+    bool codes(const Huffman& lengths, const Huffman& distances) {
+        static constexpr uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                     31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static constexpr uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                     2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static constexpr uint16_t DISTANCE_BASE[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                                       33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                                       1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static constexpr uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                       6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        for (;;) {
+            const int symbol = decode(lengths);
+            if (symbol < 0) return false;
+            if (symbol < 256) {
+                if (out_pos_ == out_size_) return false;
+                out_[out_pos_++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == 256) return true;
+            const int l = symbol - 257;
+            uint32_t extra = 0;
+            if (l >= 29 || !bits(LENGTH_EXTRA[l], &extra)) return false;
+            const size_t length = LENGTH_BASE[l] + extra;
+            const int d = decode(distances);
+            if (d < 0 || d >= 30 || !bits(DISTANCE_EXTRA[d], &extra)) return false;
+            const size_t distance = DISTANCE_BASE[d] + extra;
+            if (distance > out_pos_ || out_size_ - out_pos_ < length) return false;
+            // Byte by byte: a match may overlap what it is copying
+            const uint8_t* from = out_ + out_pos_ - distance;
+            uint8_t* to = out_ + out_pos_;
+            for (size_t i = 0; i < length; ++i) to[i] = from[i];
+            out_pos_ += length;
+        }
+    }
+
+    bool dynamic() {
+        static constexpr uint8_t ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        uint32_t nlen = 0, ndist = 0, ncode = 0;
+        if (!bits(5, &nlen) || !bits(5, &ndist) || !bits(4, &ncode)) return false;
+        nlen += 257;
+        ndist += 1;
+        ncode += 4;
+        if (nlen > 286 || ndist > 30) return false;
+
+        uint8_t lengths[286 + 30] = {};
+        for (uint32_t i = 0; i < ncode; ++i) {
+            uint32_t len = 0;
+            if (!bits(3, &len)) return false;
+            lengths[ORDER[i]] = static_cast<uint8_t>(len);
+        }
+        Huffman code_lengths;
+        if (!code_lengths.build(lengths, 19)) return false;
+
+        std::memset(lengths, 0, sizeof(lengths));
+        for (uint32_t i = 0; i < nlen + ndist;) {
+            const int symbol = decode(code_lengths);
+            if (symbol < 0) return false;
+            if (symbol < 16) {
+                lengths[i++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            uint8_t value = 0;
+            uint32_t repeat = 0;
+            if (symbol == 16) {
+                if (i == 0 || !bits(2, &repeat)) return false;
+                value = lengths[i - 1];
+                repeat += 3;
+            } else if (symbol == 17) {
+                if (!bits(3, &repeat)) return false;
+                repeat += 3;
+            } else {
+                if (!bits(7, &repeat)) return false;
+                repeat += 11;
+            }
+            if (i + repeat > nlen + ndist) return false;
+            while (repeat--) lengths[i++] = value;
+        }
+        if (lengths[256] == 0) return false;  // No end of block
+
+        Huffman literal_lengths, distances;
+        if (!literal_lengths.build(lengths, static_cast<int>(nlen)) ||
+            !distances.build(lengths + nlen, static_cast<int>(ndist))) {
+            return false;
+        }
+        return codes(literal_lengths, distances);
+    }
+
+    static const Huffman& fixedLengths() {
+        static const Huffman h = [] {
+            uint8_t lengths[288];
+            std::fill(lengths, lengths + 144, 8);
+            std::fill(lengths + 144, lengths + 256, 9);
+            std::fill(lengths + 256, lengths + 280, 7);
+            std::fill(lengths + 280, lengths + 288, 8);
+            Huffman built;
+            built.build(lengths, 288);
+            return built;
+        }();
+        return h;
+    }
+    static const Huffman& fixedDistances() {
+        static const Huffman h = [] {
+            uint8_t lengths[30];
+            std::fill(lengths, lengths + 30, 5);
+            Huffman built;
+            built.build(lengths, 30);
+            return built;
+        }();
+        return h;
+    }
+
+    const uint8_t* in_;
+    size_t in_size_;
+    size_t in_pos_ = 0;
+    uint32_t bit_buffer_ = 0;
+    int bit_count_ = 0;
+    uint8_t* out_;
+    size_t out_size_;
+    size_t out_pos_ = 0;
+};
+
+// Inflate buffers, reused across entries: a track change reads the next
+// entry into the buffer the last one gave back
+struct BufferPool {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> free;
+
+    std::unique_ptr<std::vector<uint8_t>> take(size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // The smallest that fits, else the largest, to grow
+        auto best = free.end();
+        for (auto it = free.begin(); it != free.end(); ++it) {
+            if (best == free.end()) {
+                best = it;
+                continue;
+            }
+            const size_t have = (*best)->capacity(), capacity = (*it)->capacity();
+            if (have < size ? capacity > have : capacity >= size && capacity < have) best = it;
+        }
+        if (best == free.end()) return std::make_unique<std::vector<uint8_t>>();
+        std::unique_ptr<std::vector<uint8_t>> buffer = std::move(*best);
+        free.erase(best);
+        return buffer;
+    }
+    void give(std::vector<uint8_t>* buffer) {
+        std::unique_ptr<std::vector<uint8_t>> owned(buffer);
+        if (owned->capacity() > ZipArchive::POOLED_BUFFER_MAX) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free.size() < ZipArchive::POOLED_BUFFERS) free.push_back(std::move(owned));
+    }
+};
+
+BufferPool& bufferPool() {
+    static BufferPool* pool = new BufferPool;  // Never destroyed: file views may outlive statics
+    return *pool;
+}
+
+struct CachedArchive {
+    std::string path;
+    int64_t mtime;
+    uint64_t size;
+    std::shared_ptr<const ZipArchive> archive;
+};
+
+// Most recently opened first
+struct ArchiveCache {
+    std::mutex mutex;
+    std::vector<CachedArchive> archives;
+};
+
+ArchiveCache& archiveCache() {
+    static ArchiveCache* cache = new ArchiveCache;
+    return *cache;
+}
+
+bool endsWithZip(const std::string& text, size_t end) {
+    if (end < 4) return false;
+    static constexpr char EXT[] = ".zip";
+    for (size_t i = 0; i < 4; ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[end - 4 + i])) != EXT[i]) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool ZipArchive::isArchive(const std::string& path) {
+    return endsWithZip(path, path.size());
+}
+
+bool ZipArchive::splitEntryPath(const std::string& path, std::string* archive, std::string* entry) {
+    // The first '#' after a .zip; a '#' elsewhere in a name is a plain character
+    for (size_t at = path.find(ENTRY_SEPARATOR); at != std::string::npos; at = path.find(ENTRY_SEPARATOR, at + 1)) {
+        if (!endsWithZip(path, at) || at + 1 == path.size()) continue;
+        if (archive) *archive = path.substr(0, at);
+        if (entry) *entry = path.substr(at + 1);
+        return true;
+    }
+    return false;
+}
+
+std::string ZipArchive::entryPath(const std::string& archive, const std::string& entry) {
+    return archive + ENTRY_SEPARATOR + entry;
+}
+
+std::shared_ptr<const ZipArchive> ZipArchive::open(const std::string& path, const char** error) {
+    if (error) *error = nullptr;
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    const uint64_t size = ec ? 0 : std::filesystem::file_size(path, ec);
+    if (ec) {
+        if (error) *error = "Couldn't open file";
+        return nullptr;
+    }
+    const int64_t stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count();
+
+    ArchiveCache& cache = archiveCache();
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (auto it = cache.archives.begin(); it != cache.archives.end(); ++it) {
+            if (it->path != path) continue;
+            if (it->mtime == stamp && it->size == size) {
+                std::rotate(cache.archives.begin(), it, it + 1);
+                return cache.archives.front().archive;
+            }
+            cache.archives.erase(it);  // Changed since: parsed again below
+            break;
+        }
+    }
+
+    // Parsed outside the lock; two threads racing on one archive both parse it
+    std::shared_ptr<ZipArchive> archive(new ZipArchive);
+    archive->path_ = path;
+    archive->file_ = MappedFile::open(path.c_str(), error);
+    if (!archive->file_ || !archive->parse(error)) return nullptr;
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.archives.erase(std::remove_if(cache.archives.begin(), cache.archives.end(),
+                                        [&](const CachedArchive& cached) { return cached.path == path; }),
+                         cache.archives.end());
+    cache.archives.insert(cache.archives.begin(), {path, stamp, size, archive});
+    if (cache.archives.size() > CACHED_ARCHIVES) cache.archives.resize(CACHED_ARCHIVES);
+    return archive;
+}
+
+std::shared_ptr<const MappedFile> ZipArchive::openPath(const char* path, const char** error) {
+    std::string archive_path, entry_name;
+    if (!splitEntryPath(path, &archive_path, &entry_name)) return MappedFile::open(path, error);
+    std::shared_ptr<const ZipArchive> archive = open(archive_path, error);
+    if (!archive) return nullptr;
+    const Entry* entry = archive->find(entry_name);
+    if (!entry) {
+        if (error) *error = "No such entry in the archive";
+        return nullptr;
+    }
+    return archive->read(*entry, error);
+}
+
+bool ZipArchive::parse(const char** error) {
+    auto fail = [&](const char* message) {
+        if (error) *error = message;
+        return false;
+    };
+    const uint8_t* data = file_->data();
+    const size_t size = file_->size();
+    if (size < END_RECORD_SIZE) return fail("Not a zip archive");
+
+    // The end record is last, before a comment of up to 64 KiB
+    size_t end = std::string::npos;
+    const size_t lowest = size > END_RECORD_SIZE + MAX_COMMENT ? size - END_RECORD_SIZE - MAX_COMMENT : 0;
+    for (size_t at = size - END_RECORD_SIZE + 1; at-- > lowest;) {
+        if (le32(data + at) == END_SIGNATURE && at + END_RECORD_SIZE + le16(data + at + 20) == size) {
+            end = at;
+            break;
+        }
+    }
+    if (end == std::string::npos) return fail("Not a zip archive");
+    const uint8_t* record = data + end;
+    if (le16(record + 4) != 0 || le16(record + 6) != 0) return fail("Multi-disk zip archives are not supported");
+    const uint16_t count = le16(record + 10);
+    const uint32_t directory_size = le32(record + 12);
+    const uint32_t directory_at = le32(record + 16);
+    if (count == 0xFFFF || directory_at == 0xFFFFFFFFu) return fail("Zip64 archives are not supported");
+    if (directory_at > end || directory_size > end - directory_at) return fail("Damaged zip directory");
+
+    entries_.reserve(count);
+    const uint8_t* p = data + directory_at;
+    const uint8_t* directory_end = p + directory_size;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (directory_end - p < static_cast<std::ptrdiff_t>(CENTRAL_HEADER_SIZE) || le32(p) != CENTRAL_SIGNATURE) {
+            return fail("Damaged zip directory");
+        }
+        const uint16_t flags = le16(p + 8);
+        const size_t name_size = le16(p + 28);
+        const size_t extra_size = le16(p + 30);
+        const size_t comment_size = le16(p + 32);
+        const size_t record_size = CENTRAL_HEADER_SIZE + name_size + extra_size + comment_size;
+        if (static_cast<size_t>(directory_end - p) < record_size) return fail("Damaged zip directory");
+
+        Entry entry;
+        entry.name.assign(reinterpret_cast<const char*>(p + CENTRAL_HEADER_SIZE), name_size);
+        entry.method = le16(p + 10);
+        entry.crc = le32(p + 16);
+        entry.compressed_size = le32(p + 20);
+        entry.size = le32(p + 24);
+        entry.local_offset = le32(p + 42);
+        p += record_size;
+        // Folders, and entries no one here could read, are left out
+        if (entry.name.empty() || entry.name.back() == '/' || (flags & FLAG_ENCRYPTED)) continue;
+        if (entry.method != METHOD_STORED && entry.method != METHOD_DEFLATED) continue;
+        if (entry.compressed_size == 0xFFFFFFFFu || entry.size == 0xFFFFFFFFu || entry.local_offset == 0xFFFFFFFFu) {
+            return fail("Zip64 archives are not supported");
+        }
+        entries_.push_back(std::move(entry));
+    }
+    return true;
+}
+
+const ZipArchive::Entry* ZipArchive::find(const std::string& name) const {
+    for (const Entry& entry : entries_) {
+        if (entry.name == name) return &entry;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const MappedFile> ZipArchive::read(const Entry& entry, const char** error) const {
+    auto fail = [&](const char* message) -> std::shared_ptr<const MappedFile> {
+        if (error) *error = message;
+        return nullptr;
+    };
+    if (error) *error = nullptr;
+    const uint8_t* data = file_->data();
+    const size_t size = file_->size();
+
+    // The local header repeats the name, with an extra field of its own size
+    if (entry.local_offset > size || size - entry.local_offset < LOCAL_HEADER_SIZE ||
+        le32(data + entry.local_offset) != LOCAL_SIGNATURE) {
+        return fail("Damaged zip entry");
+    }
+    const uint8_t* local = data + entry.local_offset;
+    const uint64_t data_at = entry.local_offset + LOCAL_HEADER_SIZE + le16(local + 26) + le16(local + 28);
+    if (data_at > size || size - data_at < entry.compressed_size) return fail("Damaged zip entry");
+    const uint8_t* compressed = data + data_at;
+
+    if (entry.method == METHOD_STORED) {
+        if (entry.compressed_size != entry.size) return fail("Damaged zip entry");
+        if (crc32(0, compressed, static_cast<size_t>(entry.size)) != entry.crc) return fail("Zip entry CRC mismatch");
+        return MappedFile::view(compressed, static_cast<size_t>(entry.size), shared_from_this());
+    }
+
+    // The buffer is sized by the directory's claim, so refuse claims no real
+    // entry makes before allocating for them
+    if (entry.size > MAX_ENTRY_SIZE) return fail("Zip entry too large");
+    if (entry.size > entry.compressed_size * MAX_DEFLATE_RATIO) return fail("Damaged zip entry");
+
+    BufferPool& pool = bufferPool();
+    std::shared_ptr<std::vector<uint8_t>> buffer(pool.take(static_cast<size_t>(entry.size)).release(),
+                                                 [&pool](std::vector<uint8_t>* released) { pool.give(released); });
+    buffer->resize(static_cast<size_t>(entry.size));
+    Inflater inflater(compressed, static_cast<size_t>(entry.compressed_size), buffer->data(), buffer->size());
+    if (!inflater.run()) return fail("Damaged zip entry");
+    if (crc32(0, buffer->data(), buffer->size()) != entry.crc) return fail("Zip entry CRC mismatch");
+    const uint8_t* bytes = buffer->data();
+    const size_t length = buffer->size();
+    return MappedFile::view(bytes, length, std::move(buffer));
+}
+
+size_t ZipArchive::cachedBytes() {
+    size_t bytes = 0;
+    {
+        ArchiveCache& cache = archiveCache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (const CachedArchive& cached : cache.archives) {
+            bytes += sizeof(ZipArchive) + cached.archive->entries_.capacity() * sizeof(Entry);
+            for (const Entry& entry : cached.archive->entries_) bytes += entry.name.capacity();
+        }
+    }
+    BufferPool& pool = bufferPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (const auto& buffer : pool.free) bytes += buffer->capacity();
+    return bytes;
+}
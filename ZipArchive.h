@@ -0,0 +1,66 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A .zip set of NSFs or ROMs, read where it lies. open() maps the archive and
+// parses its central directory once; the directory is cached by path, mtime
+// and size, so opening the set again for its next track costs a stat. read()
+// gives one entry as a MappedFile: a stored entry is a view into the mapping,
+// a deflated one is inflated into a buffer from a small pool, which goes back
+// to the pool when the last reader lets go. Nothing is extracted to disk.
+//
+// Entries are named by "set.zip#dir/track.nsf" paths, which openPath() takes
+// alongside plain ones wherever a file is read. Only stored and deflated
+// entries are read; Zip64, encrypted and multi-disk archives are refused.
+class ZipArchive : public std::enable_shared_from_this<ZipArchive> {
+public:
+    static constexpr char ENTRY_SEPARATOR = '#';
+    static constexpr size_t CACHED_ARCHIVES = 8;   // Directories kept once unused
+    static constexpr size_t POOLED_BUFFERS = 4;    // Inflate buffers kept once released
+    static constexpr size_t POOLED_BUFFER_MAX = 16u << 20;  // Larger ones are freed
+    static constexpr uint64_t MAX_ENTRY_SIZE = 64u << 20;   // Inflated; NSF and NES images are far smaller
+
+    struct Entry {
+        std::string name;  // As stored, '/' separated
+        uint16_t method = 0;  // 0 stored, 8 deflated
+        uint32_t crc = 0;
+        uint64_t compressed_size = 0;
+        uint64_t size = 0;
+        uint64_t local_offset = 0;  // Of the entry's local header
+    };
+
+    // Has a .zip extension
+    static bool isArchive(const std::string& path);
+    // "set.zip#entry" into its archive and entry; false for a plain path
+    static bool splitEntryPath(const std::string& path, std::string* archive, std::string* entry);
+    static std::string entryPath(const std::string& archive, const std::string& entry);
+
+    // The archive at path, from the cache while its mtime and size hold;
+    // nullptr with *error set if it cannot be read as a zip
+    static std::shared_ptr<const ZipArchive> open(const std::string& path, const char** error = nullptr);
+    // A plain file mapped, or an entry path read from its archive
+    static std::shared_ptr<const MappedFile> openPath(const char* path, const char** error = nullptr);
+
+    const std::string& path() const { return path_; }
+    const std::vector<Entry>& entries() const { return entries_; }
+    const Entry* find(const std::string& name) const;
+
+    // The entry's bytes, checked against its CRC; nullptr with *error set
+    std::shared_ptr<const MappedFile> read(const Entry& entry, const char** error = nullptr) const;
+
+    // Bytes held by the directory cache and the buffer pool
+    static size_t cachedBytes();
+
+private:
+    ZipArchive() = default;
+    bool parse(const char** error);
+
+    std::string path_;
+    std::shared_ptr<const MappedFile> file_;
+    std::vector<Entry> entries_;
+};
@@ -1,6 +1,8 @@
 #define SOKOL_IMPL
 #if defined(__APPLE__)
 #define SOKOL_METAL
+#elif defined(__EMSCRIPTEN__)
+#define SOKOL_GLES3
 #else
 #define SOKOL_VULKAN
 #endif
@@ -1,5 +1,7 @@
 #if defined(__APPLE__)
 #define SOKOL_METAL
+#elif defined(__EMSCRIPTEN__)
+#define SOKOL_GLES3
 #else
 #define SOKOL_VULKAN
 #endif
@@ -13,6 +15,12 @@
 #include <algorithm>
 #include <mutex>
 #include <atomic>
+#include <thread>
+#include <chrono>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <string>
 
 #include "imgui.h"
 #include "util/sokol_imgui.h"
@@ -23,6 +31,15 @@
 #include "gme/Nes_Apu.h"
 #include "gme/Nes_Vrc6_Apu.h"
 
+// Typed sound-chip access resolved at load time
+#include "ChannelProbe.h"
+
+// Per-file table of every chip channel, shared by the visualizers
+#include "ChannelRegistry.h"
+
+// Snapshot keyframes for fast NSF seeking
+#include "SeekIndex.h"
+
 // Native File Dialog for file selection
 #include "nfd.h"
 
@@ -32,11 +49,64 @@
 // Piano Visualizer
 #include "PianoVisualizer.h"
 
+// APU register writes inside each audio block, for the live keys
+#include "ApuTimeline.h"
+
+// Background note preprocessing of every track
+#include "TrackNoteStore.h"
+
 // NES Emulator
 #include "NesEmulator.h"
 
+// Predicted piano notes for the emulator
+#include "NesLookahead.h"
+
+// Rewind history for the emulator
+#include "NesRewind.h"
+
+// Numbered save states, written to disk in the background
+#include "SaveSlots.h"
+#include "BatterySave.h"
+
+// ROM hash for the save slot files
+#include "NoteCache.h"
+
+// Lock-free ring for render-ahead audio
+#include "SpscRing.h"
+#include "MixBus.h"
+#include "MultiView.h"
+
+// SIMD sample conversion
+#include "AudioKernels.h"
+
+// Audio callback counters and the Performance window
+#include "AudioTelemetry.h"
+#include "WebAudio.h"
+#include "FrameProfiler.h"
+#include "MemoryReport.h"
+#include "Trace.h"
+
+// Offline WAV rendering of every track
+#include "NsfExport.h"
+#include "JobPool.h"
+#include "ThreadScheduling.h"
+#include "PlayRoutineProfile.h"
+#include "QualityGovernor.h"
+#include "VideoRecorder.h"
+#include "WavRecorder.h"
+#include "OscOutput.h"
+#include "OfflineRender.h"
+#include "LibraryIndex.h"
+#include "PlayQueue.h"
+#include "TelemetryExport.h"
+#include "ZipArchive.h"
+#include "PanelCache.h"
+
 #include <cctype>
+#include <cmath>
 #include <cstring>
+#include <ctime>
+#include <filesystem>
 
 // Helper function to check file extension (case-insensitive)
 static bool has_extension(const char* path, const char* ext) {
@@ -60,6 +130,16 @@ static bool show_demo_window = false;
 static bool show_visualizer = true;
 static bool show_piano = true;
 static bool show_emulator = false;
+static bool show_performance = false;
+static bool show_library = false;
+static bool show_queue = false;
+static bool show_frame_profiler = false;
+static bool show_multi_view = false;
+static bool show_memory = false;
+static bool show_play_routine = false;
+#ifdef AGNES_PROFILE
+static bool show_cpu_profile = false;
+#endif
 
 // Application mode: NSF Player or NES Emulator
 enum class AppMode {
@@ -71,31 +151,372 @@ static AppMode current_mode = AppMode::NSF_PLAYER;
 // Keyboard state tracking for NES input
 static bool key_states[512] = {};  // Track key press states
 
+// Idle redraw: with nothing playing, loading or emulating and no input for
+// IDLE_AFTER_MS, frame() sleeps so the UI redraws about every IDLE_FRAME_MS
+// instead of at the display rate. Any event or playback restores the full
+// rate from the next frame; the pause after the last input lets hover and
+// fade animations finish.
+static constexpr int IDLE_AFTER_MS = 1000;
+static constexpr int IDLE_FRAME_MS = 100;
+static std::chrono::steady_clock::time_point last_input_time;
+static std::chrono::steady_clock::time_point last_frame_time;
+
+// --telemetry options from the command line, for init()
+static TelemetryExport::Options telemetry_options;
+
+// Cold start: milliseconds from sokol_main() to each step of startup, printed
+// as one line once the first frame is submitted, so time-to-first-frame can
+// be measured on the target. Steps deferred past it (the file dialogs, the
+// audio device, the NES emulator) print on their own when they happen.
+static std::chrono::steady_clock::time_point startup_time;
+static std::vector<std::pair<const char*, double>> startup_marks;
+static bool first_frame_submitted = false;
+
+static void startup_mark(const char* step) {
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup_time).count();
+    if (first_frame_submitted) {
+        fprintf(stderr, "startup: %s at %.1f ms\n", step, ms);
+        return;
+    }
+    startup_marks.emplace_back(step, ms);
+    if (std::strcmp(step, "first frame") != 0) return;
+    first_frame_submitted = true;
+    fprintf(stderr, "startup:");
+    for (const auto& [name, at] : startup_marks) fprintf(stderr, " %s %.1f ms%s", name, at, name == step ? "\n" : ",");
+}
+
+// Native File Dialog, initialized by the first dialog opened (UI thread)
+static bool nfd_initialized = false;
+
+static void ensure_nfd() {
+    if (nfd_initialized) return;
+    nfd_initialized = NFD_Init() == NFD_OKAY;
+    startup_mark("file dialogs");
+}
+
+static nfdresult_t open_file_dialog(nfdu8char_t** out_path, const nfdu8filteritem_t* filters,
+                                    nfdfiltersize_t filter_count, const nfdu8char_t* default_path) {
+    ensure_nfd();
+    return NFD_OpenDialogU8(out_path, filters, filter_count, default_path);
+}
+
+static nfdresult_t save_file_dialog(nfdu8char_t** out_path, const nfdu8filteritem_t* filters,
+                                    nfdfiltersize_t filter_count, const nfdu8char_t* default_path,
+                                    const nfdu8char_t* default_name) {
+    ensure_nfd();
+    return NFD_SaveDialogU8(out_path, filters, filter_count, default_path, default_name);
+}
+
+static nfdresult_t pick_folder_dialog(nfdu8char_t** out_path, const nfdu8char_t* default_path) {
+    ensure_nfd();
+    return NFD_PickFolderU8(out_path, default_path);
+}
+
 // Mutex for protecting audio operations
 static std::mutex audio_mutex;
 
+// Held by the emulation thread for each frame, and by the UI thread to load
+// or close a ROM and to start or stop the lookahead
+static std::mutex nes_mutex;
+
+// Latency profiles: device buffer, emulator Blip_Buffer length, NSF render-ahead
+// depth and how far NES emulation runs ahead of the device
+struct LatencyProfile {
+    const char* name;
+    int buffer_frames;    // sokol_audio device buffer
+    int apu_buffer_ms;    // NesEmulator Blip_Buffer length, unless auto-sized
+    int render_ahead_ms;  // NSF render-ahead target
+    int nes_ahead_ms;     // NES APU buffer fill held by rate control: above half a device buffer plus a frame
+};
+
+static constexpr LatencyProfile LATENCY_PROFILES[] = {
+    { "Low latency", 512,  100, 20,  30  },  // ~12ms device buffer, for emulator play
+    { "Balanced",    2048, 200, 100, 70  },  // ~46ms, the previous fixed setup
+    { "Safe",        4096, 500, 300, 120 },  // ~93ms, deep buffering for slow machines
+};
+
+// NTSC frame rate, pacing emulation when there is no audio device
+static constexpr double NES_FRAME_RATE = 1789773.0 / 29780.5;
+static constexpr int LATENCY_PROFILE_COUNT = sizeof(LATENCY_PROFILES) / sizeof(LATENCY_PROFILES[0]);
+static constexpr int DEFAULT_LATENCY_PROFILE = 1;
+static constexpr int MAX_NES_BUFFER_MS = 1000;
+
+// When the emulation thread runs a NES frame. EMULATOR_TIMER runs them on
+// its own 60.0988 Hz timer and the UI shows whichever finished last; with
+// DISPLAY the UI thread asks for a frame right after reading input and
+// presents it in the same frame, a period or so sooner. Audio rate control
+// covers the display's rate being a little off, as it does the device's.
+enum class FramePacing {
+    EMULATOR_TIMER,
+    DISPLAY
+};
+static constexpr int PACED_FRAME_WAIT_MS = 8;       // Longest the UI waits for a frame it asked for
+static constexpr int MAX_INPUT_LATENCY_MS = 250;   // Longer is a key with nothing to show for it
+
+// Debug builds count heap allocations made while inside the audio callback.
+// The callback must stay at zero; any allocation trips the assert below.
+#ifndef AUDIO_ALLOC_CHECK
+#ifdef NDEBUG
+#define AUDIO_ALLOC_CHECK 0
+#else
+#define AUDIO_ALLOC_CHECK 1
+#endif
+#endif
+
+#if AUDIO_ALLOC_CHECK
+static thread_local bool in_audio_callback = false;
+static std::atomic<unsigned> audio_callback_allocs{0};
+
+void* operator new(std::size_t size) {
+    if (in_audio_callback) {
+        audio_callback_allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Marks the current scope as running on the audio callback
+struct AudioCallbackScope {
+    unsigned allocs_at_entry;
+    AudioCallbackScope() : allocs_at_entry(audio_callback_allocs.load(std::memory_order_relaxed)) {
+        in_audio_callback = true;
+    }
+    ~AudioCallbackScope() {
+        in_audio_callback = false;
+        assert(audio_callback_allocs.load(std::memory_order_relaxed) == allocs_at_entry &&
+               "audio callback allocated on the heap");
+    }
+};
+#endif
+
+// Fixed scratch memory for the audio callback, sized once in init()
+struct AudioScratch {
+    std::vector<short> mono;    // NES APU output
+    std::vector<short> stereo;  // Or panned, two per frame
+    std::vector<short> taps;    // Per-oscillator samples, NesEmulator::TAP_COUNT per frame
+    ChannelTable channels;      // APU snapshot decoded for the visualizers
+    int frames = 0;             // Capacity in frames
+    
+    void allocate(int max_frames) {
+        frames = max_frames;
+        mono.assign(max_frames, 0);
+        stereo.assign(max_frames * 2, 0);
+        taps.assign(max_frames * NesEmulator::TAP_COUNT, 0);
+    }
+};
+
+// Render-ahead producer settings
+static constexpr int RENDER_CHUNK_FRAMES = 512;    // Frames rendered per gme_play call
+static constexpr int RENDER_AHEAD_MIN_MS = 20;
+static constexpr int RENDER_AHEAD_MAX_MS = 500;
+
+// SCHED_FIFO priorities of the real-time threads on Linux, below the sound
+// server's own (PipeWire and JACK run theirs near 88)
+static constexpr int RENDER_FIFO_PRIORITY = 60;
+static constexpr int NES_FIFO_PRIORITY = 59;
+
+// Gapless playback: how much of the next track the prefetch worker renders
+static constexpr int PREFETCH_RENDER_MS = 1000;
+
+// Next-track prefetch: a worker opens a second emulator, preprocesses the
+// next track's notes and renders its opening, so the change at the end of
+// the current track is a pointer swap on the render thread
+struct TrackPrefetch {
+    enum Status { IDLE, WORKING, READY, FAILED };
+    JobPool::Group job;
+    std::atomic<int> status{IDLE};
+    std::atomic<bool> cancel{false};
+    
+    // Owned by the worker while WORKING, then by whoever holds audio_mutex
+    int track = -1;
+    float tempo = 1.0f;
+    std::string path;                       // File to read when it is not the loaded one
+    std::shared_ptr<const MusicFile> file;  // The track's file once read
+    std::vector<track_info_t> track_info;   // Its track list, read along with an other_file
+    bool other_file = false;                // Not the loaded file: the UI thread makes the switch
+    int queue_index = -1;                   // Queue entry prepared, -1 outside the queue
+    long fade_start_ms = -1;                // Fade set on emu, -1 for none
+    long fade_ms = 0;
+    Music_Emu* emu = nullptr;
+    ChannelProbe probe;
+    SeekIndex seek_index;
+    PianoVisualizer piano;   // Note data only, swapped into state.piano at the switch
+    std::vector<short> pcm;  // Interleaved stereo from the start of the track
+};
+
+// File load: a worker reads and parses the file into a fresh emulator, so
+// neither the UI nor the render thread waits on disk I/O; the UI thread
+// installs the result under audio_mutex and frees the old emulator after
+// releasing it
+struct FileLoad {
+    JobPool::Group job;
+    bool active = false;  // Started and not yet installed or discarded (UI thread)
+    std::atomic<bool> done{false};
+    
+    // Owned by the worker until done
+    std::string path;
+    std::shared_ptr<const MusicFile> file;
+    Music_Emu* emu = nullptr;
+    ChannelProbe probe;
+    std::vector<track_info_t> track_info;
+    std::string error;
+    
+    // What to start once installed (UI thread)
+    int play_track = -1;   // -1: load without playing
+    int queue_index = -1;  // Queue entry the track plays as, -1 for none
+};
+
+// A control the UI thread hands the render thread, which applies it to the
+// playing emulator at the next block boundary, so neither waits on the other
+// for a track start or a tempo change
+struct AudioCommand {
+    enum Type : uint8_t { START_TRACK, SET_TEMPO };
+    Type type = START_TRACK;
+    int track = 0;           // START_TRACK: the track, SET_TEMPO: the one playing
+    float tempo = 1.0f;      // SET_TEMPO
+    long fade_start_ms = -1; // START_TRACK: its fade, -1 for none
+    long fade_ms = 0;
+};
+
+// Controls the UI can queue before the render thread catches up
+static constexpr size_t AUDIO_COMMAND_CAPACITY = 64;
+
 // application state
 static struct {
+    // The flags and counters threads hand each other, grouped by the thread
+    // that writes them, each group on cache lines of its own: a store by one
+    // thread then never invalidates the line another is polling, nor the
+    // mutexes and rings of the members around them. A request from one side
+    // and its clearing by the other (render_flush, boundary_pending) count as
+    // the requester's: the other side polls with a load and only clears
+    // through take_request() when a request is pending, so the clear is the
+    // rare write.
+    
+    // UI thread: what it asks of the render, audio and NES threads
+    struct alignas(64) {
+        std::atomic<bool> is_playing{false};  // Also cleared by the render thread on an error
+        std::atomic<float> volume_linear{1.0f};  // Cached from volume_db by set_volume_db()
+        std::atomic<long> seek_request{-1};  // Milliseconds for the render thread, -1 for none
+        std::atomic<int> synth_quality{blip_synth_standard};  // Resampling tier (Audio > Resampling)
+        std::atomic<bool> render_thread_running{false};
+        std::atomic<int> render_ahead_ms{100};
+        std::atomic<bool> render_flush{false};  // Ask the callback to drop queued frames
+        std::atomic<bool> nes_thread_running{false};
+        std::atomic<int> nes_ahead_ms{70};
+        std::atomic<bool> nes_fast_forward{false};  // Tab held, or turbo latched
+        std::atomic<bool> nes_auto_frameskip{true};
+        std::atomic<FramePacing> nes_frame_pacing{FramePacing::EMULATOR_TIMER};
+        std::atomic<uint32_t> nes_frame_requests{0};  // Counted up once a frame when display paced
+        std::atomic<bool> nes_stereo{false};  // Voices panned by NesEmulator::setChannelPan
+        std::atomic<bool> nes_rewinding{false};  // R held
+        std::atomic<int> nes_save_slot{-1};  // Slot to save or load between frames, -1 for none
+        std::atomic<int> nes_load_slot{-1};
+    } ui;
+    
+    // Render thread, once a block
+    struct alignas(64) {
+        std::atomic<int64_t> rendered_frames{0};  // Emulator position at the ring's write end
+        std::atomic<bool> boundary_pending{false};  // Switched, but the old track's tail is still queued
+        std::atomic<int64_t> boundary_frames{0};  // Old track's position at the switch
+        std::atomic<bool> track_end_unhandled{false};  // Track ended with no prefetched successor
+    } render;
+    
+    // Audio callback, once a buffer
+    struct alignas(64) {
+        std::atomic<int64_t> playback_frames{0};  // Frames into the track, as heard
+        std::atomic<bool> track_switched{false};  // Boundary is audible; UI finishes the switch
+    } audio;
+    
+    // NES emulation thread, once a frame
+    struct alignas(64) {
+        std::atomic<uint32_t> nes_frames_served{0};  // Catches up with ui.nes_frame_requests
+        std::atomic<uint32_t> nes_skipped_frames{0};
+        std::atomic<float> nes_jitter_ms{0.0f};  // Decaying peak lateness of timed frames
+    } nes;
+    
     sg_pass_action pass_action;
     
     // Game_Music_Emu state
     Music_Emu* emu = nullptr;
-    std::atomic<bool> is_playing{false};
+    ChannelProbe probe;  // Resolved by the file loader, guarded by audio_mutex
+    ChannelTable channels;  // Built with probe, sampled by the render thread; audio_mutex
+    // The APU's writes as the render thread played them, on the stream frame
+    // clock; the UI thread replays them up to what is heard into the APU keys
+    ApuTimeline nsf_timeline;
+    ChannelTable nsf_timeline_table = ChannelTable::forNesEmulator(false);  // UI thread
+    SeekIndex seek_index;  // Keyframes for the playing track, guarded by audio_mutex
+    long fade_start_ms = -1;  // Playing track's fade, -1 for none; set again after seeks (audio_mutex)
+    long fade_ms = 0;
     int current_track = 0;
     int track_count = 0;
     char loaded_file[512] = "";
+    std::shared_ptr<const MusicFile> music_file;  // loaded_file's bytes, shared with the background emulators
+    std::vector<track_info_t> track_info;  // Every track's info, read with the file (UI thread)
+    uint32_t track_info_serial = 0;        // Counts the files whose track_info was installed
+    PanelCache track_info_panel;           // The player's track info box, redrawn on a new track or file
+    PanelCache idle_panel;                 // The player's text with no file loaded
     char error_msg[512] = "";
     
     // Audio state
     bool audio_initialized = false;
     const long sample_rate = 44100;
+    AudioScratch audio_scratch;  // Only touched by the audio callback after init()
+    AudioTelemetry telemetry;    // Written by the audio callback, queried by the UI
+    TelemetryExport telemetry_export;  // --telemetry: the counters to a file every interval
+    int latency_profile = DEFAULT_LATENCY_PROFILE;
+    bool audio_setup_called = false;  // saudio_shutdown() is needed even if setup failed; set on first play
     
     // Playback info
     float tempo = 1.0f;
     float volume_db = 0.0f;
     
-    // Seek request (set by UI thread, processed by audio thread)
-    std::atomic<long> seek_request{-1};  // -1 means no seek requested
+    float seek_drag = -1.0f;  // Seek bar position while dragged, asked for on release (UI thread)
+    
+    // Track starts and tempo changes (pushed by the UI thread, popped under
+    // audio_mutex), and what the render thread last gave the emulator
+    SpscRing<AudioCommand> audio_commands;
+    float emu_tempo = 1.0f;  // audio_mutex
+    int emu_mute_mask = 0;   // audio_mutex; -1 until the next block sets it
+    int emu_synth_quality = -1;  // Resampling tier the taps were given; audio_mutex, -1 until the next block sets it
+    
+    // Render-ahead producer: gme_play runs on its own thread and the audio
+    // callback only copies finished frames out of this ring
+    SpscRing<short> render_ring;                 // Interleaved stereo int16, as gme_play wrote it
+    std::thread render_thread;
+    // Each channel's share of render_ring, so the callback applies mutes at
+    // once; render_muted is the render thread's copy for the visualizer
+    MixBus mix_bus;
+    std::vector<short> render_muted;
+    PlayRoutineProfile play_profile;  // Captured by the render thread after each block
+    
+    // OS priority and core of the render and NES threads (Audio > Thread
+    // Scheduling); pinned, they take the last two cores and the UI thread
+    // keeps off them
+    ThreadScheduling render_scheduling{"Render", RENDER_CHUNK_FRAMES * 1000.0 / 44100, RENDER_FIFO_PRIORITY};
+    ThreadScheduling nes_scheduling{"NES", 1000.0 / NES_FRAME_RATE, NES_FIFO_PRIORITY};
+    ThreadScheduling::Priority thread_priority = ThreadScheduling::Priority::Normal;  // UI thread
+    bool pin_threads = false;
+    
+    // NES emulation thread, timer paced with rate control against the audio device
+    // Both wait for the first ROM, see load_nes_rom()
+    bool nes_initialized = false;
+    std::thread nes_thread;
+    bool nes_turbo = false;
+    double nes_display_clock = 0.0;               // Display time not emulated yet, seconds (UI thread)
+    std::chrono::steady_clock::time_point nes_submitted_input;  // Input change the last frame showed (UI thread)
+    bool nes_buffer_auto = true;
+    int nes_buffer_ms = 200;  // APU buffer length when not auto-sized
+    
+    // Files being opened in the background
+    FileLoad file_load;
+    
+    // Gapless track switching
+    TrackPrefetch prefetch;
+    std::vector<short> prerender;                // Prefetched opening still to be queued (audio_mutex)
+    size_t prerender_pos = 0;
+    Music_Emu* retired_emu = nullptr;            // Previous track's emulator, freed by the UI thread
     
     // Audio visualizer
     AudioVisualizer visualizer;
@@ -103,12 +524,20 @@ static struct {
     // Piano visualizer
     PianoVisualizer piano;
     
-    // Playback time in seconds
-    std::atomic<float> playback_time{0.0f};
+    // Notes of every track of the loaded file, preprocessed in the background
+    TrackNoteStore notes;
+    int piano_track = -1;  // Track whose notes state.piano holds (UI thread)
+    std::shared_ptr<const PreprocessedTrack> piano_notes;  // What it was given, null if not from the store
+    
+    // Every track of the loaded file rendered to WAV in the background
+    NsfExport wav_export;
+    
+    // Music files under the library folders, rescanned in the background
+    LibraryIndex library;
     
-    // Piano preprocessing state
-    std::atomic<bool> preprocessing{false};
-    std::atomic<float> preprocess_progress{0.0f};
+    // Tracks to play in order across files (UI thread)
+    PlayQueue queue;
+    bool queue_autoplay = false;  // Play the first entry a drop onto an idle player adds
     
     // Audio buffer for visualization (double buffered)
     std::vector<short> viz_buffer;
@@ -116,260 +545,1089 @@ static struct {
     
     // NES Emulator
     NesEmulator nes_emu;
+    ApuTimeline nes_timeline;  // Its writes on the CPU cycle clock, replayed by the UI thread
+    ChannelTable nes_timeline_table = ChannelTable::forNesEmulator(false);
     bool nes_rom_loaded = false;
     agnes_input_t nes_input = {};  // Current controller input
+    NesLookahead nes_lookahead;    // Runs a copy of the game ahead for the piano roll
+    NesRewind nes_rewind;          // Recent frames to step back through
+    int nes_rewind_mb = static_cast<int>(NesRewind::DEFAULT_BUDGET >> 20);
+    std::string nes_movie_error;  // Why the last movie could not be saved or played
+    SaveSlots nes_slots;
+    BatterySave nes_battery;  // The game's own saves, written behind
+    MultiView multi_view{sample_rate};  // Demo grid of further games and NSFs, mixed into the stream
     float nes_screen_scale = 2.0f;
+    
+    // Memory held by the above, sampled by the UI thread
+    MemoryReport memory;
+    
+    // File > Record Video: the recorder's audio position as each of the last
+    // few frames was built, by sapp_frame_count(), for frames read back later
+    VideoRecorder video_recorder;
+    int64_t capture_audio_pos[8] = {};
+    WavRecorder output_recorder;  // File > Record Output
+    std::string record_error;     // Why either could not start
+    
+    // Audio > OSC Output: channel levels and notes for lighting rigs
+    OscOutput osc;
+    char osc_host[128] = "127.0.0.1";
+    int osc_port = OscOutput::DEFAULT_PORT;
+    int osc_rate = OscOutput::DEFAULT_RATE;
+    std::string osc_error;
+    
+    // File > Render Video Frames: replaces the UI until done; the offline
+    // frame each of the last few app frames drew (-1 for none), by
+    // sapp_frame_count(), as for capture_audio_pos
+    OfflineRender offline;
+    int offline_frame_index[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+    int offline_frames_drawn = 0;
+    sapp_present_mode offline_saved_present_mode = SAPP_PRESENTMODE_FIFO;
+    
+    // View > Adaptive Quality: visual detail stepped to the frame budget;
+    // quality_level is what the visualizers were last set to
+    QualityGovernor quality;
+    int quality_level = 0;
 } state;
 
-// Audio stream callback - called from audio thread
-void audio_stream_callback(float* buffer, int num_frames, int num_channels, void* user_data) {
+// Clear a pending request and return it, or none. The poll is a plain load,
+// so the flag's cache line is only taken for writing when there is something
+// to take.
+template <typename T>
+static T take_request(std::atomic<T>& flag, T none) {
+    if (flag.load(std::memory_order_relaxed) == none) return none;
+    return flag.exchange(none);
+}
+
+static const char* const WINDOW_TITLE = "NES Music Player - NSF Visualizer";
+
+// Ask the render and NES threads for state.thread_priority, on cores of
+// their own when pinning with three or more to go round (UI thread)
+static void apply_thread_scheduling() {
+    const int cores = ThreadScheduling::coreCount();
+    const bool pin = state.pin_threads && cores >= 3;
+    const int render_core = pin ? cores - 1 : ThreadScheduling::ANY_CORE;
+    const int nes_core = pin ? cores - 2 : ThreadScheduling::ANY_CORE;
+    state.render_scheduling.request(state.thread_priority, render_core);
+    state.nes_scheduling.request(state.thread_priority, nes_core);
+    ThreadScheduling::avoidCores(pin && cores <= 64 ? (uint64_t{3} << (cores - 2)) : 0);
+}
+
+// Update the volume and the linear gain the audio callback applies
+static void set_volume_db(float db) {
+    state.volume_db = db;
+    state.ui.volume_linear.store(std::pow(10.0f, db / 20.0f));
+}
+
+static void post_audio_command(const AudioCommand& command);
+static void apply_audio_commands();
+
+// Change playback tempo; seek keyframes taken at another tempo no longer line up
+static void set_tempo(float tempo) {
+    state.tempo = tempo;
+    if (!state.emu) return;
+    AudioCommand command;
+    command.type = AudioCommand::SET_TEMPO;
+    command.track = state.current_track;
+    command.tempo = tempo;
+    post_audio_command(command);
+}
+
+// Fill one device buffer from whichever mode is running (audio thread)
+static void render_audio_block(float* buffer, int num_frames, int num_channels) {
     const int num_samples = num_frames * num_channels;
+    AudioTelemetry::BlockScope telemetry_scope(state.telemetry, num_frames, state.sample_rate);
+    FrameProfiler::Scope profile_scope(FrameProfiler::AUDIO_CALLBACK);
+    FC_ZONE("audio_stream_callback");
+    
+#if AUDIO_ALLOC_CHECK
+    AudioCallbackScope alloc_scope;
+#endif
     
     // Handle NES Emulator mode
     if (current_mode == AppMode::NES_EMULATOR && state.nes_emu.isRunning()) {
-        static std::vector<short> nes_temp_buffer;
-        
-        // NES APU outputs mono, we need num_frames mono samples
-        nes_temp_buffer.resize(num_frames);
-        
-        // Read audio samples from emulator (mono)
-        int samples_read = state.nes_emu.readAudioSamples(nes_temp_buffer.data(), num_frames);
+        AudioScratch& scratch = state.audio_scratch;
+        const float volume_linear = state.ui.volume_linear.load(std::memory_order_relaxed);
+        int missing_frames = 0;
+        long queued_after = 0;
         
-        // If we got fewer samples than needed, fill the rest with silence
-        for (int i = samples_read; i < num_frames; ++i) {
-            nes_temp_buffer[i] = 0;
-        }
-        
-        // Update visualizer with audio data (convert mono to stereo for visualizer)
-        static std::vector<short> stereo_buffer;
-        stereo_buffer.resize(num_samples);
-        for (int i = 0; i < num_frames; ++i) {
-            stereo_buffer[i * 2] = nes_temp_buffer[i];
-            stereo_buffer[i * 2 + 1] = nes_temp_buffer[i];
-        }
-        state.visualizer.updateAudioData(stereo_buffer.data(), num_samples);
-        
-        // Update piano visualizer and channel levels with APU data
-        int periods[5], lengths[5], amplitudes[5];
-        state.nes_emu.getApuState(periods, lengths, amplitudes);
-        state.visualizer.updateChannelAmplitudesFromAPU(amplitudes, lengths);
-        float current_time = static_cast<float>(state.nes_emu.getCpuCycles()) / 1789773.0f;
-        state.piano.updateFromAPU(periods, lengths, amplitudes, current_time);
-        
-        // VRC6 expansion support for NES emulator
-        if (state.nes_emu.hasVRC6()) {
-            state.visualizer.setVRC6Enabled(true);
-            state.piano.setVRC6Enabled(true);
+        // The device may ask for more than the arena holds; work in chunks
+        for (int offset = 0; offset < num_frames; offset += scratch.frames) {
+            const int chunk = std::min(scratch.frames, num_frames - offset);
+            short* mono = scratch.mono.data();
+            short* stereo = scratch.stereo.data();
+            const bool panned = state.ui.nes_stereo.load(std::memory_order_relaxed);
             
-            int vrc6_periods[3], vrc6_volumes[3];
-            bool vrc6_enabled[3];
-            state.nes_emu.getVRC6State(vrc6_periods, vrc6_volumes, vrc6_enabled);
+            // Read audio samples from emulator (mono, or the voices panned)
+            int samples_read = panned ? state.nes_emu.readAudioStereo(stereo, chunk)
+                                      : state.nes_emu.readAudioSamples(mono, chunk);
+            queued_after = std::max(0L, state.nes_emu.bufferedAtLastRead() - samples_read);
             
-            int vrc6_amplitudes[3];
-            for (int i = 0; i < 3; ++i) {
-                vrc6_amplitudes[i] = vrc6_enabled[i] ? vrc6_volumes[i] : 0;
+            // If we got fewer samples than needed, fill the rest with silence
+            if (panned) {
+                std::fill(stereo + samples_read * 2, stereo + chunk * 2, short(0));
+            } else {
+                std::fill(mono + samples_read, mono + chunk, short(0));
             }
-            state.visualizer.updateVRC6ChannelAmplitudes(vrc6_amplitudes);
-            state.piano.updateFromVRC6(vrc6_periods, vrc6_volumes, vrc6_enabled, current_time);
-        } else {
-            state.visualizer.setVRC6Enabled(false);
-            state.piano.setVRC6Enabled(false);
+            missing_frames += chunk - samples_read;
+            
+            // Each oscillator's share of the samples just read
+            int tap_frames = state.nes_emu.readChannelTaps(scratch.taps.data(), chunk);
+            state.visualizer.updateChannelTaps(scratch.taps.data(), tap_frames, NesEmulator::TAP_COUNT,
+                                               scratch.channels.voice_channel.data());
+            
+            if (panned) {
+                state.visualizer.updateAudioData(stereo, chunk * 2);
+                AudioKernels::s16ToF32(stereo, buffer + offset * 2, chunk * 2, volume_linear);
+                continue;
+            }
+            
+            // Update visualizer with audio data (queued and analysed as mono)
+            state.visualizer.updateAudioDataMono(mono, chunk);
+            
+            // Convert mono to stereo float output
+            AudioKernels::s16MonoToF32Stereo(mono, buffer + offset * 2, chunk, volume_linear);
         }
+        state.telemetry.recordShortBlock(missing_frames);
+        state.telemetry.recordQueueDepth(state.nes_emu.bufferedAtLastRead(), state.nes_emu.bufferCapacity());
         
-        // Convert mono to stereo float output
-        float volume_linear = std::pow(10.0f, state.volume_db / 20.0f);
-        for (int i = 0; i < num_frames; ++i) {
-            float sample = (nes_temp_buffer[i] / 32768.0f) * volume_linear;
-            buffer[i * 2] = sample;      // Left channel
-            buffer[i * 2 + 1] = sample;  // Right channel
+        // Update channel levels from the last published frame (a lock-free read;
+        // emulation may be mid-frame on its own thread). The piano replays the
+        // frames' register writes on the UI thread, see replay_apu_timeline().
+        const NesEmulator::ApuSnapshot apu = state.nes_emu.getApuSnapshot();
+        ChannelTable& channels = scratch.channels;
+        if (channels.hasChip(SoundChip::Vrc6) != apu.has_vrc6) {
+            channels = ChannelTable::forNesEmulator(apu.has_vrc6);
+        }
+        channels.sampleApu(apu.periods, apu.lengths, apu.amplitudes);
+        if (apu.has_vrc6) {
+            channels.sampleVrc6(apu.vrc6_periods, apu.vrc6_amplitudes, apu.vrc6_volumes, apu.vrc6_enabled);
         }
+        state.visualizer.updateChannelLevels(channels);
+        
+        // The listener is a buffer behind this one and the queue behind the
+        // snapshot: the playback clock, in the emulator's own audio frames
+        const int64_t emulated =
+            static_cast<int64_t>(static_cast<double>(apu.cpu_cycles) * state.sample_rate / ChannelTable::NES_CPU_CLOCK);
+        state.visualizer.setPlaybackClock(emulated - queued_after - 2 * num_frames, num_frames);
         return;
     }
     
     // Handle NSF Player mode
-    if (!state.emu || !state.is_playing.load()) {
-        // Fill with silence
+    // Drop frames rendered before a seek or track change
+    if (take_request(state.ui.render_flush, false)) {
+        state.render_ring.discard();
+    }
+    
+    if (!state.emu || !state.ui.is_playing.load()) {
+        // Fill with silence; the visualizer stays on the last frame that played
         std::fill(buffer, buffer + num_samples, 0.0f);
+        state.visualizer.setPlaybackClock(static_cast<int64_t>(state.render_ring.readPosition() / 2), 0);
         return;
     }
     
-    std::lock_guard<std::mutex> lock(audio_mutex);
-    
-    // Process seek request if any
-    long seek_pos = state.seek_request.exchange(-1);
-    if (seek_pos >= 0 && state.emu) {
-        gme_seek(state.emu, seek_pos);
+    // The device is now playing the previous buffer, which ended at the ring's
+    // read position; the visualizer holds each block back until it is heard
+    state.visualizer.setPlaybackClock(static_cast<int64_t>(state.render_ring.readPosition() / 2) - num_frames,
+                                      num_frames);
+    
+    // Convert what the render thread has produced straight into the device
+    // buffer, volume applied; an underrun plays silence
+    long queue_frames = static_cast<long>(state.render_ring.readAvailable() / 2);
+    const float volume_linear = state.ui.volume_linear.load(std::memory_order_relaxed);
+    const int64_t first_frame = static_cast<int64_t>(state.render_ring.readPosition() / 2);
+    const uint32_t muted = state.mix_bus.mutedEntries(state.visualizer.getMuteMask());
+    size_t got = state.render_ring.popInPlace(num_samples, [&](const short* src, size_t offset, size_t n) {
+        AudioKernels::s16ToF32(src, buffer + offset, static_cast<int>(n), volume_linear);
+        // Mutes from the bus, while the frames are still the callback's
+        state.mix_bus.removeMuted(first_frame + static_cast<int64_t>(offset / 2), buffer + offset,
+                                  static_cast<int>(n / 2), volume_linear / 32768.0f, muted);
+    });
+    std::fill(buffer + got, buffer + num_samples, 0.0f);
+    state.telemetry.recordShortBlock(static_cast<int>((num_samples - got) / 2));
+    state.telemetry.recordQueueDepth(queue_frames, state.ui.render_ahead_ms.load() * state.sample_rate / 1000);
+    
+    // Playback time is the render position minus what is still queued or in
+    // the device buffer playing now. After a gapless switch the queue still
+    // ends the previous track until the boundary plays (load boundary_pending
+    // first, the render thread stores it last).
+    bool boundary_pending = state.render.boundary_pending.load();
+    const int64_t queued = static_cast<int64_t>(state.render_ring.readAvailable() / 2) + num_frames;
+    int64_t time = state.render.rendered_frames.load() - queued;
+    if (boundary_pending) {
+        if (time >= 0) {
+            state.render.boundary_pending.store(false);
+            state.audio.track_switched.store(true);
+        } else {
+            time += state.render.boundary_frames.load();
+        }
     }
-    
-    // Game_Music_Emu generates 16-bit signed samples (stereo)
-    static std::vector<short> temp_buffer;
-    temp_buffer.resize(num_samples);
-    
-    // Generate samples from Game_Music_Emu
-    gme_err_t err = gme_play(state.emu, num_samples, temp_buffer.data());
-    if (err) {
-        std::fill(buffer, buffer + num_samples, 0.0f);
-        return;
+    state.audio.playback_frames.store(std::max<int64_t>(0, time));
+}
+
+// Audio stream callback - called from audio thread
+void audio_stream_callback(float* buffer, int num_frames, int num_channels, void* user_data) {
+    render_audio_block(buffer, num_frames, num_channels);
+    state.multi_view.mix(buffer, num_frames, state.ui.volume_linear.load(std::memory_order_relaxed));
+    // Recorders only copy into their rings; their writer threads do the I/O
+    state.output_recorder.push(buffer, num_frames);
+    state.video_recorder.pushAudio(buffer, num_frames);
+}
+
+// Feed visualizers from the NSF emulator's chip state (render thread, audio_mutex held)
+static void update_nsf_visualizers(const short* samples, int sample_count, int64_t stream_frame) {
+    const ChannelProbe& probe = state.probe;
+    
+    // Real per-channel samples first; with them the level estimates below are skipped
+    const short* taps = nullptr;
+    int tap_frames = probe.takeTaps(&taps);
+    const int tap_count = probe.hasTaps() ? probe.taps->tapCount() : 0;
+    
+    // The block's shares for the mix bus. The visualizer is shown the audio
+    // as muted now, and no taps of muted channels, as when gme muted them.
+    const int frames = sample_count / 2;
+    state.mix_bus.feed(taps, tap_frames, tap_count, state.channels.voice_channel.data());
+    state.mix_bus.write(stream_frame, samples, frames, probe.nsf ? probe.nsf->silence_lookahead_samples() / 2 : 0);
+    const uint32_t muted = state.mix_bus.mutedEntries(state.visualizer.getMuteMask());
+    const int* tap_channels = state.channels.voice_channel.data();
+    int unmuted_channels[ChannelTapBuffer::MAX_TAPS];
+    if (muted && tap_count > 0) {
+        for (int t = 0; t < tap_count; ++t) {
+            const int entry = tap_channels[t];
+            unmuted_channels[t] = entry >= 0 && ((muted >> entry) & 1) ? -1 : entry;
+        }
+        tap_channels = unmuted_channels;
     }
+    state.visualizer.updateChannelTaps(taps, tap_frames, tap_count, tap_channels, stream_frame);
     
     // Update visualizer with audio data
-    state.visualizer.updateAudioData(temp_buffer.data(), num_samples);
-    
-    // Update playback time
-    float current_time = gme_tell(state.emu) / 1000.0f;
-    state.playback_time.store(current_time);
-    
-    // Update piano visualizer and channel levels with APU data
-    // Try to get APU data directly from Nsf_Emu
-    Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(state.emu);
-    if (nsf) {
-        Nes_Apu* apu = nsf->apu_();
-        if (apu) {
-            int periods[5], lengths[5], amplitudes[5];
-            for (int i = 0; i < 5; ++i) {
-                periods[i] = apu->osc_period(i);
-                lengths[i] = apu->osc_length(i);
-                amplitudes[i] = apu->osc_amplitude(i);
+    if (muted && sample_count <= static_cast<int>(state.render_muted.size())) {
+        std::copy(samples, samples + sample_count, state.render_muted.begin());
+        state.mix_bus.removeMuted(stream_frame, state.render_muted.data(), frames, muted);
+        samples = state.render_muted.data();
+    }
+    state.visualizer.updateAudioData(samples, sample_count, stream_frame);
+    
+    // One pass over every chip's registers feeds the levels and the
+    // expansion chips' keys, both shown once heard, where the chips are:
+    // past the block by the emulator's lead. The APU's keys come from its
+    // writes, replayed as heard.
+    if (probe.hasApu()) {
+        const int64_t lead = probe.nsf->samples_ahead() / 2;
+        const int64_t sampled_at = stream_frame + sample_count / 2 + lead;
+        state.channels.sample(probe);
+        state.visualizer.updateChannelLevels(state.channels, sampled_at);
+        if (state.channels.count > ChannelTable::APU_CHANNELS) {
+            state.piano.queueKeys(state.channels, ChannelTable::APU_CHANNELS, state.channels.count, sampled_at);
+        }
+        state.nsf_timeline.capture(stream_frame, frames, lead);
+    }
+}
+
+// Give the playing track its fade again; starting or seeking back clears it (audio_mutex held)
+static void apply_fade() {
+    if (state.emu && state.fade_start_ms >= 0) {
+        state.emu->set_fade(state.fade_start_ms, state.fade_ms);
+    }
+}
+
+// Make the prefetched track the playing one (audio_mutex held, prefetch READY).
+// The old emulator is parked in retired_emu since the UI may still be reading it.
+static void swap_in_prefetch() {
+    TrackPrefetch& pf = state.prefetch;
+    assert(!state.retired_emu);
+    
+    state.retired_emu = state.emu;
+    state.emu = pf.emu;
+    state.probe = pf.probe;
+    state.seek_index = std::move(pf.seek_index);
+    state.fade_start_ms = pf.fade_start_ms;
+    state.fade_ms = pf.fade_ms;
+    std::swap(state.prerender, pf.pcm);
+    state.prerender_pos = 0;
+    pf.emu = nullptr;
+    pf.probe = ChannelProbe();
+    if (state.probe.hasTaps()) {
+        state.probe.taps->setCapture(true);
+    }
+    state.mix_bus.restart();  // The opening plays without taps; the new emulator's follow it
+    
+    // Settings may have changed while the worker ran
+    state.visualizer.setMutesInEmulator(!state.probe.hasTaps());
+    gme_mute_voices(state.emu, state.visualizer.emulatorMuteMask());
+    state.emu_mute_mask = state.visualizer.emulatorMuteMask();
+    state.emu_synth_quality = -1;
+    if (pf.tempo != state.emu_tempo) {
+        // The pre-rendered opening no longer matches; start over at the new tempo
+        gme_set_tempo(state.emu, state.emu_tempo);
+        gme_start_track(state.emu, pf.track);
+        apply_fade();
+        state.prerender_pos = state.prerender.size();
+    }
+    if (!state.seek_index.matches(pf.track, state.emu_tempo)) {
+        state.seek_index.reset(pf.track, state.emu_tempo);
+    }
+    
+    pf.status.store(TrackPrefetch::IDLE);
+}
+
+// The playing track ended on the render thread (audio_mutex held)
+static void handle_track_end() {
+    int status = state.prefetch.status.load();
+    if (status == TrackPrefetch::READY && !state.prefetch.other_file) {
+        const int64_t end_frames = state.render.rendered_frames.load();
+        swap_in_prefetch();
+        
+        // rendered_frames before boundary_pending, see audio_stream_callback
+        state.render.rendered_frames.store(0);
+        state.render.boundary_frames.store(end_frames);
+        state.render.boundary_pending.store(true);
+    } else if (status != TrackPrefetch::WORKING) {
+        // Nothing coming, or another file the UI has to switch to; the UI
+        // decides whether to advance. While the worker is still busy the
+        // ended track renders silence until it is ready.
+        state.render.track_end_unhandled.store(true);
+    }
+}
+
+// Render-ahead producer thread: keeps render_ring filled render_ahead_ms deep.
+// gme renders straight into the ring, and the visualizer copies its share
+// from there; the callback converts each sample once on the way out.
+static void render_thread_func() {
+    const size_t chunk_samples = RENDER_CHUNK_FRAMES * 2;
+    
+    while (state.ui.render_thread_running.load()) {
+        state.render_scheduling.poll();
+        
+        // Controls the UI queued since the last block
+        if (state.audio_commands.readAvailable() > 0) {
+            std::lock_guard<std::mutex> lock(audio_mutex);
+            apply_audio_commands();
+        }
+        
+        // Never ask for more than the ring can hold alongside one more chunk
+        size_t target = static_cast<size_t>(state.ui.render_ahead_ms.load()) * state.sample_rate / 1000 * 2;
+        target = std::min(target, state.render_ring.capacity() - chunk_samples);
+        
+        if (!state.emu || !state.ui.is_playing.load() || state.render_ring.readAvailable() >= target) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            continue;
+        }
+        
+        size_t count = chunk_samples;
+        const int64_t stream_frame = static_cast<int64_t>(state.render_ring.writePosition() / 2);  // Producer side, stable
+        {
+            std::lock_guard<std::mutex> lock(audio_mutex);
+            if (!state.emu) continue;
+            
+            // Process seek request if any, through the nearest keyframe when possible
+            long seek_pos = take_request(state.ui.seek_request, -1L);
+            if (seek_pos >= 0) {
+                Nsf_Emu* nsf = state.probe.nsf;
+                if (!nsf || !state.seek_index.seek(nsf, nsf->current_track(), state.emu_tempo, seek_pos)) {
+                    gme_seek(state.emu, seek_pos);
+                }
+                apply_fade();
+                const short* skipped_taps;
+                state.probe.takeTaps(&skipped_taps);  // Rendered while seeking
+                state.mix_bus.restart();
+                state.prerender_pos = state.prerender.size();
+                state.ui.render_flush.store(true);
+                state.nsf_timeline.discard();  // Writes made while seeking are never heard
+            }
+            
+            // A finished track continues straight into the prefetched one
+            if (state.prerender_pos >= state.prerender.size() && gme_track_ended(state.emu)) {
+                handle_track_end();
+            }
+            
+            int64_t current_frames;
+            if (state.prerender_pos < state.prerender.size()) {
+                // Queue the opening the prefetch worker rendered; the emulator is already past it
+                const short* opening = state.prerender.data() + state.prerender_pos;
+                count = state.render_ring.pushInPlace(std::min(count, state.prerender.size() - state.prerender_pos),
+                                                      [&](short* dst, size_t offset, size_t n) {
+                    std::copy(opening + offset, opening + offset + n, dst);
+                    state.mix_bus.writeSilent(stream_frame + static_cast<int64_t>(offset / 2), static_cast<int>(n / 2));
+                });
+                state.prerender_pos += count;
+                current_frames = static_cast<int64_t>(state.prerender_pos / 2);
+                state.visualizer.updateChannelTaps(nullptr, 0, 0, nullptr);  // Rendered without taps
+                state.visualizer.updateAudioData(opening, static_cast<int>(count), stream_frame);
+            } else {
+                // Game_Music_Emu generates 16-bit signed samples (stereo) into
+                // the ring's free space, in two runs where it wraps; positions
+                // stay even, so each run is whole frames
+                const AudioTelemetry::Clock::time_point play_start = AudioTelemetry::Clock::now();
+                gme_err_t err = nullptr;
+                const int mute_mask = state.visualizer.emulatorMuteMask();
+                if (mute_mask != state.emu_mute_mask) {
+                    gme_mute_voices(state.emu, mute_mask);
+                    state.emu_mute_mask = mute_mask;
+                }
+                const int synth_quality = state.ui.synth_quality.load(std::memory_order_relaxed);
+                if (synth_quality != state.emu_synth_quality) {
+                    if (state.probe.hasTaps()) state.probe.taps->synth_quality(synth_quality);
+                    state.emu_synth_quality = synth_quality;
+                }
+                state.nsf_timeline.attach(state.probe.apu);
+                count = state.render_ring.pushInPlace(count, [&](short* dst, size_t offset, size_t n) {
+                    if (!err) err = gme_play(state.emu, static_cast<int>(n), dst);
+                    if (err) {
+                        std::fill(dst, dst + n, short{0});
+                        return;
+                    }
+                    update_nsf_visualizers(dst, static_cast<int>(n), stream_frame + static_cast<int64_t>(offset / 2));
+                });
+                FrameProfiler::add(FrameProfiler::EMULATION, AudioTelemetry::Clock::now() - play_start);
+                if (err) {
+                    state.ui.is_playing.store(false);
+                    continue;
+                }
+                state.telemetry.recordRender(play_start, state.emu->silence_lookahead_samples() / 2,
+                                             synth_quality, count / 2 * 1000.0 / state.sample_rate);
+                
+                current_frames = state.emu->tell_frames();
+                
+                // Grow the keyframe index as playback reaches new ground
+                Nsf_Emu* nsf = state.probe.nsf;
+                state.play_profile.capture(nsf);
+                if (nsf && state.seek_index.matches(nsf->current_track(), state.emu_tempo)) {
+                    state.seek_index.capture(nsf);
+                }
+            }
+            state.render.rendered_frames.store(current_frames);
+        }
+    }
+}
+
+// Save or load a slot asked for by the UI, between frames (emulation thread).
+// Saving only snapshots into memory; SaveSlots writes the file behind. A load
+// waits for a slot still being read.
+static void nes_apply_slot_requests() {
+    const int save = take_request(state.ui.nes_save_slot, -1);
+    int load = state.ui.nes_load_slot.load();
+    if (save < 0 && load < 0) return;
+    
+    std::lock_guard<std::mutex> lock(nes_mutex);
+    if (save >= 0 && state.nes_rom_loaded) {
+        std::vector<uint8_t> saved;
+        if (state.nes_emu.saveState(saved)) state.nes_slots.store(save, std::move(saved));
+    }
+    if (load < 0) return;
+    
+    const SaveSlots::Status status = state.nes_slots.status(load);
+    if (status == SaveSlots::Status::Reading) return;
+    std::vector<uint8_t> loaded;
+    if (state.nes_rom_loaded && state.nes_slots.fetch(load, loaded) && state.nes_emu.loadState(loaded)) {
+        // The prediction was of the run left behind
+        state.nes_lookahead.start(state.nes_emu);
+    }
+    state.ui.nes_load_slot.compare_exchange_strong(load, -1);
+}
+
+// Emulation > Movie: input recorded from power-on and played back frame for
+// frame, between emulation frames (UI thread)
+static void record_nes_movie() {
+    std::lock_guard<std::mutex> lock(nes_mutex);
+    state.nes_emu.recordMovie();
+    state.nes_movie_error.clear();
+}
+
+static void save_nes_movie() {
+    nfdu8filteritem_t filterItem[1];
+    filterItem[0].name = "Input Movie";
+    filterItem[0].spec = "fcm";
+    nfdu8char_t* outPath = nullptr;
+    // Recording goes on while the dialog is open; cancelled, it still does
+    if (save_file_dialog(&outPath, filterItem, 1, nullptr, "movie.fcm") != NFD_OKAY) return;
+    InputMovie movie;
+    {
+        std::lock_guard<std::mutex> lock(nes_mutex);
+        movie = state.nes_emu.stopMovie();
+    }
+    state.nes_movie_error.clear();
+    movie.save(outPath, &state.nes_movie_error);
+    NFD_FreePathU8(outPath);
+}
+
+static void play_nes_movie() {
+    nfdu8filteritem_t filterItem[1];
+    filterItem[0].name = "Input Movie";
+    filterItem[0].spec = "fcm";
+    nfdu8char_t* outPath = nullptr;
+    if (open_file_dialog(&outPath, filterItem, 1, nullptr) != NFD_OKAY) return;
+    InputMovie movie;
+    state.nes_movie_error.clear();
+    if (movie.load(outPath, &state.nes_movie_error)) {
+        std::lock_guard<std::mutex> lock(nes_mutex);
+        if (!state.nes_emu.playMovie(std::move(movie))) state.nes_movie_error = "The movie was recorded on another ROM";
+    }
+    NFD_FreePathU8(outPath);
+}
+
+// NES emulation thread: runs frames on a 60.0988 Hz timer whatever the display
+// refresh, and the UI thread only uploads the latest finished one. The audio
+// device drifts from that timer, so rate control stretches the APU output by
+// up to NesEmulator::MAX_RATE_ADJUST to hold the buffer's mean fill at
+// nes_ahead_ms; the fill is smoothed over about a second so the device's
+// block-sized reads don't wobble the pitch.
+static void nes_thread_func() {
+    using clock = std::chrono::steady_clock;
+    const auto frame_period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / NES_FRAME_RATE));
+    constexpr double FILL_SMOOTHING = 1.0 / 60.0;
+    constexpr double RATE_GAIN = 4.0;  // Full correction a quarter off the target
+    constexpr int MAX_FRAMESKIP = 4;   // The picture still moves at 12 fps
+    constexpr float JITTER_DECAY = 0.9983f;  // Per frame, about ten seconds
+    constexpr float MAX_JITTER_MS = 250.0f;  // Longer is a stall, not jitter a buffer covers
+    auto next_frame = clock::now();
+    bool primed = false;         // Buffer filled to the target since (re)starting
+    double smoothed_fill = 0.0;  // Samples
+    int skipped = 0;             // Frames in a row not converted
+    
+    while (state.ui.nes_thread_running.load()) {
+        state.nes_scheduling.poll();
+        nes_apply_slot_requests();
+        if (current_mode != AppMode::NES_EMULATOR || !state.nes_emu.isRunning()) {
+            if (primed) state.nes_emu.setRateAdjust(0.0);
+            primed = false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            next_frame = clock::now();
+            continue;
+        }
+        
+        // Never ask for more than the buffer can hold alongside one more frame
+        const long frame_samples = static_cast<long>(state.sample_rate / NES_FRAME_RATE) + 1;
+        long target = static_cast<long>(state.ui.nes_ahead_ms.load()) * state.sample_rate / 1000;
+        target = std::min(target, state.nes_emu.bufferCapacity() - frame_samples);
+        
+        // Fast-forward runs frames back to back. Only a frame the UI can show is
+        // converted, and audio past the target is dropped so normal speed resumes
+        // without a backlog.
+        if (state.ui.nes_fast_forward.load()) {
+            std::lock_guard<std::mutex> lock(nes_mutex);
+            FrameProfiler::Scope profile_scope(FrameProfiler::EMULATION);
+            state.nes_emu.runFrame(!state.nes_emu.screenPending());
+            state.nes_emu.trimAudio(target);
+            state.nes_lookahead.onFrame(state.nes_emu, state.nes_emu.frameInput(0));
+            state.nes_rewind.capture(state.nes_emu);
+            state.nes_battery.onFrame(state.nes_emu);
+            next_frame = clock::now();
+            continue;
+        }
+        
+        // Rewind steps back a recorded frame each period, in silence; the
+        // buffer is filled afresh once play goes on
+        if (state.ui.nes_rewinding.load()) {
+            const auto now = clock::now();
+            if (now < next_frame) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
             }
-            state.visualizer.updateChannelAmplitudesFromAPU(amplitudes, lengths);
-            state.piano.updateFromAPU(periods, lengths, amplitudes, current_time);
+            next_frame = std::max(next_frame + frame_period, now - frame_period);
+            std::lock_guard<std::mutex> lock(nes_mutex);
+            state.nes_rewind.stepBack(state.nes_emu);
+            state.nes_battery.onFrame(state.nes_emu);
+            primed = false;
+            continue;
         }
         
-        // VRC6 expansion chip support
-        Nes_Vrc6_Apu* vrc6 = nsf->vrc6_();
-        if (vrc6) {
-            // Enable VRC6 mode in visualizers
-            state.visualizer.setVRC6Enabled(true);
-            state.piano.setVRC6Enabled(true);
+        // Display pacing runs the frames the UI thread asks for; the timer
+        // then only keeps time, so nothing is late and nothing bursts when
+        // pacing switches back
+        const bool display_paced = state.ui.nes_frame_pacing.load() == FramePacing::DISPLAY;
+        const auto now = clock::now();
+        if (display_paced) next_frame = now;
+        bool due = display_paced ? state.nes.nes_frames_served.load() != state.ui.nes_frame_requests.load()
+                                 : now >= next_frame;
+        long fill = 0;
+        if (state.audio_initialized) {
+            fill = state.nes_emu.samplesAvailable();
             
-            // Get VRC6 channel data
-            int vrc6_amplitudes[3];
-            int vrc6_periods[3];
-            int vrc6_volumes[3];
-            bool vrc6_enabled[3];
-            for (int i = 0; i < 3; ++i) {
-                vrc6_periods[i] = vrc6->osc_period(i);
-                vrc6_amplitudes[i] = vrc6->osc_amplitude(i);
-                vrc6_volumes[i] = vrc6->osc_volume(i);
-                vrc6_enabled[i] = vrc6->osc_enabled(i);
+            // Fill up at once on start, and whenever an underrun is a frame away;
+            // hold off while the device isn't draining at all
+            if (!primed && fill >= target) {
+                primed = true;
+                smoothed_fill = static_cast<double>(fill);
             }
-            state.visualizer.updateVRC6ChannelAmplitudes(vrc6_amplitudes);
-            state.piano.updateFromVRC6(vrc6_periods, vrc6_volumes, vrc6_enabled, current_time);
-        } else {
-            state.visualizer.setVRC6Enabled(false);
-            state.piano.setVRC6Enabled(false);
+            if (!primed || fill < frame_samples) due = true;
+            if (fill >= state.nes_emu.bufferCapacity() - frame_samples) due = false;
+        }
+        if (!due) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        
+        // Auto frameskip: a frame started over half a period late, or one the
+        // audio is about to run out for, is still emulated but not converted
+        const bool late = now - next_frame > frame_period / 2 || (primed && fill < frame_samples);
+        const bool present = !state.ui.nes_auto_frameskip.load() || !late || skipped >= MAX_FRAMESKIP;
+        skipped = present ? 0 : skipped + 1;
+        if (!present) state.nes.nes_skipped_frames.fetch_add(1, std::memory_order_relaxed);
+        
+        // Peak lateness of the frames the timer was due for, which auto-sizing
+        // leaves room for in the APU buffer
+        if (now >= next_frame) {
+            const float late_ms = std::chrono::duration<float, std::milli>(now - next_frame).count();
+            const float peak = state.nes.nes_jitter_ms.load(std::memory_order_relaxed) * JITTER_DECAY;
+            state.nes.nes_jitter_ms.store(late_ms < MAX_JITTER_MS ? std::max(peak, late_ms) : peak,
+                                      std::memory_order_relaxed);
+        }
+        
+        // Late frames are not caught up in a burst; the buffer covers them
+        next_frame = std::max(next_frame + frame_period, now - frame_period);
+        
+        std::lock_guard<std::mutex> lock(nes_mutex);
+        if (primed) {
+            smoothed_fill += (static_cast<double>(fill) - smoothed_fill) * FILL_SMOOTHING;
+            const double error = (static_cast<double>(target) - smoothed_fill) / static_cast<double>(target);
+            state.nes_emu.setRateAdjust(error * RATE_GAIN * NesEmulator::MAX_RATE_ADJUST);
+        }
+        {
+            FrameProfiler::Scope profile_scope(FrameProfiler::EMULATION);
+            state.nes_emu.runFrame(present);
         }
+        if (state.nes.nes_frames_served.load() != state.ui.nes_frame_requests.load()) state.nes.nes_frames_served.fetch_add(1);
+        state.nes_lookahead.onFrame(state.nes_emu, state.nes_emu.frameInput(0));
+        state.nes_rewind.capture(state.nes_emu);
+        state.nes_battery.onFrame(state.nes_emu);
     }
-    
-    // Convert 16-bit signed integer to 32-bit float (-1.0 to 1.0)
-    // Apply volume control
-    float volume_linear = std::pow(10.0f, state.volume_db / 20.0f);
-    for (int i = 0; i < num_samples; i++) {
-        buffer[i] = (temp_buffer[i] / 32768.0f) * volume_linear;
+}
+
+// Display pacing: ask the emulation thread for the frames this display frame
+// covers and wait for them, so the upload that follows shows them (UI thread)
+static void pace_nes_frame() {
+    if (state.ui.nes_frame_pacing.load() != FramePacing::DISPLAY || state.ui.nes_fast_forward.load() ||
+        state.ui.nes_rewinding.load()) {
+        state.nes_display_clock = 0.0;
+        return;
+    }
+    const double period = 1.0 / NES_FRAME_RATE;
+    state.nes_display_clock = std::min(state.nes_display_clock + sapp_frame_duration(), 2.0 * period);
+    if (state.nes_display_clock < period) return;
+    state.nes_display_clock -= period;
+    
+    // One outstanding request at most: a frame the thread could not run in
+    // time is not owed on top of the next
+    if (state.nes.nes_frames_served.load() != state.ui.nes_frame_requests.load()) return;
+    const uint32_t request = state.ui.nes_frame_requests.fetch_add(1) + 1;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PACED_FRAME_WAIT_MS);
+    while (state.nes.nes_frames_served.load() != request && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
     }
 }
 
 // Helper to get APU from emulator
 Nes_Apu* getApuFromEmu(Music_Emu* emu) {
-    Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
-    if (nsf) {
-        return nsf->apu_();
-    }
-    return nullptr;
+    return ChannelProbe::resolve(emu).apu;
 }
 
-// Preprocess current track for piano visualization
+// Put the current track first in the note store's queue; until its notes
+// arrive the roll is empty rather than the old track's (UI thread)
 void preprocess_piano_track() {
-    if (!state.emu || state.preprocessing.load()) return;
-    
-    state.preprocessing.store(true);
-    state.preprocess_progress.store(0.0f);
+    if (!state.emu) return;
+    if (state.piano_track != state.current_track) {
+        state.piano.reset();
+        state.piano_track = -1;
+        state.piano_notes.reset();
+    }
+    // Keyframes are only valid for playback at 1.0x
+    state.notes.setCurrentTrack(state.current_track, state.tempo == 1.0f);
+}
+
+// Adopt the current track's notes and keyframes once the store has them (UI thread, once per frame)
+static void poll_preprocess() {
+    if (!state.emu || current_mode != AppMode::NSF_PLAYER) return;
+    // Prefixes of a track in progress are taken as they grow
+    if (state.piano_track != state.current_track || (state.piano_notes && !state.piano_notes->complete)) {
+        auto track = state.notes.notes(state.current_track);
+        if (track && track != state.piano_notes) {
+            state.piano.setPreprocessedData(*track);
+            state.piano_track = state.current_track;
+            state.piano_notes = std::move(track);
+        }
+    }
     
-    // Create a separate emulator instance for preprocessing
-    Music_Emu* preprocess_emu = nullptr;
-    gme_err_t err = gme_open_file(state.loaded_file, &preprocess_emu, state.sample_rate);
+    // Snapshots transfer between instances of the same file, hand them to
+    // playback unless the tempo has changed since they were taken
+    SeekIndex index;
+    if (state.notes.takeSeekIndex(state.current_track, index)) {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        if (index.matches(state.current_track, state.emu_tempo)) state.seek_index = std::move(index);
+    }
+}
+
+// Show the emulator's predicted notes as they come in (UI thread, once per frame)
+static void poll_lookahead() {
+    if (current_mode != AppMode::NES_EMULATOR) return;
+    auto notes = state.nes_lookahead.notes();
+    if (notes != state.piano_notes) {
+        if (notes) state.piano.setPreprocessedData(*notes);
+        else state.piano.setPreprocessedData(PreprocessedTrack());
+        state.piano_notes = std::move(notes);
+    }
+}
+
+// Info of every track of emu, read once per file so the UI never asks gme
+static std::vector<track_info_t> read_track_info(Music_Emu* emu) {
+    std::vector<track_info_t> info(static_cast<size_t>(std::max(gme_track_count(emu), 0)));
+    for (size_t track = 0; track < info.size(); ++track) {
+        if (gme_track_info(emu, &info[track], static_cast<int>(track)) != nullptr) {
+            info[track] = track_info_t();
+            info[track].length = -1;
+        }
+    }
+    return info;
+}
+
+// Prefetch worker: prepare pf.track on a second emulator while the current track plays
+static void prefetch_thread_func(std::shared_ptr<const MusicFile> file) {
+    TrackPrefetch& pf = state.prefetch;
+    const int track = pf.track;
+    
+    // A queue entry from another file is read here, off the UI thread
+    gme_err_t err = nullptr;
+    if (!file) {
+        file = MusicFile::read(pf.path.c_str(), &err);
+        if (!file) {
+            pf.status.store(TrackPrefetch::FAILED);
+            return;
+        }
+    }
+    pf.file = file;
     
-    if (err || !preprocess_emu) {
-        state.preprocessing.store(false);
+    // Capture stays off until the track is swapped in
+    Music_Emu* emu = nullptr;
+    ChannelTapBuffer* taps = nullptr;
+    err = open_tapped_emu(*file, &emu, state.sample_rate, &taps);
+    if (err || !emu) {
+        pf.status.store(TrackPrefetch::FAILED);
         return;
     }
+    ChannelProbe probe = ChannelProbe::resolve(emu, taps);
+    if (pf.other_file) {
+        pf.track_info = read_track_info(emu);
+    }
     
-    // Preprocess the track
-    state.piano.preprocessTrack(
-        preprocess_emu, 
-        state.current_track, 
+    // Note data and keyframes come from a pass at normal tempo, as in TrackNoteStore
+    pf.seek_index.reset(track, 1.0);
+    pf.piano.preprocessTrack(
+        emu,
+        track,
         state.sample_rate,
-        [](Music_Emu* emu) -> Nes_Apu* {
-            Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
-            return nsf ? nsf->apu_() : nullptr;
-        },
-        [](float progress) {
-            state.preprocess_progress.store(progress);
+        ChannelTable::forProbe(probe),
+        [&probe](Music_Emu*, ChannelTable& table) {
+            table.sample(probe);
         },
-        [](Music_Emu* emu) -> Nes_Vrc6_Apu* {
-            Nsf_Emu* nsf = dynamic_cast<Nsf_Emu*>(emu);
-            return nsf ? nsf->vrc6_() : nullptr;
+        probe.playInterval(),
+        nullptr,
+        [&](Music_Emu*) {
+            if (probe.nsf) pf.seek_index.capture(probe.nsf);
+            return !pf.cancel.load();
         }
     );
+    if (pf.tempo != 1.0f) {
+        pf.seek_index.reset(track, pf.tempo);
+    }
     
-    // Cleanup preprocessing emulator
-    gme_delete(preprocess_emu);
+    // Restart for playback and render the opening
+    gme_set_tempo(emu, pf.tempo);
+    err = gme_start_track(emu, track);
+    if (!err && pf.fade_start_ms >= 0) {
+        emu->set_fade(pf.fade_start_ms, pf.fade_ms);
+    }
+    pf.pcm.resize(static_cast<size_t>(state.sample_rate) * PREFETCH_RENDER_MS / 1000 * 2);
+    for (size_t pos = 0; !err && pos < pf.pcm.size() && !pf.cancel.load(); pos += RENDER_CHUNK_FRAMES * 2) {
+        size_t count = std::min<size_t>(RENDER_CHUNK_FRAMES * 2, pf.pcm.size() - pos);
+        err = gme_play(emu, static_cast<int>(count), pf.pcm.data() + pos);
+    }
     
-    state.preprocessing.store(false);
-    state.preprocess_progress.store(1.0f);
+    if (err || pf.cancel.load()) {
+        gme_delete(emu);
+        pf.status.store(err ? TrackPrefetch::FAILED : TrackPrefetch::IDLE);
+        return;
+    }
+    pf.emu = emu;
+    pf.probe = probe;
+    pf.status.store(TrackPrefetch::READY);
+}
+
+// Stop the prefetch worker and free an emulator it prepared but nobody took (UI thread)
+static void cancel_prefetch() {
+    TrackPrefetch& pf = state.prefetch;
+    pf.cancel.store(true);
+    JobPool::shared().cancel(pf.job);
+    JobPool::shared().wait(pf.job);
+    
+    Music_Emu* unused = nullptr;
+    {
+        // The render thread may be swapping a READY prefetch in right now
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        unused = pf.emu;
+        pf.emu = nullptr;
+        pf.probe = ChannelProbe();
+        pf.file.reset();
+        pf.status.store(TrackPrefetch::IDLE);
+    }
+    if (unused) {
+        gme_delete(unused);
+    }
 }
 
-// Safe track start - can be called from UI thread
+// Start the worker on pf's settings; file is null for one it has to read (UI thread)
+static void launch_prefetch(std::shared_ptr<const MusicFile> file) {
+    TrackPrefetch& pf = state.prefetch;
+    pf.tempo = state.tempo;
+    pf.cancel.store(false);
+    pf.status.store(TrackPrefetch::WORKING);
+    JobPool::shared().submit(pf.job, JobPool::Priority::High,
+                             [file = std::move(file)]() mutable { prefetch_thread_func(std::move(file)); });
+}
+
+// Prepare track in the background so the switch to it is gapless (UI thread)
+static void start_prefetch(int track) {
+    cancel_prefetch();
+    if (!state.emu || !state.music_file || track < 0 || track >= state.track_count) return;
+    
+    TrackPrefetch& pf = state.prefetch;
+    pf.track = track;
+    pf.path.clear();
+    pf.other_file = false;
+    pf.queue_index = -1;
+    pf.fade_start_ms = -1;
+    launch_prefetch(state.music_file);
+}
+
+// Prepare what plays after the current track: the next queue entry while
+// playing from the queue, which may be in another file, else the loaded
+// file's next track (UI thread)
+static void prefetch_next() {
+    if (state.queue.current() < 0) {
+        start_prefetch(state.current_track + 1);
+        return;
+    }
+    cancel_prefetch();
+    const int next = state.queue.next();
+    if (!state.emu || next < 0) return;
+    
+    const PlayQueue::Item& item = state.queue.items()[next];
+    TrackPrefetch& pf = state.prefetch;
+    pf.track = item.track;
+    pf.path = item.path;
+    pf.other_file = item.path != state.loaded_file;
+    pf.queue_index = next;
+    pf.fade_start_ms = item.length_ms;
+    pf.fade_ms = item.fade_ms;
+    launch_prefetch(pf.other_file ? nullptr : state.music_file);
+}
+
+// Catch the UI up with a switch the render thread made (UI thread)
+static void finish_track_switch() {
+    Music_Emu* retired = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        retired = state.retired_emu;
+        state.retired_emu = nullptr;
+    }
+    if (retired) {
+        gme_delete(retired);
+    }
+    JobPool::shared().wait(state.prefetch.job);
+    
+    // The prefetch pass made both notes and keyframes, the store need not redo them
+    state.current_track = state.prefetch.track;
+    if (state.prefetch.queue_index >= 0) {
+        state.queue.setCurrent(state.prefetch.queue_index);
+    }
+    state.piano.swapPreprocessedData(state.prefetch.piano);
+    state.piano_track = state.current_track;
+    state.piano_notes.reset();
+    state.notes.setCurrentTrack(state.current_track, false);
+    state.visualizer.setEmulator(state.emu);
+    
+    prefetch_next();
+}
+
+// Finish a pending switch right away, even if its boundary is still queued.
+// Returns true if the current track changed.
+static bool sync_track_switch() {
+    if (take_request(state.render.boundary_pending, false)) {
+        state.audio.track_switched.store(true);
+    }
+    if (!take_request(state.audio.track_switched, false)) return false;
+    finish_track_switch();
+    return true;
+}
+
+// Switch to track immediately if it is the one prefetched, for the same queue
+// entry or outside the queue (UI thread)
+static bool adopt_prefetched_track(int track, int queue_index) {
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        apply_audio_commands();  // A tempo change the prefetch has to follow
+        TrackPrefetch& pf = state.prefetch;
+        if (pf.status.load() != TrackPrefetch::READY || pf.track != track || pf.queue_index != queue_index ||
+            pf.other_file) {
+            return false;
+        }
+        
+        state.ui.seek_request.store(-1);
+        swap_in_prefetch();
+        state.render.rendered_frames.store(0);
+        state.ui.render_flush.store(true);  // Drop frames from the previous track
+        state.ui.is_playing.store(true);
+    }
+    finish_track_switch();
+    return true;
+}
+
+// Start track on the playing emulator (audio_mutex held)
+static void start_emu_track(const AudioCommand& command) {
+    gme_start_track(state.emu, command.track);
+    state.mix_bus.restart();
+    if (!state.seek_index.matches(command.track, state.emu_tempo)) {
+        state.seek_index.reset(command.track, state.emu_tempo);
+    }
+    state.fade_start_ms = command.fade_start_ms;
+    state.fade_ms = command.fade_ms;
+    apply_fade();
+    state.prerender_pos = state.prerender.size();
+    state.render.rendered_frames.store(0);
+    state.ui.render_flush.store(true);  // Drop frames from the previous track
+    state.ui.is_playing.store(true);  // Resume playback
+}
+
+// Apply the controls queued for the playing emulator, in order (render
+// thread between blocks, or the UI thread before it swaps the emulator;
+// audio_mutex held)
+static void apply_audio_commands() {
+    AudioCommand command;
+    while (state.audio_commands.pop(&command, 1) == 1) {
+        if (!state.emu) continue;
+        switch (command.type) {
+            case AudioCommand::START_TRACK:
+                start_emu_track(command);
+                break;
+            case AudioCommand::SET_TEMPO:
+                state.emu_tempo = command.tempo;
+                gme_set_tempo(state.emu, command.tempo);
+                state.seek_index.reset(command.track, command.tempo);
+                break;
+        }
+    }
+}
+
+// Hand command to the render thread (UI thread). Only a render thread too
+// far behind to take it is waited for, and the command applied here instead.
+static void post_audio_command(const AudioCommand& command) {
+    if (state.audio_commands.push(&command, 1) == 1) return;
+    std::lock_guard<std::mutex> lock(audio_mutex);
+    apply_audio_commands();
+    state.audio_commands.push(&command, 1);
+    apply_audio_commands();
+}
+
+// Start track on the render thread, with the queue entry's fade (UI thread)
 void safe_start_track(int track) {
     if (!state.emu) return;
     
-    // Request the audio thread to start the track
-    state.is_playing.store(false);  // Pause playback
+    // A switch that has not reached the speaker yet still counts as done
+    if (sync_track_switch()) {
+        track = state.current_track;
+    }
     
-    std::lock_guard<std::mutex> lock(audio_mutex);
-    state.seek_request.store(-1);  // Clear any pending seek
-    gme_start_track(state.emu, track);
-    state.is_playing.store(true);  // Resume playback
+    // Paused until the render thread has started the track
+    state.ui.is_playing.store(false);
+    state.ui.seek_request.store(-1);  // Clear any pending seek
+    AudioCommand command;
+    command.type = AudioCommand::START_TRACK;
+    command.track = track;
+    
+    // Queue entries fade out at their set length
+    const int entry = state.queue.current();
+    if (entry >= 0 && state.queue.items()[entry].track == track) {
+        command.fade_start_ms = state.queue.items()[entry].length_ms;
+        command.fade_ms = state.queue.items()[entry].fade_ms;
+    }
+    post_audio_command(command);
 }
 
-// Start track and preprocess for piano
-void start_track_with_preprocess(int track) {
+// Start track of the loaded file, for the queue's current entry or outside it
+static void start_track(int track) {
+    sync_track_switch();
     state.current_track = track;
     
-    // Preprocess first (this will use a separate emulator)
-    preprocess_piano_track();
+    // The next track may already be waiting on the prefetch emulator
+    if (adopt_prefetched_track(track, state.queue.current())) return;
+    cancel_prefetch();
     
-    // Then start playback
+    // Notes are worked out on a separate emulator while playback starts
+    preprocess_piano_track();
     safe_start_track(track);
+    
+    // And prepare the one after it
+    prefetch_next();
 }
 
-void load_nsf_file(const char* path) {
-    // Stop playback first
-    state.is_playing.store(false);
-    
-    // Wait for audio thread to stop using the emulator
-    std::lock_guard<std::mutex> lock(audio_mutex);
-    
-    // Clean up previous emulator
+// Start track and preprocess for piano; a track picked by hand leaves the queue
+void start_track_with_preprocess(int track) {
+    state.queue.setCurrent(-1);
+    start_track(track);
+}
+
+// Stop the workers reading the loaded file before it changes (UI thread)
+static void stop_file_workers() {
+    state.notes.stop();
+    std::lock_guard<std::mutex> nes_lock(nes_mutex);
+    state.nes_lookahead.stop();
+    state.nes_rewind.stop();
+}
+
+// Forget the loaded file's playback state and hand its emulators to
+// garbage, to be freed once audio_mutex is released (audio_mutex held)
+static void release_music_file(std::vector<Music_Emu*>& garbage) {
     if (state.emu) {
-        gme_delete(state.emu);
+        garbage.push_back(state.emu);
         state.emu = nullptr;
     }
-    
-    // Reset seek request
-    state.seek_request.store(-1);
-    
-    // Load new file
-    gme_err_t err = gme_open_file(path, &state.emu, state.sample_rate);
-    if (err) {
-        strncpy(state.error_msg, err, sizeof(state.error_msg) - 1);
-        state.error_msg[sizeof(state.error_msg) - 1] = '\0';
-        return;
+    if (state.retired_emu) {
+        garbage.push_back(state.retired_emu);
+        state.retired_emu = nullptr;
     }
+    state.prerender_pos = state.prerender.size();
+    state.render.boundary_pending.store(false);
+    state.audio.track_switched.store(false);
+    state.render.track_end_unhandled.store(false);
+    state.probe = ChannelProbe();
+    state.channels = ChannelTable();
+    state.seek_index.reset();
+    state.fade_start_ms = -1;
+    state.music_file.reset();
+    state.track_info.clear();
+    
+    // Controls meant for the old file go with it
+    state.audio_commands.discard();
+    
+    // Reset seek request and drop frames rendered from the old file
+    state.ui.seek_request.store(-1);
+    state.ui.render_flush.store(true);
+}
+
+// Make file, already opened into state.emu and state.probe, the loaded one
+// and point the player at track (audio_mutex held)
+static void install_music_file(std::shared_ptr<const MusicFile> file, std::vector<track_info_t> track_info,
+                               const char* path, int track) {
+    state.music_file = std::move(file);
+    state.track_info = std::move(track_info);
+    ++state.track_info_serial;
+    state.channels = ChannelTable::forProbe(state.probe);
+    state.visualizer.setChannelLayout(state.channels);
+    state.piano.setChannelLayout(state.channels);
+    state.mix_bus.setChannels(state.channels);
+    state.mix_bus.restart();
     
     // Get track info
     state.track_count = gme_track_count(state.emu);
-    state.current_track = 0;
+    state.current_track = track;
     state.error_msg[0] = '\0';
     strncpy(state.loaded_file, path, sizeof(state.loaded_file) - 1);
     state.loaded_file[sizeof(state.loaded_file) - 1] = '\0';
@@ -377,30 +1635,264 @@ void load_nsf_file(const char* path) {
     // Initialize visualizer with new emulator
     state.visualizer.init(state.emu, state.sample_rate);
     
-    // Reset piano visualizer and preprocess
+    // Reset piano visualizer and preprocess every track, the first one first
     state.piano.reset();
-    state.playback_time.store(0.0f);
-    
-    // Apply current settings
-    gme_set_tempo(state.emu, state.tempo);
-    gme_mute_voices(state.emu, state.visualizer.getMuteMask());
+    state.nsf_timeline.reset();
+    state.nsf_timeline.setClockRate(state.sample_rate);
+    state.piano_track = -1;
+    state.piano_notes.reset();
+    state.notes.start(state.music_file, state.track_count, state.sample_rate, state.current_track);
+    state.audio.playback_frames.store(0);
+    
+    // Apply current settings; with taps the mix bus mutes, not the emulator
+    state.emu_tempo = state.tempo;
+    gme_set_tempo(state.emu, state.emu_tempo);
+    state.visualizer.setMutesInEmulator(!state.probe.hasTaps());
+    state.emu_mute_mask = -1;
+    state.emu_synth_quality = -1;
 }
 
 // Called after load to preprocess piano data (call without holding audio_mutex)
 void postload_preprocess() {
     preprocess_piano_track();
+    prefetch_next();
+}
+
+// Loader worker: read and open state.file_load.path
+static void file_load_thread_func() {
+    FileLoad& load = state.file_load;
+    
+    // With per-voice taps where the emulator supports them. Read once; the
+    // preprocessing and prefetch emulators reuse the bytes.
+    gme_err_t err = nullptr;
+    load.file = MusicFile::read(load.path.c_str(), &err);
+    ChannelTapBuffer* taps = nullptr;
+    if (load.file) {
+        err = open_tapped_emu(*load.file, &load.emu, state.sample_rate, &taps);
+    }
+    if (err) {
+        load.error = err;
+        load.file.reset();
+    } else {
+        // Resolve typed chip pointers once; the expansion set is fixed per file
+        load.probe = ChannelProbe::resolve(load.emu, taps);
+        load.track_info = read_track_info(load.emu);
+    }
+    load.done.store(true);
+}
+
+// Wait for a load in progress and drop what it opened (UI thread)
+static void discard_file_load() {
+    FileLoad& load = state.file_load;
+    JobPool::shared().wait(load.job);
+    load.active = false;
+    if (load.emu) {
+        gme_delete(load.emu);
+        load.emu = nullptr;
+    }
+    load.file.reset();
+    load.probe = ChannelProbe();
+}
+
+// Open path in the background; once it is open it replaces the loaded file
+// and plays play_track (as queue entry queue_index), or is only prepared
+// when play_track is -1. A newer request replaces one not yet finished (UI thread).
+void load_nsf_file(const char* path, int play_track = -1, int queue_index = -1) {
+    discard_file_load();
+    FileLoad& load = state.file_load;
+    load.path = path;
+    load.error.clear();
+    load.play_track = play_track;
+    load.queue_index = queue_index;
+    load.done.store(false);
+    load.active = true;
+    JobPool::shared().submit(load.job, JobPool::Priority::High, file_load_thread_func);
+}
+
+// Install a finished load in place of the playing file (UI thread, once per frame)
+static void poll_file_load() {
+    FileLoad& load = state.file_load;
+    if (!load.active || !load.done.load()) return;
+    JobPool::shared().wait(load.job);
+    load.active = false;
+    if (!load.emu) {
+        // The playing file, if any, carries on
+        snprintf(state.error_msg, sizeof(state.error_msg), "%s", load.error.c_str());
+        return;
+    }
+    
+    // Stop playback first; a file loaded by hand leaves the queue
+    state.ui.is_playing.store(false);
+    state.queue.setCurrent(-1);
+    
+    // The prefetched track and any notes in progress belong to the old file
+    cancel_prefetch();
+    stop_file_workers();
+    
+    // Only pointer swaps and bookkeeping while the render thread is held off
+    std::vector<Music_Emu*> garbage;
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        release_music_file(garbage);
+        state.emu = load.emu;
+        state.probe = load.probe;
+        load.emu = nullptr;
+        load.probe = ChannelProbe();
+        if (state.probe.hasTaps()) {
+            state.probe.taps->setCapture(true);
+        }
+        install_music_file(std::move(load.file), std::move(load.track_info), load.path.c_str(), 0);
+    }
+    for (Music_Emu* emu : garbage) {
+        gme_delete(emu);
+    }
+    
+    if (load.queue_index >= 0 && load.queue_index < static_cast<int>(state.queue.items().size())) {
+        state.queue.setCurrent(load.queue_index);
+        start_track(std::clamp(load.play_track, 0, std::max(state.track_count - 1, 0)));
+    } else if (load.play_track >= 0) {
+        start_track_with_preprocess(std::clamp(load.play_track, 0, std::max(state.track_count - 1, 0)));
+    } else {
+        postload_preprocess();
+    }
+}
+
+// Switch to queue entry index, prefetched from another file: the worker
+// already read, opened and preprocessed it (UI thread)
+static bool adopt_prefetched_file(int index) {
+    TrackPrefetch& pf = state.prefetch;
+    if (pf.status.load() != TrackPrefetch::READY || pf.queue_index != index || !pf.other_file) return false;
+    
+    state.ui.is_playing.store(false);
+    stop_file_workers();
+    std::vector<Music_Emu*> garbage;
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        release_music_file(garbage);
+        swap_in_prefetch();
+        install_music_file(std::move(pf.file), std::move(pf.track_info), pf.path.c_str(), pf.track);
+        state.render.rendered_frames.store(0);
+        state.ui.is_playing.store(true);
+    }
+    for (Music_Emu* emu : garbage) {
+        gme_delete(emu);
+    }
+    state.queue.setCurrent(index);
+    finish_track_switch();
+    return true;
+}
+
+// Play queue entry index, switching files if it needs to (UI thread)
+static void play_queue_entry(int index) {
+    if (index < 0 || index >= static_cast<int>(state.queue.items().size())) return;
+    sync_track_switch();
+    if (adopt_prefetched_file(index)) return;
+    
+    const PlayQueue::Item& item = state.queue.items()[index];
+    if (!state.emu || item.path != state.loaded_file) {
+        load_nsf_file(item.path.c_str(), item.track, index);
+        return;
+    }
+    state.queue.setCurrent(index);
+    start_track(item.track);
+}
+
+// Append the entries the queue has read in the background (UI thread, once per frame)
+static void poll_queue_loads() {
+    std::string error;
+    const bool added = state.queue.poll(&error);
+    if (!error.empty()) {
+        snprintf(state.error_msg, sizeof(state.error_msg), "%s", error.c_str());
+    }
+    if (!added) return;
+    if (state.queue_autoplay) {
+        state.queue_autoplay = false;
+        play_queue_entry(0);
+    } else if (state.queue.current() >= 0) {
+        prefetch_next();  // The last entry may have one after it now
+    }
+}
+
+// Frames the audio device asks for per callback
+static int audio_device_frames() {
+#ifdef __EMSCRIPTEN__
+    return WebAudio::bufferFrames();
+#else
+    return saudio_buffer_frames();
+#endif
+}
+
+// Size the NES APU buffer: the set length, or when auto-sized the rate
+// control target, one device buffer and a frame, plus twice the emulation
+// thread's peak lateness. A resize drops what is buffered, so while playing
+// the auto size only grows; restart sizes it afresh (UI thread).
+static void size_nes_buffer(bool restart) {
+    if (!state.nes_initialized) return;
+    int ms = state.nes_buffer_ms;
+    if (state.nes_buffer_auto) {
+        if (restart) state.nes.nes_jitter_ms.store(0.0f);
+        const int device_frames = state.audio_initialized ? audio_device_frames()
+                                                          : LATENCY_PROFILES[state.latency_profile].buffer_frames;
+        const double need = state.ui.nes_ahead_ms.load() + device_frames * 1000.0 / state.sample_rate +
+                            1000.0 / NES_FRAME_RATE + 2.0 * state.nes.nes_jitter_ms.load();
+        ms = std::clamp(static_cast<int>(std::ceil(need / 10.0)) * 10, 50, MAX_NES_BUFFER_MS);
+        if (!restart && ms <= state.nes_emu.audioBufferLength()) return;
+    }
+    if (ms != state.nes_emu.audioBufferLength()) state.nes_emu.setAudioBufferLength(ms);
+}
+
+// Stereo placement of the emulator's voices until changed, in tap order:
+// Pulse 1, Pulse 2, Triangle, Noise, DMC, VRC6 Pulse 1, Pulse 2, Saw
+static constexpr float NES_DEFAULT_PANS[NesEmulator::TAP_COUNT] = {
+    -0.25f, 0.25f, 0.0f, 0.0f, 0.0f, -0.15f, 0.15f, 0.0f,
+};
+
+// Create the emulator and start its thread on first use, not at startup; the
+// caller holds nes_mutex, so the thread waits until the ROM is in (UI thread)
+static bool ensure_nes_emulator() {
+    if (state.nes_initialized) return true;
+    if (!state.nes_emu.init(state.sample_rate)) return false;
+    state.nes_timeline.setClockRate(ChannelTable::NES_CPU_CLOCK);
+    state.nes_emu.setApuTimeline(&state.nes_timeline);
+    // A light spread for Stereo, as a player might seat the pulses
+    for (int voice = 0; voice < NesEmulator::TAP_COUNT; ++voice) {
+        state.nes_emu.setChannelPan(voice, NES_DEFAULT_PANS[voice]);
+    }
+    state.nes_initialized = true;
+    state.ui.nes_thread_running.store(true);
+    state.nes_thread = std::thread(nes_thread_func);
+    startup_mark("NES emulator");
+    return true;
 }
 
 // Load NES ROM file
 void load_nes_rom(const char* path) {
-    if (state.nes_emu.loadROM(path)) {
+    std::lock_guard<std::mutex> nes_lock(nes_mutex);
+    state.nes_battery.close(&state.nes_emu);  // The last game's save, before its RAM goes
+    if (ensure_nes_emulator() && state.nes_emu.loadROM(path)) {
         state.nes_rom_loaded = true;
         current_mode = AppMode::NES_EMULATOR;
         show_emulator = true;
         
-        // Reset visualizers for emulator mode
+        // Reset visualizers for emulator mode; NSF notes still in progress are not wanted
+        state.notes.stop();
+        state.piano_track = -1;
+        state.piano_notes.reset();
+        const ChannelTable layout = ChannelTable::forNesEmulator(state.nes_emu.hasVRC6());
         state.visualizer.reset();
+        state.visualizer.setChannelLayout(layout);
         state.piano.reset();
+        state.piano.setChannelLayout(layout);
+        state.nes_timeline.reset();
+        state.nes_lookahead.start(state.nes_emu);
+        state.nes_rewind.start(static_cast<size_t>(state.nes_rewind_mb) << 20);
+        const MappedFile& rom = *state.nes_emu.romImage();
+        const uint64_t rom_hash = NoteCache::hashData(rom.data(), rom.size());
+        state.nes_slots.open(SaveSlots::defaultDirectory(), rom_hash);
+        state.nes_battery.open(BatterySave::defaultDirectory(), rom_hash, state.nes_emu);
+        state.ui.nes_load_slot.store(-1);
+        state.nes.nes_skipped_frames.store(0);
+        size_nes_buffer(true);
     } else {
         strncpy(state.error_msg, "Failed to load NES ROM", sizeof(state.error_msg) - 1);
     }
@@ -422,7 +1914,7 @@ void draw_emulator_window(bool* p_open) {
                     filterItem[1].spec = "*";
                     
                     nfdu8char_t* outPath = nullptr;
-                    nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
+                    nfdresult_t result = open_file_dialog(&outPath, filterItem, 2, nullptr);
                     
                     if (result == NFD_OKAY) {
                         load_nes_rom(outPath);
@@ -431,9 +1923,25 @@ void draw_emulator_window(bool* p_open) {
                 }
                 ImGui::Separator();
                 if (ImGui::MenuItem("Close ROM")) {
+                    std::lock_guard<std::mutex> nes_lock(nes_mutex);
                     state.nes_emu.pause();
                     state.nes_rom_loaded = false;
                     current_mode = AppMode::NSF_PLAYER;
+                    state.nes_lookahead.stop();
+                    state.nes_rewind.stop();
+                    state.nes_slots.close();
+                    state.nes_battery.close(&state.nes_emu);
+                    state.ui.nes_load_slot.store(-1);
+                    
+                    // The predicted notes go; the loaded file's are picked up again
+                    state.piano.reset();
+                    state.piano_track = -1;
+                    state.piano_notes.reset();
+                    
+                    // Back to the loaded file's channels
+                    std::lock_guard<std::mutex> lock(audio_mutex);
+                    state.visualizer.setChannelLayout(state.channels);
+                    state.piano.setChannelLayout(state.channels);
                 }
                 ImGui::EndMenu();
             }
@@ -446,10 +1954,155 @@ void draw_emulator_window(bool* p_open) {
                 if (ImGui::MenuItem("Reset", "F5")) {
                     state.nes_emu.reset();
                 }
+                if (ImGui::MenuItem("Power Cycle", "Shift+F5")) {
+                    state.nes_emu.reset(true);
+                }
+                if (ImGui::BeginMenu("Movie")) {
+                    const NesEmulator::MovieMode movie = state.nes_emu.movieMode();
+                    if (movie == NesEmulator::MovieMode::Recording) {
+                        if (ImGui::MenuItem("Stop and Save...")) save_nes_movie();
+                        ImGui::TextDisabled("Recording frame %d", state.nes_emu.movieFrame());
+                    } else {
+                        if (ImGui::MenuItem("Record from Power-On")) record_nes_movie();
+                        if (ImGui::MenuItem("Play...")) play_nes_movie();
+                    }
+                    if (movie == NesEmulator::MovieMode::Playing) {
+                        if (ImGui::MenuItem("Stop Playback")) {
+                            std::lock_guard<std::mutex> lock(nes_mutex);
+                            state.nes_emu.stopMovie();
+                        }
+                        ImGui::TextDisabled("Frame %d / %d", state.nes_emu.movieFrame(), state.nes_emu.movieFrames());
+                    }
+                    ImGui::TextDisabled("A state load or rewind ends either");
+                    if (!state.nes_movie_error.empty()) {
+                        ImGui::TextColored(ImVec4(0.8f, 0.3f, 0.3f, 1.0f), "%s", state.nes_movie_error.c_str());
+                    }
+                    ImGui::EndMenu();
+                }
+                ImGui::Separator();
+                ImGui::MenuItem("Turbo", "T", &state.nes_turbo);
+                ImGui::TextDisabled("Hold Tab to fast-forward");
+                bool frameskip = state.ui.nes_auto_frameskip.load();
+                if (ImGui::MenuItem("Auto Frameskip", nullptr, &frameskip)) {
+                    state.ui.nes_auto_frameskip.store(frameskip);
+                }
+                int run_ahead = state.nes_emu.runAhead();
+                ImGui::SetNextItemWidth(120);
+                if (ImGui::SliderInt("Run-Ahead", &run_ahead, 0, NesEmulator::MAX_RUN_AHEAD, "%d frames")) {
+                    state.nes_emu.setRunAhead(run_ahead);
+                }
+                if (run_ahead > 0) {
+                    ImGui::TextDisabled("Costs %.2f ms a frame", state.nes_emu.runAheadCost());
+                }
+                if (ImGui::BeginMenu("Frame Pacing")) {
+                    const FramePacing pacing = state.ui.nes_frame_pacing.load();
+                    if (ImGui::MenuItem("Emulator Timer", nullptr, pacing == FramePacing::EMULATOR_TIMER)) {
+                        state.ui.nes_frame_pacing.store(FramePacing::EMULATOR_TIMER);
+                    }
+                    if (ImGui::MenuItem("Display", nullptr, pacing == FramePacing::DISPLAY)) {
+                        state.ui.nes_frame_pacing.store(FramePacing::DISPLAY);
+                    }
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Present Mode")) {
+                    static const char* const PRESENT_MODE_NAMES[_SAPP_PRESENTMODE_NUM] = {
+                        "FIFO (vsync)", "Mailbox (vsync, newest)", "Immediate (tears)",
+                    };
+                    for (int i = 0; i < _SAPP_PRESENTMODE_NUM; ++i) {
+                        const sapp_present_mode mode = static_cast<sapp_present_mode>(i);
+                        if (ImGui::MenuItem(PRESENT_MODE_NAMES[i], nullptr, sapp_get_present_mode() == mode,
+                                            sapp_present_mode_supported(mode))) {
+                            sapp_set_present_mode(mode);
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
+                ImGui::TextDisabled("Latency: View > Frame Profiler");
+                ImGui::Separator();
+                ImGui::SetNextItemWidth(120);
+                ImGui::SliderInt("Rewind Memory", &state.nes_rewind_mb, 8, 512, "%d MB");
+                if (ImGui::IsItemDeactivatedAfterEdit() && state.nes_rom_loaded) {
+                    // A new budget starts the history over
+                    std::lock_guard<std::mutex> nes_lock(nes_mutex);
+                    state.nes_rewind.start(static_cast<size_t>(state.nes_rewind_mb) << 20);
+                }
+                ImGui::TextDisabled("Hold R to rewind (%.0f s stored)",
+                                    state.nes_rewind.framesStored() / NES_FRAME_RATE);
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("State", state.nes_rom_loaded)) {
+                // Slots are read from disk on first sight, so a load is instant
+                state.nes_slots.prefetch();
+                for (int i = 0; i < SaveSlots::SLOT_COUNT; ++i) {
+                    char label[32], shortcut[16];
+                    snprintf(label, sizeof(label), "Save Slot %d", i + 1);
+                    snprintf(shortcut, sizeof(shortcut), "Shift+F%d", i + 1);
+                    if (ImGui::MenuItem(label, shortcut)) state.ui.nes_save_slot.store(i);
+                }
+                ImGui::Separator();
+                for (int i = 0; i < SaveSlots::SLOT_COUNT; ++i) {
+                    char label[64], shortcut[16];
+                    const SaveSlots::Status status = state.nes_slots.status(i);
+                    if (status == SaveSlots::Status::Ready) {
+                        const std::time_t saved_at = state.nes_slots.savedAt(i);
+                        char when[32] = "";
+                        if (const std::tm* tm = std::localtime(&saved_at)) {
+                            std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", tm);
+                        }
+                        snprintf(label, sizeof(label), "Load Slot %d  (%s)", i + 1, when);
+                    } else {
+                        snprintf(label, sizeof(label), "Load Slot %d  (%s)", i + 1,
+                                 status == SaveSlots::Status::Empty ? "empty" : "reading...");
+                    }
+                    snprintf(shortcut, sizeof(shortcut), "F%d", i + 1);
+                    if (ImGui::MenuItem(label, shortcut, false, status == SaveSlots::Status::Ready)) {
+                        state.ui.nes_load_slot.store(i);
+                    }
+                }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("View")) {
                 ImGui::SliderFloat("Scale", &state.nes_screen_scale, 1.0f, 4.0f, "%.1fx");
+                if (ImGui::BeginMenu("Palette")) {
+                    for (int i = 0; i < NesEmulator::PALETTE_COUNT; ++i) {
+                        const auto palette = static_cast<NesEmulator::Palette>(i);
+                        if (ImGui::MenuItem(NesEmulator::paletteName(palette), nullptr,
+                                            state.nes_emu.palette() == palette)) {
+                            state.nes_emu.setPalette(palette);
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
+                if (ImGui::BeginMenu("Filter")) {
+                    for (int i = 0; i < NesEmulator::SCREEN_FILTER_COUNT; ++i) {
+                        const auto filter = static_cast<NesEmulator::ScreenFilter>(i);
+                        if (ImGui::MenuItem(NesEmulator::screenFilterName(filter), nullptr,
+                                            state.nes_emu.screenFilter() == filter,
+                                            state.nes_emu.screenFilterAvailable(filter))) {
+                            state.nes_emu.setScreenFilter(filter);
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
+                bool fast_ppu = state.nes_emu.fastPpu();
+                if (ImGui::MenuItem("Scanline PPU", nullptr, &fast_ppu)) {
+                    state.nes_emu.setFastPpu(fast_ppu);
+                }
+                bool catch_up_ppu = state.nes_emu.catchUpPpu();
+                if (ImGui::MenuItem("Catch-up PPU", nullptr, &catch_up_ppu)) {
+                    state.nes_emu.setCatchUpPpu(catch_up_ppu);
+                }
+                // Says so while a game's status polling keeps it serial
+                bool pipelined_ppu = state.nes_emu.pipelinedPpu();
+                const bool serial = pipelined_ppu && !state.nes_emu.ppuPipelineActive();
+                if (ImGui::MenuItem("Pipelined PPU", serial ? "serial now" : nullptr, &pipelined_ppu,
+                                    state.nes_emu.fastPpu())) {
+                    state.nes_emu.setPipelinedPpu(pipelined_ppu);
+                }
+#ifdef AGNES_PROFILE
+                ImGui::Separator();
+                ImGui::MenuItem("6502 Profile", nullptr, &show_cpu_profile);
+#endif
                 ImGui::EndMenu();
             }
             ImGui::EndMenuBar();
@@ -473,7 +2126,21 @@ void draw_emulator_window(bool* p_open) {
                 
                 // Status
                 if (running) {
-                    ImGui::TextColored(ImVec4(0.3f, 0.9f, 0.3f, 1.0f), "Running");
+                    ImGui::TextColored(ImVec4(0.3f, 0.9f, 0.3f, 1.0f),
+                                       state.ui.nes_fast_forward.load() ? "Fast-forward" : "Running");
+                    const uint32_t skipped = state.nes.nes_skipped_frames.load(std::memory_order_relaxed);
+                    if (skipped > 0) {
+                        ImGui::SameLine();
+                        ImGui::TextDisabled("(%u frames skipped)", skipped);
+                    }
+                    const NesEmulator::MovieMode movie = state.nes_emu.movieMode();
+                    if (movie == NesEmulator::MovieMode::Recording) {
+                        ImGui::SameLine();
+                        ImGui::TextColored(ImVec4(0.9f, 0.3f, 0.3f, 1.0f), "REC %d", state.nes_emu.movieFrame());
+                    } else if (movie == NesEmulator::MovieMode::Playing) {
+                        ImGui::SameLine();
+                        ImGui::TextDisabled("Movie %d / %d", state.nes_emu.movieFrame(), state.nes_emu.movieFrames());
+                    }
                 } else {
                     ImGui::TextColored(ImVec4(0.9f, 0.9f, 0.3f, 1.0f), "Paused");
                 }
@@ -514,8 +2181,341 @@ void draw_emulator_window(bool* p_open) {
     ImGui::End();
 }
 
-// Update NES controller input from keyboard
-void update_nes_input() {
+#ifdef AGNES_PROFILE
+// Hot instruction addresses of the running game, for ROM hacking; only in
+// builds configured with FC_PROFILE_6502
+static void draw_cpu_profile_window(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(360, 420), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("6502 Profile", p_open)) {
+        ImGui::End();
+        return;
+    }
+    
+    static NesEmulator::CpuProfile profile;
+    state.nes_emu.cpuProfile(profile, 64);
+    
+    constexpr double CYCLES_PER_FRAME = 29780.5;
+    ImGui::Text("%.1f M cycles over %llu frames", profile.total_cycles * 1e-6,
+                static_cast<unsigned long long>(profile.frames));
+    ImGui::Text("NMI: %5u cycles last frame (%4.1f%%), peak %u", profile.nmi_cycles,
+                100.0 * profile.nmi_cycles / CYCLES_PER_FRAME, profile.nmi_peak);
+    ImGui::Text("IRQ: %5u cycles last frame (%4.1f%%), peak %u", profile.irq_cycles,
+                100.0 * profile.irq_cycles / CYCLES_PER_FRAME, profile.irq_peak);
+    ImGui::Text("OAM DMA: %.1f%% of all cycles",
+                profile.total_cycles ? 100.0 * profile.dma_cycles / profile.total_cycles : 0.0);
+    if (ImGui::Button("Clear")) {
+        state.nes_emu.clearCpuProfile();
+    }
+    
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("##hot_pcs", 3, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("PC");
+        ImGui::TableSetupColumn("Cycles");
+        ImGui::TableSetupColumn("Share");
+        ImGui::TableHeadersRow();
+        for (const NesEmulator::CpuProfile::Spot& spot : profile.hot) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("$%04X", spot.pc);
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", spot.cycles);
+            ImGui::TableNextColumn();
+            ImGui::Text("%5.2f%%", profile.total_cycles ? 100.0 * spot.cycles / profile.total_cycles : 0.0);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+#endif
+
+// The playing NSF's play routine: CPU clocks per call against the frame it
+// has, to tell which rips are expensive to emulate
+static void draw_play_routine_window(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(420, 240), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Play Routine", p_open)) {
+        ImGui::End();
+        return;
+    }
+    
+    const PlayRoutineProfile::Snapshot& profile = state.play_profile.latest();
+    if (profile.track < 0 || profile.period <= 0) {
+        ImGui::TextDisabled("No NSF playing");
+        ImGui::End();
+        return;
+    }
+    const double period = static_cast<double>(profile.period);
+    ImGui::Text("Track %d: %ld calls, %ld cycles apart", profile.track + 1, profile.calls, profile.period);
+    ImGui::Text("Last: %5ld cycles (%5.1f%%)", profile.last, 100.0 * profile.last / period);
+    ImGui::Text("Mean: %5.0f cycles (%5.1f%%)", profile.mean, 100.0 * profile.mean / period);
+    ImGui::Text("Peak: %5ld cycles (%5.1f%%)", profile.peak, 100.0 * profile.peak / period);
+    if (profile.peak > profile.period) {
+        ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "A call overran its frame; the next was skipped");
+    }
+    
+    // Share of the frame per call, up to the track's peak or the whole frame
+    const float scale = std::max(1.0f, static_cast<float>(profile.peak / period));
+    ImGui::PlotHistogram("##play_load", profile.load.data(), profile.count, 0, "frame share", 0.0f, scale,
+                         ImVec2(-1, ImGui::GetContentRegionAvail().y));
+    ImGui::End();
+}
+
+// Search over the library index; double-click a row to play it
+static void draw_library_window(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(560, 420), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Library", p_open)) {
+        ImGui::End();
+        return;
+    }
+    
+    LibraryIndex& library = state.library;
+    if (ImGui::Button("Add Folder...")) {
+        nfdu8char_t* outPath = nullptr;
+        if (pick_folder_dialog(&outPath, nullptr) == NFD_OKAY) {
+            library.addFolder(outPath);
+            NFD_FreePathU8(outPath);
+        }
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(library.scanning());
+    if (ImGui::Button("Rescan")) {
+        library.rescan();
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (library.scanning()) {
+        ImGui::Text("Scanning: %d files, %d / %d read", library.scanFound(), library.scanRead(),
+                    library.scanToRead());
+    } else {
+        ImGui::TextDisabled("%zu files", library.size());
+    }
+    
+    const std::vector<std::string> folders = library.folders();
+    if (ImGui::CollapsingHeader("Folders")) {
+        for (size_t i = 0; i < folders.size(); ++i) {
+            ImGui::PushID(static_cast<int>(i));
+            if (ImGui::SmallButton("Remove")) {
+                library.removeFolder(i);
+            }
+            ImGui::PopID();
+            ImGui::SameLine();
+            ImGui::TextUnformatted(folders[i].c_str());
+        }
+        if (folders.empty()) ImGui::TextDisabled("No folders yet");
+    }
+    
+    // Searched again when the query changes or a scan publishes a new index
+    static char query[128] = "";
+    static std::vector<LibraryIndex::Match> matches;
+    static bool was_scanning = true;
+    const bool scanning = library.scanning();
+    ImGui::SetNextItemWidth(-1);
+    const bool edited = ImGui::InputTextWithHint("##query", "Search game, author, song or file name", query,
+                                                 sizeof(query));
+    if (edited || (was_scanning && !scanning)) {
+        matches = library.search(query, 5000);
+    }
+    was_scanning = scanning;
+    
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY |
+                                  ImGuiTableFlags_Resizable;
+    if (ImGui::BeginTable("##library", 4, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Game");
+        ImGui::TableSetupColumn("Track");
+        ImGui::TableSetupColumn("Author");
+        ImGui::TableSetupColumn("Length", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+        ImGui::TableHeadersRow();
+        
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(matches.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const LibraryIndex::Match& match = matches[row];
+                const LibraryIndex::Entry& entry = *match.entry;
+                const std::string name = entry.game.empty()
+                                             ? std::filesystem::path(entry.path).filename().string()
+                                             : entry.game;
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::PushID(row);
+                if (ImGui::Selectable(name.c_str(), false,
+                                      ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick) &&
+                    ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                    load_nsf_file(entry.path.c_str(), std::max(match.track, 0));
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s", entry.path.c_str());
+                }
+                if (ImGui::BeginPopupContextItem("##row")) {
+                    if (ImGui::MenuItem("Add to Queue")) {
+                        std::string error;
+                        if (!state.queue.addFile(entry.path, &error)) {
+                            snprintf(state.error_msg, sizeof(state.error_msg), "%s", error.c_str());
+                        }
+                        if (state.queue.current() >= 0) prefetch_next();
+                    }
+                    ImGui::EndPopup();
+                }
+                ImGui::PopID();
+                
+                ImGui::TableNextColumn();
+                if (match.track >= 0) {
+                    const LibraryIndex::Track& track = entry.tracks[match.track];
+                    ImGui::Text("%d %s", match.track + 1, track.song.c_str());
+                } else {
+                    ImGui::TextDisabled("%zu tracks", entry.tracks.size());
+                }
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(entry.author.c_str());
+                ImGui::TableNextColumn();
+                const int length_ms = match.track >= 0 ? entry.tracks[match.track].length_ms : -1;
+                if (length_ms > 0) {
+                    ImGui::Text("%d:%02d", length_ms / 60000, length_ms / 1000 % 60);
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+// The play queue; double-click an entry to play from there
+static void draw_queue_window(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(440, 380), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Queue", p_open)) {
+        ImGui::End();
+        return;
+    }
+    
+    PlayQueue& queue = state.queue;
+    bool edited = false;
+    if (ImGui::Button("Add...")) {
+        nfdu8filteritem_t filterItem[2];
+        filterItem[0].name = "NES Sound Files, Playlists and Archives";
+        filterItem[0].spec = "nsf,nsfe,m3u,zip";
+        filterItem[1].name = "All Files";
+        filterItem[1].spec = "*";
+        
+        nfdu8char_t* outPath = nullptr;
+        if (open_file_dialog(&outPath, filterItem, 2, nullptr) == NFD_OKAY) {
+            std::string error;
+            bool added = true;
+            if (has_extension(outPath, "zip")) {
+                queue.addPaths({outPath});  // Its entries, read in the background
+            } else {
+                added = has_extension(outPath, "m3u") ? queue.addPlaylist(outPath, &error)
+                                                      : queue.addFile(outPath, &error);
+            }
+            if (!added) {
+                snprintf(state.error_msg, sizeof(state.error_msg), "%s", error.c_str());
+            }
+            NFD_FreePathU8(outPath);
+            edited = true;
+        }
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(state.loaded_file[0] == '\0');
+    if (ImGui::Button("Add Loaded File")) {
+        std::string error;
+        if (!queue.addFile(state.loaded_file, &error)) {
+            snprintf(state.error_msg, sizeof(state.error_msg), "%s", error.c_str());
+        }
+        edited = true;
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        queue.clear();
+        state.queue_autoplay = false;
+        edited = true;
+    }
+    ImGui::SameLine();
+    edited |= ImGui::Checkbox("Repeat", &queue.repeat);
+    if (const size_t pending = queue.loadsPending()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("Reading %zu...", pending);
+    }
+    
+    const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY;
+    int play = -1;
+    bool rows_changed = false;
+    if (ImGui::BeginTable("##queue", 3, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("#", ImGuiTableColumnFlags_WidthFixed, 30.0f);
+        ImGui::TableSetupColumn("Title");
+        ImGui::TableSetupColumn("Length", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+        ImGui::TableHeadersRow();
+        
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(queue.items().size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const PlayQueue::Item& item = queue.items()[row];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", row + 1);
+                ImGui::TableNextColumn();
+                ImGui::PushID(row);
+                if (ImGui::Selectable(item.title.c_str(), row == queue.current(),
+                                      ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick) &&
+                    ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                    play = row;
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("%s, track %d", item.path.c_str(), item.track + 1);
+                }
+                if (ImGui::BeginPopupContextItem("##row")) {
+                    if (ImGui::MenuItem("Move Up", nullptr, false, row > 0)) {
+                        queue.move(static_cast<size_t>(row), -1);
+                        rows_changed = true;
+                    }
+                    if (ImGui::MenuItem("Move Down", nullptr, false, row + 1 < static_cast<int>(queue.items().size()))) {
+                        queue.move(static_cast<size_t>(row), 1);
+                        rows_changed = true;
+                    }
+                    if (ImGui::MenuItem("Remove")) {
+                        queue.remove(static_cast<size_t>(row));
+                        rows_changed = true;
+                    }
+                    ImGui::EndPopup();
+                }
+                ImGui::PopID();
+                if (rows_changed) break;  // Rows moved; drawn again next frame
+                
+                ImGui::TableNextColumn();
+                const long length_ms = item.length_ms + item.fade_ms;
+                ImGui::Text("%ld:%02ld", length_ms / 60000, length_ms / 1000 % 60);
+            }
+            if (rows_changed) break;
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+    
+    if (play >= 0) {
+        play_queue_entry(play);
+    } else if ((edited || rows_changed) && queue.current() >= 0) {
+        // What comes next may have changed
+        prefetch_next();
+    }
+}
+
+// NES controller keys
+static bool is_nes_key(sapp_keycode key) {
+    switch (key) {
+        case SAPP_KEYCODE_UP: case SAPP_KEYCODE_DOWN: case SAPP_KEYCODE_LEFT: case SAPP_KEYCODE_RIGHT:
+        case SAPP_KEYCODE_Z: case SAPP_KEYCODE_X: case SAPP_KEYCODE_ENTER: case SAPP_KEYCODE_BACKSPACE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Update NES controller input from keyboard, as a key event arrives: the
+// emulator places the change in the frame by when it happened, rather than
+// where the next render frame happens to poll
+void update_nes_input(std::chrono::steady_clock::time_point at) {
     // Reset input
     memset(&state.nes_input, 0, sizeof(state.nes_input));
     
@@ -532,41 +2532,247 @@ void update_nes_input() {
     state.nes_input.select = key_states[SAPP_KEYCODE_BACKSPACE];
     
     // Set input to emulator
-    state.nes_emu.setInput(0, state.nes_input);
+    state.nes_emu.queueInput(0, state.nes_input, at);
+}
+
+// (Re)create the sokol_audio stream for a latency profile. Safe at runtime:
+// saudio_shutdown() waits for the audio thread.
+static void open_audio_device(const LatencyProfile& profile) {
+#ifdef __EMSCRIPTEN__
+    // The worklet pulls 128-frame quanta whatever the profile, so the
+    // context is made once and kept; profiles only change the queue depths
+    if (!state.audio_setup_called) {
+        state.audio_scratch.allocate(std::max(profile.buffer_frames, WebAudio::QUANTUM_FRAMES));
+        state.audio_initialized = WebAudio::setup(state.sample_rate, 2, audio_stream_callback, nullptr);
+        state.audio_setup_called = true;
+    }
+#else
+    if (state.audio_setup_called) {
+        saudio_shutdown();
+        state.audio_initialized = false;
+    }
+    
+    saudio_desc audio_desc = {};
+    audio_desc.sample_rate = state.sample_rate;
+    audio_desc.num_channels = 2; // Stereo
+    audio_desc.buffer_frames = profile.buffer_frames;
+    audio_desc.stream_userdata_cb = audio_stream_callback;
+    audio_desc.user_data = nullptr;
+    audio_desc.logger.func = slog_func;
+    
+    // Size the callback's scratch arena before the stream can start pulling
+    state.audio_scratch.allocate(profile.buffer_frames);
+    
+    saudio_setup(&audio_desc);
+    state.audio_setup_called = true;
+    state.audio_initialized = saudio_isvalid();
+#endif
+}
+
+// Switch latency profile: reopen the device if it is open, then resize the
+// emulator's Blip_Buffer to match
+static void apply_latency_profile(int index) {
+    index = std::clamp(index, 0, LATENCY_PROFILE_COUNT - 1);
+    const LatencyProfile& profile = LATENCY_PROFILES[index];
+    state.latency_profile = index;
+    if (state.audio_setup_called) open_audio_device(profile);
+    
+    state.ui.render_ahead_ms.store(profile.render_ahead_ms);
+    state.ui.nes_ahead_ms.store(profile.nes_ahead_ms);
+    state.nes_buffer_ms = profile.apu_buffer_ms;
+    size_nes_buffer(true);
 }
 
+// Startup does only what the first frame needs. The audio device (which can
+// take a few hundred ms to open), the file dialogs and the NES emulator are
+// set up the first time they are used.
 void init(void) {
+    startup_mark("init");
     sg_desc _sg_desc{};
     _sg_desc.environment = sglue_environment();
     _sg_desc.logger.func = slog_func;
     sg_setup(_sg_desc);
+    startup_mark("gfx");
 
     simgui_desc_t simgui_desc = { };
     simgui_desc.logger.func = slog_func;
     simgui_setup(&simgui_desc);
+    startup_mark("imgui");
 
     // Use ImGui default dark theme (blue style)
     ImGui::StyleColorsDark();
 
     state.pass_action.colors[0] = { .load_action=SG_LOADACTION_CLEAR, .clear_value={0.1f, 0.1f, 0.1f, 1.0f } };
     
-    // Initialize sokol_audio with callback model
-    saudio_desc audio_desc = {};
-    audio_desc.sample_rate = state.sample_rate;
-    audio_desc.num_channels = 2; // Stereo
-    audio_desc.buffer_frames = 2048;  // ~46ms latency
-    audio_desc.stream_userdata_cb = audio_stream_callback;
-    audio_desc.user_data = nullptr;
-    audio_desc.logger.func = slog_func;
+    // Start the render-ahead producer (ring holds the maximum depth plus slack)
+    state.render_ring.resize(static_cast<size_t>(state.sample_rate) * 2 * (RENDER_AHEAD_MAX_MS + 100) / 1000);
+    state.audio_commands.resize(AUDIO_COMMAND_CAPACITY);
+    state.mix_bus.resize(state.render_ring.capacity() / 2);
+    state.render_muted.resize(RENDER_CHUNK_FRAMES * 2);
+    state.ui.render_thread_running.store(true);
+    state.render_thread = std::thread(render_thread_func);
+    
+    // Pick up files added or changed since the last run (on the library's thread)
+    state.library.open(LibraryIndex::defaultPath());
+    if (!state.library.folders().empty()) {
+        state.library.rescan();
+    }
+    startup_mark("library");
     
-    saudio_setup(&audio_desc);
-    state.audio_initialized = saudio_isvalid();
+    std::string telemetry_error;
+    if (!state.telemetry_export.start(telemetry_options, &telemetry_error)) {
+        snprintf(state.error_msg, sizeof(state.error_msg), "%s", telemetry_error.c_str());
+    }
+    
+    // Queue depths for the profile; the device itself opens on first play
+    apply_latency_profile(state.latency_profile);
+}
+
+// CPU cycle the listener hears in NES mode, from the playback clock the
+// audio callback publishes; the emulated one while there is no audio
+static uint64_t nes_heard_cycles() {
+    const uint64_t emulated = state.nes_emu.getCpuCycles();
+    const int64_t heard = state.visualizer.playbackClock();
+    if (!state.nes_emu.isRunning() || heard == AudioVisualizer::UNTIMED) return emulated;
+    const int64_t cycles = NoteClock::fromFrames(std::max<int64_t>(0, heard), state.sample_rate);
+    return std::min(emulated, static_cast<uint64_t>(cycles));
+}
+
+// Bring the live keys of the APU up to what is heard from the writes the
+// audio side logged, so notes shorter than a block still show, and the
+// expansion chips' up to their queued samples (UI thread). The emulator's
+// are also the live history, on its CPU clock as heard.
+static void replay_apu_timeline() {
+    if (current_mode == AppMode::NES_EMULATOR) {
+        const NesEmulator::ApuSnapshot apu = state.nes_emu.getApuSnapshot();
+        ChannelTable& table = state.nes_timeline_table;
+        if (table.hasChip(SoundChip::Vrc6) != apu.has_vrc6) {
+            table = ChannelTable::forNesEmulator(apu.has_vrc6);
+        }
+        if (apu.has_vrc6) {
+            table.sampleVrc6(apu.vrc6_periods, apu.vrc6_amplitudes, apu.vrc6_volumes, apu.vrc6_enabled);
+        }
+        state.nes_timeline.replay(static_cast<int64_t>(nes_heard_cycles()),
+                                  [&](const ApuTimeline::Voices& voices, int64_t time) {
+            table.sampleApu(voices.periods, voices.lengths, voices.volumes, voices.volumes);
+            state.piano.updateFromChannels(table, time);
+        });
+        return;
+    }
+    
+    const int64_t heard = state.visualizer.playbackClock();
+    state.piano.applyQueuedKeys(heard == AudioVisualizer::UNTIMED ? INT64_MAX : heard);
+    if (heard == AudioVisualizer::UNTIMED) return;
+    ChannelTable& table = state.nsf_timeline_table;
+    state.nsf_timeline.replay(heard, [&](const ApuTimeline::Voices& voices, int64_t) {
+        table.sampleApu(voices.periods, voices.lengths, voices.volumes, voices.volumes);
+    });
+    state.piano.updateKeys(table, 0, ChannelTable::APU_CHANNELS);
+}
+
+// Hand the OSC sender this frame's channel state; it sends the newest at
+// its own rate (UI thread, lock-free)
+static void publish_osc_snapshot() {
+    if (!state.osc.isRunning()) return;
+    OscOutput::Snapshot& snapshot = state.osc.back();
+    snapshot.count = state.visualizer.getActiveChannelCount();
+    for (int c = 0; c < snapshot.count; ++c) {
+        snapshot.level[c] = state.visualizer.getChannelLevel(c);
+        snapshot.note[c] = static_cast<int8_t>(state.piano.getLiveNote(c, &snapshot.velocity[c]));
+    }
+    state.osc.publish();
+}
+
+// Read-back frames arrive a few frames after they were built; tag each with
+// the audio heard as it was (UI thread)
+static void on_captured_frame(const sapp_capture_frame* frame, void*) {
+    const int64_t audio_pos = state.capture_audio_pos[frame->frame_count % std::size(state.capture_audio_pos)];
+    state.video_recorder.submitFrame(frame->pixels, frame->width, frame->height, frame->row_pitch, frame->bgra,
+                                     audio_pos);
+}
+
+static void on_offline_frame(const sapp_capture_frame* frame, void*) {
+    const int index = state.offline_frame_index[frame->frame_count % std::size(state.offline_frame_index)];
+    if (index >= 0) {
+        state.offline.submitFrame(index, frame->pixels, frame->width, frame->height, frame->row_pitch, frame->bgra);
+    }
+}
+
+// Render the current track's visualizations to folder/<file>-NN-NNNNNN.png,
+// drawing one frame per app frame, unthrottled where the display allows
+static void start_offline_render(const char* folder) {
+    const std::filesystem::path file_path(state.loaded_file);
+    char track[8];
+    snprintf(track, sizeof(track), "-%02d", state.current_track + 1);
+    state.record_error.clear();
+    if (!state.offline.start(state.music_file, state.current_track, *state.piano_notes, state.channels,
+                             state.sample_rate, folder, file_path.stem().string() + track, sapp_width(),
+                             sapp_height(), OfflineRender::Options(), &state.record_error)) {
+        return;
+    }
+    state.ui.is_playing.store(false);
+    std::fill(std::begin(state.offline_frame_index), std::end(state.offline_frame_index), -1);
+    state.offline_frames_drawn = 0;
+    state.offline_saved_present_mode = sapp_get_present_mode();
+    if (sapp_present_mode_supported(SAPP_PRESENTMODE_IMMEDIATE)) sapp_set_present_mode(SAPP_PRESENTMODE_IMMEDIATE);
+    sapp_set_capture_wait(true);
+    sapp_set_capture_callback(on_offline_frame, nullptr);
+}
+
+static void stop_offline_render() {
+    if (!state.offline.isActive()) return;
+    sapp_set_capture_callback(nullptr, nullptr);
+    sapp_set_capture_wait(false);
+    sapp_set_present_mode(state.offline_saved_present_mode);
+    state.offline.stop();
+    sapp_set_window_title(WINDOW_TITLE);
+}
+
+// Draw the next offline frame in place of the UI. Once all are drawn a few
+// more app frames go by untagged, for the last read-backs to arrive.
+static void draw_offline_frame() {
+    const int index = state.offline.nextFrame();
+    state.offline_frame_index[sapp_frame_count() % std::size(state.offline_frame_index)] = index;
+    if (index >= 0) {
+        state.offline_frames_drawn = 0;
+    } else if (++state.offline_frames_drawn > static_cast<int>(std::size(state.offline_frame_index))) {
+        stop_offline_render();
+        return;
+    }
     
-    // Initialize Native File Dialog
-    NFD_Init();
+    const ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(viewport->Pos);
+    ImGui::SetNextWindowSize(viewport->Size);
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
+    ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
+    ImGui::Begin("##offline", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoSavedSettings |
+                                           ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoBackground);
+    state.offline.draw(viewport->Size.x, viewport->Size.y);
+    ImGui::End();
+    ImGui::PopStyleVar(2);
     
-    // Initialize NES Emulator
-    state.nes_emu.init(state.sample_rate);
+    char title[96];
+    snprintf(title, sizeof(title), "Rendering frame %d / %d (Esc to stop)", state.offline.framesRendered(),
+             state.offline.framesTotal());
+    sapp_set_window_title(title);
+}
+
+// Record the window to folder/recording-YYYYMMDD-HHMMSS.y4m and .wav
+static void start_video_recording(const char* folder) {
+    const std::time_t now = std::time(nullptr);
+    char name[64];
+    std::strftime(name, sizeof(name), "recording-%Y%m%d-%H%M%S", std::localtime(&now));
+    const std::string stem = (std::filesystem::path(folder) / name).string();
+    state.record_error.clear();
+    if (!state.video_recorder.start(stem, state.sample_rate, sapp_width(), sapp_height(), &state.record_error)) {
+        return;
+    }
+    sapp_set_capture_callback(on_captured_frame, nullptr);
+}
+
+static void stop_video_recording() {
+    sapp_set_capture_callback(nullptr, nullptr);
+    state.video_recorder.stop();
 }
 
 void draw_player_window() {
@@ -584,14 +2790,90 @@ void draw_player_window() {
                 filterItem[1].spec = "*";
                 
                 nfdu8char_t* outPath = nullptr;
-                nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
+                nfdresult_t result = open_file_dialog(&outPath, filterItem, 2, nullptr);
                 
                 if (result == NFD_OKAY) {
                     load_nsf_file(outPath);
-                    postload_preprocess();
                     NFD_FreePathU8(outPath);
                 }
             }
+            if (ImGui::MenuItem("Export MIDI...", nullptr, false, state.emu != nullptr)) {
+                nfdu8char_t* outPath = nullptr;
+                if (pick_folder_dialog(&outPath, nullptr) == NFD_OKAY) {
+                    // Every track, named after the file: song-01.mid, song-02.mid...
+                    std::string stem = state.loaded_file;
+                    const size_t slash = stem.find_last_of("/\\");
+                    if (slash != std::string::npos) stem.erase(0, slash + 1);
+                    const size_t dot = stem.find_last_of('.');
+                    if (dot != std::string::npos && dot > 0) stem.erase(dot);
+                    state.notes.exportMidi(outPath, stem);
+                    NFD_FreePathU8(outPath);
+                }
+            }
+            if (ImGui::MenuItem("Export WAV...", nullptr, false, state.music_file != nullptr)) {
+                nfdu8char_t* outPath = nullptr;
+                if (pick_folder_dialog(&outPath, nullptr) == NFD_OKAY) {
+                    // Every track, as for MIDI: song-01.wav, song-02.wav... A
+                    // playlist next to the file (song.m3u) gives the lengths
+                    const std::filesystem::path file_path(state.loaded_file);
+                    std::filesystem::path m3u_path = file_path;
+                    m3u_path.replace_extension(".m3u");
+                    NsfExport::Options options;
+                    options.sample_rate = state.sample_rate;
+                    std::error_code ec;
+                    if (std::filesystem::is_regular_file(m3u_path, ec)) options.m3u = m3u_path.string();
+                    state.wav_export.start(state.music_file, outPath, file_path.stem().string(), options);
+                    NFD_FreePathU8(outPath);
+                }
+            }
+            if (state.output_recorder.isRecording()) {
+                if (ImGui::MenuItem("Stop Recording Output")) state.output_recorder.stop();
+            } else if (ImGui::MenuItem("Record Output...")) {
+                // Everything the device plays, in either mode, until stopped
+                nfdu8filteritem_t filterItem[1];
+                filterItem[0].name = "WAV Audio";
+                filterItem[0].spec = "wav";
+                nfdu8char_t* outPath = nullptr;
+                if (save_file_dialog(&outPath, filterItem, 1, nullptr, "output.wav") == NFD_OKAY) {
+                    state.record_error.clear();
+                    state.output_recorder.start(outPath, state.sample_rate, &state.record_error);
+                    NFD_FreePathU8(outPath);
+                }
+            }
+            if (state.video_recorder.isRecording()) {
+                if (ImGui::MenuItem("Stop Recording")) stop_video_recording();
+            } else if (ImGui::MenuItem("Record Video...", nullptr, false, sapp_capture_supported())) {
+                nfdu8char_t* outPath = nullptr;
+                if (pick_folder_dialog(&outPath, nullptr) == NFD_OKAY) {
+                    start_video_recording(outPath);
+                    NFD_FreePathU8(outPath);
+                }
+            }
+            // Needs the track's notes finished by the background pass
+            const bool notes_ready = state.piano_track == state.current_track && state.piano_notes &&
+                                     state.piano_notes->complete;
+            if (ImGui::MenuItem("Render Video Frames...", nullptr, false,
+                                sapp_capture_supported() && !state.video_recorder.isRecording() && notes_ready)) {
+                nfdu8char_t* outPath = nullptr;
+                if (pick_folder_dialog(&outPath, nullptr) == NFD_OKAY) {
+                    start_offline_render(outPath);
+                    NFD_FreePathU8(outPath);
+                }
+            }
+#if FC_TRACE
+            if (ImGui::MenuItem("Save Trace...")) {
+                nfdu8filteritem_t filterItem[1];
+                filterItem[0].name = "Chrome Trace";
+                filterItem[0].spec = "json";
+                nfdu8char_t* outPath = nullptr;
+                if (save_file_dialog(&outPath, filterItem, 1, nullptr, "trace.json") == NFD_OKAY) {
+                    if (!Trace::writeChromeJson(outPath)) {
+                        fprintf(stderr, "Could not write trace: %s\n", outPath);
+                    }
+                    NFD_FreePathU8(outPath);
+                }
+            }
+#endif
             ImGui::Separator();
             if (ImGui::MenuItem("Exit")) {
                 sapp_request_quit();
@@ -607,7 +2889,7 @@ void draw_player_window() {
                 filterItem[1].spec = "*";
                 
                 nfdu8char_t* outPath = nullptr;
-                nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
+                nfdresult_t result = open_file_dialog(&outPath, filterItem, 2, nullptr);
                 
                 if (result == NFD_OKAY) {
                     load_nes_rom(outPath);
@@ -617,9 +2899,141 @@ void draw_player_window() {
             ImGui::MenuItem("Show Emulator Window", nullptr, &show_emulator);
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Audio")) {
+            // Latency profiles re-create the audio stream without a restart
+            for (int i = 0; i < LATENCY_PROFILE_COUNT; ++i) {
+                const LatencyProfile& profile = LATENCY_PROFILES[i];
+                char label[64];
+                snprintf(label, sizeof(label), "%s (%.0f ms)", profile.name,
+                         profile.buffer_frames * 1000.0f / state.sample_rate);
+                if (ImGui::MenuItem(label, nullptr, state.latency_profile == i) && state.latency_profile != i) {
+                    apply_latency_profile(i);
+                }
+            }
+            ImGui::Separator();
+            if (ImGui::BeginMenu("Resampling")) {
+                // Both the NSF player's and the emulator's synthesis; the
+                // Performance window shows what each tier has cost
+                const int current = state.ui.synth_quality.load(std::memory_order_relaxed);
+                for (int i = 0; i < AudioTelemetry::SYNTH_QUALITIES; ++i) {
+                    if (ImGui::MenuItem(AudioTelemetry::synthQualityName(i), nullptr, current == i) && current != i) {
+                        state.ui.synth_quality.store(i, std::memory_order_relaxed);
+                        state.nes_emu.setSynthQuality(i);
+                    }
+                }
+                ImGui::EndMenu();
+            }
+            ImGui::Separator();
+            if (ImGui::MenuItem("Auto-size NES Buffer", nullptr, &state.nes_buffer_auto)) {
+                size_nes_buffer(true);
+            }
+            if (!state.nes_buffer_auto) {
+                ImGui::SetNextItemWidth(120);
+                ImGui::SliderInt("NES Buffer", &state.nes_buffer_ms, 50, MAX_NES_BUFFER_MS, "%d ms");
+                if (ImGui::IsItemDeactivatedAfterEdit()) size_nes_buffer(true);
+            }
+            ImGui::TextDisabled("NES buffer %d ms, frames up to %.1f ms late", state.nes_emu.audioBufferLength(),
+                                state.nes.nes_jitter_ms.load(std::memory_order_relaxed));
+            if (ImGui::BeginMenu("NES Stereo")) {
+                // Only the mix of the emulator's voices changes; they are
+                // synthesized one by one for the scopes either way
+                bool stereo = state.ui.nes_stereo.load(std::memory_order_relaxed);
+                if (ImGui::MenuItem("Pan Voices", nullptr, &stereo)) {
+                    state.ui.nes_stereo.store(stereo, std::memory_order_relaxed);
+                }
+                ImGui::BeginDisabled(!stereo);
+                static const ChannelTable voices = ChannelTable::forNesEmulator(true);
+                for (int i = 0; i < voices.count; ++i) {
+                    const int voice = voices.voice[i];
+                    float pan = state.nes_emu.channelPan(voice);
+                    ImGui::SetNextItemWidth(120);
+                    if (ImGui::SliderFloat(voices.name[i], &pan, -1.0f, 1.0f, "%+.2f")) {
+                        state.nes_emu.setChannelPan(voice, pan);
+                    }
+                }
+                if (ImGui::MenuItem("Reset Pans")) {
+                    for (int voice = 0; voice < NesEmulator::TAP_COUNT; ++voice) {
+                        state.nes_emu.setChannelPan(voice, NES_DEFAULT_PANS[voice]);
+                    }
+                }
+                ImGui::EndDisabled();
+                ImGui::EndMenu();
+            }
+            ImGui::Separator();
+            if (ImGui::BeginMenu("Thread Scheduling")) {
+                // Render-ahead producer and NES emulation; the OS may refuse
+                // real-time without the rights, which the status lines show
+                static const std::pair<const char*, ThreadScheduling::Priority> PRIORITIES[] = {
+                    {"OS Default", ThreadScheduling::Priority::Normal},
+                    {"High", ThreadScheduling::Priority::High},
+                    {"Real-time", ThreadScheduling::Priority::Realtime},
+                };
+                for (const auto& [label, priority] : PRIORITIES) {
+                    if (ImGui::MenuItem(label, nullptr, state.thread_priority == priority) &&
+                        state.thread_priority != priority) {
+                        state.thread_priority = priority;
+                        apply_thread_scheduling();
+                    }
+                }
+                ImGui::Separator();
+                ImGui::BeginDisabled(ThreadScheduling::coreCount() < 3);
+                if (ImGui::MenuItem("Pin to Own Cores", nullptr, &state.pin_threads)) {
+                    apply_thread_scheduling();
+                }
+                ImGui::EndDisabled();
+                ImGui::TextDisabled("%s", state.render_scheduling.status().c_str());
+                ImGui::TextDisabled("%s", state.nes_scheduling.status().c_str());
+                ImGui::EndMenu();
+            }
+            ImGui::Separator();
+            if (ImGui::BeginMenu("OSC Output")) {
+                const bool running = state.osc.isRunning();
+                ImGui::BeginDisabled(running);
+                ImGui::SetNextItemWidth(160);
+                ImGui::InputText("Host", state.osc_host, sizeof(state.osc_host));
+                ImGui::SetNextItemWidth(160);
+                ImGui::InputInt("Port", &state.osc_port);
+                ImGui::SetNextItemWidth(160);
+                ImGui::SliderInt("Rate", &state.osc_rate, 1, 120, "%d Hz");
+                ImGui::EndDisabled();
+                bool send = running;
+                if (ImGui::Checkbox("Send", &send)) {
+                    if (send) {
+                        state.osc_error.clear();
+                        state.osc.start(state.osc_host, std::clamp(state.osc_port, 1, 65535), state.osc_rate,
+                                        &state.osc_error);
+                    } else {
+                        state.osc.stop();
+                    }
+                }
+                if (!state.osc_error.empty()) {
+                    ImGui::TextColored(ImVec4(0.8f, 0.3f, 0.3f, 1.0f), "%s", state.osc_error.c_str());
+                } else if (running) {
+                    ImGui::TextDisabled("%u packets sent, %u dropped", state.osc.packetsSent(),
+                                        state.osc.packetsDropped());
+                }
+                ImGui::EndMenu();
+            }
+            ImGui::EndMenu();
+        }
         if (ImGui::BeginMenu("View")) {
             ImGui::MenuItem("Audio Visualizer", nullptr, &show_visualizer);
             ImGui::MenuItem("Piano Visualizer", nullptr, &show_piano);
+            ImGui::MenuItem("Performance", nullptr, &show_performance);
+            ImGui::MenuItem("Library", nullptr, &show_library);
+            ImGui::MenuItem("Queue", nullptr, &show_queue);
+            ImGui::MenuItem("Frame Profiler", nullptr, &show_frame_profiler);
+            ImGui::MenuItem("Multi View", nullptr, &show_multi_view);
+            ImGui::MenuItem("Memory", nullptr, &show_memory);
+            ImGui::MenuItem("Play Routine", nullptr, &show_play_routine);
+            ImGui::Separator();
+            bool adaptive = state.quality.enabled();
+            if (ImGui::MenuItem("Adaptive Quality", nullptr, &adaptive)) state.quality.setEnabled(adaptive);
+            if (adaptive) {
+                ImGui::TextDisabled("Level %d / %d, load %.0f%% of %.1f ms", state.quality.level(),
+                                    QualityGovernor::MAX_LEVEL, state.quality.load() * 100.0,
+                                    state.quality.budgetMs());
+            }
             ImGui::Separator();
             ImGui::MenuItem("ImGui Demo", nullptr, &show_demo_window);
             ImGui::EndMenu();
@@ -658,17 +3072,18 @@ void draw_player_window() {
         filterItem[1].spec = "*";
         
         nfdu8char_t* outPath = nullptr;
-        nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
+        nfdresult_t result = open_file_dialog(&outPath, filterItem, 2, nullptr);
         
         if (result == NFD_OKAY) {
             load_nsf_file(outPath);
-            postload_preprocess();
             NFD_FreePathU8(outPath);
         }
     }
     
     // Error display
-    if (state.error_msg[0] != '\0') {
+    if (state.file_load.active) {
+        ImGui::TextDisabled("Loading %s...", std::filesystem::path(state.file_load.path).filename().string().c_str());
+    } else if (state.error_msg[0] != '\0') {
         ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Error: %s", state.error_msg);
     }
     
@@ -676,24 +3091,34 @@ void draw_player_window() {
     
     // Track info and controls (only if file loaded)
     if (state.emu) {
-        // Track info
-        track_info_t info;
-        if (gme_track_info(state.emu, &info, state.current_track) == nullptr) {
+        // Track info, as read when the file was loaded
+        const track_info_t* track_info = state.current_track >= 0 &&
+                                                 state.current_track < static_cast<int>(state.track_info.size())
+                                             ? &state.track_info[state.current_track]
+                                             : nullptr;
+        if (track_info) {
+            const track_info_t& info = *track_info;
             ImGui::BeginChild("TrackInfo", ImVec2(0, 80), true);
             
-            if (info.game[0]) {
-                ImGui::Text("Game: %s", info.game);
-            }
-            if (info.song[0]) {
-                ImGui::Text("Song: %s", info.song);
-            } else {
-                ImGui::Text("Track: %d / %d", state.current_track + 1, state.track_count);
-            }
-            if (info.author[0]) {
-                ImGui::Text("Author: %s", info.author);
-            }
-            if (info.copyright[0]) {
-                ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "© %s", info.copyright);
+            // Replayed until the track or the file changes
+            const uint64_t version = static_cast<uint64_t>(state.track_info_serial) << 32 |
+                                     static_cast<uint32_t>(state.current_track);
+            if (!state.track_info_panel.begin(version)) {
+                if (info.game[0]) {
+                    ImGui::Text("Game: %s", info.game);
+                }
+                if (info.song[0]) {
+                    ImGui::Text("Song: %s", info.song);
+                } else {
+                    ImGui::Text("Track: %d / %d", state.current_track + 1, state.track_count);
+                }
+                if (info.author[0]) {
+                    ImGui::Text("Author: %s", info.author);
+                }
+                if (info.copyright[0]) {
+                    ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "© %s", info.copyright);
+                }
+                state.track_info_panel.end();
             }
             
             ImGui::EndChild();
@@ -709,14 +3134,56 @@ void draw_player_window() {
         ImGui::SameLine();
         ImGui::Text("/ %d", state.track_count);
         
+        // Piano notes are still being worked out in the background
+        const float note_progress = state.notes.progress(state.current_track);
+        const bool notes_partial = state.piano_track != state.current_track ||
+                                   (state.piano_notes && !state.piano_notes->complete);
+        if (notes_partial && note_progress >= 0.0f) {
+            ImGui::ProgressBar(note_progress, ImVec2(-1, 0), "Analyzing notes...");
+        }
+        const int tracks_done = state.notes.tracksDone();
+        if (tracks_done < state.notes.trackCount()) {
+            ImGui::TextDisabled("Notes ready for %d / %d tracks", tracks_done, state.notes.trackCount());
+        }
+        // How fast this machine works notes out, as shares of the passes' wall time
+        const PreprocessStats note_stats = state.notes.passStats();
+        if (note_stats.passes > 0 && note_stats.wall_seconds > 0.0) {
+            const double share = 100.0 / note_stats.wall_seconds;
+            ImGui::TextDisabled("Note passes: %.0fx realtime, %.0f%% emulation, %.0f%% notes, %.0f%% sort",
+                                note_stats.realtimeFactor(), note_stats.emulate_seconds * share,
+                                note_stats.extract_seconds * share, note_stats.sort_seconds * share);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%d passes over %.1f s of music in %.2f s\n"
+                                  "Emulation %.3f s, note extraction %.3f s, sort %.3f s\n"
+                                  "%llu notes",
+                                  note_stats.passes, note_stats.emulated_seconds, note_stats.wall_seconds,
+                                  note_stats.emulate_seconds, note_stats.extract_seconds, note_stats.sort_seconds,
+                                  static_cast<unsigned long long>(note_stats.notes));
+            }
+        }
+        const int tracks_exported = state.notes.tracksExported();
+        if (tracks_exported >= 0 && tracks_exported < state.notes.trackCount()) {
+            ImGui::TextDisabled("MIDI written for %d / %d tracks", tracks_exported, state.notes.trackCount());
+        }
+        const int wav_tracks = state.wav_export.trackCount();
+        const int wav_written = state.wav_export.tracksWritten();
+        if (wav_written >= 0 && wav_written < wav_tracks) {
+            ImGui::TextDisabled("WAV written for %d / %d tracks", wav_written, wav_tracks);
+        } else if (wav_written > 0 && state.wav_export.tracksFailed() > 0) {
+            ImGui::TextDisabled("WAV export: %d of %d tracks failed", state.wav_export.tracksFailed(), wav_tracks);
+        }
+        
         ImGui::Separator();
         
         // Playback position and seek bar
         {
             long pos = gme_tell(state.emu);
             long length = 0;
-            if (gme_track_info(state.emu, &info, state.current_track) == nullptr) {
-                length = info.length > 0 ? info.length : 150000; // Default 2:30 if unknown
+            const int entry = state.queue.current();
+            if (entry >= 0) {
+                length = state.queue.items()[entry].length_ms + state.queue.items()[entry].fade_ms;
+            } else if (track_info) {
+                length = track_info->length > 0 ? track_info->length : 150000; // Default 2:30 if unknown
             }
             if (length <= 0) length = 150000; // Fallback
             
@@ -736,9 +3203,11 @@ void draw_player_window() {
             float available_width = ImGui::GetContentRegionAvail().x;
             float slider_width = available_width - time_width - 20;
             
-            // Progress slider (interactive seek bar)
-            float progress = static_cast<float>(pos) / static_cast<float>(length);
-            progress = std::clamp(progress, 0.0f, 1.0f);
+            // Progress slider (interactive seek bar); a drag holds its own
+            // position, and a seek not yet taken by the render thread its target
+            const long pending_seek = state.ui.seek_request.load();
+            float progress = static_cast<float>(pending_seek >= 0 ? pending_seek : pos) / static_cast<float>(length);
+            progress = std::clamp(state.seek_drag >= 0.0f ? state.seek_drag : progress, 0.0f, 1.0f);
             
             ImGui::SetNextItemWidth(slider_width);
             ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0.15f, 0.15f, 0.25f, 1.0f));
@@ -749,10 +3218,32 @@ void draw_player_window() {
             ImGui::PushStyleVar(ImGuiStyleVar_GrabMinSize, 12.0f);
             ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 4.0f);
             
-            if (ImGui::SliderFloat("##seek", &progress, 0.0f, 1.0f, "")) {
-                // User is seeking - send request to audio thread
-                long new_pos = static_cast<long>(progress * length);
-                state.seek_request.store(new_pos);
+            // Dragging previews; the seek goes to the render thread once, on
+            // release, and restores the nearest keyframe there
+            if (ImGui::SliderFloat("##seek", &progress, 0.0f, 1.0f, "")) state.seek_drag = progress;
+            if (ImGui::IsItemDeactivated()) {
+                if (state.seek_drag >= 0.0f) state.ui.seek_request.store(static_cast<long>(state.seek_drag * length));
+                state.seek_drag = -1.0f;
+            }
+            const bool seek_active = ImGui::IsItemActive();
+            const ImVec2 seek_min = ImGui::GetItemRectMin();
+            const ImVec2 seek_max = ImGui::GetItemRectMax();
+            
+            // The notes at the hovered or dragged time, from the preprocessed
+            // track: an index lookup, nothing emulated
+            if ((ImGui::IsItemHovered() || seek_active) && state.piano.hasPreprocessedData() &&
+                state.piano_track == state.current_track && seek_max.x > seek_min.x) {
+                const float at = seek_active ? progress
+                                             : std::clamp((ImGui::GetIO().MousePos.x - seek_min.x) /
+                                                               (seek_max.x - seek_min.x), 0.0f, 1.0f);
+                const float at_seconds = at * length / 1000.0f;
+                const float at_x = seek_min.x + at * (seek_max.x - seek_min.x);
+                ImGui::GetWindowDrawList()->AddLine(ImVec2(at_x, seek_min.y), ImVec2(at_x, seek_max.y),
+                                                    IM_COL32(255, 255, 255, 160));
+                ImGui::BeginTooltip();
+                ImGui::Text("%02d:%02d", static_cast<int>(at_seconds) / 60, static_cast<int>(at_seconds) % 60);
+                state.piano.drawPianoRoll("##seek_preview", 320.0f, 120.0f, NoteClock::fromSeconds(at_seconds));
+                ImGui::EndTooltip();
             }
             
             ImGui::PopStyleVar(2);
@@ -777,14 +3268,25 @@ void draw_player_window() {
                 color_left, color_right, color_right, color_left
             );
             
-            // Check if track ended
-            if (state.is_playing.load() && gme_track_ended(state.emu)) {
-                // Auto-advance to next track
-                if (state.current_track < state.track_count - 1) {
+            // A gapless switch became audible, or the track ended with no
+            // prefetched successor and the next one has to be started here
+            if (take_request(state.audio.track_switched, false)) {
+                finish_track_switch();
+            } else if (take_request(state.render.track_end_unhandled, false) &&
+                       state.ui.is_playing.load() && gme_track_ended(state.emu)) {
+                // Auto-advance to the next queue entry, or the next track
+                if (state.queue.current() >= 0) {
+                    const int next = state.queue.next();
+                    if (next >= 0) {
+                        play_queue_entry(next);
+                    } else {
+                        state.ui.is_playing.store(false);
+                    }
+                } else if (state.current_track < state.track_count - 1) {
                     state.current_track++;
                     start_track_with_preprocess(state.current_track);
                 } else {
-                    state.is_playing.store(false);
+                    state.ui.is_playing.store(false);
                 }
             }
         }
@@ -804,21 +3306,21 @@ void draw_player_window() {
             ImGui::SameLine();
             
             // Play/Pause
-            const char* play_label = state.is_playing.load() ? "||" : ">";
+            const char* play_label = state.ui.is_playing.load() ? "||" : ">";
             if (ImGui::Button(play_label, ImVec2(50, 30))) {
-                if (!state.is_playing.load()) {
+                if (!state.ui.is_playing.load()) {
                     safe_start_track(state.current_track);  // Same track, no re-preprocessing
                 } else {
-                    state.is_playing.store(false);
+                    state.ui.is_playing.store(false);
                 }
             }
             ImGui::SameLine();
             
             // Stop
             if (ImGui::Button("[]", ImVec2(40, 30))) {
-                state.is_playing.store(false);
+                state.ui.is_playing.store(false);
                 // Reset to beginning of track
-                state.seek_request.store(0);
+                state.ui.seek_request.store(0);
             }
             ImGui::SameLine();
             
@@ -841,23 +3343,37 @@ void draw_player_window() {
         ImGui::SetNextItemWidth(200);
         if (ImGui::SliderFloat("Volume", &state.volume_db, -40.0f, 6.0f, "%.1f dB")) {
             // Volume is applied in audio callback
+            set_volume_db(state.volume_db);
         }
         ImGui::SameLine();
         if (ImGui::Button("0 dB")) {
-            state.volume_db = 0.0f;
+            set_volume_db(0.0f);
         }
         
         // Tempo
         ImGui::SetNextItemWidth(200);
         if (ImGui::SliderFloat("Tempo", &state.tempo, 0.25f, 2.0f, "%.2fx")) {
-            gme_set_tempo(state.emu, state.tempo);
+            set_tempo(state.tempo);
         }
         ImGui::SameLine();
         if (ImGui::Button("1.0x")) {
-            state.tempo = 1.0f;
-            gme_set_tempo(state.emu, state.tempo);
+            set_tempo(1.0f);
         }
         
+        // Render-ahead depth and current ring fill
+        int render_ahead = state.ui.render_ahead_ms.load();
+        ImGui::SetNextItemWidth(200);
+        if (ImGui::SliderInt("Render Ahead", &render_ahead, RENDER_AHEAD_MIN_MS, RENDER_AHEAD_MAX_MS, "%d ms")) {
+            state.ui.render_ahead_ms.store(render_ahead);
+        }
+        float fill_ms = static_cast<float>(state.render_ring.readAvailable() / 2) * 1000.0f / state.sample_rate;
+        char fill_str[32];
+        snprintf(fill_str, sizeof(fill_str), "%.0f ms", fill_ms);
+        ImGui::SetNextItemWidth(200);
+        ImGui::ProgressBar(fill_ms / static_cast<float>(render_ahead), ImVec2(200, 0), fill_str);
+        ImGui::SameLine();
+        ImGui::Text("Buffered");
+        
         // Voice info
         ImGui::Separator();
         ImGui::Text("NES APU Channels:");
@@ -866,15 +3382,14 @@ void draw_player_window() {
         const char** voice_names = gme_voice_names(state.emu);
         
         ImGui::Columns(voice_count, "voices", false);
-        for (int i = 0; i < voice_count && i < 5; ++i) {
-            NesChannel channel = static_cast<NesChannel>(i);
-            bool muted = state.visualizer.isChannelMuted(channel);
+        for (int i = 0; i < voice_count && i < ChannelTable::APU_CHANNELS; ++i) {
+            bool muted = state.visualizer.isChannelMuted(i);
             
-            ImGui::PushStyleColor(ImGuiCol_CheckMark, ChannelColors[i]);
+            ImGui::PushStyleColor(ImGuiCol_CheckMark, state.visualizer.getChannelLayout().color[i]);
             char label[64];
             snprintf(label, sizeof(label), "%s##ch%d", voice_names[i], i);
             if (ImGui::Checkbox(label, &muted)) {
-                state.visualizer.setChannelMute(channel, muted);
+                state.visualizer.setChannelMute(i, muted);
             }
             ImGui::PopStyleColor();
             
@@ -883,40 +3398,216 @@ void draw_player_window() {
         ImGui::Columns(1);
     } else {
         // No file loaded
-        ImGui::Dummy(ImVec2(0, 20));
-        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.6f, 1.0f), "Load an NSF file to start playing NES music!");
-        ImGui::Dummy(ImVec2(0, 10));
-        ImGui::TextColored(ImVec4(0.4f, 0.4f, 0.5f, 1.0f), "Supported formats: .nsf, .nsfe");
+        if (!state.idle_panel.begin(0)) {
+            ImGui::Dummy(ImVec2(0, 20));
+            ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.6f, 1.0f), "Load an NSF file to start playing NES music!");
+            ImGui::Dummy(ImVec2(0, 10));
+            ImGui::TextColored(ImVec4(0.4f, 0.4f, 0.5f, 1.0f), "Supported formats: .nsf, .nsfe");
+            state.idle_panel.end();
+        }
     }
     
     ImGui::Separator();
     
     // Status bar
     if (state.audio_initialized) {
-        ImGui::TextColored(ImVec4(0.3f, 0.8f, 0.3f, 1.0f), "Audio: Ready (%ld Hz)", state.sample_rate);
+        ImGui::TextColored(ImVec4(0.3f, 0.8f, 0.3f, 1.0f), "Audio: Ready (%ld Hz, %d frames)",
+                           state.sample_rate, audio_device_frames());
+#if AUDIO_ALLOC_CHECK
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.6f, 1.0f), "Callback allocs: %u", audio_callback_allocs.load());
+#endif
+    } else if (!state.audio_setup_called) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.6f, 1.0f), "Audio: Opens on first play");
     } else {
         ImGui::TextColored(ImVec4(0.8f, 0.3f, 0.3f, 1.0f), "Audio: Not initialized");
     }
+    if (state.video_recorder.isRecording()) {
+        const VideoRecorder& recorder = state.video_recorder;
+        ImGui::TextColored(ImVec4(0.9f, 0.3f, 0.3f, 1.0f), "Recording %.1f s, %u frames dropped, %u audio overruns",
+                           static_cast<double>(recorder.audioFrames()) / recorder.sampleRate(),
+                           recorder.framesDropped(), recorder.audioOverruns());
+    }
+    if (state.output_recorder.isRecording()) {
+        const WavRecorder& recorder = state.output_recorder;
+        ImGui::TextColored(ImVec4(0.9f, 0.3f, 0.3f, 1.0f), "Recording output %.1f s, %u overruns",
+                           static_cast<double>(recorder.framesPushed()) / recorder.sampleRate(),
+                           recorder.overruns());
+    }
+    if (!state.record_error.empty()) {
+        ImGui::TextColored(ImVec4(0.8f, 0.3f, 0.3f, 1.0f), "%s", state.record_error.c_str());
+    }
     
     ImGui::End();
 }
 
+// Add up what every owner holds, every MEMORY_SAMPLE_MS whether or not the
+// window is open, so its peaks cover the whole run (UI thread)
+static constexpr int MEMORY_SAMPLE_MS = 500;
+
+static void sample_memory() {
+    static std::chrono::steady_clock::time_point last_sample;
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_sample < std::chrono::milliseconds(MEMORY_SAMPLE_MS)) return;
+    last_sample = now;
+    
+    MemoryReport::Sample sample;
+    state.visualizer.reportMemory(sample);
+    state.piano.reportMemory(sample);
+    state.notes.reportMemory(sample);
+    state.nes_emu.reportMemory(sample);
+    state.nes_lookahead.reportMemory(sample);
+    state.nes_rewind.reportMemory(sample);
+    state.nes_slots.reportMemory(sample);
+    state.multi_view.reportMemory(sample);
+    sample.add(MemoryReport::MUSIC_EMU, ZipArchive::cachedBytes());  // Archive directories and inflate buffers
+    sample.add(MemoryReport::AUDIO_QUEUES, MemoryReport::heapBytes(state.viz_buffer));
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex);
+        report_music_emu_memory(state.emu, sample);
+        sample.add(MemoryReport::MUSIC_EMU, state.seek_index.memoryBytes());
+        sample.add(MemoryReport::AUDIO_QUEUES, state.render_ring.memoryBytes() + MemoryReport::heapBytes(state.prerender) +
+                                                   state.mix_bus.memoryBytes());
+        
+        // A READY prefetch belongs to whoever holds audio_mutex
+        TrackPrefetch& pf = state.prefetch;
+        if (pf.status.load() == TrackPrefetch::READY) {
+            report_music_emu_memory(pf.emu, sample);
+            sample.add(MemoryReport::MUSIC_EMU, pf.seek_index.memoryBytes());
+            sample.add(MemoryReport::AUDIO_QUEUES, MemoryReport::heapBytes(pf.pcm));
+            pf.piano.reportMemory(sample);
+        }
+    }
+    state.memory.record(sample);
+}
+
+// Pace frames down while the app has nothing to show changing (UI thread)
+static void idle_wait() {
+    const auto now = std::chrono::steady_clock::now();
+    const bool busy = state.ui.is_playing.load() || state.file_load.active || state.offline.isActive() ||
+                      state.multi_view.count() > 0 ||
+                      (current_mode == AppMode::NES_EMULATOR && state.nes_emu.isRunning());
+    if (busy || now - last_input_time < std::chrono::milliseconds(IDLE_AFTER_MS)) {
+        last_frame_time = now;
+        return;
+    }
+    const auto next = last_frame_time + std::chrono::milliseconds(IDLE_FRAME_MS);
+    if (next > now) {
+        std::this_thread::sleep_for(next - now);
+    }
+    last_frame_time = std::chrono::steady_clock::now();
+}
+
+// Set the visualizers to a quality level (UI thread)
+static void apply_quality(int level) {
+    if (level == state.quality_level) return;
+    state.quality_level = level;
+    const QualityGovernor::Settings settings = QualityGovernor::settings(level);
+    state.visualizer.setFftSizeLimit(settings.max_fft_size);
+    state.visualizer.setSpectrogramUploadInterval(settings.spectrogram_upload_interval);
+    state.piano.setNoteEffects(settings.note_glow, settings.note_outline);
+    state.piano.setNoteDetail(settings.note_merge_pixels, settings.note_detail_pixels);
+}
+
+// Render the ImGui frame built since build_start
+static void submit_frame(FrameProfiler::Clock::time_point build_start) {
+    sg_pass _sg_pass{};
+    _sg_pass = { .action = state.pass_action, .swapchain = sglue_swapchain() };
+
+    const FrameProfiler::Clock::time_point submit_start = FrameProfiler::Clock::now();
+    FrameProfiler::add(FrameProfiler::IMGUI_BUILD, submit_start - build_start);
+    FrameProfiler::beginGpu(FrameProfiler::GPU_MAIN_PASS);
+    sg_begin_pass(&_sg_pass);
+    simgui_render();
+    sg_end_pass();
+    FrameProfiler::endGpu(FrameProfiler::GPU_MAIN_PASS);
+    sg_commit();
+    if (!first_frame_submitted) startup_mark("first frame");
+    FrameProfiler::add(FrameProfiler::SUBMIT, FrameProfiler::Clock::now() - submit_start);
+    FrameProfiler::endFrame(show_frame_profiler ? ImGui::GetDrawData() : nullptr);
+}
+
+// One record of the counters per --telemetry interval; the export's job
+// writes it (UI thread)
+static void export_telemetry() {
+    const TelemetryExport::Clock::time_point now = TelemetryExport::Clock::now();
+    if (!state.telemetry_export.due(now)) return;
+    TelemetryExport::Record record;
+    const bool nes = current_mode == AppMode::NES_EMULATOR;
+    record.mode = nes ? "nes" : "nsf";
+    record.playing = nes ? state.nes_emu.isRunning() : state.ui.is_playing.load();
+    record.audio = state.telemetry.query();
+    record.frames = FrameProfiler::averages();
+    record.nes_run_ahead_ms = state.nes_emu.runAheadCost();
+    record.nes_skipped_frames = state.nes.nes_skipped_frames.load(std::memory_order_relaxed);
+    record.nes_jitter_ms = state.nes.nes_jitter_ms.load(std::memory_order_relaxed);
+    record.memory = state.memory.current();
+    record.note_passes = state.notes.passStats();
+    record.resident_bytes = MemoryReport::processResidentBytes();
+    state.telemetry_export.submit(record, now);
+}
+
 void frame(void) {
+    idle_wait();
+    FC_ZONE("frame");
+    
+    // The previous frame has been presented since
+    if (state.nes_submitted_input != std::chrono::steady_clock::time_point()) {
+        FrameProfiler::addInputLatency(state.nes_submitted_input, std::chrono::steady_clock::now());
+        state.nes_submitted_input = std::chrono::steady_clock::time_point();
+    }
+    sample_memory();
+    export_telemetry();
+    replay_apu_timeline();
+    publish_osc_snapshot();
+    
+    // What is being heard as this frame goes up, for its read-back
+    state.capture_audio_pos[sapp_frame_count() % std::size(state.capture_audio_pos)] =
+        state.audio_initialized ? state.video_recorder.audioFrames() - audio_device_frames() : 0;
+    
+    // Open the audio device once there is something to play
+    if (!state.audio_setup_called && (state.ui.is_playing.load() || state.multi_view.count() > 0 ||
+                                      (current_mode == AppMode::NES_EMULATOR && state.nes_emu.isRunning()))) {
+        open_audio_device(LATENCY_PROFILES[state.latency_profile]);
+        size_nes_buffer(true);
+        startup_mark("audio device");
+    }
     const int width = sapp_width();
     const int height = sapp_height();
+    const FrameProfiler::Clock::time_point build_start = FrameProfiler::Clock::now();
+    
+    // An offline render runs on its own clock and draws nothing else
+    if (state.offline.isActive()) {
+        apply_quality(0);  // Rendered frames have no deadline
+        simgui_new_frame({ width, height, state.offline.frameSeconds(), sapp_dpi_scale() });
+        if (ImGui::IsKeyPressed(ImGuiKey_Escape)) stop_offline_render();
+        if (state.offline.isActive()) draw_offline_frame();
+        submit_frame(build_start);
+        return;
+    }
     simgui_new_frame({ width, height, sapp_frame_duration(), sapp_dpi_scale() });
 
-    // Run NES emulator frame if active
+    // Feed the emulation thread input and show the frame it finished last
     if (current_mode == AppMode::NES_EMULATOR && state.nes_emu.isRunning()) {
-        // Update input from keyboard (only if ImGui doesn't want keyboard)
-        if (!ImGui::GetIO().WantCaptureKeyboard) {
-            update_nes_input();
+        // Controller input is queued by input() as keys change
+        const bool keyboard = !ImGui::GetIO().WantCaptureKeyboard;
+        state.ui.nes_fast_forward.store(state.nes_turbo || (keyboard && key_states[SAPP_KEYCODE_TAB]));
+        state.ui.nes_rewinding.store(keyboard && key_states[SAPP_KEYCODE_R] && !ImGui::GetIO().KeyCtrl);
+        pace_nes_frame();
+        state.nes_emu.updateScreenTexture();
+        const auto shown_input = state.nes_emu.takeShownInputTime();
+        if (std::chrono::steady_clock::now() - shown_input < std::chrono::milliseconds(MAX_INPUT_LATENCY_MS)) {
+            state.nes_submitted_input = shown_input;
         }
-        
-        // Run one frame of emulation
-        state.nes_emu.runFrame();
+        size_nes_buffer(false);
     }
 
+    // Install a file opened in the background, then pick up piano notes
+    poll_file_load();
+    poll_queue_loads();
+    poll_preprocess();
+    poll_lookahead();
+    
     // Main player window
     draw_player_window();
     
@@ -924,18 +3615,67 @@ void frame(void) {
     if (show_emulator) {
         draw_emulator_window(&show_emulator);
     }
+#ifdef AGNES_PROFILE
+    if (show_cpu_profile) {
+        draw_cpu_profile_window(&show_cpu_profile);
+    }
+#endif
     
-    // Visualizer window
+    // Visualizer window, scrubbable while nothing plays
+    state.visualizer.setScrubAllowed(current_mode == AppMode::NES_EMULATOR ? !state.nes_emu.isRunning()
+                                                                           : !state.ui.is_playing.load());
     if (show_visualizer) {
         state.visualizer.drawVisualizerWindow(&show_visualizer);
     }
     
     // Piano visualizer window
     if (show_piano) {
-        float current_time = (current_mode == AppMode::NES_EMULATOR) 
-            ? static_cast<float>(state.nes_emu.getCpuCycles()) / 1789773.0f
-            : state.playback_time.load();
+        // The emulator's CPU cycles are the note clock as they are
+        const int64_t current_time = (current_mode == AppMode::NES_EMULATOR)
+            ? static_cast<int64_t>(nes_heard_cycles())
+            : NoteClock::fromFrames(state.audio.playback_frames.load(), state.sample_rate);
         state.piano.drawPianoWindow(&show_piano, current_time);
+        
+        // The overview seeks the player; the emulator cannot seek
+        float seek_seconds;
+        if (state.piano.takeSeekRequest(seek_seconds) && current_mode == AppMode::NSF_PLAYER && state.emu) {
+            state.ui.seek_request.store(static_cast<long>(seek_seconds * 1000.0f));
+        }
+    }
+    
+    // Audio performance counters
+    if (show_play_routine) {
+        draw_play_routine_window(&show_play_routine);
+    }
+    if (show_performance) {
+        state.telemetry.drawPerformanceWindow(&show_performance);
+    }
+    
+    // Music library browser
+    if (show_library) {
+        draw_library_window(&show_library);
+    }
+    if (show_queue) {
+        draw_queue_window(&show_queue);
+    }
+    if (show_frame_profiler) {
+        FrameProfiler::drawWindow(&show_frame_profiler);
+    }
+    state.multi_view.tick();
+    if (show_multi_view && state.multi_view.drawWindow(&show_multi_view)) {
+        nfdu8filteritem_t filterItem[2];
+        filterItem[0].name = "ROMs and Music Files";
+        filterItem[0].spec = "nes,nsf,nsfe,spc,gbs,vgm,vgz,ay,sap,kss,hes,gym";
+        filterItem[1].name = "All Files";
+        filterItem[1].spec = "*";
+        nfdu8char_t* outPath = nullptr;
+        if (open_file_dialog(&outPath, filterItem, 2, nullptr) == NFD_OKAY) {
+            state.multi_view.add(outPath, nullptr);  // The window shows a failure
+            NFD_FreePathU8(outPath);
+        }
+    }
+    if (show_memory) {
+        state.memory.drawWindow(&show_memory);
     }
     
     // ImGui demo window
@@ -943,18 +3683,45 @@ void frame(void) {
         ImGui::ShowDemoWindow(&show_demo_window);
     }
 
-    sg_pass _sg_pass{};
-    _sg_pass = { .action = state.pass_action, .swapchain = sglue_swapchain() };
-
-    sg_begin_pass(&_sg_pass);
-    simgui_render();
-    sg_end_pass();
-    sg_commit();
+    submit_frame(build_start);
+    
+    // Present is left out: with vsync it waits out whatever the frame saved
+    state.quality.update(FrameProfiler::Clock::now() - build_start, sapp_frame_duration());
+    apply_quality(state.quality.level());
 }
 
 void cleanup(void) {
     // Stop audio playback
-    state.is_playing.store(false);
+    state.ui.is_playing.store(false);
+    
+    // Stop emulation before the lookahead and the emulator go away
+    state.ui.nes_thread_running.store(false);
+    if (state.nes_thread.joinable()) {
+        state.nes_thread.join();
+    }
+    
+    // Stop the render-ahead producer before the emulator goes away
+    state.ui.render_thread_running.store(false);
+    if (state.render_thread.joinable()) {
+        state.render_thread.join();
+    }
+    
+    // Stop the loader, prefetch, note and WAV export workers and free their emulators
+    discard_file_load();
+    cancel_prefetch();
+    state.notes.stop();
+    state.wav_export.cancel();
+    stop_video_recording();
+    state.output_recorder.stop();
+    state.osc.stop();
+    stop_offline_render();
+    state.library.stop();
+    state.nes_lookahead.stop();
+    state.nes_rewind.stop();
+    state.nes_slots.close();  // Saves still being written are finished
+    state.nes_battery.close(&state.nes_emu);  // And the game's own, with what it wrote last
+    state.multi_view.clear();  // Its jobs and textures, before the pool and sokol_gfx go
+    state.telemetry_export.stop();  // Records still pending are written
     
     // Wait for audio thread to finish
     {
@@ -964,37 +3731,62 @@ void cleanup(void) {
             gme_delete(state.emu);
             state.emu = nullptr;
         }
+        if (state.retired_emu) {
+            gme_delete(state.retired_emu);
+            state.retired_emu = nullptr;
+        }
     }
     
     // Cleanup sokol_audio
-    if (state.audio_initialized) {
+    if (state.audio_setup_called) {
+#ifdef __EMSCRIPTEN__
+        WebAudio::shutdown();
+#else
         saudio_shutdown();
+#endif
+        state.audio_setup_called = false;
     }
     
     // Cleanup Native File Dialog
-    NFD_Quit();
+    if (nfd_initialized) NFD_Quit();
     
+    state.visualizer.destroyTextures();
+    state.piano.destroyTextures();
+    state.offline.destroyTextures();
     simgui_shutdown();
     sg_shutdown();
 }
 
 void input(const sapp_event* ev) {
     simgui_handle_event(ev);
+    last_input_time = std::chrono::steady_clock::now();
+#ifdef __EMSCRIPTEN__
+    // Audio may only start from a user gesture
+    if (ev->type == SAPP_EVENTTYPE_MOUSE_DOWN || ev->type == SAPP_EVENTTYPE_KEY_DOWN ||
+        ev->type == SAPP_EVENTTYPE_TOUCHES_BEGAN) {
+        WebAudio::resume();
+    }
+#endif
     
-    // Handle file drag and drop
+    // Handle file drag and drop: one file opens as it is, while folders and
+    // several files go into the queue, read in the background
     if (ev->type == SAPP_EVENTTYPE_FILES_DROPPED) {
-        const int num_files = sapp_get_num_dropped_files();
-        if (num_files > 0) {
-            const char* path = sapp_get_dropped_file_path(0);
-            if (path && path[0] != '\0') {
-                // Check file extension and load appropriately
-                if (has_extension(path, "nsf") || has_extension(path, "nsfe")) {
-                    load_nsf_file(path);
-                    postload_preprocess();
-                } else if (has_extension(path, "nes")) {
-                    load_nes_rom(path);
-                }
+        std::vector<std::string> paths;
+        for (int i = 0; i < sapp_get_num_dropped_files(); ++i) {
+            const char* path = sapp_get_dropped_file_path(i);
+            if (path && path[0] != '\0') paths.emplace_back(path);
+        }
+        const char* single = paths.size() == 1 ? paths[0].c_str() : nullptr;
+        if (single && (has_extension(single, "nsf") || has_extension(single, "nsfe"))) {
+            load_nsf_file(single);
+        } else if (single && has_extension(single, "nes")) {
+            load_nes_rom(single);
+        } else if (!paths.empty()) {
+            if (state.queue.empty() && state.queue.loadsPending() == 0 && !state.ui.is_playing.load()) {
+                state.queue_autoplay = true;
             }
+            state.queue.addPaths(std::move(paths));
+            show_queue = true;
         }
     }
     
@@ -1004,6 +3796,12 @@ void input(const sapp_event* ev) {
     } else if (ev->type == SAPP_EVENTTYPE_KEY_UP) {
         if (ev->key_code < 512) key_states[ev->key_code] = false;
     }
+    // Timestamped here, not at the next frame (only if ImGui doesn't want keyboard)
+    if ((ev->type == SAPP_EVENTTYPE_KEY_DOWN || ev->type == SAPP_EVENTTYPE_KEY_UP) && !ev->key_repeat &&
+        is_nes_key(ev->key_code) && current_mode == AppMode::NES_EMULATOR && state.nes_emu.isRunning() &&
+        !ImGui::GetIO().WantCaptureKeyboard) {
+        update_nes_input(std::chrono::steady_clock::now());
+    }
     
     // Keyboard shortcuts
     if (ev->type == SAPP_EVENTTYPE_KEY_DOWN && !ImGui::GetIO().WantCaptureKeyboard) {
@@ -1011,10 +3809,10 @@ void input(const sapp_event* ev) {
             case SAPP_KEYCODE_SPACE:
                 // Toggle play/pause
                 if (state.emu) {
-                    if (!state.is_playing.load()) {
+                    if (!state.ui.is_playing.load()) {
                         safe_start_track(state.current_track);  // Same track, no re-preprocessing
                     } else {
-                        state.is_playing.store(false);
+                        state.ui.is_playing.store(false);
                     }
                 }
                 break;
@@ -1048,11 +3846,10 @@ void input(const sapp_event* ev) {
             filterItem[1].spec = "*";
             
             nfdu8char_t* outPath = nullptr;
-            nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
+            nfdresult_t result = open_file_dialog(&outPath, filterItem, 2, nullptr);
             
             if (result == NFD_OKAY) {
                 load_nsf_file(outPath);
-                postload_preprocess();
                 NFD_FreePathU8(outPath);
             }
         }
@@ -1066,7 +3863,7 @@ void input(const sapp_event* ev) {
             filterItem[1].spec = "*";
             
             nfdu8char_t* outPath = nullptr;
-            nfdresult_t result = NFD_OpenDialogU8(&outPath, filterItem, 2, nullptr);
+            nfdresult_t result = open_file_dialog(&outPath, filterItem, 2, nullptr);
             
             if (result == NFD_OKAY) {
                 load_nes_rom(outPath);
@@ -1083,14 +3880,37 @@ void input(const sapp_event* ev) {
             }
         }
         
-        // F5: Reset emulator
+        // T: Latch fast-forward on or off (Tab fast-forwards while held)
+        if (ev->key_code == SAPP_KEYCODE_T && current_mode == AppMode::NES_EMULATOR) {
+            state.nes_turbo = !state.nes_turbo;
+        }
+        
+        // F1-F4: Load a save slot, Shift+F1-F4: save to it
+        if (ev->key_code >= SAPP_KEYCODE_F1 && ev->key_code < SAPP_KEYCODE_F1 + SaveSlots::SLOT_COUNT &&
+            current_mode == AppMode::NES_EMULATOR && state.nes_rom_loaded) {
+            const int slot = ev->key_code - SAPP_KEYCODE_F1;
+            if (ev->modifiers & SAPP_MODIFIER_SHIFT) {
+                state.ui.nes_save_slot.store(slot);
+            } else {
+                state.nes_slots.prefetch(slot);
+                state.ui.nes_load_slot.store(slot);
+            }
+        }
+        
+        // F5: Reset emulator, Shift+F5: power cycle it
         if (ev->key_code == SAPP_KEYCODE_F5 && current_mode == AppMode::NES_EMULATOR) {
-            state.nes_emu.reset();
+            state.nes_emu.reset((ev->modifiers & SAPP_MODIFIER_SHIFT) != 0);
         }
     }
 }
 
 sapp_desc sokol_main(int argc, char* argv[]) {
+    startup_time = std::chrono::steady_clock::now();
+    std::string telemetry_error;
+    if (!TelemetryExport::parseArgs(argc, argv, &telemetry_options, &telemetry_error)) {
+        fprintf(stderr, "%s\n", telemetry_error.c_str());
+        telemetry_options = TelemetryExport::Options();
+    }
     sapp_desc _sapp_desc{};
     _sapp_desc.init_cb = init;
     _sapp_desc.frame_cb = frame;
@@ -1098,13 +3918,13 @@ sapp_desc sokol_main(int argc, char* argv[]) {
     _sapp_desc.event_cb = input;
     _sapp_desc.width = 1280;
     _sapp_desc.height = 720;
-    _sapp_desc.window_title = "NES Music Player - NSF Visualizer";
+    _sapp_desc.window_title = WINDOW_TITLE;
     _sapp_desc.icon.sokol_default = true;
     _sapp_desc.logger.func = slog_func;
     
     // Enable drag and drop support
     _sapp_desc.enable_dragndrop = true;
-    _sapp_desc.max_dropped_files = 1;
+    _sapp_desc.max_dropped_files = 256;  // A folder counts as one
     _sapp_desc.max_dropped_file_path_length = 4096;
     
     return _sapp_desc;